@@ -36,6 +36,7 @@ enum {
 	INTERFACE_UNKNOWN_ANNOTATION,
 	INTERFACE_INVALID_SYMBOL,
 	INTERFACE_DUPLICATE_SYMBOL,
+	INTERFACE_ILLEGAL_PROPERTY_CACHE,
 
 	METHOD_MISSING_NAME,
 	METHOD_INVALID_NAME,
@@ -52,6 +53,7 @@ enum {
 	SIGNAL_INVALID_SYMBOL,
 	SIGNAL_UNKNOWN_ANNOTATION,
 	SIGNAL_DUPLICATE_SYMBOL,
+	SIGNAL_ILLEGAL_BROADCAST,
 
 	PROPERTY_MISSING_NAME,
 	PROPERTY_INVALID_NAME,
@@ -88,6 +90,7 @@ enum {
 #define INTERFACE_INVALID_SYMBOL_STR          N_("Invalid C symbol for interface")
 #define INTERFACE_UNKNOWN_ANNOTATION_STR      N_("Unknown annotation for interface")
 #define INTERFACE_DUPLICATE_SYMBOL_STR        N_("Symbol '%s' already assigned to %s interface")
+#define INTERFACE_ILLEGAL_PROPERTY_CACHE_STR  N_("Illegal value for com.netsplit.Nih.PropertyCache interface annotation, expected 'true' or 'false'")
 
 #define METHOD_MISSING_NAME_STR               N_("<method> missing required name attribute")
 #define METHOD_INVALID_NAME_STR               N_("Invalid method name in <method> name attribute")
@@ -104,6 +107,7 @@ enum {
 #define SIGNAL_INVALID_SYMBOL_STR             N_("Invalid C symbol for signal")
 #define SIGNAL_UNKNOWN_ANNOTATION_STR         N_("Unknown annotation for signal")
 #define SIGNAL_DUPLICATE_SYMBOL_STR           N_("Symbol '%s' already assigned to %s signal")
+#define SIGNAL_ILLEGAL_BROADCAST_STR          N_("Illegal value for com.netsplit.Nih.Signal.Broadcast signal annotation, expected 'true' or 'false'")
 
 #define PROPERTY_MISSING_NAME_STR             N_("<property> missing required name attribute")
 #define PROPERTY_INVALID_NAME_STR             N_("Invalid property name in <property> name attribute")
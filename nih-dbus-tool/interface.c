@@ -154,6 +154,7 @@ interface_new (const void *parent,
 
 	interface->symbol = NULL;
 	interface->deprecated = FALSE;
+	interface->property_cache = FALSE;
 
 	nih_list_init (&interface->methods);
 	nih_list_init (&interface->signals);
@@ -340,8 +341,9 @@ interface_end_tag (XML_Parser  xmlp,
  * @value: annotation value.
  *
  * Handles applying the annotation @name with value @value to the interface
- * @interface.  Interfaces may be annotated as deprecated or may have an
- * alternate symbol name specified.
+ * @interface.  Interfaces may be annotated as deprecated, may have an
+ * alternate symbol name specified, or may request that proxies have a
+ * property cache.
  *
  * Unknown annotations or illegal values to the known annotations result
  * in an error being raised.
@@ -387,6 +389,20 @@ interface_annotation (Interface * interface,
 					  _(INTERFACE_INVALID_SYMBOL_STR));
 		}
 
+	} else if (! strcmp (name, "com.netsplit.Nih.PropertyCache")) {
+		if (! strcmp (value, "true")) {
+			nih_debug ("Marked %s interface as having a property cache",
+				   interface->name);
+			interface->property_cache = TRUE;
+		} else if (! strcmp (value, "false")) {
+			nih_debug ("Marked %s interface as not having a property cache",
+				   interface->name);
+			interface->property_cache = FALSE;
+		} else {
+			nih_return_error (-1, INTERFACE_ILLEGAL_PROPERTY_CACHE,
+					  _(INTERFACE_ILLEGAL_PROPERTY_CACHE_STR));
+		}
+
 	} else {
 		nih_error_raise_printf (INTERFACE_UNKNOWN_ANNOTATION,
 					"%s: %s: %s",
@@ -2710,3 +2726,548 @@ interface_proxy_get_all_sync_function (const void *parent,
 
 	return code;
 }
+
+
+/**
+ * interface_proxy_cache_update_function:
+ * @parent: parent object for new string,
+ * @prefix: prefix for function name,
+ * @interface: interface to generate function for,
+ * @prototypes: list to append function prototypes to.
+ *
+ * Generates C code for a function that will store the new value of one
+ * of the properties of @interface, passed in a variant, in the structure
+ * defined by interface_proxy_get_all_sync_function().  This is used as
+ * the update function of an NihDBusPropertyCache to apply the values
+ * from GetAll replies and PropertiesChanged signals.
+ *
+ * The prototype of the returned function is returned as a TypeFunc object
+ * appended to the @prototypes list.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the return string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+interface_proxy_cache_update_function (const void *parent,
+				       const char *prefix,
+				       Interface * interface,
+				       NihList *   prototypes)
+{
+	nih_local char *    c_type = NULL;
+	NihList             locals;
+	NihList             discard;
+	nih_local char *    name = NULL;
+	nih_local TypeFunc *func = NULL;
+	TypeVar *           arg;
+	nih_local char *    assert_block = NULL;
+	nih_local TypeVar * variter_var = NULL;
+	nih_local char *    demarshal_block = NULL;
+	nih_local char *    property_block = NULL;
+	nih_local char *    oom_error_code = NULL;
+	nih_local char *    type_error_code = NULL;
+	nih_local char *    vars_block = NULL;
+	nih_local char *    body = NULL;
+	char *              code = NULL;
+
+	nih_assert (prefix != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (prototypes != NULL);
+
+	nih_list_init (&locals);
+	nih_list_init (&discard);
+
+	/* The function returns an integer, and takes the structure of
+	 * property values, the name of the property and an iterator
+	 * pointing at the variant holding its new value.  We don't mark
+	 * the function deprecated since it's used internally.
+	 */
+	name = symbol_impl (NULL, prefix, interface->name,
+			    "cache", "update");
+	if (! name)
+		return NULL;
+
+	func = type_func_new (NULL, "int", name);
+	if (! func)
+		return NULL;
+
+	c_type = symbol_typedef (NULL, prefix, interface->symbol, NULL,
+				 "properties", NULL);
+	if (! c_type)
+		return NULL;
+
+	if (! type_to_pointer (&c_type, NULL))
+		return NULL;
+
+	arg = type_var_new (func, c_type, "properties");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	if (! nih_strcat (&assert_block, NULL,
+			  "nih_assert (properties != NULL);\n"))
+		return NULL;
+
+	arg = type_var_new (func, "const char *", "property");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	if (! nih_strcat (&assert_block, NULL,
+			  "nih_assert (property != NULL);\n"))
+		return NULL;
+
+	arg = type_var_new (func, "DBusMessageIter *", "iter");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	if (! nih_strcat (&assert_block, NULL,
+			  "nih_assert (iter != NULL);\n"))
+		return NULL;
+
+	/* We need an iterator for the variant */
+	variter_var = type_var_new (NULL, "DBusMessageIter", "variter");
+	if (! variter_var)
+		return NULL;
+
+	nih_list_add (&locals, &variter_var->entry);
+
+
+	/* Make sure that the value is a variant, and recurse into it */
+	if (! nih_strcat (&demarshal_block, NULL,
+			  "/* Recurse into the variant */\n"
+			  "if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_VARIANT)\n"
+			  "\tnih_return_error (-1, NIH_DBUS_INVALID_ARGS,\n"
+			  "\t                  _(NIH_DBUS_INVALID_ARGS_STR));\n"
+			  "\n"
+			  "dbus_message_iter_recurse (iter, &variter);\n"))
+		return NULL;
+
+	/* The value is demarshalled into the structure, there's nothing
+	 * to clean up in either case of error so we can just return.
+	 */
+	oom_error_code = nih_strdup (NULL,
+				     "nih_return_no_memory_error (-1);\n");
+	if (! oom_error_code)
+		return NULL;
+
+	type_error_code = nih_strdup (NULL,
+				      "nih_return_error (-1, NIH_DBUS_INVALID_ARGS,\n"
+				      "                  _(NIH_DBUS_INVALID_ARGS_STR));\n");
+	if (! type_error_code)
+		return NULL;
+
+	NIH_LIST_FOREACH (&interface->properties, iter) {
+		Property *        property = (Property *)iter;
+		DBusSignatureIter iter;
+		NihList           property_outputs;
+		NihList           property_locals;
+		nih_local char *  block = NULL;
+		int               first = TRUE;
+
+		if (property->access == NIH_DBUS_WRITE)
+			continue;
+
+		dbus_signature_iter_init (&iter, property->type);
+
+		nih_list_init (&property_outputs);
+		nih_list_init (&property_locals);
+
+		block = demarshal (NULL, &iter, "properties", "variter",
+				   property->symbol,
+				   oom_error_code,
+				   type_error_code,
+				   &property_outputs, &property_locals,
+				   prefix, interface->symbol,
+				   property->symbol, NULL,
+				   &discard);
+		if (! block)
+			return NULL;
+
+		if (! nih_strcat (&block, NULL, "\n"))
+			return NULL;
+
+		/* Each of the outputs from the demarshalling code becomes a
+		 * local variable to our function that we store the value in,
+		 * and that we copy into the structure.  The first output is
+		 * the value itself, any previous value that was allocated
+		 * is dropped; the others are array lengths, allocated as
+		 * children of the value where necessary.
+		 */
+		NIH_LIST_FOREACH_SAFE (&property_outputs, iter) {
+			TypeVar *var = (TypeVar *)iter;
+
+			if (first && strchr (var->type, '*'))
+				if (! nih_strcat_sprintf (&block, NULL,
+							  "if (properties->%s)\n"
+							  "\tnih_unref (properties->%s, properties);\n",
+							  var->name, var->name))
+					return NULL;
+
+			if (! nih_strcat_sprintf (&block, NULL,
+						  "properties->%s = %s;\n",
+						  var->name, var->name))
+				return NULL;
+
+			nih_list_add (&locals, &var->entry);
+			nih_ref (var, demarshal_block);
+
+			first = FALSE;
+		}
+
+		NIH_LIST_FOREACH_SAFE (&property_locals, iter) {
+			TypeVar *var = (TypeVar *)iter;
+
+			nih_list_add (&locals, &var->entry);
+			nih_ref (var, demarshal_block);
+		}
+
+		if (! nih_strcat (&block, NULL,
+				  "\n"
+				  "return 0;\n"))
+			return NULL;
+
+		/* Wrap the code in a test for the property by name */
+		if (! indent (&block, NULL, 1))
+			return NULL;
+
+		if (! nih_strcat_sprintf (&property_block, NULL,
+					  "\n"
+					  "if (! strcmp (property, \"%s\")) {\n"
+					  "%s"
+					  "}\n",
+					  property->name,
+					  block))
+			return NULL;
+	}
+
+	/* Ignore properties we don't know about */
+	if (! nih_strcat (&property_block, NULL,
+			  "\n"
+			  "return 0;\n"))
+		return NULL;
+
+	/* Lay out the function body, indenting it all before placing it
+	 * in the function code.
+	 */
+	vars_block = type_var_layout (NULL, &locals);
+	if (! vars_block)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&body, NULL,
+				  "%s"
+				  "\n"
+				  "%s"
+				  "\n"
+				  "%s"
+				  "%s",
+				  vars_block,
+				  assert_block,
+				  demarshal_block,
+				  property_block))
+		return NULL;
+
+	if (! indent (&body, NULL, 1))
+		return NULL;
+
+	/* Function header */
+	code = type_func_to_string (parent, func);
+	if (! code)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&code, parent,
+				  "{\n"
+				  "%s"
+				  "}\n",
+				  body)) {
+		nih_free (code);
+		return NULL;
+	}
+
+	/* Append the function to the prototypes list */
+	nih_list_add (prototypes, &func->entry);
+	nih_ref (func, code);
+
+	return code;
+}
+
+/**
+ * interface_proxy_cache_new_function:
+ * @parent: parent object for new string,
+ * @prefix: prefix for function name,
+ * @interface: interface to generate function for,
+ * @prototypes: list to append function prototypes to.
+ *
+ * Generates C code for a function that will create an NihDBusPropertyCache
+ * for the properties of @interface on a proxied remote object, storing
+ * their values with the function returned by
+ * interface_proxy_cache_update_function().
+ *
+ * The prototype of the returned function is returned as a TypeFunc object
+ * appended to the @prototypes list.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the return string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+interface_proxy_cache_new_function (const void *parent,
+				    const char *prefix,
+				    Interface * interface,
+				    NihList *   prototypes)
+{
+	nih_local char *    name = NULL;
+	nih_local char *    c_type = NULL;
+	nih_local char *    update_name = NULL;
+	nih_local TypeFunc *func = NULL;
+	TypeVar *           arg;
+	NihListEntry *      attrib;
+	nih_local char *    names_block = NULL;
+	nih_local char *    body = NULL;
+	char *              code = NULL;
+
+	nih_assert (prefix != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (prototypes != NULL);
+
+	/* The function returns the new cache, and takes the proxy object,
+	 * and the optional handler function and its data pointer as
+	 * arguments.  We want warning if the result isn't used.
+	 */
+	name = symbol_extern (NULL, prefix, interface->symbol, NULL,
+			      "cache", "new");
+	if (! name)
+		return NULL;
+
+	func = type_func_new (NULL, "NihDBusPropertyCache *", name);
+	if (! func)
+		return NULL;
+
+	attrib = nih_list_entry_new (func);
+	if (! attrib)
+		return NULL;
+
+	attrib->str = nih_strdup (attrib, "warn_unused_result");
+	if (! attrib->str)
+		return NULL;
+
+	nih_list_add (&func->attribs, &attrib->entry);
+
+	arg = type_var_new (func, "NihDBusProxy *", "proxy");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	arg = type_var_new (func, "NihDBusPropertyCacheHandler", "handler");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	arg = type_var_new (func, "void *", "data");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	/* The cache needs the names of the readable properties, which
+	 * live in a static array since it doesn't copy them, the size of
+	 * the structure to hold their values and the function to store a
+	 * value in it.
+	 */
+	NIH_LIST_FOREACH (&interface->properties, iter) {
+		Property *property = (Property *)iter;
+
+		if (property->access == NIH_DBUS_WRITE)
+			continue;
+
+		if (! nih_strcat_sprintf (&names_block, NULL,
+					  "\t\"%s\",\n",
+					  property->name))
+			return NULL;
+	}
+
+	c_type = symbol_typedef (NULL, prefix, interface->symbol, NULL,
+				 "properties", NULL);
+	if (! c_type)
+		return NULL;
+
+	update_name = symbol_impl (NULL, prefix, interface->name,
+				   "cache", "update");
+	if (! update_name)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&body, NULL,
+				  "static const char * const names[] = {\n"
+				  "%s"
+				  "\tNULL\n"
+				  "};\n"
+				  "\n"
+				  "nih_assert (proxy != NULL);\n"
+				  "\n"
+				  "return nih_dbus_property_cache_new (proxy, \"%s\",\n"
+				  "                                    names, sizeof (%s),\n"
+				  "                                    (NihDBusPropertyCacheUpdate)%s,\n"
+				  "                                    handler, data);\n",
+				  names_block ?: "",
+				  interface->name,
+				  c_type,
+				  update_name))
+		return NULL;
+
+	if (! indent (&body, NULL, 1))
+		return NULL;
+
+	/* Function header */
+	code = type_func_to_string (parent, func);
+	if (! code)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&code, parent,
+				  "{\n"
+				  "%s"
+				  "}\n",
+				  body)) {
+		nih_free (code);
+		return NULL;
+	}
+
+	/* Append the function to the prototypes list */
+	nih_list_add (prototypes, &func->entry);
+	nih_ref (func, code);
+
+	return code;
+}
+
+/**
+ * interface_proxy_get_all_cached_function:
+ * @parent: parent object for new string,
+ * @prefix: prefix for function name,
+ * @interface: interface to generate function for,
+ * @prototypes: list to append function prototypes to.
+ *
+ * Generates C code for a function that will obtain the value of all of
+ * the properties of @interface from an NihDBusPropertyCache created by
+ * the function returned by interface_proxy_cache_new_function().
+ *
+ * The values are returned in the same structure as the function returned
+ * by interface_proxy_get_all_sync_function(), which defines it.  The
+ * function never blocks; when the cache doesn't hold every value yet,
+ * it returns the NIH_DBUS_PROPERTY_NOT_CACHED error.
+ *
+ * The prototype of the returned function is returned as a TypeFunc object
+ * appended to the @prototypes list.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the return string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+interface_proxy_get_all_cached_function (const void *parent,
+					 const char *prefix,
+					 Interface * interface,
+					 NihList *   prototypes)
+{
+	nih_local char *    name = NULL;
+	nih_local char *    c_type = NULL;
+	nih_local TypeFunc *func = NULL;
+	TypeVar *           arg;
+	NihListEntry *      attrib;
+	nih_local char *    body = NULL;
+	char *              code = NULL;
+
+	nih_assert (prefix != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (prototypes != NULL);
+
+	/* The function returns an integer, and takes the cache along with
+	 * an output structure argument for the property values.  The
+	 * integer is negative if a raised error occurred, so we want
+	 * warning if the result isn't used.
+	 */
+	name = symbol_extern (NULL, prefix, interface->symbol, NULL,
+			      "get_all", "cached");
+	if (! name)
+		return NULL;
+
+	func = type_func_new (NULL, "int", name);
+	if (! func)
+		return NULL;
+
+	attrib = nih_list_entry_new (func);
+	if (! attrib)
+		return NULL;
+
+	attrib->str = nih_strdup (attrib, "warn_unused_result");
+	if (! attrib->str)
+		return NULL;
+
+	nih_list_add (&func->attribs, &attrib->entry);
+
+	arg = type_var_new (func, "NihDBusPropertyCache *", "cache");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	c_type = symbol_typedef (NULL, prefix, interface->symbol, NULL,
+				 "properties", NULL);
+	if (! c_type)
+		return NULL;
+
+	if (! type_to_pointer (&c_type, NULL))
+		return NULL;
+
+	if (! type_to_pointer (&c_type, NULL))
+		return NULL;
+
+	arg = type_var_new (func, c_type, "properties");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	if (! nih_strcat (&body, NULL,
+			  "nih_assert (cache != NULL);\n"
+			  "nih_assert (properties != NULL);\n"
+			  "\n"
+			  "return nih_dbus_property_cache_get (cache, (void **)properties);\n"))
+		return NULL;
+
+	if (! indent (&body, NULL, 1))
+		return NULL;
+
+	/* Function header */
+	code = type_func_to_string (parent, func);
+	if (! code)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&code, parent,
+				  "{\n"
+				  "%s"
+				  "}\n",
+				  body)) {
+		nih_free (code);
+		return NULL;
+	}
+
+	/* Append the function to the prototypes list */
+	nih_list_add (prototypes, &func->entry);
+	nih_ref (func, code);
+
+	return code;
+}
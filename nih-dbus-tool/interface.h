@@ -32,6 +32,7 @@
  * @name: D-Bus name of interface,
  * @symbol: name used when constructing C name,
  * @deprecated: whether this interface is deprecated,
+ * @property_cache: whether proxies should have a property cache,
  * @methods: methods defined by the interface,
  * @signals: signals defined by the interface,
  * @properties: properties defined by the interface.
@@ -43,12 +44,16 @@
  * When generating the C symbol names @symbol will be used.  If @symbol
  * is NULL, and the interface is not the first for the object, as many
  * final components of @name required to ensure uniqueness will be used.
+ *
+ * When @property_cache is TRUE, additional proxy functions are generated
+ * to read the values of the properties from an NihDBusPropertyCache.
  **/
 typedef struct interface {
 	NihList entry;
 	char *  name;
 	char *  symbol;
 	int     deprecated;
+	int     property_cache;
 	NihList methods;
 	NihList signals;
 	NihList properties;
@@ -125,6 +130,23 @@ char *     interface_proxy_get_all_sync_function   (const void *parent,
 						    NihList *structs)
 	__attribute__ ((warn_unused_result));
 
+char *     interface_proxy_cache_update_function   (const void *parent,
+						    const char *prefix,
+						    Interface *interface,
+						    NihList *prototypes)
+	__attribute__ ((warn_unused_result));
+char *     interface_proxy_cache_new_function      (const void *parent,
+						    const char *prefix,
+						    Interface *interface,
+						    NihList *prototypes)
+	__attribute__ ((warn_unused_result));
+
+char *     interface_proxy_get_all_cached_function (const void *parent,
+						    const char *prefix,
+						    Interface *interface,
+						    NihList *prototypes)
+	__attribute__ ((warn_unused_result));
+
 NIH_END_EXTERN
 
 #endif /* NIH_DBUS_TOOL_INTERFACE_H */
@@ -299,6 +299,63 @@ node_lookup_interface (Node *      node,
 }
 
 
+/**
+ * node_has_broadcast:
+ * @node: node to check.
+ *
+ * Checks whether any signal of any of @node's interfaces is annotated
+ * for broadcast, in which case the object code will need the
+ * NihDBusBroadcast declarations.
+ *
+ * Returns: TRUE if a broadcast function will be generated, FALSE otherwise.
+ **/
+int
+node_has_broadcast (Node *node)
+{
+	nih_assert (node != NULL);
+
+	NIH_LIST_FOREACH (&node->interfaces, iter) {
+		Interface *interface = (Interface *)iter;
+
+		NIH_LIST_FOREACH (&interface->signals, signal_iter) {
+			Signal *signal = (Signal *)signal_iter;
+
+			if (signal->broadcast)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+
+/**
+ * node_has_property_cache:
+ * @node: node to check.
+ *
+ * Checks whether any of @node's interfaces is annotated for a property
+ * cache, in which case the proxy code will need the NihDBusPropertyCache
+ * declarations.
+ *
+ * Returns: TRUE if property cache functions will be generated, FALSE
+ * otherwise.
+ **/
+int
+node_has_property_cache (Node *node)
+{
+	nih_assert (node != NULL);
+
+	NIH_LIST_FOREACH (&node->interfaces, iter) {
+		Interface *interface = (Interface *)iter;
+
+		if (interface->property_cache)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
 /**
  * node_interfaces_array:
  * @parent: parent object for new string,
@@ -619,6 +676,29 @@ node_object_functions (const void *parent,
 			if (! nih_strcat (&code, parent, object_func))
 				goto error;
 
+			if (signal->broadcast) {
+				NihList         broadcast_structs;
+				nih_local char *broadcast_func = NULL;
+
+				nih_list_init (&broadcast_structs);
+
+				broadcast_func = signal_object_broadcast_function (
+					NULL, prefix, interface, signal,
+					&signal_externs, &broadcast_structs);
+				if (! broadcast_func)
+					goto error;
+
+				/* Don't duplicate structures */
+				NIH_LIST_FOREACH_SAFE (&broadcast_structs, iter)
+					nih_free (iter);
+
+				if (! nih_strcat_sprintf (&code, parent,
+							  "\n"
+							  "%s",
+							  broadcast_func))
+					goto error;
+			}
+
 			NIH_LIST_FOREACH_SAFE (&signal_structs, iter) {
 				TypeStruct *structure = (TypeStruct *)iter;
 
@@ -940,6 +1020,7 @@ node_proxy_functions (const void *parent,
 			nih_local char *get_func = NULL;
 			nih_local char *get_notify_func = NULL;
 			nih_local char *get_sync_func = NULL;
+			nih_local char *get_cached_func = NULL;
 			nih_local char *set_func = NULL;
 			nih_local char *set_notify_func = NULL;
 			nih_local char *set_sync_func = NULL;
@@ -984,6 +1065,21 @@ node_proxy_functions (const void *parent,
 							  get_notify_func,
 							  get_sync_func))
 					goto error;
+
+				/* Function to read it from a property cache */
+				if (interface->property_cache) {
+					get_cached_func = property_proxy_get_cached_function (
+						NULL, prefix, interface, property,
+						&property_externs);
+					if (! get_cached_func)
+						goto error;
+
+					if (! nih_strcat_sprintf (&code, parent,
+								  "\n"
+								  "%s",
+								  get_cached_func))
+						goto error;
+				}
 			}
 
 			if (property->access == NIH_DBUS_READWRITE)
@@ -1066,6 +1162,9 @@ node_proxy_functions (const void *parent,
 			nih_local char *get_all_func = NULL;
 			nih_local char *get_all_notify_func = NULL;
 			nih_local char *get_all_sync_func = NULL;
+			nih_local char *cache_update_func = NULL;
+			nih_local char *cache_new_func = NULL;
+			nih_local char *get_all_cached_func = NULL;
 
 			nih_list_init (&all_prototypes);
 			nih_list_init (&all_structs);
@@ -1107,6 +1206,39 @@ node_proxy_functions (const void *parent,
 						  get_all_sync_func))
 				goto error;
 
+			/* Functions to read them from a property cache */
+			if (interface->property_cache) {
+				cache_update_func = interface_proxy_cache_update_function (
+					NULL, prefix, interface,
+					&all_prototypes);
+				if (! cache_update_func)
+					goto error;
+
+				cache_new_func = interface_proxy_cache_new_function (
+					NULL, prefix, interface,
+					&all_externs);
+				if (! cache_new_func)
+					goto error;
+
+				get_all_cached_func = interface_proxy_get_all_cached_function (
+					NULL, prefix, interface,
+					&all_externs);
+				if (! get_all_cached_func)
+					goto error;
+
+				if (! nih_strcat_sprintf (&code, parent,
+							  "\n"
+							  "static %s"
+							  "\n"
+							  "%s"
+							  "\n"
+							  "%s",
+							  cache_update_func,
+							  cache_new_func,
+							  get_all_cached_func))
+					goto error;
+			}
+
 			NIH_LIST_FOREACH_SAFE (&all_prototypes, iter) {
 				TypeFunc *func = (TypeFunc *)iter;
 
@@ -57,6 +57,9 @@ int        node_end_tag          (XML_Parser xmlp, const char *tag)
 
 Interface *node_lookup_interface (Node *node, const char *symbol);
 
+int        node_has_broadcast    (Node *node);
+int        node_has_property_cache (Node *node);
+
 char *     node_interfaces_array (const void *parent, const char *prefix,
 				  Node *node, int object, NihList *prototypes)
 	__attribute__ ((warn_unused_result));
@@ -198,6 +198,20 @@ output (const char *source_path,
 	 * prototypes, extern prototypes, etc.
 	 */
 	if (object) {
+		if (node_has_broadcast (node)) {
+			if (! nih_strcat (&source, NULL,
+					  "#include <nih-dbus/dbus_broadcast.h>\n")) {
+				nih_error_raise_no_memory ();
+				return -1;
+			}
+
+			if (! nih_strcat (&header, NULL,
+					  "#include <nih-dbus/dbus_broadcast.h>\n")) {
+				nih_error_raise_no_memory ();
+				return -1;
+			}
+		}
+
 		if (! nih_strcat (&source, NULL,
 				  "#include <nih-dbus/dbus_object.h>\n")) {
 			nih_error_raise_no_memory ();
@@ -213,14 +227,38 @@ output (const char *source_path,
 		}
 	} else {
 		if (! nih_strcat (&source, NULL,
-				  "#include <nih-dbus/dbus_pending_data.h>\n"
+				  "#include <nih-dbus/dbus_pending_data.h>\n")) {
+			nih_error_raise_no_memory ();
+			return -1;
+		}
+
+		if (! nih_strcat (&header, NULL,
+				  "#include <nih-dbus/dbus_pending_data.h>\n")) {
+			nih_error_raise_no_memory ();
+			return -1;
+		}
+
+		if (node_has_property_cache (node)) {
+			if (! nih_strcat (&source, NULL,
+					  "#include <nih-dbus/dbus_property_cache.h>\n")) {
+				nih_error_raise_no_memory ();
+				return -1;
+			}
+
+			if (! nih_strcat (&header, NULL,
+					  "#include <nih-dbus/dbus_property_cache.h>\n")) {
+				nih_error_raise_no_memory ();
+				return -1;
+			}
+		}
+
+		if (! nih_strcat (&source, NULL,
 				  "#include <nih-dbus/dbus_proxy.h>\n")) {
 			nih_error_raise_no_memory ();
 			return -1;
 		}
 
 		if (! nih_strcat (&header, NULL,
-				  "#include <nih-dbus/dbus_pending_data.h>\n"
 				  "#include <nih-dbus/dbus_proxy.h>\n")) {
 			nih_error_raise_no_memory ();
 			return -1;
@@ -2883,6 +2883,227 @@ property_proxy_get_sync_function (const void *parent,
 	return code;
 }
 
+/**
+ * property_proxy_get_cached_function:
+ * @parent: parent object for new string.
+ * @prefix: prefix for function name,
+ * @interface: interface of @property,
+ * @property: property to generate function for,
+ * @prototypes: list to append function prototypes to.
+ *
+ * Generates C code for a function that will read the value of the
+ * property @property from an NihDBusPropertyCache created by the function
+ * returned by interface_proxy_cache_new_function() for @interface.  The
+ * function never makes a method call; when the cache doesn't hold the
+ * value, it returns the NIH_DBUS_PROPERTY_NOT_CACHED error.
+ *
+ * The value returned belongs to the cache, and is not copied.
+ *
+ * The prototype of the returned function is returned as a TypeFunc object
+ * appended to the @prototypes list, with the name as @name itself.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the return string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+property_proxy_get_cached_function (const void *parent,
+				    const char *prefix,
+				    Interface * interface,
+				    Property *  property,
+				    NihList *   prototypes)
+{
+	DBusSignatureIter   iter;
+	NihList             outputs;
+	NihList             locals;
+	NihList             discard;
+	nih_local char *    name = NULL;
+	nih_local TypeFunc *func = NULL;
+	TypeVar *           arg;
+	NihListEntry *      attrib;
+	nih_local char *    c_type = NULL;
+	nih_local char *    assert_block = NULL;
+	nih_local char *    lookup_block = NULL;
+	nih_local char *    copy_block = NULL;
+	nih_local char *    demarshal_block = NULL;
+	nih_local char *    body = NULL;
+	char *              code = NULL;
+
+	nih_assert (prefix != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (property != NULL);
+	nih_assert (prototypes != NULL);
+
+	dbus_signature_iter_init (&iter, property->type);
+
+	nih_list_init (&outputs);
+	nih_list_init (&locals);
+	nih_list_init (&discard);
+
+	/* The function returns an integer, and takes the property cache
+	 * along with an output argument for the property value.  The
+	 * integer is negative if a raised error occurred, so we want
+	 * warning if the result isn't used.  Since this is used by the
+	 * client, we also add a deprecated attribute if the property is
+	 * deprecated.
+	 */
+	name = symbol_extern (NULL, prefix, interface->symbol, "get",
+			      property->symbol, "cached");
+	if (! name)
+		return NULL;
+
+	func = type_func_new (NULL, "int", name);
+	if (! func)
+		return NULL;
+
+	attrib = nih_list_entry_new (func);
+	if (! attrib)
+		return NULL;
+
+	attrib->str = nih_strdup (attrib, "warn_unused_result");
+	if (! attrib->str)
+		return NULL;
+
+	nih_list_add (&func->attribs, &attrib->entry);
+
+	if (property->deprecated) {
+		attrib = nih_list_entry_new (func);
+		if (! attrib)
+			return NULL;
+
+		attrib->str = nih_strdup (attrib, "deprecated");
+		if (! attrib->str)
+			return NULL;
+
+		nih_list_add (&func->attribs, &attrib->entry);
+	}
+
+	arg = type_var_new (func, "NihDBusPropertyCache *", "cache");
+	if (! arg)
+		return NULL;
+
+	nih_list_add (&func->args, &arg->entry);
+
+	if (! nih_strcat (&assert_block, NULL,
+			  "nih_assert (cache != NULL);\n"))
+		return NULL;
+
+	/* The value is held in the member of the interface's properties
+	 * structure with the same name as the one the get_all functions
+	 * demarshal into, so we demarshal with that name just to find out
+	 * the members and their types.
+	 */
+	demarshal_block = demarshal (NULL, &iter, "properties", "variter",
+				     property->symbol, "", "",
+				     &outputs, &locals,
+				     prefix, interface->symbol,
+				     property->symbol, NULL,
+				     &discard);
+	if (! demarshal_block)
+		return NULL;
+
+	NIH_LIST_FOREACH_SAFE (&outputs, iter) {
+		TypeVar *       var = (TypeVar *)iter;
+		nih_local char *arg_type = NULL;
+		const char *    suffix;
+		nih_local char *arg_name = NULL;
+		TypeVar *       arg;
+
+		/* Output variable */
+		arg_type = nih_strdup (NULL, var->type);
+		if (! arg_type)
+			return NULL;
+
+		if (! type_to_pointer (&arg_type, NULL))
+			return NULL;
+
+		nih_assert (! strncmp (var->name, property->symbol,
+				       strlen (property->symbol)));
+		suffix = var->name + strlen (property->symbol);
+
+		arg_name = nih_sprintf (NULL, "value%s", suffix);
+		if (! arg_name)
+			return NULL;
+
+		arg = type_var_new (func, arg_type, arg_name);
+		if (! arg)
+			return NULL;
+
+		nih_list_add (&func->args, &arg->entry);
+
+		if (! nih_strcat_sprintf (&assert_block, NULL,
+					  "nih_assert (%s != NULL);\n",
+					  arg->name))
+			return NULL;
+
+		/* Copy from the structure member to output */
+		if (! nih_strcat_sprintf (&copy_block, NULL,
+					  "*%s = properties->%s;\n",
+					  arg->name, var->name))
+			return NULL;
+	}
+
+	/* Look up the structure holding the value, which fails if the
+	 * cache doesn't have it.
+	 */
+	c_type = symbol_typedef (NULL, prefix, interface->symbol, NULL,
+				 "properties", NULL);
+	if (! c_type)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&lookup_block, NULL,
+				  "properties = nih_dbus_property_cache_lookup (cache, \"%s\");\n"
+				  "if (! properties)\n"
+				  "\treturn -1;\n",
+				  property->name))
+		return NULL;
+
+	/* Lay out the function body, indenting it all before placing it
+	 * in the function code.
+	 */
+	if (! nih_strcat_sprintf (&body, NULL,
+				  "%s *properties;\n"
+				  "\n"
+				  "%s"
+				  "\n"
+				  "%s"
+				  "\n"
+				  "%s"
+				  "\n"
+				  "return 0;\n",
+				  c_type,
+				  assert_block,
+				  lookup_block,
+				  copy_block))
+		return NULL;
+
+	if (! indent (&body, NULL, 1))
+		return NULL;
+
+	/* Function header */
+	code = type_func_to_string (parent, func);
+	if (! code)
+		return NULL;
+
+	if (! nih_strcat_sprintf (&code, parent,
+				  "{\n"
+				  "%s"
+				  "}\n",
+				  body)) {
+		nih_free (code);
+		return NULL;
+	}
+
+	/* Append the function to the prototypes list */
+	nih_list_add (prototypes, &func->entry);
+	nih_ref (func, code);
+
+	return code;
+}
+
 /**
  * property_proxy_set_sync_function:
  * @parent: parent object for new string.
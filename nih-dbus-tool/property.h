@@ -137,6 +137,12 @@ char *    property_proxy_get_sync_function   (const void *parent,
 					      NihList *prototypes,
 					      NihList *structs)
 	__attribute__ ((warn_unused_result));
+char *    property_proxy_get_cached_function (const void *parent,
+					      const char *prefix,
+					      Interface *interface,
+					      Property *property,
+					      NihList *prototypes)
+	__attribute__ ((warn_unused_result));
 char *    property_proxy_set_sync_function   (const void *parent,
 					      const char *prefix,
 					      Interface *interface,
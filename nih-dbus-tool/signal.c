@@ -125,6 +125,7 @@ signal_new (const void *parent,
 
 	signal->symbol = NULL;
 	signal->deprecated = FALSE;
+	signal->broadcast = FALSE;
 
 	nih_list_init (&signal->arguments);
 
@@ -302,8 +303,9 @@ signal_end_tag (XML_Parser  xmlp,
  * @value: annotation value.
  *
  * Handles applying the annotation @name with value @value to the signal
- * @signal.  Signals may be annotated as deprecated or may have an alternate
- * symbol name specified.
+ * @signal.  Signals may be annotated as deprecated, may have an alternate
+ * symbol name specified, or may be marked as broadcast to peer
+ * connections.
  *
  * Unknown annotations or illegal values to the known annotations result
  * in an error being raised.
@@ -349,6 +351,20 @@ signal_annotation (Signal *    signal,
 					  _(SIGNAL_INVALID_SYMBOL_STR));
 		}
 
+	} else if (! strcmp (name, "com.netsplit.Nih.Signal.Broadcast")) {
+		if (! strcmp (value, "true")) {
+			nih_debug ("Marked %s signal as broadcast",
+				   signal->name);
+			signal->broadcast = TRUE;
+		} else if (! strcmp (value, "false")) {
+			nih_debug ("Marked %s signal as not broadcast",
+				   signal->name);
+			signal->broadcast = FALSE;
+		} else {
+			nih_return_error (-1, SIGNAL_ILLEGAL_BROADCAST,
+					  _(SIGNAL_ILLEGAL_BROADCAST_STR));
+		}
+
 	} else {
 		nih_error_raise_printf (SIGNAL_UNKNOWN_ANNOTATION,
 					"%s: %s: %s",
@@ -419,38 +435,32 @@ signal_lookup_argument (Signal *    signal,
 
 
 /**
- * signal_object_function:
+ * signal_object_send_function:
  * @parent: parent object for new string.
  * @prefix: prefix for function name,
  * @interface: interface of @signal,
  * @signal: signal to generate function for,
+ * @broadcast: whether to send with a broadcast,
  * @prototypes: list to append function prototypes to,
  * @structs: list to append structure definitions to.
  *
- * Generates C code for a function to emit a signal @signal on @interface by
- * marshalling the arguments.
- *
- * The prototype of the returned function is returned as a TypeFunc object
- * appended to the @prototypes list.
- *
- * If any of the arguments require a structure to be defined, the
- * definition is returned as a TypeStruct object appended to the @structs
- * list.  The name is generated from @prefix, @interface and @signal.
+ * Generates C code for a function to construct the signal @signal on
+ * @interface by marshalling the arguments, and send it either on a
+ * single connection or, when @broadcast is TRUE, to every subscriber of
+ * an NihDBusBroadcast.
  *
- * If @parent is not NULL, it should be a pointer to another object which
- * will be used as a parent for the returned string.  When all parents
- * of the returned string are freed, the return string will also be
- * freed.
+ * See signal_object_function() for details.
  *
  * Returns: newly allocated string or NULL if insufficient memory.
  **/
-char *
-signal_object_function (const void *parent,
-			const char *prefix,
-			Interface * interface,
-			Signal *    signal,
-			NihList *   prototypes,
-			NihList *   structs)
+static char *
+signal_object_send_function (const void *parent,
+			     const char *prefix,
+			     Interface * interface,
+			     Signal *    signal,
+			     int         broadcast,
+			     NihList *   prototypes,
+			     NihList *   structs)
 {
 	NihList             locals;
 	NihList             signal_structs;
@@ -476,10 +486,12 @@ signal_object_function (const void *parent,
 	nih_list_init (&signal_structs);
 
 	/* The function returns an integer, and accepts an argument for
-	 * the connection and origin path.  The integer indicates whether
-	 * an error occurred, so we want a warning if the result isn't used.
+	 * the connection, or broadcast, and origin path.  The integer
+	 * indicates whether an error occurred, so we want a warning if the
+	 * result isn't used.
 	 */
-	name = symbol_extern (NULL, prefix, interface->symbol, "emit",
+	name = symbol_extern (NULL, prefix, interface->symbol,
+			      broadcast ? "broadcast" : "emit",
 			      signal->symbol, NULL);
 	if (! name)
 		return NULL;
@@ -498,15 +510,27 @@ signal_object_function (const void *parent,
 
 	nih_list_add (&func->attribs, &attrib->entry);
 
-	arg = type_var_new (func, "DBusConnection *", "connection");
-	if (! arg)
-		return NULL;
+	if (broadcast) {
+		arg = type_var_new (func, "NihDBusBroadcast *", "broadcast");
+		if (! arg)
+			return NULL;
 
-	nih_list_add (&func->args, &arg->entry);
+		nih_list_add (&func->args, &arg->entry);
 
-	if (! nih_strcat (&assert_block, NULL,
-			  "nih_assert (connection != NULL);\n"))
-		return NULL;
+		if (! nih_strcat (&assert_block, NULL,
+				  "nih_assert (broadcast != NULL);\n"))
+			return NULL;
+	} else {
+		arg = type_var_new (func, "DBusConnection *", "connection");
+		if (! arg)
+			return NULL;
+
+		nih_list_add (&func->args, &arg->entry);
+
+		if (! nih_strcat (&assert_block, NULL,
+				  "nih_assert (connection != NULL);\n"))
+			return NULL;
+	}
 
 	arg = type_var_new (func, "const char *", "origin_path");
 	if (! arg)
@@ -641,19 +665,35 @@ signal_object_function (const void *parent,
 				  "\n"
 				  "%s"
 				  "\n"
-				  "%s"
+				  "%s",
+				  vars_block,
+				  assert_block,
+				  marshal_block))
+		return NULL;
+
+	if (broadcast) {
+		if (! nih_strcat (&body, NULL,
+				  "/* Send the same signal to each subscribed connection. */\n"
+				  "if (nih_dbus_broadcast_send (broadcast, signal) < 0) {\n"
+				  "\tdbus_message_unref (signal);\n"
+				  "\treturn -1;\n"
+				  "}\n"))
+			return NULL;
+	} else {
+		if (! nih_strcat (&body, NULL,
 				  "/* Send the signal, appending it to the outgoing queue. */\n"
 				  "if (! dbus_connection_send (connection, signal, NULL)) {\n"
 				  "\tdbus_message_unref (signal);\n"
 				  "\treturn -1;\n"
-				  "}\n"
-				  "\n"
-				  "dbus_message_unref (signal);\n"
-				  "\n"
-				  "return 0;\n",
-				  vars_block,
-				  assert_block,
-				  marshal_block))
+				  "}\n"))
+			return NULL;
+	}
+
+	if (! nih_strcat (&body, NULL,
+			  "\n"
+			  "dbus_message_unref (signal);\n"
+			  "\n"
+			  "return 0;\n"))
 		return NULL;
 
 	if (! indent (&body, NULL, 1))
@@ -687,6 +727,83 @@ signal_object_function (const void *parent,
 	return code;
 }
 
+/**
+ * signal_object_function:
+ * @parent: parent object for new string.
+ * @prefix: prefix for function name,
+ * @interface: interface of @signal,
+ * @signal: signal to generate function for,
+ * @prototypes: list to append function prototypes to,
+ * @structs: list to append structure definitions to.
+ *
+ * Generates C code for a function to emit a signal @signal on @interface by
+ * marshalling the arguments.
+ *
+ * The prototype of the returned function is returned as a TypeFunc object
+ * appended to the @prototypes list.
+ *
+ * If any of the arguments require a structure to be defined, the
+ * definition is returned as a TypeStruct object appended to the @structs
+ * list.  The name is generated from @prefix, @interface and @signal.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the return string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+signal_object_function (const void *parent,
+			const char *prefix,
+			Interface * interface,
+			Signal *    signal,
+			NihList *   prototypes,
+			NihList *   structs)
+{
+	return signal_object_send_function (parent, prefix, interface, signal,
+					    FALSE, prototypes, structs);
+}
+
+/**
+ * signal_object_broadcast_function:
+ * @parent: parent object for new string.
+ * @prefix: prefix for function name,
+ * @interface: interface of @signal,
+ * @signal: signal to generate function for,
+ * @prototypes: list to append function prototypes to,
+ * @structs: list to append structure definitions to.
+ *
+ * Generates C code for a function to emit a signal @signal on @interface
+ * to every connection subscribed to an NihDBusBroadcast, marshalling the
+ * arguments only once.
+ *
+ * The prototype of the returned function is returned as a TypeFunc object
+ * appended to the @prototypes list.
+ *
+ * If any of the arguments require a structure to be defined, the
+ * definition is returned as a TypeStruct object appended to the @structs
+ * list.  The name is generated from @prefix, @interface and @signal.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the return string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+signal_object_broadcast_function (const void *parent,
+				  const char *prefix,
+				  Interface * interface,
+				  Signal *    signal,
+				  NihList *   prototypes,
+				  NihList *   structs)
+{
+	return signal_object_send_function (parent, prefix, interface, signal,
+					    TRUE, prototypes, structs);
+}
+
 
 /**
  * signal_proxy_function:
@@ -35,6 +35,7 @@
  * @name: D-Bus name of signal,
  * @symbol: name used when constructing C name,
  * @deprecated: whether this signal is deprecated,
+ * @broadcast: whether to generate a broadcast function,
  * @arguments: arguments provided by the signal.
  *
  * D-Bus interfaces specify zero or more signals, which are identified by
@@ -43,12 +44,16 @@
  * When generating the C symbol names @symbol will be used.  If @symbol
  * is NULL, @name will be converted into the usual C lowercase and underscore
  * style and used instead.
+ *
+ * When @broadcast is TRUE, an additional function is generated for
+ * objects that sends the signal to the subscribers of an NihDBusBroadcast.
  **/
 typedef struct signal {
 	NihList entry;
 	char *  name;
 	char *  symbol;
 	int     deprecated;
+	int     broadcast;
 	NihList arguments;
 } Signal;
 
@@ -78,6 +83,14 @@ char *    signal_object_function (const void *parent, const char *prefix,
 				  NihList *prototypes, NihList *structs)
 	__attribute__ ((warn_unused_result));
 
+char *    signal_object_broadcast_function (const void *parent,
+					    const char *prefix,
+					    Interface *interface,
+					    Signal *signal,
+					    NihList *prototypes,
+					    NihList *structs)
+	__attribute__ ((warn_unused_result));
+
 char *    signal_proxy_function  (const void *parent, const char *prefix,
 				  Interface *interface, Signal *signal,
 				  NihList *prototypes, NihList *typedefs,
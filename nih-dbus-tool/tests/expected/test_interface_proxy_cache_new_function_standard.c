@@ -0,0 +1,18 @@
+NihDBusPropertyCache *
+my_cache_new (NihDBusProxy *              proxy,
+              NihDBusPropertyCacheHandler handler,
+              void *                      data)
+{
+	static const char * const names[] = {
+		"name",
+		"size",
+		NULL
+	};
+
+	nih_assert (proxy != NULL);
+
+	return nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+	                                    names, sizeof (MyProperties),
+	                                    (NihDBusPropertyCacheUpdate)my_com_netsplit_Nih_Test_cache_update,
+	                                    handler, data);
+}
@@ -0,0 +1,62 @@
+int
+my_com_netsplit_Nih_Test_cache_update (MyProperties *   properties,
+                                       const char *     property,
+                                       DBusMessageIter *iter)
+{
+	DBusMessageIter variter;
+	char *          name;
+	const char *    name_dbus;
+	uint32_t        size;
+
+	nih_assert (properties != NULL);
+	nih_assert (property != NULL);
+	nih_assert (iter != NULL);
+
+	/* Recurse into the variant */
+	if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_VARIANT)
+		nih_return_error (-1, NIH_DBUS_INVALID_ARGS,
+		                  _(NIH_DBUS_INVALID_ARGS_STR));
+
+	dbus_message_iter_recurse (iter, &variter);
+
+	if (! strcmp (property, "name")) {
+		/* Demarshal a char * from the message */
+		if (dbus_message_iter_get_arg_type (&variter) != DBUS_TYPE_STRING) {
+			nih_return_error (-1, NIH_DBUS_INVALID_ARGS,
+			                  _(NIH_DBUS_INVALID_ARGS_STR));
+		}
+
+		dbus_message_iter_get_basic (&variter, &name_dbus);
+
+		name = nih_strdup (properties, name_dbus);
+		if (! name) {
+			nih_return_no_memory_error (-1);
+		}
+
+		dbus_message_iter_next (&variter);
+
+		if (properties->name)
+			nih_unref (properties->name, properties);
+		properties->name = name;
+
+		return 0;
+	}
+
+	if (! strcmp (property, "size")) {
+		/* Demarshal a uint32_t from the message */
+		if (dbus_message_iter_get_arg_type (&variter) != DBUS_TYPE_UINT32) {
+			nih_return_error (-1, NIH_DBUS_INVALID_ARGS,
+			                  _(NIH_DBUS_INVALID_ARGS_STR));
+		}
+
+		dbus_message_iter_get_basic (&variter, &size);
+
+		dbus_message_iter_next (&variter);
+
+		properties->size = size;
+
+		return 0;
+	}
+
+	return 0;
+}
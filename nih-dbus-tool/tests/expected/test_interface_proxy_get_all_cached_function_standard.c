@@ -0,0 +1,9 @@
+int
+my_get_all_cached (NihDBusPropertyCache *cache,
+                   MyProperties **       properties)
+{
+	nih_assert (cache != NULL);
+	nih_assert (properties != NULL);
+
+	return nih_dbus_property_cache_get (cache, (void **)properties);
+}
@@ -0,0 +1,20 @@
+int
+my_get_property_cached (NihDBusPropertyCache *cache,
+                        int32_t **            value,
+                        size_t *              value_len)
+{
+	MyProperties *properties;
+
+	nih_assert (cache != NULL);
+	nih_assert (value != NULL);
+	nih_assert (value_len != NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "property");
+	if (! properties)
+		return -1;
+
+	*value = properties->property;
+	*value_len = properties->property_len;
+
+	return 0;
+}
@@ -0,0 +1,17 @@
+int
+my_get_property_cached (NihDBusPropertyCache *cache,
+                        char **               value)
+{
+	MyProperties *properties;
+
+	nih_assert (cache != NULL);
+	nih_assert (value != NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "property");
+	if (! properties)
+		return -1;
+
+	*value = properties->property;
+
+	return 0;
+}
@@ -0,0 +1,27 @@
+int
+my_broadcast_signal (NihDBusBroadcast *broadcast,
+                     const char *      origin_path)
+{
+	DBusMessage *   signal;
+	DBusMessageIter iter;
+
+	nih_assert (broadcast != NULL);
+	nih_assert (origin_path != NULL);
+
+	/* Construct the message. */
+	signal = dbus_message_new_signal (origin_path, "com.netsplit.Nih.Test", "Signal");
+	if (! signal)
+		return -1;
+
+	dbus_message_iter_init_append (signal, &iter);
+
+	/* Send the same signal to each subscribed connection. */
+	if (nih_dbus_broadcast_send (broadcast, signal) < 0) {
+		dbus_message_unref (signal);
+		return -1;
+	}
+
+	dbus_message_unref (signal);
+
+	return 0;
+}
@@ -36,10 +36,12 @@
 #include <nih/alloc.h>
 #include <nih/signal.h>
 #include <nih/main.h>
+#include <nih/string.h>
 #include <nih/error.h>
 
 #include <nih-dbus/dbus_connection.h>
 #include <nih-dbus/dbus_object.h>
+#include <nih-dbus/dbus_property_cache.h>
 #include <nih-dbus/dbus_proxy.h>
 #include <nih-dbus/dbus_error.h>
 #include <nih-dbus/errors.h>
@@ -61154,6 +61156,382 @@ test_get_all_sync (void)
 }
 
 
+static int   cache_handler_called;
+static char *last_cache_name;
+
+static void
+my_cache_handler (void *                data,
+		  NihDBusPropertyCache *cache,
+		  const char *          name)
+{
+	cache_handler_called++;
+
+	TEST_NE_P (cache, NULL);
+	TEST_EQ_P (data, cache->proxy);
+
+	if (last_cache_name)
+		nih_free (last_cache_name);
+	last_cache_name = name ? NIH_MUST (nih_strdup (NULL, name)) : NULL;
+}
+
+static void
+my_emit_properties_changed (DBusConnection *conn,
+			    NihSignal *     signal)
+{
+	DBusMessage *   message;
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+	DBusMessageIter dictiter;
+	DBusMessageIter variter;
+	const char *    interface = "com.netsplit.Nih.Test";
+	const char *    changed = "int32";
+	const char *    invalidated = "string";
+
+	int32_property = 42;
+	str_property = "ze punishment is over";
+
+	message = dbus_message_new_signal ("/com/netsplit/Nih/Test",
+					   DBUS_INTERFACE_PROPERTIES,
+					   "PropertiesChanged");
+	assert (message != NULL);
+
+	dbus_message_iter_init_append (message, &iter);
+
+	assert (dbus_message_iter_append_basic (&iter, DBUS_TYPE_STRING,
+						&interface));
+
+	assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+						  (DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						   DBUS_TYPE_STRING_AS_STRING
+						   DBUS_TYPE_VARIANT_AS_STRING
+						   DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+						  &arrayiter));
+	assert (dbus_message_iter_open_container (&arrayiter, DBUS_TYPE_DICT_ENTRY,
+						  NULL, &dictiter));
+	assert (dbus_message_iter_append_basic (&dictiter, DBUS_TYPE_STRING,
+						&changed));
+	assert (dbus_message_iter_open_container (&dictiter, DBUS_TYPE_VARIANT,
+						  DBUS_TYPE_INT32_AS_STRING,
+						  &variter));
+	assert (dbus_message_iter_append_basic (&variter, DBUS_TYPE_INT32,
+						&int32_property));
+	assert (dbus_message_iter_close_container (&dictiter, &variter));
+	assert (dbus_message_iter_close_container (&arrayiter, &dictiter));
+	assert (dbus_message_iter_close_container (&iter, &arrayiter));
+
+	assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+						  DBUS_TYPE_STRING_AS_STRING,
+						  &arrayiter));
+	assert (dbus_message_iter_append_basic (&arrayiter, DBUS_TYPE_STRING,
+						&invalidated));
+	assert (dbus_message_iter_close_container (&iter, &arrayiter));
+
+	assert (dbus_connection_send (conn, message, NULL));
+	dbus_connection_flush (conn);
+
+	dbus_message_unref (message);
+}
+
+void
+test_cache (void)
+{
+	pid_t                 dbus_pid;
+	DBusConnection *      client_conn;
+	DBusConnection *      server_conn;
+	pid_t                 server_pid;
+	int                   wait_fd;
+	NihDBusObject *       object = NULL;
+	NihDBusProxy *        proxy = NULL;
+	void *                parent = NULL;
+	NihDBusPropertyCache *cache;
+	ProxyTestProperties * properties;
+	int32_t               int32_value;
+	char *                str_value;
+	int32_t *             int32_array_value;
+	size_t                int32_array_len;
+	int                   ret;
+	NihError *            err;
+	int                   status;
+
+	TEST_FUNCTION ("proxy_test_cache_new");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (client_conn);
+	TEST_DBUS_OPEN (server_conn);
+
+	TEST_CHILD_WAIT (server_pid, wait_fd) {
+		parent = nih_alloc (NULL, 0);
+
+		byte_property = 97;
+		boolean_property = TRUE;
+		int16_property = -42;
+		uint16_property = 42;
+		int32_property = -1048576;
+		uint32_property = 1048576;
+		int64_property = -4815162342L;
+		uint64_property = 4815162342L;
+		double_property = 3.14;
+
+		str_property = "she needs more of ze punishment";
+		object_path_property = "/com/netsplit/Nih/Test";
+		signature_property = "a(ib)";
+
+		struct_property = nih_new (parent, MyStruct);
+		struct_property->item0 = "Joe";
+		struct_property->item1 = 34;
+
+		int32_array_property = nih_alloc (parent, sizeof (int32_t) * 6);
+		int32_array_property[0] = 4;
+		int32_array_property[1] = 8;
+		int32_array_property[2] = 15;
+		int32_array_property[3] = 16;
+		int32_array_property[4] = 23;
+		int32_array_property[5] = 42;
+
+		int32_array_property_len = 6;
+
+		str_array_property = nih_alloc (parent, sizeof (char *) * 7);
+		str_array_property[0] = "she";
+		str_array_property[1] = "needs";
+		str_array_property[2] = "more";
+		str_array_property[3] = "of";
+		str_array_property[4] = "ze";
+		str_array_property[5] = "punishment";
+		str_array_property[6] = NULL;
+
+		int32_array_array_property = nih_alloc (parent, sizeof (int32_t *) * 3);
+		int32_array_array_property_len = nih_alloc (int32_array_array_property,
+							    sizeof (size_t) * 2);
+
+		int32_array_array_property[0] = nih_alloc (int32_array_array_property,
+							   sizeof (int32_t) * 6);
+		int32_array_array_property[0][0] = 4;
+		int32_array_array_property[0][1] = 8;
+		int32_array_array_property[0][2] = 15;
+		int32_array_array_property[0][3] = 16;
+		int32_array_array_property[0][4] = 23;
+		int32_array_array_property[0][5] = 42;
+
+		int32_array_array_property_len[0] = 6;
+
+		int32_array_array_property[1] = nih_alloc (int32_array_array_property,
+							   sizeof (int32_t) * 6);
+		int32_array_array_property[1][0] = 1;
+		int32_array_array_property[1][1] = 1;
+		int32_array_array_property[1][2] = 2;
+		int32_array_array_property[1][3] = 3;
+		int32_array_array_property[1][4] = 5;
+		int32_array_array_property[1][5] = 8;
+
+		int32_array_array_property_len[1] = 6;
+
+		int32_array_array_property[2] = NULL;
+
+		struct_array_property = nih_alloc (parent, sizeof (MyStruct *) * 3);
+
+		struct_array_property[0] = nih_new (struct_array_property, MyStruct);
+		struct_array_property[0]->item0 = "Joe";
+		struct_array_property[0]->item1 = 34;
+
+		struct_array_property[1] = nih_new (struct_array_property, MyStruct);
+		struct_array_property[1]->item0 = "Paul";
+		struct_array_property[1]->item1 = 27;
+
+		struct_array_property[2] = NULL;
+
+		dict_entry_array_property = nih_alloc (parent, sizeof (MyStruct *) * 3);
+
+		dict_entry_array_property[0] = nih_new (dict_entry_array_property, MyStruct);
+		dict_entry_array_property[0]->item0 = "Joe";
+		dict_entry_array_property[0]->item1 = 34;
+
+		dict_entry_array_property[1] = nih_new (dict_entry_array_property, MyStruct);
+		dict_entry_array_property[1]->item0 = "Paul";
+		dict_entry_array_property[1]->item1 = 27;
+
+		dict_entry_array_property[2] = NULL;
+
+		unix_fd_property = 1;
+
+		assert0 (nih_dbus_setup (server_conn, NULL));
+
+		object = nih_dbus_object_new (NULL, server_conn,
+					      "/com/netsplit/Nih/Test",
+					      my_interfaces,
+					      NULL);
+
+		nih_signal_set_handler (SIGTERM, nih_signal_handler);
+		assert (nih_signal_add_handler (object, SIGTERM,
+						nih_main_term_signal, NULL));
+
+		nih_signal_set_handler (SIGUSR1, nih_signal_handler);
+		assert (nih_signal_add_handler (object, SIGUSR1,
+						(NihSignalHandler)my_emit_properties_changed,
+						server_conn));
+
+		TEST_CHILD_RELEASE (wait_fd);
+
+		nih_main_loop ();
+
+		nih_free (object);
+		nih_free (parent);
+
+		TEST_DBUS_CLOSE (client_conn);
+		TEST_DBUS_CLOSE (server_conn);
+
+		dbus_shutdown ();
+
+		exit (0);
+	}
+
+	proxy = nih_dbus_proxy_new (NULL, client_conn,
+				    dbus_bus_get_unique_name (server_conn),
+				    "/com/netsplit/Nih/Test",
+				    NULL, NULL);
+	assert (proxy != NULL);
+
+
+	/* Check that a new cache has no values until the connection has
+	 * been dispatched, and that reading them returns an error rather
+	 * than blocking.
+	 */
+	TEST_FEATURE ("with values not yet received");
+	cache_handler_called = 0;
+
+	cache = proxy_test_cache_new (proxy, my_cache_handler, proxy);
+
+	TEST_NE_P (cache, NULL);
+	TEST_ALLOC_PARENT (cache, proxy);
+	TEST_NE_P (cache->pending_call, NULL);
+
+	ret = proxy_test_get_int32_cached (cache, &int32_value);
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+	ret = proxy_test_get_all_cached (cache, &properties);
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+	TEST_EQ (cache_handler_called, 0);
+
+
+	/* Check that once the reply to the GetAll call has been received,
+	 * the handler is called and every value can be read from the
+	 * cache.
+	 */
+	TEST_FEATURE ("with values received");
+	while (! cache_handler_called)
+		TEST_DBUS_DISPATCH (client_conn);
+
+	TEST_EQ (cache_handler_called, 1);
+	TEST_EQ_P (last_cache_name, NULL);
+	TEST_EQ_P (cache->pending_call, NULL);
+
+	ret = proxy_test_get_int32_cached (cache, &int32_value);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (int32_value, -1048576);
+
+	ret = proxy_test_get_string_cached (cache, &str_value);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_STR (str_value, "she needs more of ze punishment");
+
+	ret = proxy_test_get_int32_array_cached (cache, &int32_array_value,
+						 &int32_array_len);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (int32_array_len, 6);
+	TEST_EQ (int32_array_value[0], 4);
+	TEST_EQ (int32_array_value[5], 42);
+
+	ret = proxy_test_get_all_cached (cache, &properties);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (properties->byte, 97);
+	TEST_EQ (properties->int32, -1048576);
+	TEST_EQ_STR (properties->string, "she needs more of ze punishment");
+	TEST_EQ_STR (properties->structure->item0, "Joe");
+	TEST_EQ (properties->structure->item1, 34);
+
+
+	/* Check that a PropertiesChanged signal stores a changed value in
+	 * the cache immediately, without another method call, while an
+	 * invalidated value can't be read until it has been refetched.
+	 */
+	TEST_FEATURE ("with changed and invalidated properties");
+	cache_handler_called = 0;
+
+	kill (server_pid, SIGUSR1);
+
+	while (cache_handler_called < 2)
+		TEST_DBUS_DISPATCH (client_conn);
+
+	TEST_EQ (cache_handler_called, 2);
+	TEST_EQ_STR (last_cache_name, "string");
+	TEST_NE_P (cache->pending_call, NULL);
+
+	ret = proxy_test_get_int32_cached (cache, &int32_value);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (int32_value, 42);
+
+	ret = proxy_test_get_string_cached (cache, &str_value);
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+
+	/* Check that the invalidated value is refetched with a GetAll
+	 * call, and can be read once the reply has been received.
+	 */
+	TEST_FEATURE ("with invalidated property refetched");
+	while (cache_handler_called < 3)
+		TEST_DBUS_DISPATCH (client_conn);
+
+	TEST_EQ_P (last_cache_name, NULL);
+	TEST_EQ_P (cache->pending_call, NULL);
+
+	ret = proxy_test_get_string_cached (cache, &str_value);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_STR (str_value, "ze punishment is over");
+
+	ret = proxy_test_get_int32_cached (cache, &int32_value);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (int32_value, 42);
+
+
+	nih_free (proxy);
+
+	if (last_cache_name)
+		nih_free (last_cache_name);
+	last_cache_name = NULL;
+
+	kill (server_pid, SIGTERM);
+	waitpid (server_pid, &status, 0);
+	TEST_TRUE (WIFEXITED (status));
+	TEST_EQ (WEXITSTATUS (status), 0);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
 
 
 int
@@ -61419,5 +61797,7 @@ main (int   argc,
 	test_get_all ();
 	test_get_all_sync ();
 
+	test_cache ();
+
 	return 0;
 }
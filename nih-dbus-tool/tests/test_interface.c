@@ -169,6 +169,7 @@ test_new (void)
 		TEST_ALLOC_PARENT (interface->name, interface);
 		TEST_EQ_P (interface->symbol, NULL);
 		TEST_FALSE (interface->deprecated);
+		TEST_FALSE (interface->property_cache);
 		TEST_LIST_EMPTY (&interface->methods);
 		TEST_LIST_EMPTY (&interface->signals);
 		TEST_LIST_EMPTY (&interface->properties);
@@ -824,6 +825,65 @@ test_annotation (void)
 	}
 
 
+	/* Check that the annotation to request a property cache is handled,
+	 * and the Interface is marked as having one.
+	 */
+	TEST_FEATURE ("with property cache annotation");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+		}
+
+		ret = interface_annotation (interface,
+					    "com.netsplit.Nih.PropertyCache",
+					    "true");
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			TEST_FALSE (interface->property_cache);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			nih_free (interface);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_TRUE (interface->property_cache);
+
+		nih_free (interface);
+	}
+
+
+	/* Check that an invalid value for the property cache annotation
+	 * results in an error being raised.
+	 */
+	TEST_FEATURE ("with invalid value for property cache annotation");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+		}
+
+		ret = interface_annotation (interface,
+					    "com.netsplit.Nih.PropertyCache",
+					    "foo");
+
+		TEST_LT (ret, 0);
+
+		TEST_FALSE (interface->property_cache);
+
+		err = nih_error_get ();
+		TEST_EQ (err->number, INTERFACE_ILLEGAL_PROPERTY_CACHE);
+		nih_free (err);
+
+		nih_free (interface);
+	}
+
+
 	/* Check that an invalid value for the deprecated annotation results
 	 * in an error being raised.
 	 */
@@ -6919,6 +6979,321 @@ test_proxy_get_all_sync_function (void)
 }
 
 
+void
+test_proxy_cache_update_function (void)
+{
+	NihList       prototypes;
+	Interface *   interface = NULL;
+	Property *    property = NULL;
+	char *        str;
+	TypeFunc *    func;
+	TypeVar *     arg;
+
+	/* Check that we can generate a function that stores the new value
+	 * of any readable property of the interface, passed in a variant,
+	 * in the properties structure.
+	 */
+	TEST_FUNCTION ("interface_proxy_cache_update_function");
+	TEST_ALLOC_FAIL {
+		nih_list_init (&prototypes);
+
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+			interface->symbol = NULL;
+
+			property = property_new (interface, "name",
+						 "s", NIH_DBUS_READWRITE);
+			property->symbol = "name";
+			nih_list_add (&interface->properties, &property->entry);
+
+			property = property_new (interface, "size",
+						 "u", NIH_DBUS_READ);
+			property->symbol = "size";
+			nih_list_add (&interface->properties, &property->entry);
+
+			property = property_new (interface, "touch",
+						 "b", NIH_DBUS_WRITE);
+			property->symbol = "touch";
+			nih_list_add (&interface->properties, &property->entry);
+		}
+
+		str = interface_proxy_cache_update_function (NULL, "my",
+							     interface,
+							     &prototypes);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str, NULL);
+
+			TEST_LIST_EMPTY (&prototypes);
+
+			nih_free (interface);
+			continue;
+		}
+
+		TEST_EXPECTED_STR (str, "test_interface_proxy_cache_update_function_standard.c");
+
+		TEST_LIST_NOT_EMPTY (&prototypes);
+
+		func = (TypeFunc *)prototypes.next;
+		TEST_ALLOC_SIZE (func, sizeof (TypeFunc));
+		TEST_ALLOC_PARENT (func, str);
+		TEST_EQ_STR (func->type, "int");
+		TEST_ALLOC_PARENT (func->type, func);
+		TEST_EQ_STR (func->name, "my_com_netsplit_Nih_Test_cache_update");
+		TEST_ALLOC_PARENT (func->name, func);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "MyProperties *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "properties");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "const char *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "property");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "DBusMessageIter *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "iter");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+		TEST_LIST_EMPTY (&func->args);
+
+		TEST_LIST_EMPTY (&func->attribs);
+		nih_free (func);
+
+		TEST_LIST_EMPTY (&prototypes);
+
+		nih_free (str);
+		nih_free (interface);
+	}
+}
+
+void
+test_proxy_cache_new_function (void)
+{
+	NihList       prototypes;
+	Interface *   interface = NULL;
+	Property *    property = NULL;
+	char *        str;
+	TypeFunc *    func;
+	TypeVar *     arg;
+	NihListEntry *attrib;
+
+	/* Check that we can generate a function that creates a property
+	 * cache for the interface, passing the names of the readable
+	 * properties and the update function to store their values.
+	 */
+	TEST_FUNCTION ("interface_proxy_cache_new_function");
+	TEST_ALLOC_FAIL {
+		nih_list_init (&prototypes);
+
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+			interface->symbol = NULL;
+
+			property = property_new (interface, "name",
+						 "s", NIH_DBUS_READWRITE);
+			property->symbol = "name";
+			nih_list_add (&interface->properties, &property->entry);
+
+			property = property_new (interface, "size",
+						 "u", NIH_DBUS_READ);
+			property->symbol = "size";
+			nih_list_add (&interface->properties, &property->entry);
+
+			property = property_new (interface, "touch",
+						 "b", NIH_DBUS_WRITE);
+			property->symbol = "touch";
+			nih_list_add (&interface->properties, &property->entry);
+		}
+
+		str = interface_proxy_cache_new_function (NULL, "my",
+							  interface,
+							  &prototypes);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str, NULL);
+
+			TEST_LIST_EMPTY (&prototypes);
+
+			nih_free (interface);
+			continue;
+		}
+
+		TEST_EXPECTED_STR (str, "test_interface_proxy_cache_new_function_standard.c");
+
+		TEST_LIST_NOT_EMPTY (&prototypes);
+
+		func = (TypeFunc *)prototypes.next;
+		TEST_ALLOC_SIZE (func, sizeof (TypeFunc));
+		TEST_ALLOC_PARENT (func, str);
+		TEST_EQ_STR (func->type, "NihDBusPropertyCache *");
+		TEST_ALLOC_PARENT (func->type, func);
+		TEST_EQ_STR (func->name, "my_cache_new");
+		TEST_ALLOC_PARENT (func->name, func);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "NihDBusProxy *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "proxy");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "NihDBusPropertyCacheHandler");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "handler");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "void *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "data");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+		TEST_LIST_EMPTY (&func->args);
+
+		TEST_LIST_NOT_EMPTY (&func->attribs);
+
+		attrib = (NihListEntry *)func->attribs.next;
+		TEST_ALLOC_SIZE (attrib, sizeof (NihListEntry *));
+		TEST_ALLOC_PARENT (attrib, func);
+		TEST_EQ_STR (attrib->str, "warn_unused_result");
+		TEST_ALLOC_PARENT (attrib->str, attrib);
+		nih_free (attrib);
+
+		TEST_LIST_EMPTY (&func->attribs);
+		nih_free (func);
+
+		TEST_LIST_EMPTY (&prototypes);
+
+		nih_free (str);
+		nih_free (interface);
+	}
+}
+
+void
+test_proxy_get_all_cached_function (void)
+{
+	NihList       prototypes;
+	Interface *   interface = NULL;
+	char *        str;
+	TypeFunc *    func;
+	TypeVar *     arg;
+	NihListEntry *attrib;
+
+	/* Check that we can generate a function that obtains the value of
+	 * all properties from a property cache, returning them in the
+	 * same structure as the synchronous get_all function.
+	 */
+	TEST_FUNCTION ("interface_proxy_get_all_cached_function");
+	TEST_ALLOC_FAIL {
+		nih_list_init (&prototypes);
+
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+			interface->symbol = NULL;
+		}
+
+		str = interface_proxy_get_all_cached_function (NULL, "my",
+							       interface,
+							       &prototypes);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str, NULL);
+
+			TEST_LIST_EMPTY (&prototypes);
+
+			nih_free (interface);
+			continue;
+		}
+
+		TEST_EXPECTED_STR (str, "test_interface_proxy_get_all_cached_function_standard.c");
+
+		TEST_LIST_NOT_EMPTY (&prototypes);
+
+		func = (TypeFunc *)prototypes.next;
+		TEST_ALLOC_SIZE (func, sizeof (TypeFunc));
+		TEST_ALLOC_PARENT (func, str);
+		TEST_EQ_STR (func->type, "int");
+		TEST_ALLOC_PARENT (func->type, func);
+		TEST_EQ_STR (func->name, "my_get_all_cached");
+		TEST_ALLOC_PARENT (func->name, func);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "NihDBusPropertyCache *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "cache");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "MyProperties **");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "properties");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+		TEST_LIST_EMPTY (&func->args);
+
+		TEST_LIST_NOT_EMPTY (&func->attribs);
+
+		attrib = (NihListEntry *)func->attribs.next;
+		TEST_ALLOC_SIZE (attrib, sizeof (NihListEntry *));
+		TEST_ALLOC_PARENT (attrib, func);
+		TEST_EQ_STR (attrib->str, "warn_unused_result");
+		TEST_ALLOC_PARENT (attrib->str, attrib);
+		nih_free (attrib);
+
+		TEST_LIST_EMPTY (&func->attribs);
+		nih_free (func);
+
+		TEST_LIST_EMPTY (&prototypes);
+
+		nih_free (str);
+		nih_free (interface);
+	}
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -6941,6 +7316,9 @@ main (int   argc,
 	test_proxy_get_all_function ();
 	test_proxy_get_all_notify_function ();
 	test_proxy_get_all_sync_function ();
+	test_proxy_cache_update_function ();
+	test_proxy_cache_new_function ();
+	test_proxy_get_all_cached_function ();
 
 	return 0;
 }
@@ -645,6 +645,121 @@ test_lookup_interface (void)
 }
 
 
+void
+test_has_broadcast (void)
+{
+	Node *     node = NULL;
+	Interface *interface = NULL;
+	Signal *   signal = NULL;
+	int        ret;
+
+	TEST_FUNCTION ("node_has_broadcast");
+
+
+	/* Check that the function returns TRUE if a signal of one of the
+	 * interfaces is annotated for broadcast.
+	 */
+	TEST_FEATURE ("with broadcast signal");
+	node = node_new (NULL, NULL);
+
+	interface = interface_new (node, "com.netsplit.Nih.Test");
+	nih_list_add (&node->interfaces, &interface->entry);
+
+	interface = interface_new (node, "com.netsplit.Nih.Foo");
+	nih_list_add (&node->interfaces, &interface->entry);
+
+	signal = signal_new (interface, "Bar");
+	nih_list_add (&interface->signals, &signal->entry);
+
+	signal = signal_new (interface, "Baz");
+	signal->broadcast = TRUE;
+	nih_list_add (&interface->signals, &signal->entry);
+
+	ret = node_has_broadcast (node);
+
+	TEST_TRUE (ret);
+
+	nih_free (node);
+
+
+	/* Check that the function returns FALSE if no signal is annotated
+	 * for broadcast.
+	 */
+	TEST_FEATURE ("without broadcast signal");
+	node = node_new (NULL, NULL);
+
+	interface = interface_new (node, "com.netsplit.Nih.Test");
+	nih_list_add (&node->interfaces, &interface->entry);
+
+	signal = signal_new (interface, "Bar");
+	nih_list_add (&interface->signals, &signal->entry);
+
+	ret = node_has_broadcast (node);
+
+	TEST_FALSE (ret);
+
+	nih_free (node);
+
+
+	/* Check that the function returns FALSE if there are no
+	 * interfaces.
+	 */
+	TEST_FEATURE ("with no interfaces");
+	node = node_new (NULL, NULL);
+
+	ret = node_has_broadcast (node);
+
+	TEST_FALSE (ret);
+
+	nih_free (node);
+}
+
+void
+test_has_property_cache (void)
+{
+	Node *     node = NULL;
+	Interface *interface = NULL;
+	int        ret;
+
+	TEST_FUNCTION ("node_has_property_cache");
+
+
+	/* Check that the function returns TRUE if one of the interfaces
+	 * is annotated for a property cache.
+	 */
+	TEST_FEATURE ("with property cache");
+	node = node_new (NULL, NULL);
+
+	interface = interface_new (node, "com.netsplit.Nih.Test");
+	nih_list_add (&node->interfaces, &interface->entry);
+
+	interface = interface_new (node, "com.netsplit.Nih.Foo");
+	interface->property_cache = TRUE;
+	nih_list_add (&node->interfaces, &interface->entry);
+
+	ret = node_has_property_cache (node);
+
+	TEST_TRUE (ret);
+
+	nih_free (node);
+
+
+	/* Check that the function returns FALSE if no interface is
+	 * annotated for a property cache.
+	 */
+	TEST_FEATURE ("without property cache");
+	node = node_new (NULL, NULL);
+
+	interface = interface_new (node, "com.netsplit.Nih.Test");
+	nih_list_add (&node->interfaces, &interface->entry);
+
+	ret = node_has_property_cache (node);
+
+	TEST_FALSE (ret);
+
+	nih_free (node);
+}
+
 void
 test_interfaces_array (void)
 {
@@ -16750,6 +16865,8 @@ main (int   argc,
 	test_start_tag ();
 	test_end_tag ();
 	test_lookup_interface ();
+	test_has_broadcast ();
+	test_has_property_cache ();
 
 	test_interfaces_array ();
 	test_object_functions ();
@@ -155,6 +155,7 @@ test_new (void)
 		TEST_ALLOC_PARENT (signal->name, signal);
 		TEST_EQ_P (signal->symbol, NULL);
 		TEST_FALSE (signal->deprecated);
+		TEST_FALSE (signal->broadcast);
 		TEST_LIST_EMPTY (&signal->arguments);
 
 		nih_free (signal);
@@ -826,6 +827,52 @@ test_annotation (void)
 	}
 
 
+	/* Check that the annotation to generate a broadcast function for
+	 * a signal is handled, and the Signal is marked broadcast.
+	 */
+	TEST_FEATURE ("with broadcast annotation");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			signal = signal_new (NULL, "TestSignal");
+		}
+
+		ret = signal_annotation (signal,
+					 "com.netsplit.Nih.Signal.Broadcast",
+					 "true");
+
+		TEST_EQ (ret, 0);
+
+		TEST_TRUE (signal->broadcast);
+
+		nih_free (signal);
+	}
+
+
+	/* Check that an invalid value for the broadcast annotation results
+	 * in an error being raised.
+	 */
+	TEST_FEATURE ("with invalid value for broadcast annotation");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			signal = signal_new (NULL, "TestSignal");
+		}
+
+		ret = signal_annotation (signal,
+					 "com.netsplit.Nih.Signal.Broadcast",
+					 "foo");
+
+		TEST_LT (ret, 0);
+
+		TEST_FALSE (signal->broadcast);
+
+		err = nih_error_get ();
+		TEST_EQ (err->number, SIGNAL_ILLEGAL_BROADCAST);
+		nih_free (err);
+
+		nih_free (signal);
+	}
+
+
 	/* Check that an invalid symbol in an annotation results in an
 	 * error being raised.
 	 */
@@ -1644,6 +1691,218 @@ test_object_function (void)
 }
 
 
+void
+test_object_broadcast_function (void)
+{
+	NihList       prototypes;
+	NihList       structs;
+	Interface *   interface = NULL;
+	Signal *      signal = NULL;
+	Argument *    argument = NULL;
+	char *        str;
+	TypeFunc *    func;
+	TypeVar *     arg;
+	NihListEntry *attrib;
+
+	TEST_FUNCTION ("signal_object_broadcast_function");
+
+
+	/* Check that we can generate a function that marshals its arguments
+	 * into a D-Bus message and sends it to the subscribers of a broadcast,
+	 * taking the broadcast in place of a connection.
+	 */
+	TEST_FEATURE ("with signal");
+	TEST_ALLOC_FAIL {
+		nih_list_init (&prototypes);
+		nih_list_init (&structs);
+
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+			interface->symbol = NULL;
+
+			signal = signal_new (NULL, "Signal");
+			signal->symbol = nih_strdup (signal, "signal");
+
+			argument = argument_new (signal, "Msg",
+						 "s", NIH_DBUS_ARG_OUT);
+			argument->symbol = nih_strdup (argument, "msg");
+			nih_list_add (&signal->arguments, &argument->entry);
+		}
+
+		str = signal_object_broadcast_function (NULL, "my", interface,
+							signal, &prototypes,
+							&structs);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str, NULL);
+
+			TEST_LIST_EMPTY (&prototypes);
+			TEST_LIST_EMPTY (&structs);
+
+			nih_free (signal);
+			nih_free (interface);
+			continue;
+		}
+
+		TEST_EXPECTED_STR (str, "test_signal_object_broadcast_function_standard.c");
+
+		TEST_LIST_NOT_EMPTY (&prototypes);
+
+		func = (TypeFunc *)prototypes.next;
+		TEST_ALLOC_SIZE (func, sizeof (TypeFunc));
+		TEST_ALLOC_PARENT (func, str);
+		TEST_EQ_STR (func->type, "int");
+		TEST_ALLOC_PARENT (func->type, func);
+		TEST_EQ_STR (func->name, "my_broadcast_signal");
+		TEST_ALLOC_PARENT (func->name, func);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "NihDBusBroadcast *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "broadcast");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "const char *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "origin_path");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "const char *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "msg");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_EMPTY (&func->args);
+
+		TEST_LIST_NOT_EMPTY (&func->attribs);
+
+		attrib = (NihListEntry *)func->attribs.next;
+		TEST_ALLOC_SIZE (attrib, sizeof (NihListEntry *));
+		TEST_ALLOC_PARENT (attrib, func);
+		TEST_EQ_STR (attrib->str, "warn_unused_result");
+		TEST_ALLOC_PARENT (attrib->str, attrib);
+		nih_free (attrib);
+
+		TEST_LIST_EMPTY (&func->attribs);
+		nih_free (func);
+
+		TEST_LIST_EMPTY (&prototypes);
+
+		TEST_LIST_EMPTY (&structs);
+
+		nih_free (str);
+		nih_free (signal);
+		nih_free (interface);
+	}
+
+
+	/* Check that we can generate a broadcast function for a signal
+	 * with no arguments.
+	 */
+	TEST_FEATURE ("with no arguments");
+	TEST_ALLOC_FAIL {
+		nih_list_init (&prototypes);
+		nih_list_init (&structs);
+
+		TEST_ALLOC_SAFE {
+			interface = interface_new (NULL, "com.netsplit.Nih.Test");
+			interface->symbol = NULL;
+
+			signal = signal_new (NULL, "Signal");
+			signal->symbol = nih_strdup (signal, "signal");
+		}
+
+		str = signal_object_broadcast_function (NULL, "my", interface,
+							signal, &prototypes,
+							&structs);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str, NULL);
+
+			TEST_LIST_EMPTY (&prototypes);
+			TEST_LIST_EMPTY (&structs);
+
+			nih_free (signal);
+			nih_free (interface);
+			continue;
+		}
+
+		TEST_EXPECTED_STR (str, "test_signal_object_broadcast_function_no_args.c");
+
+		TEST_LIST_NOT_EMPTY (&prototypes);
+
+		func = (TypeFunc *)prototypes.next;
+		TEST_ALLOC_SIZE (func, sizeof (TypeFunc));
+		TEST_ALLOC_PARENT (func, str);
+		TEST_EQ_STR (func->type, "int");
+		TEST_ALLOC_PARENT (func->type, func);
+		TEST_EQ_STR (func->name, "my_broadcast_signal");
+		TEST_ALLOC_PARENT (func->name, func);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "NihDBusBroadcast *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "broadcast");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_NOT_EMPTY (&func->args);
+
+		arg = (TypeVar *)func->args.next;
+		TEST_ALLOC_SIZE (arg, sizeof (TypeVar));
+		TEST_ALLOC_PARENT (arg, func);
+		TEST_EQ_STR (arg->type, "const char *");
+		TEST_ALLOC_PARENT (arg->type, arg);
+		TEST_EQ_STR (arg->name, "origin_path");
+		TEST_ALLOC_PARENT (arg->name, arg);
+		nih_free (arg);
+
+		TEST_LIST_EMPTY (&func->args);
+
+		TEST_LIST_NOT_EMPTY (&func->attribs);
+
+		attrib = (NihListEntry *)func->attribs.next;
+		TEST_ALLOC_SIZE (attrib, sizeof (NihListEntry *));
+		TEST_ALLOC_PARENT (attrib, func);
+		TEST_EQ_STR (attrib->str, "warn_unused_result");
+		TEST_ALLOC_PARENT (attrib->str, attrib);
+		nih_free (attrib);
+
+		TEST_LIST_EMPTY (&func->attribs);
+		nih_free (func);
+
+		TEST_LIST_EMPTY (&prototypes);
+
+		TEST_LIST_EMPTY (&structs);
+
+		nih_free (str);
+		nih_free (signal);
+		nih_free (interface);
+	}
+}
+
+
 static int my_signal_handler_called = FALSE;
 
 static void
@@ -2649,6 +2908,7 @@ main (int   argc,
 	test_lookup_argument ();
 
 	test_object_function ();
+	test_object_broadcast_function ();
 	test_proxy_function ();
 
 	test_args_array ();
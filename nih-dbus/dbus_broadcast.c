@@ -0,0 +1,379 @@
+/* libnih
+ *
+ * dbus_broadcast.c - D-Bus signal broadcast to peer connections
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <dbus/dbus.h>
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/string.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include "dbus_broadcast.h"
+
+
+/**
+ * NihDBusBroadcastPeer:
+ * @entry: list header,
+ * @connection: D-Bus connection,
+ * @subscriptions: subscriptions of @connection,
+ * @freeing: TRUE while the peer is being freed.
+ *
+ * This structure holds the subscriptions of a single connection, so that
+ * a signal is only sent once to each connection no matter how many of
+ * its subscriptions match.  It holds a reference to @connection, and is
+ * freed along with its last subscription.
+ **/
+typedef struct nih_dbus_broadcast_peer {
+	NihList         entry;
+	DBusConnection *connection;
+	NihList         subscriptions;
+	int             freeing;
+} NihDBusBroadcastPeer;
+
+
+/* Prototypes for static functions */
+static NihDBusBroadcastPeer *nih_dbus_broadcast_peer_lookup (NihDBusBroadcast *broadcast,
+							     DBusConnection *connection);
+static int                   nih_dbus_broadcast_peer_destroy (NihDBusBroadcastPeer *peer);
+static int                   nih_dbus_broadcast_peer_match   (NihDBusBroadcastPeer *peer,
+							      const char *interface,
+							      const char *member);
+static int                   nih_dbus_subscription_destroy   (NihDBusSubscription *subscription);
+
+
+/**
+ * nih_dbus_broadcast_new:
+ * @parent: parent object for new broadcast.
+ *
+ * Allocates a new broadcast with no subscriptions.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned broadcast.  When all parents
+ * of the returned broadcast are freed, the returned broadcast will also be
+ * freed, along with all of its subscriptions.
+ *
+ * Returns: new NihDBusBroadcast structure, or NULL if insufficient memory.
+ **/
+NihDBusBroadcast *
+nih_dbus_broadcast_new (const void *parent)
+{
+	NihDBusBroadcast *broadcast;
+
+	broadcast = nih_new (parent, NihDBusBroadcast);
+	if (! broadcast)
+		return NULL;
+
+	nih_list_init (&broadcast->peers);
+
+	return broadcast;
+}
+
+
+/**
+ * nih_dbus_broadcast_subscribe:
+ * @broadcast: broadcast to subscribe to,
+ * @connection: D-Bus connection,
+ * @interface: interface of signals or NULL,
+ * @member: name of signal or NULL.
+ *
+ * Subscribes @connection to signals on @interface named @member sent
+ * with @broadcast; @interface may be NULL to match signals on any
+ * interface, and @member may be NULL to match any signal.
+ *
+ * A reference to @connection is held until all of its subscriptions have
+ * been freed, or nih_dbus_broadcast_remove() is called, which would
+ * normally be done in the server's disconnect handler; otherwise the
+ * subscriptions are freed the next time a signal is sent after the
+ * connection has been disconnected.
+ *
+ * The subscription may be cancelled by freeing the returned structure.
+ *
+ * Returns: new NihDBusSubscription structure or NULL on raised error.
+ **/
+NihDBusSubscription *
+nih_dbus_broadcast_subscribe (NihDBusBroadcast *broadcast,
+			      DBusConnection *  connection,
+			      const char *      interface,
+			      const char *      member)
+{
+	NihDBusBroadcastPeer *peer;
+	NihDBusSubscription * subscription;
+	int                   new_peer = FALSE;
+
+	nih_assert (broadcast != NULL);
+	nih_assert (connection != NULL);
+
+	peer = nih_dbus_broadcast_peer_lookup (broadcast, connection);
+	if (! peer) {
+		peer = nih_new (broadcast, NihDBusBroadcastPeer);
+		if (! peer)
+			nih_return_no_memory_error (NULL);
+
+		nih_list_init (&peer->entry);
+
+		peer->connection = connection;
+		nih_list_init (&peer->subscriptions);
+		peer->freeing = FALSE;
+
+		nih_alloc_set_destructor (peer, nih_dbus_broadcast_peer_destroy);
+
+		dbus_connection_ref (peer->connection);
+		nih_list_add (&broadcast->peers, &peer->entry);
+
+		new_peer = TRUE;
+	}
+
+	subscription = nih_new (peer, NihDBusSubscription);
+	if (! subscription)
+		goto error;
+
+	nih_list_init (&subscription->entry);
+
+	subscription->peer = peer;
+
+	subscription->interface = NULL;
+	if (interface) {
+		subscription->interface = nih_strdup (subscription, interface);
+		if (! subscription->interface) {
+			nih_free (subscription);
+			goto error;
+		}
+	}
+
+	subscription->member = NULL;
+	if (member) {
+		subscription->member = nih_strdup (subscription, member);
+		if (! subscription->member) {
+			nih_free (subscription);
+			goto error;
+		}
+	}
+
+	nih_alloc_set_destructor (subscription, nih_dbus_subscription_destroy);
+
+	nih_list_add (&peer->subscriptions, &subscription->entry);
+
+	return subscription;
+
+error:
+	if (new_peer)
+		nih_free (peer);
+
+	nih_return_no_memory_error (NULL);
+}
+
+/**
+ * nih_dbus_broadcast_remove:
+ * @broadcast: broadcast to remove from,
+ * @connection: D-Bus connection.
+ *
+ * Frees all of the subscriptions of @connection to signals sent with
+ * @broadcast, and drops the reference held to @connection.
+ **/
+void
+nih_dbus_broadcast_remove (NihDBusBroadcast *broadcast,
+			   DBusConnection *  connection)
+{
+	NihDBusBroadcastPeer *peer;
+
+	nih_assert (broadcast != NULL);
+	nih_assert (connection != NULL);
+
+	peer = nih_dbus_broadcast_peer_lookup (broadcast, connection);
+	if (peer)
+		nih_free (peer);
+}
+
+
+/**
+ * nih_dbus_broadcast_send:
+ * @broadcast: broadcast to send with,
+ * @message: signal to send.
+ *
+ * Sends the signal @message to every connection with a subscription
+ * matching it, queueing the same message on each connection so that
+ * its arguments are only marshalled once.  Each connection is only sent
+ * the message once, however many of its subscriptions match.
+ *
+ * Connections that have been disconnected are removed, freeing their
+ * subscriptions as nih_dbus_broadcast_remove() would.
+ *
+ * No error is raised on failure, as with dbus_connection_send(); the
+ * signal will have been sent to those connections it could be.
+ *
+ * Returns: zero on success, negative value if the message could not be
+ * queued on every connection due to insufficient memory.
+ **/
+int
+nih_dbus_broadcast_send (NihDBusBroadcast *broadcast,
+			 DBusMessage *     message)
+{
+	const char *interface;
+	const char *member;
+	int         ret = 0;
+
+	nih_assert (broadcast != NULL);
+	nih_assert (message != NULL);
+
+	interface = dbus_message_get_interface (message);
+	member = dbus_message_get_member (message);
+
+	NIH_LIST_FOREACH_SAFE (&broadcast->peers, iter) {
+		NihDBusBroadcastPeer *peer = (NihDBusBroadcastPeer *)iter;
+
+		if (! dbus_connection_get_is_connected (peer->connection)) {
+			nih_free (peer);
+			continue;
+		}
+
+		if (! nih_dbus_broadcast_peer_match (peer, interface, member))
+			continue;
+
+		if (! dbus_connection_send (peer->connection, message, NULL))
+			ret = -1;
+	}
+
+	return ret;
+}
+
+
+/**
+ * nih_dbus_broadcast_peer_lookup:
+ * @broadcast: broadcast to search,
+ * @connection: D-Bus connection to find.
+ *
+ * Finds the structure holding the subscriptions of @connection to
+ * @broadcast.
+ *
+ * Returns: peer found or NULL if @connection has no subscriptions.
+ **/
+static NihDBusBroadcastPeer *
+nih_dbus_broadcast_peer_lookup (NihDBusBroadcast *broadcast,
+				DBusConnection *  connection)
+{
+	nih_assert (broadcast != NULL);
+	nih_assert (connection != NULL);
+
+	NIH_LIST_FOREACH (&broadcast->peers, iter) {
+		NihDBusBroadcastPeer *peer = (NihDBusBroadcastPeer *)iter;
+
+		if (peer->connection == connection)
+			return peer;
+	}
+
+	return NULL;
+}
+
+/**
+ * nih_dbus_broadcast_peer_destroy:
+ * @peer: peer being destroyed.
+ *
+ * Destructor function for an NihDBusBroadcastPeer structure; removes it
+ * from the broadcast's list and drops the reference to the connection.
+ * Its subscriptions are freed along with it.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_broadcast_peer_destroy (NihDBusBroadcastPeer *peer)
+{
+	nih_assert (peer != NULL);
+
+	peer->freeing = TRUE;
+
+	nih_list_destroy (&peer->entry);
+
+	dbus_connection_unref (peer->connection);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_broadcast_peer_match:
+ * @peer: peer to check,
+ * @interface: interface of signal,
+ * @member: name of signal.
+ *
+ * Checks whether any of the subscriptions of @peer match the signal
+ * named @member on @interface.
+ *
+ * Returns: TRUE if the signal should be sent to @peer, FALSE otherwise.
+ **/
+static int
+nih_dbus_broadcast_peer_match (NihDBusBroadcastPeer *peer,
+			       const char *          interface,
+			       const char *          member)
+{
+	nih_assert (peer != NULL);
+
+	NIH_LIST_FOREACH (&peer->subscriptions, iter) {
+		NihDBusSubscription *subscription = (NihDBusSubscription *)iter;
+
+		if (subscription->interface
+		    && ((! interface)
+			|| strcmp (subscription->interface, interface)))
+			continue;
+
+		if (subscription->member
+		    && ((! member)
+			|| strcmp (subscription->member, member)))
+			continue;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * nih_dbus_subscription_destroy:
+ * @subscription: subscription being destroyed.
+ *
+ * Destructor function for an NihDBusSubscription structure; removes it
+ * from its peer's list, and frees the peer if this was the last of its
+ * subscriptions.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_subscription_destroy (NihDBusSubscription *subscription)
+{
+	NihDBusBroadcastPeer *peer;
+
+	nih_assert (subscription != NULL);
+
+	peer = subscription->peer;
+
+	nih_list_destroy (&subscription->entry);
+
+	if ((! peer->freeing) && NIH_LIST_EMPTY (&peer->subscriptions))
+		nih_free (peer);
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_DBUS_BROADCAST_H
+#define NIH_DBUS_BROADCAST_H
+
+/**
+ * Servers accepting peer-to-peer connections with nih_dbus_server() have
+ * no bus daemon to route signals, so must send each signal to every
+ * interested connection themselves.  A broadcast tracks which signals
+ * each connection has subscribed to, and sends a signal to all of them
+ * by queueing the same message on each connection, so that it is only
+ * constructed and marshalled once:
+ *
+ *	broadcast = nih_dbus_broadcast_new (NULL);
+ *	nih_dbus_broadcast_subscribe (broadcast, connection,
+ *				      "com.example.Foo", NULL);
+ *	my_foo_broadcast_changed (broadcast, "/com/example/foo", value);
+ *
+ * nih-dbus-tool generates broadcast functions for signals annotated with
+ * com.netsplit.Nih.Signal.Broadcast.
+ **/
+
+#include <nih/macros.h>
+#include <nih/list.h>
+
+#include <dbus/dbus.h>
+
+
+/**
+ * NihDBusBroadcast:
+ * @peers: connections with subscriptions.
+ *
+ * This structure tracks the subscriptions of connections to the signals
+ * that are sent with nih_dbus_broadcast_send().
+ **/
+typedef struct nih_dbus_broadcast {
+	NihList peers;
+} NihDBusBroadcast;
+
+/**
+ * NihDBusSubscription:
+ * @entry: list header,
+ * @peer: connection subscription belongs to,
+ * @interface: interface of signals subscribed to,
+ * @member: name of signal subscribed to.
+ *
+ * This structure represents the subscription of a connection to signals
+ * on @interface named @member; either may be NULL to subscribe to any
+ * interface or any signal.
+ *
+ * The subscription may be cancelled by freeing it.
+ **/
+typedef struct nih_dbus_subscription {
+	NihList                         entry;
+	struct nih_dbus_broadcast_peer *peer;
+	char *                          interface;
+	char *                          member;
+} NihDBusSubscription;
+
+
+NIH_BEGIN_EXTERN
+
+NihDBusBroadcast *   nih_dbus_broadcast_new       (const void *parent)
+	__attribute__ ((warn_unused_result, malloc));
+
+NihDBusSubscription *nih_dbus_broadcast_subscribe (NihDBusBroadcast *broadcast,
+						   DBusConnection *connection,
+						   const char *interface,
+						   const char *member)
+	__attribute__ ((warn_unused_result));
+void                 nih_dbus_broadcast_remove    (NihDBusBroadcast *broadcast,
+						   DBusConnection *connection);
+
+int                  nih_dbus_broadcast_send      (NihDBusBroadcast *broadcast,
+						   DBusMessage *message)
+	__attribute__ ((warn_unused_result));
+
+NIH_END_EXTERN
+
+#endif /* NIH_DBUS_BROADCAST_H */
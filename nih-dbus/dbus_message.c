@@ -38,6 +38,16 @@
 static int nih_dbus_message_destroy (NihDBusMessage *msg);
 
 
+/**
+ * message_pool:
+ *
+ * Idle NihDBusMessage structure kept by nih_dbus_message_release() for
+ * re-use by the next call to nih_dbus_message_borrow().  This is not
+ * locked since messages are only dispatched from the main loop.
+ **/
+static NihDBusMessage *message_pool = NULL;
+
+
 /**
  * nih_dbus_message_new:
  * @parent: parent object for new message,
@@ -88,6 +98,95 @@ nih_dbus_message_new (const void *    parent,
 	return msg;
 }
 
+/**
+ * nih_dbus_message_borrow:
+ * @connection: D-Bus connection to associate with,
+ * @message: D-Bus message to encapsulate.
+ *
+ * Obtains a D-Bus message object for the duration of a synchronous call
+ * to a handler function, as used when dispatching method calls.  Unlike
+ * nih_dbus_message_new() no references are taken to @connection or
+ * @message, which the caller must hold until the object is passed to
+ * nih_dbus_message_release(), and the object is re-used from previous
+ * calls where possible rather than allocated each time.
+ *
+ * The object may be used as a parent for allocations by the handler in
+ * the normal way, and if the handler takes a reference to it, it will be
+ * converted into an ordinary message object by nih_dbus_message_release().
+ *
+ * The object is shared with other calls without locking, so this must
+ * only be called by the thread dispatching messages, normally the main
+ * loop; other threads should use nih_dbus_message_new().
+ *
+ * Returns: D-Bus message object, or NULL if insufficient memory.
+ **/
+NihDBusMessage *
+nih_dbus_message_borrow (DBusConnection *connection,
+			 DBusMessage *   message)
+{
+	NihDBusMessage *msg;
+
+	nih_assert (connection != NULL);
+	nih_assert (message != NULL);
+
+	if (message_pool) {
+		msg = message_pool;
+		message_pool = NULL;
+	} else {
+		msg = nih_new (NULL, NihDBusMessage);
+		if (! msg)
+			return NULL;
+	}
+
+	msg->connection = connection;
+	msg->message = message;
+
+	return msg;
+}
+
+/**
+ * nih_dbus_message_release:
+ * @msg: message obtained from nih_dbus_message_borrow().
+ *
+ * Releases the D-Bus message object @msg once the handler it was passed
+ * to has returned.
+ *
+ * If the handler took a reference to @msg, for example to reply to an
+ * asynchronous method call later, references to the connection and
+ * message are taken now and @msg is left to be freed along with its
+ * last parent in the same way as one returned by nih_dbus_message_new().
+ *
+ * Otherwise anything allocated as a child of @msg is freed, and @msg is
+ * kept for re-use by the next call to nih_dbus_message_borrow().
+ **/
+void
+nih_dbus_message_release (NihDBusMessage *msg)
+{
+	nih_assert (msg != NULL);
+
+	if (nih_alloc_parents (msg) > 1) {
+		dbus_connection_ref (msg->connection);
+		dbus_message_ref (msg->message);
+
+		nih_alloc_set_destructor (msg, nih_dbus_message_destroy);
+
+		nih_unref (msg, NULL);
+		return;
+	}
+
+	nih_free_children (msg);
+
+	msg->connection = NULL;
+	msg->message = NULL;
+
+	if (message_pool) {
+		nih_free (msg);
+	} else {
+		message_pool = msg;
+	}
+}
+
+
 /**
  * nih_dbus_message_destroy:
  * @msg: message to be destroyed.
@@ -50,7 +50,7 @@
  * for any reply data.
  *
  * Instances are allocated automatically and passed to marshaller functions,
- * and freed on their return.
+ * and freed on their return unless a reference has been taken to them.
  **/
 typedef struct nih_dbus_message {
 	DBusConnection *connection;
@@ -60,14 +60,19 @@ typedef struct nih_dbus_message {
 
 NIH_BEGIN_EXTERN
 
-NihDBusMessage *nih_dbus_message_new   (const void *parent,
-					DBusConnection *connection,
-					DBusMessage *message)
+NihDBusMessage *nih_dbus_message_new     (const void *parent,
+					  DBusConnection *connection,
+					  DBusMessage *message)
 	__attribute__ ((warn_unused_result));
 
-int             nih_dbus_message_error (NihDBusMessage *msg,
-					const char *name,
-					const char *format, ...)
+NihDBusMessage *nih_dbus_message_borrow  (DBusConnection *connection,
+					  DBusMessage *message)
+	__attribute__ ((warn_unused_result));
+void            nih_dbus_message_release (NihDBusMessage *msg);
+
+int             nih_dbus_message_error   (NihDBusMessage *msg,
+					  const char *name,
+					  const char *format, ...)
 	__attribute__ ((warn_unused_result));
 
 NIH_END_EXTERN
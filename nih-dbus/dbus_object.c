@@ -24,6 +24,9 @@
 #endif /* HAVE_CONFIG_H */
 
 
+#include <time.h>
+#include <stddef.h>
+
 #include <dbus/dbus.h>
 
 #include <nih/macros.h>
@@ -33,6 +36,7 @@
 #include <nih/string.h>
 #include <nih/logging.h>
 #include <nih/error.h>
+#include <nih/metrics.h>
 
 #include <nih-dbus/dbus_message.h>
 #include <nih-dbus/dbus_error.h>
@@ -41,6 +45,37 @@
 #include "dbus_object.h"
 
 
+/**
+ * NihDBusSubtreeEntry:
+ * @entry: list header for the subtree's cache,
+ * @path: path of object,
+ * @lru: list header for the subtree's recently used list,
+ * @subtree: subtree the object belongs to,
+ * @object: materialised object.
+ *
+ * This structure is used to cache the objects materialised by a subtree,
+ * @path is placed immediately after @entry so that the cache may be a
+ * string hash table.
+ **/
+typedef struct nih_dbus_subtree_entry {
+	NihList         entry;
+	const char *    path;
+	NihList         lru;
+	NihDBusSubtree *subtree;
+	NihDBusObject * object;
+} NihDBusSubtreeEntry;
+
+/**
+ * NIH_DBUS_SUBTREE_ENTRY:
+ * @_lru: pointer to lru member.
+ *
+ * Returns: the NihDBusSubtreeEntry containing the list header @_lru.
+ **/
+#define NIH_DBUS_SUBTREE_ENTRY(_lru) \
+	((NihDBusSubtreeEntry *)((char *)(_lru) \
+				 - offsetof (NihDBusSubtreeEntry, lru)))
+
+
 /* Prototypes for static functions */
 static int               nih_dbus_object_destroy      (NihDBusObject *object);
 static void              nih_dbus_object_unregister   (DBusConnection *connection,
@@ -60,6 +95,30 @@ static DBusHandlerResult nih_dbus_object_property_get_all (DBusConnection *conne
 static DBusHandlerResult nih_dbus_object_property_set (DBusConnection *connection,
 						       DBusMessage *message,
 						       NihDBusObject *object);
+static int               nih_dbus_object_append_interface (NihDBusObject *object,
+							   NihDBusMessage *message,
+							   const NihDBusInterface *interface,
+							   NihHash *name_hash,
+							   DBusMessageIter *arrayiter)
+	__attribute__ ((warn_unused_result));
+
+static int               nih_dbus_subtree_destroy     (NihDBusSubtree *subtree);
+static void              nih_dbus_subtree_unregister  (DBusConnection *connection,
+						       NihDBusSubtree *subtree);
+static DBusHandlerResult nih_dbus_subtree_message     (DBusConnection *connection,
+						       DBusMessage *message,
+						       NihDBusSubtree *subtree);
+static NihDBusObject *   nih_dbus_subtree_wrap        (const void *parent,
+						       NihDBusSubtree *subtree,
+						       const char *path,
+						       const NihDBusInterface **interfaces,
+						       void *data)
+	__attribute__ ((warn_unused_result, malloc));
+static int               nih_dbus_subtree_object      (NihDBusSubtree *subtree,
+						       const char *path,
+						       NihDBusObject **object)
+	__attribute__ ((warn_unused_result));
+static int               nih_dbus_subtree_entry_destroy (NihDBusSubtreeEntry *entry);
 
 
 /**
@@ -73,6 +132,27 @@ static const DBusObjectPathVTable nih_dbus_object_vtable = {
 	NULL,
 };
 
+/**
+ * nih_dbus_subtree_vtable:
+ *
+ * Table of functions for handling D-Bus subtrees.
+ **/
+static const DBusObjectPathVTable nih_dbus_subtree_vtable = {
+	(DBusObjectPathUnregisterFunction)nih_dbus_subtree_unregister,
+	(DBusObjectPathMessageFunction)nih_dbus_subtree_message,
+	NULL,
+};
+
+/**
+ * nih_dbus_subtree_no_interfaces:
+ *
+ * Interfaces array for the objects materialised to answer the Introspect
+ * method on paths within a subtree that have no object of their own.
+ **/
+static const NihDBusInterface *nih_dbus_subtree_no_interfaces[] = {
+	NULL
+};
+
 
 /**
  * nih_dbus_object_new:
@@ -136,6 +216,7 @@ nih_dbus_object_new (const void *             parent,
 	object->data = data;
 	object->interfaces = interfaces;
 	object->registered = FALSE;
+	object->subtree = NULL;
 
 	if (! dbus_connection_register_object_path (object->connection,
 						    object->path,
@@ -255,18 +336,41 @@ nih_dbus_object_message (DBusConnection *connection,
 			if (dbus_message_is_method_call (message,
 							 (*interface)->name,
 							 method->name)) {
-				nih_local NihDBusMessage *msg = NULL;
-				DBusHandlerResult         result;
-
-				msg = nih_dbus_message_new (NULL,
-							    connection, message);
+				NihDBusMessage *  msg;
+				DBusHandlerResult result;
+				struct timespec   start;
+				struct timespec   end;
+
+				/* The handler is called synchronously and
+				 * we hold the connection and message until
+				 * it returns, so borrow a message object
+				 * rather than allocating a new one; it's
+				 * kept if the handler takes a reference.
+				 */
+				msg = nih_dbus_message_borrow (connection,
+							       message);
 				if (! msg)
 					return DBUS_HANDLER_RESULT_NEED_MEMORY;
 
+				NIH_METRIC_ADD ("dbus_method_calls", 1);
+				if (nih_metrics_enabled)
+					clock_gettime (CLOCK_MONOTONIC, &start);
+
 				nih_error_push_context ();
 				result = method->handler (object, msg);
 				nih_error_pop_context ();
 
+				nih_dbus_message_release (msg);
+
+				if (nih_metrics_enabled) {
+					clock_gettime (CLOCK_MONOTONIC, &end);
+					NIH_METRIC_RECORD (
+						"dbus_dispatch_ns",
+						((end.tv_sec - start.tv_sec)
+						 * 1000000000ULL
+						 + end.tv_nsec - start.tv_nsec));
+				}
+
 				if (result != DBUS_HANDLER_RESULT_NOT_YET_HANDLED)
 					return result;
 			}
@@ -477,12 +581,29 @@ nih_dbus_object_introspect (DBusConnection *connection,
 		}
 	}
 
-	if (! nih_strcat (&xml, NULL, "</node>\n")) {
-		dbus_free_string_array (children);
-		return DBUS_HANDLER_RESULT_NEED_MEMORY;
+	dbus_free_string_array (children);
+
+	/* And for the children of objects materialised by a subtree, which
+	 * libdbus knows nothing about.
+	 */
+	if (object->subtree && object->subtree->children) {
+		nih_local char **subtree_children = NULL;
+
+		subtree_children = object->subtree->children (
+			object->subtree->data, object->subtree,
+			NULL, object->path);
+		if (! subtree_children)
+			return DBUS_HANDLER_RESULT_NEED_MEMORY;
+
+		for (child = subtree_children; *child; child++)
+			if (! nih_strcat_sprintf (&xml, NULL,
+						  "  <node name=\"%s\"/>\n",
+						  *child))
+				return DBUS_HANDLER_RESULT_NEED_MEMORY;
 	}
 
-	dbus_free_string_array (children);
+	if (! nih_strcat (&xml, NULL, "</node>\n"))
+		return DBUS_HANDLER_RESULT_NEED_MEMORY;
 
 
 	/* Generate and send the reply */
@@ -740,96 +861,46 @@ nih_dbus_object_property_get_all (DBusConnection *connection,
 	 */
 	for (interface = object->interfaces; interface && *interface;
 	     interface++) {
-		const NihDBusProperty *property;
-
 		if (strlen (interface_name)
 		    && strcmp ((*interface)->name, interface_name))
 			continue;
 
-		for (property = (*interface)->properties;
-		     property && property->name;
-		     property++) {
-			if (property->getter
-			    && (! nih_hash_lookup (name_hash, property->name))) {
-				NihListEntry *  entry;
-				DBusMessageIter dictiter;
-				int             ret;
-
-				entry = nih_list_entry_new (name_hash);
-				if (! entry) {
-					dbus_message_iter_abandon_container (&iter, &arrayiter);
-					dbus_message_unref (reply);
-					return DBUS_HANDLER_RESULT_NEED_MEMORY;
-				}
-
-				entry->str = (char *)property->name;
-				nih_hash_add (name_hash, &entry->entry);
-
-				if (! dbus_message_iter_open_container (
-					    &arrayiter, DBUS_TYPE_DICT_ENTRY,
-					    NULL, &dictiter)) {
-					dbus_message_iter_abandon_container (&iter, &arrayiter);
-					dbus_message_unref (reply);
-					return DBUS_HANDLER_RESULT_NEED_MEMORY;
-				}
-
-				if (! dbus_message_iter_append_basic (
-					    &dictiter, DBUS_TYPE_STRING,
-					    &(property->name))) {
-					dbus_message_iter_abandon_container (&arrayiter, &dictiter);
-					dbus_message_iter_abandon_container (&iter, &arrayiter);
-					dbus_message_unref (reply);
-					return DBUS_HANDLER_RESULT_NEED_MEMORY;
-				}
-
-				nih_error_push_context ();
-				ret = property->getter (object, msg, &dictiter);
-				if (ret < 0) {
-					NihError *err;
-
-					dbus_message_iter_abandon_container (&arrayiter, &dictiter);
-					dbus_message_iter_abandon_container (&iter, &arrayiter);
-					dbus_message_unref (reply);
-
-					err = nih_error_get ();
-					if (err->number == ENOMEM) {
-						nih_free (err);
-						nih_error_pop_context ();
-
-						return DBUS_HANDLER_RESULT_NEED_MEMORY;
-					} else if (err->number == NIH_DBUS_ERROR) {
-						NihDBusError *dbus_err = (NihDBusError *)err;
-
-						reply = NIH_MUST (dbus_message_new_error (
-									  message,
-									  dbus_err->name,
-									  dbus_err->message));
-						nih_free (err);
-						nih_error_pop_context ();
-					} else {
-						reply = NIH_MUST (dbus_message_new_error (
-									  message,
-									  DBUS_ERROR_FAILED,
-									  err->message));
-						nih_free (err);
-						nih_error_pop_context ();
-					}
-
-					goto reply;
-				} else {
-					nih_error_pop_context ();
+		nih_error_push_context ();
+		if (nih_dbus_object_append_interface (object, msg, *interface,
+						      name_hash,
+						      &arrayiter) < 0) {
+			NihError *err;
 
-					if (! dbus_message_iter_close_container (
-						    &arrayiter, &dictiter)) {
-						dbus_message_iter_abandon_container (&iter, &arrayiter);
-						dbus_message_unref (reply);
-						return DBUS_HANDLER_RESULT_NEED_MEMORY;
-					}
-				}
+			dbus_message_iter_abandon_container (&iter, &arrayiter);
+			dbus_message_unref (reply);
 
+			err = nih_error_get ();
+			if (err->number == ENOMEM) {
+				nih_free (err);
+				nih_error_pop_context ();
 
+				return DBUS_HANDLER_RESULT_NEED_MEMORY;
+			} else if (err->number == NIH_DBUS_ERROR) {
+				NihDBusError *dbus_err = (NihDBusError *)err;
+
+				reply = NIH_MUST (dbus_message_new_error (
+							  message,
+							  dbus_err->name,
+							  dbus_err->message));
+				nih_free (err);
+				nih_error_pop_context ();
+			} else {
+				reply = NIH_MUST (dbus_message_new_error (
+							  message,
+							  DBUS_ERROR_FAILED,
+							  err->message));
+				nih_free (err);
+				nih_error_pop_context ();
 			}
+
+			goto reply;
 		}
+		nih_error_pop_context ();
 	}
 
 	/* Close the array and send the reply */
@@ -849,6 +920,149 @@ reply:
 	return DBUS_HANDLER_RESULT_HANDLED;
 }
 
+/**
+ * nih_dbus_object_append_interface:
+ * @object: object to get properties of,
+ * @message: message being handled,
+ * @interface: interface to get properties of,
+ * @name_hash: names of properties already appended,
+ * @arrayiter: iterator for open array.
+ *
+ * Calls the getter function of each readable property of @interface for
+ * @object, appending a dictionary entry of the property name and value
+ * to the array open at @arrayiter.
+ *
+ * If @name_hash is not NULL, properties already in it are skipped and
+ * those appended are added to it, so that properties of the same name
+ * in different interfaces are only appended once.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_dbus_object_append_interface (NihDBusObject *         object,
+				  NihDBusMessage *        message,
+				  const NihDBusInterface *interface,
+				  NihHash *               name_hash,
+				  DBusMessageIter *       arrayiter)
+{
+	const NihDBusProperty *property;
+
+	nih_assert (object != NULL);
+	nih_assert (message != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (arrayiter != NULL);
+
+	for (property = interface->properties; property && property->name;
+	     property++) {
+		DBusMessageIter dictiter;
+		int             ret;
+
+		if (! property->getter)
+			continue;
+
+		if (name_hash) {
+			NihListEntry *entry;
+
+			if (nih_hash_lookup (name_hash, property->name))
+				continue;
+
+			entry = nih_list_entry_new (name_hash);
+			if (! entry)
+				nih_return_no_memory_error (-1);
+
+			entry->str = (char *)property->name;
+			nih_hash_add (name_hash, &entry->entry);
+		}
+
+		if (! dbus_message_iter_open_container (arrayiter,
+							DBUS_TYPE_DICT_ENTRY,
+							NULL, &dictiter))
+			nih_return_no_memory_error (-1);
+
+		if (! dbus_message_iter_append_basic (&dictiter,
+						      DBUS_TYPE_STRING,
+						      &(property->name))) {
+			dbus_message_iter_abandon_container (arrayiter,
+							     &dictiter);
+			nih_return_no_memory_error (-1);
+		}
+
+		/* Call the getter in its own context, raising whatever
+		 * error it returns in ours.
+		 */
+		nih_error_push_context ();
+		ret = property->getter (object, message, &dictiter);
+		if (ret < 0) {
+			NihError *err;
+
+			dbus_message_iter_abandon_container (arrayiter,
+							     &dictiter);
+
+			err = nih_error_steal ();
+			nih_error_pop_context ();
+
+			nih_error_raise_error (err);
+			return -1;
+		}
+		nih_error_pop_context ();
+
+		if (! dbus_message_iter_close_container (arrayiter, &dictiter))
+			nih_return_no_memory_error (-1);
+	}
+
+	return 0;
+}
+
+/**
+ * nih_dbus_object_append_properties:
+ * @object: object to get properties of,
+ * @message: message being handled,
+ * @interface: interface to get properties of,
+ * @iter: iterator to append to.
+ *
+ * Appends a dictionary of the names and values of the readable properties
+ * of @interface for @object to @iter, as returned by the GetAll method,
+ * calling the getter function of each property.  @message is passed to
+ * the getter functions, and is normally the message being replied to.
+ *
+ * This is used to build messages that describe objects, such as the
+ * signals and replies of an object manager.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_object_append_properties (NihDBusObject *         object,
+				   NihDBusMessage *        message,
+				   const NihDBusInterface *interface,
+				   DBusMessageIter *       iter)
+{
+	DBusMessageIter arrayiter;
+
+	nih_assert (object != NULL);
+	nih_assert (message != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (iter != NULL);
+
+	if (! dbus_message_iter_open_container (iter, DBUS_TYPE_ARRAY,
+						(DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						 DBUS_TYPE_STRING_AS_STRING
+						 DBUS_TYPE_VARIANT_AS_STRING
+						 DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+						&arrayiter))
+		nih_return_no_memory_error (-1);
+
+	if (nih_dbus_object_append_interface (object, message, interface,
+					      NULL, &arrayiter) < 0) {
+		dbus_message_iter_abandon_container (iter, &arrayiter);
+		return -1;
+	}
+
+	if (! dbus_message_iter_close_container (iter, &arrayiter))
+		nih_return_no_memory_error (-1);
+
+	return 0;
+}
+
 /**
  * nih_dbus_object_property_set:
  * @connection: D-Bus connection,
@@ -981,3 +1195,409 @@ nih_dbus_object_property_set (DBusConnection *connection,
 
 	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
+
+
+/**
+ * nih_dbus_subtree_new:
+ * @parent: parent object for new subtree,
+ * @connection: D-Bus connection to associate with,
+ * @path: path of subtree,
+ * @lookup: function to resolve objects,
+ * @children: function to enumerate children of objects,
+ * @cache_size: maximum number of objects to cache,
+ * @data: data pointer.
+ *
+ * Creates a new D-Bus subtree that handles messages received on
+ * @connection for @path and every path beneath it that does not have an
+ * object of its own registered with nih_dbus_object_new().
+ *
+ * Rather than each object being registered in advance, @lookup is called
+ * with the path of a message to resolve the data pointer and interfaces
+ * of the object there, and a NihDBusObject is materialised from them to
+ * handle the message in the same way as a registered one.  If there is
+ * no object at that path, the message is left for libdbus to reply to
+ * with an error.
+ *
+ * Up to @cache_size materialised objects are kept so that @lookup need
+ * not be called for each message to the same object; the least recently
+ * used are discarded as others are materialised.  When the object at a
+ * cached path goes away, or its interfaces change, you must call
+ * nih_dbus_subtree_invalidate().  If @cache_size is zero, objects are
+ * materialised for each message and discarded afterwards.
+ *
+ * If @children is not NULL, it is called when the Introspect method is
+ * invoked to enumerate the objects beneath a path so that clients may
+ * discover them; Introspect may also be invoked on paths that have no
+ * object but have children, such as @path itself.
+ *
+ * The subtree structure is allocated using nih_alloc() and connected to
+ * the given @connection, it can be unregistered by freeing it and it will
+ * be automatically unregistered should @connection be disconnected.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned subtree.  When all parents
+ * of the returned subtree are freed, the returned subtree will also be
+ * freed.
+ *
+ * Returns: new NihDBusSubtree structure on success, or NULL if
+ * insufficient memory.
+ **/
+NihDBusSubtree *
+nih_dbus_subtree_new (const void *           parent,
+		      DBusConnection *       connection,
+		      const char *           path,
+		      NihDBusSubtreeLookup   lookup,
+		      NihDBusSubtreeChildren children,
+		      size_t                 cache_size,
+		      void *                 data)
+{
+	NihDBusSubtree *subtree;
+
+	nih_assert (connection != NULL);
+	nih_assert (path != NULL);
+	nih_assert (lookup != NULL);
+
+	subtree = nih_new (parent, NihDBusSubtree);
+	if (! subtree)
+		return NULL;
+
+	subtree->path = nih_strdup (subtree, path);
+	if (! subtree->path) {
+		nih_free (subtree);
+		return NULL;
+	}
+
+	/* As with objects, we don't reference the connection.
+	 */
+	subtree->connection = connection;
+
+	subtree->data = data;
+	subtree->lookup = lookup;
+	subtree->children = children;
+
+	subtree->cache_size = cache_size;
+	subtree->cache_len = 0;
+	subtree->cache = NULL;
+	nih_list_init (&subtree->lru);
+
+	subtree->registered = FALSE;
+
+	if (cache_size) {
+		subtree->cache = nih_hash_string_new (subtree, cache_size);
+		if (! subtree->cache) {
+			nih_free (subtree);
+			return NULL;
+		}
+	}
+
+	if (! dbus_connection_register_fallback (subtree->connection,
+						 subtree->path,
+						 &nih_dbus_subtree_vtable,
+						 subtree)) {
+		nih_free (subtree);
+		return NULL;
+	}
+
+	subtree->registered = TRUE;
+	nih_alloc_set_destructor (subtree, nih_dbus_subtree_destroy);
+
+	return subtree;
+}
+
+/**
+ * nih_dbus_subtree_destroy:
+ * @subtree: D-Bus subtree being destroyed.
+ *
+ * Destructor function for an NihDBusSubtree structure, ensures that it
+ * is unregistered from the attached D-Bus connection and path.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_subtree_destroy (NihDBusSubtree *subtree)
+{
+	nih_assert (subtree != NULL);
+
+	if (subtree->registered) {
+		subtree->registered = FALSE;
+		dbus_connection_unregister_object_path (subtree->connection,
+							subtree->path);
+	}
+
+	return 0;
+}
+
+/**
+ * nih_dbus_subtree_unregister:
+ * @connection: D-Bus connection,
+ * @subtree: D-Bus subtree to destroy.
+ *
+ * Called by D-Bus to unregister the @subtree attached to the D-Bus
+ * connection @connection, requires us to free the attached structure.
+ **/
+static void
+nih_dbus_subtree_unregister (DBusConnection *connection,
+			     NihDBusSubtree *subtree)
+{
+	nih_assert (connection != NULL);
+	nih_assert (subtree != NULL);
+	nih_assert (subtree->connection == connection);
+
+	if (subtree->registered) {
+		subtree->registered = FALSE;
+		nih_free (subtree);
+	}
+}
+
+
+/**
+ * nih_dbus_subtree_invalidate:
+ * @subtree: D-Bus subtree,
+ * @path: path of object.
+ *
+ * Discards the object at @path from the cache of @subtree, so that it
+ * will be looked up again when the next message for it is received.  This
+ * must be called when an object that may be cached goes away or its
+ * interfaces change.
+ *
+ * If @path is NULL, all cached objects are discarded.
+ **/
+void
+nih_dbus_subtree_invalidate (NihDBusSubtree *subtree,
+			     const char *    path)
+{
+	NihDBusSubtreeEntry *entry;
+
+	nih_assert (subtree != NULL);
+
+	if (! subtree->cache)
+		return;
+
+	if (! path) {
+		while (! NIH_LIST_EMPTY (&subtree->lru))
+			nih_free (NIH_DBUS_SUBTREE_ENTRY (subtree->lru.next));
+
+		return;
+	}
+
+	entry = (NihDBusSubtreeEntry *)nih_hash_lookup (subtree->cache, path);
+	if (entry)
+		nih_free (entry);
+}
+
+
+/**
+ * nih_dbus_subtree_message:
+ * @connection: D-Bus connection,
+ * @message: D-Bus message received,
+ * @subtree: Subtree that received the message.
+ *
+ * Called by D-Bus when a @message is received for a path within @subtree
+ * that has no object registered.  We materialise the object at that path,
+ * using the cache where possible, and handle the message as if it had
+ * been received by a registered object.
+ *
+ * Returns: result of handling the message.
+ **/
+static DBusHandlerResult
+nih_dbus_subtree_message (DBusConnection *connection,
+			  DBusMessage *   message,
+			  NihDBusSubtree *subtree)
+{
+	const char *      path;
+	NihDBusObject *   object;
+	DBusHandlerResult result;
+
+	nih_assert (connection != NULL);
+	nih_assert (message != NULL);
+	nih_assert (subtree != NULL);
+	nih_assert (subtree->connection == connection);
+
+	path = dbus_message_get_path (message);
+	if (! path)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (nih_dbus_subtree_object (subtree, path, &object) < 0)
+		return DBUS_HANDLER_RESULT_NEED_MEMORY;
+
+	/* Paths without an object may still have children, so answer
+	 * introspection for those with an object that has no interfaces.
+	 */
+	if ((! object) && subtree->children
+	    && dbus_message_is_method_call (
+		    message, DBUS_INTERFACE_INTROSPECTABLE, "Introspect")) {
+		object = nih_dbus_subtree_wrap (NULL, subtree, path,
+						nih_dbus_subtree_no_interfaces,
+						NULL);
+		if (! object)
+			return DBUS_HANDLER_RESULT_NEED_MEMORY;
+	}
+
+	if (! object)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	/* We hold a reference to the object while it handles the message,
+	 * since a handler may invalidate it.
+	 */
+	result = nih_dbus_object_message (connection, message, object);
+	nih_unref (object, NULL);
+
+	return result;
+}
+
+/**
+ * nih_dbus_subtree_wrap:
+ * @parent: parent object for new object,
+ * @subtree: D-Bus subtree,
+ * @path: path of object,
+ * @interfaces: interfaces list to attach,
+ * @data: data pointer.
+ *
+ * Materialises the object at @path within @subtree, which is not
+ * registered with the connection.
+ *
+ * Returns: new NihDBusObject structure on success, or NULL if
+ * insufficient memory.
+ **/
+static NihDBusObject *
+nih_dbus_subtree_wrap (const void *             parent,
+		       NihDBusSubtree *         subtree,
+		       const char *             path,
+		       const NihDBusInterface **interfaces,
+		       void *                   data)
+{
+	NihDBusObject *object;
+
+	nih_assert (subtree != NULL);
+	nih_assert (path != NULL);
+	nih_assert (interfaces != NULL);
+
+	object = nih_new (parent, NihDBusObject);
+	if (! object)
+		return NULL;
+
+	object->path = nih_strdup (object, path);
+	if (! object->path) {
+		nih_free (object);
+		return NULL;
+	}
+
+	object->connection = subtree->connection;
+	object->data = data;
+	object->interfaces = interfaces;
+	object->registered = FALSE;
+	object->subtree = subtree;
+
+	return object;
+}
+
+/**
+ * nih_dbus_subtree_object:
+ * @subtree: D-Bus subtree,
+ * @path: path of object,
+ * @object: pointer to store object in.
+ *
+ * Locates the object at @path within @subtree, either from its cache or
+ * by calling its lookup function and materialising a new object, which
+ * is added to the cache if it has one.  The cache is kept in order of use
+ * so that the least recently used object is discarded when it is full.
+ *
+ * On return @object is set to the object with a reference held by the
+ * NULL parent, which the caller must drop with nih_unref(), or to NULL
+ * if there is no object at @path.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+static int
+nih_dbus_subtree_object (NihDBusSubtree *subtree,
+			 const char *    path,
+			 NihDBusObject **object)
+{
+	NihDBusSubtreeEntry *    entry;
+	const NihDBusInterface **interfaces = NULL;
+	void *                   data = NULL;
+
+	nih_assert (subtree != NULL);
+	nih_assert (path != NULL);
+	nih_assert (object != NULL);
+
+	*object = NULL;
+
+	if (subtree->cache) {
+		entry = (NihDBusSubtreeEntry *)nih_hash_lookup (subtree->cache,
+								path);
+		if (entry) {
+			nih_list_add_after (&subtree->lru, &entry->lru);
+
+			*object = entry->object;
+			nih_ref (*object, NULL);
+
+			return 0;
+		}
+	}
+
+	if (! subtree->lookup (subtree->data, subtree, path,
+			       &data, &interfaces))
+		return 0;
+
+	nih_assert (interfaces != NULL);
+
+	if (! subtree->cache) {
+		*object = nih_dbus_subtree_wrap (NULL, subtree, path,
+						 interfaces, data);
+
+		return *object ? 0 : -1;
+	}
+
+	entry = nih_new (subtree, NihDBusSubtreeEntry);
+	if (! entry)
+		return -1;
+
+	nih_list_init (&entry->entry);
+	nih_list_init (&entry->lru);
+
+	entry->subtree = subtree;
+	entry->object = nih_dbus_subtree_wrap (entry, subtree, path,
+					       interfaces, data);
+	if (! entry->object) {
+		nih_free (entry);
+		return -1;
+	}
+
+	entry->path = entry->object->path;
+
+	if (subtree->cache_len >= subtree->cache_size)
+		nih_free (NIH_DBUS_SUBTREE_ENTRY (subtree->lru.prev));
+
+	nih_hash_add (subtree->cache, &entry->entry);
+	nih_list_add_after (&subtree->lru, &entry->lru);
+	subtree->cache_len++;
+
+	nih_alloc_set_destructor (entry, nih_dbus_subtree_entry_destroy);
+
+	*object = entry->object;
+	nih_ref (*object, NULL);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_subtree_entry_destroy:
+ * @entry: cache entry being destroyed.
+ *
+ * Destructor function for an NihDBusSubtreeEntry structure, ensures that
+ * it is removed from the cache of its subtree.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_subtree_entry_destroy (NihDBusSubtreeEntry *entry)
+{
+	nih_assert (entry != NULL);
+
+	nih_list_destroy (&entry->entry);
+	nih_list_destroy (&entry->lru);
+	entry->subtree->cache_len--;
+
+	return 0;
+}
@@ -21,19 +21,77 @@
 #define NIH_DBUS_OBJECT_H
 
 #include <nih/macros.h>
+#include <nih/list.h>
+#include <nih/hash.h>
 
 #include <nih-dbus/dbus_interface.h>
+#include <nih-dbus/dbus_message.h>
 
 #include <dbus/dbus.h>
 
 
+/**
+ * NihDBusSubtree:
+ *
+ * Forward declaration of the structure representing a subtree of objects
+ * materialised on demand, defined below.
+ **/
+typedef struct nih_dbus_subtree NihDBusSubtree;
+
+
+/**
+ * NihDBusSubtreeLookup:
+ * @data: data pointer passed to nih_dbus_subtree_new(),
+ * @subtree: subtree containing @path,
+ * @path: path of object,
+ * @object_data: pointer to store object's data pointer in,
+ * @interfaces: pointer to store object's interfaces array in.
+ *
+ * A subtree lookup function is called to resolve the object at @path,
+ * which is the path of @subtree or one beneath it, when a message is
+ * received for it and it is not already cached.
+ *
+ * If an object exists at @path, the function should store the data pointer
+ * to be passed to its handlers in @object_data and its NULL-terminated
+ * array of interfaces in @interfaces, and return TRUE.
+ *
+ * Returns: TRUE if an object exists at @path, FALSE otherwise.
+ **/
+typedef int (*NihDBusSubtreeLookup) (void *data, NihDBusSubtree *subtree,
+				     const char *path, void **object_data,
+				     const NihDBusInterface ***interfaces);
+
+/**
+ * NihDBusSubtreeChildren:
+ * @data: data pointer passed to nih_dbus_subtree_new(),
+ * @subtree: subtree containing @path,
+ * @parent: parent object for new array,
+ * @path: path of object.
+ *
+ * A subtree children function is called when the Introspect method is
+ * invoked on @path, which is the path of @subtree or one beneath it, to
+ * enumerate the objects immediately beneath it.
+ *
+ * The function should return a NULL-terminated array of the final path
+ * elements of those objects, allocated with nih_alloc() using @parent,
+ * omitting any that have been registered with nih_dbus_object_new() since
+ * those are included automatically.
+ *
+ * Returns: newly allocated array or NULL if insufficient memory.
+ **/
+typedef char **(*NihDBusSubtreeChildren) (void *data, NihDBusSubtree *subtree,
+					  const void *parent,
+					  const char *path);
+
+
 /**
  * NihDBusObject:
  * @path: path of object,
  * @connection: associated connection,
  * @data: pointer to object data,
  * @interfaces: NULL-terminated array of interfaces the object supports,
- * @registered: TRUE while the object is registered.
+ * @registered: TRUE while the object is registered,
+ * @subtree: subtree the object was materialised by.
  *
  * This structure represents an object visible on the given @connection
  * at @path and being handled by libnih-dbus.  It connects the @data
@@ -45,6 +103,10 @@
  * No reference is held to @connection, therefore you may not assume that
  * it is valid.  In general, the object will be automatically freed should
  * @connection be cleaned up.
+ *
+ * Objects passed to handlers by a subtree are not registered themselves,
+ * and have @subtree set; these may be freed once the handler returns so
+ * should not be stored.
  **/
 struct nih_dbus_object {
 	char *                   path;
@@ -52,6 +114,49 @@ struct nih_dbus_object {
 	void *                   data;
 	const NihDBusInterface **interfaces;
 	int                      registered;
+	NihDBusSubtree *         subtree;
+};
+
+/**
+ * NihDBusSubtree:
+ * @path: path of subtree,
+ * @connection: associated connection,
+ * @data: pointer passed to @lookup and @children,
+ * @lookup: function to resolve objects,
+ * @children: function to enumerate children of objects,
+ * @cache_size: maximum number of objects to cache,
+ * @cache_len: number of objects cached,
+ * @cache: hash table of cached objects,
+ * @lru: list of cached objects, most recently used first,
+ * @registered: TRUE while the subtree is registered.
+ *
+ * This structure represents a set of objects visible on the given
+ * @connection at @path and the paths beneath it, which are only
+ * materialised as NihDBusObject structures when a message is received for
+ * them by calling @lookup; this allows large numbers of objects to be
+ * exported without registering each one with @connection.
+ *
+ * Up to @cache_size of the materialised objects are kept in @cache so
+ * that @lookup need not be called for each message, the least recently
+ * used being discarded first.
+ *
+ * No reference is held to @connection, therefore you may not assume that
+ * it is valid.  In general, the subtree will be automatically freed should
+ * @connection be cleaned up.
+ **/
+struct nih_dbus_subtree {
+	char *                 path;
+	DBusConnection *       connection;
+	void *                 data;
+	NihDBusSubtreeLookup   lookup;
+	NihDBusSubtreeChildren children;
+
+	size_t                 cache_size;
+	size_t                 cache_len;
+	NihHash *              cache;
+	NihList                lru;
+
+	int                    registered;
 };
 
 
@@ -63,6 +168,22 @@ NihDBusObject *nih_dbus_object_new (const void *parent,
 				    const NihDBusInterface **interfaces,
 				    void *data);
 
+int            nih_dbus_object_append_properties (NihDBusObject *object,
+						  NihDBusMessage *message,
+						  const NihDBusInterface *interface,
+						  DBusMessageIter *iter)
+	__attribute__ ((warn_unused_result));
+
+NihDBusSubtree *nih_dbus_subtree_new        (const void *parent,
+					     DBusConnection *connection,
+					     const char *path,
+					     NihDBusSubtreeLookup lookup,
+					     NihDBusSubtreeChildren children,
+					     size_t cache_size, void *data);
+
+void            nih_dbus_subtree_invalidate (NihDBusSubtree *subtree,
+					     const char *path);
+
 NIH_END_EXTERN
 
 #endif /* NIH_DBUS_OBJECT_H */
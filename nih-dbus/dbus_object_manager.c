@@ -0,0 +1,777 @@
+/* libnih
+ *
+ * dbus_object_manager.c - D-Bus object manager
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <errno.h>
+#include <string.h>
+
+#include <dbus/dbus.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_error.h>
+#include <nih-dbus/dbus_message.h>
+#include <nih-dbus/dbus_object.h>
+#include <nih-dbus/errors.h>
+
+#include "dbus_object_manager.h"
+
+
+/**
+ * NihDBusObjectManager:
+ * @object: object implementing the interface,
+ * @objects: hash table of managed objects,
+ * @freeing: TRUE while the manager is being freed.
+ *
+ * This structure holds the state of an object manager, and is the data
+ * pointer of @object.
+ **/
+typedef struct nih_dbus_object_manager {
+	NihDBusObject *object;
+	NihHash *      objects;
+	int            freeing;
+} NihDBusObjectManager;
+
+/**
+ * NihDBusObjectManagerEntry:
+ * @entry: list header for the manager's hash table,
+ * @path: path of object,
+ * @object: managed object,
+ * @manager: object manager,
+ * @removed: TRUE once InterfacesRemoved has been emitted.
+ *
+ * This structure is allocated as a child of each managed @object so that
+ * it is removed from @manager when freed; @path is placed immediately
+ * after @entry so that the manager's table may be a string hash table.
+ **/
+typedef struct nih_dbus_object_manager_entry {
+	NihList               entry;
+	const char *          path;
+	NihDBusObject *       object;
+	NihDBusObjectManager *manager;
+	int                   removed;
+} NihDBusObjectManagerEntry;
+
+
+/* Prototypes for static functions */
+static int               nih_dbus_object_manager_destroy           (NihDBusObjectManager *manager);
+static int               nih_dbus_object_manager_entry_destroy     (NihDBusObjectManagerEntry *entry);
+static int               nih_dbus_object_manager_beneath           (const char *manager_path,
+								    const char *path);
+static DBusHandlerResult nih_dbus_object_manager_get_managed_objects (NihDBusObject *object,
+								    NihDBusMessage *message);
+static int               nih_dbus_object_manager_append_interfaces (NihDBusObject *object,
+								    NihDBusMessage *message,
+								    DBusMessageIter *iter)
+	__attribute__ ((warn_unused_result));
+static int               nih_dbus_object_manager_interfaces_added  (NihDBusObjectManager *manager,
+								    NihDBusObject *object)
+	__attribute__ ((warn_unused_result));
+static int               nih_dbus_object_manager_interfaces_removed (NihDBusObjectManager *manager,
+								     NihDBusObject *object)
+	__attribute__ ((warn_unused_result));
+
+
+/**
+ * nih_dbus_object_manager_get_managed_objects_args:
+ *
+ * Arguments of the GetManagedObjects method.
+ **/
+static const NihDBusArg nih_dbus_object_manager_get_managed_objects_args[] = {
+	{ "object_paths_interfaces_and_properties", "a{oa{sa{sv}}}",
+	  NIH_DBUS_ARG_OUT },
+	{ NULL }
+};
+
+/**
+ * nih_dbus_object_manager_interfaces_added_args:
+ *
+ * Arguments of the InterfacesAdded signal.
+ **/
+static const NihDBusArg nih_dbus_object_manager_interfaces_added_args[] = {
+	{ "object_path", "o", NIH_DBUS_ARG_OUT },
+	{ "interfaces_and_properties", "a{sa{sv}}", NIH_DBUS_ARG_OUT },
+	{ NULL }
+};
+
+/**
+ * nih_dbus_object_manager_interfaces_removed_args:
+ *
+ * Arguments of the InterfacesRemoved signal.
+ **/
+static const NihDBusArg nih_dbus_object_manager_interfaces_removed_args[] = {
+	{ "object_path", "o", NIH_DBUS_ARG_OUT },
+	{ "interfaces", "as", NIH_DBUS_ARG_OUT },
+	{ NULL }
+};
+
+/**
+ * nih_dbus_object_manager_methods:
+ *
+ * Methods of the object manager interface.
+ **/
+static const NihDBusMethod nih_dbus_object_manager_methods[] = {
+	{ "GetManagedObjects", nih_dbus_object_manager_get_managed_objects_args,
+	  nih_dbus_object_manager_get_managed_objects },
+	{ NULL }
+};
+
+/**
+ * nih_dbus_object_manager_signals:
+ *
+ * Signals of the object manager interface.
+ **/
+static const NihDBusSignal nih_dbus_object_manager_signals[] = {
+	{ "InterfacesAdded", nih_dbus_object_manager_interfaces_added_args,
+	  NULL },
+	{ "InterfacesRemoved", nih_dbus_object_manager_interfaces_removed_args,
+	  NULL },
+	{ NULL }
+};
+
+/**
+ * nih_dbus_object_manager_interface:
+ *
+ * Definition of the org.freedesktop.DBus.ObjectManager interface.
+ **/
+static const NihDBusInterface nih_dbus_object_manager_interface = {
+	NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+	nih_dbus_object_manager_methods,
+	nih_dbus_object_manager_signals,
+	NULL
+};
+
+/**
+ * nih_dbus_object_manager_interfaces:
+ *
+ * Interfaces array for object managers.
+ **/
+static const NihDBusInterface *nih_dbus_object_manager_interfaces[] = {
+	&nih_dbus_object_manager_interface,
+	NULL
+};
+
+
+/**
+ * nih_dbus_object_manager_new:
+ * @parent: parent object for new object,
+ * @connection: D-Bus connection to associate with,
+ * @path: path of object.
+ *
+ * Registers an object manager on @connection at @path, to which the
+ * objects beneath @path may be added with nih_dbus_object_manager_add().
+ *
+ * The object is unregistered when freed, or when @connection is
+ * disconnected.  Freeing the object manager does not free the objects
+ * that were added to it.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned object.  When all parents
+ * of the returned object are freed, the returned object will also be
+ * freed.
+ *
+ * Returns: new NihDBusObject structure on success, or NULL if
+ * insufficient memory.
+ **/
+NihDBusObject *
+nih_dbus_object_manager_new (const void *    parent,
+			     DBusConnection *connection,
+			     const char *    path)
+{
+	NihDBusObject *       object;
+	NihDBusObjectManager *manager;
+
+	nih_assert (connection != NULL);
+	nih_assert (path != NULL);
+
+	object = nih_dbus_object_new (parent, connection, path,
+				      nih_dbus_object_manager_interfaces, NULL);
+	if (! object)
+		return NULL;
+
+	manager = nih_new (object, NihDBusObjectManager);
+	if (! manager) {
+		nih_free (object);
+		return NULL;
+	}
+
+	manager->object = object;
+	manager->freeing = FALSE;
+
+	manager->objects = nih_hash_string_new (manager, 0);
+	if (! manager->objects) {
+		nih_free (object);
+		return NULL;
+	}
+
+	nih_alloc_set_destructor (manager, nih_dbus_object_manager_destroy);
+
+	object->data = manager;
+
+	return object;
+}
+
+/**
+ * nih_dbus_object_manager_destroy:
+ * @manager: object manager being destroyed.
+ *
+ * Destructor function for an NihDBusObjectManager structure, ensures that
+ * the entries attached to the managed objects are freed without emitting
+ * signals for them.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_object_manager_destroy (NihDBusObjectManager *manager)
+{
+	nih_assert (manager != NULL);
+
+	manager->freeing = TRUE;
+
+	NIH_HASH_FOREACH_SAFE (manager->objects, iter)
+		nih_free (iter);
+
+	return 0;
+}
+
+
+/**
+ * nih_dbus_object_manager_add:
+ * @manager: object manager,
+ * @object: object to add.
+ *
+ * Adds @object, which must be beneath the path of @manager, to the
+ * objects returned by the GetManagedObjects method of @manager and emits
+ * the InterfacesAdded signal with the values of all of its properties.
+ * The NIH_DBUS_OBJECT_NOT_BENEATH error is raised for any other object,
+ * including @manager itself.
+ *
+ * @object is removed again when it is freed, or by calling
+ * nih_dbus_object_manager_remove().
+ *
+ * Managed objects are identified by their path, since that's what
+ * GetManagedObjects returns; adding an object at a path that has already
+ * been added, whether the same object or another one, does nothing.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_object_manager_add (NihDBusObject *manager,
+			     NihDBusObject *object)
+{
+	NihDBusObjectManager *     state;
+	NihDBusObjectManagerEntry *entry;
+
+	nih_assert (manager != NULL);
+	nih_assert (manager->interfaces == nih_dbus_object_manager_interfaces);
+	nih_assert (object != NULL);
+
+	state = manager->data;
+
+	if (! nih_dbus_object_manager_beneath (manager->path, object->path))
+		nih_return_error (-1, NIH_DBUS_OBJECT_NOT_BENEATH,
+				  _(NIH_DBUS_OBJECT_NOT_BENEATH_STR));
+
+	if (nih_hash_lookup (state->objects, object->path))
+		return 0;
+
+	/* Add the entry before emitting the signal, so that a client that
+	 * calls GetManagedObjects on receiving it will find the object;
+	 * and so that nothing is announced that we couldn't then manage.
+	 */
+	entry = nih_new (object, NihDBusObjectManagerEntry);
+	if (! entry)
+		nih_return_no_memory_error (-1);
+
+	nih_list_init (&entry->entry);
+	entry->path = object->path;
+	entry->object = object;
+	entry->manager = state;
+	entry->removed = FALSE;
+
+	nih_alloc_set_destructor (entry, nih_dbus_object_manager_entry_destroy);
+
+	nih_hash_add (state->objects, &entry->entry);
+
+	if (nih_dbus_object_manager_interfaces_added (state, object) < 0) {
+		entry->removed = TRUE;
+		nih_free (entry);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * nih_dbus_object_manager_beneath:
+ * @manager_path: path of object manager,
+ * @path: path of object.
+ *
+ * Returns: TRUE if @path is beneath @manager_path, FALSE otherwise.
+ **/
+static int
+nih_dbus_object_manager_beneath (const char *manager_path,
+				 const char *path)
+{
+	size_t len;
+
+	nih_assert (manager_path != NULL);
+	nih_assert (path != NULL);
+
+	/* Everything but the root itself is beneath the root, which is
+	 * the only path that ends in a slash.
+	 */
+	if (! strcmp (manager_path, "/"))
+		return strcmp (path, "/") ? TRUE : FALSE;
+
+	len = strlen (manager_path);
+
+	return ((! strncmp (path, manager_path, len))
+		&& (path[len] == '/')) ? TRUE : FALSE;
+}
+
+/**
+ * nih_dbus_object_manager_remove:
+ * @manager: object manager,
+ * @object: object to remove.
+ *
+ * Removes @object from the objects returned by the GetManagedObjects
+ * method of @manager and emits the InterfacesRemoved signal.  Removing an
+ * object that was not added does nothing.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_object_manager_remove (NihDBusObject *manager,
+				NihDBusObject *object)
+{
+	NihDBusObjectManager *     state;
+	NihDBusObjectManagerEntry *entry;
+
+	nih_assert (manager != NULL);
+	nih_assert (manager->interfaces == nih_dbus_object_manager_interfaces);
+	nih_assert (object != NULL);
+
+	state = manager->data;
+
+	entry = (NihDBusObjectManagerEntry *)nih_hash_lookup (state->objects,
+							      object->path);
+	if ((! entry) || (entry->object != object))
+		return 0;
+
+	if (nih_dbus_object_manager_interfaces_removed (state, object) < 0)
+		return -1;
+
+	entry->removed = TRUE;
+	nih_free (entry);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_object_manager_entry_destroy:
+ * @entry: entry being destroyed.
+ *
+ * Destructor function for an NihDBusObjectManagerEntry structure, ensures
+ * that it is removed from the object manager and, when its object is
+ * freed while still managed, emits the InterfacesRemoved signal.
+ *
+ * The signal is not emitted once the connection has been disconnected,
+ * since the object is being freed because of it.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_object_manager_entry_destroy (NihDBusObjectManagerEntry *entry)
+{
+	nih_assert (entry != NULL);
+
+	nih_list_destroy (&entry->entry);
+
+	if ((! entry->removed) && (! entry->manager->freeing)
+	    && dbus_connection_get_is_connected (
+		    entry->manager->object->connection)) {
+		nih_error_push_context ();
+		if (nih_dbus_object_manager_interfaces_removed (
+			    entry->manager, entry->object) < 0) {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_warn ("%s: %s", _("Unable to emit InterfacesRemoved signal"),
+				  err->message);
+			nih_free (err);
+		}
+		nih_error_pop_context ();
+	}
+
+	return 0;
+}
+
+
+/**
+ * nih_dbus_object_manager_get_managed_objects:
+ * @object: object manager,
+ * @message: method call message.
+ *
+ * Handles the GetManagedObjects method, replying with a dictionary of
+ * the path of each managed object to a dictionary of its interfaces and
+ * the values of their properties.
+ *
+ * Returns: result of handling the message.
+ **/
+static DBusHandlerResult
+nih_dbus_object_manager_get_managed_objects (NihDBusObject * object,
+					     NihDBusMessage *message)
+{
+	NihDBusObjectManager *manager;
+	DBusMessage *         reply;
+	DBusMessageIter       iter;
+	DBusMessageIter       arrayiter;
+
+	nih_assert (object != NULL);
+	nih_assert (message != NULL);
+
+	manager = object->data;
+
+	/* Make sure the message signature was what we expected */
+	if (! dbus_message_has_signature (message->message, "")) {
+		reply = dbus_message_new_error (message->message,
+						DBUS_ERROR_INVALID_ARGS,
+						_("Invalid arguments to GetManagedObjects method"));
+		if (! reply)
+			return DBUS_HANDLER_RESULT_NEED_MEMORY;
+
+		goto reply;
+	}
+
+	reply = dbus_message_new_method_return (message->message);
+	if (! reply)
+		return DBUS_HANDLER_RESULT_NEED_MEMORY;
+
+	dbus_message_iter_init_append (reply, &iter);
+
+	if (! dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+						(DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						 DBUS_TYPE_OBJECT_PATH_AS_STRING
+						 DBUS_TYPE_ARRAY_AS_STRING
+						 DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						 DBUS_TYPE_STRING_AS_STRING
+						 DBUS_TYPE_ARRAY_AS_STRING
+						 DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						 DBUS_TYPE_STRING_AS_STRING
+						 DBUS_TYPE_VARIANT_AS_STRING
+						 DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+						 DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+						 DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+						&arrayiter)) {
+		dbus_message_unref (reply);
+		return DBUS_HANDLER_RESULT_NEED_MEMORY;
+	}
+
+	NIH_HASH_FOREACH (manager->objects, hash_iter) {
+		NihDBusObjectManagerEntry *entry = (NihDBusObjectManagerEntry *)hash_iter;
+		DBusMessageIter            dictiter;
+		int                        ret;
+
+		if (! dbus_message_iter_open_container (&arrayiter,
+							DBUS_TYPE_DICT_ENTRY,
+							NULL, &dictiter)) {
+			dbus_message_iter_abandon_container (&iter, &arrayiter);
+			dbus_message_unref (reply);
+			return DBUS_HANDLER_RESULT_NEED_MEMORY;
+		}
+
+		if (! dbus_message_iter_append_basic (&dictiter,
+						      DBUS_TYPE_OBJECT_PATH,
+						      &entry->object->path)) {
+			dbus_message_iter_abandon_container (&arrayiter, &dictiter);
+			dbus_message_iter_abandon_container (&iter, &arrayiter);
+			dbus_message_unref (reply);
+			return DBUS_HANDLER_RESULT_NEED_MEMORY;
+		}
+
+		nih_error_push_context ();
+		ret = nih_dbus_object_manager_append_interfaces (entry->object,
+								 message,
+								 &dictiter);
+		if (ret < 0) {
+			NihError *err;
+
+			dbus_message_iter_abandon_container (&arrayiter, &dictiter);
+			dbus_message_iter_abandon_container (&iter, &arrayiter);
+			dbus_message_unref (reply);
+
+			err = nih_error_get ();
+			if (err->number == ENOMEM) {
+				nih_free (err);
+				nih_error_pop_context ();
+
+				return DBUS_HANDLER_RESULT_NEED_MEMORY;
+			} else if (err->number == NIH_DBUS_ERROR) {
+				NihDBusError *dbus_err = (NihDBusError *)err;
+
+				reply = NIH_MUST (dbus_message_new_error (
+							  message->message,
+							  dbus_err->name,
+							  dbus_err->message));
+				nih_free (err);
+				nih_error_pop_context ();
+			} else {
+				reply = NIH_MUST (dbus_message_new_error (
+							  message->message,
+							  DBUS_ERROR_FAILED,
+							  err->message));
+				nih_free (err);
+				nih_error_pop_context ();
+			}
+
+			goto reply;
+		}
+		nih_error_pop_context ();
+
+		if (! dbus_message_iter_close_container (&arrayiter, &dictiter)) {
+			dbus_message_iter_abandon_container (&iter, &arrayiter);
+			dbus_message_unref (reply);
+			return DBUS_HANDLER_RESULT_NEED_MEMORY;
+		}
+	}
+
+	if (! dbus_message_iter_close_container (&iter, &arrayiter)) {
+		dbus_message_unref (reply);
+		return DBUS_HANDLER_RESULT_NEED_MEMORY;
+	}
+
+reply:
+	if (! dbus_connection_send (message->connection, reply, NULL)) {
+		dbus_message_unref (reply);
+		return DBUS_HANDLER_RESULT_NEED_MEMORY;
+	}
+
+	dbus_message_unref (reply);
+
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/**
+ * nih_dbus_object_manager_append_interfaces:
+ * @object: managed object,
+ * @message: message being handled,
+ * @iter: iterator to append to.
+ *
+ * Appends a dictionary of the name of each of the interfaces of @object
+ * to a dictionary of the values of its properties to @iter.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_dbus_object_manager_append_interfaces (NihDBusObject *  object,
+					   NihDBusMessage * message,
+					   DBusMessageIter *iter)
+{
+	const NihDBusInterface **interface;
+	DBusMessageIter          arrayiter;
+
+	nih_assert (object != NULL);
+	nih_assert (message != NULL);
+	nih_assert (iter != NULL);
+
+	if (! dbus_message_iter_open_container (iter, DBUS_TYPE_ARRAY,
+						(DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						 DBUS_TYPE_STRING_AS_STRING
+						 DBUS_TYPE_ARRAY_AS_STRING
+						 DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						 DBUS_TYPE_STRING_AS_STRING
+						 DBUS_TYPE_VARIANT_AS_STRING
+						 DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+						 DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+						&arrayiter))
+		nih_return_no_memory_error (-1);
+
+	for (interface = object->interfaces; interface && *interface;
+	     interface++) {
+		DBusMessageIter dictiter;
+
+		if (! dbus_message_iter_open_container (&arrayiter,
+							DBUS_TYPE_DICT_ENTRY,
+							NULL, &dictiter)) {
+			dbus_message_iter_abandon_container (iter, &arrayiter);
+			nih_return_no_memory_error (-1);
+		}
+
+		if (! dbus_message_iter_append_basic (&dictiter,
+						      DBUS_TYPE_STRING,
+						      &(*interface)->name)) {
+			dbus_message_iter_abandon_container (&arrayiter, &dictiter);
+			dbus_message_iter_abandon_container (iter, &arrayiter);
+			nih_return_no_memory_error (-1);
+		}
+
+		if (nih_dbus_object_append_properties (object, message,
+						       *interface,
+						       &dictiter) < 0) {
+			dbus_message_iter_abandon_container (&arrayiter, &dictiter);
+			dbus_message_iter_abandon_container (iter, &arrayiter);
+			return -1;
+		}
+
+		if (! dbus_message_iter_close_container (&arrayiter, &dictiter)) {
+			dbus_message_iter_abandon_container (iter, &arrayiter);
+			nih_return_no_memory_error (-1);
+		}
+	}
+
+	if (! dbus_message_iter_close_container (iter, &arrayiter))
+		nih_return_no_memory_error (-1);
+
+	return 0;
+}
+
+
+/**
+ * nih_dbus_object_manager_interfaces_added:
+ * @manager: object manager,
+ * @object: object added.
+ *
+ * Emits the InterfacesAdded signal from @manager for @object, with the
+ * values of all of its properties.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_dbus_object_manager_interfaces_added (NihDBusObjectManager *manager,
+					  NihDBusObject *       object)
+{
+	nih_local NihDBusMessage *msg = NULL;
+	DBusMessage *             signal;
+	DBusMessageIter           iter;
+
+	nih_assert (manager != NULL);
+	nih_assert (object != NULL);
+
+	signal = dbus_message_new_signal (manager->object->path,
+					  NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+					  "InterfacesAdded");
+	if (! signal)
+		nih_return_no_memory_error (-1);
+
+	/* The getters are passed the signal being emitted, since there is
+	 * no message being replied to.
+	 */
+	msg = nih_dbus_message_new (NULL, manager->object->connection, signal);
+	if (! msg) {
+		dbus_message_unref (signal);
+		nih_return_no_memory_error (-1);
+	}
+
+	dbus_message_iter_init_append (signal, &iter);
+
+	if (! dbus_message_iter_append_basic (&iter, DBUS_TYPE_OBJECT_PATH,
+					      &object->path)) {
+		dbus_message_unref (signal);
+		nih_return_no_memory_error (-1);
+	}
+
+	if (nih_dbus_object_manager_append_interfaces (object, msg,
+						       &iter) < 0) {
+		dbus_message_unref (signal);
+		return -1;
+	}
+
+	if (! dbus_connection_send (manager->object->connection, signal, NULL)) {
+		dbus_message_unref (signal);
+		nih_return_no_memory_error (-1);
+	}
+
+	dbus_message_unref (signal);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_object_manager_interfaces_removed:
+ * @manager: object manager,
+ * @object: object removed.
+ *
+ * Emits the InterfacesRemoved signal from @manager for @object.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_dbus_object_manager_interfaces_removed (NihDBusObjectManager *manager,
+					    NihDBusObject *       object)
+{
+	const NihDBusInterface **interface;
+	DBusMessage *            signal;
+	DBusMessageIter          iter;
+	DBusMessageIter          arrayiter;
+
+	nih_assert (manager != NULL);
+	nih_assert (object != NULL);
+
+	signal = dbus_message_new_signal (manager->object->path,
+					  NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+					  "InterfacesRemoved");
+	if (! signal)
+		nih_return_no_memory_error (-1);
+
+	dbus_message_iter_init_append (signal, &iter);
+
+	if (! dbus_message_iter_append_basic (&iter, DBUS_TYPE_OBJECT_PATH,
+					      &object->path))
+		goto error;
+
+	if (! dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+						DBUS_TYPE_STRING_AS_STRING,
+						&arrayiter))
+		goto error;
+
+	for (interface = object->interfaces; interface && *interface;
+	     interface++) {
+		if (! dbus_message_iter_append_basic (&arrayiter,
+						      DBUS_TYPE_STRING,
+						      &(*interface)->name)) {
+			dbus_message_iter_abandon_container (&iter, &arrayiter);
+			goto error;
+		}
+	}
+
+	if (! dbus_message_iter_close_container (&iter, &arrayiter))
+		goto error;
+
+	if (! dbus_connection_send (manager->object->connection, signal, NULL))
+		goto error;
+
+	dbus_message_unref (signal);
+
+	return 0;
+
+error:
+	dbus_message_unref (signal);
+	nih_return_no_memory_error (-1);
+}
@@ -0,0 +1,71 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef NIH_DBUS_OBJECT_MANAGER_H
+#define NIH_DBUS_OBJECT_MANAGER_H
+
+/**
+ * An object manager implements the org.freedesktop.DBus.ObjectManager
+ * interface so that clients may retrieve every object beneath it, with
+ * the values of all of their properties, in a single GetManagedObjects
+ * call rather than introspecting each object and calling GetAll for each
+ * of its interfaces:
+ *
+ *	manager = nih_dbus_object_manager_new (NULL, connection, "/com/example");
+ *	object = nih_dbus_object_new (NULL, connection, "/com/example/foo",
+ *				      foo_interfaces, foo);
+ *	nih_dbus_object_manager_add (manager, object);
+ *
+ * Adding objects to the manager emits the InterfacesAdded signal, and
+ * removing them, or freeing them, emits the InterfacesRemoved signal so
+ * that clients may keep their copy up to date.
+ **/
+
+#include <nih/macros.h>
+
+#include <nih-dbus/dbus_object.h>
+
+#include <dbus/dbus.h>
+
+
+/**
+ * NIH_DBUS_OBJECT_MANAGER_INTERFACE:
+ *
+ * Name of the interface implemented by object managers.
+ **/
+#define NIH_DBUS_OBJECT_MANAGER_INTERFACE "org.freedesktop.DBus.ObjectManager"
+
+
+NIH_BEGIN_EXTERN
+
+NihDBusObject *nih_dbus_object_manager_new    (const void *parent,
+					       DBusConnection *connection,
+					       const char *path)
+	__attribute__ ((warn_unused_result, malloc));
+
+int            nih_dbus_object_manager_add    (NihDBusObject *manager,
+					       NihDBusObject *object)
+	__attribute__ ((warn_unused_result));
+int            nih_dbus_object_manager_remove (NihDBusObject *manager,
+					       NihDBusObject *object)
+	__attribute__ ((warn_unused_result));
+
+NIH_END_EXTERN
+
+#endif /* NIH_DBUS_OBJECT_MANAGER_H */
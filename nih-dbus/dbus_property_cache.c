@@ -0,0 +1,803 @@
+/* libnih
+ *
+ * dbus_property_cache.c - D-Bus proxy property caches
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <dbus/dbus.h>
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_error.h>
+#include <nih-dbus/errors.h>
+#include <nih-dbus/dbus_proxy.h>
+
+#include "dbus_property_cache.h"
+
+
+/* Prototypes for static functions */
+static int   nih_dbus_property_cache_destroy (NihDBusPropertyCache *cache);
+static int   nih_dbus_property_cache_index   (NihDBusPropertyCache *cache,
+					      const char *name);
+static int   nih_dbus_property_cache_fetch   (NihDBusPropertyCache *cache)
+	__attribute__ ((warn_unused_result));
+static void  nih_dbus_property_cache_refetch (NihDBusPropertyCache *cache);
+static void  nih_dbus_property_cache_drop    (NihDBusPropertyCache *cache);
+static int   nih_dbus_property_cache_store   (NihDBusPropertyCache *cache,
+					      DBusMessageIter *dictiter);
+static char *nih_dbus_property_cache_rule    (const void *parent,
+					      NihDBusPropertyCache *cache)
+	__attribute__ ((warn_unused_result));
+
+/* Prototypes for handler functions */
+static void              nih_dbus_property_cache_reply   (DBusPendingCall *pending_call,
+							  NihDBusPropertyCache *cache);
+static DBusHandlerResult nih_dbus_property_cache_changed (DBusConnection *connection,
+							  DBusMessage *message,
+							  NihDBusPropertyCache *cache);
+
+
+/**
+ * nih_dbus_property_cache_new:
+ * @proxy: proxy for remote object,
+ * @interface: name of interface,
+ * @names: NULL-terminated array of property names,
+ * @size: size of structure holding property values,
+ * @update: function to store a new property value,
+ * @handler: optional handler for changed values,
+ * @data: data to pass to @handler.
+ *
+ * Creates a new cache for the values of the properties @names of
+ * @interface on the remote object proxied by @proxy, held in a zeroed
+ * structure of @size bytes whose members are set by @update.
+ *
+ * An asynchronous GetAll call is made to obtain the initial values, they
+ * are available from the cache once the connection has been dispatched
+ * and the reply received.
+ *
+ * The cache connects to the PropertiesChanged signal of the remote
+ * object, storing changed values with @update and refetching invalidated
+ * ones, then calling @handler once for each property named in the signal.
+ *
+ * @names is not copied, and must remain valid for the life of the cache;
+ * it is normally a static array in generated code.
+ *
+ * The cache is allocated as a child of @proxy so that it is freed along
+ * with it, it may also be freed directly.
+ *
+ * Returns: newly allocated NihDBusPropertyCache structure or NULL on
+ * raised error.
+ **/
+NihDBusPropertyCache *
+nih_dbus_property_cache_new (NihDBusProxy *              proxy,
+			     const char *                interface,
+			     const char * const *        names,
+			     size_t                      size,
+			     NihDBusPropertyCacheUpdate  update,
+			     NihDBusPropertyCacheHandler handler,
+			     void *                      data)
+{
+	NihDBusPropertyCache *cache;
+	nih_local char *      rule = NULL;
+	DBusError             dbus_error;
+	size_t                count;
+
+	nih_assert (proxy != NULL);
+	nih_assert (interface != NULL);
+	nih_assert (names != NULL);
+	nih_assert (size > 0);
+	nih_assert (update != NULL);
+
+	cache = nih_new (proxy, NihDBusPropertyCache);
+	if (! cache)
+		nih_return_no_memory_error (NULL);
+
+	cache->proxy = proxy;
+
+	cache->interface = nih_strdup (cache, interface);
+	if (! cache->interface) {
+		nih_free (cache);
+		nih_return_no_memory_error (NULL);
+	}
+
+	for (count = 0; names[count]; count++)
+		;
+
+	cache->names = names;
+	cache->valid = nih_alloc (cache, sizeof (int) * (count + 1));
+	if (! cache->valid) {
+		nih_free (cache);
+		nih_return_no_memory_error (NULL);
+	}
+
+	memset (cache->valid, 0, sizeof (int) * (count + 1));
+
+	cache->properties = nih_alloc (cache, size);
+	if (! cache->properties) {
+		nih_free (cache);
+		nih_return_no_memory_error (NULL);
+	}
+
+	memset (cache->properties, 0, size);
+
+	cache->update = update;
+	cache->pending_call = NULL;
+
+	cache->handler = handler;
+	cache->data = data;
+
+	if (! dbus_connection_add_filter (cache->proxy->connection,
+					  (DBusHandleMessageFunction)nih_dbus_property_cache_changed,
+					  cache, NULL)) {
+		nih_free (cache);
+		nih_return_no_memory_error (NULL);
+	}
+
+	if (cache->proxy->name) {
+		rule = nih_dbus_property_cache_rule (NULL, cache);
+		if (! rule) {
+			nih_error_raise_no_memory ();
+			goto error;
+		}
+
+		dbus_error_init (&dbus_error);
+
+		dbus_bus_add_match (cache->proxy->connection, rule, &dbus_error);
+		if (dbus_error_is_set (&dbus_error)) {
+			if (dbus_error_has_name (&dbus_error, DBUS_ERROR_NO_MEMORY)) {
+				nih_error_raise_no_memory ();
+			} else {
+				nih_dbus_error_raise (dbus_error.name,
+						      dbus_error.message);
+			}
+
+			dbus_error_free (&dbus_error);
+			goto error;
+		}
+	}
+
+	nih_alloc_set_destructor (cache, nih_dbus_property_cache_destroy);
+
+	/* Values are only ever obtained asynchronously, so kick off the
+	 * first GetAll now rather than waiting for the first read.
+	 */
+	if (nih_dbus_property_cache_fetch (cache) < 0) {
+		nih_free (cache);
+		return NULL;
+	}
+
+	return cache;
+
+error:
+	dbus_connection_remove_filter (cache->proxy->connection,
+				       (DBusHandleMessageFunction)nih_dbus_property_cache_changed,
+				       cache);
+	nih_free (cache);
+
+	return NULL;
+}
+
+/**
+ * nih_dbus_property_cache_destroy:
+ * @cache: property cache being destroyed.
+ *
+ * Destructor function for an NihDBusPropertyCache structure; cancels any
+ * outstanding GetAll call and drops the bus rule matching the
+ * PropertiesChanged signal and the associated filter function.
+ *
+ * Returns: always zero.
+ **/
+static int
+nih_dbus_property_cache_destroy (NihDBusPropertyCache *cache)
+{
+	nih_local char *rule = NULL;
+	DBusError       dbus_error;
+
+	nih_assert (cache != NULL);
+
+	if (cache->pending_call) {
+		dbus_pending_call_cancel (cache->pending_call);
+		dbus_pending_call_unref (cache->pending_call);
+		cache->pending_call = NULL;
+	}
+
+	if (cache->proxy->name) {
+		rule = NIH_MUST (nih_dbus_property_cache_rule (NULL, cache));
+
+		dbus_error_init (&dbus_error);
+		dbus_bus_remove_match (cache->proxy->connection,
+				       rule, &dbus_error);
+		dbus_error_free (&dbus_error);
+	}
+
+	dbus_connection_remove_filter (cache->proxy->connection,
+				       (DBusHandleMessageFunction)nih_dbus_property_cache_changed,
+				       cache);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_property_cache_rule:
+ * @parent: parent object for new string,
+ * @cache: property cache.
+ *
+ * Generates a D-Bus match rule for the PropertiesChanged signal of the
+ * interface held in @cache.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the returned string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL on insufficient memory.
+ **/
+static char *
+nih_dbus_property_cache_rule (const void *          parent,
+			      NihDBusPropertyCache *cache)
+{
+	char *rule;
+
+	nih_assert (cache != NULL);
+	nih_assert (cache->proxy->name != NULL);
+
+	rule = nih_sprintf (parent, ("type='%s',sender='%s',path='%s',"
+				     "interface='%s',member='%s',arg0='%s'"),
+			    "signal",
+			    cache->proxy->name,
+			    cache->proxy->path,
+			    DBUS_INTERFACE_PROPERTIES,
+			    "PropertiesChanged",
+			    cache->interface);
+
+	return rule;
+}
+
+/**
+ * nih_dbus_property_cache_index:
+ * @cache: property cache,
+ * @name: name of property.
+ *
+ * Looks up the property @name in the list of properties held in @cache.
+ *
+ * Returns: index into @cache's names and valid arrays, or -1 if @name
+ * is not a cached property.
+ **/
+static int
+nih_dbus_property_cache_index (NihDBusPropertyCache *cache,
+			       const char *          name)
+{
+	int i;
+
+	nih_assert (cache != NULL);
+	nih_assert (name != NULL);
+
+	for (i = 0; cache->names[i]; i++)
+		if (! strcmp (cache->names[i], name))
+			return i;
+
+	return -1;
+}
+
+
+/**
+ * nih_dbus_property_cache_lookup:
+ * @cache: property cache,
+ * @name: name of property.
+ *
+ * Checks that @cache holds a value for the property @name, returning the
+ * structure holding the property values so that the caller may read the
+ * member for it.  No communication with the remote object takes place,
+ * this function returns immediately.
+ *
+ * When the value has not been received yet, or was invalidated by the
+ * remote object, the NIH_DBUS_PROPERTY_NOT_CACHED error is raised; a
+ * GetAll call is made to refetch the values if one is not already
+ * outstanding.
+ *
+ * The returned structure belongs to the cache, as do any values within
+ * it; a value is only valid until the property next changes, which can
+ * happen whenever the connection is dispatched.  Take a reference to it
+ * with nih_ref() to keep it for longer.
+ *
+ * Returns: structure holding property values or NULL on raised error.
+ **/
+void *
+nih_dbus_property_cache_lookup (NihDBusPropertyCache *cache,
+				const char *          name)
+{
+	int i;
+
+	nih_assert (cache != NULL);
+	nih_assert (name != NULL);
+
+	i = nih_dbus_property_cache_index (cache, name);
+	nih_assert (i >= 0);
+
+	if (! cache->valid[i]) {
+		if (nih_dbus_property_cache_fetch (cache) < 0)
+			return NULL;
+
+		nih_return_error (NULL, NIH_DBUS_PROPERTY_NOT_CACHED,
+				  _(NIH_DBUS_PROPERTY_NOT_CACHED_STR));
+	}
+
+	return cache->properties;
+}
+
+/**
+ * nih_dbus_property_cache_get:
+ * @cache: property cache,
+ * @properties: pointer to store property values in.
+ *
+ * Obtains the values of all of the properties held in @cache, storing
+ * the structure containing them in @properties.  No communication with
+ * the remote object takes place, this function returns immediately.
+ *
+ * When the cache does not hold a value for every property, the
+ * NIH_DBUS_PROPERTY_NOT_CACHED error is raised; a GetAll call is made to
+ * refetch the values if one is not already outstanding.
+ *
+ * The returned structure belongs to the cache, as do the values within
+ * it; see nih_dbus_property_cache_lookup().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_property_cache_get (NihDBusPropertyCache *cache,
+			     void **               properties)
+{
+	int i;
+
+	nih_assert (cache != NULL);
+	nih_assert (properties != NULL);
+
+	for (i = 0; cache->names[i]; i++) {
+		if (cache->valid[i])
+			continue;
+
+		if (nih_dbus_property_cache_fetch (cache) < 0)
+			return -1;
+
+		nih_return_error (-1, NIH_DBUS_PROPERTY_NOT_CACHED,
+				  _(NIH_DBUS_PROPERTY_NOT_CACHED_STR));
+	}
+
+	*properties = cache->properties;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_property_cache_invalidate:
+ * @cache: property cache.
+ *
+ * Marks all of the values held in @cache as invalid and refetches them
+ * with an asynchronous GetAll call, calling the handler function with a
+ * NULL property name.
+ **/
+void
+nih_dbus_property_cache_invalidate (NihDBusPropertyCache *cache)
+{
+	nih_assert (cache != NULL);
+
+	nih_dbus_property_cache_drop (cache);
+	nih_dbus_property_cache_refetch (cache);
+
+	if (cache->handler) {
+		nih_error_push_context ();
+		cache->handler (cache->data, cache, NULL);
+		nih_error_pop_context ();
+	}
+}
+
+/**
+ * nih_dbus_property_cache_drop:
+ * @cache: property cache.
+ *
+ * Marks all of the values held in @cache as invalid and cancels any
+ * outstanding GetAll call, since its reply may be from a previous owner
+ * of the proxied name.  The values themselves are kept in the structure
+ * until replaced, so that references the caller holds remain valid.
+ **/
+static void
+nih_dbus_property_cache_drop (NihDBusPropertyCache *cache)
+{
+	int i;
+
+	nih_assert (cache != NULL);
+
+	for (i = 0; cache->names[i]; i++)
+		cache->valid[i] = FALSE;
+
+	if (cache->pending_call) {
+		dbus_pending_call_cancel (cache->pending_call);
+		dbus_pending_call_unref (cache->pending_call);
+		cache->pending_call = NULL;
+	}
+}
+
+
+/**
+ * nih_dbus_property_cache_fetch:
+ * @cache: property cache.
+ *
+ * Makes an asynchronous GetAll call to the remote object to obtain the
+ * values of all of the properties held in @cache, unless one is already
+ * outstanding.  The values are stored by nih_dbus_property_cache_reply()
+ * when the reply is received.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_dbus_property_cache_fetch (NihDBusPropertyCache *cache)
+{
+	DBusMessage *    method_call;
+	DBusMessageIter  iter;
+	DBusPendingCall *pending_call;
+	const char *     interface;
+
+	nih_assert (cache != NULL);
+
+	if (cache->pending_call)
+		return 0;
+
+	method_call = dbus_message_new_method_call (cache->proxy->name,
+						    cache->proxy->path,
+						    DBUS_INTERFACE_PROPERTIES,
+						    "GetAll");
+	if (! method_call)
+		nih_return_no_memory_error (-1);
+
+	dbus_message_set_auto_start (method_call, cache->proxy->auto_start);
+
+	dbus_message_iter_init_append (method_call, &iter);
+
+	interface = cache->interface;
+	if (! dbus_message_iter_append_basic (&iter, DBUS_TYPE_STRING,
+					      &interface)) {
+		dbus_message_unref (method_call);
+		nih_return_no_memory_error (-1);
+	}
+
+	pending_call = NULL;
+	if (! dbus_connection_send_with_reply (cache->proxy->connection,
+					       method_call, &pending_call,
+					       -1)) {
+		dbus_message_unref (method_call);
+		nih_return_no_memory_error (-1);
+	}
+
+	dbus_message_unref (method_call);
+
+	if (! pending_call) {
+		nih_dbus_error_raise (DBUS_ERROR_DISCONNECTED,
+				      "Connection is closed");
+		return -1;
+	}
+
+	if (! dbus_pending_call_set_notify (pending_call,
+					    (DBusPendingCallNotifyFunction)nih_dbus_property_cache_reply,
+					    cache, NULL)) {
+		dbus_pending_call_cancel (pending_call);
+		dbus_pending_call_unref (pending_call);
+		nih_return_no_memory_error (-1);
+	}
+
+	cache->pending_call = pending_call;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_property_cache_refetch:
+ * @cache: property cache.
+ *
+ * Calls nih_dbus_property_cache_fetch() from a context where an error
+ * cannot be returned; the error is logged and discarded, the next read
+ * of a missing value tries again.
+ **/
+static void
+nih_dbus_property_cache_refetch (NihDBusPropertyCache *cache)
+{
+	NihError *err;
+
+	nih_assert (cache != NULL);
+
+	if (nih_dbus_property_cache_fetch (cache) < 0) {
+		err = nih_error_get ();
+		nih_debug ("Unable to refetch %s properties: %s",
+			   cache->interface, err->message);
+		nih_free (err);
+	}
+}
+
+/**
+ * nih_dbus_property_cache_store:
+ * @cache: property cache,
+ * @dictiter: iterator for dictionary entry.
+ *
+ * Stores the property value in the dictionary entry pointed to by
+ * @dictiter in @cache, marking it valid.  Entries for properties that
+ * are not cached are ignored.  When the value cannot be stored, the
+ * property is left invalid and the error discarded.
+ *
+ * Returns: index of stored property, -1 if none was stored or -2 if the
+ * entry was malformed.
+ **/
+static int
+nih_dbus_property_cache_store (NihDBusPropertyCache *cache,
+			       DBusMessageIter *     dictiter)
+{
+	DBusMessageIter entryiter;
+	const char *    name;
+	int             i;
+	NihError *      err;
+
+	nih_assert (cache != NULL);
+	nih_assert (dictiter != NULL);
+
+	if (dbus_message_iter_get_arg_type (dictiter) != DBUS_TYPE_DICT_ENTRY)
+		return -2;
+
+	dbus_message_iter_recurse (dictiter, &entryiter);
+
+	if (dbus_message_iter_get_arg_type (&entryiter) != DBUS_TYPE_STRING)
+		return -2;
+
+	dbus_message_iter_get_basic (&entryiter, &name);
+	dbus_message_iter_next (&entryiter);
+
+	i = nih_dbus_property_cache_index (cache, name);
+	if (i < 0)
+		return -1;
+
+	if (cache->update (cache->properties, name, &entryiter) < 0) {
+		err = nih_error_get ();
+		nih_debug ("Unable to store %s property %s: %s",
+			   cache->interface, name, err->message);
+		nih_free (err);
+
+		cache->valid[i] = FALSE;
+		return -1;
+	}
+
+	cache->valid[i] = TRUE;
+
+	return i;
+}
+
+
+/**
+ * nih_dbus_property_cache_reply:
+ * @pending_call: pending call that has completed,
+ * @cache: property cache.
+ *
+ * This function is called by D-Bus when the reply to the GetAll call
+ * made by nih_dbus_property_cache_fetch() is received; it stores each of
+ * the returned values in @cache and then calls the handler function
+ * with a NULL property name.
+ *
+ * Error replies leave the values invalid, they will be refetched on the
+ * next read.
+ **/
+static void
+nih_dbus_property_cache_reply (DBusPendingCall *     pending_call,
+			       NihDBusPropertyCache *cache)
+{
+	DBusMessage *   reply;
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+
+	nih_assert (pending_call != NULL);
+	nih_assert (cache != NULL);
+	nih_assert (pending_call == cache->pending_call);
+
+	reply = dbus_pending_call_steal_reply (pending_call);
+	nih_assert (reply != NULL);
+
+	dbus_pending_call_unref (cache->pending_call);
+	cache->pending_call = NULL;
+
+	if (dbus_message_get_type (reply) != DBUS_MESSAGE_TYPE_METHOD_RETURN) {
+		nih_debug ("Unable to obtain %s properties", cache->interface);
+		dbus_message_unref (reply);
+		return;
+	}
+
+	dbus_message_iter_init (reply, &iter);
+
+	if (dbus_message_iter_get_arg_type (&iter) != DBUS_TYPE_ARRAY) {
+		dbus_message_unref (reply);
+		return;
+	}
+
+	dbus_message_iter_recurse (&iter, &arrayiter);
+
+	while (dbus_message_iter_get_arg_type (&arrayiter) != DBUS_TYPE_INVALID) {
+		if (nih_dbus_property_cache_store (cache, &arrayiter) < -1)
+			break;
+
+		dbus_message_iter_next (&arrayiter);
+	}
+
+	dbus_message_unref (reply);
+
+	if (cache->handler) {
+		nih_error_push_context ();
+		cache->handler (cache->data, cache, NULL);
+		nih_error_pop_context ();
+	}
+}
+
+/**
+ * nih_dbus_property_cache_changed:
+ * @connection: D-Bus connection signal received on,
+ * @message: signal message,
+ * @cache: property cache.
+ *
+ * This function is called by D-Bus when a signal is received.
+ *
+ * When the signal is the PropertiesChanged signal for the interface held
+ * in @cache, the changed values are stored in the cache and the
+ * invalidated ones marked as such and refetched with a GetAll call; the
+ * handler function is called for each of them.
+ *
+ * When the signal announces a new owner for the proxied name, all
+ * values are invalidated and refetched from the new owner.
+ *
+ * Returns: usually DBUS_HANDLER_RESULT_NOT_YET_HANDLED so other filters
+ * see the signal.
+ **/
+static DBusHandlerResult
+nih_dbus_property_cache_changed (DBusConnection *      connection,
+				 DBusMessage *         message,
+				 NihDBusPropertyCache *cache)
+{
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+	DBusMessageIter dictiter;
+	const char *    interface;
+	const char *    name;
+	const char *    old_owner;
+	const char *    new_owner;
+	int             refetch = FALSE;
+	int             i;
+
+	nih_assert (connection != NULL);
+	nih_assert (message != NULL);
+	nih_assert (cache != NULL);
+
+	/* A change of owner means a different instance of the service,
+	 * whose properties may have entirely different values.  The proxy
+	 * already asked the bus for these signals.
+	 */
+	if (cache->proxy->name
+	    && dbus_message_is_signal (message, DBUS_INTERFACE_DBUS,
+				       "NameOwnerChanged")
+	    && dbus_message_has_path (message, DBUS_PATH_DBUS)
+	    && dbus_message_has_sender (message, DBUS_SERVICE_DBUS)
+	    && dbus_message_get_args (message, NULL,
+				      DBUS_TYPE_STRING, &name,
+				      DBUS_TYPE_STRING, &old_owner,
+				      DBUS_TYPE_STRING, &new_owner,
+				      DBUS_TYPE_INVALID)
+	    && (! strcmp (name, cache->proxy->name))) {
+		nih_dbus_property_cache_drop (cache);
+		if (strlen (new_owner))
+			nih_dbus_property_cache_refetch (cache);
+
+		if (cache->handler) {
+			nih_error_push_context ();
+			cache->handler (cache->data, cache, NULL);
+			nih_error_pop_context ();
+		}
+
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	}
+
+	if (! dbus_message_is_signal (message, DBUS_INTERFACE_PROPERTIES,
+				      "PropertiesChanged"))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (! dbus_message_has_path (message, cache->proxy->path))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	/* Only the current owner of the name may change the properties;
+	 * when the name has no owner, there's nobody to accept it from.
+	 */
+	if (cache->proxy->name) {
+		if (! cache->proxy->owner)
+			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+		if (! dbus_message_has_sender (message, cache->proxy->owner))
+			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	}
+
+	if (! dbus_message_has_signature (message, "sa{sv}as"))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	dbus_message_iter_init (message, &iter);
+
+	dbus_message_iter_get_basic (&iter, &interface);
+	if (strcmp (interface, cache->interface))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	/* Store the new value of each property that changed, which are
+	 * the following dictionary, calling the handler once it's there.
+	 */
+	dbus_message_iter_next (&iter);
+	dbus_message_iter_recurse (&iter, &arrayiter);
+
+	while (dbus_message_iter_get_arg_type (&arrayiter) == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse (&arrayiter, &dictiter);
+		dbus_message_iter_get_basic (&dictiter, &name);
+
+		i = nih_dbus_property_cache_store (cache, &arrayiter);
+		if ((i < 0) && (nih_dbus_property_cache_index (cache, name) >= 0))
+			refetch = TRUE;
+
+		if (cache->handler) {
+			nih_error_push_context ();
+			cache->handler (cache->data, cache, name);
+			nih_error_pop_context ();
+		}
+
+		dbus_message_iter_next (&arrayiter);
+	}
+
+	/* Mark each property that was invalidated, which are in the
+	 * following array, so that reads fail until the values have been
+	 * refetched.
+	 */
+	dbus_message_iter_next (&iter);
+	dbus_message_iter_recurse (&iter, &arrayiter);
+
+	while (dbus_message_iter_get_arg_type (&arrayiter) == DBUS_TYPE_STRING) {
+		dbus_message_iter_get_basic (&arrayiter, &name);
+
+		i = nih_dbus_property_cache_index (cache, name);
+		if (i >= 0) {
+			cache->valid[i] = FALSE;
+			refetch = TRUE;
+		}
+
+		if (cache->handler) {
+			nih_error_push_context ();
+			cache->handler (cache->data, cache, name);
+			nih_error_pop_context ();
+		}
+
+		dbus_message_iter_next (&arrayiter);
+	}
+
+	if (refetch)
+		nih_dbus_property_cache_refetch (cache);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
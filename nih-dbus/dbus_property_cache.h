@@ -0,0 +1,158 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_DBUS_PROPERTY_CACHE_H
+#define NIH_DBUS_PROPERTY_CACHE_H
+
+/**
+ * A property cache holds the values of all of the properties of one
+ * interface of a proxied remote object, so that clients that frequently
+ * read them need not make a method call for each read.
+ *
+ * The values are obtained with an asynchronous GetAll call when the
+ * cache is created, and kept up to date from the
+ * org.freedesktop.DBus.Properties.PropertiesChanged signal: changed
+ * values are applied to the cache as they arrive, while invalidated
+ * properties are refetched with another asynchronous GetAll call.  Reads
+ * never block; a property whose value has not yet arrived is reported
+ * as not cached.
+ *
+ * Caches are not normally created directly, instead nih-dbus-tool will
+ * generate typed functions for interfaces annotated with
+ * com.netsplit.Nih.PropertyCache.
+ **/
+
+#include <nih/macros.h>
+
+#include <dbus/dbus.h>
+
+#include <nih-dbus/dbus_proxy.h>
+
+
+/**
+ * NihDBusPropertyCache:
+ *
+ * Forward declaration of the property cache structure.
+ **/
+typedef struct nih_dbus_property_cache NihDBusPropertyCache;
+
+/**
+ * NihDBusPropertyCacheUpdate:
+ * @properties: structure holding property values,
+ * @name: name of property,
+ * @iter: message iterator pointing at the new value.
+ *
+ * A property cache update function demarshals the new value of the
+ * property @name from the variant pointed to by @iter, replacing the
+ * value held in the matching member of @properties.  Any previous value
+ * that was allocated is unreferenced from @properties.
+ *
+ * This is normally the _cache_update function generated by nih-dbus-tool
+ * for the interface.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+typedef int (*NihDBusPropertyCacheUpdate) (void *           properties,
+					   const char *     name,
+					   DBusMessageIter *iter);
+
+/**
+ * NihDBusPropertyCacheHandler:
+ * @data: data pointer passed to nih_dbus_property_cache_new(),
+ * @cache: property cache,
+ * @name: name of property.
+ *
+ * A property cache handler is called after the remote object announced
+ * that the property @name has changed, once the new value is in the
+ * cache, or that it has become invalid, in which case the cache no
+ * longer holds a value for it until it has been refetched.
+ *
+ * @name is NULL after the values of all of the properties were replaced
+ * by the reply to a GetAll call, or all were dropped because the owner
+ * of the proxied name changed.
+ *
+ * The handler may read the new values from the cache, but must not free
+ * the cache.
+ **/
+typedef void (*NihDBusPropertyCacheHandler) (void *                data,
+					     NihDBusPropertyCache *cache,
+					     const char *          name);
+
+
+/**
+ * NihDBusPropertyCache:
+ * @proxy: proxy for remote object,
+ * @interface: name of cached interface,
+ * @names: NULL-terminated array of property names,
+ * @valid: whether each of @names has a cached value,
+ * @properties: cached property values,
+ * @update: function to store a new property value,
+ * @pending_call: outstanding GetAll call,
+ * @handler: handler to call when values change,
+ * @data: data to pass to @handler.
+ *
+ * This structure holds the cached values of the properties of
+ * @interface on the object proxied by @proxy.  @properties is always
+ * allocated, but the member for the property @names[i] only holds a
+ * value when @valid[i] is TRUE.
+ *
+ * @pending_call is not NULL while an asynchronous GetAll call to
+ * refetch values is outstanding.
+ *
+ * The cache keeps no copy of the owner of the proxied name; the sender
+ * of each change is checked against the private copy held by @proxy,
+ * and all values are dropped when the bus announces a new owner.
+ *
+ * Property caches are bound to the life cycle of @proxy.
+ **/
+struct nih_dbus_property_cache {
+	NihDBusProxy *              proxy;
+	char *                      interface;
+	const char * const *        names;
+	int *                       valid;
+	void *                      properties;
+	NihDBusPropertyCacheUpdate  update;
+	DBusPendingCall *           pending_call;
+
+	NihDBusPropertyCacheHandler handler;
+	void *                      data;
+};
+
+
+NIH_BEGIN_EXTERN
+
+NihDBusPropertyCache *nih_dbus_property_cache_new        (NihDBusProxy *proxy,
+							  const char *interface,
+							  const char * const *names,
+							  size_t size,
+							  NihDBusPropertyCacheUpdate update,
+							  NihDBusPropertyCacheHandler handler,
+							  void *data)
+	__attribute__ ((warn_unused_result));
+
+void *                nih_dbus_property_cache_lookup     (NihDBusPropertyCache *cache,
+							  const char *name)
+	__attribute__ ((warn_unused_result));
+int                   nih_dbus_property_cache_get        (NihDBusPropertyCache *cache,
+							  void **properties)
+	__attribute__ ((warn_unused_result));
+void                  nih_dbus_property_cache_invalidate (NihDBusPropertyCache *cache);
+
+NIH_END_EXTERN
+
+#endif /* NIH_DBUS_PROPERTY_CACHE_H */
@@ -0,0 +1,604 @@
+/* libnih
+ *
+ * dbus_stats.c - D-Bus statistics object
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <stdint.h>
+
+#include <dbus/dbus.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/timer.h>
+#include <nih/io.h>
+#include <nih/metrics.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_message.h>
+#include <nih-dbus/dbus_object.h>
+
+#include "com.netsplit.Nih.Stats_object.h"
+
+#include "dbus_stats.h"
+
+
+/* Prototypes for static functions */
+static uint32_t nih_dbus_stats_count         (const NihList *list);
+static void *   nih_dbus_stats_element       (void ***array, size_t *len,
+					      const void *parent, size_t size);
+static int      nih_dbus_stats_add_counter   (NihDbusStatsGetSnapshotCountersElement ***counters,
+					      size_t *len, const void *parent,
+					      const char *name, uint64_t value);
+static int      nih_dbus_stats_add_gauge     (NihDbusStatsGetSnapshotGaugesElement ***gauges,
+					      size_t *len, const void *parent,
+					      const char *name, int64_t value);
+static int      nih_dbus_stats_add_histogram (NihDbusStatsGetSnapshotHistogramsElement ***histograms,
+					      size_t *len, const void *parent,
+					      const NihMetricValue *value);
+
+
+/**
+ * nih_dbus_stats_new:
+ * @parent: parent object for new object,
+ * @connection: D-Bus connection to associate with.
+ *
+ * Registers the statistics object on @connection at NIH_DBUS_STATS_PATH,
+ * and enables the collection of metrics since there's little point in
+ * exporting them otherwise.
+ *
+ * The object is unregistered when freed, or when @connection is
+ * disconnected.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned object.  When all parents
+ * of the returned object are freed, the returned object will also be
+ * freed.
+ *
+ * Returns: new NihDBusObject structure on success, or NULL if
+ * insufficient memory.
+ **/
+NihDBusObject *
+nih_dbus_stats_new (const void *    parent,
+		    DBusConnection *connection)
+{
+	NihDBusObject *object;
+
+	nih_assert (connection != NULL);
+
+	object = nih_dbus_object_new (parent, connection, NIH_DBUS_STATS_PATH,
+				      nih_dbus_stats_interfaces, NULL);
+	if (! object)
+		return NULL;
+
+	nih_metrics_enable (TRUE);
+
+	return object;
+}
+
+
+/**
+ * nih_dbus_stats_count:
+ * @list: list to count.
+ *
+ * Returns: number of entries in @list.
+ **/
+static uint32_t
+nih_dbus_stats_count (const NihList *list)
+{
+	uint32_t count = 0;
+
+	nih_assert (list != NULL);
+
+	NIH_LIST_FOREACH (list, iter)
+		count++;
+
+	return count;
+}
+
+
+/**
+ * nih_dbus_stats_get_loop_iterations:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the LoopIterations property, the number of
+ * times the main loop has been run.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_loop_iterations (void *          data,
+				    NihDBusMessage *message,
+				    uint64_t *      value)
+{
+	NihMetricValue metric;
+
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_metric_get ("main_loop_iterations", &metric);
+	*value = metric.value;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_watches:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the Watches property, the number of I/O
+ * watches currently registered.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_watches (void *          data,
+			    NihDBusMessage *message,
+			    uint32_t *      value)
+{
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_io_init ();
+
+	*value = nih_dbus_stats_count (nih_io_watches);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_timers:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the Timers property, the number of timers
+ * currently registered.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_timers (void *          data,
+			   NihDBusMessage *message,
+			   uint32_t *      value)
+{
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_timer_init ();
+
+	*value = nih_dbus_stats_count (nih_timers);
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_alloc_live_bytes:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the AllocLiveBytes property, the total size
+ * of objects allocated with nih_alloc() and not yet freed.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_alloc_live_bytes (void *          data,
+				     NihDBusMessage *message,
+				     uint64_t *      value)
+{
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	*value = nih_alloc_live_bytes ();
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_dispatch_calls:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the DispatchCalls property, the number of
+ * D-Bus method calls dispatched to handlers.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_dispatch_calls (void *          data,
+				   NihDBusMessage *message,
+				   uint64_t *      value)
+{
+	NihMetricValue metric;
+
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_metric_get ("dbus_method_calls", &metric);
+	*value = metric.value;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_dispatch_p50:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the DispatchP50 property, the median time
+ * taken by D-Bus method handlers in nanoseconds.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_dispatch_p50 (void *          data,
+				 NihDBusMessage *message,
+				 uint64_t *      value)
+{
+	NihMetricValue metric;
+
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_metric_get ("dbus_dispatch_ns", &metric);
+	*value = metric.p50;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_dispatch_p90:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the DispatchP90 property, the 90th
+ * percentile of the time taken by D-Bus method handlers in nanoseconds.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_dispatch_p90 (void *          data,
+				 NihDBusMessage *message,
+				 uint64_t *      value)
+{
+	NihMetricValue metric;
+
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_metric_get ("dbus_dispatch_ns", &metric);
+	*value = metric.p90;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_dispatch_p99:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @value: pointer to store value.
+ *
+ * Implements the getter for the DispatchP99 property, the 99th
+ * percentile of the time taken by D-Bus method handlers in nanoseconds.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_dispatch_p99 (void *          data,
+				 NihDBusMessage *message,
+				 uint64_t *      value)
+{
+	NihMetricValue metric;
+
+	nih_assert (message != NULL);
+	nih_assert (value != NULL);
+
+	nih_metric_get ("dbus_dispatch_ns", &metric);
+	*value = metric.p99;
+
+	return 0;
+}
+
+
+/**
+ * nih_dbus_stats_element:
+ * @array: array to append to,
+ * @len: length of @array,
+ * @parent: parent of @array,
+ * @size: size of element.
+ *
+ * Allocates a new element of @size bytes and appends it to the
+ * NULL-terminated array @array which has @len elements, reallocating it
+ * and updating @len.
+ *
+ * Returns: new element, or NULL if insufficient memory.
+ **/
+static void *
+nih_dbus_stats_element (void ***    array,
+			size_t *    len,
+			const void *parent,
+			size_t      size)
+{
+	void **tmp;
+	void * element;
+
+	nih_assert (array != NULL);
+	nih_assert (len != NULL);
+
+	tmp = nih_realloc (*array, parent, sizeof (void *) * (*len + 2));
+	if (! tmp)
+		return NULL;
+
+	*array = tmp;
+
+	element = nih_alloc (*array, size);
+	if (! element)
+		return NULL;
+
+	(*array)[(*len)++] = element;
+	(*array)[*len] = NULL;
+
+	return element;
+}
+
+/**
+ * nih_dbus_stats_add_counter:
+ * @counters: array to append to,
+ * @len: length of @counters,
+ * @parent: parent of @counters,
+ * @name: name of counter,
+ * @value: value of counter.
+ *
+ * Appends an element for the counter @name to @counters.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+static int
+nih_dbus_stats_add_counter (NihDbusStatsGetSnapshotCountersElement ***counters,
+			    size_t *                                  len,
+			    const void *                              parent,
+			    const char *                              name,
+			    uint64_t                                  value)
+{
+	NihDbusStatsGetSnapshotCountersElement *element;
+
+	nih_assert (name != NULL);
+
+	element = nih_dbus_stats_element ((void ***)counters, len, parent,
+					  sizeof (NihDbusStatsGetSnapshotCountersElement));
+	if (! element)
+		return -1;
+
+	element->item0 = nih_strdup (element, name);
+	if (! element->item0)
+		return -1;
+
+	element->item1 = value;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_add_gauge:
+ * @gauges: array to append to,
+ * @len: length of @gauges,
+ * @parent: parent of @gauges,
+ * @name: name of gauge,
+ * @value: value of gauge.
+ *
+ * Appends an element for the gauge @name to @gauges; unlike counters,
+ * gauges may be negative.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+static int
+nih_dbus_stats_add_gauge (NihDbusStatsGetSnapshotGaugesElement ***gauges,
+			  size_t *                                len,
+			  const void *                            parent,
+			  const char *                            name,
+			  int64_t                                 value)
+{
+	NihDbusStatsGetSnapshotGaugesElement *element;
+
+	nih_assert (name != NULL);
+
+	element = nih_dbus_stats_element ((void ***)gauges, len, parent,
+					  sizeof (NihDbusStatsGetSnapshotGaugesElement));
+	if (! element)
+		return -1;
+
+	element->item0 = nih_strdup (element, name);
+	if (! element->item0)
+		return -1;
+
+	element->item1 = value;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_add_histogram:
+ * @histograms: array to append to,
+ * @len: length of @histograms,
+ * @parent: parent of @histograms,
+ * @value: value of histogram.
+ *
+ * Appends an element for the histogram summarised in @value to
+ * @histograms, holding its name followed by the count, sum, min, max,
+ * p50, p90 and p99 fields.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+static int
+nih_dbus_stats_add_histogram (NihDbusStatsGetSnapshotHistogramsElement ***histograms,
+			      size_t *                                    len,
+			      const void *                                parent,
+			      const NihMetricValue *                      value)
+{
+	NihDbusStatsGetSnapshotHistogramsElement *element;
+
+	nih_assert (value != NULL);
+
+	element = nih_dbus_stats_element ((void ***)histograms, len, parent,
+					  sizeof (NihDbusStatsGetSnapshotHistogramsElement));
+	if (! element)
+		return -1;
+
+	element->item0 = nih_strdup (element, value->name);
+	if (! element->item0)
+		return -1;
+
+	element->item1 = value->count;
+	element->item2 = value->sum;
+	element->item3 = value->min;
+	element->item4 = value->max;
+	element->item5 = value->p50;
+	element->item6 = value->p90;
+	element->item7 = value->p99;
+
+	return 0;
+}
+
+/**
+ * nih_dbus_stats_get_snapshot:
+ * @data: not used,
+ * @message: D-Bus message received,
+ * @counters: pointer to store array of counters,
+ * @gauges: pointer to store array of gauges,
+ * @histograms: pointer to store array of histograms.
+ *
+ * Implements the GetSnapshot method, returning the value of every metric
+ * by name in an array for each type so that each keeps its own: counters
+ * are unsigned, gauges are signed and include the live bytes allocated
+ * and the number of timers and watches, and histograms are summarised by
+ * their count, sum, min, max, p50, p90 and p99 fields.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_dbus_stats_get_snapshot (void *                                      data,
+			     NihDBusMessage *                            message,
+			     NihDbusStatsGetSnapshotCountersElement ***  counters,
+			     NihDbusStatsGetSnapshotGaugesElement ***    gauges,
+			     NihDbusStatsGetSnapshotHistogramsElement ***histograms)
+{
+	nih_local NihMetricValue **snapshot = NULL;
+	NihMetricValue **          iter;
+	size_t                     ncounters = 0;
+	size_t                     ngauges = 0;
+	size_t                     nhistograms = 0;
+
+	nih_assert (message != NULL);
+	nih_assert (counters != NULL);
+	nih_assert (gauges != NULL);
+	nih_assert (histograms != NULL);
+
+	*counters = NULL;
+	*gauges = NULL;
+	*histograms = NULL;
+
+	snapshot = nih_metrics_snapshot (NULL);
+	if (! snapshot)
+		goto error;
+
+	nih_io_init ();
+	nih_timer_init ();
+
+	/* Each array must be sent even if it's empty. */
+	*counters = nih_new (message, NihDbusStatsGetSnapshotCountersElement *);
+	*histograms = nih_new (message,
+			       NihDbusStatsGetSnapshotHistogramsElement *);
+	if ((! *counters) || (! *histograms))
+		goto error;
+
+	**counters = NULL;
+	**histograms = NULL;
+
+	if ((nih_dbus_stats_add_gauge (gauges, &ngauges, message,
+				       "alloc_live_bytes",
+				       nih_alloc_live_bytes ()) < 0)
+	    || (nih_dbus_stats_add_gauge (gauges, &ngauges, message, "timers",
+					  nih_dbus_stats_count (nih_timers)) < 0)
+	    || (nih_dbus_stats_add_gauge (gauges, &ngauges, message, "watches",
+					  nih_dbus_stats_count (nih_io_watches)) < 0))
+		goto error;
+
+	for (iter = snapshot; *iter; iter++) {
+		NihMetricValue *value = *iter;
+
+		switch (value->type) {
+		case NIH_METRIC_COUNTER:
+			if (nih_dbus_stats_add_counter (counters, &ncounters,
+							message, value->name,
+							value->value) < 0)
+				goto error;
+
+			break;
+		case NIH_METRIC_GAUGE:
+			if (nih_dbus_stats_add_gauge (gauges, &ngauges,
+						      message, value->name,
+						      value->value) < 0)
+				goto error;
+
+			break;
+		case NIH_METRIC_HISTOGRAM:
+			if (nih_dbus_stats_add_histogram (histograms,
+							  &nhistograms,
+							  message, value) < 0)
+				goto error;
+
+			break;
+		default:
+			nih_assert_not_reached ();
+		}
+	}
+
+	return 0;
+
+error:
+	if (*counters) {
+		nih_free (*counters);
+		*counters = NULL;
+	}
+	if (*gauges) {
+		nih_free (*gauges);
+		*gauges = NULL;
+	}
+	if (*histograms) {
+		nih_free (*histograms);
+		*histograms = NULL;
+	}
+
+	nih_return_no_memory_error (-1);
+}
@@ -0,0 +1,59 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_DBUS_STATS_H
+#define NIH_DBUS_STATS_H
+
+/**
+ * The statistics object exports the library's metrics on a D-Bus
+ * connection so that the performance of a running daemon can be
+ * inspected without attaching a debugger:
+ *
+ *	nih_dbus_stats_new (NULL, connection);
+ *
+ * The object implements the com.netsplit.Nih.Stats interface, described
+ * by com.netsplit.Nih.Stats.xml, with read-only properties for commonly
+ * needed values and a GetSnapshot method returning the value of every
+ * metric by name, with counters, gauges and histograms each in their own
+ * array so that they keep their own types.
+ **/
+
+#include <nih/macros.h>
+
+#include <nih-dbus/dbus_object.h>
+
+#include <dbus/dbus.h>
+
+
+/**
+ * NIH_DBUS_STATS_PATH:
+ *
+ * Path at which the statistics object is registered.
+ **/
+#define NIH_DBUS_STATS_PATH "/com/netsplit/Nih/Stats"
+
+
+NIH_BEGIN_EXTERN
+
+NihDBusObject *nih_dbus_stats_new (const void *parent,
+				   DBusConnection *connection)
+	__attribute__ ((warn_unused_result, malloc));
+
+NIH_END_EXTERN
+
+#endif /* NIH_DBUS_STATS_H */
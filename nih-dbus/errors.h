@@ -32,9 +32,13 @@ enum {
 
 	NIH_DBUS_ERROR,
 	NIH_DBUS_INVALID_ARGS,
+	NIH_DBUS_PROPERTY_NOT_CACHED,
+	NIH_DBUS_OBJECT_NOT_BENEATH,
 };
 
 /* Error strings for defined messages */
 #define NIH_DBUS_INVALID_ARGS_STR	   N_("Invalid arguments received in reply")
+#define NIH_DBUS_PROPERTY_NOT_CACHED_STR   N_("Property value has not been received")
+#define NIH_DBUS_OBJECT_NOT_BENEATH_STR    N_("Object is not beneath the object manager")
 
 #endif /* NIH_DBUS_ERRORS_H */
@@ -22,11 +22,15 @@
 
 #include <nih-dbus/dbus_error.h>
 #include <nih-dbus/dbus_connection.h>
+#include <nih-dbus/dbus_broadcast.h>
 #include <nih-dbus/dbus_message.h>
 #include <nih-dbus/dbus_interface.h>
 #include <nih-dbus/dbus_object.h>
+#include <nih-dbus/dbus_object_manager.h>
 #include <nih-dbus/dbus_pending_data.h>
+#include <nih-dbus/dbus_property_cache.h>
 #include <nih-dbus/dbus_proxy.h>
+#include <nih-dbus/dbus_stats.h>
 #include <nih-dbus/dbus_util.h>
 #include <nih-dbus/errors.h>
 
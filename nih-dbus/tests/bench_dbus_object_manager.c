@@ -0,0 +1,247 @@
+/* libnih
+ *
+ * bench_dbus_object_manager.c - benchmark object manager client sync
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+#include <nih/bench.h>
+#include <nih-dbus/test_dbus.h>
+
+#include <stdio.h>
+
+#include <dbus/dbus.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_object.h>
+#include <nih-dbus/dbus_object_manager.h>
+
+
+/**
+ * NUM_OBJECTS:
+ *
+ * Number of objects exported by the server.
+ **/
+#define NUM_OBJECTS 1000
+
+
+static int
+string_get (NihDBusObject *  object,
+	    NihDBusMessage * message,
+	    DBusMessageIter *iter)
+{
+	DBusMessageIter subiter;
+
+	if (! dbus_message_iter_open_container (iter, DBUS_TYPE_VARIANT,
+						DBUS_TYPE_STRING_AS_STRING,
+						&subiter))
+		nih_return_no_memory_error (-1);
+
+	if (! dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
+					      &object->path))
+		nih_return_no_memory_error (-1);
+
+	if (! dbus_message_iter_close_container (iter, &subiter))
+		nih_return_no_memory_error (-1);
+
+	return 0;
+}
+
+static const NihDBusProperty job_props[] = {
+	{ "name",     "s", NIH_DBUS_READ, string_get, NULL },
+	{ "goal",     "s", NIH_DBUS_READ, string_get, NULL },
+	{ "state",    "s", NIH_DBUS_READ, string_get, NULL },
+	{ "instance", "s", NIH_DBUS_READ, string_get, NULL },
+	{ NULL }
+};
+
+static const NihDBusProperty process_props[] = {
+	{ "main",     "s", NIH_DBUS_READ, string_get, NULL },
+	{ "pre-start", "s", NIH_DBUS_READ, string_get, NULL },
+	{ NULL }
+};
+
+static const NihDBusInterface job_interface = {
+	"com.netsplit.Nih.Test.Job",
+	NULL,
+	NULL,
+	job_props
+};
+
+static const NihDBusInterface process_interface = {
+	"com.netsplit.Nih.Test.Process",
+	NULL,
+	NULL,
+	process_props
+};
+
+static const NihDBusInterface *interfaces[] = {
+	&job_interface,
+	&process_interface,
+	NULL
+};
+
+
+static DBusConnection *client_conn = NULL;
+static char            server_name[128];
+
+
+/* Runs the server, exporting NUM_OBJECTS objects beneath an object
+ * manager, and writing the unique name of its connection to @fd.
+ */
+static void
+server (int fd)
+{
+	DBusConnection *conn;
+	NihDBusObject * manager;
+	const char *    name;
+	int             i;
+
+	assert ((conn = dbus_bus_get_private (DBUS_BUS_SYSTEM, NULL)) != NULL);
+
+	manager = NIH_MUST (nih_dbus_object_manager_new (NULL, conn,
+							 "/com/netsplit/Nih"));
+
+	for (i = 0; i < NUM_OBJECTS; i++) {
+		NihDBusObject * object;
+		nih_local char *path = NULL;
+
+		path = NIH_MUST (nih_sprintf (NULL, "/com/netsplit/Nih/job_%d",
+					      i));
+		object = NIH_MUST (nih_dbus_object_new (manager, conn, path,
+							interfaces, NULL));
+		NIH_ZERO (nih_dbus_object_manager_add (manager, object));
+	}
+
+	name = dbus_bus_get_unique_name (conn);
+	assert (write (fd, name, strlen (name) + 1) > 0);
+	close (fd);
+
+	while (dbus_connection_read_write_dispatch (conn, -1))
+		;
+
+	exit (0);
+}
+
+/* Makes a method call to the server, waiting for and discarding the
+ * reply.
+ */
+static void
+call (const char *path,
+      const char *interface,
+      const char *method,
+      const char *arg)
+{
+	DBusMessage *message;
+	DBusMessage *reply;
+
+	message = dbus_message_new_method_call (server_name, path,
+						interface, method);
+	assert (message != NULL);
+
+	if (arg)
+		assert (dbus_message_append_args (message,
+						  DBUS_TYPE_STRING, &arg,
+						  DBUS_TYPE_INVALID));
+
+	reply = dbus_connection_send_with_reply_and_block (client_conn,
+							   message, -1, NULL);
+	assert (reply != NULL);
+	assert (dbus_message_get_type (reply)
+		== DBUS_MESSAGE_TYPE_METHOD_RETURN);
+
+	dbus_message_unref (reply);
+	dbus_message_unref (message);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	pid_t dbus_pid;
+	pid_t server_pid;
+	int   fds[2];
+	char  name[64];
+
+	nih_error_init ();
+
+	TEST_DBUS (dbus_pid);
+
+	assert0 (pipe (fds));
+	assert ((server_pid = fork ()) >= 0);
+	if (server_pid == 0) {
+		close (fds[0]);
+		server (fds[1]);
+	}
+
+	close (fds[1]);
+	assert (read (fds[0], server_name, sizeof (server_name)) > 0);
+	close (fds[0]);
+
+	TEST_DBUS_OPEN (client_conn);
+
+	/* Time taken for a client to learn every object and the value of
+	 * every property, first by introspecting the tree and calling
+	 * GetAll for each interface of each object, which is how clients
+	 * must sync without an object manager; and then with a single
+	 * GetManagedObjects call.
+	 */
+	BENCH_GROUP ("Cold client sync");
+
+	snprintf (name, sizeof (name), "introspect_get_all/%d", NUM_OBJECTS);
+	BENCH (name, 1) {
+		int i;
+
+		call ("/com/netsplit/Nih", DBUS_INTERFACE_INTROSPECTABLE,
+		      "Introspect", NULL);
+
+		for (i = 0; i < NUM_OBJECTS; i++) {
+			char path[64];
+
+			sprintf (path, "/com/netsplit/Nih/job_%d", i);
+
+			call (path, DBUS_INTERFACE_INTROSPECTABLE,
+			      "Introspect", NULL);
+			call (path, DBUS_INTERFACE_PROPERTIES, "GetAll",
+			      "com.netsplit.Nih.Test.Job");
+			call (path, DBUS_INTERFACE_PROPERTIES, "GetAll",
+			      "com.netsplit.Nih.Test.Process");
+		}
+	}
+
+	snprintf (name, sizeof (name), "get_managed_objects/%d", NUM_OBJECTS);
+	BENCH (name, 1) {
+		call ("/com/netsplit/Nih", NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+		      "GetManagedObjects", NULL);
+	}
+
+	TEST_DBUS_CLOSE (client_conn);
+
+	kill (server_pid, SIGTERM);
+	waitpid (server_pid, NULL, 0);
+
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+
+	return 0;
+}
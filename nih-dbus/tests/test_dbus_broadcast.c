@@ -0,0 +1,538 @@
+/* libnih
+ *
+ * test_dbus_broadcast.c - test suite for nih-dbus/dbus_broadcast.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+#include <nih-dbus/test_dbus.h>
+
+#include <dbus/dbus.h>
+
+#include <errno.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_broadcast.h>
+
+
+void
+test_new (void)
+{
+	NihDBusBroadcast *broadcast;
+
+	/* Check that we can create a new broadcast, and that it has no
+	 * subscriptions.
+	 */
+	TEST_FUNCTION ("nih_dbus_broadcast_new");
+	TEST_ALLOC_FAIL {
+		broadcast = nih_dbus_broadcast_new (NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (broadcast, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (broadcast, sizeof (NihDBusBroadcast));
+		TEST_LIST_EMPTY (&broadcast->peers);
+
+		nih_free (broadcast);
+	}
+}
+
+
+void
+test_subscribe (void)
+{
+	pid_t                dbus_pid;
+	DBusConnection *     conn;
+	NihDBusBroadcast *   broadcast = NULL;
+	NihDBusSubscription *subscription;
+	NihDBusSubscription *other;
+	NihError *           err;
+
+	TEST_FUNCTION ("nih_dbus_broadcast_subscribe");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+
+
+	/* Check that we can subscribe a connection to a signal, and that
+	 * the interface and member are copied into the subscription.
+	 */
+	TEST_FEATURE ("with interface and member");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			broadcast = nih_dbus_broadcast_new (NULL);
+		}
+
+		subscription = nih_dbus_broadcast_subscribe (
+			broadcast, conn, "com.netsplit.Nih.Test", "Signal");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (subscription, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			TEST_LIST_EMPTY (&broadcast->peers);
+
+			nih_free (broadcast);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (subscription, sizeof (NihDBusSubscription));
+		TEST_ALLOC_PARENT (subscription, subscription->peer);
+		TEST_ALLOC_PARENT (subscription->peer, broadcast);
+		TEST_EQ_STR (subscription->interface, "com.netsplit.Nih.Test");
+		TEST_ALLOC_PARENT (subscription->interface, subscription);
+		TEST_EQ_STR (subscription->member, "Signal");
+		TEST_ALLOC_PARENT (subscription->member, subscription);
+
+		TEST_LIST_NOT_EMPTY (&broadcast->peers);
+
+		nih_free (broadcast);
+	}
+
+
+	/* Check that the interface and member may be NULL to subscribe to
+	 * any signal.
+	 */
+	TEST_FEATURE ("with any signal");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			broadcast = nih_dbus_broadcast_new (NULL);
+		}
+
+		subscription = nih_dbus_broadcast_subscribe (
+			broadcast, conn, NULL, NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (subscription, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			nih_free (broadcast);
+			continue;
+		}
+
+		TEST_EQ_P (subscription->interface, NULL);
+		TEST_EQ_P (subscription->member, NULL);
+
+		nih_free (broadcast);
+	}
+
+
+	/* Check that a second subscription for the same connection shares
+	 * the same peer, and that the peer is only removed once the last
+	 * of its subscriptions is freed.
+	 */
+	TEST_FEATURE ("with multiple subscriptions");
+	broadcast = nih_dbus_broadcast_new (NULL);
+
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, conn, "com.netsplit.Nih.Test", NULL);
+	TEST_NE_P (subscription, NULL);
+
+	other = nih_dbus_broadcast_subscribe (
+		broadcast, conn, "com.netsplit.Nih.Other", NULL);
+	TEST_NE_P (other, NULL);
+
+	TEST_EQ_P (other->peer, subscription->peer);
+
+	nih_free (subscription);
+
+	TEST_LIST_NOT_EMPTY (&broadcast->peers);
+
+	nih_free (other);
+
+	TEST_LIST_EMPTY (&broadcast->peers);
+
+	nih_free (broadcast);
+
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+void
+test_remove (void)
+{
+	pid_t                dbus_pid;
+	DBusConnection *     conn;
+	DBusConnection *     other_conn;
+	NihDBusBroadcast *   broadcast;
+	NihDBusSubscription *subscription;
+	NihDBusSubscription *other;
+
+	/* Check that removing a connection frees all of its subscriptions,
+	 * while leaving those of other connections alone.
+	 */
+	TEST_FUNCTION ("nih_dbus_broadcast_remove");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (other_conn);
+
+	broadcast = nih_dbus_broadcast_new (NULL);
+
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, conn, "com.netsplit.Nih.Test", NULL);
+	TEST_NE_P (subscription, NULL);
+	TEST_FREE_TAG (subscription);
+
+	other = nih_dbus_broadcast_subscribe (
+		broadcast, other_conn, "com.netsplit.Nih.Test", NULL);
+	TEST_NE_P (other, NULL);
+	TEST_FREE_TAG (other);
+
+	nih_dbus_broadcast_remove (broadcast, conn);
+
+	TEST_FREE (subscription);
+	TEST_NOT_FREE (other);
+
+	nih_dbus_broadcast_remove (broadcast, conn);
+
+	TEST_NOT_FREE (other);
+
+	nih_free (broadcast);
+
+	TEST_FREE (other);
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_CLOSE (other_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+static DBusConnection *
+open_peer (DBusConnection *conn)
+{
+	DBusConnection *peer;
+	DBusError       dbus_error;
+	char            rule[256];
+
+	TEST_DBUS_OPEN (peer);
+
+	sprintf (rule, "type='signal',sender='%s'",
+		 dbus_bus_get_unique_name (conn));
+
+	dbus_error_init (&dbus_error);
+	dbus_bus_add_match (peer, rule, &dbus_error);
+	assert (! dbus_error_is_set (&dbus_error));
+
+	return peer;
+}
+
+static void
+send_marker (DBusConnection *conn)
+{
+	DBusMessage *marker;
+
+	marker = dbus_message_new_signal ("/com/netsplit/Nih",
+					  "com.netsplit.Nih.Test", "Marker");
+	assert (marker != NULL);
+
+	assert (dbus_connection_send (conn, marker, NULL));
+	dbus_connection_flush (conn);
+
+	dbus_message_unref (marker);
+}
+
+void
+test_send (void)
+{
+	pid_t                dbus_pid;
+	DBusConnection *     conn;
+	DBusConnection *     conn_peer;
+	DBusConnection *     other_conn;
+	DBusConnection *     other_peer;
+	DBusConnection *     unsubscribed_conn;
+	DBusConnection *     unsubscribed_peer;
+	DBusConnection *     disconnected_conn;
+	NihDBusBroadcast *   broadcast;
+	NihDBusSubscription *subscription;
+	DBusMessage *        message;
+	DBusMessage *        received;
+	int                  ret;
+
+	TEST_FUNCTION ("nih_dbus_broadcast_send");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (other_conn);
+	TEST_DBUS_OPEN (unsubscribed_conn);
+
+	/* Each connection has a peer that receives every signal it sends
+	 * through the bus, so we can see what was sent; a marker signal
+	 * sent directly after each broadcast shows where the broadcast
+	 * would have appeared had it been sent.
+	 */
+	conn_peer = open_peer (conn);
+	other_peer = open_peer (other_conn);
+	unsubscribed_peer = open_peer (unsubscribed_conn);
+
+	broadcast = nih_dbus_broadcast_new (NULL);
+
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, conn, "com.netsplit.Nih.Test", "Signal");
+	TEST_NE_P (subscription, NULL);
+
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, conn, "com.netsplit.Nih.Test", NULL);
+	TEST_NE_P (subscription, NULL);
+
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, other_conn, "com.netsplit.Nih.Other", NULL);
+	TEST_NE_P (subscription, NULL);
+
+
+	/* Check that a signal is sent on each connection with a matching
+	 * subscription, and not on others; the message should be sent
+	 * only once even though two subscriptions match.
+	 */
+	TEST_FEATURE ("with matching subscription");
+	message = dbus_message_new_signal ("/com/netsplit/Nih",
+					   "com.netsplit.Nih.Test", "Signal");
+
+	ret = nih_dbus_broadcast_send (broadcast, message);
+
+	TEST_EQ (ret, 0);
+
+	send_marker (conn);
+	send_marker (other_conn);
+	send_marker (unsubscribed_conn);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Signal"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (other_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (unsubscribed_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	dbus_message_unref (message);
+
+
+	/* Check that a signal on a different interface is only sent
+	 * on the connection subscribed to that interface.
+	 */
+	TEST_FEATURE ("with other interface");
+	message = dbus_message_new_signal ("/com/netsplit/Nih",
+					   "com.netsplit.Nih.Other", "Signal");
+
+	ret = nih_dbus_broadcast_send (broadcast, message);
+
+	TEST_EQ (ret, 0);
+
+	send_marker (conn);
+	send_marker (other_conn);
+	send_marker (unsubscribed_conn);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (other_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Other",
+					   "Signal"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (other_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (unsubscribed_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	dbus_message_unref (message);
+
+
+	/* Check that a signal no connection is subscribed to is not
+	 * sent anywhere.
+	 */
+	TEST_FEATURE ("with no matching subscription");
+	message = dbus_message_new_signal ("/com/netsplit/Nih",
+					   "com.netsplit.Nih.Unknown", "Signal");
+
+	ret = nih_dbus_broadcast_send (broadcast, message);
+
+	TEST_EQ (ret, 0);
+
+	send_marker (conn);
+	send_marker (other_conn);
+	send_marker (unsubscribed_conn);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (other_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (unsubscribed_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	dbus_message_unref (message);
+
+
+	/* Check that when several connections are subscribed, the same
+	 * message is sent on each of them rather than a copy; the serial
+	 * number is assigned when it is first sent and kept by the rest.
+	 */
+	TEST_FEATURE ("with multiple connections");
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, other_conn, "com.netsplit.Nih.Test", "Signal");
+	TEST_NE_P (subscription, NULL);
+
+	message = dbus_message_new_signal ("/com/netsplit/Nih",
+					   "com.netsplit.Nih.Test", "Signal");
+
+	ret = nih_dbus_broadcast_send (broadcast, message);
+
+	TEST_EQ (ret, 0);
+	TEST_NE (dbus_message_get_serial (message), 0);
+
+	send_marker (conn);
+	send_marker (other_conn);
+	send_marker (unsubscribed_conn);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Signal"));
+	TEST_EQ (dbus_message_get_serial (received),
+		 dbus_message_get_serial (message));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (other_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Signal"));
+	TEST_EQ (dbus_message_get_serial (received),
+		 dbus_message_get_serial (message));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (other_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (unsubscribed_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	dbus_message_unref (message);
+
+
+	/* Check that a connection that has been disconnected is removed
+	 * when a signal is next sent, freeing its subscriptions and
+	 * dropping the reference to it.
+	 */
+	TEST_FEATURE ("with disconnected connection");
+	TEST_DBUS_OPEN (disconnected_conn);
+
+	subscription = nih_dbus_broadcast_subscribe (
+		broadcast, disconnected_conn, "com.netsplit.Nih.Test", NULL);
+	TEST_NE_P (subscription, NULL);
+	TEST_FREE_TAG (subscription);
+
+	dbus_connection_close (disconnected_conn);
+
+	message = dbus_message_new_signal ("/com/netsplit/Nih",
+					   "com.netsplit.Nih.Test", "Signal");
+
+	ret = nih_dbus_broadcast_send (broadcast, message);
+
+	TEST_EQ (ret, 0);
+	TEST_FREE (subscription);
+
+	send_marker (conn);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Signal"));
+	dbus_message_unref (received);
+
+	TEST_DBUS_MESSAGE (conn_peer, received);
+	TEST_TRUE (dbus_message_is_signal (received, "com.netsplit.Nih.Test",
+					   "Marker"));
+	dbus_message_unref (received);
+
+	dbus_message_unref (message);
+
+	dbus_connection_unref (disconnected_conn);
+
+
+	nih_free (broadcast);
+
+	TEST_DBUS_CLOSE (conn_peer);
+	TEST_DBUS_CLOSE (other_peer);
+	TEST_DBUS_CLOSE (unsubscribed_peer);
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_CLOSE (other_conn);
+	TEST_DBUS_CLOSE (unsubscribed_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_new ();
+	test_subscribe ();
+	test_remove ();
+	test_send ();
+
+	return 0;
+}
@@ -32,6 +32,7 @@
 
 #include <nih/macros.h>
 #include <nih/alloc.h>
+#include <nih/string.h>
 #include <nih/timer.h>
 #include <nih/signal.h>
 #include <nih/main.h>
@@ -84,6 +85,95 @@ test_message_new (void)
 }
 
 
+void
+test_message_borrow (void)
+{
+	NihDBusMessage *msg;
+	NihDBusMessage *other;
+	pid_t           dbus_pid;
+	DBusConnection *conn;
+	DBusMessage *   message;
+	void *          parent;
+	char *          str;
+
+	TEST_FUNCTION ("nih_dbus_message_borrow");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+
+	message = dbus_message_new (DBUS_MESSAGE_TYPE_METHOD_CALL);
+
+
+	/* Check that we can borrow a DBus message structure, and that
+	 * once released its children are freed and the same structure is
+	 * returned by the next call.
+	 */
+	TEST_FEATURE ("without reference");
+	msg = nih_dbus_message_borrow (conn, message);
+
+	TEST_ALLOC_SIZE (msg, sizeof (NihDBusMessage));
+	TEST_EQ_P (msg->connection, conn);
+	TEST_EQ_P (msg->message, message);
+
+	str = nih_strdup (msg, "test");
+	TEST_FREE_TAG (str);
+
+	nih_dbus_message_release (msg);
+
+	TEST_FREE (str);
+
+	other = nih_dbus_message_borrow (conn, message);
+
+	TEST_EQ_P (other, msg);
+	TEST_EQ_P (other->connection, conn);
+	TEST_EQ_P (other->message, message);
+
+	nih_dbus_message_release (other);
+
+
+	/* Check that when a reference is taken to the borrowed structure
+	 * it is not re-used, and remains valid with its children until the
+	 * reference is dropped.
+	 */
+	TEST_FEATURE ("with reference");
+	parent = nih_alloc (NULL, 0);
+
+	msg = nih_dbus_message_borrow (conn, message);
+
+	str = nih_strdup (msg, "test");
+	TEST_FREE_TAG (str);
+
+	nih_ref (msg, parent);
+	TEST_FREE_TAG (msg);
+
+	nih_dbus_message_release (msg);
+
+	TEST_NOT_FREE (msg);
+	TEST_NOT_FREE (str);
+	TEST_ALLOC_PARENT (msg, parent);
+	TEST_FALSE (nih_alloc_parent (msg, NULL));
+	TEST_EQ_P (msg->connection, conn);
+	TEST_EQ_P (msg->message, message);
+
+	other = nih_dbus_message_borrow (conn, message);
+
+	TEST_NE_P (other, msg);
+
+	nih_dbus_message_release (other);
+
+	nih_free (parent);
+
+	TEST_FREE (msg);
+	TEST_FREE (str);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
 void
 test_message_error (void)
 {
@@ -174,6 +264,7 @@ main (int   argc,
       char *argv[])
 {
 	test_message_new ();
+	test_message_borrow ();
 	test_message_error ();
 
 	return 0;
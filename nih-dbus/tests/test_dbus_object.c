@@ -54,6 +54,28 @@ foo_handler (NihDBusObject * object,
 	return DBUS_HANDLER_RESULT_HANDLED;
 }
 
+static int             async_called = FALSE;
+static NihDBusMessage *async_message = NULL;
+static char *          async_str = NULL;
+
+static DBusHandlerResult
+async_handler (NihDBusObject * object,
+	       NihDBusMessage *message)
+{
+	async_called = TRUE;
+	last_object = object;
+
+	/* Take a reference to reply later, as asynchronous handlers do,
+	 * and allocate something from the message as demarshalling does.
+	 */
+	nih_ref (message, object);
+	async_message = message;
+
+	async_str = nih_strdup (message, "test");
+
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
 static int bar_decline = FALSE;
 static int bar_called = FALSE;
 
@@ -338,6 +360,18 @@ static const NihDBusInterface interface_c = {
 	interface_c_props
 };
 
+static const NihDBusMethod interface_async_methods[] = {
+	{ "Async", baz_args, async_handler },
+	{ NULL }
+};
+
+static const NihDBusInterface interface_async = {
+	"Nih.TestAsync",
+	interface_async_methods,
+	NULL,
+	NULL
+};
+
 static const NihDBusInterface *no_interfaces[] = {
 	NULL
 };
@@ -352,6 +386,11 @@ static const NihDBusInterface *prop_interface[] = {
 	NULL
 };
 
+static const NihDBusInterface *async_interface[] = {
+	&interface_async,
+	NULL
+};
+
 static const NihDBusInterface *all_interfaces[] = {
 	&interface_a,
 	&interface_b,
@@ -359,6 +398,53 @@ static const NihDBusInterface *all_interfaces[] = {
 	NULL
 };
 
+
+static int lookup_called = 0;
+
+static int
+subtree_lookup (void *                     data,
+		NihDBusSubtree *           subtree,
+		const char *               path,
+		void **                    object_data,
+		const NihDBusInterface ***interfaces)
+{
+	lookup_called++;
+
+	if (strcmp (path, "/com/netsplit/Nih/Frodo")
+	    && strcmp (path, "/com/netsplit/Nih/Bilbo"))
+		return FALSE;
+
+	*object_data = data;
+	*interfaces = one_interface;
+
+	return TRUE;
+}
+
+static char **
+subtree_children (void *          data,
+		  NihDBusSubtree *subtree,
+		  const void *    parent,
+		  const char *    path)
+{
+	char **children;
+
+	children = nih_str_array_new (parent);
+	if (! children)
+		return NULL;
+
+	if (! strcmp (path, "/com/netsplit/Nih")) {
+		size_t len = 0;
+
+		if ((! nih_str_array_add (&children, parent, &len, "Bilbo"))
+		    || (! nih_str_array_add (&children, parent, &len, "Frodo"))) {
+			nih_free (children);
+			return NULL;
+		}
+	}
+
+	return children;
+}
+
 void
 test_object_new (void)
 {
@@ -488,6 +574,7 @@ test_object_message (void)
 	DBusMessage *    message;
 	dbus_uint32_t    serial;
 	DBusMessage *    reply;
+	NihDBusMessage * first;
 
 	TEST_FUNCTION ("nih_dbus_object_message");
 	TEST_DBUS (dbus_pid);
@@ -614,6 +701,101 @@ test_object_message (void)
 	nih_free (object);
 
 
+	/* Check that a handler may take a reference to the message structure
+	 * to reply later; it must remain valid, along with anything allocated
+	 * from it, until it is freed, and the next call must be given a
+	 * different structure.
+	 */
+	TEST_FEATURE ("with handler taking reference");
+	object = nih_dbus_object_new (NULL, server_conn, "/com/netsplit/Nih",
+				      async_interface, &server_conn);
+
+	async_called = FALSE;
+	last_object = NULL;
+	async_message = NULL;
+	async_str = NULL;
+
+	message = dbus_message_new_method_call (
+		dbus_bus_get_unique_name (server_conn),
+		"/com/netsplit/Nih",
+		"Nih.TestAsync",
+		"Async");
+	assert (message != NULL);
+
+	assert (dbus_connection_send (client_conn, message, &serial));
+	dbus_connection_flush (client_conn);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_DISPATCH (server_conn);
+
+	TEST_TRUE (async_called);
+	TEST_EQ_P (last_object, object);
+
+	first = async_message;
+	TEST_NE_P (first, NULL);
+	TEST_ALLOC_PARENT (first, object);
+	TEST_FALSE (nih_alloc_parent (first, NULL));
+	TEST_EQ_P (first->connection, server_conn);
+	TEST_TRUE (dbus_message_is_method_call (first->message,
+						"Nih.TestAsync", "Async"));
+	TEST_EQ_STR (async_str, "test");
+	TEST_ALLOC_PARENT (async_str, first);
+
+	TEST_FREE_TAG (first);
+
+	async_called = FALSE;
+	async_message = NULL;
+
+	message = dbus_message_new_method_call (
+		dbus_bus_get_unique_name (server_conn),
+		"/com/netsplit/Nih",
+		"Nih.TestAsync",
+		"Async");
+	assert (message != NULL);
+
+	assert (dbus_connection_send (client_conn, message, NULL));
+	dbus_connection_flush (client_conn);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_DISPATCH (server_conn);
+
+	TEST_TRUE (async_called);
+	TEST_NE_P (async_message, NULL);
+	TEST_NE_P (async_message, first);
+
+	TEST_NOT_FREE (first);
+	TEST_TRUE (dbus_message_is_method_call (first->message,
+						"Nih.TestAsync", "Async"));
+
+	reply = dbus_message_new_method_return (first->message);
+	assert (reply != NULL);
+
+	assert (dbus_connection_send (first->connection, reply, NULL));
+	dbus_connection_flush (first->connection);
+
+	dbus_message_unref (reply);
+
+	nih_free (first);
+
+	TEST_FREE (first);
+
+	TEST_DBUS_MESSAGE (client_conn, reply);
+
+	TEST_EQ (dbus_message_get_type (reply),
+		 DBUS_MESSAGE_TYPE_METHOD_RETURN);
+	TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+
+	dbus_message_unref (reply);
+
+	TEST_FREE_TAG (async_message);
+
+	nih_free (object);
+
+	TEST_FREE (async_message);
+
+
 	/* Check that an unknown method on a known interface results in
 	 * an error being returned to the caller.
 	 */
@@ -3751,6 +3933,365 @@ test_object_property_set (void)
 }
 
 
+void
+test_subtree_new (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *conn;
+	NihDBusSubtree *subtree;
+
+	/* Check that we can register a new subtree, having the filled in
+	 * structure returned for us with a fallback handler registered
+	 * against the connection at the right path.
+	 */
+	TEST_FUNCTION ("nih_dbus_subtree_new");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+
+	TEST_ALLOC_FAIL {
+		void *data;
+
+		subtree = nih_dbus_subtree_new (NULL, conn, "/com/netsplit/Nih",
+						subtree_lookup, subtree_children,
+						10, &subtree);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (subtree, NULL);
+
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (subtree, sizeof (NihDBusSubtree));
+
+		TEST_ALLOC_PARENT (subtree->path, subtree);
+		TEST_EQ_STR (subtree->path, "/com/netsplit/Nih");
+
+		TEST_EQ_P (subtree->connection, conn);
+		TEST_EQ_P (subtree->data, &subtree);
+		TEST_EQ_P (subtree->lookup, subtree_lookup);
+		TEST_EQ_P (subtree->children, subtree_children);
+		TEST_EQ (subtree->cache_size, 10);
+		TEST_EQ (subtree->cache_len, 0);
+		TEST_ALLOC_PARENT (subtree->cache, subtree);
+		TEST_LIST_EMPTY (&subtree->lru);
+		TEST_EQ (subtree->registered, TRUE);
+
+		TEST_TRUE (dbus_connection_get_object_path_data (
+				   conn, "/com/netsplit/Nih", &data));
+		TEST_EQ_P (data, subtree);
+
+		nih_free (subtree);
+
+		TEST_TRUE (dbus_connection_get_object_path_data (
+				   conn, "/com/netsplit/Nih", &data));
+		TEST_EQ_P (data, NULL);
+	}
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_subtree_message (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusSubtree *subtree;
+	NihDBusObject * object;
+	DBusMessage *   message;
+	dbus_uint32_t   serial;
+	DBusMessage *   reply;
+	int             i;
+
+	TEST_FUNCTION ("nih_dbus_subtree_message");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+
+	/* Check that a method call to an object within the subtree is
+	 * handled by an object materialised from the lookup function,
+	 * which is discarded afterwards when there is no cache.
+	 */
+	TEST_FEATURE ("with object and no cache");
+	subtree = nih_dbus_subtree_new (NULL, server_conn, "/com/netsplit/Nih",
+					subtree_lookup, NULL, 0, &server_conn);
+
+	TEST_ALLOC_FAIL {
+		foo_called = FALSE;
+		last_object = NULL;
+		last_message_conn = NULL;
+
+		message = dbus_message_new_method_call (
+			dbus_bus_get_unique_name (server_conn),
+			"/com/netsplit/Nih/Frodo",
+			"Nih.TestA",
+			"Foo");
+		assert (message != NULL);
+
+		assert (dbus_connection_send (client_conn, message, NULL));
+		dbus_connection_flush (client_conn);
+
+		dbus_message_unref (message);
+
+		TEST_DBUS_DISPATCH (server_conn);
+
+		TEST_TRUE (foo_called);
+		TEST_NE_P (last_object, NULL);
+		TEST_EQ_P (last_message_conn, server_conn);
+	}
+
+	nih_free (subtree);
+
+
+	/* Check that the materialised object is cached, so that the lookup
+	 * function is only called for the first message, and that the
+	 * object has the path and data of the object it represents.
+	 */
+	TEST_FEATURE ("with object and cache");
+	subtree = nih_dbus_subtree_new (NULL, server_conn, "/com/netsplit/Nih",
+					subtree_lookup, NULL, 10, &server_conn);
+	lookup_called = 0;
+	object = NULL;
+
+	for (i = 0; i < 2; i++) {
+		foo_called = FALSE;
+		last_object = NULL;
+
+		message = dbus_message_new_method_call (
+			dbus_bus_get_unique_name (server_conn),
+			"/com/netsplit/Nih/Frodo",
+			"Nih.TestA",
+			"Foo");
+		assert (message != NULL);
+
+		assert (dbus_connection_send (client_conn, message, NULL));
+		dbus_connection_flush (client_conn);
+
+		dbus_message_unref (message);
+
+		TEST_DBUS_DISPATCH (server_conn);
+
+		TEST_TRUE (foo_called);
+		TEST_EQ (lookup_called, 1);
+
+		if (! object)
+			object = last_object;
+		TEST_EQ_P (last_object, object);
+	}
+
+	TEST_EQ_STR (object->path, "/com/netsplit/Nih/Frodo");
+	TEST_EQ_P (object->connection, server_conn);
+	TEST_EQ_P (object->data, &server_conn);
+	TEST_EQ_P (object->interfaces, one_interface);
+	TEST_EQ (object->registered, FALSE);
+	TEST_EQ_P (object->subtree, subtree);
+	TEST_EQ (subtree->cache_len, 1);
+
+
+	/* Check that invalidating the path discards the cached object, so
+	 * that the lookup function is called again for the next message.
+	 */
+	TEST_FEATURE ("with invalidated object");
+	TEST_FREE_TAG (object);
+
+	nih_dbus_subtree_invalidate (subtree, "/com/netsplit/Nih/Frodo");
+
+	TEST_FREE (object);
+	TEST_EQ (subtree->cache_len, 0);
+
+	message = dbus_message_new_method_call (
+		dbus_bus_get_unique_name (server_conn),
+		"/com/netsplit/Nih/Frodo",
+		"Nih.TestA",
+		"Foo");
+	assert (message != NULL);
+
+	assert (dbus_connection_send (client_conn, message, NULL));
+	dbus_connection_flush (client_conn);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_DISPATCH (server_conn);
+
+	TEST_EQ (lookup_called, 2);
+	TEST_EQ (subtree->cache_len, 1);
+
+	nih_free (subtree);
+
+
+	/* Check that the least recently used object is discarded when the
+	 * cache is full.
+	 */
+	TEST_FEATURE ("with full cache");
+	subtree = nih_dbus_subtree_new (NULL, server_conn, "/com/netsplit/Nih",
+					subtree_lookup, NULL, 1, &server_conn);
+	lookup_called = 0;
+
+	for (i = 0; i < 3; i++) {
+		message = dbus_message_new_method_call (
+			dbus_bus_get_unique_name (server_conn),
+			(i % 2 ? "/com/netsplit/Nih/Bilbo"
+			 : "/com/netsplit/Nih/Frodo"),
+			"Nih.TestA",
+			"Foo");
+		assert (message != NULL);
+
+		assert (dbus_connection_send (client_conn, message, NULL));
+		dbus_connection_flush (client_conn);
+
+		dbus_message_unref (message);
+
+		TEST_DBUS_DISPATCH (server_conn);
+	}
+
+	TEST_EQ (lookup_called, 3);
+	TEST_EQ (subtree->cache_len, 1);
+
+	nih_free (subtree);
+
+
+	/* Check that a method call to a path within the subtree without
+	 * an object results in an error being returned to the caller.
+	 */
+	TEST_FEATURE ("with unknown object");
+	subtree = nih_dbus_subtree_new (NULL, server_conn, "/com/netsplit/Nih",
+					subtree_lookup, NULL, 10, &server_conn);
+
+	TEST_ALLOC_FAIL {
+		foo_called = FALSE;
+
+		message = dbus_message_new_method_call (
+			dbus_bus_get_unique_name (server_conn),
+			"/com/netsplit/Nih/Sam",
+			"Nih.TestA",
+			"Foo");
+		assert (message != NULL);
+
+		TEST_ALLOC_SAFE {
+			assert (dbus_connection_send (client_conn, message, &serial));
+			dbus_connection_flush (client_conn);
+		}
+
+		dbus_message_unref (message);
+
+		TEST_DBUS_DISPATCH (server_conn);
+		TEST_DBUS_MESSAGE (client_conn, reply);
+
+		TEST_FALSE (foo_called);
+		TEST_EQ (subtree->cache_len, 0);
+
+		TEST_TRUE (dbus_message_is_error (reply, DBUS_ERROR_UNKNOWN_METHOD));
+		TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+
+		dbus_message_unref (reply);
+	}
+
+	nih_free (subtree);
+
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_subtree_introspect (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusSubtree *subtree;
+	DBusMessage *   message;
+	dbus_uint32_t   serial;
+	DBusMessage *   reply;
+	const char *    xml;
+
+	/* Check that the Introspect method on the path of the subtree,
+	 * which has no object of its own, returns node entries for the
+	 * children enumerated by the subtree's children function.
+	 */
+	TEST_FUNCTION ("nih_dbus_object_introspect");
+	TEST_FEATURE ("with subtree children");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+	subtree = nih_dbus_subtree_new (NULL, server_conn, "/com/netsplit/Nih",
+					subtree_lookup, subtree_children,
+					10, &server_conn);
+
+	TEST_ALLOC_FAIL {
+		message = dbus_message_new_method_call (
+			dbus_bus_get_unique_name (server_conn),
+			"/com/netsplit/Nih",
+			DBUS_INTERFACE_INTROSPECTABLE,
+			"Introspect");
+		assert (message != NULL);
+
+		TEST_ALLOC_SAFE {
+			assert (dbus_connection_send (client_conn, message, &serial));
+			dbus_connection_flush (client_conn);
+		}
+
+		dbus_message_unref (message);
+
+		TEST_DBUS_DISPATCH (server_conn);
+		TEST_DBUS_MESSAGE (client_conn, reply);
+
+		TEST_EQ (dbus_message_get_type (reply),
+			 DBUS_MESSAGE_TYPE_METHOD_RETURN);
+		TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+
+		TEST_TRUE (dbus_message_get_args (reply, NULL,
+						  DBUS_TYPE_STRING, &xml,
+						  DBUS_TYPE_INVALID));
+
+		TEST_EQ_STRN (xml, DBUS_INTROSPECT_1_0_XML_DOCTYPE_DECL_NODE);
+		xml += strlen (DBUS_INTROSPECT_1_0_XML_DOCTYPE_DECL_NODE);
+
+		TEST_EQ_STRN (xml, "<node name=\"/com/netsplit/Nih\">\n");
+		xml = strchr (xml, '\n') + 1;
+
+		TEST_EQ_STRN (xml, "  <interface name=\"org.freedesktop.DBus.Introspectable\">\n");
+		xml = strchr (xml, '\n') + 1;
+		TEST_EQ_STRN (xml, "    <method name=\"Introspect\">\n");
+		xml = strchr (xml, '\n') + 1;
+		TEST_EQ_STRN (xml, "      <arg name=\"data\" type=\"s\" direction=\"out\"/>\n");
+		xml = strchr (xml, '\n') + 1;
+		TEST_EQ_STRN (xml, "    </method>\n");
+		xml = strchr (xml, '\n') + 1;
+		TEST_EQ_STRN (xml, "  </interface>\n");
+		xml = strchr (xml, '\n') + 1;
+
+		TEST_EQ_STRN (xml, "  <node name=\"Bilbo\"/>\n");
+		xml = strchr (xml, '\n') + 1;
+		TEST_EQ_STRN (xml, "  <node name=\"Frodo\"/>\n");
+		xml = strchr (xml, '\n') + 1;
+
+		TEST_EQ_STRN (xml, "</node>\n");
+		xml = strchr (xml, '\n') + 1;
+
+		TEST_EQ_STR (xml, "");
+
+		dbus_message_unref (reply);
+	}
+
+	nih_free (subtree);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -3766,5 +4307,9 @@ main (int   argc,
 	test_object_property_get_all ();
 	test_object_property_set ();
 
+	test_subtree_new ();
+	test_subtree_message ();
+	test_subtree_introspect ();
+
 	return 0;
 }
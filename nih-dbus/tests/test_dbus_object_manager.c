@@ -0,0 +1,583 @@
+/* libnih
+ *
+ * test_dbus_object_manager.c - test suite for nih-dbus/dbus_object_manager.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+#include <nih-dbus/test_dbus.h>
+
+#include <dbus/dbus.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_error.h>
+#include <nih-dbus/dbus_message.h>
+#include <nih-dbus/dbus_object.h>
+#include <nih-dbus/dbus_object_manager.h>
+#include <nih-dbus/errors.h>
+
+
+static int
+colour_get (NihDBusObject *  object,
+	    NihDBusMessage * message,
+	    DBusMessageIter *iter)
+{
+	DBusMessageIter subiter;
+	const char *    colour = "red";
+
+	if (! dbus_message_iter_open_container (iter, DBUS_TYPE_VARIANT,
+						DBUS_TYPE_STRING_AS_STRING,
+						&subiter)) {
+		nih_error_raise_no_memory ();
+		return -1;
+	}
+
+	if (! dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
+					      &colour)) {
+		nih_error_raise_no_memory ();
+		return -1;
+	}
+
+	if (! dbus_message_iter_close_container (iter, &subiter)) {
+		nih_error_raise_no_memory ();
+		return -1;
+	}
+
+	return 0;
+}
+
+static const NihDBusProperty interface_a_props[] = {
+	{ "Colour", "s", NIH_DBUS_READ, colour_get, NULL },
+	{ NULL }
+};
+
+static const NihDBusInterface interface_a = {
+	"Nih.TestA",
+	NULL,
+	NULL,
+	interface_a_props
+};
+
+static const NihDBusInterface interface_b = {
+	"Nih.TestB",
+	NULL,
+	NULL,
+	NULL
+};
+
+static const NihDBusInterface *all_interfaces[] = {
+	&interface_a,
+	&interface_b,
+	NULL
+};
+
+
+/* Checks that @iter is at the dictionary of interfaces and properties
+ * of an object with all_interfaces.
+ */
+static void
+check_interfaces (DBusMessageIter *iter)
+{
+	DBusMessageIter arrayiter;
+	DBusMessageIter dictiter;
+	DBusMessageIter propiter;
+	DBusMessageIter propdictiter;
+	DBusMessageIter variter;
+	const char *    str;
+
+	TEST_EQ (dbus_message_iter_get_arg_type (iter), DBUS_TYPE_ARRAY);
+	dbus_message_iter_recurse (iter, &arrayiter);
+
+	TEST_EQ (dbus_message_iter_get_arg_type (&arrayiter),
+		 DBUS_TYPE_DICT_ENTRY);
+	dbus_message_iter_recurse (&arrayiter, &dictiter);
+
+	dbus_message_iter_get_basic (&dictiter, &str);
+	TEST_EQ_STR (str, "Nih.TestA");
+	dbus_message_iter_next (&dictiter);
+
+	dbus_message_iter_recurse (&dictiter, &propiter);
+	TEST_EQ (dbus_message_iter_get_arg_type (&propiter),
+		 DBUS_TYPE_DICT_ENTRY);
+	dbus_message_iter_recurse (&propiter, &propdictiter);
+
+	dbus_message_iter_get_basic (&propdictiter, &str);
+	TEST_EQ_STR (str, "Colour");
+	dbus_message_iter_next (&propdictiter);
+
+	dbus_message_iter_recurse (&propdictiter, &variter);
+	dbus_message_iter_get_basic (&variter, &str);
+	TEST_EQ_STR (str, "red");
+
+	dbus_message_iter_next (&propiter);
+	TEST_EQ (dbus_message_iter_get_arg_type (&propiter),
+		 DBUS_TYPE_INVALID);
+
+	dbus_message_iter_next (&arrayiter);
+	TEST_EQ (dbus_message_iter_get_arg_type (&arrayiter),
+		 DBUS_TYPE_DICT_ENTRY);
+	dbus_message_iter_recurse (&arrayiter, &dictiter);
+
+	dbus_message_iter_get_basic (&dictiter, &str);
+	TEST_EQ_STR (str, "Nih.TestB");
+	dbus_message_iter_next (&dictiter);
+
+	dbus_message_iter_recurse (&dictiter, &propiter);
+	TEST_EQ (dbus_message_iter_get_arg_type (&propiter),
+		 DBUS_TYPE_INVALID);
+
+	dbus_message_iter_next (&arrayiter);
+	TEST_EQ (dbus_message_iter_get_arg_type (&arrayiter),
+		 DBUS_TYPE_INVALID);
+}
+
+
+void
+test_new (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *conn;
+	NihDBusObject * manager;
+
+	/* Check that we can register a new object manager, which is
+	 * returned as an object registered at the right path implementing
+	 * the object manager interface.
+	 */
+	TEST_FUNCTION ("nih_dbus_object_manager_new");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+
+	TEST_ALLOC_FAIL {
+		void *data;
+
+		manager = nih_dbus_object_manager_new (NULL, conn,
+						       "/com/netsplit/Nih");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (manager, NULL);
+
+			TEST_TRUE (dbus_connection_get_object_path_data (
+					   conn, "/com/netsplit/Nih", &data));
+			TEST_EQ_P (data, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (manager, sizeof (NihDBusObject));
+		TEST_EQ_STR (manager->path, "/com/netsplit/Nih");
+		TEST_EQ_STR (manager->interfaces[0]->name,
+			     NIH_DBUS_OBJECT_MANAGER_INTERFACE);
+		TEST_EQ_P (manager->interfaces[1], NULL);
+		TEST_ALLOC_PARENT (manager->data, manager);
+
+		TEST_TRUE (dbus_connection_get_object_path_data (
+				   conn, "/com/netsplit/Nih", &data));
+		TEST_EQ_P (data, manager);
+
+		nih_free (manager);
+	}
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_add (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusObject * manager;
+	NihDBusObject * object;
+	NihDBusObject * other;
+	DBusMessage *   signal;
+	DBusMessageIter iter;
+	const char *    path;
+	NihError *      err;
+	int             ret;
+
+	/* Check that adding an object emits the InterfacesAdded signal
+	 * from the manager with the object's path and the values of its
+	 * properties for each interface.
+	 */
+	TEST_FUNCTION ("nih_dbus_object_manager_add");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+	dbus_bus_add_match (client_conn, "type='signal'", NULL);
+
+	manager = nih_dbus_object_manager_new (NULL, server_conn,
+					       "/com/netsplit/Nih");
+	object = nih_dbus_object_new (NULL, server_conn,
+				      "/com/netsplit/Nih/Frodo",
+				      all_interfaces, NULL);
+
+	ret = nih_dbus_object_manager_add (manager, object);
+
+	TEST_EQ (ret, 0);
+
+	dbus_connection_flush (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, signal);
+
+	TEST_TRUE (dbus_message_is_signal (signal,
+					   NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+					   "InterfacesAdded"));
+	TEST_EQ_STR (dbus_message_get_path (signal), "/com/netsplit/Nih");
+	TEST_TRUE (dbus_message_has_signature (signal, "oa{sa{sv}}"));
+
+	dbus_message_iter_init (signal, &iter);
+
+	dbus_message_iter_get_basic (&iter, &path);
+	TEST_EQ_STR (path, "/com/netsplit/Nih/Frodo");
+	dbus_message_iter_next (&iter);
+
+	check_interfaces (&iter);
+
+	dbus_message_unref (signal);
+
+
+	/* Check that adding the same object again does nothing. */
+	TEST_FEATURE ("with object already added");
+	ret = nih_dbus_object_manager_add (manager, object);
+
+	TEST_EQ (ret, 0);
+
+
+	/* Check that an object whose path merely begins with that of the
+	 * manager is not beneath it, and that an error is raised rather
+	 * than the object being added.
+	 */
+	TEST_FEATURE ("with object not beneath manager");
+	other = nih_dbus_object_new (NULL, server_conn,
+				     "/com/netsplit/NihFrodo",
+				     all_interfaces, NULL);
+
+	ret = nih_dbus_object_manager_add (manager, other);
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_OBJECT_NOT_BENEATH);
+	nih_free (err);
+
+	nih_free (other);
+
+
+	/* Check that the manager cannot manage itself. */
+	TEST_FEATURE ("with manager itself");
+	ret = nih_dbus_object_manager_add (manager, manager);
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_OBJECT_NOT_BENEATH);
+	nih_free (err);
+
+	nih_free (manager);
+
+
+	/* Check that every other object is beneath a manager at the root
+	 * path.
+	 */
+	TEST_FEATURE ("with manager at root");
+	manager = nih_dbus_object_manager_new (NULL, server_conn, "/");
+
+	ret = nih_dbus_object_manager_add (manager, object);
+
+	TEST_EQ (ret, 0);
+
+	dbus_connection_flush (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, signal);
+
+	TEST_TRUE (dbus_message_is_signal (signal,
+					   NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+					   "InterfacesAdded"));
+	TEST_EQ_STR (dbus_message_get_path (signal), "/");
+
+	dbus_message_unref (signal);
+
+	ret = nih_dbus_object_manager_add (manager, manager);
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_OBJECT_NOT_BENEATH);
+	nih_free (err);
+
+	nih_free (manager);
+	nih_free (object);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_remove (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusObject * manager;
+	NihDBusObject * object;
+	DBusMessage *   signal;
+	char **         interfaces;
+	int             interfaces_len;
+	const char *    path;
+	int             ret;
+
+	TEST_FUNCTION ("nih_dbus_object_manager_remove");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+	dbus_bus_add_match (client_conn, "type='signal'", NULL);
+
+	manager = nih_dbus_object_manager_new (NULL, server_conn,
+					       "/com/netsplit/Nih");
+
+
+	/* Check that removing an object emits the InterfacesRemoved signal
+	 * from the manager with the object's path and interface names.
+	 */
+	TEST_FEATURE ("with managed object");
+	object = nih_dbus_object_new (NULL, server_conn,
+				      "/com/netsplit/Nih/Frodo",
+				      all_interfaces, NULL);
+	assert0 (nih_dbus_object_manager_add (manager, object));
+
+	dbus_connection_flush (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, signal);
+	dbus_message_unref (signal);
+
+	ret = nih_dbus_object_manager_remove (manager, object);
+
+	TEST_EQ (ret, 0);
+
+	dbus_connection_flush (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, signal);
+
+	TEST_TRUE (dbus_message_is_signal (signal,
+					   NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+					   "InterfacesRemoved"));
+	TEST_TRUE (dbus_message_get_args (signal, NULL,
+					  DBUS_TYPE_OBJECT_PATH, &path,
+					  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+					  &interfaces, &interfaces_len,
+					  DBUS_TYPE_INVALID));
+	TEST_EQ_STR (path, "/com/netsplit/Nih/Frodo");
+	TEST_EQ (interfaces_len, 2);
+	TEST_EQ_STR (interfaces[0], "Nih.TestA");
+	TEST_EQ_STR (interfaces[1], "Nih.TestB");
+
+	dbus_free_string_array (interfaces);
+	dbus_message_unref (signal);
+
+
+	/* Check that an object is removed, and the signal emitted, when
+	 * it is freed.
+	 */
+	TEST_FEATURE ("with freed object");
+	assert0 (nih_dbus_object_manager_add (manager, object));
+
+	dbus_connection_flush (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, signal);
+	dbus_message_unref (signal);
+
+	nih_free (object);
+
+	dbus_connection_flush (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, signal);
+
+	TEST_TRUE (dbus_message_is_signal (signal,
+					   NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+					   "InterfacesRemoved"));
+	TEST_TRUE (dbus_message_get_args (signal, NULL,
+					  DBUS_TYPE_OBJECT_PATH, &path,
+					  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+					  &interfaces, &interfaces_len,
+					  DBUS_TYPE_INVALID));
+	TEST_EQ_STR (path, "/com/netsplit/Nih/Frodo");
+	TEST_EQ (interfaces_len, 2);
+
+	dbus_free_string_array (interfaces);
+	dbus_message_unref (signal);
+
+
+	/* Check that freeing the manager doesn't free the objects that
+	 * were added to it.
+	 */
+	TEST_FEATURE ("with freed manager");
+	object = nih_dbus_object_new (NULL, server_conn,
+				      "/com/netsplit/Nih/Frodo",
+				      all_interfaces, NULL);
+	assert0 (nih_dbus_object_manager_add (manager, object));
+
+	TEST_FREE_TAG (object);
+
+	nih_free (manager);
+
+	TEST_NOT_FREE (object);
+
+	nih_free (object);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_get_managed_objects (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusObject * manager;
+	NihDBusObject * object;
+	DBusMessage *   message;
+	dbus_uint32_t   serial;
+	DBusMessage *   reply;
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+	DBusMessageIter dictiter;
+	const char *    path;
+
+	TEST_FUNCTION ("nih_dbus_object_manager_get_managed_objects");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+	manager = nih_dbus_object_manager_new (NULL, server_conn,
+					       "/com/netsplit/Nih");
+	object = nih_dbus_object_new (NULL, server_conn,
+				      "/com/netsplit/Nih/Frodo",
+				      all_interfaces, NULL);
+	assert0 (nih_dbus_object_manager_add (manager, object));
+
+
+	/* Check that the GetManagedObjects method returns the path of each
+	 * managed object with the values of its properties for each
+	 * interface.
+	 */
+	TEST_FEATURE ("with managed object");
+	TEST_ALLOC_FAIL {
+		message = dbus_message_new_method_call (
+			dbus_bus_get_unique_name (server_conn),
+			"/com/netsplit/Nih",
+			NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+			"GetManagedObjects");
+		assert (message != NULL);
+
+		TEST_ALLOC_SAFE {
+			assert (dbus_connection_send (client_conn, message, &serial));
+			dbus_connection_flush (client_conn);
+		}
+
+		dbus_message_unref (message);
+
+		TEST_DBUS_DISPATCH (server_conn);
+		TEST_DBUS_MESSAGE (client_conn, reply);
+
+		TEST_EQ (dbus_message_get_type (reply),
+			 DBUS_MESSAGE_TYPE_METHOD_RETURN);
+		TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+		TEST_TRUE (dbus_message_has_signature (reply, "a{oa{sa{sv}}}"));
+
+		dbus_message_iter_init (reply, &iter);
+		dbus_message_iter_recurse (&iter, &arrayiter);
+
+		TEST_EQ (dbus_message_iter_get_arg_type (&arrayiter),
+			 DBUS_TYPE_DICT_ENTRY);
+		dbus_message_iter_recurse (&arrayiter, &dictiter);
+
+		dbus_message_iter_get_basic (&dictiter, &path);
+		TEST_EQ_STR (path, "/com/netsplit/Nih/Frodo");
+		dbus_message_iter_next (&dictiter);
+
+		check_interfaces (&dictiter);
+
+		dbus_message_iter_next (&arrayiter);
+		TEST_EQ (dbus_message_iter_get_arg_type (&arrayiter),
+			 DBUS_TYPE_INVALID);
+
+		dbus_message_unref (reply);
+	}
+
+
+	/* Check that we receive an Invalid Args error when we pass
+	 * arguments.
+	 */
+	TEST_FEATURE ("with too many arguments");
+	message = dbus_message_new_method_call (
+		dbus_bus_get_unique_name (server_conn),
+		"/com/netsplit/Nih",
+		NIH_DBUS_OBJECT_MANAGER_INTERFACE,
+		"GetManagedObjects");
+	assert (message != NULL);
+
+	path = "/com/netsplit/Nih";
+	assert (dbus_message_append_args (message,
+					  DBUS_TYPE_STRING, &path,
+					  DBUS_TYPE_INVALID));
+
+	assert (dbus_connection_send (client_conn, message, &serial));
+	dbus_connection_flush (client_conn);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_DISPATCH (server_conn);
+	TEST_DBUS_MESSAGE (client_conn, reply);
+
+	TEST_TRUE (dbus_message_is_error (reply, DBUS_ERROR_INVALID_ARGS));
+	TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+
+	dbus_message_unref (reply);
+
+	nih_free (object);
+	nih_free (manager);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	nih_error_init ();
+
+	test_new ();
+	test_add ();
+	test_remove ();
+	test_get_managed_objects ();
+
+	return 0;
+}
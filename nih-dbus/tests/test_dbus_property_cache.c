@@ -0,0 +1,783 @@
+/* libnih
+ *
+ * test_dbus_property_cache.c - test suite for nih-dbus/dbus_property_cache.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+#include <nih-dbus/test_dbus.h>
+
+#include <dbus/dbus.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_proxy.h>
+#include <nih-dbus/dbus_property_cache.h>
+#include <nih-dbus/errors.h>
+
+
+typedef struct my_properties {
+	uint32_t size;
+	char *   name;
+} MyProperties;
+
+static const char * const my_names[] = {
+	"size",
+	"name",
+	NULL
+};
+
+static int
+my_update (MyProperties *   properties,
+	   const char *     name,
+	   DBusMessageIter *iter)
+{
+	DBusMessageIter variter;
+	const char *    str;
+	char *          value;
+
+	TEST_NE_P (properties, NULL);
+	TEST_NE_P (name, NULL);
+	TEST_NE_P (iter, NULL);
+
+	if (dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_VARIANT)
+		nih_return_error (-1, NIH_DBUS_INVALID_ARGS,
+				  _(NIH_DBUS_INVALID_ARGS_STR));
+
+	dbus_message_iter_recurse (iter, &variter);
+
+	if (! strcmp (name, "size")) {
+		if (dbus_message_iter_get_arg_type (&variter) != DBUS_TYPE_UINT32)
+			nih_return_error (-1, NIH_DBUS_INVALID_ARGS,
+					  _(NIH_DBUS_INVALID_ARGS_STR));
+
+		dbus_message_iter_get_basic (&variter, &properties->size);
+	} else if (! strcmp (name, "name")) {
+		if (dbus_message_iter_get_arg_type (&variter) != DBUS_TYPE_STRING)
+			nih_return_error (-1, NIH_DBUS_INVALID_ARGS,
+					  _(NIH_DBUS_INVALID_ARGS_STR));
+
+		dbus_message_iter_get_basic (&variter, &str);
+
+		value = nih_strdup (properties, str);
+		if (! value)
+			nih_return_no_memory_error (-1);
+
+		if (properties->name)
+			nih_unref (properties->name, properties);
+		properties->name = value;
+	}
+
+	return 0;
+}
+
+static int   my_handler_called = 0;
+static char *last_name = NULL;
+
+static void
+my_handler (void *                data,
+	    NihDBusPropertyCache *cache,
+	    const char *          name)
+{
+	my_handler_called++;
+
+	TEST_NE_P (cache, NULL);
+	TEST_EQ_P (data, cache->proxy);
+
+	if (last_name)
+		nih_free (last_name);
+	last_name = name ? NIH_MUST (nih_strdup (NULL, name)) : NULL;
+}
+
+static int properties_changed_seen = 0;
+
+static DBusHandlerResult
+my_filter (DBusConnection *connection,
+	   DBusMessage *   message,
+	   void *          data)
+{
+	if (dbus_message_is_signal (message, DBUS_INTERFACE_PROPERTIES,
+				    "PropertiesChanged"))
+		properties_changed_seen++;
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static void
+append_entry (DBusMessageIter *arrayiter,
+	      const char *     name,
+	      int              type,
+	      const void *     value)
+{
+	DBusMessageIter dictiter;
+	DBusMessageIter variter;
+	char            signature[2] = { type, '\0' };
+
+	assert (dbus_message_iter_open_container (arrayiter, DBUS_TYPE_DICT_ENTRY,
+						  NULL, &dictiter));
+	assert (dbus_message_iter_append_basic (&dictiter, DBUS_TYPE_STRING,
+						&name));
+	assert (dbus_message_iter_open_container (&dictiter, DBUS_TYPE_VARIANT,
+						  signature, &variter));
+	assert (dbus_message_iter_append_basic (&variter, type, value));
+	assert (dbus_message_iter_close_container (&dictiter, &variter));
+	assert (dbus_message_iter_close_container (arrayiter, &dictiter));
+}
+
+static void
+reply_get_all (DBusConnection *conn,
+	       uint32_t        size,
+	       const char *    name)
+{
+	DBusMessage *   method_call;
+	DBusMessage *   reply;
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+
+	TEST_DBUS_MESSAGE (conn, method_call);
+	TEST_TRUE (dbus_message_is_method_call (method_call,
+						DBUS_INTERFACE_PROPERTIES,
+						"GetAll"));
+
+	if (name) {
+		reply = dbus_message_new_method_return (method_call);
+		assert (reply != NULL);
+
+		dbus_message_iter_init_append (reply, &iter);
+
+		assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+							  (DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+							   DBUS_TYPE_STRING_AS_STRING
+							   DBUS_TYPE_VARIANT_AS_STRING
+							   DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+							  &arrayiter));
+		append_entry (&arrayiter, "size", DBUS_TYPE_UINT32, &size);
+		append_entry (&arrayiter, "name", DBUS_TYPE_STRING, &name);
+		assert (dbus_message_iter_close_container (&iter, &arrayiter));
+	} else {
+		reply = dbus_message_new_error (method_call,
+						DBUS_ERROR_UNKNOWN_METHOD,
+						"No such method");
+		assert (reply != NULL);
+	}
+
+	assert (dbus_connection_send (conn, reply, NULL));
+	dbus_connection_flush (conn);
+
+	dbus_message_unref (reply);
+	dbus_message_unref (method_call);
+}
+
+static void
+emit_properties_changed (DBusConnection *conn,
+			 const char *    destination,
+			 const char *    interface,
+			 const char *    changed,
+			 const char *    invalidated)
+{
+	DBusMessage *   signal;
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+	uint32_t        value = 42;
+
+	signal = dbus_message_new_signal ("/com/netsplit/Nih",
+					  DBUS_INTERFACE_PROPERTIES,
+					  "PropertiesChanged");
+	assert (signal != NULL);
+
+	if (destination)
+		assert (dbus_message_set_destination (signal, destination));
+
+	dbus_message_iter_init_append (signal, &iter);
+
+	assert (dbus_message_iter_append_basic (&iter, DBUS_TYPE_STRING,
+						&interface));
+
+	assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+						  (DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+						   DBUS_TYPE_STRING_AS_STRING
+						   DBUS_TYPE_VARIANT_AS_STRING
+						   DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+						  &arrayiter));
+	if (changed)
+		append_entry (&arrayiter, changed, DBUS_TYPE_UINT32, &value);
+	assert (dbus_message_iter_close_container (&iter, &arrayiter));
+
+	assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+						  DBUS_TYPE_STRING_AS_STRING,
+						  &arrayiter));
+	if (invalidated)
+		assert (dbus_message_iter_append_basic (&arrayiter, DBUS_TYPE_STRING,
+							&invalidated));
+	assert (dbus_message_iter_close_container (&iter, &arrayiter));
+
+	assert (dbus_connection_send (conn, signal, NULL));
+	dbus_connection_flush (conn);
+
+	dbus_message_unref (signal);
+}
+
+
+void
+test_new (void)
+{
+	pid_t                 dbus_pid;
+	DBusConnection *      conn;
+	DBusConnection *      server_conn;
+	NihDBusProxy *        proxy = NULL;
+	NihDBusPropertyCache *cache;
+	MyProperties *        properties;
+
+	TEST_FUNCTION ("nih_dbus_property_cache_new");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (server_conn);
+
+
+	/* Check that a new cache is allocated as a child of the proxy
+	 * with a zeroed structure for the values, none of which are valid,
+	 * and that a GetAll call is made for them.
+	 */
+	TEST_FEATURE ("with proxy");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			proxy = nih_dbus_proxy_new (NULL, conn,
+						    dbus_bus_get_unique_name (server_conn),
+						    "/com/netsplit/Nih",
+						    NULL, NULL);
+		}
+
+		cache = nih_dbus_property_cache_new (proxy,
+						     "com.netsplit.Nih.Test",
+						     my_names,
+						     sizeof (MyProperties),
+						     (NihDBusPropertyCacheUpdate)my_update,
+						     my_handler, proxy);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (cache, NULL);
+
+			nih_free (nih_error_get ());
+
+			/* Constructs the rule when we free */
+			TEST_ALLOC_SAFE {
+				nih_free (proxy);
+			}
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (cache, sizeof (NihDBusPropertyCache));
+		TEST_ALLOC_PARENT (cache, proxy);
+		TEST_EQ_P (cache->proxy, proxy);
+		TEST_EQ_STR (cache->interface, "com.netsplit.Nih.Test");
+		TEST_ALLOC_PARENT (cache->interface, cache);
+		TEST_EQ_P (cache->names, my_names);
+		TEST_ALLOC_PARENT (cache->valid, cache);
+		TEST_FALSE (cache->valid[0]);
+		TEST_FALSE (cache->valid[1]);
+		TEST_EQ_P (cache->update, (NihDBusPropertyCacheUpdate)my_update);
+		TEST_NE_P (cache->pending_call, NULL);
+		TEST_EQ_P (cache->handler, my_handler);
+		TEST_EQ_P (cache->data, proxy);
+
+		properties = cache->properties;
+		TEST_ALLOC_SIZE (properties, sizeof (MyProperties));
+		TEST_ALLOC_PARENT (properties, cache);
+		TEST_EQ (properties->size, 0);
+		TEST_EQ_P (properties->name, NULL);
+
+		TEST_FREE_TAG (cache);
+
+		/* Constructs the rules when we free */
+		TEST_ALLOC_SAFE {
+			nih_free (proxy);
+		}
+
+		TEST_FREE (cache);
+	}
+
+
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_lookup (void)
+{
+	pid_t                 dbus_pid;
+	DBusConnection *      conn;
+	DBusConnection *      server_conn;
+	NihDBusProxy *        proxy;
+	NihDBusPropertyCache *cache;
+	MyProperties *        properties;
+	NihError *            err;
+
+	TEST_FUNCTION ("nih_dbus_property_cache_lookup");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (server_conn);
+
+	proxy = nih_dbus_proxy_new (NULL, conn,
+				    dbus_bus_get_unique_name (server_conn),
+				    "/com/netsplit/Nih", NULL, NULL);
+	assert (proxy != NULL);
+
+
+	/* Check that reading a value before the reply to the GetAll call
+	 * has been received returns an error immediately.
+	 */
+	TEST_FEATURE ("with value not yet received");
+	cache = nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+					     my_names, sizeof (MyProperties),
+					     (NihDBusPropertyCacheUpdate)my_update,
+					     my_handler, proxy);
+	assert (cache != NULL);
+
+	my_handler_called = 0;
+
+	properties = nih_dbus_property_cache_lookup (cache, "size");
+
+	TEST_EQ_P (properties, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+	TEST_EQ (my_handler_called, 0);
+
+
+	/* Check that once the reply has been received the values are
+	 * stored in the structure and may be read, and the handler called
+	 * with a NULL name.
+	 */
+	TEST_FEATURE ("with values received");
+	reply_get_all (server_conn, 1234, "foo");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	TEST_EQ (my_handler_called, 1);
+	TEST_EQ_P (last_name, NULL);
+	TEST_EQ_P (cache->pending_call, NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "size");
+
+	TEST_EQ_P (properties, cache->properties);
+	TEST_EQ (properties->size, 1234);
+	TEST_EQ_STR (properties->name, "foo");
+	TEST_ALLOC_PARENT (properties->name, properties);
+
+	properties = nih_dbus_property_cache_lookup (cache, "name");
+
+	TEST_EQ_P (properties, cache->properties);
+
+	nih_free (cache);
+
+
+	/* Check that an error reply leaves the values invalid, and that
+	 * the next read makes another GetAll call.
+	 */
+	TEST_FEATURE ("with error reply");
+	cache = nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+					     my_names, sizeof (MyProperties),
+					     (NihDBusPropertyCacheUpdate)my_update,
+					     my_handler, proxy);
+	assert (cache != NULL);
+
+	my_handler_called = 0;
+
+	reply_get_all (server_conn, 0, NULL);
+
+	TEST_DBUS_DISPATCH (conn);
+
+	TEST_EQ (my_handler_called, 0);
+	TEST_EQ_P (cache->pending_call, NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "size");
+
+	TEST_EQ_P (properties, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+	TEST_NE_P (cache->pending_call, NULL);
+
+	reply_get_all (server_conn, 1234, "foo");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	properties = nih_dbus_property_cache_lookup (cache, "size");
+
+	TEST_NE_P (properties, NULL);
+	TEST_EQ (properties->size, 1234);
+
+	nih_free (cache);
+
+
+	nih_free (proxy);
+
+	if (last_name)
+		nih_free (last_name);
+	last_name = NULL;
+
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_get (void)
+{
+	pid_t                 dbus_pid;
+	DBusConnection *      conn;
+	DBusConnection *      server_conn;
+	NihDBusProxy *        proxy;
+	NihDBusPropertyCache *cache;
+	void *                properties;
+	NihError *            err;
+	int                   ret;
+
+	TEST_FUNCTION ("nih_dbus_property_cache_get");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (server_conn);
+
+	proxy = nih_dbus_proxy_new (NULL, conn,
+				    dbus_bus_get_unique_name (server_conn),
+				    "/com/netsplit/Nih", NULL, NULL);
+	assert (proxy != NULL);
+
+	cache = nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+					     my_names, sizeof (MyProperties),
+					     (NihDBusPropertyCacheUpdate)my_update,
+					     NULL, NULL);
+	assert (cache != NULL);
+
+
+	/* Check that reading all of the values before they have been
+	 * received returns an error immediately.
+	 */
+	TEST_FEATURE ("with values not yet received");
+	properties = NULL;
+
+	ret = nih_dbus_property_cache_get (cache, &properties);
+
+	TEST_LT (ret, 0);
+	TEST_EQ_P (properties, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+
+	/* Check that once they have been received, the structure holding
+	 * them is returned.
+	 */
+	TEST_FEATURE ("with values received");
+	reply_get_all (server_conn, 1234, "foo");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	ret = nih_dbus_property_cache_get (cache, &properties);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_P (properties, cache->properties);
+	TEST_EQ (((MyProperties *)properties)->size, 1234);
+
+
+	nih_free (proxy);
+
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_invalidate (void)
+{
+	pid_t                 dbus_pid;
+	DBusConnection *      conn;
+	DBusConnection *      server_conn;
+	NihDBusProxy *        proxy;
+	NihDBusPropertyCache *cache;
+	MyProperties *        properties;
+	char *                name;
+	NihError *            err;
+
+	TEST_FUNCTION ("nih_dbus_property_cache_invalidate");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (server_conn);
+
+	proxy = nih_dbus_proxy_new (NULL, conn,
+				    dbus_bus_get_unique_name (server_conn),
+				    "/com/netsplit/Nih", NULL, NULL);
+	assert (proxy != NULL);
+
+	cache = nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+					     my_names, sizeof (MyProperties),
+					     (NihDBusPropertyCacheUpdate)my_update,
+					     my_handler, proxy);
+	assert (cache != NULL);
+
+	reply_get_all (server_conn, 1234, "foo");
+
+	TEST_DBUS_DISPATCH (conn);
+
+
+	/* Check that invalidating the cache makes the values unreadable,
+	 * calls the handler with a NULL name and makes a GetAll call
+	 * to refetch them, while a reference the caller held to a value
+	 * remains valid.
+	 */
+	TEST_FEATURE ("with values");
+	my_handler_called = 0;
+
+	properties = cache->properties;
+	name = properties->name;
+	nih_ref (name, proxy);
+
+	nih_dbus_property_cache_invalidate (cache);
+
+	TEST_EQ (my_handler_called, 1);
+	TEST_EQ_P (last_name, NULL);
+	TEST_NE_P (cache->pending_call, NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "name");
+
+	TEST_EQ_P (properties, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+
+	/* Check that the values can be read again once the reply has
+	 * been received.
+	 */
+	TEST_FEATURE ("with values refetched");
+	TEST_FREE_TAG (name);
+
+	reply_get_all (server_conn, 5678, "bar");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	TEST_NOT_FREE (name);
+	TEST_EQ_STR (name, "foo");
+	nih_free (name);
+
+	properties = nih_dbus_property_cache_lookup (cache, "name");
+
+	TEST_NE_P (properties, NULL);
+	TEST_EQ (properties->size, 5678);
+	TEST_EQ_STR (properties->name, "bar");
+
+
+	nih_free (proxy);
+
+	if (last_name)
+		nih_free (last_name);
+	last_name = NULL;
+
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+void
+test_changed (void)
+{
+	pid_t                 dbus_pid;
+	DBusConnection *      conn;
+	DBusConnection *      server_conn;
+	NihDBusProxy *        proxy;
+	NihDBusPropertyCache *cache;
+	MyProperties *        properties;
+	NihError *            err;
+
+	TEST_FUNCTION ("nih_dbus_property_cache_changed");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+	TEST_DBUS_OPEN (server_conn);
+
+	proxy = nih_dbus_proxy_new (NULL, conn,
+				    dbus_bus_get_unique_name (server_conn),
+				    "/com/netsplit/Nih", NULL, NULL);
+	assert (proxy != NULL);
+
+	cache = nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+					     my_names, sizeof (MyProperties),
+					     (NihDBusPropertyCacheUpdate)my_update,
+					     my_handler, proxy);
+	assert (cache != NULL);
+
+	reply_get_all (server_conn, 1234, "foo");
+
+	TEST_DBUS_DISPATCH (conn);
+
+
+	/* Check that the PropertiesChanged signal for the cached interface
+	 * stores the new value of a changed property in the cache without
+	 * making another method call, and calls the handler with its name.
+	 */
+	TEST_FEATURE ("with changed property");
+	my_handler_called = 0;
+
+	emit_properties_changed (server_conn, NULL, "com.netsplit.Nih.Test",
+				 "size", NULL);
+
+	TEST_DBUS_DISPATCH (conn);
+
+	TEST_EQ (my_handler_called, 1);
+	TEST_EQ_STR (last_name, "size");
+	TEST_EQ_P (cache->pending_call, NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "size");
+
+	TEST_NE_P (properties, NULL);
+	TEST_EQ (properties->size, 42);
+	TEST_EQ_STR (properties->name, "foo");
+
+
+	/* Check that an invalidated property can't be read until it has
+	 * been refetched with a GetAll call, while the others still can,
+	 * and that the handler is called with its name.
+	 */
+	TEST_FEATURE ("with invalidated property");
+	my_handler_called = 0;
+
+	emit_properties_changed (server_conn, NULL, "com.netsplit.Nih.Test",
+				 NULL, "name");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	TEST_EQ (my_handler_called, 1);
+	TEST_EQ_STR (last_name, "name");
+	TEST_NE_P (cache->pending_call, NULL);
+
+	properties = nih_dbus_property_cache_lookup (cache, "name");
+
+	TEST_EQ_P (properties, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_DBUS_PROPERTY_NOT_CACHED);
+	nih_free (err);
+
+	properties = nih_dbus_property_cache_lookup (cache, "size");
+
+	TEST_NE_P (properties, NULL);
+	TEST_EQ (properties->size, 42);
+
+	reply_get_all (server_conn, 42, "bar");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	properties = nih_dbus_property_cache_lookup (cache, "name");
+
+	TEST_NE_P (properties, NULL);
+	TEST_EQ_STR (properties->name, "bar");
+
+
+	/* Check that the signal for a different interface is ignored.
+	 */
+	TEST_FEATURE ("with different interface");
+	my_handler_called = 0;
+
+	emit_properties_changed (server_conn, dbus_bus_get_unique_name (conn),
+				 "com.netsplit.Nih.Other", NULL, "name");
+
+	TEST_DBUS_DISPATCH (conn);
+
+	TEST_EQ (my_handler_called, 0);
+	TEST_EQ_P (cache->pending_call, NULL);
+
+
+	nih_free (proxy);
+
+
+	/* Check that when the proxied name has no owner, the signal is
+	 * ignored whoever sends it.
+	 */
+	TEST_FEATURE ("with name that has no owner");
+	proxy = nih_dbus_proxy_new (NULL, conn, "com.netsplit.Nih.Nobody",
+				    "/com/netsplit/Nih", NULL, NULL);
+	assert (proxy != NULL);
+	proxy->auto_start = FALSE;
+
+	TEST_EQ_P (proxy->owner, NULL);
+
+	cache = nih_dbus_property_cache_new (proxy, "com.netsplit.Nih.Test",
+					     my_names, sizeof (MyProperties),
+					     (NihDBusPropertyCacheUpdate)my_update,
+					     my_handler, proxy);
+	assert (cache != NULL);
+
+	my_handler_called = 0;
+
+	properties_changed_seen = 0;
+	assert (dbus_connection_add_filter (conn, my_filter, NULL, NULL));
+
+	emit_properties_changed (server_conn, dbus_bus_get_unique_name (conn),
+				 "com.netsplit.Nih.Test", "size", NULL);
+
+	while (cache->pending_call || (! properties_changed_seen))
+		TEST_DBUS_DISPATCH (conn);
+
+	dbus_connection_remove_filter (conn, my_filter, NULL);
+
+	TEST_EQ (my_handler_called, 0);
+	TEST_FALSE (cache->valid[0]);
+
+	nih_free (proxy);
+
+
+	if (last_name)
+		nih_free (last_name);
+	last_name = NULL;
+
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_new ();
+	test_lookup ();
+	test_get ();
+	test_invalidate ();
+	test_changed ();
+
+	return 0;
+}
@@ -0,0 +1,324 @@
+/* libnih
+ *
+ * test_dbus_stats.c - test suite for nih-dbus/dbus_stats.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+#include <nih-dbus/test_dbus.h>
+
+#include <dbus/dbus.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/metrics.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_connection.h>
+#include <nih-dbus/dbus_object.h>
+#include <nih-dbus/dbus_stats.h>
+
+
+void
+test_new (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *conn;
+	NihDBusObject * object;
+	void *          data;
+
+	/* Check that the statistics object is registered on the connection
+	 * at the well-known path, and that metrics collection is enabled.
+	 */
+	TEST_FUNCTION ("nih_dbus_stats_new");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+
+	TEST_ALLOC_FAIL {
+		nih_metrics_enable (FALSE);
+
+		object = nih_dbus_stats_new (NULL, conn);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (object, NULL);
+			TEST_FALSE (nih_metrics_enabled);
+			continue;
+		}
+
+		TEST_EQ_STR (object->path, NIH_DBUS_STATS_PATH);
+		TEST_EQ_P (object->connection, conn);
+		TEST_TRUE (object->registered);
+		TEST_TRUE (nih_metrics_enabled);
+
+		TEST_TRUE (dbus_connection_get_object_path_data (
+				   conn, NIH_DBUS_STATS_PATH, &data));
+		TEST_EQ_P (data, object);
+
+		nih_free (object);
+	}
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+void
+test_get_property (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusObject * object;
+	DBusMessage *   message;
+	DBusMessage *   reply;
+	DBusMessageIter iter;
+	DBusMessageIter subiter;
+	dbus_uint32_t   serial;
+	const char *    interface_name;
+	const char *    property_name;
+	dbus_uint64_t   value;
+
+	/* Check that the live bytes allocated can be obtained from the
+	 * read-only property, and is not zero since the object itself was
+	 * allocated.
+	 */
+	TEST_FUNCTION ("AllocLiveBytes");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+	object = nih_dbus_stats_new (NULL, server_conn);
+
+	message = dbus_message_new_method_call (
+		dbus_bus_get_unique_name (server_conn),
+		NIH_DBUS_STATS_PATH,
+		DBUS_INTERFACE_PROPERTIES,
+		"Get");
+	assert (message != NULL);
+
+	dbus_message_iter_init_append (message, &iter);
+
+	interface_name = "com.netsplit.Nih.Stats";
+	assert (dbus_message_iter_append_basic (&iter, DBUS_TYPE_STRING,
+						&interface_name));
+
+	property_name = "AllocLiveBytes";
+	assert (dbus_message_iter_append_basic (&iter, DBUS_TYPE_STRING,
+						&property_name));
+
+	assert (dbus_connection_send (client_conn, message, &serial));
+	dbus_connection_flush (client_conn);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_DISPATCH (server_conn);
+
+	TEST_DBUS_MESSAGE (client_conn, reply);
+
+	TEST_EQ (dbus_message_get_type (reply),
+		 DBUS_MESSAGE_TYPE_METHOD_RETURN);
+	TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+
+	TEST_TRUE (dbus_message_has_signature (reply, "v"));
+
+	dbus_message_iter_init (reply, &iter);
+	dbus_message_iter_recurse (&iter, &subiter);
+
+	TEST_EQ (dbus_message_iter_get_arg_type (&subiter),
+		 DBUS_TYPE_UINT64);
+
+	dbus_message_iter_get_basic (&subiter, &value);
+
+	TEST_GT (value, 0);
+
+	dbus_message_unref (reply);
+
+	nih_free (object);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+void
+test_get_snapshot (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	DBusConnection *client_conn;
+	NihDBusObject * object;
+	DBusMessage *   message;
+	DBusMessage *   reply;
+	DBusMessageIter iter;
+	DBusMessageIter arrayiter;
+	DBusMessageIter dictiter;
+	dbus_uint32_t   serial;
+	const char *    name;
+	dbus_uint64_t   value;
+	dbus_int64_t    gauge;
+	dbus_uint64_t   count;
+	int             found_bytes = FALSE;
+	int             found_gauge = FALSE;
+	int             found_calls = FALSE;
+	int             found_histogram = FALSE;
+
+	/* Check that the snapshot method returns the values of counters,
+	 * gauges and histograms each with their own type, including the
+	 * library's own, the count of method calls which includes this one
+	 * and a gauge with a negative value.
+	 */
+	TEST_FUNCTION ("GetSnapshot");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+	TEST_DBUS_OPEN (client_conn);
+
+	object = nih_dbus_stats_new (NULL, server_conn);
+
+	nih_metric_set (nih_metric_gauge ("test_gauge"), -42);
+	nih_metric_record (nih_metric_histogram ("test_histogram"), 100);
+
+	message = dbus_message_new_method_call (
+		dbus_bus_get_unique_name (server_conn),
+		NIH_DBUS_STATS_PATH,
+		"com.netsplit.Nih.Stats",
+		"GetSnapshot");
+	assert (message != NULL);
+
+	assert (dbus_connection_send (client_conn, message, &serial));
+	dbus_connection_flush (client_conn);
+
+	dbus_message_unref (message);
+
+	TEST_DBUS_DISPATCH (server_conn);
+
+	TEST_DBUS_MESSAGE (client_conn, reply);
+
+	TEST_EQ (dbus_message_get_type (reply),
+		 DBUS_MESSAGE_TYPE_METHOD_RETURN);
+	TEST_EQ (dbus_message_get_reply_serial (reply), serial);
+
+	TEST_TRUE (dbus_message_has_signature (reply,
+					       "a{st}a{sx}a(sttttttt)"));
+
+	dbus_message_iter_init (reply, &iter);
+
+	/* Counters */
+	dbus_message_iter_recurse (&iter, &arrayiter);
+
+	while (dbus_message_iter_get_arg_type (&arrayiter)
+	       == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse (&arrayiter, &dictiter);
+
+		dbus_message_iter_get_basic (&dictiter, &name);
+		dbus_message_iter_next (&dictiter);
+		dbus_message_iter_get_basic (&dictiter, &value);
+
+		if (! strcmp (name, "dbus_method_calls")) {
+			TEST_GE (value, 1);
+			found_calls = TRUE;
+		}
+
+		dbus_message_iter_next (&arrayiter);
+	}
+
+	dbus_message_iter_next (&iter);
+
+	/* Gauges */
+	dbus_message_iter_recurse (&iter, &arrayiter);
+
+	while (dbus_message_iter_get_arg_type (&arrayiter)
+	       == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse (&arrayiter, &dictiter);
+
+		dbus_message_iter_get_basic (&dictiter, &name);
+		dbus_message_iter_next (&dictiter);
+		dbus_message_iter_get_basic (&dictiter, &gauge);
+
+		if (! strcmp (name, "alloc_live_bytes")) {
+			TEST_GT (gauge, 0);
+			found_bytes = TRUE;
+		} else if (! strcmp (name, "test_gauge")) {
+			TEST_EQ (gauge, -42);
+			found_gauge = TRUE;
+		}
+
+		dbus_message_iter_next (&arrayiter);
+	}
+
+	dbus_message_iter_next (&iter);
+
+	/* Histograms */
+	dbus_message_iter_recurse (&iter, &arrayiter);
+
+	while (dbus_message_iter_get_arg_type (&arrayiter)
+	       == DBUS_TYPE_STRUCT) {
+		dbus_message_iter_recurse (&arrayiter, &dictiter);
+
+		dbus_message_iter_get_basic (&dictiter, &name);
+		dbus_message_iter_next (&dictiter);
+		dbus_message_iter_get_basic (&dictiter, &count);
+
+		if (! strcmp (name, "test_histogram")) {
+			TEST_EQ (count, 1);
+
+			dbus_message_iter_next (&dictiter);
+			dbus_message_iter_get_basic (&dictiter, &value);
+			TEST_EQ (value, 100);
+
+			found_histogram = TRUE;
+		}
+
+		dbus_message_iter_next (&arrayiter);
+	}
+
+	TEST_TRUE (found_bytes);
+	TEST_TRUE (found_gauge);
+	TEST_TRUE (found_calls);
+	TEST_TRUE (found_histogram);
+
+	dbus_message_unref (reply);
+
+	nih_free (object);
+
+	TEST_DBUS_CLOSE (client_conn);
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	nih_error_init ();
+
+	test_new ();
+	test_get_property ();
+	test_get_snapshot ();
+
+	return 0;
+}
@@ -27,6 +27,18 @@
 #include <malloc.h>
 #include <stdlib.h>
 
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+/* config.h defines __thread to nothing when the compiler doesn't support
+ * it, which would leave a single reference cache shared, unlocked, by
+ * every thread.
+ */
+#if ENABLE_THREADING && defined (__thread)
+# error "Thread-safe allocation requires compiler support for __thread"
+#endif /* ENABLE_THREADING && defined (__thread) */
+
 #include <nih/macros.h>
 #include <nih/logging.h>
 #include <nih/list.h>
@@ -75,6 +87,91 @@ typedef struct nih_alloc_ref {
 } NihAllocRef;
 
 
+/**
+ * NihAllocRefCache:
+ * @refs: first cached reference,
+ * @len: number of references in the cache,
+ * @registered: TRUE once the cache will be flushed on thread exit.
+ *
+ * Each thread keeps a small cache of freed NihAllocRef structures for
+ * re-use, saving a malloc() and free() pair for every object allocated
+ * and freed; without --enable-threading there is only one.  The cache
+ * is a singly-linked list through the @children_entry.next member of
+ * each reference.
+ *
+ * Only references are cached; the objects themselves are allocated
+ * with malloc(), which has per-thread caches of its own.
+ **/
+typedef struct nih_alloc_ref_cache {
+	NihAllocRef *refs;
+	size_t       len;
+	int          registered;
+} NihAllocRefCache;
+
+
+/**
+ * NIH_ALLOC_REF_CACHE:
+ *
+ * Maximum number of NihAllocRef structures kept in each thread's cache.
+ **/
+#define NIH_ALLOC_REF_CACHE 64
+
+/**
+ * NIH_ALLOC_LOCK:
+ *
+ * Locks the allocator when running in thread-safe mode, so that the
+ * parent and child lists of objects may be safely manipulated.
+ **/
+#if ENABLE_THREADING
+# define NIH_ALLOC_LOCK()					\
+	do {							\
+		if (thread_safe)				\
+			pthread_mutex_lock (&alloc_lock);	\
+	} while (0)
+#else /* ENABLE_THREADING */
+# define NIH_ALLOC_LOCK()
+#endif /* ENABLE_THREADING */
+
+/**
+ * NIH_ALLOC_UNLOCK:
+ *
+ * Unlocks the allocator after a call to NIH_ALLOC_LOCK().
+ **/
+#if ENABLE_THREADING
+# define NIH_ALLOC_UNLOCK()					\
+	do {							\
+		if (thread_safe)				\
+			pthread_mutex_unlock (&alloc_lock);	\
+	} while (0)
+#else /* ENABLE_THREADING */
+# define NIH_ALLOC_UNLOCK()
+#endif /* ENABLE_THREADING */
+
+/**
+ * NIH_ALLOC_ACCOUNT:
+ * @_add: bytes allocated,
+ * @_sub: bytes returned.
+ *
+ * Updates the count of live bytes, atomically when running in
+ * thread-safe mode since allocations without a parent don't lock.
+ **/
+#if ENABLE_THREADING
+# define NIH_ALLOC_ACCOUNT(_add, _sub)					\
+	do {								\
+		if (thread_safe) {					\
+			__atomic_add_fetch (&live_bytes, (_add) - (_sub), \
+					    __ATOMIC_RELAXED);		\
+		} else {						\
+			live_bytes += (_add) - (_sub);			\
+		}							\
+	} while (0)
+#else /* ENABLE_THREADING */
+# define NIH_ALLOC_ACCOUNT(_add, _sub)			\
+	do {						\
+		live_bytes += (_add) - (_sub);		\
+	} while (0)
+#endif /* ENABLE_THREADING */
+
 /**
  * NIH_ALLOC_SIZE:
  *
@@ -116,13 +213,23 @@ typedef struct nih_alloc_ref {
 
 
 /* Prototypes for static functions */
-static inline int          nih_alloc_context_free   (NihAllocCtx *ctx);
+static inline int          nih_alloc_context_free     (NihAllocCtx *ctx);
+static inline int          nih_alloc_context_finalise (NihAllocCtx *ctx);
+static inline size_t       nih_alloc_context_release  (NihAllocCtx *ctx,
+						       size_t max);
 
-static inline NihAllocRef *nih_alloc_ref_new        (NihAllocCtx *parent,
-						     NihAllocCtx *child);
-static inline void         nih_alloc_ref_free       (NihAllocRef *ref);
-static inline NihAllocRef *nih_alloc_ref_lookup     (NihAllocCtx *parent,
-						     NihAllocCtx *child);
+static inline NihAllocRef *nih_alloc_ref_new          (NihAllocCtx *parent,
+						       NihAllocCtx *child);
+static inline void         nih_alloc_ref_free         (NihAllocRef *ref);
+static inline NihAllocRef *nih_alloc_ref_lookup       (NihAllocCtx *parent,
+						       NihAllocCtx *child);
+
+static inline NihAllocRef *nih_alloc_ref_get          (void);
+static inline void         nih_alloc_ref_put          (NihAllocRef *ref);
+#if ENABLE_THREADING
+static void                nih_alloc_ref_cache_init   (void);
+static void                nih_alloc_ref_cache_free   (void *ptr);
+#endif /* ENABLE_THREADING */
 
 
 /* Point to the functions we actually call for allocation. */
@@ -131,6 +238,109 @@ void *(*__nih_realloc) (void *ptr, size_t size) = realloc;
 void  (*__nih_free)    (void *ptr)              = free;
 
 
+/**
+ * ref_cache:
+ *
+ * Cache of freed references for the current thread.
+ **/
+static __thread NihAllocRefCache ref_cache = { NULL, 0, FALSE };
+
+/**
+ * deferred:
+ *
+ * List of finalised contexts, linked through their empty parents list,
+ * whose memory is yet to be returned by nih_alloc_reclaim().
+ **/
+static NihList deferred = { &deferred, &deferred };
+
+/**
+ * live_bytes:
+ *
+ * Total size of all objects allocated and not yet returned to the system,
+ * including those finalised but awaiting nih_alloc_reclaim().
+ **/
+static size_t live_bytes = 0;
+
+#if ENABLE_THREADING
+/**
+ * thread_safe:
+ *
+ * TRUE once nih_alloc_set_thread_safe() has been called, at which point
+ * all manipulation of references takes @alloc_lock.
+ **/
+static int thread_safe = FALSE;
+
+/**
+ * alloc_lock:
+ *
+ * Lock held while manipulating references in thread-safe mode; it's
+ * recursive since destructors are called with it held and may free or
+ * unreference other objects.
+ **/
+static pthread_mutex_t alloc_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+/**
+ * ref_cache_once:
+ *
+ * Ensures @ref_cache_key is only created once.
+ **/
+static pthread_once_t ref_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * ref_cache_key:
+ *
+ * Thread-specific key whose destructor flushes a thread's reference
+ * cache when the thread exits.
+ **/
+static pthread_key_t ref_cache_key;
+#endif /* ENABLE_THREADING */
+
+
+/**
+ * nih_alloc_set_thread_safe:
+ * @enable: TRUE to enable thread-safe mode.
+ *
+ * Enables the thread-safe mode of the allocator, in which all changes
+ * to the parent and child references of objects are serialised by a
+ * single recursive lock shared by the whole allocator, so that objects
+ * may be allocated in one thread and handed to another.  This
+ * must be called before any additional threads are created, and once
+ * enabled the mode cannot be disabled again.
+ *
+ * Allocation of an object without a parent in a worker thread touches no
+ * shared state, and such objects may be handed to the main thread which
+ * takes its own reference with nih_ref() before the worker drops its
+ * reference with nih_discard() or nih_unref(); only after that should
+ * the worker stop using the object.  A worker may also allocate an object
+ * with a parent owned by another thread, or free it, but must ensure by
+ * other means that the parent is not freed in the meantime.
+ *
+ * Destructors are called with the allocator lock held, so must not wait
+ * for another thread that may be allocating.
+ *
+ * The locking is only compiled in when libnih is configured with
+ * --enable-threading, which is not the default; otherwise this function
+ * does nothing and returns a negative value, and the allocator must only
+ * be used from a single thread.
+ *
+ * Returns: zero on success, negative value if libnih was built without
+ * support for threading.
+ **/
+int
+nih_alloc_set_thread_safe (int enable)
+{
+#if ENABLE_THREADING
+	nih_assert (enable || (! thread_safe));
+
+	thread_safe = enable;
+
+	return 0;
+#else /* ENABLE_THREADING */
+	return -1;
+#endif /* ENABLE_THREADING */
+}
+
+
 /**
  * nih_alloc:
  * @parent: parent object for new object,
@@ -165,7 +375,18 @@ nih_alloc (const void *parent,
 	ctx->destructor = NULL;
 	ctx->size = size;
 
-	nih_alloc_ref_new (NIH_ALLOC_CTX (parent), ctx);
+	NIH_ALLOC_ACCOUNT (size, 0);
+
+	/* Objects without a parent aren't visible to other threads, so
+	 * there's no need to lock.
+	 */
+	if (parent) {
+		NIH_ALLOC_LOCK ();
+		nih_alloc_ref_new (NIH_ALLOC_CTX (parent), ctx);
+		NIH_ALLOC_UNLOCK ();
+	} else {
+		nih_alloc_ref_new (NULL, ctx);
+	}
 
 	return NIH_ALLOC_PTR (ctx);
 }
@@ -197,10 +418,13 @@ nih_realloc (void *      ptr,
 	NihAllocCtx *ctx;
 	NihList *    first_parent = NULL;
 	NihList *    first_child = NULL;
+	size_t       old_size;
 
 	if (! ptr)
 		return nih_alloc (parent, size);
 
+	NIH_ALLOC_LOCK ();
+
 	ctx = NIH_ALLOC_CTX (ptr);
 	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
 
@@ -232,6 +456,8 @@ nih_realloc (void *      ptr,
 	 * or NULL if the list is empty.
 	 */
 
+	old_size = ctx->size;
+
 	if (! NIH_LIST_EMPTY (&ctx->parents))
 		first_parent = ctx->parents.next;
 	if (! NIH_LIST_EMPTY (&ctx->children))
@@ -241,11 +467,15 @@ nih_realloc (void *      ptr,
 	 * return NULL since we've not actually changed anything.
 	 */
 	ctx = __nih_realloc (ctx, NIH_ALLOC_SIZE + size);
-	if (! ctx)
+	if (! ctx) {
+		NIH_ALLOC_UNLOCK ();
 		return NULL;
+	}
 
 	ctx->size = size;
 
+	NIH_ALLOC_ACCOUNT (size, old_size);
+
 	/* Now update our parents and children lists, or reinitialise,
 	 * as noted above this ensures that all the pointers are correct
 	 */
@@ -278,6 +508,8 @@ nih_realloc (void *      ptr,
 		ref->parent = ctx;
 	}
 
+	NIH_ALLOC_UNLOCK ();
+
 	return NIH_ALLOC_PTR (ctx);
 }
 
@@ -311,9 +543,12 @@ int
 nih_free (void *ptr)
 {
 	NihAllocCtx *ctx;
+	int          ret;
 
 	nih_assert (ptr != NULL);
 
+	NIH_ALLOC_LOCK ();
+
 	ctx = NIH_ALLOC_CTX (ptr);
 	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
 
@@ -329,7 +564,99 @@ nih_free (void *ptr)
 		nih_alloc_ref_free (ref);
 	}
 
-	return nih_alloc_context_free (ctx);
+	ret = nih_alloc_context_free (ctx);
+
+	NIH_ALLOC_UNLOCK ();
+
+	return ret;
+}
+
+/**
+ * nih_free_deferred:
+ * @ptr: object to free.
+ *
+ * Frees the object @ptr in the same way as nih_free(), except that only
+ * the destructors of @ptr and the children freed with it are called
+ * immediately; the memory itself is returned in bounded slices by later
+ * calls to nih_alloc_reclaim().
+ *
+ * This avoids long pauses when freeing very large trees of objects, such
+ * as a parsed configuration, from the main loop; which calls
+ * nih_alloc_reclaim() itself on each iteration.  The objects must not be
+ * used once this function returns, exactly as if they had been freed.
+ *
+ * Returns: return value from @ptr's destructor, or 0.
+ **/
+int
+nih_free_deferred (void *ptr)
+{
+	NihAllocCtx *ctx;
+	int          ret;
+
+	nih_assert (ptr != NULL);
+
+	NIH_ALLOC_LOCK ();
+
+	ctx = NIH_ALLOC_CTX (ptr);
+	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
+
+	NIH_LIST_FOREACH_SAFE (&ctx->parents, iter) {
+		NihAllocRef *ref = NIH_LIST_ITER (iter, NihAllocRef,
+						  parents_entry);
+
+		nih_alloc_ref_free (ref);
+	}
+
+	ret = nih_alloc_context_finalise (ctx);
+
+	/* The parents list is now unused, so link the context into the
+	 * deferred list through it.
+	 */
+	nih_list_add (&deferred, &ctx->parents);
+
+	NIH_ALLOC_UNLOCK ();
+
+	return ret;
+}
+
+/**
+ * nih_alloc_reclaim:
+ * @max: maximum number of objects to free.
+ *
+ * Returns the memory of up to @max objects previously freed with
+ * nih_free_deferred(), or all of them if @max is zero.  Objects are
+ * freed in the order they were passed to nih_free_deferred().
+ *
+ * This is called by the main loop on each iteration with
+ * NIH_ALLOC_RECLAIM_SLICE; in thread-safe mode it may instead be called
+ * from a separate reclaimer thread.
+ *
+ * Returns: TRUE if objects remain to be reclaimed, FALSE otherwise.
+ **/
+int
+nih_alloc_reclaim (size_t max)
+{
+	size_t count = 0;
+	int    ret;
+
+	NIH_ALLOC_LOCK ();
+
+	while (! NIH_LIST_EMPTY (&deferred)) {
+		NihAllocCtx *ctx = NIH_LIST_ITER (deferred.next, NihAllocCtx,
+						  parents);
+
+		count += nih_alloc_context_release (
+			ctx, max ? max - count : 0);
+
+		if (max && (count >= max))
+			break;
+	}
+
+	ret = NIH_LIST_EMPTY (&deferred) ? FALSE : TRUE;
+
+	NIH_ALLOC_UNLOCK ();
+
+	return ret;
 }
 
 /**
@@ -354,22 +681,26 @@ nih_discard (void *ptr)
 {
 	NihAllocCtx *ctx;
 	NihAllocRef *ref;
+	int          ret = 0;
 
 	nih_assert (ptr != NULL);
 
+	NIH_ALLOC_LOCK ();
+
 	ctx = NIH_ALLOC_CTX (ptr);
 	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
 
 	ref = nih_alloc_ref_lookup (NULL, ctx);
-	if (! ref)
-		return 0;
+	if (ref) {
+		nih_alloc_ref_free (ref);
 
-	nih_alloc_ref_free (ref);
+		if (NIH_LIST_EMPTY (&ctx->parents))
+			ret = nih_alloc_context_free (ctx);
+	}
 
-	if (NIH_LIST_EMPTY (&ctx->parents))
-		return nih_alloc_context_free (ctx);
+	NIH_ALLOC_UNLOCK ();
 
-	return 0;
+	return ret;
 }
 
 /**
@@ -393,6 +724,44 @@ _nih_discard_local (void *ptraddr)
 		nih_discard (*ptr);
 }
 
+/**
+ * nih_free_children:
+ * @ptr: object to empty.
+ *
+ * Removes the references from @ptr to all of its children, freeing those
+ * children that have no other parent references, while leaving @ptr
+ * itself allocated and its destructor unset.
+ *
+ * This has the same effect on the children as freeing @ptr would, and is
+ * useful to re-use a long-lived object as a context for short-lived
+ * allocations without allocating and freeing it each time.
+ **/
+void
+nih_free_children (void *ptr)
+{
+	NihAllocCtx *ctx;
+
+	nih_assert (ptr != NULL);
+
+	NIH_ALLOC_LOCK ();
+
+	ctx = NIH_ALLOC_CTX (ptr);
+	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
+
+	NIH_LIST_FOREACH_SAFE (&ctx->children, iter) {
+		NihAllocRef *ref = NIH_LIST_ITER (iter, NihAllocRef,
+						  children_entry);
+		NihAllocCtx *child = ref->child;
+
+		nih_alloc_ref_free (ref);
+
+		if (NIH_LIST_EMPTY (&child->parents))
+			nih_alloc_context_free (child);
+	}
+
+	NIH_ALLOC_UNLOCK ();
+}
+
 
 /**
  * nih_alloc_context_free:
@@ -414,6 +783,37 @@ _nih_discard_local (void *ptraddr)
  **/
 static inline int
 nih_alloc_context_free (NihAllocCtx *ctx)
+{
+	int ret;
+
+	nih_assert (ctx != NULL);
+
+	ret = nih_alloc_context_finalise (ctx);
+	nih_alloc_context_release (ctx, 0);
+
+	return ret;
+}
+
+/**
+ * nih_alloc_context_finalise:
+ * @ctx: context to finalise.
+ *
+ * This is the internal function called by nih_alloc_context_free() and
+ * nih_free_deferred() to call the destructors of @ctx and all of the
+ * children that will be freed along with it.
+ *
+ * All parent references must have been discarded prior to calling this
+ * function.
+ *
+ * Once this returns, the children list of @ctx contains references to
+ * every object that is to be freed, all of which have been finalised and
+ * have no other references; the tree is flattened this way so that it
+ * can be freed without recursion.
+ *
+ * Returns: return value from @ptr's destructor, or 0.
+ **/
+static inline int
+nih_alloc_context_finalise (NihAllocCtx *ctx)
 {
 	int ret = 0;
 
@@ -442,7 +842,7 @@ nih_alloc_context_free (NihAllocCtx *ctx)
 		nih_list_destroy (&ref->parents_entry);
 		if (! NIH_LIST_EMPTY (&ref->child->parents)) {
 			nih_list_destroy (&ref->children_entry);
-			free (ref);
+			nih_alloc_ref_put (ref);
 			continue;
 		}
 
@@ -470,6 +870,32 @@ nih_alloc_context_free (NihAllocCtx *ctx)
 		nih_list_add_after (iter, &_iter);
 	}
 
+	return ret;
+}
+
+/**
+ * nih_alloc_context_release:
+ * @ctx: finalised context,
+ * @max: maximum number of objects to free.
+ *
+ * This is the internal function used to free the memory of a context
+ * after it has been finalised with nih_alloc_context_finalise(), along
+ * with that of the children collected in its list.
+ *
+ * If @max is not zero, at most @max objects are freed, children first,
+ * and @ctx itself is only freed once it has no children left.
+ *
+ * Returns: number of objects freed.
+ **/
+static inline size_t
+nih_alloc_context_release (NihAllocCtx *ctx,
+			   size_t       max)
+{
+	size_t count = 0;
+
+	nih_assert (ctx != NULL);
+	nih_assert (ctx->destructor == NIH_ALLOC_FINALISED);
+
 	/* We now have a single list of children all of which have no
 	 * references back to us as their parent, and all of had their
 	 * destructors called.
@@ -480,16 +906,26 @@ nih_alloc_context_free (NihAllocCtx *ctx)
 		NihAllocRef *ref = NIH_LIST_ITER (iter, NihAllocRef,
 						  children_entry);
 
+		if (max && (count >= max))
+			return count;
+
+		NIH_ALLOC_ACCOUNT (0, ref->child->size);
 		__nih_free (ref->child);
 
 		nih_list_destroy (&ref->children_entry);
-		free (ref);
+		nih_alloc_ref_put (ref);
+		count++;
 	}
 
+	if (max && (count >= max))
+		return count;
+
 	/* And now we can free ourselves. */
+	nih_list_destroy (&ctx->parents);
+	NIH_ALLOC_ACCOUNT (0, ctx->size);
 	__nih_free (ctx);
 
-	return ret;
+	return count + 1;
 }
 
 
@@ -562,7 +998,9 @@ nih_ref (const void *ptr,
 {
 	nih_assert (ptr != NULL);
 
+	NIH_ALLOC_LOCK ();
 	nih_alloc_ref_new (NIH_ALLOC_CTX (parent), NIH_ALLOC_CTX (ptr));
+	NIH_ALLOC_UNLOCK ();
 }
 
 /**
@@ -586,7 +1024,7 @@ nih_alloc_ref_new (NihAllocCtx *parent,
 	nih_assert (child != NULL);
 	nih_assert (child->destructor != NIH_ALLOC_FINALISED);
 
-	ref = NIH_MUST (malloc (sizeof (NihAllocRef)));
+	ref = nih_alloc_ref_get ();
 
 	nih_list_init (&ref->children_entry);
 	nih_list_init (&ref->parents_entry);
@@ -625,6 +1063,8 @@ nih_unref (void *      ptr,
 
 	nih_assert (ptr != NULL);
 
+	NIH_ALLOC_LOCK ();
+
 	ctx = NIH_ALLOC_CTX (ptr);
 	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
 
@@ -635,6 +1075,8 @@ nih_unref (void *      ptr,
 
 	if (NIH_LIST_EMPTY (&ctx->parents))
 		nih_alloc_context_free (ctx);
+
+	NIH_ALLOC_UNLOCK ();
 }
 
 /**
@@ -656,8 +1098,104 @@ nih_alloc_ref_free (NihAllocRef *ref)
 	nih_list_destroy (&ref->children_entry);
 	nih_list_destroy (&ref->parents_entry);
 
-	free (ref);
+	nih_alloc_ref_put (ref);
+}
+
+/**
+ * nih_alloc_ref_get:
+ *
+ * This is the internal function used by nih_alloc_ref_new() to obtain
+ * memory for a new reference, taken from the current thread's cache if
+ * possible.  The returned reference is not initialised.
+ *
+ * Returns: uninitialised reference.
+ **/
+static inline NihAllocRef *
+nih_alloc_ref_get (void)
+{
+	NihAllocRef *ref;
+
+	if (! ref_cache.refs)
+		return NIH_MUST (malloc (sizeof (NihAllocRef)));
+
+	ref = ref_cache.refs;
+	ref_cache.refs = (NihAllocRef *)ref->children_entry.next;
+	ref_cache.len--;
+
+	return ref;
+}
+
+/**
+ * nih_alloc_ref_put:
+ * @ref: reference to free.
+ *
+ * This is the internal function used to return the memory of @ref once
+ * it has been removed from its lists, placing it in the current thread's
+ * cache unless that is already full.
+ **/
+static inline void
+nih_alloc_ref_put (NihAllocRef *ref)
+{
+	nih_assert (ref != NULL);
+
+	if (ref_cache.len >= NIH_ALLOC_REF_CACHE) {
+		free (ref);
+		return;
+	}
+
+#if ENABLE_THREADING
+	/* Make sure the cache is freed when a thread exits */
+	if (! ref_cache.registered) {
+		pthread_once (&ref_cache_once, nih_alloc_ref_cache_init);
+		pthread_setspecific (ref_cache_key, &ref_cache);
+		ref_cache.registered = TRUE;
+	}
+#endif /* ENABLE_THREADING */
+
+	ref->children_entry.next = (NihList *)ref_cache.refs;
+	ref_cache.refs = ref;
+	ref_cache.len++;
+}
+
+#if ENABLE_THREADING
+/**
+ * nih_alloc_ref_cache_init:
+ *
+ * Creates the thread-specific key used to flush reference caches on
+ * thread exit, called once through pthread_once().
+ **/
+static void
+nih_alloc_ref_cache_init (void)
+{
+	NIH_ZERO (pthread_key_create (&ref_cache_key,
+				      nih_alloc_ref_cache_free));
+}
+
+/**
+ * nih_alloc_ref_cache_free:
+ * @ptr: thread's reference cache.
+ *
+ * Frees all references in the cache @ptr, called when the thread that
+ * owns it exits.
+ **/
+static void
+nih_alloc_ref_cache_free (void *ptr)
+{
+	NihAllocRefCache *cache = ptr;
+
+	nih_assert (cache != NULL);
+
+	while (cache->refs) {
+		NihAllocRef *ref = cache->refs;
+
+		cache->refs = (NihAllocRef *)ref->children_entry.next;
+		free (ref);
+	}
+
+	cache->len = 0;
+	cache->registered = FALSE;
 }
+#endif /* ENABLE_THREADING */
 
 
 /**
@@ -678,14 +1216,48 @@ nih_alloc_parent (const void *ptr,
 
 	nih_assert (ptr != NULL);
 
+	NIH_ALLOC_LOCK ();
+
 	ctx = NIH_ALLOC_CTX (ptr);
 	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
 
 	ref = nih_alloc_ref_lookup (NIH_ALLOC_CTX (parent), ctx);
 
+	NIH_ALLOC_UNLOCK ();
+
 	return ref ? TRUE : FALSE;
 }
 
+/**
+ * nih_alloc_parents:
+ * @ptr: object to query.
+ *
+ * Counts the parent references to @ptr, including that of the special
+ * NULL parent.
+ *
+ * Returns: number of parent references.
+ **/
+size_t
+nih_alloc_parents (const void *ptr)
+{
+	NihAllocCtx *ctx;
+	size_t       count = 0;
+
+	nih_assert (ptr != NULL);
+
+	NIH_ALLOC_LOCK ();
+
+	ctx = NIH_ALLOC_CTX (ptr);
+	nih_assert (ctx->destructor != NIH_ALLOC_FINALISED);
+
+	NIH_LIST_FOREACH (&ctx->parents, iter)
+		count++;
+
+	NIH_ALLOC_UNLOCK ();
+
+	return count;
+}
+
 /**
  * nih_alloc_ref_lookup:
  * @parent: parent context,
@@ -737,3 +1309,15 @@ nih_alloc_size (const void *ptr)
 
 	return ctx->size;
 }
+
+/**
+ * nih_alloc_live_bytes:
+ *
+ * Returns: the total size of all objects that have been allocated and
+ * not yet returned to the system.
+ **/
+size_t
+nih_alloc_live_bytes (void)
+{
+	return __atomic_load_n (&live_bytes, __ATOMIC_RELAXED);
+}
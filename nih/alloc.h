@@ -60,6 +60,11 @@
  * obviously does not clean up any pointers in the parent object which
  * point at the freed child.
  *
+ * Freeing a very large tree of objects can take some time, so from the
+ * main loop you may use nih_free_deferred() instead; destructors are
+ * called immediately but the memory is returned a slice at a time on
+ * each following iteration of the loop.
+ *
  * In many situations, you will allocate an object using nih_alloc() with
  * no parent and pass that to functions which may take a reference to it.
  * When finished, you need to discard the object safely; if no references
@@ -203,11 +208,45 @@
  * afterwards.
  *
  * Much of the main loop related objects in libnih behave in this way.
+ *
+ * == Threads ==
+ *
+ * By default the allocator does no locking at all, and objects may only
+ * be manipulated by the thread that allocated them.  When libnih is
+ * configured with --enable-threading, which is not the default,
+ * nih_alloc_set_thread_safe() may be called before any other threads
+ * are created to serialise all changes to references between objects
+ * with a single lock shared by the whole allocator.
+ *
+ * The memory for objects comes straight from malloc(), which keeps its
+ * own per-thread caches; the allocator only adds a per-thread cache of
+ * the reference structures that link objects, so that allocating and
+ * freeing objects without a parent neither takes the lock nor touches
+ * any other shared state.  Without --enable-threading the locking is
+ * compiled out entirely, and there is a single cache of references.
+ *
+ * The safe way to hand an object from a worker thread to the main
+ * thread is to allocate it with no parent, queue it for the main thread
+ * which takes its own reference with nih_ref() and then drops the
+ * worker's reference with nih_discard().  The worker must not touch the
+ * object once queued.
+ *
+ * Destructors are called with the allocator lock held, so they must not
+ * block waiting for another thread that might itself be allocating.
  **/
 
 #include <nih/macros.h>
 
 
+/**
+ * NIH_ALLOC_RECLAIM_SLICE:
+ *
+ * Number of objects freed with nih_free_deferred() whose memory is
+ * returned on each iteration of the main loop.
+ **/
+#define NIH_ALLOC_RECLAIM_SLICE 1024
+
+
 /**
  * NihDestructor:
  * @ptr: pointer to be destroyed.
@@ -314,8 +353,10 @@ void * nih_realloc                   (void *ptr, const void *parent,
 	__attribute__ ((warn_unused_result));
 
 int    nih_free                      (void *ptr);
+int    nih_free_deferred             (void *ptr);
 int    nih_discard                   (void *ptr);
 void   _nih_discard_local            (void *ptraddr);
+void   nih_free_children             (void *ptr);
 
 void   nih_alloc_real_set_destructor (const void *ptr,
 				      NihDestructor destructor);
@@ -324,8 +365,14 @@ void   nih_ref                       (const void *ptr, const void *parent);
 void   nih_unref                     (void *ptr, const void *parent);
 
 int    nih_alloc_parent              (const void *ptr, const void *parent);
+size_t nih_alloc_parents             (const void *ptr);
 
 size_t nih_alloc_size                (const void *ptr);
+size_t nih_alloc_live_bytes          (void);
+
+int    nih_alloc_set_thread_safe     (int enable);
+
+int    nih_alloc_reclaim             (size_t max);
 
 NIH_END_EXTERN
 
@@ -0,0 +1,253 @@
+/* libnih
+ *
+ * array.c - dynamic arrays
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/logging.h>
+
+#include "array.h"
+
+
+/**
+ * NIH_ARRAY_MIN_SIZE:
+ *
+ * Number of elements allocated when storage is first needed.
+ **/
+#define NIH_ARRAY_MIN_SIZE 8
+
+
+/**
+ * nih_array_new:
+ * @parent: parent object for new array,
+ * @elem_size: size of each element.
+ *
+ * Allocates a new, empty, array for elements of @elem_size bytes; no
+ * storage for elements is allocated until the first is added.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned array.  When all parents
+ * of the returned array are freed, the returned array will also be
+ * freed.
+ *
+ * Returns: newly allocated array or NULL if insufficient memory.
+ **/
+NihArray *
+nih_array_new (const void *parent,
+	       size_t      elem_size)
+{
+	NihArray *array;
+
+	nih_assert (elem_size > 0);
+
+	array = nih_new (parent, NihArray);
+	if (! array)
+		return NULL;
+
+	array->data = NULL;
+	array->len = 0;
+	array->size = 0;
+	array->elem_size = elem_size;
+
+	return array;
+}
+
+
+/**
+ * nih_array_reserve:
+ * @array: array to grow,
+ * @len: number of elements required.
+ *
+ * Ensures that @array has storage for at least @len elements, so that
+ * they may be added without further allocation.  The storage is at least
+ * doubled each time it is grown.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+int
+nih_array_reserve (NihArray *array,
+		   size_t    len)
+{
+	void * data;
+	size_t size;
+
+	nih_assert (array != NULL);
+
+	if (len <= array->size)
+		return 0;
+
+	size = nih_max (array->size * 2, (size_t)NIH_ARRAY_MIN_SIZE);
+	if (size < len)
+		size = len;
+
+	if (size > SIZE_MAX / array->elem_size)
+		return -1;
+
+	data = nih_realloc (array->data, array, size * array->elem_size);
+	if (! data)
+		return -1;
+
+	array->data = data;
+	array->size = size;
+
+	return 0;
+}
+
+
+/**
+ * nih_array_insert:
+ * @array: array to insert into,
+ * @index: index to insert at,
+ * @elem: element to copy.
+ *
+ * Inserts a copy of @elem into @array before the element at @index,
+ * moving that element and those after it up.  @index may be equal to
+ * the length of @array to append the element.
+ *
+ * @elem may be NULL, in which case the new element is zeroed.
+ *
+ * Returns: pointer to the new element or NULL if insufficient memory.
+ **/
+void *
+nih_array_insert (NihArray   *array,
+		  size_t      index,
+		  const void *elem)
+{
+	char *ptr;
+
+	nih_assert (array != NULL);
+	nih_assert (index <= array->len);
+
+	if (nih_array_reserve (array, array->len + 1) < 0)
+		return NULL;
+
+	ptr = (char *)array->data + index * array->elem_size;
+	memmove (ptr + array->elem_size, ptr,
+		 (array->len - index) * array->elem_size);
+
+	if (elem)
+		memcpy (ptr, elem, array->elem_size);
+	else
+		memset (ptr, 0, array->elem_size);
+
+	array->len++;
+
+	return ptr;
+}
+
+/**
+ * nih_array_append:
+ * @array: array to append to,
+ * @elem: element to copy.
+ *
+ * Adds a copy of @elem to the end of @array.
+ *
+ * @elem may be NULL, in which case the new element is zeroed.
+ *
+ * Returns: pointer to the new element or NULL if insufficient memory.
+ **/
+void *
+nih_array_append (NihArray   *array,
+		  const void *elem)
+{
+	nih_assert (array != NULL);
+
+	return nih_array_insert (array, array->len, elem);
+}
+
+/**
+ * nih_array_remove:
+ * @array: array to remove from,
+ * @index: index of element to remove.
+ *
+ * Removes the element at @index from @array, moving those after it
+ * down.  The storage is not shrunk.
+ **/
+void
+nih_array_remove (NihArray *array,
+		  size_t    index)
+{
+	char *ptr;
+
+	nih_assert (array != NULL);
+	nih_assert (index < array->len);
+
+	ptr = (char *)array->data + index * array->elem_size;
+	memmove (ptr, ptr + array->elem_size,
+		 (array->len - index - 1) * array->elem_size);
+
+	array->len--;
+}
+
+
+/**
+ * nih_array_sort:
+ * @array: array to sort,
+ * @cmp_function: function used to compare elements.
+ *
+ * Sorts the elements of @array using qsort(); @cmp_function is passed
+ * pointers to two elements.
+ **/
+void
+nih_array_sort (NihArray       *array,
+		NihCmpFunction  cmp_function)
+{
+	nih_assert (array != NULL);
+	nih_assert (cmp_function != NULL);
+
+	if (array->len > 1)
+		qsort (array->data, array->len, array->elem_size,
+		       cmp_function);
+}
+
+/**
+ * nih_array_search:
+ * @array: sorted array to search,
+ * @key: key to find,
+ * @cmp_function: function used to compare elements.
+ *
+ * Searches @array, which must be sorted according to @cmp_function, for
+ * an element matching @key using bsearch(); @cmp_function is passed @key
+ * as its first argument and a pointer to an element as its second.
+ *
+ * Returns: pointer to matching element or NULL if not found.
+ **/
+void *
+nih_array_search (NihArray       *array,
+		  const void     *key,
+		  NihCmpFunction  cmp_function)
+{
+	nih_assert (array != NULL);
+	nih_assert (cmp_function != NULL);
+
+	if (! array->len)
+		return NULL;
+
+	return bsearch (key, array->data, array->len, array->elem_size,
+			cmp_function);
+}
@@ -0,0 +1,181 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_ARRAY_H
+#define NIH_ARRAY_H
+
+/**
+ * Provides a dynamic array that stores its elements by value in a single
+ * contiguous block of memory, which is cheaper to iterate than an NihList
+ * and cheaper to grow than a NULL-terminated array since the storage is
+ * enlarged geometrically rather than one element at a time.
+ *
+ * Arrays are created with nih_array_new(), giving the size of each
+ * element; the storage is a child of the array so is freed along with it.
+ * Elements are added with nih_array_append() or nih_array_insert() and
+ * removed with nih_array_remove(), both of which return a pointer to the
+ * element in the array; such pointers, and the data member, are only
+ * valid until the array is next changed.
+ *
+ * The array is untyped, the NIH_ARRAY_INDEX() and NIH_ARRAY_FOREACH()
+ * macros give typed access to its elements.
+ *
+ * Arrays may be sorted with nih_array_sort(), which wraps qsort(), or
+ * with a function defined by NIH_ARRAY_SORT_FUNCTION() which allows the
+ * comparison to be inlined; sorted arrays may be searched with
+ * nih_array_search().
+ **/
+
+#include <nih/macros.h>
+#include <nih/hash.h>
+
+
+/**
+ * NihArray:
+ * @data: elements,
+ * @len: number of elements,
+ * @size: number of elements that may be stored without growing @data,
+ * @elem_size: size of each element.
+ *
+ * This structure represents a dynamic array, @data may be cast to a
+ * pointer to the element type and indexed directly up to @len.
+ **/
+typedef struct nih_array {
+	void   *data;
+	size_t  len;
+	size_t  size;
+	size_t  elem_size;
+} NihArray;
+
+
+/**
+ * NIH_ARRAY_INDEX:
+ * @array: array,
+ * @type: type of elements,
+ * @index: index of element.
+ *
+ * Expands to the element of @array at @index, which may be assigned to.
+ **/
+#define NIH_ARRAY_INDEX(array, type, index)				\
+	(((type *)(array)->data)[(index)])
+
+/**
+ * NIH_ARRAY_FOREACH:
+ * @array: array to iterate,
+ * @type: type of elements,
+ * @iter: name of iterator variable.
+ *
+ * Expands to a for statement that iterates over each element of @array,
+ * setting @iter to a pointer to each element for the block within the
+ * loop.
+ *
+ * You must not add or remove elements while iterating.
+ **/
+#define NIH_ARRAY_FOREACH(array, type, iter)				\
+	for (type *iter = (type *)(array)->data;			\
+	     iter < (type *)(array)->data + (array)->len; iter++)
+
+/**
+ * NIH_ARRAY_SORT_FUNCTION:
+ * @name: name of function,
+ * @type: type of elements,
+ * @cmp: comparison function or macro.
+ *
+ * Expands to the definition of a static function @name that sorts an
+ * array of @type elements, taking the array as its only argument.
+ *
+ * @cmp is called with pointers to two elements of @type and should return
+ * an integer less than, equal to or greater than zero in the same manner
+ * as a function passed to nih_array_sort(); since it is called directly,
+ * it may be a static inline function or macro, and the elements are
+ * moved by assignment, both of which avoid the overhead of qsort() for
+ * small elements.
+ *
+ * The sort is a heap sort, so is not stable.  A function named
+ * @name_sift is also defined.
+ **/
+#define NIH_ARRAY_SORT_FUNCTION(name, type, cmp)			\
+	static inline void						\
+	name##_sift (type   *base,					\
+		     size_t  root,					\
+		     size_t  len)					\
+	{								\
+		type tmp = base[root];					\
+		size_t child;						\
+									\
+		while ((child = root * 2 + 1) < len) {			\
+			if ((child + 1 < len)				\
+			    && (cmp (&base[child], &base[child + 1]) < 0)) \
+				child++;				\
+									\
+			if (cmp (&tmp, &base[child]) >= 0)		\
+				break;					\
+									\
+			base[root] = base[child];			\
+			root = child;					\
+		}							\
+									\
+		base[root] = tmp;					\
+	}								\
+									\
+	static void							\
+	name (NihArray *array)						\
+	{								\
+		type *base;						\
+		size_t i;						\
+									\
+		nih_assert (array != NULL);				\
+		nih_assert (array->elem_size == sizeof (type));		\
+									\
+		base = (type *)array->data;				\
+									\
+		for (i = array->len / 2; i-- > 0; )			\
+			name##_sift (base, i, array->len);		\
+									\
+		for (i = array->len; i-- > 1; ) {			\
+			type tmp = base[0];				\
+									\
+			base[0] = base[i];				\
+			base[i] = tmp;					\
+									\
+			name##_sift (base, 0, i);			\
+		}							\
+	}
+
+
+NIH_BEGIN_EXTERN
+
+NihArray *nih_array_new     (const void *parent, size_t elem_size)
+	__attribute__ ((warn_unused_result, malloc));
+
+int       nih_array_reserve (NihArray *array, size_t len)
+	__attribute__ ((warn_unused_result));
+
+void *    nih_array_insert  (NihArray *array, size_t index, const void *elem)
+	__attribute__ ((warn_unused_result));
+void *    nih_array_append  (NihArray *array, const void *elem)
+	__attribute__ ((warn_unused_result));
+void      nih_array_remove  (NihArray *array, size_t index);
+
+void      nih_array_sort    (NihArray *array, NihCmpFunction cmp_function);
+void *    nih_array_search  (NihArray *array, const void *key,
+			     NihCmpFunction cmp_function);
+
+NIH_END_EXTERN
+
+#endif /* NIH_ARRAY_H */
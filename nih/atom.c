@@ -0,0 +1,409 @@
+/* libnih
+ *
+ * atom.c - interned strings
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/logging.h>
+
+#include "atom.h"
+#include "hash_private.h"
+
+
+/**
+ * NihAtom:
+ * @hash: hash of string,
+ * @len: length of string,
+ * @str: string.
+ *
+ * This structure holds an atom in a table, the pointer to @str is the
+ * atom returned to callers.  Keeping the hash allows most mismatches to
+ * be found without comparing strings, and the table to be grown without
+ * hashing them again.
+ **/
+typedef struct nih_atom {
+	uint32_t hash;
+	size_t   len;
+	char     str[];
+} NihAtom;
+
+
+/**
+ * NIH_ATOM_TABLE_SIZE:
+ *
+ * Initial number of slots in a new table.
+ **/
+#define NIH_ATOM_TABLE_SIZE 64
+
+/**
+ * NIH_ATOM:
+ * @_str: atom string.
+ *
+ * Obtain the NihAtom structure given the pointer to its string.
+ **/
+#define NIH_ATOM(_str) ((NihAtom *)((char *)(_str) - offsetof (NihAtom, str)))
+
+
+/* Prototypes for static functions */
+static NihAtom **      nih_atom_table_find  (NihAtomTable *table,
+					     const char *str, size_t len,
+					     uint32_t hash);
+static int             nih_atom_table_grow  (NihAtomTable *table);
+
+
+/**
+ * nih_atoms:
+ *
+ * Global table of atoms used by nih_atom(), never freed.
+ **/
+NihAtomTable *nih_atoms = NULL;
+
+
+/**
+ * nih_atom_init:
+ *
+ * Initialise the global table of atoms.
+ **/
+void
+nih_atom_init (void)
+{
+	if (! nih_atoms)
+		nih_atoms = NIH_MUST (nih_atom_table_new (NULL));
+}
+
+
+/**
+ * nih_atom_table_new:
+ * @parent: parent object for new table.
+ *
+ * Allocates a new, empty, table of atoms.  Atoms interned in the table
+ * are children of it, and are freed along with it.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned table.  When all parents
+ * of the returned table are freed, the returned table will also be
+ * freed.
+ *
+ * Returns: newly allocated table or NULL if insufficient memory.
+ **/
+NihAtomTable *
+nih_atom_table_new (const void *parent)
+{
+	NihAtomTable *table;
+
+	table = nih_new (parent, NihAtomTable);
+	if (! table)
+		return NULL;
+
+	table->size = NIH_ATOM_TABLE_SIZE;
+	table->slots = nih_alloc (table, sizeof (NihAtom *) * table->size);
+	if (! table->slots) {
+		nih_free (table);
+		return NULL;
+	}
+
+	memset (table->slots, 0, sizeof (NihAtom *) * table->size);
+
+	table->count = 0;
+	table->lookups = 0;
+	table->bytes = 0;
+	table->bytes_saved = 0;
+
+	return table;
+}
+
+
+/**
+ * nih_atom_table_find:
+ * @table: table to search,
+ * @str: string to find,
+ * @len: length of @str,
+ * @hash: hash of @str.
+ *
+ * Searches @table for an atom matching the first @len bytes of @str.
+ *
+ * Returns: pointer to the slot containing the atom, or to the empty slot
+ * where it would be placed.
+ **/
+static NihAtom **
+nih_atom_table_find (NihAtomTable *table,
+		     const char   *str,
+		     size_t        len,
+		     uint32_t      hash)
+{
+	size_t mask = table->size - 1;
+	size_t i;
+
+	for (i = hash & mask; table->slots[i]; i = (i + 1) & mask) {
+		NihAtom *atom = table->slots[i];
+
+		if ((atom->hash == hash) && (atom->len == len)
+		    && (! memcmp (atom->str, str, len)))
+			break;
+	}
+
+	return &table->slots[i];
+}
+
+/**
+ * nih_atom_table_grow:
+ * @table: table to grow.
+ *
+ * Doubles the number of slots in @table, moving the existing atoms into
+ * their new positions.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+static int
+nih_atom_table_grow (NihAtomTable *table)
+{
+	NihAtom **slots;
+	size_t    size;
+	size_t    mask;
+	size_t    i;
+
+	nih_assert (table != NULL);
+
+	size = table->size * 2;
+	mask = size - 1;
+
+	slots = nih_alloc (table, sizeof (NihAtom *) * size);
+	if (! slots)
+		return -1;
+
+	memset (slots, 0, sizeof (NihAtom *) * size);
+
+	for (i = 0; i < table->size; i++) {
+		NihAtom *atom = table->slots[i];
+		size_t   j;
+
+		if (! atom)
+			continue;
+
+		for (j = atom->hash & mask; slots[j]; j = (j + 1) & mask)
+			;
+
+		slots[j] = atom;
+	}
+
+	nih_free (table->slots);
+	table->slots = slots;
+	table->size = size;
+
+	return 0;
+}
+
+
+/**
+ * nih_atom_table_internn:
+ * @table: table to intern in,
+ * @str: string to intern,
+ * @len: length of @str.
+ *
+ * Returns the atom for the first @len bytes of @str in @table, which
+ * need not be NULL-terminated, adding it to the table if it isn't already
+ * present.  The same pointer is returned for every call with an equal
+ * string.
+ *
+ * Returns: atom or NULL if insufficient memory.
+ **/
+const char *
+nih_atom_table_internn (NihAtomTable *table,
+			const char   *str,
+			size_t        len)
+{
+	NihAtom **slot;
+	NihAtom * atom;
+	uint32_t  hash;
+
+	nih_assert (table != NULL);
+	nih_assert (str != NULL);
+
+	hash = nih_hash_bytes (str, len);
+	slot = nih_atom_table_find (table, str, len, hash);
+
+	table->lookups++;
+
+	if (*slot) {
+		table->bytes_saved += len + 1;
+		return (*slot)->str;
+	}
+
+	/* Keep the table no more than half full so that probe sequences
+	 * stay short; the slot must be found again after growing it.
+	 */
+	if ((table->count + 1) * 2 > table->size) {
+		if (nih_atom_table_grow (table) < 0) {
+			table->lookups--;
+			return NULL;
+		}
+
+		slot = nih_atom_table_find (table, str, len, hash);
+	}
+
+	atom = nih_alloc (table, sizeof (NihAtom) + len + 1);
+	if (! atom) {
+		table->lookups--;
+		return NULL;
+	}
+
+	atom->hash = hash;
+	atom->len = len;
+	memcpy (atom->str, str, len);
+	atom->str[len] = '\0';
+
+	*slot = atom;
+
+	table->count++;
+	table->bytes += len + 1;
+
+	return atom->str;
+}
+
+/**
+ * nih_atom_table_intern:
+ * @table: table to intern in,
+ * @str: string to intern.
+ *
+ * Returns the atom for @str in @table, adding it to the table if it
+ * isn't already present.  The same pointer is returned for every call
+ * with an equal string.
+ *
+ * Returns: atom or NULL if insufficient memory.
+ **/
+const char *
+nih_atom_table_intern (NihAtomTable *table,
+		       const char   *str)
+{
+	nih_assert (table != NULL);
+	nih_assert (str != NULL);
+
+	return nih_atom_table_internn (table, str, strlen (str));
+}
+
+/**
+ * nih_atom_table_lookup:
+ * @table: table to search,
+ * @str: string to find.
+ *
+ * Returns the atom for @str in @table without adding it; this can be
+ * used to find out whether a string could possibly match any atom,
+ * since a string that has never been interned cannot.
+ *
+ * Returns: atom or NULL if @str is not in @table.
+ **/
+const char *
+nih_atom_table_lookup (NihAtomTable *table,
+		       const char   *str)
+{
+	NihAtom **slot;
+	size_t    len;
+
+	nih_assert (table != NULL);
+	nih_assert (str != NULL);
+
+	len = strlen (str);
+	slot = nih_atom_table_find (table, str, len, nih_hash_bytes (str, len));
+
+	return *slot ? (*slot)->str : NULL;
+}
+
+
+/**
+ * nih_atom:
+ * @str: string to intern.
+ *
+ * Returns the atom for @str in the global table nih_atoms, adding it if
+ * it isn't already present.
+ *
+ * Returns: atom or NULL if insufficient memory.
+ **/
+const char *
+nih_atom (const char *str)
+{
+	nih_assert (str != NULL);
+
+	nih_atom_init ();
+
+	return nih_atom_table_intern (nih_atoms, str);
+}
+
+/**
+ * nih_atomn:
+ * @str: string to intern,
+ * @len: length of @str.
+ *
+ * Returns the atom for the first @len bytes of @str in the global table
+ * nih_atoms, adding it if it isn't already present.
+ *
+ * Returns: atom or NULL if insufficient memory.
+ **/
+const char *
+nih_atomn (const char *str,
+	   size_t      len)
+{
+	nih_assert (str != NULL);
+
+	nih_atom_init ();
+
+	return nih_atom_table_internn (nih_atoms, str, len);
+}
+
+/**
+ * nih_atom_lookup:
+ * @str: string to find.
+ *
+ * Returns the atom for @str in the global table nih_atoms without adding
+ * it.
+ *
+ * Returns: atom or NULL if @str has not been interned.
+ **/
+const char *
+nih_atom_lookup (const char *str)
+{
+	nih_assert (str != NULL);
+
+	nih_atom_init ();
+
+	return nih_atom_table_lookup (nih_atoms, str);
+}
+
+
+/**
+ * nih_atom_len:
+ * @atom: atom.
+ *
+ * Returns: length of @atom, without the cost of strlen().
+ **/
+size_t
+nih_atom_len (const char *atom)
+{
+	nih_assert (atom != NULL);
+
+	return NIH_ATOM (atom)->len;
+}
@@ -0,0 +1,94 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_ATOM_H
+#define NIH_ATOM_H
+
+/**
+ * Atoms are interned strings; each distinct string is stored once in an
+ * atom table and the same constant pointer returned each time it is
+ * interned, so that atoms from the same table may be compared for
+ * equality by comparing pointers rather than with strcmp(), and many
+ * copies of a commonly used name share the same storage.
+ *
+ * The global table nih_atoms is used by nih_atom(), and lives for the
+ * lifetime of the process; tables with a shorter life may be created with
+ * nih_atom_table_new() and all of their atoms are freed along with the
+ * table.  Atoms themselves may not be freed or modified, and since they
+ * point into the middle of an allocated block they must not be passed
+ * to any nih_alloc() function, including as the parent of other objects.
+ *
+ * Atom tables are not thread-safe.
+ **/
+
+#include <nih/macros.h>
+
+
+/**
+ * NihAtomTable:
+ * @slots: open-addressed array of atoms,
+ * @size: number of slots, always a power of two,
+ * @count: number of atoms in the table,
+ * @lookups: number of strings interned,
+ * @bytes: bytes used by the strings of all atoms,
+ * @bytes_saved: bytes that would have been used by copies of the strings.
+ *
+ * This structure represents a table of atoms.  The @lookups, @bytes and
+ * @bytes_saved members may be read to find out how effective the table
+ * is; @bytes_saved counts the string length of every intern of a string
+ * that was already in the table.
+ **/
+typedef struct nih_atom_table {
+	struct nih_atom **slots;
+	size_t            size;
+	size_t            count;
+
+	size_t            lookups;
+	size_t            bytes;
+	size_t            bytes_saved;
+} NihAtomTable;
+
+
+NIH_BEGIN_EXTERN
+
+extern NihAtomTable *nih_atoms;
+
+
+void          nih_atom_init          (void);
+
+NihAtomTable *nih_atom_table_new     (const void *parent)
+	__attribute__ ((warn_unused_result, malloc));
+
+const char *  nih_atom_table_intern  (NihAtomTable *table, const char *str)
+	__attribute__ ((warn_unused_result));
+const char *  nih_atom_table_internn (NihAtomTable *table, const char *str,
+				      size_t len)
+	__attribute__ ((warn_unused_result));
+const char *  nih_atom_table_lookup  (NihAtomTable *table, const char *str);
+
+const char *  nih_atom               (const char *str)
+	__attribute__ ((warn_unused_result));
+const char *  nih_atomn              (const char *str, size_t len)
+	__attribute__ ((warn_unused_result));
+const char *  nih_atom_lookup        (const char *str);
+
+size_t        nih_atom_len           (const char *atom);
+
+NIH_END_EXTERN
+
+#endif /* NIH_ATOM_H */
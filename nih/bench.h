@@ -0,0 +1,291 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_BENCH_H
+#define NIH_BENCH_H
+
+/**
+ * Benchmarks use these macros in the same way that test suites use those
+ * in <nih/test.h>; each benchmark is a block of code run a number of
+ * times in a loop, which is repeated after a warm-up pass and the best
+ * time taken:
+ *
+ *	BENCH ("nih_list_add", 100000) {
+ *		nih_list_add (&list, &entries[bench_iteration]);
+ *	}
+ *
+ * One line is output for each benchmark with tab-separated fields giving
+ * the name, number of iterations, nanoseconds per iteration and the
+ * number of allocations and bytes allocated through nih_alloc() per
+ * iteration; lines beginning with # are comments.
+ **/
+
+/* For _GNU_SOURCE */
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+
+
+/* As with the test suites, we count allocations by overriding the
+ * functions called by nih_alloc().
+ */
+extern void *(*__nih_malloc)(size_t size);
+extern void *(*__nih_realloc)(void *ptr, size_t size);
+
+
+/**
+ * BENCH_WARMUP:
+ *
+ * Number of passes of each benchmark run before timing begins.
+ **/
+#define BENCH_WARMUP 1
+
+/**
+ * BENCH_REPETITIONS:
+ *
+ * Number of timed passes of each benchmark, the best of which is output.
+ **/
+#define BENCH_REPETITIONS 5
+
+
+/**
+ * bench_iteration:
+ *
+ * Variable used by BENCH as the loop counter, may be used within the
+ * block to vary the data it acts on.
+ **/
+static size_t bench_iteration __attribute__ ((unused)) = 0;
+
+/**
+ * _bench_name:
+ *
+ * Name of the benchmark being run; never NULL, since it's passed to
+ * printf().
+ **/
+static const char *_bench_name __attribute__ ((unused)) = "";
+
+/**
+ * _bench_iterations:
+ *
+ * Number of iterations in each pass of the benchmark being run.
+ **/
+static size_t _bench_iterations __attribute__ ((unused)) = 0;
+
+/**
+ * _bench_pass:
+ *
+ * Number of the current pass, negative for warm-up passes.
+ **/
+static int _bench_pass __attribute__ ((unused)) = 0;
+
+/**
+ * _bench_start:
+ *
+ * Time at which the current pass began.
+ **/
+static struct timespec _bench_start __attribute__ ((unused));
+
+/**
+ * _bench_best:
+ *
+ * Shortest time taken by a timed pass, in nanoseconds.
+ **/
+static double _bench_best __attribute__ ((unused)) = 0.0;
+
+/**
+ * _bench_allocs:
+ *
+ * Number of allocations made during timed passes.
+ **/
+static size_t _bench_allocs __attribute__ ((unused)) = 0;
+
+/**
+ * _bench_bytes:
+ *
+ * Number of bytes allocated during timed passes.
+ **/
+static size_t _bench_bytes __attribute__ ((unused)) = 0;
+
+/**
+ * _bench_header:
+ *
+ * TRUE once the header comment has been output.
+ **/
+static int _bench_header __attribute__ ((unused)) = FALSE;
+
+
+/**
+ * _bench_realloc:
+ *
+ * realloc() wrapper used by BENCH to count allocations.
+ **/
+static inline __attribute__ ((unused)) void *
+_bench_realloc (void   *ptr,
+		size_t  size)
+{
+	if (_bench_pass > 0) {
+		_bench_allocs++;
+		_bench_bytes += size;
+	}
+
+	return realloc (ptr, size);
+}
+
+/**
+ * _bench_malloc:
+ *
+ * malloc() wrapper used by BENCH to count allocations.
+ **/
+static inline __attribute__ ((unused)) void *
+_bench_malloc (size_t size)
+{
+	return _bench_realloc (NULL, size);
+}
+
+/**
+ * _bench_elapsed:
+ * @start: time to measure from.
+ *
+ * Returns: nanoseconds elapsed since @start.
+ **/
+static inline __attribute__ ((unused)) double
+_bench_elapsed (const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	return ((now.tv_sec - start->tv_sec) * 1000000000.0
+		+ (now.tv_nsec - start->tv_nsec));
+}
+
+/**
+ * _bench_print_header:
+ *
+ * Output a comment naming the fields of each result, the first time it
+ * is called.
+ **/
+static inline __attribute__ ((unused)) void
+_bench_print_header (void)
+{
+	if (_bench_header)
+		return;
+
+	printf ("# benchmark\titerations\tns/op\tallocs/op\tbytes/op\n");
+	_bench_header = TRUE;
+}
+
+/**
+ * BENCH_REPORT:
+ * @_name: name of benchmark,
+ * @_iterations: number of iterations,
+ * @_ns: nanoseconds per iteration,
+ * @_allocs: allocations per iteration,
+ * @_bytes: bytes allocated per iteration.
+ *
+ * Output the result of a benchmark, this is used by BENCH and may be
+ * used directly by benchmarks that must do their own timing.
+ **/
+#define BENCH_REPORT(_name, _iterations, _ns, _allocs, _bytes)		\
+	do {								\
+		_bench_print_header ();					\
+		printf ("%s\t%zu\t%.1f\t%.2f\t%.1f\n", (_name),		\
+			(size_t)(_iterations), (double)(_ns),		\
+			(double)(_allocs), (double)(_bytes));		\
+		fflush (stdout);					\
+	} while (0)
+
+/**
+ * _bench_next:
+ *
+ * Called by BENCH before each pass of the benchmark; records the time
+ * taken by the previous pass and starts timing the next one.
+ *
+ * Returns: TRUE if another pass should be run, FALSE when finished.
+ **/
+static inline __attribute__ ((unused)) int
+_bench_next (void)
+{
+	if (_bench_pass > 0) {
+		double ns = _bench_elapsed (&_bench_start);
+
+		if ((_bench_pass == 1) || (ns < _bench_best))
+			_bench_best = ns;
+	}
+
+	if (_bench_pass++ >= BENCH_REPETITIONS) {
+		double ops = (double)_bench_iterations * BENCH_REPETITIONS;
+
+		__nih_malloc = malloc;
+		__nih_realloc = realloc;
+
+		BENCH_REPORT (_bench_name, _bench_iterations,
+			      _bench_best / _bench_iterations,
+			      _bench_allocs / ops, _bench_bytes / ops);
+		return FALSE;
+	}
+
+	clock_gettime (CLOCK_MONOTONIC, &_bench_start);
+	return TRUE;
+}
+
+/**
+ * BENCH:
+ * @_name: name of benchmark,
+ * @_iterations: number of iterations in each pass.
+ *
+ * This macro expands to code that runs the following block @_iterations
+ * times, with the special bench_iteration variable counting from zero,
+ * for BENCH_WARMUP untimed passes and then BENCH_REPETITIONS timed
+ * passes; and outputs the result.
+ *
+ * This cannot be nested as it relies on setting an alternate allocator
+ * and sharing a global state.
+ **/
+#define BENCH(_name, _iterations)					\
+	for (_bench_name = (_name), _bench_iterations = (_iterations),	\
+		     _bench_pass = -BENCH_WARMUP,			\
+		     _bench_allocs = 0, _bench_bytes = 0,		\
+		     __nih_malloc = _bench_malloc,			\
+		     __nih_realloc = _bench_realloc;			\
+	     _bench_next (); )						\
+		for (bench_iteration = 0;				\
+		     bench_iteration < _bench_iterations;		\
+		     bench_iteration++)
+
+/**
+ * BENCH_GROUP:
+ * @_name: name of group of benchmarks.
+ *
+ * Output a comment indicating that a group of benchmarks of @_name are
+ * being run.
+ **/
+#define BENCH_GROUP(_name)			\
+	do {					\
+		_bench_print_header ();		\
+		printf ("# %s\n", (_name));	\
+	} while (0)
+
+#endif /* NIH_BENCH_H */
@@ -0,0 +1,683 @@
+/* libnih
+ *
+ * chash.c - concurrent read-mostly hash tables
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/hash.h>
+#include <nih/logging.h>
+
+#include "chash.h"
+
+
+/**
+ * NihCHashEntry:
+ * @next: next entry in bin,
+ * @hash: hash of @key,
+ * @key: string key,
+ * @value: object referenced by the entry,
+ * @epoch: epoch in which the entry was removed,
+ * @retired: next removed entry.
+ *
+ * This structure holds an entry in a concurrent hash table.  Once added
+ * to a bin, only @next is changed while the entry remains there, and not
+ * at all after it has been removed so that readers standing on it may
+ * carry on to the rest of the bin.
+ **/
+typedef struct nih_chash_entry {
+	struct nih_chash_entry *next;
+	uint32_t                hash;
+	char                   *key;
+	void                   *value;
+
+	unsigned long           epoch;
+	struct nih_chash_entry *retired;
+} NihCHashEntry;
+
+/**
+ * NihCHash:
+ * @bins: array of bins,
+ * @size: number of bins, always a power of two,
+ * @count: number of entries,
+ * @retired: entries removed but not yet freed,
+ * @lock: lock serialising writers.
+ *
+ * This structure represents a concurrent hash table.
+ **/
+struct nih_chash {
+	NihCHashEntry  **bins;
+	size_t           size;
+	size_t           count;
+
+	NihCHashEntry   *retired;
+
+#if ENABLE_THREADING
+	pthread_mutex_t  lock;
+#endif /* ENABLE_THREADING */
+};
+
+/**
+ * NihCHashReader:
+ * @next: next reader,
+ * @in_use: TRUE while owned by a thread,
+ * @state: epoch observed shifted left one, plus one while reading,
+ * @nesting: depth of nested read sections.
+ *
+ * This structure records whether a thread is reading from any concurrent
+ * hash table, and which epoch it observed when it started.  Readers are
+ * allocated with malloc() rather than nih_alloc(), since any thread may
+ * allocate one, and are never freed; when a thread exits its reader is
+ * released to be used by a later thread.
+ **/
+typedef struct nih_chash_reader {
+	struct nih_chash_reader *next;
+	int                      in_use;
+	unsigned long            state;
+	int                      nesting;
+} NihCHashReader;
+
+
+/**
+ * NIH_CHASH_MIN_SIZE:
+ *
+ * Smallest number of bins in a table.
+ **/
+#define NIH_CHASH_MIN_SIZE 16
+
+/**
+ * NIH_CHASH_LOCK:
+ * @hash: table to lock.
+ *
+ * Locks @hash against other writers when built with threading support.
+ **/
+#if ENABLE_THREADING
+# define NIH_CHASH_LOCK(hash) pthread_mutex_lock (&(hash)->lock)
+#else /* ENABLE_THREADING */
+# define NIH_CHASH_LOCK(hash)
+#endif /* ENABLE_THREADING */
+
+/**
+ * NIH_CHASH_UNLOCK:
+ * @hash: table to unlock.
+ *
+ * Unlocks @hash after a call to NIH_CHASH_LOCK().
+ **/
+#if ENABLE_THREADING
+# define NIH_CHASH_UNLOCK(hash) pthread_mutex_unlock (&(hash)->lock)
+#else /* ENABLE_THREADING */
+# define NIH_CHASH_UNLOCK(hash)
+#endif /* ENABLE_THREADING */
+
+
+/* Prototypes for static functions */
+static NihCHashReader *nih_chash_reader         (void);
+#if ENABLE_THREADING
+static void            nih_chash_reader_init    (void);
+static void            nih_chash_reader_release (void *ptr);
+#endif /* ENABLE_THREADING */
+static int             nih_chash_advance        (void);
+static void            nih_chash_retire         (NihCHash *hash,
+						 NihCHashEntry *entry);
+
+
+/**
+ * epoch:
+ *
+ * Global epoch, advanced by writers once every reader has observed the
+ * current value; an entry removed in one epoch cannot be seen by any
+ * reader two epochs later.
+ **/
+static unsigned long epoch = 0;
+
+/**
+ * readers:
+ *
+ * List of all readers, added to at the head with compare-and-swap.
+ **/
+static NihCHashReader *readers = NULL;
+
+/**
+ * reader:
+ *
+ * Reader owned by the current thread.
+ **/
+static __thread NihCHashReader *reader = NULL;
+
+#if ENABLE_THREADING
+/**
+ * reader_once:
+ *
+ * Ensures @reader_key is only created once.
+ **/
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+
+/**
+ * reader_key:
+ *
+ * Thread-specific key whose destructor releases a thread's reader when
+ * the thread exits.
+ **/
+static pthread_key_t reader_key;
+#endif /* ENABLE_THREADING */
+
+
+/**
+ * nih_chash_new:
+ * @parent: parent object for new table,
+ * @entries: rough number of entries expected.
+ *
+ * Allocates a new, empty, concurrent hash table; the number of bins is
+ * fixed at the power of two no smaller than @entries.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned table.  When all parents
+ * of the returned table are freed, the returned table will also be
+ * freed.
+ *
+ * Returns: newly allocated table or NULL if insufficient memory.
+ **/
+NihCHash *
+nih_chash_new (const void *parent,
+	       size_t      entries)
+{
+	NihCHash *hash;
+
+	hash = nih_new (parent, NihCHash);
+	if (! hash)
+		return NULL;
+
+	hash->size = NIH_CHASH_MIN_SIZE;
+	while (hash->size < entries)
+		hash->size *= 2;
+
+	hash->bins = nih_alloc (hash, sizeof (NihCHashEntry *) * hash->size);
+	if (! hash->bins) {
+		nih_free (hash);
+		return NULL;
+	}
+
+	memset (hash->bins, 0, sizeof (NihCHashEntry *) * hash->size);
+
+	hash->count = 0;
+	hash->retired = NULL;
+
+#if ENABLE_THREADING
+	pthread_mutex_init (&hash->lock, NULL);
+#endif /* ENABLE_THREADING */
+
+	return hash;
+}
+
+
+/**
+ * nih_chash_add:
+ * @hash: table to add to,
+ * @key: string key,
+ * @value: object to add.
+ *
+ * Adds @value to @hash under @key, replacing any existing value with the
+ * same key; a reference to @value is taken by the table, and a copy of
+ * @key is made.  @value must have been allocated with nih_alloc().
+ *
+ * Readers either find the old value or @value; the table's reference to
+ * the old value is dropped once no reader can still be using it.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+int
+nih_chash_add (NihCHash   *hash,
+	       const char *key,
+	       void       *value)
+{
+	NihCHashEntry  *entry;
+	NihCHashEntry **bin;
+	NihCHashEntry **prev;
+
+	nih_assert (hash != NULL);
+	nih_assert (key != NULL);
+	nih_assert (value != NULL);
+
+	entry = nih_new (hash, NihCHashEntry);
+	if (! entry)
+		return -1;
+
+	entry->key = nih_strdup (entry, key);
+	if (! entry->key) {
+		nih_free (entry);
+		return -1;
+	}
+
+	entry->hash = nih_hash_string_hash (key);
+	entry->value = value;
+	entry->retired = NULL;
+	nih_ref (value, entry);
+
+	NIH_CHASH_LOCK (hash);
+
+	/* Find the existing entry with the same key, if there is one, and
+	 * replace it in the bin; otherwise add the new entry at the head.
+	 * Either way the new entry is complete before it's published.
+	 */
+	bin = &hash->bins[entry->hash & (hash->size - 1)];
+
+	prev = bin;
+	while (*prev) {
+		if (((*prev)->hash == entry->hash)
+		    && (! strcmp ((*prev)->key, key)))
+			break;
+
+		prev = &(*prev)->next;
+	}
+
+	if (*prev) {
+		NihCHashEntry *old = *prev;
+
+		entry->next = old->next;
+		__atomic_store_n (prev, entry, __ATOMIC_RELEASE);
+
+		nih_chash_retire (hash, old);
+	} else {
+		entry->next = *bin;
+		__atomic_store_n (bin, entry, __ATOMIC_RELEASE);
+
+		__atomic_store_n (&hash->count, hash->count + 1,
+				  __ATOMIC_RELAXED);
+	}
+
+	NIH_CHASH_UNLOCK (hash);
+
+	nih_chash_reclaim (hash);
+
+	return 0;
+}
+
+/**
+ * nih_chash_remove:
+ * @hash: table to remove from,
+ * @key: string key.
+ *
+ * Removes the value for @key from @hash; the table's reference to it is
+ * dropped once no reader can still be using it.
+ *
+ * Returns: TRUE if a value was removed, FALSE if @key was not found.
+ **/
+int
+nih_chash_remove (NihCHash   *hash,
+		  const char *key)
+{
+	NihCHashEntry **prev;
+	uint32_t        key_hash;
+
+	nih_assert (hash != NULL);
+	nih_assert (key != NULL);
+
+	key_hash = nih_hash_string_hash (key);
+
+	NIH_CHASH_LOCK (hash);
+
+	prev = &hash->bins[key_hash & (hash->size - 1)];
+	while (*prev) {
+		NihCHashEntry *entry = *prev;
+
+		if ((entry->hash == key_hash) && (! strcmp (entry->key, key))) {
+			__atomic_store_n (prev, entry->next, __ATOMIC_RELEASE);
+			__atomic_store_n (&hash->count, hash->count - 1,
+					  __ATOMIC_RELAXED);
+
+			nih_chash_retire (hash, entry);
+
+			NIH_CHASH_UNLOCK (hash);
+
+			nih_chash_reclaim (hash);
+			return TRUE;
+		}
+
+		prev = &entry->next;
+	}
+
+	NIH_CHASH_UNLOCK (hash);
+
+	return FALSE;
+}
+
+
+/**
+ * nih_chash_lookup:
+ * @hash: table to search,
+ * @key: string key.
+ *
+ * Finds the value for @key in @hash without taking any locks.
+ *
+ * The value may be replaced or removed by another thread at any time,
+ * so the caller should be inside a read section begun with
+ * nih_chash_read_lock() for as long as it uses the value; or take its
+ * own reference with nih_ref() before leaving it.  When there are no
+ * other threads changing @hash, this is not necessary.
+ *
+ * Returns: value found or NULL if @key was not found.
+ **/
+void *
+nih_chash_lookup (NihCHash   *hash,
+		  const char *key)
+{
+	NihCHashEntry *entry;
+	uint32_t       key_hash;
+	void *         value = NULL;
+
+	nih_assert (hash != NULL);
+	nih_assert (key != NULL);
+
+	key_hash = nih_hash_string_hash (key);
+
+	nih_chash_read_lock ();
+
+	entry = __atomic_load_n (&hash->bins[key_hash & (hash->size - 1)],
+				 __ATOMIC_ACQUIRE);
+	while (entry) {
+		if ((entry->hash == key_hash) && (! strcmp (entry->key, key))) {
+			value = entry->value;
+			break;
+		}
+
+		entry = __atomic_load_n (&entry->next, __ATOMIC_ACQUIRE);
+	}
+
+	nih_chash_read_unlock ();
+
+	return value;
+}
+
+/**
+ * nih_chash_count:
+ * @hash: table.
+ *
+ * Returns: number of values in @hash, which may already be out of date
+ * if other threads are changing it.
+ **/
+size_t
+nih_chash_count (NihCHash *hash)
+{
+	nih_assert (hash != NULL);
+
+	return __atomic_load_n (&hash->count, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * nih_chash_reader:
+ *
+ * Returns the reader owned by the current thread, reusing one released
+ * by an exited thread or allocating a new one the first time it is
+ * called in each thread.
+ *
+ * Returns: reader.
+ **/
+static NihCHashReader *
+nih_chash_reader (void)
+{
+	NihCHashReader *new_reader;
+
+	if (reader)
+		return reader;
+
+	for (new_reader = __atomic_load_n (&readers, __ATOMIC_ACQUIRE);
+	     new_reader; new_reader = new_reader->next) {
+		int in_use = FALSE;
+
+		if (__atomic_compare_exchange_n (&new_reader->in_use, &in_use,
+						 TRUE, FALSE, __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED))
+			break;
+	}
+
+	if (! new_reader) {
+		new_reader = NIH_MUST (malloc (sizeof (NihCHashReader)));
+		new_reader->in_use = TRUE;
+		new_reader->state = 0;
+		new_reader->nesting = 0;
+
+		new_reader->next = __atomic_load_n (&readers, __ATOMIC_RELAXED);
+		while (! __atomic_compare_exchange_n (&readers,
+						      &new_reader->next,
+						      new_reader, FALSE,
+						      __ATOMIC_RELEASE,
+						      __ATOMIC_RELAXED))
+			;
+	}
+
+#if ENABLE_THREADING
+	/* Make sure the reader is released when the thread exits */
+	pthread_once (&reader_once, nih_chash_reader_init);
+	pthread_setspecific (reader_key, new_reader);
+#endif /* ENABLE_THREADING */
+
+	reader = new_reader;
+
+	return reader;
+}
+
+#if ENABLE_THREADING
+/**
+ * nih_chash_reader_init:
+ *
+ * Creates the thread-specific key used to release readers.
+ **/
+static void
+nih_chash_reader_init (void)
+{
+	NIH_ZERO (pthread_key_create (&reader_key, nih_chash_reader_release));
+}
+
+/**
+ * nih_chash_reader_release:
+ * @ptr: reader.
+ *
+ * Releases a thread's reader when it exits, so that it may be used by
+ * another thread.
+ **/
+static void
+nih_chash_reader_release (void *ptr)
+{
+	NihCHashReader *old_reader = ptr;
+
+	nih_assert (old_reader != NULL);
+
+	old_reader->nesting = 0;
+	__atomic_store_n (&old_reader->state, 0, __ATOMIC_RELEASE);
+	__atomic_store_n (&old_reader->in_use, FALSE, __ATOMIC_RELEASE);
+}
+#endif /* ENABLE_THREADING */
+
+
+/**
+ * nih_chash_read_lock:
+ *
+ * Begins a read section in the current thread; values found with
+ * nih_chash_lookup() in any table will not be freed by the table until
+ * the matching call to nih_chash_read_unlock().  Read sections may be
+ * nested.
+ *
+ * This never waits for writers.
+ **/
+void
+nih_chash_read_lock (void)
+{
+	NihCHashReader *self;
+
+	self = nih_chash_reader ();
+	if (self->nesting++)
+		return;
+
+	/* Announce the epoch we've observed before reading anything from
+	 * a table; the fence pairs with the one in nih_chash_advance() so
+	 * that either the writer sees us reading, or we see its changes.
+	 */
+	__atomic_store_n (&self->state,
+			  (__atomic_load_n (&epoch, __ATOMIC_RELAXED) << 1) | 1,
+			  __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+/**
+ * nih_chash_read_unlock:
+ *
+ * Ends a read section begun with nih_chash_read_lock().
+ **/
+void
+nih_chash_read_unlock (void)
+{
+	NihCHashReader *self;
+
+	self = nih_chash_reader ();
+	nih_assert (self->nesting > 0);
+
+	if (--self->nesting)
+		return;
+
+	__atomic_store_n (&self->state, 0, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * nih_chash_advance:
+ *
+ * Advances the global epoch if every thread inside a read section has
+ * observed the current one.
+ *
+ * Returns: TRUE if the epoch was advanced, FALSE otherwise.
+ **/
+static int
+nih_chash_advance (void)
+{
+	NihCHashReader *iter;
+	unsigned long   current;
+
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+	current = __atomic_load_n (&epoch, __ATOMIC_RELAXED);
+
+	for (iter = __atomic_load_n (&readers, __ATOMIC_ACQUIRE);
+	     iter; iter = iter->next) {
+		unsigned long state;
+
+		state = __atomic_load_n (&iter->state, __ATOMIC_ACQUIRE);
+		if ((state & 1) && ((state >> 1) != current))
+			return FALSE;
+	}
+
+	return __atomic_compare_exchange_n (&epoch, &current, current + 1,
+					    FALSE, __ATOMIC_SEQ_CST,
+					    __ATOMIC_RELAXED);
+}
+
+/**
+ * nih_chash_retire:
+ * @hash: table @entry was removed from,
+ * @entry: entry removed.
+ *
+ * Adds @entry, which must already have been removed from its bin, to the
+ * list of entries to be freed by nih_chash_reclaim().  Must be called
+ * with the table locked.
+ **/
+static void
+nih_chash_retire (NihCHash      *hash,
+		  NihCHashEntry *entry)
+{
+	nih_assert (hash != NULL);
+	nih_assert (entry != NULL);
+
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+	entry->epoch = __atomic_load_n (&epoch, __ATOMIC_RELAXED);
+	entry->retired = hash->retired;
+	__atomic_store_n (&hash->retired, entry, __ATOMIC_RELAXED);
+}
+
+/**
+ * nih_chash_reclaim:
+ * @hash: table to reclaim.
+ *
+ * Frees entries removed from @hash, dropping the table's reference to
+ * their values, once no reader can still be using them.  This is done
+ * whenever the table is changed, but may also be called when the calling
+ * thread is otherwise idle to free the entries left behind by readers
+ * that were busy at the time.
+ **/
+void
+nih_chash_reclaim (NihCHash *hash)
+{
+	NihCHashEntry **prev;
+	NihCHashEntry  *freed = NULL;
+	unsigned long   current;
+
+	nih_assert (hash != NULL);
+
+	if (! __atomic_load_n (&hash->retired, __ATOMIC_RELAXED))
+		return;
+
+	/* Entries removed in the current epoch need it to be advanced
+	 * twice before they can be freed.
+	 */
+	if (nih_chash_advance ())
+		nih_chash_advance ();
+
+	current = __atomic_load_n (&epoch, __ATOMIC_RELAXED);
+
+	NIH_CHASH_LOCK (hash);
+
+	prev = &hash->retired;
+	while (*prev) {
+		NihCHashEntry *entry = *prev;
+
+		if (current - entry->epoch >= 2) {
+			*prev = entry->retired;
+
+			entry->retired = freed;
+			freed = entry;
+		} else {
+			prev = &entry->retired;
+		}
+	}
+
+	NIH_CHASH_UNLOCK (hash);
+
+	/* Free outside the lock since dropping the references may call
+	 * destructors that change the table.
+	 */
+	while (freed) {
+		NihCHashEntry *entry = freed;
+
+		freed = entry->retired;
+		nih_free (entry);
+	}
+}
@@ -0,0 +1,79 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_CHASH_H
+#define NIH_CHASH_H
+
+/**
+ * Provides a hash table mapping string keys to objects allocated with
+ * nih_alloc() that may be shared between threads, for tables that are
+ * read far more often than they are changed such as those mapping names
+ * to objects.
+ *
+ * Lookups take no locks and never wait for writers, while changes with
+ * nih_chash_add() and nih_chash_remove() are serialised by a lock held
+ * by each table.  The table holds a reference to each value; when a
+ * value is replaced or removed, that reference is not dropped until no
+ * thread can still be reading it, so a value returned by
+ * nih_chash_lookup() may be used until the reader calls
+ * nih_chash_read_unlock(), after which it must have taken its own
+ * reference with nih_ref() to keep using it.
+ *
+ * Readers announce themselves by calling nih_chash_read_lock() before
+ * the lookup and nih_chash_read_unlock() afterwards, which only touch
+ * memory belonging to the calling thread; read sections may be nested
+ * but should be short since they delay the freeing of values removed
+ * from every table.
+ *
+ * Readers never use nih_alloc(), so the allocator need only be in
+ * thread-safe mode, see nih_alloc_set_thread_safe(), if tables are
+ * changed or reclaimed from more than one thread.  The table itself
+ * may only be freed once no other thread is using it.
+ **/
+
+#include <nih/macros.h>
+
+
+/**
+ * NihCHash:
+ *
+ * Opaque structure representing a concurrent hash table.
+ **/
+typedef struct nih_chash NihCHash;
+
+
+NIH_BEGIN_EXTERN
+
+NihCHash *nih_chash_new         (const void *parent, size_t entries)
+	__attribute__ ((warn_unused_result, malloc));
+
+int       nih_chash_add         (NihCHash *hash, const char *key, void *value)
+	__attribute__ ((warn_unused_result));
+int       nih_chash_remove      (NihCHash *hash, const char *key);
+
+void *    nih_chash_lookup      (NihCHash *hash, const char *key);
+size_t    nih_chash_count       (NihCHash *hash);
+
+void      nih_chash_read_lock   (void);
+void      nih_chash_read_unlock (void);
+
+void      nih_chash_reclaim     (NihCHash *hash);
+
+NIH_END_EXTERN
+
+#endif /* NIH_CHASH_H */
@@ -26,13 +26,20 @@
 
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <nih/macros.h>
 #include <nih/alloc.h>
 #include <nih/list.h>
+#include <nih/io.h>
 #include <nih/logging.h>
+#include <nih/error.h>
 
 #include "child.h"
 
@@ -44,6 +51,33 @@
  **/
 #define WAITOPTS (WEXITED | WSTOPPED | WCONTINUED)
 
+/**
+ * CAPTURE_CHUNK:
+ *
+ * Maximum number of bytes of child output moved by a single splice(),
+ * tee() or read() call.
+ **/
+#define CAPTURE_CHUNK 16384
+
+
+/* Prototypes for static functions */
+static void    nih_child_capture_watcher  (NihChildCapture *capture,
+					   NihIoWatch *watch,
+					   NihIoEvents events);
+static void    nih_child_capture_handler  (NihChildCapture *capture,
+					   pid_t pid, NihChildEvents event,
+					   int status);
+static int     nih_child_capture_transfer (NihChildCapture *capture);
+static ssize_t nih_child_capture_lines    (NihChildCapture *capture,
+					   const struct timespec *stamp);
+static ssize_t nih_child_capture_move     (NihChildCapture *capture,
+					   size_t len);
+static void    nih_child_capture_write    (NihChildCapture *capture,
+					   const char *buf, size_t len);
+static void    nih_child_capture_dispatch (NihChildCapture *capture,
+					   const struct timespec *stamp,
+					   int eof);
+
 
 /**
  * nih_child_watches:
@@ -122,6 +156,75 @@ nih_child_add_watch (const void      *parent,
 	watch->handler = handler;
 	watch->data = data;
 
+	watch->rusage_handler = NULL;
+
+	nih_list_add (nih_child_watches, &watch->entry);
+
+	return watch;
+}
+
+/**
+ * nih_child_add_rusage_watch:
+ * @parent: parent object for new watch,
+ * @pid: process id to watch or -1,
+ * @events: events to watch for,
+ * @handler: function to call on @events,
+ * @data: pointer to pass to @handler.
+ *
+ * Adds @handler to the list of functions that should be called by
+ * nih_child_poll() if any of the events listed in @events occurs to the
+ * process with id @pid, in the same manner as nih_child_add_watch()
+ * except that @handler is also passed the resource usage of the process.
+ *
+ * The resource usage is returned by the same wait4() call that reaps
+ * the process, so it can't race with the process going away as reading
+ * it from /proc would; it is only available once the process has
+ * terminated, and is zeroed for other events.
+ *
+ * The watch structure is allocated using nih_alloc() and stored in a linked
+ * list; there is no non-allocated version because of this and because it
+ * will be automatically freed once called if @pid is not -1 and the event
+ * indicates that the process has terminated.
+ *
+ * Removal of the watch can be performed by freeing it.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned watch.  When all parents
+ * of the returned watch are freed, the returned watch will also be
+ * freed.
+ *
+ * Returns: the watch information, or NULL if insufficient memory.
+ **/
+NihChildWatch *
+nih_child_add_rusage_watch (const void            *parent,
+			    pid_t                  pid,
+			    NihChildEvents         events,
+			    NihChildRusageHandler  handler,
+			    void                  *data)
+{
+	NihChildWatch *watch;
+
+	nih_assert (pid != 0);
+	nih_assert (handler != NULL);
+
+	nih_child_init ();
+
+	watch = nih_new (parent, NihChildWatch);
+	if (! watch)
+		return NULL;
+
+	nih_list_init (&watch->entry);
+
+	nih_alloc_set_destructor (watch, nih_list_destroy);
+
+	watch->pid = pid;
+	watch->events = events;
+
+	watch->handler = NULL;
+	watch->data = data;
+
+	watch->rusage_handler = handler;
+
 	nih_list_add (nih_child_watches, &watch->entry);
 
 	return watch;
@@ -136,12 +239,19 @@ nih_child_add_watch (const void      *parent,
  * watches is iterated and the handler function for appropriate entries
  * is called.
  *
+ * Each event is first read with WNOWAIT so that it is left pending;
+ * when it indicates that the child has terminated, the child is then
+ * reaped with wait4() which also returns its resource usage for watches
+ * added with nih_child_add_rusage_watch(), otherwise the event is
+ * consumed with a second waitid() call and the usage passed is zeroed.
+ *
  * It is safe for the handler to remove itself.
  **/
 void
 nih_child_poll (void)
 {
-	siginfo_t info;
+	siginfo_t     info;
+	struct rusage usage;
 
 	nih_child_init ();
 
@@ -153,8 +263,9 @@ nih_child_poll (void)
 	 * So we have to take care to do it ourselves before every call.
 	 */
 	memset (&info, 0, sizeof (info));
+	memset (&usage, 0, sizeof (usage));
 
-	while (waitid (P_ALL, 0, &info, WAITOPTS | WNOHANG) == 0) {
+	while (waitid (P_ALL, 0, &info, WAITOPTS | WNOHANG | WNOWAIT) == 0) {
 		pid_t          pid;
 		NihChildEvents event;
 		int            status, free_watch = TRUE;
@@ -205,6 +316,23 @@ nih_child_poll (void)
 			nih_assert_not_reached ();
 		}
 
+		/* Consume the event we peeked at; a terminated child can't
+		 * change state, so it's safe to reap it with wait4() to get
+		 * its usage, but a stopped or continued one might since die
+		 * so we must not consume its exit status here.
+		 */
+		if (free_watch) {
+			while ((wait4 (pid, NULL, WNOHANG, &usage) < 0)
+			       && (errno == EINTR))
+				;
+		} else {
+			siginfo_t consumed;
+
+			memset (&consumed, 0, sizeof (consumed));
+			waitid (P_PID, pid, &consumed,
+				WSTOPPED | WCONTINUED | WNOHANG);
+		}
+
 		NIH_LIST_FOREACH_SAFE (nih_child_watches, iter) {
 			NihChildWatch *watch = (NihChildWatch *)iter;
 
@@ -214,7 +342,13 @@ nih_child_poll (void)
 			if (! (watch->events & event))
 				continue;
 
-			watch->handler (watch->data, pid, event, status);
+			if (watch->rusage_handler) {
+				watch->rusage_handler (watch->data, pid, event,
+						       status, &usage);
+			} else {
+				watch->handler (watch->data, pid, event,
+						status);
+			}
 
 			if (free_watch && (watch->pid != -1))
 				nih_free (watch);
@@ -222,5 +356,536 @@ nih_child_poll (void)
 
 		/* For next waitid call */
 		memset (&info, 0, sizeof (info));
+		memset (&usage, 0, sizeof (usage));
 	}
 }
+
+
+/**
+ * nih_child_capture_new:
+ * @parent: parent object for new capture,
+ * @pid: process whose output is captured,
+ * @fd: read end of pipe connected to the output of @pid,
+ * @out_fd: file descriptor to move output to, or -1,
+ * @flags: capture flags,
+ * @reader: function to call for each line of output,
+ * @data: pointer to pass to @reader.
+ *
+ * Captures the output of the child process @pid, which should have had
+ * its standard output and/or standard error connected to the write end
+ * of a pipe whose read end is @fd.  Ownership of @fd passes to the
+ * capture, which closes it when freed; @out_fd remains owned by the
+ * caller and must stay open for as long as the capture exists.
+ *
+ * Whenever data is available on @fd it is moved to @out_fd, a log file
+ * or socket, using splice() so that it never needs to be copied into
+ * our own address space.  Files opened with O_APPEND, and other
+ * descriptors that don't support splice(), fall back to read() and
+ * write().  @out_fd should not be non-blocking, otherwise output may
+ * be lost when it cannot keep up.
+ *
+ * If @reader is given, the output is additionally duplicated with tee()
+ * and @reader is called for each complete line; when @flags includes
+ * NIH_CHILD_CAPTURE_TIMESTAMP it is also given the time the line was
+ * read.  @out_fd may be -1 if you're only interested in the lines, if
+ * @reader is also NULL the output is discarded.
+ *
+ * The capture also adds a watch on @pid, so that when the child
+ * terminates any output remaining in the pipe is handled before
+ * nih_child_poll() calls child watches added after this one.  Once
+ * both the child has terminated and the pipe has been closed the
+ * capture is freed automatically.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned capture.  When all parents
+ * of the returned capture are freed, the returned capture will also be
+ * freed.
+ *
+ * Returns: newly allocated capture, or NULL on raised error.
+ **/
+NihChildCapture *
+nih_child_capture_new (const void            *parent,
+		       pid_t                  pid,
+		       int                    fd,
+		       int                    out_fd,
+		       NihChildCaptureFlags   flags,
+		       NihChildCaptureReader  reader,
+		       void                  *data)
+{
+	NihChildCapture *capture;
+
+	nih_assert (pid > 0);
+	nih_assert (fd >= 0);
+
+	capture = nih_new (parent, NihChildCapture);
+	if (! capture)
+		nih_return_no_memory_error (NULL);
+
+	capture->pid = pid;
+	capture->fd = fd;
+	capture->out_fd = out_fd;
+	capture->flags = flags;
+	capture->splice = TRUE;
+
+	capture->tee_fd[0] = -1;
+	capture->tee_fd[1] = -1;
+	capture->line_buf = NULL;
+
+	capture->io_watch = NULL;
+	capture->child_watch = NULL;
+
+	capture->reader = reader;
+	capture->data = data;
+
+	nih_alloc_set_destructor (capture, nih_child_capture_destroy);
+
+	if (reader) {
+		capture->line_buf = nih_io_buffer_new (capture);
+		if (! capture->line_buf) {
+			nih_error_raise_no_memory ();
+			goto error;
+		}
+
+		/* The tee pipe is only needed when there's somewhere else
+		 * for the output to go.
+		 */
+		if (out_fd >= 0) {
+			if (pipe (capture->tee_fd) < 0) {
+				nih_error_raise_system ();
+				goto error;
+			}
+
+			if ((nih_io_set_nonblock (capture->tee_fd[0]) < 0)
+			    || (nih_io_set_nonblock (capture->tee_fd[1]) < 0)
+			    || (nih_io_set_cloexec (capture->tee_fd[0]) < 0)
+			    || (nih_io_set_cloexec (capture->tee_fd[1]) < 0)) {
+				nih_error_raise_system ();
+				goto error;
+			}
+		}
+	}
+
+	if (nih_io_set_nonblock (fd) < 0) {
+		nih_error_raise_system ();
+		goto error;
+	}
+
+	capture->io_watch = nih_io_add_watch (
+		capture, fd, NIH_IO_READ,
+		(NihIoWatcher)nih_child_capture_watcher, capture);
+	if (! capture->io_watch) {
+		nih_error_raise_no_memory ();
+		goto error;
+	}
+
+	capture->io_watch->caller = __builtin_return_address (0);
+
+	/* Not a child of the capture since nih_child_poll() frees the
+	 * watch itself after calling our handler, which may well free
+	 * the capture.
+	 */
+	capture->child_watch = nih_child_add_watch (
+		NULL, pid, NIH_CHILD_EXITED | NIH_CHILD_KILLED | NIH_CHILD_DUMPED,
+		(NihChildHandler)nih_child_capture_handler, capture);
+	if (! capture->child_watch) {
+		nih_error_raise_no_memory ();
+		goto error;
+	}
+
+	return capture;
+error:
+	/* Don't close the caller's descriptor when they'll still have it */
+	capture->fd = -1;
+	nih_free (capture);
+	return NULL;
+}
+
+/**
+ * nih_child_capture_destroy:
+ * @capture: capture to be destroyed.
+ *
+ * Closes the pipe from the child process and the internal tee pipe, and
+ * removes the watch on the child process.  The output file descriptor
+ * is not closed.
+ *
+ * Normally used or called from an nih_alloc() destructor.
+ *
+ * Returns: zero.
+ **/
+int
+nih_child_capture_destroy (NihChildCapture *capture)
+{
+	nih_assert (capture != NULL);
+
+	if (capture->child_watch)
+		nih_free (capture->child_watch);
+
+	if (capture->fd >= 0)
+		close (capture->fd);
+
+	if (capture->tee_fd[0] >= 0) {
+		close (capture->tee_fd[0]);
+		close (capture->tee_fd[1]);
+	}
+
+	return 0;
+}
+
+
+/**
+ * nih_child_capture_watcher:
+ * @capture: capture structure,
+ * @watch: NihIoWatch for which an event occurred,
+ * @events: events that occurred.
+ *
+ * This is the watcher function associated with the pipe from the child,
+ * it moves all data available to the output and stops watching the pipe
+ * once it has been closed; freeing the capture if the child has already
+ * been reaped.
+ **/
+static void
+nih_child_capture_watcher (NihChildCapture *capture,
+			   NihIoWatch      *watch,
+			   NihIoEvents      events)
+{
+	nih_assert (capture != NULL);
+	nih_assert (watch != NULL);
+
+	if (! nih_child_capture_transfer (capture))
+		return;
+
+	nih_free (capture->io_watch);
+	capture->io_watch = NULL;
+
+	if (! capture->child_watch)
+		nih_free (capture);
+}
+
+/**
+ * nih_child_capture_handler:
+ * @capture: capture structure,
+ * @pid: process that changed,
+ * @event: event that occurred on the child,
+ * @status: exit status, signal or ptrace event.
+ *
+ * This is the child handler associated with the process being captured,
+ * it handles any output the child left in the pipe before dying so that
+ * it's seen before the termination is handled by later watches, and
+ * frees the capture if the pipe has already been closed.
+ **/
+static void
+nih_child_capture_handler (NihChildCapture *capture,
+			   pid_t            pid,
+			   NihChildEvents   event,
+			   int              status)
+{
+	nih_assert (capture != NULL);
+
+	/* nih_child_poll() frees the watch for us */
+	capture->child_watch = NULL;
+
+	if (capture->io_watch && nih_child_capture_transfer (capture)) {
+		nih_free (capture->io_watch);
+		capture->io_watch = NULL;
+	}
+
+	if (! capture->io_watch)
+		nih_free (capture);
+}
+
+/**
+ * nih_child_capture_transfer:
+ * @capture: capture structure.
+ *
+ * Moves as much data as is available in the pipe from the child to the
+ * output, passing it to the reader function if required.
+ *
+ * Returns: TRUE if the pipe was closed, FALSE if it's merely empty.
+ **/
+static int
+nih_child_capture_transfer (NihChildCapture *capture)
+{
+	struct timespec  now;
+	struct timespec *stamp = NULL;
+
+	nih_assert (capture != NULL);
+
+	/* One timestamp is used for everything read in one go, and only
+	 * if anyone is interested in it.
+	 */
+	if (capture->reader
+	    && (capture->flags & NIH_CHILD_CAPTURE_TIMESTAMP)) {
+		nih_assert (clock_gettime (CLOCK_REALTIME, &now) == 0);
+		stamp = &now;
+	}
+
+	for (;;) {
+		ssize_t len;
+
+		if (capture->reader) {
+			len = nih_child_capture_lines (capture, stamp);
+		} else {
+			len = nih_child_capture_move (capture, CAPTURE_CHUNK);
+		}
+
+		if (len > 0)
+			continue;
+
+		if (len < 0) {
+			switch (errno) {
+			case EINTR:
+				continue;
+			case EAGAIN:
+			case ENOMEM:
+				return FALSE;
+			default:
+				nih_warn ("%s: %s",
+					  _("Error while reading child output"),
+					  strerror (errno));
+				break;
+			}
+		}
+
+		/* Pass on any final partial line */
+		if (capture->reader)
+			nih_child_capture_dispatch (capture, stamp, TRUE);
+
+		return TRUE;
+	}
+}
+
+/**
+ * nih_child_capture_lines:
+ * @capture: capture structure,
+ * @stamp: timestamp to pass to the reader.
+ *
+ * Moves up to CAPTURE_CHUNK bytes from the pipe to the output, while
+ * duplicating them into the line buffer, and calls the reader function
+ * for each complete line now in that buffer.
+ *
+ * Returns: number of bytes moved, zero if the pipe was closed or negative
+ * value on error with errno set.
+ **/
+static ssize_t
+nih_child_capture_lines (NihChildCapture       *capture,
+			 const struct timespec *stamp)
+{
+	NihIoBuffer *buffer;
+	ssize_t      len;
+
+	nih_assert (capture != NULL);
+	nih_assert (capture->reader != NULL);
+
+	buffer = capture->line_buf;
+	if (nih_io_buffer_resize (buffer, CAPTURE_CHUNK) < 0) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if ((capture->out_fd >= 0) && capture->splice) {
+		char    discard[CAPTURE_CHUNK];
+		size_t  done;
+		ssize_t ret = 0;
+		int     saved_errno;
+
+		/* Duplicate the data in the pipe without consuming it,
+		 * then move it to the output; that way we're only copying
+		 * it once, into the line buffer.
+		 */
+		len = tee (capture->fd, capture->tee_fd[1], CAPTURE_CHUNK,
+			   SPLICE_F_NONBLOCK);
+		if ((len < 0) && (errno == EINVAL)) {
+			/* Not a pipe; fall back to reading and writing */
+			capture->splice = FALSE;
+			return nih_child_capture_lines (capture, stamp);
+		} else if (len <= 0) {
+			return len;
+		}
+
+		for (done = 0; done < (size_t)len; ) {
+			ret = nih_child_capture_move (capture, len - done);
+			if (ret > 0) {
+				done += ret;
+			} else if ((ret == 0) || (errno != EINTR)) {
+				break;
+			}
+		}
+
+		saved_errno = errno;
+
+		/* Only the data actually moved has been consumed from the
+		 * pipe, anything left there will be duplicated again next
+		 * time; so pass only what was moved on to the line buffer
+		 * and throw the rest of the duplicate away.
+		 */
+		while ((done > 0)
+		       && (read (capture->tee_fd[0], buffer->buf + buffer->len,
+				 done) < 0))
+			nih_assert (errno == EINTR);
+
+		while ((done < (size_t)len)
+		       && (read (capture->tee_fd[0], discard,
+				 len - done) < 0))
+			nih_assert (errno == EINTR);
+
+		if (! done) {
+			errno = saved_errno;
+			return ret;
+		}
+
+		len = done;
+	} else {
+		len = read (capture->fd, buffer->buf + buffer->len,
+			    buffer->size - buffer->len);
+		if (len <= 0)
+			return len;
+
+		if (capture->out_fd >= 0)
+			nih_child_capture_write (capture,
+						 buffer->buf + buffer->len,
+						 len);
+	}
+
+	buffer->len += len;
+
+	nih_child_capture_dispatch (capture, stamp, FALSE);
+
+	return len;
+}
+
+/**
+ * nih_child_capture_move:
+ * @capture: capture structure,
+ * @len: maximum number of bytes to move.
+ *
+ * Moves up to @len bytes from the pipe to the output without copying
+ * them through our address space where possible.  If there's no output
+ * the data is simply discarded.
+ *
+ * Errors writing to the output are logged and further output discarded,
+ * since the child would block forever if we stopped reading the pipe.
+ *
+ * Returns: number of bytes moved, zero if the pipe was closed or negative
+ * value on error with errno set.
+ **/
+static ssize_t
+nih_child_capture_move (NihChildCapture *capture,
+			size_t           len)
+{
+	char    buf[CAPTURE_CHUNK];
+	ssize_t ret;
+
+	nih_assert (capture != NULL);
+	nih_assert (len <= CAPTURE_CHUNK);
+
+	if ((capture->out_fd >= 0) && capture->splice) {
+		ret = splice (capture->fd, NULL, capture->out_fd, NULL, len,
+			      SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if ((ret >= 0) || (errno == EAGAIN) || (errno == EINTR))
+			return ret;
+
+		if (errno != EINVAL) {
+			nih_warn ("%s: %s", _("Error while writing child output"),
+				  strerror (errno));
+			capture->out_fd = -1;
+		}
+
+		/* Output was opened with O_APPEND or otherwise doesn't
+		 * support splice; we'll have to copy the data ourselves.
+		 */
+		capture->splice = FALSE;
+	}
+
+	ret = read (capture->fd, buf, len);
+	if ((ret > 0) && (capture->out_fd >= 0))
+		nih_child_capture_write (capture, buf, ret);
+
+	return ret;
+}
+
+/**
+ * nih_child_capture_write:
+ * @capture: capture structure,
+ * @buf: data to write,
+ * @len: length of @buf.
+ *
+ * Writes all of @buf to the output, logging any error and discarding
+ * further output if one occurs.
+ **/
+static void
+nih_child_capture_write (NihChildCapture *capture,
+			 const char      *buf,
+			 size_t           len)
+{
+	nih_assert (capture != NULL);
+	nih_assert (capture->out_fd >= 0);
+
+	while (len) {
+		ssize_t ret;
+
+		ret = write (capture->out_fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			nih_warn ("%s: %s", _("Error while writing child output"),
+				  strerror (errno));
+			capture->out_fd = -1;
+			return;
+		}
+
+		buf += ret;
+		len -= ret;
+	}
+}
+
+/**
+ * nih_child_capture_dispatch:
+ * @capture: capture structure,
+ * @stamp: timestamp to pass to the reader,
+ * @eof: TRUE if the pipe has been closed.
+ *
+ * Calls the reader function for each complete line in the line buffer,
+ * and removes them from it.  Lines longer than NIH_CHILD_CAPTURE_LINE_MAX
+ * are passed in pieces of that length, and when @eof is TRUE any
+ * remaining partial line is passed as well.
+ **/
+static void
+nih_child_capture_dispatch (NihChildCapture       *capture,
+			    const struct timespec *stamp,
+			    int                    eof)
+{
+	NihIoBuffer *buffer;
+	size_t       off = 0;
+
+	nih_assert (capture != NULL);
+	nih_assert (capture->reader != NULL);
+
+	buffer = capture->line_buf;
+
+	while (off < buffer->len) {
+		size_t  len, skip;
+		char   *nl;
+
+		len = buffer->len - off;
+		if (len > NIH_CHILD_CAPTURE_LINE_MAX)
+			len = NIH_CHILD_CAPTURE_LINE_MAX;
+
+		nl = memchr (buffer->buf + off, '\n', len);
+		if (nl) {
+			len = nl - (buffer->buf + off);
+			skip = 1;
+		} else if ((len == NIH_CHILD_CAPTURE_LINE_MAX) || eof) {
+			skip = 0;
+		} else {
+			break;
+		}
+
+		capture->reader (capture->data, capture, stamp,
+				 buffer->buf + off, len);
+		off += len + skip;
+	}
+
+	if (off)
+		nih_io_buffer_shrink (buffer, off);
+}
@@ -22,9 +22,23 @@
 
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+
+#include <time.h>
 
 #include <nih/macros.h>
 #include <nih/list.h>
+#include <nih/io.h>
+
+
+/**
+ * NIH_CHILD_CAPTURE_LINE_MAX:
+ *
+ * Maximum length of a line of child output passed to a capture reader;
+ * longer runs of output without a newline are passed in pieces of this
+ * length.
+ **/
+#define NIH_CHILD_CAPTURE_LINE_MAX 32768
 
 
 /**
@@ -62,19 +76,41 @@ typedef enum {
 typedef void (*NihChildHandler) (void *data, pid_t pid,
 				 NihChildEvents event, int status);
 
+/**
+ * NihChildRusageHandler:
+ * @data: data pointer given with callback,
+ * @pid: process that changed,
+ * @event: event that occurred on the child,
+ * @status: exit status of process, signal that killed it or ptrace event,
+ * @rusage: resource usage of the process.
+ *
+ * A child rusage handler is a function called for events on the child
+ * process obtained through waitid(), that additionally receives the
+ * resource usage of the child.  For events indicating that the process
+ * has terminated, this is the final usage of the process and any of its
+ * own children that it waited for, as returned by wait4() when reaping
+ * it; for other events it is zeroed.
+ **/
+typedef void (*NihChildRusageHandler) (void *data, pid_t pid,
+				       NihChildEvents event, int status,
+				       const struct rusage *rusage);
+
 /**
  * NihChildWatch:
  * @entry: list header,
  * @pid: process id to watch or -1,
  * @events: events to watch for,
  * @handler: function called when events occur to child,
- * @data: pointer passed to @reaper.
+ * @data: pointer passed to @reaper,
+ * @rusage_handler: function called with resource usage instead of @handler.
  *
  * This structure represents a watch on a particular child, the @reaper
  * function is called when an event in @events occurs to a child with
  * process id @pid.  If @pid is -1 then this function is called when @events
  * occur for all processes.
  *
+ * Only one of @handler or @rusage_handler is set.
+ *
  * The watch can be cancelled by calling nih_list_remove() on the structure
  * as they are held in a list internally.
  **/
@@ -85,22 +121,119 @@ typedef struct nih_child_watch {
 
 	NihChildHandler  handler;
 	void            *data;
+
+	NihChildRusageHandler rusage_handler;
 } NihChildWatch;
 
 
+/**
+ * NihChildCaptureFlags:
+ *
+ * Flags that modify how the output of a child process is captured; they
+ * only have any effect when a reader function is given.
+ **/
+typedef enum {
+	NIH_CHILD_CAPTURE_NONE      = 00,
+	NIH_CHILD_CAPTURE_TIMESTAMP = 01,
+} NihChildCaptureFlags;
+
+/* Predefine the typedef as we use it in the callback */
+typedef struct nih_child_capture NihChildCapture;
+
+/**
+ * NihChildCaptureReader:
+ * @data: data pointer given with callback,
+ * @capture: capture the line was read from,
+ * @stamp: time the line was read, or NULL,
+ * @line: line of output,
+ * @len: length of @line.
+ *
+ * A capture reader is a function called for each complete line of output
+ * from a child process, @line is not NULL-terminated and does not include
+ * the newline character.  A final partial line is passed once the child
+ * closes its end of the pipe, and a line longer than
+ * NIH_CHILD_CAPTURE_LINE_MAX is passed in pieces of that length so that
+ * the child cannot make us buffer an unlimited amount of output.
+ *
+ * @stamp is only given when the capture was created with the
+ * NIH_CHILD_CAPTURE_TIMESTAMP flag.
+ *
+ * You must not nih_free() @capture or cause it to be freed from within
+ * this function.
+ **/
+typedef void (*NihChildCaptureReader) (void *data, NihChildCapture *capture,
+				       const struct timespec *stamp,
+				       const char *line, size_t len);
+
+/**
+ * NihChildCapture:
+ * @pid: process whose output is captured,
+ * @fd: read end of the pipe connected to the child's output,
+ * @out_fd: file descriptor output is moved to, or -1,
+ * @flags: capture flags,
+ * @splice: TRUE while @out_fd accepts splice(),
+ * @tee_fd: pipe used to duplicate output for @reader,
+ * @line_buf: buffer holding output not yet passed to @reader,
+ * @io_watch: watch on @fd,
+ * @child_watch: watch on @pid,
+ * @reader: function called for each line of output,
+ * @data: pointer passed to @reader.
+ *
+ * This structure represents the capture of the output of a child process
+ * from a pipe to a log file or socket.  Output is moved from @fd to
+ * @out_fd within the kernel using splice() and never copied into our
+ * own address space unless @reader is given, in which case it's
+ * duplicated with tee() into @line_buf and split into lines.
+ *
+ * The structure is freed automatically once both @pid has terminated
+ * and the child's end of the pipe has been closed; at which point both
+ * @io_watch and @child_watch will be NULL.
+ **/
+struct nih_child_capture {
+	pid_t                  pid;
+	int                    fd;
+	int                    out_fd;
+	NihChildCaptureFlags   flags;
+	int                    splice;
+
+	int                    tee_fd[2];
+	NihIoBuffer           *line_buf;
+
+	NihIoWatch            *io_watch;
+	NihChildWatch         *child_watch;
+
+	NihChildCaptureReader  reader;
+	void                  *data;
+};
+
+
 NIH_BEGIN_EXTERN
 
 extern NihList *nih_child_watches;
 
 
-void           nih_child_init      (void);
+void             nih_child_init             (void);
 
-NihChildWatch *nih_child_add_watch (const void *parent, pid_t pid,
-				    NihChildEvents events,
-				    NihChildHandler handler, void *data)
+NihChildWatch *  nih_child_add_watch        (const void *parent, pid_t pid,
+					     NihChildEvents events,
+					     NihChildHandler handler,
+					     void *data)
+	__attribute__ ((warn_unused_result));
+NihChildWatch *  nih_child_add_rusage_watch (const void *parent, pid_t pid,
+					     NihChildEvents events,
+					     NihChildRusageHandler handler,
+					     void *data)
 	__attribute__ ((warn_unused_result));
 
-void           nih_child_poll      (void);
+void             nih_child_poll             (void);
+
+NihChildCapture *nih_child_capture_new      (const void *parent, pid_t pid,
+					     int fd, int out_fd,
+					     NihChildCaptureFlags flags,
+					     NihChildCaptureReader reader,
+					     void *data)
+	__attribute__ ((warn_unused_result));
+int              nih_child_capture_destroy  (NihChildCapture *capture);
 
 NIH_END_EXTERN
 
@@ -41,6 +41,9 @@ enum {
 	NIH_CONFIG_UNKNOWN_STANZA,
 
 	NIH_DIR_LOOP_DETECTED,
+	NIH_SNAPSHOT_INVALID,
+	NIH_SNAPSHOT_UNKNOWN_TYPE,
+	NIH_SNAPSHOT_NOT_FOUND,
 
 	/* 0x20000 thru 0x2FFFF reserved for applications */
 	NIH_ERROR_APPLICATION_START = 0x20000L,
@@ -61,5 +64,8 @@ enum {
 #define NIH_CONFIG_UNKNOWN_STANZA_STR      N_("Unknown stanza")
 
 #define NIH_DIR_LOOP_DETECTED_STR          N_("Directory loop detected")
+#define NIH_SNAPSHOT_INVALID_STR           N_("Invalid snapshot image")
+#define NIH_SNAPSHOT_UNKNOWN_TYPE_STR      N_("Unknown type in snapshot image")
+#define NIH_SNAPSHOT_NOT_FOUND_STR         N_("No such object in snapshot image")
 
 #endif /* NIH_ERRORS_H */
@@ -0,0 +1,208 @@
+/* libnih
+ *
+ * event.c - lightweight notifications based on eventfd
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <sys/eventfd.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/io.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include "event.h"
+
+
+/* Prototypes for static functions */
+static void nih_event_watcher (NihEvent *event, NihIoWatch *watch,
+			       NihIoEvents events);
+
+
+/**
+ * nih_event_new:
+ * @parent: parent object for new event,
+ * @flags: event flags,
+ * @handler: function to call when triggered,
+ * @data: pointer to pass to @handler.
+ *
+ * Allocates a new event that will result in @handler being called from
+ * the main loop once it has been triggered with nih_event_trigger().
+ *
+ * Triggers are coalesced, so that no matter how many times the event is
+ * triggered between main loop iterations @handler is only called once
+ * with the total.  If @flags includes NIH_EVENT_SEMAPHORE then @handler
+ * is instead called once per main loop iteration, with a count of one,
+ * until the total has been consumed.
+ *
+ * The event structure is allocated using nih_alloc() and the underlying
+ * eventfd is closed when it is freed.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned event.  When all parents
+ * of the returned event are freed, the returned event will also be
+ * freed.
+ *
+ * Returns: newly allocated event, or NULL on raised error.
+ **/
+NihEvent *
+nih_event_new (const void      *parent,
+	       NihEventFlags    flags,
+	       NihEventHandler  handler,
+	       void            *data)
+{
+	NihEvent *event;
+	int       efd_flags;
+
+	nih_assert (handler != NULL);
+
+	event = nih_new (parent, NihEvent);
+	if (! event)
+		nih_return_no_memory_error (NULL);
+
+	efd_flags = EFD_NONBLOCK | EFD_CLOEXEC;
+	if (flags & NIH_EVENT_SEMAPHORE)
+		efd_flags |= EFD_SEMAPHORE;
+
+	event->fd = eventfd (0, efd_flags);
+	if (event->fd < 0) {
+		nih_error_raise_system ();
+		nih_free (event);
+		return NULL;
+	}
+
+	event->flags = flags;
+	event->handler = handler;
+	event->data = data;
+
+	nih_alloc_set_destructor (event, nih_event_destroy);
+
+	event->watch = nih_io_add_watch (event, event->fd, NIH_IO_READ,
+					 (NihIoWatcher)nih_event_watcher,
+					 event);
+	if (! event->watch) {
+		nih_free (event);
+		nih_return_no_memory_error (NULL);
+	}
+
+	event->watch->caller = __builtin_return_address (0);
+
+	return event;
+}
+
+/**
+ * nih_event_destroy:
+ * @event: event to be destroyed.
+ *
+ * Closes the eventfd associated with @event so that it can be freed;
+ * you must ensure that no other thread is still triggering the event.
+ *
+ * Normally used or called from an nih_alloc() destructor.
+ *
+ * Returns: zero.
+ **/
+int
+nih_event_destroy (NihEvent *event)
+{
+	nih_assert (event != NULL);
+
+	close (event->fd);
+
+	return 0;
+}
+
+
+/**
+ * nih_event_trigger:
+ * @event: event to trigger,
+ * @value: amount to add to counter.
+ *
+ * Triggers @event by adding @value to its counter, resulting in its
+ * handler being called in the next main loop iteration.
+ *
+ * This function makes a single write() system call and touches no other
+ * state, so it may be safely called from any thread or from a signal
+ * handler.  For the same reason it does not raise an error, and errno is
+ * preserved so that the interrupted code does not see it change; instead
+ * the negated error number is returned, -EAGAIN indicating that the
+ * counter would overflow.
+ *
+ * Returns: zero on success, negative error number on error.
+ **/
+int
+nih_event_trigger (NihEvent *event,
+		   uint64_t  value)
+{
+	int saved_errno;
+	int ret = 0;
+
+	nih_assert (event != NULL);
+	nih_assert (value > 0);
+
+	saved_errno = errno;
+
+	while (write (event->fd, &value, sizeof (value)) < 0) {
+		if (errno != EINTR) {
+			ret = -errno;
+			break;
+		}
+	}
+
+	errno = saved_errno;
+
+	return ret;
+}
+
+
+/**
+ * nih_event_watcher:
+ * @event: event structure,
+ * @watch: NihIoWatch for which an event occurred,
+ * @events: events that occurred.
+ *
+ * This is the watcher function associated with the eventfd of @event,
+ * it reads the counter, which resets it (or decrements it by one in
+ * semaphore mode), and calls the handler function with the value read.
+ **/
+static void
+nih_event_watcher (NihEvent    *event,
+		   NihIoWatch  *watch,
+		   NihIoEvents  events)
+{
+	uint64_t count;
+
+	nih_assert (event != NULL);
+	nih_assert (watch != NULL);
+
+	while (read (event->fd, &count, sizeof (count)) < 0) {
+		/* Another reader may have beaten us to it */
+		if (errno != EINTR)
+			return;
+	}
+
+	event->handler (event->data, event, count);
+}
@@ -0,0 +1,93 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_EVENT_H
+#define NIH_EVENT_H
+
+#include <stdint.h>
+
+#include <nih/macros.h>
+#include <nih/io.h>
+
+
+/**
+ * NihEventFlags:
+ *
+ * Flags that modify how an event delivers its notifications.  In
+ * semaphore mode, the handler is called with a count of one for each
+ * main loop iteration until every trigger has been consumed; otherwise
+ * all triggers since the last call are coalesced into a single call.
+ **/
+typedef enum {
+	NIH_EVENT_NONE      = 00,
+	NIH_EVENT_SEMAPHORE = 01,
+} NihEventFlags;
+
+/**
+ * NihEventHandler:
+ * @data: pointer given with handler,
+ * @event: event that was triggered,
+ * @count: number of triggers being handled.
+ *
+ * An event handler is called from the main loop when the event has been
+ * triggered, @count contains the total of the values given to
+ * nih_event_trigger() since the last call, or one in semaphore mode.
+ *
+ * It is safe to free @event from within this function.
+ **/
+typedef struct nih_event NihEvent;
+typedef void (*NihEventHandler) (void *data, NihEvent *event, uint64_t count);
+
+/**
+ * NihEvent:
+ * @fd: eventfd holding the counter,
+ * @flags: event flags,
+ * @watch: I/O watch on @fd,
+ * @handler: function called when the event is triggered,
+ * @data: pointer passed to @handler.
+ *
+ * This structure represents a lightweight notification that may be
+ * triggered from any thread, or from a signal handler, and results in
+ * @handler being called from the main loop.
+ *
+ * The counter is held by the kernel in @fd so no locking is required,
+ * and since the main loop is woken by @fd becoming readable there's no
+ * need to call nih_main_loop_interrupt() either.
+ **/
+struct nih_event {
+	int              fd;
+	NihEventFlags    flags;
+	NihIoWatch      *watch;
+
+	NihEventHandler  handler;
+	void            *data;
+};
+
+
+NIH_BEGIN_EXTERN
+
+NihEvent *nih_event_new     (const void *parent, NihEventFlags flags,
+			     NihEventHandler handler, void *data)
+	__attribute__ ((warn_unused_result));
+int       nih_event_destroy (NihEvent *event);
+
+int       nih_event_trigger (NihEvent *event, uint64_t value);
+
+NIH_END_EXTERN
+
+#endif /* NIH_EVENT_H */
@@ -29,8 +29,10 @@
 #include <sys/stat.h>
 
 #include <fcntl.h>
+#include <errno.h>
 #include <stdio.h>
 #include <dirent.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -38,6 +40,7 @@
 #include <nih/macros.h>
 #include <nih/alloc.h>
 #include <nih/list.h>
+#include <nih/array.h>
 #include <nih/string.h>
 #include <nih/io.h>
 #include <nih/file.h>
@@ -45,6 +48,8 @@
 #include <nih/error.h>
 #include <nih/errors.h>
 
+#include "hash_private.h"
+
 
 /**
  * NihDirEntry:
@@ -62,17 +67,129 @@ typedef struct nih_dir_entry {
 } NihDirEntry;
 
 
+/**
+ * NIH_FILE_GLOB_DEAD:
+ *
+ * Automaton state of a final component that cannot match any pattern.
+ **/
+#define NIH_FILE_GLOB_DEAD 0
+
+/**
+ * NIH_FILE_GLOB_START:
+ *
+ * Automaton state at the start of each component.
+ **/
+#define NIH_FILE_GLOB_START 1
+
+/**
+ * NIH_FILE_GLOB_SET_SIZE:
+ *
+ * Size of the bitmap of bytes matched by a glob element.
+ **/
+#define NIH_FILE_GLOB_SET_SIZE (256 / 8)
+
+/**
+ * NIH_FILE_GLOB_HAS:
+ * @_state: set of positions,
+ * @_pos: position to test.
+ *
+ * Returns: non-zero if @_pos is in the automaton state @_state.
+ **/
+#define NIH_FILE_GLOB_HAS(_state, _pos) \
+	((_state)[(_pos) / 64] & ((uint64_t)1 << ((_pos) % 64)))
+
+/**
+ * NIH_FILE_GLOB_ADD:
+ * @_state: set of positions,
+ * @_pos: position to add.
+ *
+ * Adds @_pos to the automaton state @_state.
+ **/
+#define NIH_FILE_GLOB_ADD(_state, _pos) \
+	((_state)[(_pos) / 64] |= (uint64_t)1 << ((_pos) % 64))
+
+
+/**
+ * NihFileGlobType:
+ *
+ * Types of position within a compiled glob pattern.
+ **/
+typedef enum nih_file_glob_type {
+	NIH_FILE_GLOB_SET,
+	NIH_FILE_GLOB_STAR,
+	NIH_FILE_GLOB_END,
+} NihFileGlobType;
+
+/**
+ * NihFileGlobElement:
+ * @type: type of position,
+ * @set: bitmap of bytes matched for NIH_FILE_GLOB_SET.
+ *
+ * This structure is a single position within a pattern being compiled;
+ * a set matches one byte and moves to the next position, a star matches
+ * any number of bytes and the end accepts the input.
+ **/
+typedef struct nih_file_glob_element {
+	NihFileGlobType type;
+	uint8_t         set[NIH_FILE_GLOB_SET_SIZE];
+} NihFileGlobElement;
+
+
 /* Prototypes for static functions */
-static char **nih_dir_walk_scan  (const char *path, NihFileFilter filter,
-				  void *data)
+static void        nih_file_glob_truncate    (NihFileGlob *glob,
+					      size_t npatterns);
+static const char *nih_file_glob_parse_class (const char *pattern,
+					      uint8_t *set);
+static void        nih_file_glob_parse       (const char *pattern,
+					      NihFileGlobElement *elements,
+					      size_t *nelements);
+static void        nih_file_glob_close       (const NihFileGlobElement *elements,
+					      size_t nelements, uint64_t *state);
+static void        nih_file_glob_step        (const NihFileGlobElement *elements,
+					      size_t nelements,
+					      const uint64_t *state,
+					      unsigned char c, uint64_t *next);
+static uint32_t *  nih_file_glob_find        (const uint64_t *states,
+					      size_t nwords, uint32_t *index,
+					      size_t indexsize,
+					      const uint64_t *state);
+static int         nih_file_glob_compile     (NihFileGlob *glob)
+	__attribute__ ((warn_unused_result));
+static NihArray *nih_dir_walk_scan  (const char *path, NihFileFilter filter,
+				     void *data)
 	__attribute__ ((warn_unused_result));
-static int    nih_dir_walk_visit (const char *dirname, NihList *dirs,
-				  const char *path, NihFileFilter filter,
-				  NihFileVisitor visitor,
-				  NihFileErrorHandler error, void *data)
+static int       nih_dir_walk_visit (const char *dirname, NihList *dirs,
+				     const char *path, NihFileFilter filter,
+				     NihFileVisitor visitor,
+				     NihFileErrorHandler error, void *data)
 	__attribute__ ((warn_unused_result));
 
 
+/**
+ * nih_file_ignore_patterns:
+ *
+ * Patterns added by nih_file_glob_add_ignore(), matching the same files
+ * as nih_file_ignore().
+ **/
+static const char * const nih_file_ignore_patterns[] = {
+	/* nih_file_is_hidden */
+	".*",
+	/* nih_file_is_backup */
+	"*~", "*.bak", "*.BAK", "#*#",
+	/* nih_file_is_swap */
+	"*.swp", "*.swo", "*.swn", ".#*",
+	/* nih_file_is_rcs */
+	"*,v", "RCS", "CVS", "CVS.adm", "SCCS", ".bzr", ".bzr.log", ".hg",
+	".git", ".svn", "BitKeeper", ".arch-ids", ".arch-inventory", "{arch}",
+	"_darcs",
+	/* nih_file_is_packaging */
+	"*.dpkg-*", "*.rpmsave", "*.rpmorig", "*.rpmnew",
+	"*;[0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F]"
+	"[0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F]",
+	NULL
+};
+
+
 /**
  * nih_file_read:
  * @parent: parent object for new string,
@@ -499,6 +616,721 @@ nih_file_ignore (void       *data,
 }
 
 
+/**
+ * nih_file_glob_new:
+ * @parent: parent object for new glob.
+ *
+ * Allocates and returns a new, empty, set of glob patterns that matches
+ * nothing until patterns are added with nih_file_glob_add().
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned glob.  When all parents
+ * of the returned glob are freed, the returned glob will also be
+ * freed.
+ *
+ * Returns: new glob or NULL if insufficient memory.
+ **/
+NihFileGlob *
+nih_file_glob_new (const void *parent)
+{
+	NihFileGlob *glob;
+
+	glob = nih_new (parent, NihFileGlob);
+	if (! glob)
+		return NULL;
+
+	glob->patterns = nih_str_array_new (glob);
+	if (! glob->patterns)
+		goto error;
+
+	glob->npatterns = 0;
+
+	/* Start with the two states that every automaton has; the dead
+	 * state and the start state, which any separator returns to.
+	 */
+	memset (glob->classes, 0, sizeof (glob->classes));
+	glob->classes['/'] = 1;
+	glob->nclasses = 2;
+
+	glob->nstates = 2;
+
+	glob->table = nih_alloc (glob, sizeof (uint16_t) * 4);
+	if (! glob->table)
+		goto error;
+
+	glob->table[0] = NIH_FILE_GLOB_DEAD;
+	glob->table[1] = NIH_FILE_GLOB_START;
+	glob->table[2] = NIH_FILE_GLOB_DEAD;
+	glob->table[3] = NIH_FILE_GLOB_START;
+
+	glob->accept = nih_alloc (glob, 2);
+	if (! glob->accept)
+		goto error;
+
+	glob->accept[NIH_FILE_GLOB_DEAD] = FALSE;
+	glob->accept[NIH_FILE_GLOB_START] = FALSE;
+
+	return glob;
+error:
+	nih_free (glob);
+	return NULL;
+}
+
+/**
+ * nih_file_glob_add:
+ * @glob: glob to add to,
+ * @pattern: pattern to add.
+ *
+ * Adds @pattern to @glob, so that nih_file_glob_match() will also return
+ * TRUE for paths whose final component matches it, and compiles the
+ * patterns again.
+ *
+ * Patterns are matched against the whole of the final component, may
+ * not contain '/' and use the usual shell syntax; "*" matches any
+ * sequence of characters including none, "?" matches any one character,
+ * "[...]" matches one character in the set, which may include ranges and
+ * be negated with "!" or "^" as its first character, and "\\" matches
+ * the following character literally.  A leading "." is not treated
+ * specially.
+ *
+ * Since patterns are compiled each time, it is more efficient to
+ * add all patterns before matching any paths.
+ *
+ * Returns: zero on success, negative value on raised error; EINVAL is
+ * raised if @pattern contains '/'.
+ **/
+int
+nih_file_glob_add (NihFileGlob *glob,
+		   const char  *pattern)
+{
+	size_t npatterns;
+
+	nih_assert (glob != NULL);
+	nih_assert (pattern != NULL);
+
+	if (strchr (pattern, '/')) {
+		errno = EINVAL;
+		nih_return_system_error (-1);
+	}
+
+	npatterns = glob->npatterns;
+
+	if (! nih_str_array_add (&glob->patterns, glob, &glob->npatterns,
+				 pattern))
+		nih_return_no_memory_error (-1);
+
+	if (nih_file_glob_compile (glob) < 0) {
+		nih_file_glob_truncate (glob, npatterns);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * nih_file_glob_add_ignore:
+ * @glob: glob to add to.
+ *
+ * Adds patterns to @glob for the files and directories that
+ * nih_file_ignore() determines should normally be ignored, those that
+ * are hidden, backup files, editor swap files, used by revision control
+ * systems or by package managers, and compiles the patterns again.
+ *
+ * The only difference is that packaging files are matched by
+ * "*.dpkg-*" wherever a later "." appears, while nih_file_is_packaging()
+ * only considers the last.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_file_glob_add_ignore (NihFileGlob *glob)
+{
+	const char * const *pattern;
+	size_t              npatterns;
+
+	nih_assert (glob != NULL);
+
+	npatterns = glob->npatterns;
+
+	for (pattern = nih_file_ignore_patterns; *pattern; pattern++) {
+		if (! nih_str_array_add (&glob->patterns, glob,
+					 &glob->npatterns, *pattern)) {
+			nih_file_glob_truncate (glob, npatterns);
+			nih_return_no_memory_error (-1);
+		}
+	}
+
+	if (nih_file_glob_compile (glob) < 0) {
+		nih_file_glob_truncate (glob, npatterns);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * nih_file_glob_truncate:
+ * @glob: glob to truncate,
+ * @npatterns: number of patterns to keep.
+ *
+ * Removes the patterns added to @glob after the first @npatterns, used
+ * when they could not be compiled; the automaton is left unchanged.
+ **/
+static void
+nih_file_glob_truncate (NihFileGlob *glob,
+			size_t       npatterns)
+{
+	nih_assert (glob != NULL);
+	nih_assert (npatterns <= glob->npatterns);
+
+	while (glob->npatterns > npatterns)
+		nih_free (glob->patterns[--glob->npatterns]);
+
+	glob->patterns[npatterns] = NULL;
+}
+
+/**
+ * nih_file_glob_parse_class:
+ * @pattern: pattern at opening bracket,
+ * @set: set to fill.
+ *
+ * Parses the bracket expression at the start of @pattern, setting the
+ * bits in @set for the bytes that it matches.
+ *
+ * Returns: pointer to the character after the closing bracket, or NULL
+ * if the expression is not terminated.
+ **/
+static const char *
+nih_file_glob_parse_class (const char *pattern,
+			   uint8_t    *set)
+{
+	const unsigned char *ptr;
+	int                  negate = FALSE, first = TRUE;
+	size_t               i;
+
+	nih_assert (pattern != NULL);
+	nih_assert (pattern[0] == '[');
+	nih_assert (set != NULL);
+
+	ptr = (const unsigned char *)pattern + 1;
+	if ((*ptr == '!') || (*ptr == '^')) {
+		negate = TRUE;
+		ptr++;
+	}
+
+	while (first || (*ptr != ']')) {
+		unsigned char start, end;
+		unsigned int  c;
+
+		first = FALSE;
+
+		if ((*ptr == '\\') && ptr[1])
+			ptr++;
+		if (! *ptr)
+			return NULL;
+
+		start = end = *(ptr++);
+
+		if ((ptr[0] == '-') && ptr[1] && (ptr[1] != ']')) {
+			ptr++;
+			if ((*ptr == '\\') && ptr[1])
+				ptr++;
+
+			end = *(ptr++);
+		}
+
+		for (c = start; c <= end; c++)
+			set[c / 8] |= 1 << (c % 8);
+	}
+
+	if (negate)
+		for (i = 0; i < NIH_FILE_GLOB_SET_SIZE; i++)
+			set[i] = ~set[i];
+
+	/* Neither the terminator nor a separator ever match */
+	set['\0' / 8] &= ~(1 << ('\0' % 8));
+	set['/' / 8] &= ~(1 << ('/' % 8));
+
+	return (const char *)ptr + 1;
+}
+
+/**
+ * nih_file_glob_parse:
+ * @pattern: pattern to parse,
+ * @elements: array to append to,
+ * @nelements: number of elements in @elements.
+ *
+ * Parses @pattern into a sequence of elements appended to @elements,
+ * followed by an element that marks its end; @elements must have room
+ * for one more element than there are characters in @pattern.
+ *
+ * Each element is a position in the automaton, which is compiled from
+ * the sets of positions that may be reached for each input.
+ **/
+static void
+nih_file_glob_parse (const char        *pattern,
+		     NihFileGlobElement *elements,
+		     size_t            *nelements)
+{
+	const char *ptr;
+	int         star = FALSE;
+
+	nih_assert (pattern != NULL);
+	nih_assert (elements != NULL);
+	nih_assert (nelements != NULL);
+
+	ptr = pattern;
+	while (*ptr) {
+		NihFileGlobElement *element = &elements[*nelements];
+		const char         *next;
+
+		memset (element, 0, sizeof (NihFileGlobElement));
+
+		if (*ptr == '*') {
+			ptr++;
+
+			/* Consecutive stars match the same as one */
+			if (star)
+				continue;
+
+			element->type = NIH_FILE_GLOB_STAR;
+		} else if (*ptr == '?') {
+			ptr++;
+
+			element->type = NIH_FILE_GLOB_SET;
+			memset (element->set, 0xff, NIH_FILE_GLOB_SET_SIZE);
+			element->set['\0' / 8] &= ~(1 << ('\0' % 8));
+			element->set['/' / 8] &= ~(1 << ('/' % 8));
+		} else if ((*ptr == '[')
+			   && (next = nih_file_glob_parse_class (
+				       ptr, element->set))) {
+			ptr = next;
+
+			element->type = NIH_FILE_GLOB_SET;
+		} else {
+			unsigned char c;
+
+			if ((*ptr == '\\') && ptr[1])
+				ptr++;
+
+			c = *(ptr++);
+
+			element->type = NIH_FILE_GLOB_SET;
+			element->set[c / 8] |= 1 << (c % 8);
+		}
+
+		star = (element->type == NIH_FILE_GLOB_STAR);
+		(*nelements)++;
+	}
+
+	memset (&elements[*nelements], 0, sizeof (NihFileGlobElement));
+	elements[(*nelements)++].type = NIH_FILE_GLOB_END;
+}
+
+/**
+ * nih_file_glob_close:
+ * @elements: elements of all patterns,
+ * @nelements: number of elements,
+ * @state: set of positions.
+ *
+ * Adds to @state the positions following any star in it, since a star
+ * may match no characters at all.
+ **/
+static void
+nih_file_glob_close (const NihFileGlobElement *elements,
+		     size_t                    nelements,
+		     uint64_t                 *state)
+{
+	size_t i;
+
+	nih_assert (elements != NULL);
+	nih_assert (state != NULL);
+
+	/* Stars are never last, so the following position is always
+	 * within the same pattern; and since positions are visited in
+	 * order, one following it is visited in turn.
+	 */
+	for (i = 0; i < nelements; i++)
+		if (NIH_FILE_GLOB_HAS (state, i)
+		    && (elements[i].type == NIH_FILE_GLOB_STAR))
+			NIH_FILE_GLOB_ADD (state, i + 1);
+}
+
+/**
+ * nih_file_glob_step:
+ * @elements: elements of all patterns,
+ * @nelements: number of elements,
+ * @state: set of positions,
+ * @c: next byte of input,
+ * @next: set of positions to fill.
+ *
+ * Computes the set of positions reached from those in @state when the
+ * byte @c is matched, storing it in @next.
+ **/
+static void
+nih_file_glob_step (const NihFileGlobElement *elements,
+		    size_t                    nelements,
+		    const uint64_t           *state,
+		    unsigned char             c,
+		    uint64_t                 *next)
+{
+	size_t i;
+
+	nih_assert (elements != NULL);
+	nih_assert (state != NULL);
+	nih_assert (next != NULL);
+
+	memset (next, 0, sizeof (uint64_t) * ((nelements + 63) / 64 ?: 1));
+
+	for (i = 0; i < nelements; i++) {
+		if (! NIH_FILE_GLOB_HAS (state, i))
+			continue;
+
+		switch (elements[i].type) {
+		case NIH_FILE_GLOB_STAR:
+			NIH_FILE_GLOB_ADD (next, i);
+			break;
+		case NIH_FILE_GLOB_SET:
+			if (elements[i].set[c / 8] & (1 << (c % 8)))
+				NIH_FILE_GLOB_ADD (next, i + 1);
+			break;
+		default:
+			break;
+		}
+	}
+
+	nih_file_glob_close (elements, nelements, next);
+}
+
+/**
+ * nih_file_glob_find:
+ * @states: sets of positions of each state,
+ * @nwords: number of words in each set,
+ * @index: open-addressed index of states,
+ * @indexsize: number of slots in @index, always a power of two,
+ * @state: set of positions to look for.
+ *
+ * Looks up @state in @index, where each slot holds one more than the
+ * number of the state whose set of positions hashes to it, or zero if
+ * it is empty.
+ *
+ * Returns: slot holding @state, or empty slot where it belongs.
+ **/
+static uint32_t *
+nih_file_glob_find (const uint64_t *states,
+		    size_t          nwords,
+		    uint32_t *      index,
+		    size_t          indexsize,
+		    const uint64_t *state)
+{
+	uint32_t hash;
+	size_t   i;
+
+	nih_assert (states != NULL);
+	nih_assert (index != NULL);
+	nih_assert (state != NULL);
+
+	hash = nih_hash_bytes (state, sizeof (uint64_t) * nwords);
+
+	for (i = hash & (indexsize - 1); index[i];
+	     i = (i + 1) & (indexsize - 1))
+		if (! memcmp (&states[nwords * (index[i] - 1)], state,
+			      sizeof (uint64_t) * nwords))
+			break;
+
+	return &index[i];
+}
+
+/**
+ * nih_file_glob_compile:
+ * @glob: glob to compile.
+ *
+ * Compiles the patterns of @glob into a single deterministic automaton,
+ * replacing any previous one.  Each state of the automaton is the set
+ * of positions in the patterns that the input seen so far may have
+ * reached, so the number of states is normally little more than the
+ * number of positions.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_file_glob_compile (NihFileGlob *glob)
+{
+	nih_local NihFileGlobElement *elements = NULL;
+	nih_local uint64_t *          states = NULL;
+	nih_local uint32_t *          index = NULL;
+	nih_local uint16_t *          table = NULL;
+	nih_local char *              accept = NULL;
+	uint8_t                       classes[256];
+	unsigned char                 rep[256];
+	size_t                        nelements, nclasses, nwords;
+	size_t                        nstates, maxstates, slash;
+	size_t                        i, j, k, s;
+	unsigned int                  c;
+
+	nih_assert (glob != NULL);
+
+	/* Parse every pattern into one array of positions, with the start
+	 * state being the set of the first position of each.
+	 */
+	nelements = 0;
+	for (i = 0; i < glob->npatterns; i++)
+		nelements += strlen (glob->patterns[i]) + 1;
+
+	elements = nih_alloc (NULL, sizeof (NihFileGlobElement)
+			      * (nelements ?: 1));
+	if (! elements)
+		nih_return_no_memory_error (-1);
+
+	nwords = (nelements + 63) / 64 ?: 1;
+	maxstates = 16;
+
+	states = nih_alloc (NULL, sizeof (uint64_t) * nwords * maxstates);
+	if (! states)
+		nih_return_no_memory_error (-1);
+
+	memset (states, 0, sizeof (uint64_t) * nwords * 2);
+
+	nelements = 0;
+	for (i = 0; i < glob->npatterns; i++) {
+		size_t start = nelements;
+
+		nih_file_glob_parse (glob->patterns[i], elements, &nelements);
+
+		NIH_FILE_GLOB_ADD (&states[nwords * NIH_FILE_GLOB_START],
+				   start);
+	}
+
+	nih_file_glob_close (elements, nelements,
+			     &states[nwords * NIH_FILE_GLOB_START]);
+	nstates = 2;
+
+	/* Index the states by their set of positions so that the next
+	 * state of each transition can be found without comparing it
+	 * against every state found so far; the index is kept at least
+	 * half empty.  The start state isn't indexed, since it may only
+	 * be reached by a separator.
+	 */
+	index = nih_alloc (NULL, sizeof (uint32_t) * maxstates * 2);
+	if (! index)
+		nih_return_no_memory_error (-1);
+
+	memset (index, 0, sizeof (uint32_t) * maxstates * 2);
+	*nih_file_glob_find (states, nwords, index, maxstates * 2,
+			     &states[nwords * NIH_FILE_GLOB_DEAD])
+		= NIH_FILE_GLOB_DEAD + 1;
+
+	/* Divide the bytes into classes such that no set distinguishes
+	 * between bytes of the same class, with the separator always in
+	 * a class of its own.
+	 */
+	memset (classes, 0, sizeof (classes));
+	classes['/'] = 1;
+	nclasses = 2;
+
+	for (i = 0; i < nelements; i++) {
+		int     split[512];
+		uint8_t nclass = 0;
+
+		if (elements[i].type != NIH_FILE_GLOB_SET)
+			continue;
+
+		memset (split, -1, sizeof (split));
+
+		for (c = 0; c < 256; c++) {
+			int key;
+
+			key = classes[c] * 2
+				+ ((elements[i].set[c / 8] >> (c % 8)) & 1);
+			if (split[key] < 0)
+				split[key] = nclass++;
+
+			classes[c] = split[key];
+		}
+
+		nclasses = nclass ?: 256;
+	}
+
+	for (c = 256; c-- > 0; )
+		rep[classes[c]] = c;
+
+	slash = classes['/'];
+
+	/* Build the transitions of each state in turn, adding new states
+	 * to the end as they are found.
+	 */
+	table = nih_alloc (NULL, sizeof (uint16_t) * nclasses * maxstates);
+	if (! table)
+		nih_return_no_memory_error (-1);
+
+	accept = nih_alloc (NULL, maxstates);
+	if (! accept)
+		nih_return_no_memory_error (-1);
+
+	for (i = 0; i < nstates; i++) {
+		accept[i] = FALSE;
+		for (j = 0; j < nelements; j++)
+			if (NIH_FILE_GLOB_HAS (&states[nwords * i], j)
+			    && (elements[j].type == NIH_FILE_GLOB_END))
+				accept[i] = TRUE;
+
+		for (k = 0; k < nclasses; k++) {
+			uint64_t *next;
+			uint32_t *slot;
+			size_t    size;
+
+			if (k == slash) {
+				table[nclasses * i + k] = NIH_FILE_GLOB_START;
+				continue;
+			}
+
+			if (nstates == maxstates) {
+				uint64_t *new_states;
+				uint32_t *new_index;
+				uint16_t *new_table;
+				char *    new_accept;
+
+				if (maxstates * 2 > UINT16_MAX + 1) {
+					errno = E2BIG;
+					nih_return_system_error (-1);
+				}
+
+				size = sizeof (uint64_t) * nwords * maxstates;
+				new_states = nih_realloc (states, NULL,
+							  size * 2);
+				if (! new_states)
+					nih_return_no_memory_error (-1);
+				states = new_states;
+
+				size = sizeof (uint16_t) * nclasses * maxstates;
+				new_table = nih_realloc (table, NULL, size * 2);
+				if (! new_table)
+					nih_return_no_memory_error (-1);
+				table = new_table;
+
+				new_accept = nih_realloc (accept, NULL,
+							  maxstates * 2);
+				if (! new_accept)
+					nih_return_no_memory_error (-1);
+				accept = new_accept;
+
+				size = sizeof (uint32_t) * maxstates * 4;
+				new_index = nih_realloc (index, NULL, size);
+				if (! new_index)
+					nih_return_no_memory_error (-1);
+				index = new_index;
+
+				maxstates *= 2;
+
+				memset (index, 0, size);
+				for (s = 0; s < nstates; s++) {
+					if (s == NIH_FILE_GLOB_START)
+						continue;
+
+					*nih_file_glob_find (states, nwords,
+							     index,
+							     maxstates * 2,
+							     &states[nwords * s])
+						= s + 1;
+				}
+			}
+
+			/* Compute the next state into the free slot at the
+			 * end, which is kept if it is new.
+			 */
+			next = &states[nwords * nstates];
+			nih_file_glob_step (elements, nelements,
+					    &states[nwords * i], rep[k], next);
+
+			slot = nih_file_glob_find (states, nwords, index,
+						   maxstates * 2, next);
+			if (! *slot)
+				*slot = ++nstates;
+
+			table[nclasses * i + k] = *slot - 1;
+		}
+	}
+
+	/* Replace the previous automaton */
+	nih_unref (glob->table, glob);
+	nih_unref (glob->accept, glob);
+
+	memcpy (glob->classes, classes, sizeof (classes));
+	glob->nclasses = nclasses;
+	glob->nstates = nstates;
+
+	glob->table = table;
+	nih_ref (glob->table, glob);
+
+	glob->accept = accept;
+	nih_ref (glob->accept, glob);
+
+	return 0;
+}
+
+/**
+ * nih_file_glob_match:
+ * @glob: glob to match against,
+ * @path: path to check.
+ *
+ * Determines whether the final component of @path matches any of the
+ * patterns added to @glob, in a single pass over the bytes of @path.
+ *
+ * Returns: TRUE if it matches, FALSE otherwise.
+ **/
+int
+nih_file_glob_match (const NihFileGlob *glob,
+		     const char        *path)
+{
+	const unsigned char *ptr;
+	const uint16_t *     table;
+	const uint8_t *      classes;
+	size_t               nclasses;
+	size_t               state;
+
+	nih_assert (glob != NULL);
+	nih_assert (path != NULL);
+
+	table = glob->table;
+	classes = glob->classes;
+	nclasses = glob->nclasses;
+
+	/* Separators return to the start state, so only the final
+	 * component decides the result.
+	 */
+	state = NIH_FILE_GLOB_START;
+	for (ptr = (const unsigned char *)path; *ptr; ptr++)
+		state = table[nclasses * state + classes[*ptr]];
+
+	return glob->accept[state];
+}
+
+/**
+ * nih_file_glob_filter:
+ * @data: glob to match against,
+ * @path: path to check,
+ * @is_dir: TRUE if @path is a directory.
+ *
+ * File filter for nih_dir_walk() and nih_watch_new() that ignores paths
+ * whose final component matches any of the patterns added to the glob
+ * given as @data.
+ *
+ * Returns: TRUE if it should be ignored, FALSE otherwise.
+ **/
+int
+nih_file_glob_filter (void       *data,
+		      const char *path,
+		      int         is_dir)
+{
+	NihFileGlob *glob = (NihFileGlob *)data;
+
+	nih_assert (glob != NULL);
+	nih_assert (path != NULL);
+
+	return nih_file_glob_match (glob, path);
+}
+
+
 /**
  * nih_dir_walk:
  * @path: path to walk,
@@ -535,8 +1367,7 @@ nih_dir_walk (const char          *path,
 {
 	nih_local NihList  *dirs = NULL;
 	struct stat         statbuf;
-	nih_local char    **paths = NULL;
-	char              **subpath;
+	nih_local NihArray *paths = NULL;
 	int                 ret = 0;
 
 	nih_assert (path != NULL);
@@ -560,7 +1391,7 @@ nih_dir_walk (const char          *path,
 		nih_list_add (dirs, &entry->entry);
 	}
 
-	for (subpath = paths; *subpath; subpath++) {
+	NIH_ARRAY_FOREACH (paths, char *, subpath) {
 		ret = nih_dir_walk_visit (path, dirs, *subpath, filter,
 					  visitor, error, data);
 		if (ret < 0)
@@ -576,7 +1407,7 @@ nih_dir_walk (const char          *path,
  * @b: pointer to second path.
  *
  * This function wraps the strcoll() function allowing it to be called
- * from qsort().
+ * from nih_array_sort().
  *
  * Returns: zero if strings are equal, otherwise integer less than zero
  * if @a is less than @b or integer greater than zero if @a is greater
@@ -607,20 +1438,19 @@ nih_dir_walk_sort (const void *a,
  * Reads the list of files in @path, removing ".", ".." and any for which
  * @filter return TRUE.
  *
- * Returns: NULL-terminated array of full paths to sub-paths or NULL on
- * raised error.
+ * Returns: sorted array of full paths to sub-paths or NULL on raised
+ * error.
  **/
-static char **
+static NihArray *
 nih_dir_walk_scan (const char    *path,
 		   NihFileFilter  filter,
 		   void          *data)
 {
-	DIR            *dir;
-	struct dirent  *ent;
-	char          **paths;
-	size_t          npaths;
-	int             isdir;
-	struct stat     statbuf;
+	DIR           *dir;
+	struct dirent *ent;
+	NihArray      *paths;
+	int            isdir;
+	struct stat    statbuf;
 
 	nih_assert (path != NULL);
 
@@ -628,8 +1458,7 @@ nih_dir_walk_scan (const char    *path,
 	if (! dir)
 		nih_return_system_error (NULL);
 
-	npaths = 0;
-	paths = NIH_MUST (nih_str_array_new (NULL));
+	paths = NIH_MUST (nih_array_new (NULL, sizeof (char *)));
 
 	while ((ent = readdir (dir)) != NULL) {
 		nih_local char *subpath = NULL;
@@ -653,12 +1482,13 @@ nih_dir_walk_scan (const char    *path,
 		if (filter && filter (data, subpath, isdir))
 			continue;
 
-		NIH_MUST (nih_str_array_addp (&paths, NULL, &npaths, subpath));
+		NIH_MUST (nih_array_append (paths, &subpath));
+		nih_ref (subpath, paths);
 	}
 
 	closedir (dir);
 
-	qsort (paths, npaths, sizeof (char *), nih_dir_walk_sort);
+	nih_array_sort (paths, nih_dir_walk_sort);
 
 	return paths;
 }
@@ -721,10 +1551,9 @@ nih_dir_walk_visit (const char          *dirname,
 	/* Iterate into sub-directories; first checking for directory loops.
 	 */
 	if (S_ISDIR (statbuf.st_mode)) {
-		nih_local NihDirEntry  *entry = NULL;
-		nih_local char        **paths = NULL;
-		char                  **subpath;
-		int                     ret = 0;
+		nih_local NihDirEntry *entry = NULL;
+		nih_local NihArray    *paths = NULL;
+		int                    ret = 0;
 
 		NIH_LIST_FOREACH (dirs, iter) {
 			NihDirEntry *entry = (NihDirEntry *)iter;
@@ -756,7 +1585,7 @@ nih_dir_walk_visit (const char          *dirname,
 		 * value, it means that an error handler decided to abort the
 		 * walk; so just abort right now.
 		 */
-		for (subpath = paths; *subpath; subpath++) {
+		NIH_ARRAY_FOREACH (paths, char *, subpath) {
 			ret = nih_dir_walk_visit (dirname, dirs, *subpath,
 						  filter, visitor, error,
 						  data);
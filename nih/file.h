@@ -24,6 +24,7 @@
 #include <sys/stat.h>
 
 #include <fcntl.h>
+#include <stdint.h>
 
 #include <nih/macros.h>
 
@@ -78,6 +79,37 @@ typedef int (*NihFileErrorHandler) (void *data, const char *dirname,
 				    const char *path, struct stat *statbuf);
 
 
+/**
+ * NihFileGlob:
+ * @patterns: NULL-terminated array of patterns,
+ * @npatterns: number of patterns in @patterns,
+ * @classes: byte class of each possible byte,
+ * @nclasses: number of byte classes,
+ * @nstates: number of automaton states,
+ * @table: transition table of @nstates rows of @nclasses entries,
+ * @accept: whether each automaton state matches.
+ *
+ * This structure holds a set of glob patterns compiled into a single
+ * deterministic automaton, so that a path may be matched against all of
+ * them in one pass over its bytes.  Bytes that no pattern distinguishes
+ * between share a class, keeping @table small.
+ *
+ * It should be created with nih_file_glob_new() and patterns added with
+ * nih_file_glob_add(); the members should be treated as read-only.
+ **/
+typedef struct nih_file_glob {
+	char     **patterns;
+	size_t     npatterns;
+
+	uint8_t    classes[256];
+	size_t     nclasses;
+
+	size_t     nstates;
+	uint16_t  *table;
+	char      *accept;
+} NihFileGlob;
+
+
 NIH_BEGIN_EXTERN
 
 char *nih_file_read         (const void *parent, const char *path,
@@ -95,6 +127,17 @@ int   nih_file_is_rcs       (const char *path);
 int   nih_file_is_packaging (const char *path);
 int   nih_file_ignore       (void *data, const char *path);
 
+NihFileGlob *nih_file_glob_new        (const void *parent)
+	__attribute__ ((warn_unused_result, malloc));
+int          nih_file_glob_add        (NihFileGlob *glob, const char *pattern)
+	__attribute__ ((warn_unused_result));
+int          nih_file_glob_add_ignore (NihFileGlob *glob)
+	__attribute__ ((warn_unused_result));
+int          nih_file_glob_match      (const NihFileGlob *glob,
+				       const char *path);
+int          nih_file_glob_filter     (void *data, const char *path,
+				       int is_dir);
+
 int   nih_dir_walk          (const char *path, NihFileFilter filter,
 			     NihFileVisitor visitor, NihFileErrorHandler error,
 			     void *data)
@@ -0,0 +1,1388 @@
+/* libnih
+ *
+ * handover.c - carrying live objects across exec
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/io.h>
+#include <nih/timer.h>
+#include <nih/watch.h>
+#include <nih/snapshot.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+#include <nih/errors.h>
+
+#include "handover.h"
+
+
+/**
+ * NihHandoverMessage:
+ * @entry: list header,
+ * @addr: address received from or to send to,
+ * @addrlen: length of @addr,
+ * @data: message data,
+ * @len: length of @data,
+ * @control: control messages,
+ * @control_len: length of @control,
+ * @cloexec: TRUE for each file descriptor in @control that should be
+ * closed on exec,
+ * @nfds: number of file descriptors in @control,
+ * @int_data: integer data.
+ *
+ * This structure records an NihIoMessage in a snapshot; @control holds
+ * the control messages one after another as they would be found in a
+ * control buffer.
+ **/
+typedef struct nih_handover_message {
+	NihList  entry;
+	char    *addr;
+	size_t   addrlen;
+	char    *data;
+	size_t   len;
+	char    *control;
+	size_t   control_len;
+	char    *cloexec;
+	size_t   nfds;
+	int      int_data;
+} NihHandoverMessage;
+
+/**
+ * NihHandoverIo:
+ * @fd: file descriptor,
+ * @cloexec: TRUE if @fd should be closed on exec,
+ * @type: type of structure,
+ * @shutdown: TRUE if the structure should be closed once empty,
+ * @send_buf: data to be sent,
+ * @send_len: length of @send_buf,
+ * @recv_buf: data received,
+ * @recv_len: length of @recv_buf,
+ * @send_q: messages to be sent,
+ * @recv_q: messages received.
+ *
+ * This structure records an NihIo in a snapshot; @send_buf and @recv_buf
+ * are only used for NIH_IO_STREAM structures, @send_q and @recv_q hold
+ * NihHandoverMessage structures for NIH_IO_MESSAGE structures.
+ **/
+typedef struct nih_handover_io {
+	int        fd;
+	int        cloexec;
+	NihIoType  type;
+	int        shutdown;
+
+	char      *send_buf;
+	size_t     send_len;
+	char      *recv_buf;
+	size_t     recv_len;
+
+	NihList    send_q;
+	NihList    recv_q;
+} NihHandoverIo;
+
+/**
+ * NihHandoverPath:
+ * @entry: list header,
+ * @path: path,
+ * @wd: inotify watch descriptor.
+ *
+ * This structure records a path watched by an NihWatch in a snapshot, or
+ * a file that has been created but not yet closed.
+ **/
+typedef struct nih_handover_path {
+	NihList  entry;
+	char    *path;
+	int      wd;
+} NihHandoverPath;
+
+/**
+ * NihHandoverWatch:
+ * @io: inotify instance,
+ * @path: full path being watched,
+ * @subdirs: include sub-directories of @path,
+ * @create: call create handler for existing files,
+ * @handles: paths being watched,
+ * @created: files created but not yet closed.
+ *
+ * This structure records an NihWatch in a snapshot, @handles and @created
+ * hold NihHandoverPath structures.
+ **/
+typedef struct nih_handover_watch {
+	NihHandoverIo *io;
+	char          *path;
+	int            subdirs;
+	int            create;
+
+	NihList        handles;
+	NihList        created;
+} NihHandoverWatch;
+
+/**
+ * NihHandoverTimer:
+ * @type: type of timer,
+ * @due: time due,
+ * @period: timeout or period of timer,
+ * @schedule: schedule of timer.
+ *
+ * This structure records an NihTimer in a snapshot.
+ **/
+typedef struct nih_handover_timer {
+	NihTimerType     type;
+	time_t           due;
+	time_t           period;
+	NihTimerSchedule schedule;
+} NihHandoverTimer;
+
+
+/* Prototypes for static functions */
+static int                 nih_handover_init        (void)
+	__attribute__ ((warn_unused_result));
+static NihHandoverIo *     nih_handover_io_new      (const void *parent,
+						     NihIo *io)
+	__attribute__ ((warn_unused_result, malloc));
+static NihHandoverMessage *nih_handover_message_new (const void *parent,
+						     NihIoMessage *message)
+	__attribute__ ((warn_unused_result, malloc));
+static NihHandoverPath *   nih_handover_path_new    (const void *parent,
+						     const char *path, int wd)
+	__attribute__ ((warn_unused_result, malloc));
+static int *               nih_handover_message_fds (NihHandoverMessage *record,
+						     size_t *offset,
+						     size_t *nfds);
+static int                 nih_handover_inherit     (int fd)
+	__attribute__ ((warn_unused_result));
+static void                nih_handover_cloexec     (NihSnapshot *snapshot);
+static NihIo *             nih_handover_io_reopen   (const void *parent,
+						     NihHandoverIo *record,
+						     NihIoReader reader,
+						     NihIoCloseHandler close_handler,
+						     NihIoErrorHandler error_handler,
+						     void *data)
+	__attribute__ ((warn_unused_result));
+static int                 nih_handover_io_restore  (NihIo *io,
+						     NihHandoverIo *record)
+	__attribute__ ((warn_unused_result));
+static NihIoMessage *      nih_handover_message_restore (const void *parent,
+							 NihHandoverMessage *record)
+	__attribute__ ((warn_unused_result, malloc));
+static void *              nih_handover_lookup      (NihSnapshot *snapshot,
+						     const char *name,
+						     const NihSnapshotType *type)
+	__attribute__ ((warn_unused_result));
+
+
+/* Snapshot types of the structures above; names include a version number
+ * that should be increased whenever a structure changes.
+ */
+static const NihSnapshotType nih_handover_message_type;
+static const NihSnapshotType nih_handover_io_type;
+static const NihSnapshotType nih_handover_path_type;
+static const NihSnapshotType nih_handover_watch_type;
+static const NihSnapshotType nih_handover_timer_type;
+
+static const NihSnapshotField nih_handover_message_fields[] = {
+	{ NIH_SNAPSHOT_LINK, offsetof (NihHandoverMessage, entry) },
+	{ NIH_SNAPSHOT_DATA, offsetof (NihHandoverMessage, addr), NULL,
+	  offsetof (NihHandoverMessage, addrlen) },
+	{ NIH_SNAPSHOT_DATA, offsetof (NihHandoverMessage, data), NULL,
+	  offsetof (NihHandoverMessage, len) },
+	{ NIH_SNAPSHOT_DATA, offsetof (NihHandoverMessage, control), NULL,
+	  offsetof (NihHandoverMessage, control_len) },
+	{ NIH_SNAPSHOT_DATA, offsetof (NihHandoverMessage, cloexec), NULL,
+	  offsetof (NihHandoverMessage, nfds) },
+};
+
+static const NihSnapshotType nih_handover_message_type = {
+	"nih-handover-message-2", sizeof (NihHandoverMessage),
+	nih_handover_message_fields,
+	sizeof (nih_handover_message_fields) / sizeof (NihSnapshotField),
+	NULL
+};
+
+static const NihSnapshotField nih_handover_io_fields[] = {
+	{ NIH_SNAPSHOT_DATA, offsetof (NihHandoverIo, send_buf), NULL,
+	  offsetof (NihHandoverIo, send_len) },
+	{ NIH_SNAPSHOT_DATA, offsetof (NihHandoverIo, recv_buf), NULL,
+	  offsetof (NihHandoverIo, recv_len) },
+	{ NIH_SNAPSHOT_LIST, offsetof (NihHandoverIo, send_q),
+	  &nih_handover_message_type, offsetof (NihHandoverMessage, entry) },
+	{ NIH_SNAPSHOT_LIST, offsetof (NihHandoverIo, recv_q),
+	  &nih_handover_message_type, offsetof (NihHandoverMessage, entry) },
+};
+
+static const NihSnapshotType nih_handover_io_type = {
+	"nih-handover-io-1", sizeof (NihHandoverIo),
+	nih_handover_io_fields,
+	sizeof (nih_handover_io_fields) / sizeof (NihSnapshotField),
+	NULL
+};
+
+static const NihSnapshotField nih_handover_path_fields[] = {
+	{ NIH_SNAPSHOT_LINK, offsetof (NihHandoverPath, entry) },
+	{ NIH_SNAPSHOT_STRING, offsetof (NihHandoverPath, path) },
+};
+
+static const NihSnapshotType nih_handover_path_type = {
+	"nih-handover-path-1", sizeof (NihHandoverPath),
+	nih_handover_path_fields,
+	sizeof (nih_handover_path_fields) / sizeof (NihSnapshotField),
+	NULL
+};
+
+static const NihSnapshotField nih_handover_watch_fields[] = {
+	{ NIH_SNAPSHOT_POINTER, offsetof (NihHandoverWatch, io),
+	  &nih_handover_io_type },
+	{ NIH_SNAPSHOT_STRING, offsetof (NihHandoverWatch, path) },
+	{ NIH_SNAPSHOT_LIST, offsetof (NihHandoverWatch, handles),
+	  &nih_handover_path_type, offsetof (NihHandoverPath, entry) },
+	{ NIH_SNAPSHOT_LIST, offsetof (NihHandoverWatch, created),
+	  &nih_handover_path_type, offsetof (NihHandoverPath, entry) },
+};
+
+static const NihSnapshotType nih_handover_watch_type = {
+	"nih-handover-watch-1", sizeof (NihHandoverWatch),
+	nih_handover_watch_fields,
+	sizeof (nih_handover_watch_fields) / sizeof (NihSnapshotField),
+	NULL
+};
+
+static const NihSnapshotType nih_handover_timer_type = {
+	"nih-handover-timer-1", sizeof (NihHandoverTimer), NULL, 0, NULL
+};
+
+
+/**
+ * nih_handover_init:
+ *
+ * Registers the snapshot types used to carry objects across exec.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_handover_init (void)
+{
+	static int initialised = FALSE;
+
+	if (initialised)
+		return 0;
+
+	if ((nih_snapshot_register (&nih_handover_message_type) < 0)
+	    || (nih_snapshot_register (&nih_handover_io_type) < 0)
+	    || (nih_snapshot_register (&nih_handover_path_type) < 0)
+	    || (nih_snapshot_register (&nih_handover_watch_type) < 0)
+	    || (nih_snapshot_register (&nih_handover_timer_type) < 0))
+		return -1;
+
+	initialised = TRUE;
+
+	return 0;
+}
+
+
+/**
+ * nih_handover_add_io:
+ * @snapshot: snapshot to add to,
+ * @name: name of object,
+ * @io: structure to add.
+ *
+ * Adds @io to @snapshot as a top-level object named @name, along with the
+ * data in its send and receive buffers or the messages in its send and
+ * receive queues.  The data is not copied until the image is written, so
+ * @io should not be used in the meantime.
+ *
+ * The structure may be reconstructed in a new process image with
+ * nih_handover_get_io().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_handover_add_io (NihSnapshot *snapshot,
+		     const char * name,
+		     NihIo *      io)
+{
+	NihHandoverIo *record;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+	nih_assert (io != NULL);
+
+	record = nih_handover_io_new (snapshot, io);
+	if (! record)
+		return -1;
+
+	return nih_snapshot_add (snapshot, name, &nih_handover_io_type, record);
+}
+
+/**
+ * nih_handover_add_watch:
+ * @snapshot: snapshot to add to,
+ * @name: name of object,
+ * @watch: watch to add.
+ *
+ * Adds @watch to @snapshot as a top-level object named @name, along with
+ * the watch descriptors of the paths being watched, the files created
+ * but not yet closed, and any partial inotify events that have been
+ * read.
+ *
+ * The watch may be reconstructed in a new process image with
+ * nih_handover_get_watch() without walking the directory tree again.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_handover_add_watch (NihSnapshot *snapshot,
+			const char * name,
+			NihWatch *   watch)
+{
+	NihHandoverWatch *record;
+	NihHandoverPath * path;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+	nih_assert (watch != NULL);
+
+	record = nih_new (snapshot, NihHandoverWatch);
+	if (! record)
+		nih_return_no_memory_error (-1);
+
+	record->path = (char *)watch->path;
+	record->subdirs = watch->subdirs;
+	record->create = watch->create;
+
+	nih_list_init (&record->handles);
+	nih_list_init (&record->created);
+
+	record->io = nih_handover_io_new (record, watch->io);
+	if (! record->io)
+		goto error;
+
+	NIH_LIST_FOREACH (&watch->watches, iter) {
+		NihWatchHandle *handle = (NihWatchHandle *)iter;
+
+		path = nih_handover_path_new (record, handle->path, handle->wd);
+		if (! path)
+			goto error;
+
+		nih_list_add (&record->handles, &path->entry);
+	}
+
+	NIH_HASH_FOREACH (watch->created, iter) {
+		NihListEntry *entry = (NihListEntry *)iter;
+
+		path = nih_handover_path_new (record, entry->str, -1);
+		if (! path)
+			goto error;
+
+		nih_list_add (&record->created, &path->entry);
+	}
+
+	return nih_snapshot_add (snapshot, name, &nih_handover_watch_type,
+				 record);
+
+error:
+	nih_free (record);
+	return -1;
+}
+
+/**
+ * nih_handover_add_timer:
+ * @snapshot: snapshot to add to,
+ * @name: name of object,
+ * @timer: timer to add.
+ *
+ * Adds @timer to @snapshot as a top-level object named @name.  The time
+ * it is due is measured by the monotonic clock, which is not reset by
+ * exec, so the timer may be reconstructed in a new process image with
+ * nih_handover_get_timer() and will be due at the same time.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_handover_add_timer (NihSnapshot *snapshot,
+			const char * name,
+			NihTimer *   timer)
+{
+	NihHandoverTimer *record;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+	nih_assert (timer != NULL);
+
+	record = nih_new (snapshot, NihHandoverTimer);
+	if (! record)
+		nih_return_no_memory_error (-1);
+
+	memset (record, 0, sizeof (NihHandoverTimer));
+
+	record->type = timer->type;
+	record->due = timer->due;
+
+	switch (timer->type) {
+	case NIH_TIMER_TIMEOUT:
+		record->period = timer->timeout;
+		break;
+	case NIH_TIMER_PERIODIC:
+		record->period = timer->period;
+		break;
+	case NIH_TIMER_SCHEDULED:
+		record->schedule = timer->schedule;
+		break;
+	default:
+		nih_assert_not_reached ();
+	}
+
+	return nih_snapshot_add (snapshot, name, &nih_handover_timer_type,
+				 record);
+}
+
+
+/**
+ * nih_handover_io_new:
+ * @parent: parent object for new record,
+ * @io: structure to record.
+ *
+ * Allocates a record of @io, which refers to the buffers of @io rather
+ * than copying them.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned record.  When all parents
+ * of the returned record are freed, the returned record will also be
+ * freed.
+ *
+ * Returns: new record or NULL on raised error.
+ **/
+static NihHandoverIo *
+nih_handover_io_new (const void *parent,
+		     NihIo *     io)
+{
+	NihHandoverIo *record;
+	int            flags;
+
+	nih_assert (io != NULL);
+
+	flags = fcntl (io->watch->fd, F_GETFD);
+	if (flags < 0)
+		nih_return_system_error (NULL);
+
+	record = nih_new (parent, NihHandoverIo);
+	if (! record)
+		nih_return_no_memory_error (NULL);
+
+	record->fd = io->watch->fd;
+	record->cloexec = (flags & FD_CLOEXEC) ? TRUE : FALSE;
+	record->type = io->type;
+	record->shutdown = io->shutdown;
+
+	record->send_buf = NULL;
+	record->send_len = 0;
+	record->recv_buf = NULL;
+	record->recv_len = 0;
+
+	nih_list_init (&record->send_q);
+	nih_list_init (&record->recv_q);
+
+	switch (io->type) {
+	case NIH_IO_STREAM:
+		if (io->send_buf->len) {
+			record->send_buf = io->send_buf->buf;
+			record->send_len = io->send_buf->len;
+		}
+
+		if (io->recv_buf->len) {
+			record->recv_buf = io->recv_buf->buf;
+			record->recv_len = io->recv_buf->len;
+		}
+
+		break;
+	case NIH_IO_MESSAGE:
+		NIH_LIST_FOREACH (io->send_q, iter) {
+			NihHandoverMessage *message;
+
+			message = nih_handover_message_new (
+				record, (NihIoMessage *)iter);
+			if (! message)
+				goto error;
+
+			nih_list_add (&record->send_q, &message->entry);
+		}
+
+		NIH_LIST_FOREACH (io->recv_q, iter) {
+			NihHandoverMessage *message;
+
+			message = nih_handover_message_new (
+				record, (NihIoMessage *)iter);
+			if (! message)
+				goto error;
+
+			nih_list_add (&record->recv_q, &message->entry);
+		}
+
+		break;
+	default:
+		nih_assert_not_reached ();
+	}
+
+	return record;
+
+error:
+	nih_free (record);
+	return NULL;
+}
+
+/**
+ * nih_handover_message_new:
+ * @parent: parent object for new record,
+ * @message: message to record.
+ *
+ * Allocates a record of @message, which refers to the address and data
+ * of @message rather than copying them; the control messages are copied
+ * into a single buffer, and the flags of any file descriptors passed in
+ * them are recorded.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned record.  When all parents
+ * of the returned record are freed, the returned record will also be
+ * freed.
+ *
+ * Returns: new record or NULL on raised error.
+ **/
+static NihHandoverMessage *
+nih_handover_message_new (const void *  parent,
+			  NihIoMessage *message)
+{
+	NihHandoverMessage *record;
+	struct cmsghdr **   cmsg;
+	size_t              offset, nfds, j;
+	int *               fds;
+
+	nih_assert (message != NULL);
+
+	record = nih_new (parent, NihHandoverMessage);
+	if (! record)
+		nih_return_no_memory_error (NULL);
+
+	nih_list_init (&record->entry);
+
+	record->addr = (char *)message->addr;
+	record->addrlen = message->addr ? message->addrlen : 0;
+
+	record->data = message->data->len ? message->data->buf : NULL;
+	record->len = message->data->len;
+
+	record->control = NULL;
+	record->control_len = 0;
+	record->cloexec = NULL;
+	record->nfds = 0;
+
+	for (cmsg = message->control; *cmsg; cmsg++)
+		record->control_len += CMSG_ALIGN ((*cmsg)->cmsg_len);
+
+	if (record->control_len) {
+		offset = 0;
+
+		record->control = nih_alloc (record, record->control_len);
+		if (! record->control) {
+			nih_free (record);
+			nih_return_no_memory_error (NULL);
+		}
+
+		memset (record->control, 0, record->control_len);
+
+		for (cmsg = message->control; *cmsg; cmsg++) {
+			memcpy (record->control + offset, *cmsg,
+				(*cmsg)->cmsg_len);
+			offset += CMSG_ALIGN ((*cmsg)->cmsg_len);
+		}
+	}
+
+	offset = 0;
+	while ((fds = nih_handover_message_fds (record, &offset, &nfds)))
+		record->nfds += nfds;
+
+	if (record->nfds) {
+		size_t i = 0;
+
+		record->cloexec = nih_alloc (record, record->nfds);
+		if (! record->cloexec) {
+			nih_free (record);
+			nih_return_no_memory_error (NULL);
+		}
+
+		offset = 0;
+		while ((fds = nih_handover_message_fds (record, &offset,
+							&nfds))) {
+			for (j = 0; j < nfds; j++) {
+				int flags;
+
+				flags = fcntl (fds[j], F_GETFD);
+				if (flags < 0) {
+					nih_error_raise_system ();
+					nih_free (record);
+					return NULL;
+				}
+
+				record->cloexec[i++] = ((flags & FD_CLOEXEC)
+							? TRUE : FALSE);
+			}
+		}
+	}
+
+	record->int_data = message->int_data;
+
+	return record;
+}
+
+/**
+ * nih_handover_message_fds:
+ * @record: record of message,
+ * @offset: offset of next control message in @record,
+ * @nfds: pointer to store number of file descriptors in.
+ *
+ * Finds the next control message of @record at or after @offset that
+ * passes file descriptors, and advances @offset past it.
+ *
+ * Returns: array of @nfds file descriptors, or NULL if there are no more.
+ **/
+static int *
+nih_handover_message_fds (NihHandoverMessage *record,
+			  size_t *            offset,
+			  size_t *            nfds)
+{
+	nih_assert (record != NULL);
+	nih_assert (offset != NULL);
+	nih_assert (nfds != NULL);
+
+	while (*offset < record->control_len) {
+		struct cmsghdr *cmsg;
+
+		cmsg = (struct cmsghdr *)(record->control + *offset);
+		*offset += CMSG_ALIGN (cmsg->cmsg_len);
+
+		if ((cmsg->cmsg_level != SOL_SOCKET)
+		    || (cmsg->cmsg_type != SCM_RIGHTS))
+			continue;
+
+		*nfds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+		return (int *)CMSG_DATA (cmsg);
+	}
+
+	return NULL;
+}
+
+/**
+ * nih_handover_path_new:
+ * @parent: parent object for new record,
+ * @path: path,
+ * @wd: inotify watch descriptor.
+ *
+ * Allocates a record of @path, which refers to @path rather than copying
+ * it.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned record.  When all parents
+ * of the returned record are freed, the returned record will also be
+ * freed.
+ *
+ * Returns: new record or NULL on raised error.
+ **/
+static NihHandoverPath *
+nih_handover_path_new (const void *parent,
+		       const char *path,
+		       int         wd)
+{
+	NihHandoverPath *record;
+
+	nih_assert (path != NULL);
+
+	record = nih_new (parent, NihHandoverPath);
+	if (! record)
+		nih_return_no_memory_error (NULL);
+
+	nih_list_init (&record->entry);
+
+	record->path = (char *)path;
+	record->wd = wd;
+
+	return record;
+}
+
+
+/**
+ * nih_handover_write:
+ * @snapshot: snapshot to write.
+ *
+ * Writes the image of @snapshot as nih_snapshot_write() does, and then
+ * ensures that the file descriptors of the structures added with
+ * nih_handover_add_io() and nih_handover_add_watch(), and any passed in
+ * the control messages of their queued messages, will not be closed on
+ * exec.  The new process image sets the flag again on those that had it
+ * as the objects are reconstructed; should exec fail, the caller should
+ * instead call nih_handover_abort().
+ *
+ * Returns: file descriptor of image, or negative value on raised error.
+ **/
+int
+nih_handover_write (NihSnapshot *snapshot)
+{
+	int fd;
+
+	nih_assert (snapshot != NULL);
+
+	fd = nih_snapshot_write (snapshot);
+	if (fd < 0)
+		return -1;
+
+	NIH_ARRAY_FOREACH (snapshot->objects, NihSnapshotObject, object) {
+		if (object->type == &nih_handover_io_type) {
+			NihHandoverIo *record = object->ptr;
+
+			if (nih_handover_inherit (record->fd) < 0)
+				goto error;
+
+		} else if (object->type == &nih_handover_message_type) {
+			NihHandoverMessage *record = object->ptr;
+			size_t              offset = 0, nfds, i;
+			int *               fds;
+
+			while ((fds = nih_handover_message_fds (record, &offset,
+								&nfds)))
+				for (i = 0; i < nfds; i++)
+					if (nih_handover_inherit (fds[i]) < 0)
+						goto error;
+		}
+	}
+
+	return fd;
+
+error:
+	nih_handover_cloexec (snapshot);
+	close (fd);
+	return -1;
+}
+
+/**
+ * nih_handover_abort:
+ * @snapshot: snapshot written,
+ * @fd: file descriptor of image.
+ *
+ * Undoes nih_handover_write() when the new process image could not be
+ * executed, closing @fd and setting the close-on-exec flag again on the
+ * file descriptors that had it.
+ **/
+void
+nih_handover_abort (NihSnapshot *snapshot,
+		    int          fd)
+{
+	nih_assert (snapshot != NULL);
+	nih_assert (fd >= 0);
+
+	nih_handover_cloexec (snapshot);
+	close (fd);
+}
+
+/**
+ * nih_handover_inherit:
+ * @fd: file descriptor to change.
+ *
+ * Change the flags of @fd so that the file descriptor is not closed on
+ * exec().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_handover_inherit (int fd)
+{
+	int flags;
+
+	nih_assert (fd >= 0);
+
+	flags = fcntl (fd, F_GETFD);
+	if (flags < 0)
+		nih_return_system_error (-1);
+
+	if (! (flags & FD_CLOEXEC))
+		return 0;
+
+	if (fcntl (fd, F_SETFD, flags & ~FD_CLOEXEC) < 0)
+		nih_return_system_error (-1);
+
+	return 0;
+}
+
+/**
+ * nih_handover_cloexec:
+ * @snapshot: snapshot written.
+ *
+ * Sets the close-on-exec flag again on the file descriptors of the
+ * records in @snapshot that had it before nih_handover_write() cleared
+ * it.  Errors are ignored since the flag is only being put back.
+ **/
+static void
+nih_handover_cloexec (NihSnapshot *snapshot)
+{
+	nih_assert (snapshot != NULL);
+
+	NIH_ARRAY_FOREACH (snapshot->objects, NihSnapshotObject, object) {
+		if (object->type == &nih_handover_io_type) {
+			NihHandoverIo *record = object->ptr;
+
+			if (record->cloexec)
+				fcntl (record->fd, F_SETFD, FD_CLOEXEC);
+
+		} else if (object->type == &nih_handover_message_type) {
+			NihHandoverMessage *record = object->ptr;
+			size_t              offset = 0, nfds, n = 0, i;
+			int *               fds;
+
+			while ((fds = nih_handover_message_fds (record, &offset,
+								&nfds)))
+				for (i = 0; i < nfds; i++, n++)
+					if (record->cloexec[n])
+						fcntl (fds[i], F_SETFD,
+						       FD_CLOEXEC);
+		}
+	}
+}
+
+
+/**
+ * nih_handover_read:
+ * @parent: parent object for new snapshot,
+ * @fd: file descriptor of image.
+ *
+ * Reads the image from @fd, as written by nih_handover_write(), in the
+ * same manner as nih_snapshot_read(); objects added with the handover
+ * functions may then be reconstructed with nih_handover_get_io(),
+ * nih_handover_get_watch() and nih_handover_get_timer().
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned snapshot.  When all parents
+ * of the returned snapshot are freed, the returned snapshot will also be
+ * freed.
+ *
+ * Returns: new NihSnapshot structure or NULL on raised error.
+ **/
+NihSnapshot *
+nih_handover_read (const void *parent,
+		   int         fd)
+{
+	nih_assert (fd >= 0);
+
+	if (nih_handover_init () < 0)
+		return NULL;
+
+	return nih_snapshot_read (parent, fd);
+}
+
+
+/**
+ * nih_handover_get_io:
+ * @parent: parent object for new structure,
+ * @snapshot: snapshot to obtain from,
+ * @name: name of object,
+ * @reader: function to call when new data available,
+ * @close_handler: function to call on close,
+ * @error_handler: function to call on error,
+ * @data: data to pass to functions.
+ *
+ * Reconstructs the NihIo structure added to @snapshot as @name with
+ * nih_handover_add_io(), with the functions given, which have the same
+ * meaning as they do for nih_io_reopen().  Data and messages that had
+ * not been sent are sent when possible; data and messages that had been
+ * received but not yet used remain in the receive buffer or queue, the
+ * reader is not called again until more are received.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned structure.  When all parents
+ * of the returned structure are freed, the returned structure will also be
+ * freed.
+ *
+ * Returns: newly allocated structure, or NULL on raised error.
+ **/
+NihIo *
+nih_handover_get_io (const void *      parent,
+		     NihSnapshot *     snapshot,
+		     const char *      name,
+		     NihIoReader       reader,
+		     NihIoCloseHandler close_handler,
+		     NihIoErrorHandler error_handler,
+		     void *            data)
+{
+	NihHandoverIo *record;
+	NihIo *        io;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+
+	record = nih_handover_lookup (snapshot, name, &nih_handover_io_type);
+	if (! record)
+		return NULL;
+
+	io = nih_handover_io_reopen (parent, record, reader, close_handler,
+				     error_handler, data);
+	if (! io)
+		return NULL;
+
+	io->watch->caller = __builtin_return_address (0);
+
+	return io;
+}
+
+/**
+ * nih_handover_get_watch:
+ * @parent: parent object for new watch,
+ * @snapshot: snapshot to obtain from,
+ * @name: name of object,
+ * @filter: function to filter paths watched,
+ * @create_handler: function called when a path is created,
+ * @modify_handler: function called when a path is modified,
+ * @delete_handler: function called when a path is deleted,
+ * @data: pointer to pass to functions.
+ *
+ * Reconstructs the NihWatch added to @snapshot as @name with
+ * nih_handover_add_watch(), with the functions given, which have the
+ * same meaning as they do for nih_watch_new().  The inotify instance
+ * and its watch descriptors are re-used, so the directory tree is not
+ * walked again and the create handler is not called for existing files;
+ * events that occurred during the exec are handled as normal.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned watch.  When all parents
+ * of the returned watch are freed, the returned watch will also be
+ * freed.
+ *
+ * Returns: new NihWatch structure, or NULL on raised error.
+ **/
+NihWatch *
+nih_handover_get_watch (const void *     parent,
+			NihSnapshot *    snapshot,
+			const char *     name,
+			NihFileFilter    filter,
+			NihCreateHandler create_handler,
+			NihModifyHandler modify_handler,
+			NihDeleteHandler delete_handler,
+			void *           data)
+{
+	NihHandoverWatch *record;
+	NihWatch *        watch;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+
+	record = nih_handover_lookup (snapshot, name, &nih_handover_watch_type);
+	if (! record)
+		return NULL;
+
+	if ((! record->io) || (! record->path))
+		nih_return_error (NULL, NIH_SNAPSHOT_INVALID,
+				  _(NIH_SNAPSHOT_INVALID_STR));
+
+	watch = nih_watch_reopen (parent, record->io->fd, record->path,
+				  record->subdirs, record->create, filter,
+				  create_handler, modify_handler,
+				  delete_handler, data);
+	if (! watch)
+		return NULL;
+
+	watch->io->watch->caller = __builtin_return_address (0);
+
+	if (nih_handover_io_restore (watch->io, record->io) < 0)
+		goto error;
+
+	NIH_LIST_FOREACH (&record->handles, iter) {
+		NihHandoverPath *path = (NihHandoverPath *)iter;
+		NihWatchHandle * handle;
+
+		if (! path->path) {
+			nih_error_raise (NIH_SNAPSHOT_INVALID,
+					 _(NIH_SNAPSHOT_INVALID_STR));
+			goto error;
+		}
+
+		handle = nih_new (watch, NihWatchHandle);
+		if (! handle) {
+			nih_error_raise_no_memory ();
+			goto error;
+		}
+
+		nih_list_init (&handle->entry);
+		nih_alloc_set_destructor (handle, nih_list_destroy);
+
+		handle->wd = path->wd;
+		handle->path = nih_strdup (handle, path->path);
+		if (! handle->path) {
+			nih_free (handle);
+			nih_error_raise_no_memory ();
+			goto error;
+		}
+
+		nih_list_add (&watch->watches, &handle->entry);
+	}
+
+	NIH_LIST_FOREACH (&record->created, iter) {
+		NihHandoverPath *path = (NihHandoverPath *)iter;
+		NihListEntry *   entry;
+
+		if (! path->path) {
+			nih_error_raise (NIH_SNAPSHOT_INVALID,
+					 _(NIH_SNAPSHOT_INVALID_STR));
+			goto error;
+		}
+
+		entry = nih_list_entry_new (watch);
+		if (! entry) {
+			nih_error_raise_no_memory ();
+			goto error;
+		}
+
+		entry->str = nih_strdup (entry, path->path);
+		if (! entry->str) {
+			nih_free (entry);
+			nih_error_raise_no_memory ();
+			goto error;
+		}
+
+		nih_hash_add (watch->created, &entry->entry);
+	}
+
+	return watch;
+
+error:
+	/* Leave the inotify instance open */
+	nih_alloc_set_destructor (watch->io, NULL);
+	nih_free (watch);
+	return NULL;
+}
+
+/**
+ * nih_handover_get_timer:
+ * @parent: parent object for new timer,
+ * @snapshot: snapshot to obtain from,
+ * @name: name of object,
+ * @callback: function to be called,
+ * @data: pointer to pass to function as first argument.
+ *
+ * Reconstructs the NihTimer added to @snapshot as @name with
+ * nih_handover_add_timer(), calling @callback with @data when it is due,
+ * which is the time it was originally due.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned timer.  When all parents
+ * of the returned timer are freed, the returned timer will also be
+ * freed.
+ *
+ * Returns: the new timer information, or NULL on raised error.
+ **/
+NihTimer *
+nih_handover_get_timer (const void * parent,
+			NihSnapshot *snapshot,
+			const char * name,
+			NihTimerCb   callback,
+			void *       data)
+{
+	NihHandoverTimer *record;
+	NihTimer *        timer;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+	nih_assert (callback != NULL);
+
+	record = nih_handover_lookup (snapshot, name, &nih_handover_timer_type);
+	if (! record)
+		return NULL;
+
+	switch (record->type) {
+	case NIH_TIMER_TIMEOUT:
+		timer = nih_timer_add_timeout (parent, record->period,
+					       callback, data);
+		break;
+	case NIH_TIMER_PERIODIC:
+		timer = nih_timer_add_periodic (parent, record->period,
+						callback, data);
+		break;
+	case NIH_TIMER_SCHEDULED:
+		timer = nih_timer_add_scheduled (parent, &record->schedule,
+						 callback, data);
+		break;
+	default:
+		nih_return_error (NULL, NIH_SNAPSHOT_INVALID,
+				  _(NIH_SNAPSHOT_INVALID_STR));
+	}
+
+	if (! timer)
+		nih_return_no_memory_error (NULL);
+
+	timer->caller = __builtin_return_address (0);
+	timer->due = record->due;
+
+	return timer;
+}
+
+
+/**
+ * nih_handover_io_reopen:
+ * @parent: parent object for new structure,
+ * @record: record of structure,
+ * @reader: function to call when new data available,
+ * @close_handler: function to call on close,
+ * @error_handler: function to call on error,
+ * @data: data to pass to functions.
+ *
+ * Reconstructs the NihIo structure recorded in @record.
+ *
+ * Returns: newly allocated structure, or NULL on raised error.
+ **/
+static NihIo *
+nih_handover_io_reopen (const void *      parent,
+			NihHandoverIo *   record,
+			NihIoReader       reader,
+			NihIoCloseHandler close_handler,
+			NihIoErrorHandler error_handler,
+			void *            data)
+{
+	NihIo *io;
+
+	nih_assert (record != NULL);
+
+	if ((record->fd < 0)
+	    || ((record->type != NIH_IO_STREAM)
+		&& (record->type != NIH_IO_MESSAGE)))
+		nih_return_error (NULL, NIH_SNAPSHOT_INVALID,
+				  _(NIH_SNAPSHOT_INVALID_STR));
+
+	io = nih_io_reopen (parent, record->fd, record->type, reader,
+			    close_handler, error_handler, data);
+	if (! io)
+		return NULL;
+
+	if (nih_handover_io_restore (io, record) < 0) {
+		nih_alloc_set_destructor (io, NULL);
+		nih_free (io);
+		return NULL;
+	}
+
+	return io;
+}
+
+/**
+ * nih_handover_io_restore:
+ * @io: structure to restore,
+ * @record: record of structure.
+ *
+ * Restores the buffers or queues of @io, and the flags of its file
+ * descriptor, from @record.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_handover_io_restore (NihIo *        io,
+			 NihHandoverIo *record)
+{
+	nih_assert (io != NULL);
+	nih_assert (record != NULL);
+
+	if (record->type != io->type)
+		nih_return_error (-1, NIH_SNAPSHOT_INVALID,
+				  _(NIH_SNAPSHOT_INVALID_STR));
+
+	if (record->cloexec && (nih_io_set_cloexec (record->fd) < 0))
+		nih_return_system_error (-1);
+
+	switch (io->type) {
+	case NIH_IO_STREAM:
+		if (record->send_buf
+		    && (nih_io_write (io, record->send_buf,
+				      record->send_len) < 0))
+			nih_return_no_memory_error (-1);
+
+		if (record->recv_buf
+		    && (nih_io_buffer_push (io->recv_buf, record->recv_buf,
+					    record->recv_len) < 0))
+			nih_return_no_memory_error (-1);
+
+		break;
+	case NIH_IO_MESSAGE:
+		NIH_LIST_FOREACH (&record->send_q, iter) {
+			NihIoMessage *message;
+
+			message = nih_handover_message_restore (
+				NULL, (NihHandoverMessage *)iter);
+			if (! message)
+				return -1;
+
+			nih_io_send_message (io, message);
+			nih_discard (message);
+		}
+
+		NIH_LIST_FOREACH (&record->recv_q, iter) {
+			NihIoMessage *message;
+
+			message = nih_handover_message_restore (
+				io, (NihHandoverMessage *)iter);
+			if (! message)
+				return -1;
+
+			nih_list_add (io->recv_q, &message->entry);
+		}
+
+		break;
+	default:
+		nih_assert_not_reached ();
+	}
+
+	io->shutdown = record->shutdown;
+
+	return 0;
+}
+
+/**
+ * nih_handover_message_restore:
+ * @parent: parent object for new message,
+ * @record: record of message.
+ *
+ * Reconstructs the message recorded in @record, and sets the
+ * close-on-exec flag again on any file descriptors passed in it that
+ * had it.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned message.  When all parents
+ * of the returned message are freed, the returned message will also be
+ * freed.
+ *
+ * Returns: new message, or NULL on raised error.
+ **/
+static NihIoMessage *
+nih_handover_message_restore (const void *        parent,
+			      NihHandoverMessage *record)
+{
+	NihIoMessage *message;
+	size_t        offset = 0, nfds = 0, i;
+
+	nih_assert (record != NULL);
+
+	message = nih_io_message_new (parent);
+	if (! message)
+		nih_return_no_memory_error (NULL);
+
+	if (record->addr) {
+		message->addr = nih_alloc (message, record->addrlen);
+		if (! message->addr)
+			goto error;
+
+		memcpy (message->addr, record->addr, record->addrlen);
+		message->addrlen = record->addrlen;
+	}
+
+	if (record->data
+	    && (nih_io_buffer_push (message->data, record->data,
+				    record->len) < 0))
+		goto error;
+
+	while (offset < record->control_len) {
+		struct cmsghdr *cmsg;
+
+		cmsg = (struct cmsghdr *)(record->control + offset);
+		if ((record->control_len - offset < sizeof (struct cmsghdr))
+		    || (cmsg->cmsg_len < CMSG_LEN (0))
+		    || (cmsg->cmsg_len > record->control_len - offset)) {
+			nih_free (message);
+			nih_return_error (NULL, NIH_SNAPSHOT_INVALID,
+					  _(NIH_SNAPSHOT_INVALID_STR));
+		}
+
+		if ((cmsg->cmsg_level == SOL_SOCKET)
+		    && (cmsg->cmsg_type == SCM_RIGHTS)) {
+			int *fds = (int *)CMSG_DATA (cmsg);
+
+			for (i = 0;
+			     i < (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+			     i++, nfds++) {
+				if (nfds >= record->nfds) {
+					nih_free (message);
+					nih_return_error (NULL, NIH_SNAPSHOT_INVALID,
+							  _(NIH_SNAPSHOT_INVALID_STR));
+				}
+
+				if (record->cloexec[nfds]
+				    && (nih_io_set_cloexec (fds[i]) < 0)) {
+					nih_error_raise_system ();
+					nih_free (message);
+					return NULL;
+				}
+			}
+		}
+
+		if (nih_io_message_add_control (message, cmsg->cmsg_level,
+						cmsg->cmsg_type,
+						cmsg->cmsg_len - CMSG_LEN (0),
+						CMSG_DATA (cmsg)) < 0)
+			goto error;
+
+		offset += CMSG_ALIGN (cmsg->cmsg_len);
+	}
+
+	message->int_data = record->int_data;
+
+	return message;
+
+error:
+	nih_free (message);
+	nih_return_no_memory_error (NULL);
+}
+
+/**
+ * nih_handover_lookup:
+ * @snapshot: snapshot to search,
+ * @name: name of object,
+ * @type: expected type of object.
+ *
+ * Finds the top-level object named @name in @snapshot, which must be of
+ * @type.
+ *
+ * Returns: object found, or NULL on raised error.
+ **/
+static void *
+nih_handover_lookup (NihSnapshot *          snapshot,
+		     const char *           name,
+		     const NihSnapshotType *type)
+{
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+	nih_assert (type != NULL);
+
+	if (nih_snapshot_get_type (snapshot, name) != type)
+		nih_return_error (NULL, NIH_SNAPSHOT_NOT_FOUND,
+				  _(NIH_SNAPSHOT_NOT_FOUND_STR));
+
+	return nih_snapshot_get (snapshot, name);
+}
@@ -0,0 +1,104 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_HANDOVER_H
+#define NIH_HANDOVER_H
+
+/**
+ * Handover carries live NihIo, NihWatch and NihTimer objects across a
+ * re-exec, so that connected clients keep their connections along with
+ * any data buffered for them, inotify instances keep their watches
+ * without the directory tree being walked again, and timers keep their
+ * due times.
+ *
+ * Objects are added by name to a snapshot, see nih/snapshot.h, alongside
+ * any other state, and the image is written with nih_handover_write()
+ * which ensures that their file descriptors are inherited:
+ *
+ *	snapshot = nih_snapshot_new (NULL);
+ *	nih_handover_add_io (snapshot, "control", control_io);
+ *	nih_handover_add_watch (snapshot, "conf", conf_watch);
+ *	nih_handover_add_timer (snapshot, "reload", reload_timer);
+ *	fd = nih_handover_write (snapshot);
+ *
+ * If exec then fails, nih_handover_abort() closes the image and makes
+ * the file descriptors close-on-exec again where they were before.
+ *
+ * The new process image reads the image with nih_handover_read(), and
+ * reconstructs each object with the functions and data pointers it
+ * should use, since those cannot be carried across exec:
+ *
+ *	snapshot = nih_handover_read (NULL, fd);
+ *	control_io = nih_handover_get_io (NULL, snapshot, "control",
+ *					  control_reader, control_close,
+ *					  NULL, NULL);
+ *	nih_free (snapshot);
+ *
+ * Only the int_data member of messages in NihIo queues is carried, and
+ * any file descriptors they contain are inherited.
+ **/
+
+#include <nih/macros.h>
+#include <nih/io.h>
+#include <nih/timer.h>
+#include <nih/watch.h>
+#include <nih/snapshot.h>
+
+
+NIH_BEGIN_EXTERN
+
+int          nih_handover_add_io    (NihSnapshot *snapshot, const char *name,
+				     NihIo *io)
+	__attribute__ ((warn_unused_result));
+int          nih_handover_add_watch (NihSnapshot *snapshot, const char *name,
+				     NihWatch *watch)
+	__attribute__ ((warn_unused_result));
+int          nih_handover_add_timer (NihSnapshot *snapshot, const char *name,
+				     NihTimer *timer)
+	__attribute__ ((warn_unused_result));
+
+int          nih_handover_write     (NihSnapshot *snapshot)
+	__attribute__ ((warn_unused_result));
+void         nih_handover_abort     (NihSnapshot *snapshot, int fd);
+
+NihSnapshot *nih_handover_read      (const void *parent, int fd)
+	__attribute__ ((warn_unused_result, malloc));
+
+NihIo *      nih_handover_get_io    (const void *parent,
+				     NihSnapshot *snapshot, const char *name,
+				     NihIoReader reader,
+				     NihIoCloseHandler close_handler,
+				     NihIoErrorHandler error_handler,
+				     void *data)
+	__attribute__ ((warn_unused_result));
+NihWatch *   nih_handover_get_watch (const void *parent,
+				     NihSnapshot *snapshot, const char *name,
+				     NihFileFilter filter,
+				     NihCreateHandler create_handler,
+				     NihModifyHandler modify_handler,
+				     NihDeleteHandler delete_handler,
+				     void *data)
+	__attribute__ ((warn_unused_result));
+NihTimer *   nih_handover_get_timer (const void *parent,
+				     NihSnapshot *snapshot, const char *name,
+				     NihTimerCb callback, void *data)
+	__attribute__ ((warn_unused_result));
+
+NIH_END_EXTERN
+
+#endif /* NIH_HANDOVER_H */
@@ -31,6 +31,7 @@
 #include <nih/alloc.h>
 
 #include "hash.h"
+#include "hash_private.h"
 
 
 /**
@@ -378,6 +379,35 @@ nih_hash_string_hash (const char *key)
 	return hash;
 }
 
+/**
+ * nih_hash_bytes:
+ * @data: data to hash,
+ * @len: length of @data.
+ *
+ * Generates and returns a 32-bit hash of the first @len bytes of @data
+ * using the same algorithm as nih_hash_string_hash(), for keys that are
+ * not NULL-terminated strings; for the characters of a string it gives
+ * the same result.
+ *
+ * Returns: 32-bit hash.
+ **/
+uint32_t
+nih_hash_bytes (const void *data,
+		size_t      len)
+{
+	register uint32_t hash = FNV_OFFSET_BASIS;
+	const char *      ptr = data;
+
+	nih_assert ((data != NULL) || (len == 0));
+
+	while (len--) {
+		hash *= FNV_PRIME;
+		hash ^= *(ptr++);
+	}
+
+	return hash;
+}
+
 /**
  * nih_hash_string_cmp:
  * @key1: key to compare,
@@ -0,0 +1,42 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_HASH_PRIVATE_H
+#define NIH_HASH_PRIVATE_H
+
+/**
+ * Functions used by the parts of libnih that keep their own tables and
+ * need to hash keys that are not NULL-terminated strings.  This header
+ * is not installed, and the functions are hidden from the shared
+ * library.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <nih/macros.h>
+
+
+NIH_BEGIN_EXTERN
+
+uint32_t nih_hash_bytes (const void *data, size_t len)
+	__attribute__ ((warn_unused_result, visibility ("hidden")));
+
+NIH_END_EXTERN
+
+#endif /* NIH_HASH_PRIVATE_H */
@@ -47,8 +47,10 @@
 #include <nih/logging.h>
 #include <nih/error.h>
 #include <nih/errors.h>
+#include <nih/metrics.h>
 
 #include "io.h"
+#include "main_private.h"
 
 
 /* Prototypes for static functions */
@@ -140,6 +142,8 @@ nih_io_add_watch (const void   *parent,
 	watch->watcher = watcher;
 	watch->data = data;
 
+	watch->caller = __builtin_return_address (0);
+
 	nih_list_add (nih_io_watches, &watch->entry);
 
 	return watch;
@@ -233,8 +237,16 @@ nih_io_handle_fds (fd_set *readfds,
 		    && FD_ISSET (watch->fd, exceptfds))
 			events |= NIH_IO_EXCEPT;
 
-		if (events)
+		if (events) {
+			NihIoWatcher     watcher = watch->watcher;
+			void            *caller = watch->caller;
+			struct timespec  start;
+
+			nih_main_watchdog_begin (&start);
 			watch->watcher (watch->data, watch, events);
+			nih_main_watchdog_end (&start, "I/O watch",
+					       watcher, caller);
+		}
 	}
 }
 
@@ -430,6 +442,8 @@ nih_io_buffer_push (NihIoBuffer *buffer,
 	memcpy (buffer->buf + buffer->len, str, len);
 	buffer->len += len;
 
+	NIH_METRIC_SET_MAX ("io_buffer_high_water", buffer->len);
+
 	return 0;
 }
 
@@ -667,6 +681,9 @@ nih_io_message_recv  (const void *parent,
 	if (recv_len < 0)
 		goto error;
 
+	NIH_METRIC_ADD ("io_messages_read", 1);
+	NIH_METRIC_ADD ("io_read_bytes", recv_len);
+
 	/* Update the lengths, both to the caller and of the message structure
 	 * buffers based on what was actually received.
 	 */
@@ -762,6 +779,9 @@ nih_io_message_send (NihIoMessage *message,
 	if (len < 0)
 		nih_return_system_error (-1);
 
+	NIH_METRIC_ADD ("io_messages_written", 1);
+	NIH_METRIC_ADD ("io_write_bytes", len);
+
 	return len;
 }
 
@@ -870,6 +890,8 @@ nih_io_reopen (const void        *parent,
 	if (! io->watch)
 		goto error;
 
+	io->watch->caller = __builtin_return_address (0);
+
 	/* Irritating signal, means we terminate if the remote end
 	 * disconnects between a read() and a write() ... far better to
 	 * just get an errno!
@@ -1086,6 +1108,9 @@ nih_io_watcher_read (NihIo      *io,
 				nih_return_system_error (-1);
 			} else if (len > 0) {
 				io->recv_buf->len += len;
+				NIH_METRIC_ADD ("io_read_bytes", len);
+				NIH_METRIC_SET_MAX ("io_buffer_high_water",
+						    io->recv_buf->len);
 			} else {
 				return 0;
 			}
@@ -1145,6 +1170,7 @@ nih_io_watcher_write (NihIo      *io,
 			if (len < 0)
 				nih_return_system_error (-1);
 
+			NIH_METRIC_ADD ("io_write_bytes", len);
 			nih_io_buffer_shrink (io->send_buf, len);
 		}
 
@@ -135,12 +135,18 @@ typedef void (*NihIoErrorHandler) (void *data, NihIo *io);
  * @fd: file descriptor,
  * @events: events to watch for,
  * @watcher: function called when @events occur on @fd,
- * @data: pointer passed to @watcher.
+ * @data: pointer passed to @watcher,
+ * @caller: address of the code that added the watch.
  *
  * This structure represents the most basic kind of I/O handling, a watch
  * on a file descriptor or socket that causes a function to be called
  * when listed events occur.
  *
+ * @caller is only used to identify the watch when reporting slow
+ * callbacks, see nih_main_watchdog_enable().  Functions in libnih that
+ * add a watch on behalf of their own caller, such as nih_io_reopen(),
+ * record the address of that caller instead.
+ *
  * The watch can be cancelled by calling nih_list_remove() on the structure
  * as they are held in a list internally.
  **/
@@ -151,6 +157,8 @@ struct nih_io_watch {
 
 	NihIoWatcher  watcher;
 	void         *data;
+
+	void         *caller;
 };
 
 /**
@@ -30,6 +30,7 @@
 #include <nih/signal.h>
 #include <nih/child.h>
 #include <nih/io.h>
+#include <nih/event.h>
 #include <nih/file.h>
 #include <nih/watch.h>
 #include <nih/main.h>
@@ -39,5 +40,12 @@
 #include <nih/logging.h>
 #include <nih/error.h>
 #include <nih/errors.h>
+#include <nih/metrics.h>
+#include <nih/atom.h>
+#include <nih/array.h>
+#include <nih/chash.h>
+#include <nih/str.h>
+#include <nih/snapshot.h>
+#include <nih/handover.h>
 
 #endif /* NIH_LIBNIH_H */
@@ -27,13 +27,24 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <time.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <limits.h>
 #include <signal.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <execinfo.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
 
 #include <nih/macros.h>
 #include <nih/alloc.h>
@@ -45,8 +56,10 @@
 #include <nih/io.h>
 #include <nih/error.h>
 #include <nih/logging.h>
+#include <nih/metrics.h>
 
 #include "main.h"
+#include "main_private.h"
 
 
 /**
@@ -63,6 +76,20 @@
  **/
 #define DEV_NULL "/dev/null"
 
+/**
+ * NIH_MAIN_WATCHDOG_FRAMES:
+ *
+ * Maximum number of stack frames written in a watchdog backtrace.
+ **/
+#define NIH_MAIN_WATCHDOG_FRAMES 64
+
+
+/* Prototypes for static functions */
+#if ENABLE_THREADING
+static void *nih_main_watchdog_thread  (void *arg);
+static void  nih_main_watchdog_handler (int signum);
+#endif /* ENABLE_THREADING */
+
 
 /**
  * program_name:
@@ -160,6 +187,55 @@ static __thread int exit_status = 0;
 NihList *nih_main_loop_functions = NULL;
 
 
+/**
+ * watchdog_threshold:
+ *
+ * Time in milliseconds after which callbacks are reported by the main
+ * loop watchdog, or zero if the watchdog is disabled.
+ **/
+static unsigned long watchdog_threshold = 0;
+
+/**
+ * watchdog_dispatch:
+ *
+ * Counter incremented before and after each callback timed by the
+ * watchdog, so it is odd while a callback is running and changes each
+ * time a new one is called.
+ **/
+static unsigned long watchdog_dispatch = 0;
+
+#if ENABLE_THREADING
+/**
+ * watchdog_running:
+ *
+ * TRUE while the watchdog backtrace thread should keep running.
+ **/
+static int watchdog_running = FALSE;
+
+/**
+ * watchdog_thread:
+ *
+ * Watchdog backtrace thread.
+ **/
+static pthread_t watchdog_thread;
+
+/**
+ * watchdog_loop_thread:
+ *
+ * Thread running the main loop, which is signalled by @watchdog_thread.
+ **/
+static pthread_t watchdog_loop_thread;
+
+/**
+ * watchdog_oldact:
+ *
+ * Action for NIH_MAIN_WATCHDOG_SIGNAL before the watchdog replaced it,
+ * restored by nih_main_watchdog_disable().
+ **/
+static struct sigaction watchdog_oldact;
+#endif /* ENABLE_THREADING */
+
+
 /**
  * nih_main_init_full:
  * @argv0: program name from arguments,
@@ -500,6 +576,200 @@ nih_main_unlink_pidfile (void)
 }
 
 
+/**
+ * nih_main_listen_fds:
+ * @unset_environment: TRUE to remove the variables from the environment.
+ *
+ * Checks whether the service manager that started the process passed it
+ * file descriptors to use in place of sockets it would otherwise create
+ * and bind itself, which allows clients to connect before the process
+ * is ready to accept them and keeps sockets open across restarts.
+ *
+ * Passed descriptors are numbered consecutively from
+ * NIH_MAIN_LISTEN_FDS_START, the number of them is given in the
+ * LISTEN_FDS environment variable and LISTEN_PID holds the pid of the
+ * process they are intended for; descriptors intended for another
+ * process, such as a parent that did not consume them, are ignored.
+ *
+ * Passed descriptors are marked close-on-exec; listening sockets among
+ * them may be watched with nih_main_listen_watch(), while datagram
+ * sockets and FIFOs may be given to nih_io_reopen().
+ *
+ * If @unset_environment is TRUE, the variables are removed so that they
+ * are not inherited by child processes, even if an error is raised.
+ *
+ * Returns: number of passed file descriptors, zero if none were passed
+ * or negative value on raised error.
+ **/
+int
+nih_main_listen_fds (int unset_environment)
+{
+	const char *value;
+	char *      end;
+	long        pid, nfds;
+	int         fd, ret = 0;
+
+	value = getenv ("LISTEN_PID");
+	if (! value)
+		goto finish;
+
+	errno = 0;
+	pid = strtol (value, &end, 10);
+	if (errno || (end == value) || *end || (pid <= 0)) {
+		errno = EINVAL;
+		nih_error_raise_system ();
+		ret = -1;
+		goto finish;
+	}
+
+	if (pid != getpid ())
+		goto finish;
+
+	value = getenv ("LISTEN_FDS");
+	if (! value)
+		goto finish;
+
+	errno = 0;
+	nfds = strtol (value, &end, 10);
+	if (errno || (end == value) || *end || (nfds < 0)
+	    || (nfds > INT_MAX - NIH_MAIN_LISTEN_FDS_START)) {
+		errno = EINVAL;
+		nih_error_raise_system ();
+		ret = -1;
+		goto finish;
+	}
+
+	for (fd = NIH_MAIN_LISTEN_FDS_START;
+	     fd < NIH_MAIN_LISTEN_FDS_START + nfds; fd++) {
+		if (nih_io_set_cloexec (fd) < 0) {
+			nih_error_raise_system ();
+			ret = -1;
+			goto finish;
+		}
+	}
+
+	ret = nfds;
+finish:
+	if (unset_environment) {
+		unsetenv ("LISTEN_PID");
+		unsetenv ("LISTEN_FDS");
+		unsetenv ("LISTEN_FDNAMES");
+	}
+
+	return ret;
+}
+
+/**
+ * nih_main_listen_watch:
+ * @parent: parent object for new watch,
+ * @fd: passed file descriptor,
+ * @watcher: function called when a connection is pending,
+ * @data: pointer to pass to @watcher.
+ *
+ * Adds a watch for connections on the listening socket @fd, which was
+ * passed to the process and counted by nih_main_listen_fds().  @watcher
+ * is called from the main loop whenever a connection is pending, and
+ * should accept() it; the socket is made non-blocking first, since
+ * another process sharing it may accept the connection first.
+ *
+ * The watch is allocated using nih_alloc() and stored in a linked list;
+ * it can be removed by using nih_free() without closing @fd.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned watch.  When all parents
+ * of the returned watch are freed, the returned watch will also be
+ * freed.
+ *
+ * Returns: new watch or NULL on raised error.
+ **/
+NihIoWatch *
+nih_main_listen_watch (const void   *parent,
+		       int           fd,
+		       NihIoWatcher  watcher,
+		       void         *data)
+{
+	NihIoWatch *watch;
+
+	nih_assert (fd >= NIH_MAIN_LISTEN_FDS_START);
+	nih_assert (watcher != NULL);
+
+	if (nih_io_set_nonblock (fd) < 0)
+		nih_return_system_error (NULL);
+
+	watch = nih_io_add_watch (parent, fd, NIH_IO_READ, watcher, data);
+	if (! watch)
+		nih_return_no_memory_error (NULL);
+
+	watch->caller = __builtin_return_address (0);
+
+	return watch;
+}
+
+/**
+ * nih_main_notify:
+ * @state: newline-separated assignments to send.
+ *
+ * Notifies the service manager that started the process of a change in
+ * its state, most commonly "READY=1" once it has finished starting up
+ * and is accepting connections, which replaces daemonising with
+ * nih_main_daemonise() for services started this way.
+ *
+ * The assignments are sent as a single datagram to the socket named in
+ * the NOTIFY_SOCKET environment variable, which may be either an
+ * absolute path or a name in the abstract namespace prefixed by "@".
+ *
+ * Returns: TRUE if the state was sent, FALSE if the process was not
+ * started by a service manager, or negative value on raised error.
+ **/
+int
+nih_main_notify (const char *state)
+{
+	const char *       value;
+	struct sockaddr_un addr;
+	socklen_t          addrlen;
+	size_t             len;
+	int                sock;
+
+	nih_assert (state != NULL);
+
+	value = getenv ("NOTIFY_SOCKET");
+	if (! value)
+		return FALSE;
+
+	len = strlen (value);
+	if (((value[0] != '/') && (value[0] != '@'))
+	    || (len < 2) || (len > sizeof (addr.sun_path))) {
+		errno = EINVAL;
+		nih_return_system_error (-1);
+	}
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	memcpy (addr.sun_path, value, len);
+	if (addr.sun_path[0] == '@')
+		addr.sun_path[0] = '\0';
+
+	addrlen = offsetof (struct sockaddr_un, sun_path) + len;
+
+	sock = socket (PF_UNIX, SOCK_DGRAM, 0);
+	if (sock < 0)
+		nih_return_system_error (-1);
+
+	nih_io_set_cloexec (sock);
+
+	if (sendto (sock, state, strlen (state), MSG_NOSIGNAL,
+		    (struct sockaddr *)&addr, addrlen) < 0) {
+		nih_error_raise_system ();
+		close (sock);
+		return -1;
+	}
+
+	close (sock);
+
+	return TRUE;
+}
+
+
 /**
  * nih_main_loop_init:
  *
@@ -546,9 +816,19 @@ nih_main_loop (void)
 		NihTimer       *next_timer;
 		struct timespec now;
 		struct timeval  timeout;
+		struct timespec wait_start;
 		fd_set          readfds, writefds, exceptfds;
 		char            buf[1];
 		int             nfds, ret;
+		int             reclaim;
+
+		/* Return a slice of the memory of objects freed with
+		 * nih_free_deferred(), if there's more left we mustn't
+		 * sleep in select().
+		 */
+		reclaim = nih_alloc_reclaim (NIH_ALLOC_RECLAIM_SLICE);
+
+		NIH_METRIC_ADD ("main_loop_iterations", 1);
 
 		/* Use the due time of the next timer to calculate how long
 		 * to spend in select().  That way we don't sleep for any
@@ -562,6 +842,11 @@ nih_main_loop (void)
 			timeout.tv_usec = 0;
 		}
 
+		if (reclaim) {
+			timeout.tv_sec = 0;
+			timeout.tv_usec = 0;
+		}
+
 		/* Start off with empty watch lists */
 		FD_ZERO (&readfds);
 		FD_ZERO (&writefds);
@@ -578,8 +863,19 @@ nih_main_loop (void)
 		 * calls nih_main_loop_interrupt), a file descriptor we're
 		 * watching changes in some way or it's time to run a timer.
 		 */
+		if (nih_metrics_enabled)
+			clock_gettime (CLOCK_MONOTONIC, &wait_start);
+
 		ret = select (nfds, &readfds, &writefds, &exceptfds,
-			      (next_timer ? &timeout : NULL));
+			      ((next_timer || reclaim) ? &timeout : NULL));
+
+		if (nih_metrics_enabled) {
+			nih_assert (clock_gettime (CLOCK_MONOTONIC, &now) == 0);
+			NIH_METRIC_RECORD ("main_loop_wait_ns",
+					   ((now.tv_sec - wait_start.tv_sec)
+					    * 1000000000ULL
+					    + now.tv_nsec - wait_start.tv_nsec));
+		}
 
 		/* Deal with events */
 		if (ret > 0)
@@ -605,8 +901,14 @@ nih_main_loop (void)
 		/* Run the loop functions */
 		NIH_LIST_FOREACH_SAFE (nih_main_loop_functions, iter) {
 			NihMainLoopFunc *func = (NihMainLoopFunc *)iter;
+			NihMainLoopCb    callback = func->callback;
+			void            *caller = func->caller;
+			struct timespec  start;
 
+			nih_main_watchdog_begin (&start);
 			func->callback (func->data, func);
+			nih_main_watchdog_end (&start, "main loop",
+					       callback, caller);
 		}
 	}
 
@@ -692,6 +994,8 @@ nih_main_loop_add_func (const void    *parent,
 	func->callback = callback;
 	func->data = data;
 
+	func->caller = __builtin_return_address (0);
+
 	nih_list_add (nih_main_loop_functions, &func->entry);
 
 	return func;
@@ -712,3 +1016,244 @@ nih_main_term_signal (void      *data,
 {
 	nih_main_loop_exit (0);
 }
+
+
+/**
+ * nih_main_watchdog_enable:
+ * @threshold: time in milliseconds,
+ * @flags: watchdog flags.
+ *
+ * Enables a watchdog that times each call to an I/O watch, timer or main
+ * loop function callback from the main loop, and logs a warning naming
+ * any callback that takes longer than @threshold milliseconds along with
+ * the code that registered it.
+ *
+ * The function addresses are translated to symbols where possible, this
+ * requires the program to be linked with -rdynamic.
+ *
+ * If @flags includes NIH_MAIN_WATCHDOG_BACKTRACE, a separate thread is
+ * started that checks whether the main loop has been in the same
+ * callback for longer than @threshold, in which case it sends
+ * NIH_MAIN_WATCHDOG_SIGNAL to the main loop thread which writes a
+ * backtrace of itself to standard error.  This requires libnih to be
+ * built with threading support, and must be called from the thread that
+ * runs the main loop.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_main_watchdog_enable (unsigned long        threshold,
+			  NihMainWatchdogFlags flags)
+{
+	nih_assert (threshold > 0);
+
+	nih_main_watchdog_disable ();
+
+	if (flags & NIH_MAIN_WATCHDOG_BACKTRACE) {
+#if ENABLE_THREADING
+		struct sigaction act;
+		void *           frames[1];
+		int              ret;
+
+		/* backtrace() loads libgcc on first use, which allocates;
+		 * do that now rather than in the signal handler.
+		 */
+		backtrace (frames, 1);
+
+		act.sa_handler = nih_main_watchdog_handler;
+		act.sa_flags = SA_RESTART;
+		sigemptyset (&act.sa_mask);
+
+		if (sigaction (NIH_MAIN_WATCHDOG_SIGNAL, &act,
+			       &watchdog_oldact) < 0)
+			nih_return_system_error (-1);
+
+		watchdog_loop_thread = pthread_self ();
+		watchdog_running = TRUE;
+
+		ret = pthread_create (&watchdog_thread, NULL,
+				      nih_main_watchdog_thread,
+				      (void *)threshold);
+		if (ret) {
+			watchdog_running = FALSE;
+			sigaction (NIH_MAIN_WATCHDOG_SIGNAL, &watchdog_oldact,
+				   NULL);
+
+			errno = ret;
+			nih_return_system_error (-1);
+		}
+#else /* ENABLE_THREADING */
+		errno = ENOSYS;
+		nih_return_system_error (-1);
+#endif /* ENABLE_THREADING */
+	}
+
+	watchdog_threshold = threshold;
+
+	return 0;
+}
+
+/**
+ * nih_main_watchdog_disable:
+ *
+ * Disables the main loop watchdog enabled by nih_main_watchdog_enable(),
+ * stopping the backtrace thread if one was started and restoring the
+ * previous action for NIH_MAIN_WATCHDOG_SIGNAL.
+ **/
+void
+nih_main_watchdog_disable (void)
+{
+	watchdog_threshold = 0;
+
+#if ENABLE_THREADING
+	if (watchdog_running) {
+		__atomic_store_n (&watchdog_running, FALSE, __ATOMIC_RELEASE);
+		pthread_join (watchdog_thread, NULL);
+
+		sigaction (NIH_MAIN_WATCHDOG_SIGNAL, &watchdog_oldact, NULL);
+	}
+#endif /* ENABLE_THREADING */
+}
+
+/**
+ * nih_main_watchdog_begin:
+ * @start: time to fill in.
+ *
+ * Called by the main loop before dispatching a callback, if the watchdog
+ * is enabled the current time is stored in @start; otherwise this has
+ * no effect.
+ **/
+void
+nih_main_watchdog_begin (struct timespec *start)
+{
+	nih_assert (start != NULL);
+
+	if (! watchdog_threshold) {
+		start->tv_sec = start->tv_nsec = 0;
+		return;
+	}
+
+	nih_assert (clock_gettime (CLOCK_MONOTONIC, start) == 0);
+
+	__atomic_add_fetch (&watchdog_dispatch, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * nih_main_watchdog_end:
+ * @start: time from nih_main_watchdog_begin(),
+ * @type: type of callback,
+ * @callback: callback function,
+ * @caller: address of code that registered @callback.
+ *
+ * Called by the main loop after dispatching a callback, if the watchdog
+ * is enabled and the callback took longer than the threshold a warning
+ * is logged naming @callback and @caller.
+ **/
+void
+nih_main_watchdog_end (const struct timespec *start,
+		       const char *           type,
+		       void *                 callback,
+		       void *                 caller)
+{
+	struct timespec now;
+	unsigned long   elapsed;
+	char **         symbols;
+
+	nih_assert (start != NULL);
+	nih_assert (type != NULL);
+
+	/* The watchdog may have been enabled or disabled by the callback
+	 * itself, so it's whether we timed the callback that matters.
+	 */
+	if ((! start->tv_sec) && (! start->tv_nsec))
+		return;
+
+	__atomic_add_fetch (&watchdog_dispatch, 1, __ATOMIC_RELEASE);
+
+	if (! watchdog_threshold)
+		return;
+
+	nih_assert (clock_gettime (CLOCK_MONOTONIC, &now) == 0);
+
+	elapsed = ((now.tv_sec - start->tv_sec) * 1000
+		   + (now.tv_nsec - start->tv_nsec) / 1000000);
+	if (elapsed < watchdog_threshold)
+		return;
+
+	symbols = backtrace_symbols ((void *[]){ callback, caller }, 2);
+
+	nih_warn (_("Slow %s callback %s took %lums, registered at %s"),
+		  type, symbols ? symbols[0] : "?", elapsed,
+		  symbols ? symbols[1] : "?");
+
+	free (symbols);
+}
+
+#if ENABLE_THREADING
+/**
+ * nih_main_watchdog_thread:
+ * @arg: threshold in milliseconds.
+ *
+ * Thread started by nih_main_watchdog_enable() which wakes up every
+ * threshold milliseconds and, if the main loop has been in the same
+ * callback since it last woke, signals the main loop thread to write
+ * a backtrace; only one backtrace is written for each callback.
+ *
+ * Returns: NULL.
+ **/
+static void *
+nih_main_watchdog_thread (void *arg)
+{
+	unsigned long   threshold = (unsigned long)arg;
+	struct timespec interval;
+	unsigned long   last = 0;
+	unsigned long   reported = 0;
+
+	interval.tv_sec = threshold / 1000;
+	interval.tv_nsec = (threshold % 1000) * 1000000;
+
+	while (__atomic_load_n (&watchdog_running, __ATOMIC_ACQUIRE)) {
+		unsigned long dispatch;
+
+		nanosleep (&interval, NULL);
+
+		/* The counter is odd while a callback is running */
+		dispatch = __atomic_load_n (&watchdog_dispatch,
+					    __ATOMIC_ACQUIRE);
+		if ((dispatch & 1) && (dispatch == last)
+		    && (dispatch != reported)) {
+			pthread_kill (watchdog_loop_thread,
+				      NIH_MAIN_WATCHDOG_SIGNAL);
+			reported = dispatch;
+		}
+
+		last = dispatch;
+	}
+
+	return NULL;
+}
+
+/**
+ * nih_main_watchdog_handler:
+ * @signum: signal number.
+ *
+ * Signal handler called in the main loop thread when the watchdog thread
+ * finds it stuck in a callback, writes a backtrace to standard error.
+ **/
+static void
+nih_main_watchdog_handler (int signum)
+{
+	static const char msg[] = "Main loop stuck in callback:\n";
+	void *            frames[NIH_MAIN_WATCHDOG_FRAMES];
+	int               saved_errno = errno;
+	int               nframes;
+
+	if (write (STDERR_FILENO, msg, sizeof (msg) - 1) < 0)
+		;
+
+	nframes = backtrace (frames, NIH_MAIN_WATCHDOG_FRAMES);
+	backtrace_symbols_fd (frames, nframes, STDERR_FILENO);
+
+	errno = saved_errno;
+}
+#endif /* ENABLE_THREADING */
@@ -20,9 +20,12 @@
 #ifndef NIH_MAIN_H
 #define NIH_MAIN_H
 
+#include <time.h>
+
 #include <nih/macros.h>
 #include <nih/list.h>
 #include <nih/signal.h>
+#include <nih/io.h>
 
 
 /**
@@ -43,7 +46,8 @@ typedef void (*NihMainLoopCb) (void *data, NihMainLoopFunc *loop);
  * NihMainLoopFunc:
  * @entry: list header,
  * @callback: function called,
- * @data: pointer passed to @callback.
+ * @data: pointer passed to @callback,
+ * @caller: address of the code that added the function.
  *
  * This structure contains information about a function that should be
  * called once in each main loop iteration.
@@ -56,9 +60,39 @@ struct nih_main_loop_func {
 
 	NihMainLoopCb  callback;
 	void          *data;
+
+	void          *caller;
 };
 
 
+/**
+ * NIH_MAIN_LISTEN_FDS_START:
+ *
+ * First file descriptor passed by a service manager, see
+ * nih_main_listen_fds().
+ **/
+#define NIH_MAIN_LISTEN_FDS_START 3
+
+/**
+ * NIH_MAIN_WATCHDOG_SIGNAL:
+ *
+ * Signal sent to the main loop thread by the watchdog to obtain a
+ * backtrace when it is stuck in a callback.
+ **/
+#define NIH_MAIN_WATCHDOG_SIGNAL SIGPROF
+
+/**
+ * NihMainWatchdogFlags:
+ *
+ * Flags that modify the behaviour of the main loop watchdog enabled with
+ * nih_main_watchdog_enable().
+ **/
+typedef enum {
+	NIH_MAIN_WATCHDOG_NONE      = 00,
+	NIH_MAIN_WATCHDOG_BACKTRACE = 01,
+} NihMainWatchdogFlags;
+
+
 /**
  * nih_main_init_gettext:
  *
@@ -131,6 +165,14 @@ int              nih_main_write_pidfile  (pid_t pid)
 	__attribute__ ((warn_unused_result));
 void             nih_main_unlink_pidfile (void);
 
+int              nih_main_listen_fds     (int unset_environment)
+	__attribute__ ((warn_unused_result));
+NihIoWatch *     nih_main_listen_watch   (const void *parent, int fd,
+					  NihIoWatcher watcher, void *data)
+	__attribute__ ((warn_unused_result));
+int              nih_main_notify         (const char *state)
+	__attribute__ ((warn_unused_result));
+
 void             nih_main_loop_init      (void);
 int              nih_main_loop           (void);
 void             nih_main_loop_interrupt (void);
@@ -142,6 +184,11 @@ NihMainLoopFunc *nih_main_loop_add_func  (const void *parent,
 
 void             nih_main_term_signal    (void *data, NihSignal *signal);
 
+int              nih_main_watchdog_enable  (unsigned long threshold,
+					    NihMainWatchdogFlags flags)
+	__attribute__ ((warn_unused_result));
+void             nih_main_watchdog_disable (void);
+
 NIH_END_EXTERN
 
 #endif /* NIH_MAIN_H */
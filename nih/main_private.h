@@ -0,0 +1,45 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_MAIN_PRIVATE_H
+#define NIH_MAIN_PRIVATE_H
+
+/**
+ * Functions used by the parts of libnih that dispatch callbacks from the
+ * main loop to report them to the watchdog enabled with
+ * nih_main_watchdog_enable().  This header is not installed, and the
+ * functions are hidden from the shared library.
+ **/
+
+#include <time.h>
+
+#include <nih/macros.h>
+
+
+NIH_BEGIN_EXTERN
+
+void nih_main_watchdog_begin (struct timespec *start)
+	__attribute__ ((visibility ("hidden")));
+void nih_main_watchdog_end   (const struct timespec *start,
+			      const char *type,
+			      void *callback, void *caller)
+	__attribute__ ((visibility ("hidden")));
+
+NIH_END_EXTERN
+
+#endif /* NIH_MAIN_PRIVATE_H */
@@ -0,0 +1,724 @@
+/* libnih
+ *
+ * metrics.c - counters, gauges and histograms
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/logging.h>
+
+#include "metrics.h"
+
+
+/**
+ * NIH_METRICS_LOCK:
+ *
+ * Locks the table of metrics when built with threading support.
+ **/
+#if ENABLE_THREADING
+# define NIH_METRICS_LOCK() pthread_mutex_lock (&metrics_lock)
+#else /* ENABLE_THREADING */
+# define NIH_METRICS_LOCK()
+#endif /* ENABLE_THREADING */
+
+/**
+ * NIH_METRICS_UNLOCK:
+ *
+ * Unlocks the table of metrics after a call to NIH_METRICS_LOCK().
+ **/
+#if ENABLE_THREADING
+# define NIH_METRICS_UNLOCK() pthread_mutex_unlock (&metrics_lock)
+#else /* ENABLE_THREADING */
+# define NIH_METRICS_UNLOCK()
+#endif /* ENABLE_THREADING */
+
+
+/* Prototypes for static functions */
+static NihMetric *nih_metric_lookup       (const char *name,
+					   NihMetricType type);
+static inline int nih_metric_shard        (void);
+static inline size_t nih_metric_bucket    (uint64_t value);
+static uint64_t   nih_metric_bucket_value (size_t bucket);
+static uint64_t   nih_metric_percentile   (const uint64_t *buckets,
+					   uint64_t count, unsigned int pct);
+static void       nih_metric_sum          (NihMetric *metric,
+					   NihMetricValue *value,
+					   uint64_t *buckets);
+static int        nih_metric_value_cmp    (const void *a, const void *b);
+
+
+/**
+ * nih_metrics_enabled:
+ *
+ * TRUE when metrics are being collected, set with nih_metrics_enable().
+ **/
+int nih_metrics_enabled = FALSE;
+
+/**
+ * metrics:
+ *
+ * Hash table of all metrics, each item is an NihMetric structure.
+ **/
+static NihHash *metrics = NULL;
+
+/**
+ * metric_shard:
+ *
+ * Shard used by the current thread, assigned on first use.
+ **/
+static __thread int metric_shard = -1;
+
+/**
+ * next_shard:
+ *
+ * Shard to be assigned to the next thread.
+ **/
+static unsigned int next_shard = 0;
+
+#if ENABLE_THREADING
+/**
+ * metrics_lock:
+ *
+ * Lock held while creating metrics or taking a snapshot of them.
+ **/
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* ENABLE_THREADING */
+
+
+/**
+ * nih_metrics_init:
+ *
+ * Initialise the table of metrics.
+ **/
+void
+nih_metrics_init (void)
+{
+	NIH_METRICS_LOCK ();
+
+	if (! metrics)
+		metrics = NIH_MUST (nih_hash_string_new (NULL, 0));
+
+	NIH_METRICS_UNLOCK ();
+}
+
+/**
+ * nih_metrics_enable:
+ * @enable: TRUE to collect metrics.
+ *
+ * Enables or disables the collection of metrics by the library and the
+ * NIH_METRIC_*() macros; existing values are retained while disabled.
+ **/
+void
+nih_metrics_enable (int enable)
+{
+	nih_metrics_enabled = enable ? TRUE : FALSE;
+}
+
+
+/**
+ * nih_metric_counter:
+ * @name: name of counter.
+ *
+ * Looks up the counter named @name, creating it if it doesn't exist.
+ *
+ * Returns: counter.
+ **/
+NihMetric *
+nih_metric_counter (const char *name)
+{
+	nih_assert (name != NULL);
+
+	return nih_metric_lookup (name, NIH_METRIC_COUNTER);
+}
+
+/**
+ * nih_metric_gauge:
+ * @name: name of gauge.
+ *
+ * Looks up the gauge named @name, creating it if it doesn't exist.
+ *
+ * Returns: gauge.
+ **/
+NihMetric *
+nih_metric_gauge (const char *name)
+{
+	nih_assert (name != NULL);
+
+	return nih_metric_lookup (name, NIH_METRIC_GAUGE);
+}
+
+/**
+ * nih_metric_histogram:
+ * @name: name of histogram.
+ *
+ * Looks up the histogram named @name, creating it if it doesn't exist.
+ *
+ * Returns: histogram.
+ **/
+NihMetric *
+nih_metric_histogram (const char *name)
+{
+	nih_assert (name != NULL);
+
+	return nih_metric_lookup (name, NIH_METRIC_HISTOGRAM);
+}
+
+/**
+ * nih_metric_lookup:
+ * @name: name of metric,
+ * @type: type of metric.
+ *
+ * Looks up the metric @name in the table of metrics, creating it with
+ * @type if it doesn't exist.  Since metrics live for the lifetime of the
+ * process, allocation failures are retried.
+ *
+ * Returns: metric.
+ **/
+static NihMetric *
+nih_metric_lookup (const char    *name,
+		   NihMetricType  type)
+{
+	NihMetric *metric;
+	int        i;
+
+	nih_assert (name != NULL);
+
+	nih_metrics_init ();
+
+	NIH_METRICS_LOCK ();
+
+	metric = (NihMetric *)nih_hash_lookup (metrics, name);
+	if (metric) {
+		nih_assert (metric->type == type);
+
+		NIH_METRICS_UNLOCK ();
+		return metric;
+	}
+
+	metric = NIH_MUST (nih_new (metrics, NihMetric));
+	memset (metric, 0, sizeof (NihMetric));
+
+	nih_list_init (&metric->entry);
+
+	metric->name = NIH_MUST (nih_strdup (metric, name));
+	metric->type = type;
+
+	/* nih_alloc() only guarantees the alignment of malloc(), so the
+	 * shards are allocated separately to give each its own cache line;
+	 * like the metric, they are never freed.
+	 */
+	NIH_ZERO (posix_memalign ((void **)&metric->shards,
+				  NIH_METRIC_CACHE_LINE,
+				  sizeof (NihMetricShard) * NIH_METRIC_SHARDS));
+	memset (metric->shards, 0,
+		sizeof (NihMetricShard) * NIH_METRIC_SHARDS);
+
+	for (i = 0; i < NIH_METRIC_SHARDS; i++) {
+		NihMetricShard *shard = &metric->shards[i];
+
+		shard->min = UINT64_MAX;
+
+		if (type != NIH_METRIC_HISTOGRAM)
+			continue;
+
+		shard->buckets = NIH_MUST (nih_alloc (
+			metric, sizeof (uint64_t) * NIH_METRIC_BUCKETS));
+		memset (shard->buckets, 0,
+			sizeof (uint64_t) * NIH_METRIC_BUCKETS);
+	}
+
+	nih_hash_add (metrics, &metric->entry);
+
+	NIH_METRICS_UNLOCK ();
+
+	return metric;
+}
+
+
+/**
+ * nih_metric_shard:
+ *
+ * Returns the shard index used by the current thread, assigning one the
+ * first time it is called in each thread.
+ *
+ * Returns: shard index.
+ **/
+static inline int
+nih_metric_shard (void)
+{
+	if (metric_shard < 0)
+		metric_shard = (__atomic_fetch_add (&next_shard, 1,
+						    __ATOMIC_RELAXED)
+				% NIH_METRIC_SHARDS);
+
+	return metric_shard;
+}
+
+/**
+ * nih_metric_add:
+ * @metric: counter,
+ * @value: value to add.
+ *
+ * Adds @value to the counter @metric.
+ **/
+void
+nih_metric_add (NihMetric *metric,
+		int64_t    value)
+{
+	nih_assert (metric != NULL);
+	nih_assert (metric->type == NIH_METRIC_COUNTER);
+
+	__atomic_add_fetch (&metric->shards[nih_metric_shard ()].value,
+			    value, __ATOMIC_RELAXED);
+}
+
+/**
+ * nih_metric_set:
+ * @metric: gauge,
+ * @value: new value.
+ *
+ * Sets the gauge @metric to @value.
+ **/
+void
+nih_metric_set (NihMetric *metric,
+		int64_t    value)
+{
+	nih_assert (metric != NULL);
+	nih_assert (metric->type == NIH_METRIC_GAUGE);
+
+	__atomic_store_n (&metric->shards[0].value, value, __ATOMIC_RELAXED);
+}
+
+/**
+ * nih_metric_set_max:
+ * @metric: gauge,
+ * @value: new value.
+ *
+ * Sets the gauge @metric to @value if that is greater than its current
+ * value, used for high water marks.
+ **/
+void
+nih_metric_set_max (NihMetric *metric,
+		    int64_t    value)
+{
+	int64_t current;
+
+	nih_assert (metric != NULL);
+	nih_assert (metric->type == NIH_METRIC_GAUGE);
+
+	current = __atomic_load_n (&metric->shards[0].value, __ATOMIC_RELAXED);
+	while ((value > current)
+	       && (! __atomic_compare_exchange_n (&metric->shards[0].value,
+						  &current, value, TRUE,
+						  __ATOMIC_RELAXED,
+						  __ATOMIC_RELAXED)))
+		;
+}
+
+/**
+ * nih_metric_record:
+ * @metric: histogram,
+ * @value: value to record.
+ *
+ * Records @value in the histogram @metric.
+ **/
+void
+nih_metric_record (NihMetric *metric,
+		   uint64_t   value)
+{
+	NihMetricShard *shard;
+	uint64_t        current;
+
+	nih_assert (metric != NULL);
+	nih_assert (metric->type == NIH_METRIC_HISTOGRAM);
+
+	shard = &metric->shards[nih_metric_shard ()];
+
+	__atomic_add_fetch (&shard->buckets[nih_metric_bucket (value)], 1,
+			    __ATOMIC_RELAXED);
+	__atomic_add_fetch (&shard->count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch (&shard->sum, value, __ATOMIC_RELAXED);
+
+	current = __atomic_load_n (&shard->min, __ATOMIC_RELAXED);
+	while ((value < current)
+	       && (! __atomic_compare_exchange_n (&shard->min, &current,
+						  value, TRUE,
+						  __ATOMIC_RELAXED,
+						  __ATOMIC_RELAXED)))
+		;
+
+	current = __atomic_load_n (&shard->max, __ATOMIC_RELAXED);
+	while ((value > current)
+	       && (! __atomic_compare_exchange_n (&shard->max, &current,
+						  value, TRUE,
+						  __ATOMIC_RELAXED,
+						  __ATOMIC_RELAXED)))
+		;
+}
+
+
+/**
+ * nih_metric_bucket:
+ * @value: value to find bucket for.
+ *
+ * Histogram buckets are linear below NIH_METRIC_SUB_BUCKETS, and above
+ * that each power of two is divided into NIH_METRIC_SUB_BUCKETS linear
+ * buckets, so the error is bounded relative to @value.
+ *
+ * Returns: index of bucket for @value.
+ **/
+static inline size_t
+nih_metric_bucket (uint64_t value)
+{
+	size_t bucket;
+	int    exp;
+
+	if (value < NIH_METRIC_SUB_BUCKETS)
+		return value;
+
+	/* NIH_METRIC_SUB_BUCKETS is 2^3, so the three bits below the
+	 * most significant select the sub-bucket.
+	 */
+	exp = 63 - __builtin_clzll (value);
+	bucket = ((exp - 2) * NIH_METRIC_SUB_BUCKETS
+		  + ((value >> (exp - 3)) & (NIH_METRIC_SUB_BUCKETS - 1)));
+
+	if (bucket >= NIH_METRIC_BUCKETS)
+		bucket = NIH_METRIC_BUCKETS - 1;
+
+	return bucket;
+}
+
+/**
+ * nih_metric_bucket_value:
+ * @bucket: index of bucket.
+ *
+ * Returns: largest value counted in @bucket.
+ **/
+static uint64_t
+nih_metric_bucket_value (size_t bucket)
+{
+	int exp;
+	int sub;
+
+	if (bucket < NIH_METRIC_SUB_BUCKETS)
+		return bucket;
+
+	exp = bucket / NIH_METRIC_SUB_BUCKETS + 2;
+	sub = bucket % NIH_METRIC_SUB_BUCKETS;
+
+	return (((uint64_t)NIH_METRIC_SUB_BUCKETS + sub + 1) << (exp - 3)) - 1;
+}
+
+/**
+ * nih_metric_percentile:
+ * @buckets: histogram buckets,
+ * @count: total of @buckets,
+ * @pct: percentile to find.
+ *
+ * Returns: value at the @pct percentile of @buckets.
+ **/
+static uint64_t
+nih_metric_percentile (const uint64_t *buckets,
+		       uint64_t        count,
+		       unsigned int    pct)
+{
+	uint64_t target;
+	uint64_t seen = 0;
+	size_t   i;
+
+	nih_assert (buckets != NULL);
+
+	if (! count)
+		return 0;
+
+	target = (count * pct + 99) / 100;
+
+	for (i = 0; i < NIH_METRIC_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= target)
+			return nih_metric_bucket_value (i);
+	}
+
+	return nih_metric_bucket_value (NIH_METRIC_BUCKETS - 1);
+}
+
+
+/**
+ * nih_metrics_snapshot:
+ * @parent: parent object for new array.
+ *
+ * Takes a snapshot of the current value of all metrics, summing the
+ * shards of each, and returns them as a NULL-terminated array sorted by
+ * name.  Values may continue to be updated by other threads while the
+ * snapshot is taken, so related metrics may be slightly inconsistent.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned array.  When all parents
+ * of the returned array are freed, the returned array will also be
+ * freed.
+ *
+ * Returns: newly allocated array or NULL if insufficient memory.
+ **/
+NihMetricValue **
+nih_metrics_snapshot (const void *parent)
+{
+	NihMetricValue **snapshot = NULL;
+	uint64_t        *buckets = NULL;
+	size_t           len = 0;
+
+	nih_metrics_init ();
+
+	NIH_METRICS_LOCK ();
+
+	NIH_HASH_FOREACH (metrics, iter)
+		len++;
+
+	snapshot = nih_alloc (parent, sizeof (NihMetricValue *) * (len + 1));
+	if (! snapshot)
+		goto error;
+
+	buckets = nih_alloc (snapshot, sizeof (uint64_t) * NIH_METRIC_BUCKETS);
+	if (! buckets)
+		goto error;
+
+	len = 0;
+	snapshot[len] = NULL;
+
+	NIH_HASH_FOREACH (metrics, iter) {
+		NihMetric      *metric = (NihMetric *)iter;
+		NihMetricValue *value;
+
+		value = nih_new (snapshot, NihMetricValue);
+		if (! value)
+			goto error;
+
+		memset (value, 0, sizeof (NihMetricValue));
+
+		value->name = nih_strdup (value, metric->name);
+		if (! value->name)
+			goto error;
+
+		nih_metric_sum (metric, value, buckets);
+
+		snapshot[len++] = value;
+		snapshot[len] = NULL;
+	}
+
+	NIH_METRICS_UNLOCK ();
+
+	nih_free (buckets);
+
+	qsort (snapshot, len, sizeof (NihMetricValue *), nih_metric_value_cmp);
+
+	return snapshot;
+
+error:
+	NIH_METRICS_UNLOCK ();
+
+	if (snapshot)
+		nih_free (snapshot);
+
+	return NULL;
+}
+
+/**
+ * nih_metric_get:
+ * @name: name of metric,
+ * @value: value to fill.
+ *
+ * Obtains the current value of the metric named @name, summing its
+ * shards as nih_metrics_snapshot() does but without copying every other
+ * metric.  @value is zeroed if the metric has not yet been used; its
+ * name member is not set.
+ **/
+void
+nih_metric_get (const char     *name,
+		NihMetricValue *value)
+{
+	uint64_t   buckets[NIH_METRIC_BUCKETS];
+	NihMetric *metric;
+
+	nih_assert (name != NULL);
+	nih_assert (value != NULL);
+
+	memset (value, 0, sizeof (NihMetricValue));
+
+	nih_metrics_init ();
+
+	NIH_METRICS_LOCK ();
+
+	metric = (NihMetric *)nih_hash_lookup (metrics, name);
+	if (metric)
+		nih_metric_sum (metric, value, buckets);
+
+	NIH_METRICS_UNLOCK ();
+}
+
+/**
+ * nih_metric_sum:
+ * @metric: metric to sum,
+ * @value: zeroed value to fill,
+ * @buckets: NIH_METRIC_BUCKETS buckets to use.
+ *
+ * Sums the shards of @metric into @value, using @buckets to total the
+ * histogram buckets for the percentiles.  Must be called with the table
+ * of metrics locked.
+ **/
+static void
+nih_metric_sum (NihMetric      *metric,
+		NihMetricValue *value,
+		uint64_t       *buckets)
+{
+	size_t i;
+
+	nih_assert (metric != NULL);
+	nih_assert (value != NULL);
+	nih_assert (buckets != NULL);
+
+	value->type = metric->type;
+	value->min = UINT64_MAX;
+
+	memset (buckets, 0, sizeof (uint64_t) * NIH_METRIC_BUCKETS);
+
+	for (i = 0; i < NIH_METRIC_SHARDS; i++) {
+		NihMetricShard *shard = &metric->shards[i];
+		uint64_t        min, max;
+		size_t          j;
+
+		value->value += __atomic_load_n (&shard->value,
+						 __ATOMIC_RELAXED);
+
+		if (metric->type != NIH_METRIC_HISTOGRAM)
+			continue;
+
+		value->count += __atomic_load_n (&shard->count,
+						 __ATOMIC_RELAXED);
+		value->sum += __atomic_load_n (&shard->sum, __ATOMIC_RELAXED);
+
+		min = __atomic_load_n (&shard->min, __ATOMIC_RELAXED);
+		if (min < value->min)
+			value->min = min;
+
+		max = __atomic_load_n (&shard->max, __ATOMIC_RELAXED);
+		if (max > value->max)
+			value->max = max;
+
+		for (j = 0; j < NIH_METRIC_BUCKETS; j++)
+			buckets[j] += __atomic_load_n (&shard->buckets[j],
+						       __ATOMIC_RELAXED);
+	}
+
+	if (value->min == UINT64_MAX)
+		value->min = 0;
+
+	if (metric->type == NIH_METRIC_HISTOGRAM) {
+		uint64_t count = 0;
+
+		/* Use the bucket total rather than the count so the
+		 * percentiles are consistent with the buckets.
+		 */
+		for (i = 0; i < NIH_METRIC_BUCKETS; i++)
+			count += buckets[i];
+
+		value->p50 = nih_metric_percentile (buckets, count, 50);
+		value->p90 = nih_metric_percentile (buckets, count, 90);
+		value->p99 = nih_metric_percentile (buckets, count, 99);
+	}
+}
+
+/**
+ * nih_metric_value_cmp:
+ * @a: pointer to first value,
+ * @b: pointer to second value.
+ *
+ * Compares two values from a snapshot by name, for qsort().
+ *
+ * Returns: integer less than, equal to or greater than zero.
+ **/
+static int
+nih_metric_value_cmp (const void *a,
+		      const void *b)
+{
+	const NihMetricValue *value_a = *(const NihMetricValue **)a;
+	const NihMetricValue *value_b = *(const NihMetricValue **)b;
+
+	return strcmp (value_a->name, value_b->name);
+}
+
+
+/**
+ * nih_metrics_reset:
+ *
+ * Resets all counters and histograms to zero; gauges are left alone
+ * since they describe current state.  Updates made by other threads
+ * while this is in progress may be lost.
+ **/
+void
+nih_metrics_reset (void)
+{
+	nih_metrics_init ();
+
+	NIH_METRICS_LOCK ();
+
+	NIH_HASH_FOREACH (metrics, iter) {
+		NihMetric *metric = (NihMetric *)iter;
+		int        i;
+
+		if (metric->type == NIH_METRIC_GAUGE)
+			continue;
+
+		for (i = 0; i < NIH_METRIC_SHARDS; i++) {
+			NihMetricShard *shard = &metric->shards[i];
+			size_t          j;
+
+			__atomic_store_n (&shard->value, 0, __ATOMIC_RELAXED);
+
+			if (metric->type != NIH_METRIC_HISTOGRAM)
+				continue;
+
+			__atomic_store_n (&shard->count, 0, __ATOMIC_RELAXED);
+			__atomic_store_n (&shard->sum, 0, __ATOMIC_RELAXED);
+			__atomic_store_n (&shard->min, UINT64_MAX,
+					  __ATOMIC_RELAXED);
+			__atomic_store_n (&shard->max, 0, __ATOMIC_RELAXED);
+
+			for (j = 0; j < NIH_METRIC_BUCKETS; j++)
+				__atomic_store_n (&shard->buckets[j], 0,
+						  __ATOMIC_RELAXED);
+		}
+	}
+
+	NIH_METRICS_UNLOCK ();
+}
@@ -0,0 +1,266 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_METRICS_H
+#define NIH_METRICS_H
+
+/**
+ * Metrics are named counters, gauges and histograms kept by the library
+ * and by programs using it, so that monitoring can see where a daemon
+ * spends its time.  Collection is disabled by default and enabled with
+ * nih_metrics_enable(); while disabled the instrumented code paths only
+ * test a single variable.
+ *
+ * Metrics are created on first use with nih_metric_counter(),
+ * nih_metric_gauge() or nih_metric_histogram() and live for the
+ * lifetime of the process; the NIH_METRIC_ADD(), NIH_METRIC_SET_MAX()
+ * and NIH_METRIC_RECORD() macros cache the metric at the call site.
+ *
+ * Updates are spread over a number of shards, each thread using its own,
+ * so that they need no locks; the shards are summed when the values of
+ * all metrics are obtained with nih_metrics_snapshot(), or that of a
+ * single metric with nih_metric_get().
+ **/
+
+#include <stdint.h>
+
+#include <nih/macros.h>
+#include <nih/list.h>
+
+
+/**
+ * NIH_METRIC_SHARDS:
+ *
+ * Number of shards each counter and histogram is split into.
+ **/
+#define NIH_METRIC_SHARDS 8
+
+/**
+ * NIH_METRIC_CACHE_LINE:
+ *
+ * Size of a cache line, to which each shard is aligned.
+ **/
+#define NIH_METRIC_CACHE_LINE 64
+
+/**
+ * NIH_METRIC_SUB_BUCKETS:
+ *
+ * Number of histogram buckets for each power of two, giving a precision
+ * of 1 in NIH_METRIC_SUB_BUCKETS.
+ **/
+#define NIH_METRIC_SUB_BUCKETS 8
+
+/**
+ * NIH_METRIC_BUCKETS:
+ *
+ * Number of buckets in each histogram shard, covering values up to 2^40;
+ * larger values are counted in the last bucket.
+ **/
+#define NIH_METRIC_BUCKETS ((40 - 2) * NIH_METRIC_SUB_BUCKETS)
+
+
+/**
+ * NihMetricType:
+ *
+ * Type of a metric.  Counters only increase, until reset; gauges hold a
+ * current value or high water mark and histograms record the
+ * distribution of values such as latencies.
+ **/
+typedef enum {
+	NIH_METRIC_COUNTER,
+	NIH_METRIC_GAUGE,
+	NIH_METRIC_HISTOGRAM,
+} NihMetricType;
+
+/**
+ * NihMetricShard:
+ * @value: counter total or gauge value,
+ * @count: number of values recorded in histogram,
+ * @sum: sum of values recorded in histogram,
+ * @min: smallest value recorded in histogram,
+ * @max: largest value recorded in histogram,
+ * @buckets: histogram buckets.
+ *
+ * Each shard of a metric is updated by a single thread at a time and
+ * occupies its own cache line, since the array of shards is allocated
+ * with posix_memalign() rather than nih_alloc() which cannot honour the
+ * alignment.  Gauges only use the first shard.
+ **/
+typedef struct nih_metric_shard {
+	int64_t   value;
+	uint64_t  count;
+	uint64_t  sum;
+	uint64_t  min;
+	uint64_t  max;
+	uint64_t *buckets;
+} __attribute__ ((aligned (NIH_METRIC_CACHE_LINE))) NihMetricShard;
+
+/**
+ * NihMetric:
+ * @entry: list header,
+ * @name: name of metric,
+ * @type: type of metric,
+ * @shards: NIH_METRIC_SHARDS values of metric.
+ *
+ * This structure represents a metric, held in the hash table of all
+ * metrics.  Metrics are never freed.
+ **/
+typedef struct nih_metric {
+	NihList         entry;
+	char           *name;
+	NihMetricType   type;
+
+	NihMetricShard *shards;
+} NihMetric;
+
+/**
+ * NihMetricValue:
+ * @name: name of metric,
+ * @type: type of metric,
+ * @value: total of counter or value of gauge,
+ * @count: number of values recorded in histogram,
+ * @sum: sum of values recorded in histogram,
+ * @min: smallest value recorded in histogram,
+ * @max: largest value recorded in histogram,
+ * @p50: median value recorded in histogram,
+ * @p90: 90th percentile of values recorded in histogram,
+ * @p99: 99th percentile of values recorded in histogram.
+ *
+ * This structure holds the value of a metric at the time that
+ * nih_metrics_snapshot() was called.  Percentiles are accurate to the
+ * precision of the histogram buckets, and are the upper bound of the
+ * bucket the percentile falls within.
+ **/
+typedef struct nih_metric_value {
+	char          *name;
+	NihMetricType  type;
+
+	int64_t        value;
+
+	uint64_t       count;
+	uint64_t       sum;
+	uint64_t       min;
+	uint64_t       max;
+	uint64_t       p50;
+	uint64_t       p90;
+	uint64_t       p99;
+} NihMetricValue;
+
+
+/**
+ * NIH_METRIC_CACHED:
+ * @_type: type of metric,
+ * @_name: name of metric,
+ * @_call: update to make.
+ *
+ * Expands to code that, if metrics are enabled, looks up the metric
+ * @_name of @_type the first time it is reached and caches it for later
+ * calls, setting the variable _metric for @_call.
+ *
+ * The cache may be filled by more than one thread at once, since looking
+ * up the metric always returns the same one, so it's only necessary that
+ * it's read and written atomically.
+ **/
+#define NIH_METRIC_CACHED(_type, _name, _call)				\
+	do {								\
+		static NihMetric *_metric_cache = NULL;			\
+		NihMetric        *_metric;				\
+									\
+		if (! nih_metrics_enabled)				\
+			break;						\
+									\
+		_metric = __atomic_load_n (&_metric_cache,		\
+					   __ATOMIC_ACQUIRE);		\
+		if (! _metric) {					\
+			_metric = nih_metric_##_type (_name);		\
+			__atomic_store_n (&_metric_cache, _metric,	\
+					  __ATOMIC_RELEASE);		\
+		}							\
+									\
+		_call;							\
+	} while (0)
+
+/**
+ * NIH_METRIC_ADD:
+ * @_name: name of counter,
+ * @_value: value to add.
+ *
+ * Adds @_value to the counter @_name if metrics are enabled.
+ **/
+#define NIH_METRIC_ADD(_name, _value) \
+	NIH_METRIC_CACHED (counter, _name, nih_metric_add (_metric, (_value)))
+
+/**
+ * NIH_METRIC_SET:
+ * @_name: name of gauge,
+ * @_value: new value.
+ *
+ * Sets the gauge @_name to @_value if metrics are enabled.
+ **/
+#define NIH_METRIC_SET(_name, _value) \
+	NIH_METRIC_CACHED (gauge, _name, nih_metric_set (_metric, (_value)))
+
+/**
+ * NIH_METRIC_SET_MAX:
+ * @_name: name of gauge,
+ * @_value: new value.
+ *
+ * Sets the gauge @_name to @_value if metrics are enabled and it is
+ * greater than its current value.
+ **/
+#define NIH_METRIC_SET_MAX(_name, _value) \
+	NIH_METRIC_CACHED (gauge, _name, nih_metric_set_max (_metric, (_value)))
+
+/**
+ * NIH_METRIC_RECORD:
+ * @_name: name of histogram,
+ * @_value: value to record.
+ *
+ * Records @_value in the histogram @_name if metrics are enabled.
+ **/
+#define NIH_METRIC_RECORD(_name, _value) \
+	NIH_METRIC_CACHED (histogram, _name, nih_metric_record (_metric, (_value)))
+
+
+NIH_BEGIN_EXTERN
+
+extern int nih_metrics_enabled;
+
+
+void             nih_metrics_init     (void);
+void             nih_metrics_enable   (int enable);
+
+NihMetric *      nih_metric_counter   (const char *name);
+NihMetric *      nih_metric_gauge     (const char *name);
+NihMetric *      nih_metric_histogram (const char *name);
+
+void             nih_metric_add       (NihMetric *metric, int64_t value);
+void             nih_metric_set       (NihMetric *metric, int64_t value);
+void             nih_metric_set_max   (NihMetric *metric, int64_t value);
+void             nih_metric_record    (NihMetric *metric, uint64_t value);
+
+void             nih_metric_get       (const char *name,
+				       NihMetricValue *value);
+
+NihMetricValue **nih_metrics_snapshot (const void *parent)
+	__attribute__ ((warn_unused_result));
+void             nih_metrics_reset    (void);
+
+NIH_END_EXTERN
+
+#endif /* NIH_METRICS_H */
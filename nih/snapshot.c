@@ -0,0 +1,1688 @@
+/* libnih
+ *
+ * snapshot.c - object graph snapshots passed across exec
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/tree.h>
+#include <nih/array.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+#include <nih/errors.h>
+
+#include "snapshot.h"
+
+
+/**
+ * NIH_SNAPSHOT_MAGIC:
+ *
+ * Bytes found at the start of every snapshot image, which include the
+ * version of the image format.
+ **/
+#define NIH_SNAPSHOT_MAGIC "NIHSNAP1"
+
+/**
+ * NIH_SNAPSHOT_MAGIC_LEN:
+ *
+ * Length of NIH_SNAPSHOT_MAGIC.
+ **/
+#define NIH_SNAPSHOT_MAGIC_LEN 8
+
+
+/**
+ * NihSnapshotAddress:
+ * @entry: list header,
+ * @ptr: address of object,
+ * @index: index of object in the snapshot's objects array.
+ *
+ * This structure is used to find the objects already added to a snapshot
+ * by their address.
+ **/
+typedef struct nih_snapshot_address {
+	NihList  entry;
+	void    *ptr;
+	uint32_t index;
+} NihSnapshotAddress;
+
+/**
+ * NihSnapshotRoot:
+ * @entry: list header,
+ * @name: name of object,
+ * @index: index of object in the snapshot's objects array.
+ *
+ * This structure records the name of a top-level object in a snapshot.
+ **/
+typedef struct nih_snapshot_root {
+	NihList  entry;
+	char    *name;
+	uint32_t index;
+} NihSnapshotRoot;
+
+/**
+ * NihSnapshotWriter:
+ * @buf: image being written, or NULL,
+ * @len: length of image.
+ *
+ * This structure is used to write an image; when @buf is NULL nothing is
+ * written, only @len is increased, so the same code is used to calculate
+ * the size of the image before writing it.
+ **/
+typedef struct nih_snapshot_writer {
+	char   *buf;
+	size_t  len;
+} NihSnapshotWriter;
+
+/**
+ * NihSnapshotReader:
+ * @buf: image being read,
+ * @len: length of image,
+ * @pos: current position in @buf.
+ *
+ * This structure is used to read an image, ensuring that nothing is read
+ * beyond its end.
+ **/
+typedef struct nih_snapshot_reader {
+	const char *buf;
+	size_t      len;
+	size_t      pos;
+} NihSnapshotReader;
+
+
+/* Prototypes for static functions */
+static const NihSnapshotType *nih_snapshot_type_lookup   (const char *name);
+
+static int                    nih_snapshot_object_add    (NihSnapshot *snapshot,
+							  const NihSnapshotType *type,
+							  void *ptr,
+							  uint32_t parent,
+							  uint32_t parent_field,
+							  const void *parent_ptr,
+							  uint32_t *index);
+static int                    nih_snapshot_object_visit  (NihSnapshot *snapshot,
+							  uint32_t index);
+static NihSnapshotAddress *   nih_snapshot_address_lookup (NihSnapshot *snapshot,
+							   const void *ptr);
+static int                    nih_snapshot_address_grow  (NihSnapshot *snapshot);
+static const void *           nih_snapshot_address_key   (NihList *entry);
+static uint32_t               nih_snapshot_address_hash  (const void *key);
+static int                    nih_snapshot_address_cmp   (const void *key1,
+							  const void *key2);
+
+static int                    nih_snapshot_image         (NihSnapshot *snapshot,
+							  NihSnapshotWriter *writer);
+static void                   nih_snapshot_put           (NihSnapshotWriter *writer,
+							  const void *data,
+							  size_t len);
+static void                   nih_snapshot_put_u32       (NihSnapshotWriter *writer,
+							  uint32_t value);
+static void                   nih_snapshot_put_string    (NihSnapshotWriter *writer,
+							  const char *str);
+static uint32_t               nih_snapshot_id            (NihSnapshot *snapshot,
+							  const void *ptr);
+
+static const void *           nih_snapshot_get_bytes     (NihSnapshotReader *reader,
+							  size_t len);
+static int                    nih_snapshot_get_u32       (NihSnapshotReader *reader,
+							  uint32_t *value);
+static int                    nih_snapshot_get_string    (NihSnapshotReader *reader,
+							  const char **str);
+static int                    nih_snapshot_get_object    (NihSnapshot *snapshot,
+							  uint32_t id,
+							  const NihSnapshotType *type,
+							  void **ptr);
+static int                    nih_snapshot_restore       (NihSnapshot *snapshot,
+							  NihSnapshotReader *reader);
+
+
+/**
+ * snapshot_types:
+ *
+ * List of registered snapshot types, each entry is an NihListEntry
+ * structure with the data member pointing to the NihSnapshotType.
+ **/
+static NihList *snapshot_types = NULL;
+
+
+/**
+ * nih_snapshot_register:
+ * @type: type to register.
+ *
+ * Registers @type so that objects of that type may be read from snapshot
+ * images by nih_snapshot_read(); a type registered with the same name as
+ * an existing type replaces it.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_snapshot_register (const NihSnapshotType *type)
+{
+	NihListEntry *entry;
+
+	nih_assert (type != NULL);
+	nih_assert (type->name != NULL);
+	nih_assert ((type->num_fields == 0) || (type->fields != NULL));
+
+	if (! snapshot_types) {
+		snapshot_types = nih_list_new (NULL);
+		if (! snapshot_types)
+			nih_return_no_memory_error (-1);
+	}
+
+	NIH_LIST_FOREACH (snapshot_types, iter) {
+		entry = (NihListEntry *)iter;
+
+		if (! strcmp (((const NihSnapshotType *)entry->data)->name,
+			      type->name)) {
+			entry->data = (void *)type;
+			return 0;
+		}
+	}
+
+	entry = nih_list_entry_new (snapshot_types);
+	if (! entry)
+		nih_return_no_memory_error (-1);
+
+	entry->data = (void *)type;
+	nih_list_add (snapshot_types, &entry->entry);
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_type_lookup:
+ * @name: name of type.
+ *
+ * Finds the registered type named @name.
+ *
+ * Returns: type found or NULL if not registered.
+ **/
+static const NihSnapshotType *
+nih_snapshot_type_lookup (const char *name)
+{
+	nih_assert (name != NULL);
+
+	if (! snapshot_types)
+		return NULL;
+
+	NIH_LIST_FOREACH (snapshot_types, iter) {
+		NihListEntry *         entry = (NihListEntry *)iter;
+		const NihSnapshotType *type = entry->data;
+
+		if (! strcmp (type->name, name))
+			return type;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * nih_snapshot_new:
+ * @parent: parent object for new snapshot.
+ *
+ * Allocates a new snapshot to which objects may be added with
+ * nih_snapshot_add() before it is written with nih_snapshot_write().
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned snapshot.  When all parents
+ * of the returned snapshot are freed, the returned snapshot will also be
+ * freed.
+ *
+ * Returns: new NihSnapshot structure or NULL if insufficient memory.
+ **/
+NihSnapshot *
+nih_snapshot_new (const void *parent)
+{
+	NihSnapshot *snapshot;
+
+	snapshot = nih_new (parent, NihSnapshot);
+	if (! snapshot)
+		return NULL;
+
+	snapshot->objects = nih_array_new (snapshot, sizeof (NihSnapshotObject));
+	if (! snapshot->objects)
+		goto error;
+
+	snapshot->addresses = nih_hash_new (snapshot, 0,
+					    nih_snapshot_address_key,
+					    nih_snapshot_address_hash,
+					    nih_snapshot_address_cmp);
+	if (! snapshot->addresses)
+		goto error;
+
+	snapshot->roots = nih_hash_string_new (snapshot, 0);
+	if (! snapshot->roots)
+		goto error;
+
+	return snapshot;
+
+error:
+	nih_free (snapshot);
+	return NULL;
+}
+
+
+/**
+ * nih_snapshot_add:
+ * @snapshot: snapshot to add to,
+ * @name: name of object,
+ * @type: type of object,
+ * @ptr: object to add.
+ *
+ * Adds the object @ptr of type @type to @snapshot as a top-level object
+ * named @name, along with all of the objects that may be reached from it
+ * through the members described by @type and the types of those objects.
+ *
+ * Objects are only added once, no matter how many times they are reached,
+ * so objects shared between several others are restored shared in the
+ * same way.
+ *
+ * The objects are not written until nih_snapshot_write() is called, so
+ * should not be modified in the meantime.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+nih_snapshot_add (NihSnapshot *          snapshot,
+		  const char *           name,
+		  const NihSnapshotType *type,
+		  void *                 ptr)
+{
+	NihSnapshotRoot *root;
+	NihList *        replaced;
+	uint32_t         index;
+	size_t           first, i;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+	nih_assert (type != NULL);
+	nih_assert (ptr != NULL);
+
+	first = snapshot->objects->len;
+
+	if (nih_snapshot_object_add (snapshot, type, ptr, 0, 0, NULL, &index) < 0)
+		return -1;
+
+	/* Visit each object added, which may add more objects to the end
+	 * of the array; this avoids recursion for long lists.
+	 */
+	for (i = first; i < snapshot->objects->len; i++)
+		if (nih_snapshot_object_visit (snapshot, i) < 0)
+			return -1;
+
+	root = nih_new (snapshot->roots, NihSnapshotRoot);
+	if (! root)
+		nih_return_no_memory_error (-1);
+
+	nih_list_init (&root->entry);
+
+	root->name = nih_strdup (root, name);
+	if (! root->name) {
+		nih_free (root);
+		nih_return_no_memory_error (-1);
+	}
+
+	root->index = index;
+
+	replaced = nih_hash_replace (snapshot->roots, &root->entry);
+	if (replaced)
+		nih_free (replaced);
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_object_add:
+ * @snapshot: snapshot to add to,
+ * @type: type of object,
+ * @ptr: object to add,
+ * @parent: index of object referring to @ptr plus one, or zero,
+ * @parent_field: index of hash table member of @parent plus one, or zero,
+ * @parent_ptr: possible nih_alloc() parent of @ptr, or NULL,
+ * @index: pointer to store index of object in.
+ *
+ * Adds the object @ptr to @snapshot if it is not already there, without
+ * visiting the objects it refers to.  When @parent_ptr is an nih_alloc()
+ * parent of @ptr, @parent and @parent_field are recorded as the parent
+ * of @ptr.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_snapshot_object_add (NihSnapshot *          snapshot,
+			 const NihSnapshotType *type,
+			 void *                 ptr,
+			 uint32_t               parent,
+			 uint32_t               parent_field,
+			 const void *           parent_ptr,
+			 uint32_t *             index)
+{
+	NihSnapshotAddress *address;
+	NihSnapshotObject   object;
+	NihSnapshotObject * found;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (type != NULL);
+	nih_assert (ptr != NULL);
+	nih_assert (index != NULL);
+
+	address = nih_snapshot_address_lookup (snapshot, ptr);
+	if (address) {
+		found = &NIH_ARRAY_INDEX (snapshot->objects, NihSnapshotObject,
+					  address->index);
+		if (found->type != type)
+			nih_return_error (-1, NIH_SNAPSHOT_INVALID,
+					  _(NIH_SNAPSHOT_INVALID_STR));
+
+		if ((! found->parent) && parent_ptr
+		    && nih_alloc_parent (ptr, parent_ptr)) {
+			found->parent = parent;
+			found->parent_field = parent_field;
+		}
+
+		*index = address->index;
+		return 0;
+	}
+
+	if (snapshot->objects->len >= UINT32_MAX - 1)
+		nih_return_error (-1, NIH_SNAPSHOT_INVALID,
+				  _(NIH_SNAPSHOT_INVALID_STR));
+
+	address = nih_new (snapshot, NihSnapshotAddress);
+	if (! address)
+		nih_return_no_memory_error (-1);
+
+	nih_list_init (&address->entry);
+	nih_alloc_set_destructor (address, nih_list_destroy);
+
+	address->ptr = ptr;
+	address->index = snapshot->objects->len;
+
+	object.ptr = ptr;
+	object.type = type;
+	object.parent = 0;
+	object.parent_field = 0;
+	if (parent_ptr && nih_alloc_parent (ptr, parent_ptr)) {
+		object.parent = parent;
+		object.parent_field = parent_field;
+	}
+
+	if (! nih_array_append (snapshot->objects, &object)) {
+		nih_free (address);
+		nih_return_no_memory_error (-1);
+	}
+
+	nih_hash_add (snapshot->addresses, &address->entry);
+
+	if (nih_snapshot_address_grow (snapshot) < 0)
+		return -1;
+
+	*index = address->index;
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_object_visit:
+ * @snapshot: snapshot being added to,
+ * @index: index of object to visit.
+ *
+ * Adds the objects referred to by the object at @index in @snapshot.
+ *
+ * Objects linked into a hash table are recorded as children of the object
+ * holding it when they are children of the hash table itself, since the
+ * hash table is restored as a child of that object.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_snapshot_object_visit (NihSnapshot *snapshot,
+			   uint32_t     index)
+{
+	const NihSnapshotType *type;
+	char *                 ptr;
+	uint32_t               parent = index + 1;
+	uint32_t               found;
+	size_t                 i, j;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (index < snapshot->objects->len);
+
+	/* Take copies, since adding objects may move the array. */
+	ptr = NIH_ARRAY_INDEX (snapshot->objects, NihSnapshotObject, index).ptr;
+	type = NIH_ARRAY_INDEX (snapshot->objects, NihSnapshotObject, index).type;
+
+	for (i = 0; i < type->num_fields; i++) {
+		const NihSnapshotField *field = &type->fields[i];
+		void *                  member = ptr + field->offset;
+
+		switch (field->type) {
+		case NIH_SNAPSHOT_STRING:
+		case NIH_SNAPSHOT_DATA:
+		case NIH_SNAPSHOT_LINK:
+			break;
+		case NIH_SNAPSHOT_POINTER:
+			if (*(void **)member
+			    && (nih_snapshot_object_add (snapshot,
+							 field->target,
+							 *(void **)member,
+							 parent, 0, ptr,
+							 &found) < 0))
+				return -1;
+
+			break;
+		case NIH_SNAPSHOT_LIST:
+			NIH_LIST_FOREACH ((NihList *)member, iter) {
+				if (nih_snapshot_object_add (
+					    snapshot, field->target,
+					    (char *)iter - field->link,
+					    parent, 0, ptr, &found) < 0)
+					return -1;
+			}
+
+			break;
+		case NIH_SNAPSHOT_HASH:
+			if (! *(NihHash **)member)
+				break;
+
+			NIH_HASH_FOREACH (*(NihHash **)member, iter) {
+				if (nih_snapshot_object_add (
+					    snapshot, field->target,
+					    (char *)iter - field->link,
+					    parent, i + 1,
+					    *(NihHash **)member,
+					    &found) < 0)
+					return -1;
+			}
+
+			break;
+		case NIH_SNAPSHOT_TREE: {
+			NihTree *node = member;
+			NihTree *links[] = { node->parent, node->left,
+					     node->right };
+
+			for (j = 0; j < 3; j++) {
+				if (links[j]
+				    && (nih_snapshot_object_add (
+						snapshot, field->target,
+						(char *)links[j] - field->link,
+						parent, 0, ptr, &found) < 0))
+					return -1;
+			}
+
+			break;
+		}
+		default:
+			nih_assert_not_reached ();
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * nih_snapshot_address_lookup:
+ * @snapshot: snapshot to search,
+ * @ptr: address of object.
+ *
+ * Finds the object at address @ptr in @snapshot.
+ *
+ * Returns: address structure or NULL if not found.
+ **/
+static NihSnapshotAddress *
+nih_snapshot_address_lookup (NihSnapshot *snapshot,
+			     const void * ptr)
+{
+	nih_assert (snapshot != NULL);
+
+	return (NihSnapshotAddress *)nih_hash_lookup (snapshot->addresses,
+						      ptr);
+}
+
+/**
+ * nih_snapshot_address_grow:
+ * @snapshot: snapshot to check.
+ *
+ * Replaces the hash table used to find objects in @snapshot by address
+ * with a larger one once it holds, on average, more than two objects in
+ * each bin.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_snapshot_address_grow (NihSnapshot *snapshot)
+{
+	NihHash *addresses;
+
+	nih_assert (snapshot != NULL);
+
+	if (snapshot->objects->len <= snapshot->addresses->size * 2)
+		return 0;
+
+	addresses = nih_hash_new (snapshot, snapshot->objects->len * 4,
+				  nih_snapshot_address_key,
+				  nih_snapshot_address_hash,
+				  nih_snapshot_address_cmp);
+	if (! addresses)
+		nih_return_no_memory_error (-1);
+
+	/* The hash table can grow no further */
+	if (addresses->size == snapshot->addresses->size) {
+		nih_free (addresses);
+		return 0;
+	}
+
+	NIH_HASH_FOREACH_SAFE (snapshot->addresses, iter)
+		nih_hash_add (addresses, iter);
+
+	nih_free (snapshot->addresses);
+	snapshot->addresses = addresses;
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_address_key:
+ * @entry: NihSnapshotAddress entry.
+ *
+ * Key function for the hash table of objects by address.
+ *
+ * Returns: address of object.
+ **/
+static const void *
+nih_snapshot_address_key (NihList *entry)
+{
+	nih_assert (entry != NULL);
+
+	return ((NihSnapshotAddress *)entry)->ptr;
+}
+
+/**
+ * nih_snapshot_address_hash:
+ * @key: address of object.
+ *
+ * Hash function for the hash table of objects by address; the low bits
+ * of addresses are discarded since they are the same for every object.
+ *
+ * Returns: 32-bit hash.
+ **/
+static uint32_t
+nih_snapshot_address_hash (const void *key)
+{
+	return (uint32_t)(((uintptr_t)key >> 4) * 2654435761U);
+}
+
+/**
+ * nih_snapshot_address_cmp:
+ * @key1: address of object,
+ * @key2: address of object.
+ *
+ * Comparison function for the hash table of objects by address.
+ *
+ * Returns: zero if @key1 and @key2 are the same, non-zero otherwise.
+ **/
+static int
+nih_snapshot_address_cmp (const void *key1,
+			  const void *key2)
+{
+	return key1 != key2;
+}
+
+
+/**
+ * nih_snapshot_write:
+ * @snapshot: snapshot to write.
+ *
+ * Writes an image of the objects added to @snapshot to a new anonymous
+ * memory file.  The image is first sized, and then written directly into
+ * the mapped file, so no intermediate copy is made.
+ *
+ * The returned file descriptor is not closed on exec, so that it may be
+ * inherited by a new process image which can read it with
+ * nih_snapshot_read(); it should be closed otherwise.
+ *
+ * Returns: file descriptor of image, or negative value on raised error.
+ **/
+int
+nih_snapshot_write (NihSnapshot *snapshot)
+{
+	NihSnapshotWriter writer;
+	int               fd;
+
+	nih_assert (snapshot != NULL);
+
+	writer.buf = NULL;
+	writer.len = 0;
+
+	if (nih_snapshot_image (snapshot, &writer) < 0)
+		return -1;
+
+	fd = memfd_create ("nih-snapshot", 0);
+	if (fd < 0)
+		nih_return_system_error (-1);
+
+	if (ftruncate (fd, writer.len) < 0)
+		goto error;
+
+	writer.buf = mmap (NULL, writer.len, PROT_READ | PROT_WRITE,
+			   MAP_SHARED, fd, 0);
+	if (writer.buf == MAP_FAILED)
+		goto error;
+
+	if (nih_snapshot_image (snapshot, &writer) < 0) {
+		NihError *err;
+
+		err = nih_error_steal ();
+		munmap (writer.buf, writer.len);
+		close (fd);
+		nih_error_raise_error (err);
+		return -1;
+	}
+
+	munmap (writer.buf, writer.len);
+
+	return fd;
+
+error:
+	nih_error_raise_system ();
+	close (fd);
+	return -1;
+}
+
+/**
+ * nih_snapshot_image:
+ * @snapshot: snapshot to write,
+ * @writer: writer to use.
+ *
+ * Writes the image of @snapshot using @writer, which will only calculate
+ * its length if it has no buffer.
+ *
+ * Addresses are not written to the image; pointer and tree members are
+ * replaced by the number of the object they point to, and other members
+ * handled specially are cleared.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_snapshot_image (NihSnapshot *      snapshot,
+		    NihSnapshotWriter *writer)
+{
+	nih_local NihArray *types = NULL;
+	size_t              num_roots = 0;
+	size_t              i, j;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (writer != NULL);
+
+	writer->len = 0;
+
+	/* Number the types used, writing each name once */
+	types = nih_array_new (NULL, sizeof (const NihSnapshotType *));
+	if (! types)
+		nih_return_no_memory_error (-1);
+
+	NIH_ARRAY_FOREACH (snapshot->objects, NihSnapshotObject, object) {
+		int found = FALSE;
+
+		NIH_ARRAY_FOREACH (types, const NihSnapshotType *, type)
+			if (*type == object->type)
+				found = TRUE;
+
+		if ((! found) && (! nih_array_append (types, &object->type)))
+			nih_return_no_memory_error (-1);
+	}
+
+	NIH_HASH_FOREACH (snapshot->roots, iter)
+		num_roots++;
+
+	nih_snapshot_put (writer, NIH_SNAPSHOT_MAGIC, NIH_SNAPSHOT_MAGIC_LEN);
+	nih_snapshot_put_u32 (writer, sizeof (void *));
+	nih_snapshot_put_u32 (writer, types->len);
+	nih_snapshot_put_u32 (writer, snapshot->objects->len);
+	nih_snapshot_put_u32 (writer, num_roots);
+
+	NIH_ARRAY_FOREACH (types, const NihSnapshotType *, type)
+		nih_snapshot_put_string (writer, (*type)->name);
+
+	NIH_ARRAY_FOREACH (snapshot->objects, NihSnapshotObject, object) {
+		const NihSnapshotType *type = object->type;
+		char *                 raw;
+		uint32_t               type_index = 0;
+
+		while (NIH_ARRAY_INDEX (types, const NihSnapshotType *,
+					type_index) != type)
+			type_index++;
+
+		nih_snapshot_put_u32 (writer, type_index);
+		nih_snapshot_put_u32 (writer, object->parent);
+		nih_snapshot_put_u32 (writer, object->parent_field);
+		nih_snapshot_put_u32 (writer, type->size);
+
+		raw = writer->buf ? writer->buf + writer->len : NULL;
+		nih_snapshot_put (writer, object->ptr, type->size);
+
+		/* Patch the copied structure, and append the variable
+		 * length data of each member.
+		 */
+		for (i = 0; i < type->num_fields; i++) {
+			const NihSnapshotField *field = &type->fields[i];
+			char *                  member = (char *)object->ptr + field->offset;
+
+			switch (field->type) {
+			case NIH_SNAPSHOT_STRING:
+				if (raw)
+					memset (raw + field->offset, 0,
+						sizeof (void *));
+
+				nih_snapshot_put_string (writer,
+							 *(char **)member);
+				break;
+			case NIH_SNAPSHOT_DATA: {
+				size_t len;
+
+				if (raw)
+					memset (raw + field->offset, 0,
+						sizeof (void *));
+
+				memcpy (&len, (char *)object->ptr + field->link,
+					sizeof (size_t));
+
+				nih_snapshot_put_u32 (writer,
+						      *(void **)member ? 1 : 0);
+				if (*(void **)member)
+					nih_snapshot_put (writer,
+							  *(void **)member, len);
+
+				break;
+			}
+			case NIH_SNAPSHOT_POINTER:
+				if (raw) {
+					uintptr_t id;
+
+					id = nih_snapshot_id (snapshot,
+							      *(void **)member);
+					memcpy (raw + field->offset, &id,
+						sizeof (uintptr_t));
+				}
+
+				break;
+			case NIH_SNAPSHOT_LINK:
+				if (raw)
+					memset (raw + field->offset, 0,
+						sizeof (NihList));
+
+				break;
+			case NIH_SNAPSHOT_LIST: {
+				uint32_t count = 0;
+
+				if (raw)
+					memset (raw + field->offset, 0,
+						sizeof (NihList));
+
+				NIH_LIST_FOREACH ((NihList *)member, iter)
+					count++;
+
+				nih_snapshot_put_u32 (writer, count);
+
+				NIH_LIST_FOREACH ((NihList *)member, iter)
+					nih_snapshot_put_u32 (
+						writer,
+						nih_snapshot_id (
+							snapshot,
+							(char *)iter - field->link));
+
+				break;
+			}
+			case NIH_SNAPSHOT_HASH: {
+				NihHash *hash = *(NihHash **)member;
+				uint32_t count = 0;
+
+				if (raw)
+					memset (raw + field->offset, 0,
+						sizeof (NihHash *));
+
+				if (! hash) {
+					nih_snapshot_put_u32 (writer, 0);
+					break;
+				}
+
+				NIH_HASH_FOREACH (hash, iter)
+					count++;
+
+				nih_snapshot_put_u32 (writer, hash->size);
+				nih_snapshot_put_u32 (writer, count);
+
+				NIH_HASH_FOREACH (hash, iter)
+					nih_snapshot_put_u32 (
+						writer,
+						nih_snapshot_id (
+							snapshot,
+							(char *)iter - field->link));
+
+				break;
+			}
+			case NIH_SNAPSHOT_TREE: {
+				NihTree * node = (NihTree *)member;
+				NihTree * links[] = { node->parent, node->left,
+						      node->right };
+				uintptr_t ids[3];
+
+				if (! raw)
+					break;
+
+				for (j = 0; j < 3; j++)
+					ids[j] = (links[j]
+						  ? nih_snapshot_id (
+							  snapshot,
+							  (char *)links[j] - field->link)
+						  : 0);
+
+				memcpy (raw + field->offset, ids, sizeof (ids));
+				break;
+			}
+			default:
+				nih_assert_not_reached ();
+			}
+		}
+	}
+
+	NIH_HASH_FOREACH (snapshot->roots, iter) {
+		NihSnapshotRoot *root = (NihSnapshotRoot *)iter;
+
+		nih_snapshot_put_string (writer, root->name);
+		nih_snapshot_put_u32 (writer, root->index + 1);
+	}
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_put:
+ * @writer: writer to use,
+ * @data: data to write,
+ * @len: length of @data.
+ *
+ * Appends @len bytes from @data to the image being written by @writer.
+ **/
+static void
+nih_snapshot_put (NihSnapshotWriter *writer,
+		  const void *       data,
+		  size_t             len)
+{
+	nih_assert (writer != NULL);
+
+	if (writer->buf)
+		memcpy (writer->buf + writer->len, data, len);
+
+	writer->len += len;
+}
+
+/**
+ * nih_snapshot_put_u32:
+ * @writer: writer to use,
+ * @value: value to write.
+ *
+ * Appends @value to the image being written by @writer.
+ **/
+static void
+nih_snapshot_put_u32 (NihSnapshotWriter *writer,
+		      uint32_t           value)
+{
+	nih_snapshot_put (writer, &value, sizeof (uint32_t));
+}
+
+/**
+ * nih_snapshot_put_string:
+ * @writer: writer to use,
+ * @str: string to write, or NULL.
+ *
+ * Appends @str to the image being written by @writer, preceded by its
+ * length including the terminating nul, or zero if @str is NULL.
+ **/
+static void
+nih_snapshot_put_string (NihSnapshotWriter *writer,
+			 const char *       str)
+{
+	uint32_t len;
+
+	len = str ? strlen (str) + 1 : 0;
+
+	nih_snapshot_put_u32 (writer, len);
+	if (str)
+		nih_snapshot_put (writer, str, len);
+}
+
+/**
+ * nih_snapshot_id:
+ * @snapshot: snapshot being written,
+ * @ptr: address of object.
+ *
+ * Returns: number of the object at @ptr, which is its index plus one.
+ **/
+static uint32_t
+nih_snapshot_id (NihSnapshot *snapshot,
+		 const void * ptr)
+{
+	NihSnapshotAddress *address;
+
+	nih_assert (snapshot != NULL);
+
+	if (! ptr)
+		return 0;
+
+	address = nih_snapshot_address_lookup (snapshot, ptr);
+	nih_assert (address != NULL);
+
+	return address->index + 1;
+}
+
+
+/**
+ * nih_snapshot_read:
+ * @parent: parent object for new snapshot,
+ * @fd: file descriptor of image.
+ *
+ * Reads the image from @fd, as written by nih_snapshot_write(), and
+ * restores the objects in it.  Top-level objects may be obtained with
+ * nih_snapshot_get(); objects whose parent is not in the image are
+ * children of the returned snapshot so you should take a reference to
+ * any you wish to keep before freeing it.
+ *
+ * The types of all of the objects in the image must have been registered
+ * with nih_snapshot_register().  Once every object has been restored,
+ * the restore function of each type is called for its objects.
+ *
+ * @fd is not closed.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned snapshot.  When all parents
+ * of the returned snapshot are freed, the returned snapshot will also be
+ * freed.
+ *
+ * Returns: new NihSnapshot structure or NULL on raised error.
+ **/
+NihSnapshot *
+nih_snapshot_read (const void *parent,
+		   int         fd)
+{
+	NihSnapshot *     snapshot;
+	NihSnapshotReader reader;
+	struct stat       statbuf;
+	void *            map;
+	int               ret;
+
+	nih_assert (fd >= 0);
+
+	if (fstat (fd, &statbuf) < 0)
+		nih_return_system_error (NULL);
+
+	if (statbuf.st_size < NIH_SNAPSHOT_MAGIC_LEN)
+		nih_return_error (NULL, NIH_SNAPSHOT_INVALID,
+				  _(NIH_SNAPSHOT_INVALID_STR));
+
+	map = mmap (NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		nih_return_system_error (NULL);
+
+	snapshot = nih_snapshot_new (parent);
+	if (! snapshot) {
+		munmap (map, statbuf.st_size);
+		nih_return_no_memory_error (NULL);
+	}
+
+	reader.buf = map;
+	reader.len = statbuf.st_size;
+	reader.pos = 0;
+
+	ret = nih_snapshot_restore (snapshot, &reader);
+
+	munmap (map, statbuf.st_size);
+
+	if (ret < 0) {
+		nih_free (snapshot);
+		return NULL;
+	}
+
+	return snapshot;
+}
+
+/**
+ * nih_snapshot_restore:
+ * @snapshot: snapshot to restore into,
+ * @reader: reader for image.
+ *
+ * Restores the objects in the image being read by @reader into
+ * @snapshot.  This is done in several passes over the objects: first
+ * each is allocated and copied, then the members of each are restored,
+ * then lists and hash tables are filled, and finally objects are given
+ * their parents and restore functions are called.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_snapshot_restore (NihSnapshot *      snapshot,
+		      NihSnapshotReader *reader)
+{
+	nih_local const NihSnapshotType **types = NULL;
+	nih_local size_t *                extras = NULL;
+	const char *                      magic;
+	uint32_t                          pointer_size;
+	uint32_t                          num_types;
+	uint32_t                          num_objects;
+	uint32_t                          num_roots;
+	uint32_t                          i, k;
+	size_t                            j;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (reader != NULL);
+
+	magic = nih_snapshot_get_bytes (reader, NIH_SNAPSHOT_MAGIC_LEN);
+	if ((! magic)
+	    || memcmp (magic, NIH_SNAPSHOT_MAGIC, NIH_SNAPSHOT_MAGIC_LEN)
+	    || (nih_snapshot_get_u32 (reader, &pointer_size) < 0)
+	    || (pointer_size != sizeof (void *))
+	    || (nih_snapshot_get_u32 (reader, &num_types) < 0)
+	    || (nih_snapshot_get_u32 (reader, &num_objects) < 0)
+	    || (nih_snapshot_get_u32 (reader, &num_roots) < 0))
+		goto invalid;
+
+	/* Sanity check the counts against the size of the image, so we
+	 * don't try to allocate huge arrays for a corrupt one.
+	 */
+	if ((num_types > reader->len) || (num_objects > reader->len)
+	    || (num_roots > reader->len))
+		goto invalid;
+
+	types = nih_alloc (NULL, sizeof (NihSnapshotType *) * (num_types + 1));
+	if (! types)
+		nih_return_no_memory_error (-1);
+
+	for (i = 0; i < num_types; i++) {
+		const char *name;
+
+		if ((nih_snapshot_get_string (reader, &name) < 0) || (! name))
+			goto invalid;
+
+		types[i] = nih_snapshot_type_lookup (name);
+		if (! types[i])
+			nih_return_error (-1, NIH_SNAPSHOT_UNKNOWN_TYPE,
+					  _(NIH_SNAPSHOT_UNKNOWN_TYPE_STR));
+	}
+
+	extras = nih_alloc (NULL, sizeof (size_t) * (num_objects + 1));
+	if (! extras)
+		nih_return_no_memory_error (-1);
+
+	if (nih_array_reserve (snapshot->objects, num_objects) < 0)
+		nih_return_no_memory_error (-1);
+
+	/* Allocate each object as a child of the snapshot and copy its
+	 * structure, skipping over the data that follows it.
+	 */
+	for (i = 0; i < num_objects; i++) {
+		NihSnapshotObject object;
+		uint32_t          type_index;
+		uint32_t          size;
+		const void *      raw;
+
+		if ((nih_snapshot_get_u32 (reader, &type_index) < 0)
+		    || (type_index >= num_types)
+		    || (nih_snapshot_get_u32 (reader, &object.parent) < 0)
+		    || (object.parent > num_objects)
+		    || (object.parent == i + 1)
+		    || (nih_snapshot_get_u32 (reader, &object.parent_field) < 0)
+		    || (object.parent_field && (! object.parent))
+		    || (nih_snapshot_get_u32 (reader, &size) < 0))
+			goto invalid;
+
+		object.type = types[type_index];
+		if (size != object.type->size)
+			goto invalid;
+
+		raw = nih_snapshot_get_bytes (reader, size);
+		if (! raw)
+			goto invalid;
+
+		object.ptr = nih_alloc (snapshot, size);
+		if (! object.ptr)
+			nih_return_no_memory_error (-1);
+
+		memcpy (object.ptr, raw, size);
+
+		if (! nih_array_append (snapshot->objects, &object)) {
+			nih_free (object.ptr);
+			nih_return_no_memory_error (-1);
+		}
+
+		extras[i] = reader->pos;
+
+		for (j = 0; j < object.type->num_fields; j++) {
+			const NihSnapshotField *field = &object.type->fields[j];
+			const char *            str;
+			uint32_t                count;
+			size_t                  len;
+
+			switch (field->type) {
+			case NIH_SNAPSHOT_STRING:
+				if (nih_snapshot_get_string (reader, &str) < 0)
+					goto invalid;
+
+				break;
+			case NIH_SNAPSHOT_DATA:
+				memcpy (&len, (char *)object.ptr + field->link,
+					sizeof (size_t));
+
+				if ((nih_snapshot_get_u32 (reader, &count) < 0)
+				    || (count > 1)
+				    || (count && (! nih_snapshot_get_bytes (reader,
+									    len))))
+					goto invalid;
+
+				break;
+			case NIH_SNAPSHOT_HASH:
+				if (nih_snapshot_get_u32 (reader, &count) < 0)
+					goto invalid;
+				if (! count)
+					break;
+				/* fall through */
+			case NIH_SNAPSHOT_LIST:
+				if ((nih_snapshot_get_u32 (reader, &count) < 0)
+				    || (count > reader->len)
+				    || (! nih_snapshot_get_bytes (
+						reader,
+						(size_t)count * sizeof (uint32_t))))
+					goto invalid;
+
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	for (i = 0; i < num_roots; i++) {
+		NihSnapshotRoot *root;
+		NihList *        replaced;
+		const char *     name;
+		uint32_t         id;
+
+		if ((nih_snapshot_get_string (reader, &name) < 0) || (! name)
+		    || (nih_snapshot_get_u32 (reader, &id) < 0)
+		    || (! id) || (id > num_objects))
+			goto invalid;
+
+		root = nih_new (snapshot->roots, NihSnapshotRoot);
+		if (! root)
+			nih_return_no_memory_error (-1);
+
+		nih_list_init (&root->entry);
+
+		root->name = nih_strdup (root, name);
+		if (! root->name) {
+			nih_free (root);
+			nih_return_no_memory_error (-1);
+		}
+
+		root->index = id - 1;
+
+		replaced = nih_hash_replace (snapshot->roots, &root->entry);
+		if (replaced)
+			nih_free (replaced);
+	}
+
+	/* Restore the members of each object; links must all be emptied
+	 * before any lists are filled.
+	 */
+	for (i = 0; i < num_objects; i++) {
+		NihSnapshotObject *object;
+		NihSnapshotReader  data;
+
+		object = &NIH_ARRAY_INDEX (snapshot->objects,
+					   NihSnapshotObject, i);
+
+		data = *reader;
+		data.pos = extras[i];
+
+		for (j = 0; j < object->type->num_fields; j++) {
+			const NihSnapshotField *field = &object->type->fields[j];
+			char *                  member = (char *)object->ptr + field->offset;
+			const char *            str;
+			uintptr_t               id;
+			uint32_t                count;
+			size_t                  len;
+
+			switch (field->type) {
+			case NIH_SNAPSHOT_STRING:
+				nih_assert (nih_snapshot_get_string (&data, &str) == 0);
+
+				*(char **)member = NULL;
+				if (str) {
+					*(char **)member = nih_strdup (object->ptr, str);
+					if (! *(char **)member)
+						nih_return_no_memory_error (-1);
+				}
+
+				break;
+			case NIH_SNAPSHOT_DATA:
+				*(void **)member = NULL;
+
+				nih_assert (nih_snapshot_get_u32 (&data, &count) == 0);
+				if (! count)
+					break;
+
+				memcpy (&len, (char *)object->ptr + field->link,
+					sizeof (size_t));
+
+				*(void **)member = nih_alloc (object->ptr, len);
+				if (! *(void **)member)
+					nih_return_no_memory_error (-1);
+
+				memcpy (*(void **)member,
+					nih_snapshot_get_bytes (&data, len), len);
+
+				break;
+			case NIH_SNAPSHOT_POINTER:
+				memcpy (&id, member, sizeof (uintptr_t));
+				if ((id > num_objects)
+				    || (nih_snapshot_get_object (snapshot, id,
+								 field->target,
+								 (void **)member) < 0))
+					goto invalid;
+
+				break;
+			case NIH_SNAPSHOT_LINK:
+				nih_list_init ((NihList *)member);
+				break;
+			case NIH_SNAPSHOT_TREE: {
+				uintptr_t ids[3];
+				void *    links[3];
+
+				memcpy (ids, member, sizeof (ids));
+
+				for (k = 0; k < 3; k++) {
+					if ((ids[k] > num_objects)
+					    || (nih_snapshot_get_object (
+							snapshot, ids[k],
+							field->target,
+							&links[k]) < 0))
+						goto invalid;
+
+					if (links[k])
+						links[k] = (char *)links[k] + field->link;
+				}
+
+				((NihTree *)member)->parent = links[0];
+				((NihTree *)member)->left = links[1];
+				((NihTree *)member)->right = links[2];
+				break;
+			}
+			case NIH_SNAPSHOT_HASH:
+				*(NihHash **)member = NULL;
+
+				nih_assert (nih_snapshot_get_u32 (&data, &count) == 0);
+				if (! count)
+					break;
+
+				nih_assert (nih_snapshot_get_u32 (&data, &count) == 0);
+				data.pos += sizeof (uint32_t) * count;
+
+				break;
+			case NIH_SNAPSHOT_LIST:
+				nih_list_init ((NihList *)member);
+
+				nih_assert (nih_snapshot_get_u32 (&data, &count) == 0);
+				data.pos += sizeof (uint32_t) * count;
+
+				break;
+			default:
+				nih_assert_not_reached ();
+			}
+		}
+	}
+
+	/* Fill lists and hash tables */
+	for (i = 0; i < num_objects; i++) {
+		NihSnapshotObject *object;
+		NihSnapshotReader  data;
+
+		object = &NIH_ARRAY_INDEX (snapshot->objects,
+					   NihSnapshotObject, i);
+
+		data = *reader;
+		data.pos = extras[i];
+
+		for (j = 0; j < object->type->num_fields; j++) {
+			const NihSnapshotField *field = &object->type->fields[j];
+			char *                  member = (char *)object->ptr + field->offset;
+			const char *            str;
+			uint32_t                size = 0;
+			uint32_t                count;
+			NihList *               head = NULL;
+			NihHash *               hash = NULL;
+
+			switch (field->type) {
+			case NIH_SNAPSHOT_STRING:
+				nih_assert (nih_snapshot_get_string (&data, &str) == 0);
+				continue;
+			case NIH_SNAPSHOT_DATA:
+				nih_assert (nih_snapshot_get_u32 (&data, &count) == 0);
+				if (count) {
+					size_t len;
+
+					memcpy (&len, member - field->offset + field->link,
+						sizeof (size_t));
+					data.pos += len;
+				}
+
+				continue;
+			case NIH_SNAPSHOT_HASH:
+				nih_assert (nih_snapshot_get_u32 (&data, &size) == 0);
+				if (! size)
+					continue;
+
+				if (field->key_function) {
+					hash = nih_hash_new (object->ptr, size + 1,
+							     field->key_function,
+							     field->hash_function,
+							     field->cmp_function);
+				} else {
+					hash = nih_hash_string_new (object->ptr,
+								    size + 1);
+				}
+				if (! hash)
+					nih_return_no_memory_error (-1);
+
+				*(NihHash **)member = hash;
+				break;
+			case NIH_SNAPSHOT_LIST:
+				head = (NihList *)member;
+				break;
+			default:
+				continue;
+			}
+
+			nih_assert (nih_snapshot_get_u32 (&data, &count) == 0);
+
+			for (k = 0; k < count; k++) {
+				uint32_t id;
+				void *   entry;
+
+				nih_assert (nih_snapshot_get_u32 (&data, &id) == 0);
+
+				if ((! id) || (id > num_objects)
+				    || (nih_snapshot_get_object (snapshot, id,
+								 field->target,
+								 &entry) < 0))
+					goto invalid;
+
+				if (hash) {
+					nih_hash_add (hash, (NihList *)((char *)entry + field->link));
+				} else {
+					nih_list_add (head, (NihList *)((char *)entry + field->link));
+				}
+			}
+		}
+	}
+
+	/* Give objects their original parents; those children of a hash
+	 * table are made children of the restored hash table.
+	 */
+	for (i = 0; i < num_objects; i++) {
+		NihSnapshotObject *object;
+		NihSnapshotObject *parent;
+		void *             parent_ptr;
+
+		object = &NIH_ARRAY_INDEX (snapshot->objects,
+					   NihSnapshotObject, i);
+		if (! object->parent)
+			continue;
+
+		parent = &NIH_ARRAY_INDEX (snapshot->objects,
+					   NihSnapshotObject,
+					   object->parent - 1);
+		parent_ptr = parent->ptr;
+
+		if (object->parent_field) {
+			const NihSnapshotField *field;
+
+			if (object->parent_field > parent->type->num_fields)
+				goto invalid;
+
+			field = &parent->type->fields[object->parent_field - 1];
+			if (field->type != NIH_SNAPSHOT_HASH)
+				goto invalid;
+
+			parent_ptr = *(NihHash **)((char *)parent->ptr
+						   + field->offset);
+			if (! parent_ptr)
+				goto invalid;
+		}
+
+		nih_ref (object->ptr, parent_ptr);
+		nih_unref (object->ptr, snapshot);
+	}
+
+	NIH_ARRAY_FOREACH (snapshot->objects, NihSnapshotObject, object) {
+		if (object->type->restore
+		    && (object->type->restore (object->ptr) < 0))
+			return -1;
+	}
+
+	return 0;
+
+invalid:
+	nih_return_error (-1, NIH_SNAPSHOT_INVALID,
+			  _(NIH_SNAPSHOT_INVALID_STR));
+}
+
+/**
+ * nih_snapshot_get_bytes:
+ * @reader: reader to use,
+ * @len: number of bytes.
+ *
+ * Returns: pointer to the next @len bytes of the image being read by
+ * @reader, or NULL if there are not that many left.
+ **/
+static const void *
+nih_snapshot_get_bytes (NihSnapshotReader *reader,
+			size_t             len)
+{
+	const void *ptr;
+
+	nih_assert (reader != NULL);
+
+	if (len > reader->len - reader->pos)
+		return NULL;
+
+	ptr = reader->buf + reader->pos;
+	reader->pos += len;
+
+	return ptr;
+}
+
+/**
+ * nih_snapshot_get_u32:
+ * @reader: reader to use,
+ * @value: pointer to store value in.
+ *
+ * Reads the next value from the image being read by @reader.
+ *
+ * Returns: zero on success, negative value if the image is too short.
+ **/
+static int
+nih_snapshot_get_u32 (NihSnapshotReader *reader,
+		      uint32_t *         value)
+{
+	const void *ptr;
+
+	nih_assert (value != NULL);
+
+	ptr = nih_snapshot_get_bytes (reader, sizeof (uint32_t));
+	if (! ptr)
+		return -1;
+
+	memcpy (value, ptr, sizeof (uint32_t));
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_get_string:
+ * @reader: reader to use,
+ * @str: pointer to store string in.
+ *
+ * Reads the next string from the image being read by @reader, setting
+ * @str to point to it within the image, or to NULL.
+ *
+ * Returns: zero on success, negative value if the image is too short or
+ * the string is not terminated.
+ **/
+static int
+nih_snapshot_get_string (NihSnapshotReader *reader,
+			 const char **      str)
+{
+	uint32_t len;
+
+	nih_assert (str != NULL);
+
+	if (nih_snapshot_get_u32 (reader, &len) < 0)
+		return -1;
+
+	if (! len) {
+		*str = NULL;
+		return 0;
+	}
+
+	*str = nih_snapshot_get_bytes (reader, len);
+	if ((! *str) || (*str)[len - 1])
+		return -1;
+
+	return 0;
+}
+
+/**
+ * nih_snapshot_get_object:
+ * @snapshot: snapshot being restored,
+ * @id: number of object, or zero,
+ * @type: expected type of object,
+ * @ptr: pointer to store address of object in.
+ *
+ * Sets @ptr to the address of the restored object numbered @id, which
+ * must be of @type, or to NULL if @id is zero.
+ *
+ * Returns: zero on success, negative value if the object is of the wrong
+ * type.
+ **/
+static int
+nih_snapshot_get_object (NihSnapshot *          snapshot,
+			 uint32_t               id,
+			 const NihSnapshotType *type,
+			 void **                ptr)
+{
+	NihSnapshotObject *object;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (id <= snapshot->objects->len);
+	nih_assert (ptr != NULL);
+
+	if (! id) {
+		*ptr = NULL;
+		return 0;
+	}
+
+	object = &NIH_ARRAY_INDEX (snapshot->objects, NihSnapshotObject,
+				   id - 1);
+	if (object->type != type)
+		return -1;
+
+	*ptr = object->ptr;
+
+	return 0;
+}
+
+
+/**
+ * nih_snapshot_get:
+ * @snapshot: snapshot to search,
+ * @name: name of top-level object.
+ *
+ * Finds the top-level object named @name in @snapshot, as given to
+ * nih_snapshot_add() when it was written.
+ *
+ * Returns: object found or NULL if there is none named @name.
+ **/
+void *
+nih_snapshot_get (NihSnapshot *snapshot,
+		  const char * name)
+{
+	NihSnapshotRoot *root;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+
+	root = (NihSnapshotRoot *)nih_hash_lookup (snapshot->roots, name);
+	if (! root)
+		return NULL;
+
+	return NIH_ARRAY_INDEX (snapshot->objects, NihSnapshotObject,
+				root->index).ptr;
+}
+
+/**
+ * nih_snapshot_get_type:
+ * @snapshot: snapshot to search,
+ * @name: name of top-level object.
+ *
+ * Finds the type of the top-level object named @name in @snapshot, so
+ * that it may be checked before the object is used.
+ *
+ * Returns: type of object found or NULL if there is none named @name.
+ **/
+const NihSnapshotType *
+nih_snapshot_get_type (NihSnapshot *snapshot,
+		       const char * name)
+{
+	NihSnapshotRoot *root;
+
+	nih_assert (snapshot != NULL);
+	nih_assert (name != NULL);
+
+	root = (NihSnapshotRoot *)nih_hash_lookup (snapshot->roots, name);
+	if (! root)
+		return NULL;
+
+	return NIH_ARRAY_INDEX (snapshot->objects, NihSnapshotObject,
+				root->index).type;
+}
@@ -0,0 +1,241 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_SNAPSHOT_H
+#define NIH_SNAPSHOT_H
+
+/**
+ * Snapshots allow a daemon to re-exec itself, for example to upgrade in
+ * place, without rebuilding its state from scratch: graphs of nih_alloc()
+ * objects are written to a compact binary image in an anonymous memory
+ * file that is inherited across exec, and read back by the new process
+ * image.
+ *
+ * The layout of each structure is described by an NihSnapshotType, which
+ * lists the members that cannot simply be copied: strings, blocks of data,
+ * pointers to other objects, list heads and links, hash tables and tree
+ * nodes.  Every type that may be found in an image must be registered
+ * with nih_snapshot_register() in the process that reads it; structures
+ * are copied as they are, so an image can only be read by a program
+ * built with the same structure layouts.
+ *
+ * Saving state starts by creating a snapshot with nih_snapshot_new(),
+ * adding each top-level object to it by name with nih_snapshot_add(),
+ * which also adds every object reachable from it, and then writing the
+ * image with nih_snapshot_write():
+ *
+ *	snapshot = nih_snapshot_new (NULL);
+ *	nih_snapshot_add (snapshot, "jobs", &job_list_type, jobs);
+ *	fd = nih_snapshot_write (snapshot);
+ *
+ * The returned file descriptor is not closed on exec, so its number may
+ * be passed to the new process image on its command line; that then
+ * reads the image with nih_snapshot_read() and obtains its top-level
+ * objects with nih_snapshot_get():
+ *
+ *	snapshot = nih_snapshot_read (NULL, fd);
+ *	jobs = nih_snapshot_get (snapshot, "jobs");
+ *	nih_ref (jobs, NULL);
+ *	nih_free (snapshot);
+ *
+ * The nih_alloc() parent of each object is preserved when the parent is
+ * also in the image and the object was reached through one of its
+ * members, other objects are children of the snapshot.
+ **/
+
+#include <nih/macros.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/array.h>
+
+#include <stdint.h>
+
+
+/**
+ * NihSnapshotFieldType:
+ *
+ * Describes how a member of a structure is written to, and read from, a
+ * snapshot image.
+ *
+ * NIH_SNAPSHOT_STRING members are nih_alloc() allocated strings, or NULL,
+ * and are restored as children of the structure.
+ *
+ * NIH_SNAPSHOT_DATA members point to an nih_alloc() allocated block of
+ * bytes, or are NULL, whose length is held in a size_t member of the same
+ * structure; they are restored as children of the structure.
+ *
+ * NIH_SNAPSHOT_POINTER members point to an nih_alloc() allocated object,
+ * or are NULL; the object is added to the image as well.
+ *
+ * NIH_SNAPSHOT_LINK members are NihList entries by which the structure is
+ * linked into a list or hash table, and are restored empty before being
+ * added to the list or hash table they were in.
+ *
+ * NIH_SNAPSHOT_LIST members are NihList heads, whose entries are added to
+ * the image and restored into the list in the same order.
+ *
+ * NIH_SNAPSHOT_HASH members point to an NihHash, or are NULL, whose
+ * entries are added to the image and restored into a new hash table of
+ * the same size.
+ *
+ * NIH_SNAPSHOT_TREE members are NihTree nodes, the nodes they are linked
+ * to are added to the image and the links restored.
+ **/
+typedef enum nih_snapshot_field_type {
+	NIH_SNAPSHOT_STRING,
+	NIH_SNAPSHOT_DATA,
+	NIH_SNAPSHOT_POINTER,
+	NIH_SNAPSHOT_LINK,
+	NIH_SNAPSHOT_LIST,
+	NIH_SNAPSHOT_HASH,
+	NIH_SNAPSHOT_TREE,
+} NihSnapshotFieldType;
+
+typedef struct nih_snapshot_type NihSnapshotType;
+
+/**
+ * NihSnapshotField:
+ * @type: how the member is handled,
+ * @offset: offset of the member within the structure,
+ * @target: type of object pointed to or linked,
+ * @link: offset of the NihList or NihTree member within @target, or of
+ * the length member for NIH_SNAPSHOT_DATA,
+ * @key_function: function to obtain keys of hash entries,
+ * @hash_function: function to hash keys of hash entries,
+ * @cmp_function: function to compare keys of hash entries.
+ *
+ * This structure describes a single member of a structure that cannot be
+ * copied as it is.  @target is required for all but NIH_SNAPSHOT_STRING,
+ * NIH_SNAPSHOT_DATA and NIH_SNAPSHOT_LINK members, and @link for all but
+ * NIH_SNAPSHOT_STRING, NIH_SNAPSHOT_POINTER and NIH_SNAPSHOT_LINK members.
+ *
+ * The functions are only used for NIH_SNAPSHOT_HASH members, since the
+ * addresses of functions in the new process image may differ; when
+ * @key_function is NULL, the hash is restored with nih_hash_string_new().
+ **/
+typedef struct nih_snapshot_field {
+	NihSnapshotFieldType   type;
+	size_t                 offset;
+	const NihSnapshotType *target;
+	size_t                 link;
+
+	NihKeyFunction         key_function;
+	NihHashFunction        hash_function;
+	NihCmpFunction         cmp_function;
+} NihSnapshotField;
+
+/**
+ * NihSnapshotRestore:
+ * @ptr: restored object.
+ *
+ * A restore function is called for each object of a type once all of the
+ * objects in an image have been restored, and may be used to set members
+ * that are not held in the image such as function pointers or file
+ * descriptors, and to set destructors.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+typedef int (*NihSnapshotRestore) (void *ptr);
+
+/**
+ * NihSnapshotType:
+ * @name: unique name of type,
+ * @size: size of structure,
+ * @fields: array of members that cannot be copied,
+ * @num_fields: number of entries in @fields,
+ * @restore: function to call for restored objects.
+ *
+ * This structure describes a type of object that may be held in a
+ * snapshot image, @name is written to the image and used to find the type
+ * again when reading it so must be unique; including a version number in
+ * the name allows a program to refuse images with an older layout.
+ *
+ * Members of the structure that are not listed in @fields are copied as
+ * they are, so must not contain pointers or other values only meaningful
+ * to the process writing the image unless @restore replaces them.
+ **/
+struct nih_snapshot_type {
+	const char             *name;
+	size_t                  size;
+	const NihSnapshotField *fields;
+	size_t                  num_fields;
+
+	NihSnapshotRestore      restore;
+};
+
+/**
+ * NihSnapshot:
+ * @objects: objects in the image,
+ * @addresses: index of @objects by address,
+ * @roots: top-level objects by name.
+ *
+ * This structure represents a snapshot being written, or one that has
+ * been read.  @objects is an array of NihSnapshotObject structures in the
+ * order they are found in the image.
+ **/
+typedef struct nih_snapshot {
+	NihArray *objects;
+	NihHash  *addresses;
+	NihHash  *roots;
+} NihSnapshot;
+
+/**
+ * NihSnapshotObject:
+ * @ptr: address of object,
+ * @type: type of object,
+ * @parent: index of parent object plus one, or zero,
+ * @parent_field: index of hash table member of parent plus one, or zero.
+ *
+ * This structure records an object in a snapshot.  When @parent_field is
+ * not zero, the object is a child of the hash table held in that member
+ * of its parent rather than of the parent itself.
+ **/
+typedef struct nih_snapshot_object {
+	void                  *ptr;
+	const NihSnapshotType *type;
+	uint32_t               parent;
+	uint32_t               parent_field;
+} NihSnapshotObject;
+
+
+NIH_BEGIN_EXTERN
+
+int                    nih_snapshot_register (const NihSnapshotType *type)
+	__attribute__ ((warn_unused_result));
+
+NihSnapshot *          nih_snapshot_new      (const void *parent)
+	__attribute__ ((warn_unused_result, malloc));
+
+int                    nih_snapshot_add      (NihSnapshot *snapshot,
+					      const char *name,
+					      const NihSnapshotType *type,
+					      void *ptr)
+	__attribute__ ((warn_unused_result));
+int                    nih_snapshot_write    (NihSnapshot *snapshot)
+	__attribute__ ((warn_unused_result));
+
+NihSnapshot *          nih_snapshot_read     (const void *parent, int fd)
+	__attribute__ ((warn_unused_result, malloc));
+void *                 nih_snapshot_get      (NihSnapshot *snapshot,
+					      const char *name);
+const NihSnapshotType *nih_snapshot_get_type (NihSnapshot *snapshot,
+					      const char *name);
+
+NIH_END_EXTERN
+
+#endif /* NIH_SNAPSHOT_H */
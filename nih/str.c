@@ -0,0 +1,154 @@
+/* libnih
+ *
+ * str.c - shared immutable strings
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/logging.h>
+
+#include "str.h"
+
+
+/**
+ * NIH_STR_LEN_OFFSET:
+ * @_len: length of string.
+ *
+ * Expands to the offset of the stored length from the start of a string
+ * of @_len characters, leaving room for the terminating NULL and
+ * aligning it.
+ **/
+#define NIH_STR_LEN_OFFSET(_len)					\
+	(NIH_ALIGN_SIZE * (((_len) / NIH_ALIGN_SIZE) + 1))
+
+/**
+ * NIH_STR_LEN:
+ * @_str: shared string.
+ *
+ * Expands to the stored length at the end of the block holding @_str.
+ **/
+#define NIH_STR_LEN(_str)						\
+	(*(size_t *)((char *)(_str) + nih_alloc_size (_str)		\
+		     - sizeof (size_t)))
+
+
+/**
+ * nih_lstr_newn:
+ * @parent: parent object for string,
+ * @str: string to copy,
+ * @len: length of @str.
+ *
+ * Allocates a shared string holding the first @len characters of @str,
+ * which need not be NULL-terminated.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the returned string will also be
+ * freed.
+ *
+ * Returns: shared string or NULL if insufficient memory.
+ **/
+NihStr *
+nih_lstr_newn (const void *parent,
+	       const char *str,
+	       size_t      len)
+{
+	NihStr *new_str;
+
+	nih_assert (str != NULL);
+
+	new_str = nih_alloc (parent, NIH_STR_LEN_OFFSET (len) + sizeof (size_t));
+	if (! new_str)
+		return NULL;
+
+	memcpy (new_str, str, len);
+	new_str[len] = '\0';
+
+	NIH_STR_LEN (new_str) = len;
+
+	return new_str;
+}
+
+/**
+ * nih_lstr_new:
+ * @parent: parent object for string,
+ * @str: string to copy.
+ *
+ * Allocates a shared string equal to @str.  To share an existing shared
+ * string rather than copying it, use nih_lstr_ref().
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the returned string will also be
+ * freed.
+ *
+ * Returns: shared string or NULL if insufficient memory.
+ **/
+NihStr *
+nih_lstr_new (const void *parent,
+	      const char *str)
+{
+	nih_assert (str != NULL);
+
+	return nih_lstr_newn (parent, str, strlen (str));
+}
+
+/**
+ * nih_lstr_ref:
+ * @parent: new parent object for string,
+ * @str: shared string.
+ *
+ * Shares @str with @parent by adding a reference to it from @parent,
+ * rather than copying it; the string will not be freed until @parent,
+ * and all of its other parents, are freed or drop their references.
+ *
+ * Returns: @str.
+ **/
+NihStr *
+nih_lstr_ref (const void *parent,
+	      NihStr *    str)
+{
+	nih_assert (parent != NULL);
+	nih_assert (str != NULL);
+
+	nih_ref (str, parent);
+
+	return str;
+}
+
+
+/**
+ * nih_lstr_len:
+ * @str: shared string.
+ *
+ * Returns: length of @str, without the cost of strlen().
+ **/
+size_t
+nih_lstr_len (const NihStr *str)
+{
+	nih_assert (str != NULL);
+
+	return NIH_STR_LEN (str);
+}
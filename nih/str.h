@@ -0,0 +1,72 @@
+/* libnih
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef NIH_STR_H
+#define NIH_STR_H
+
+/**
+ * Shared strings are immutable strings allocated with nih_alloc() that
+ * carry their length with them.  Rather than each object that needs the
+ * string taking its own copy with nih_strdup(), the string is shared by
+ * adding a reference to it from each object with nih_lstr_ref(), and it
+ * is freed along with the last of them.
+ *
+ * A pointer to an NihStr is a pointer to its NULL-terminated characters,
+ * so it may be used anywhere an ordinary string may be, including as an
+ * nih_alloc() parent, and converted back with nih_strdup() if a private
+ * copy that may be modified is needed.
+ *
+ * Since shared strings may have many parents, they must be released with
+ * nih_unref() or nih_discard() rather than nih_free(), and they must
+ * never be modified or passed to nih_realloc().
+ *
+ * The length of a shared string is stored with it and returned by
+ * nih_lstr_len() without counting the characters.  It's kept after the
+ * characters rather than before them, because the string has to begin
+ * at the start of its nih_alloc() block.
+ *
+ * Equal strings are not merged; use nih_atom() where each distinct string
+ * should be stored only once.
+ **/
+
+#include <nih/macros.h>
+
+
+/**
+ * NihStr:
+ *
+ * Type of a shared string, used in place of char to indicate that the
+ * string may be shared and must not be modified.
+ **/
+typedef char NihStr;
+
+
+NIH_BEGIN_EXTERN
+
+NihStr *nih_lstr_new  (const void *parent, const char *str)
+	__attribute__ ((warn_unused_result, malloc));
+NihStr *nih_lstr_newn (const void *parent, const char *str, size_t len)
+	__attribute__ ((warn_unused_result, malloc));
+
+NihStr *nih_lstr_ref  (const void *parent, NihStr *str);
+
+size_t  nih_lstr_len  (const NihStr *str);
+
+NIH_END_EXTERN
+
+#endif /* NIH_STR_H */
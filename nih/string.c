@@ -39,6 +39,15 @@
 #include "string.h"
 
 
+/**
+ * NIH_SPRINTF_BUFSIZ:
+ *
+ * Size of the buffer on the stack that nih_vsprintf() formats into first,
+ * large enough for most messages so that they are only formatted once.
+ **/
+#define NIH_SPRINTF_BUFSIZ 256
+
+
 /**
  * nih_sprintf:
  * @parent: parent object for new string,
@@ -94,12 +103,17 @@ nih_vsprintf (const void *parent,
 {
 	ssize_t   len;
 	va_list   args_copy;
+	char      buf[NIH_SPRINTF_BUFSIZ];
 	char     *str;
 
 	nih_assert (format != NULL);
 
+	/* Format into the buffer on the stack, which also tells us the
+	 * length; only if the string didn't fit do we need to format it
+	 * a second time into the allocated string.
+	 */
 	va_copy (args_copy, args);
-	len = vsnprintf (NULL, 0, format, args_copy);
+	len = vsnprintf (buf, sizeof (buf), format, args_copy);
 	va_end (args_copy);
 
 	nih_assert (len >= 0);
@@ -108,9 +122,13 @@ nih_vsprintf (const void *parent,
 	if (! str)
 		return NULL;
 
-	va_copy (args_copy, args);
-	vsnprintf (str, len + 1, format, args_copy);
-	va_end (args_copy);
+	if ((size_t)len < sizeof (buf)) {
+		memcpy (str, buf, len + 1);
+	} else {
+		va_copy (args_copy, args);
+		vsnprintf (str, len + 1, format, args_copy);
+		va_end (args_copy);
+	}
 
 	return str;
 }
@@ -324,6 +342,15 @@ nih_strcat_sprintf (char       **str,
  * When the string pointed to by @str is not NULL, @parent is ignored;
  * though it usual to pass a parent of @str for style reasons.
  *
+ * The string is formatted in the same manner as nih_vsprintf() before
+ * being copied into any unused space at the end of @str, so the arguments
+ * may safely point into @str itself.  When @str has to be grown its size
+ * is at least doubled, so that repeated calls to build up a string only
+ * occasionally need to allocate.  The trade-off is that a string built up
+ * this way may use up to twice the memory it needs; callers that keep
+ * such a string around for a long time can give the slack back with
+ * nih_realloc() once it is complete.
+ *
  * Returns: new string pointer or NULL if insufficient memory.
  **/
 char *
@@ -332,32 +359,66 @@ nih_strcat_vsprintf (char       **str,
 		     const char  *format,
 		     va_list      args)
 {
-	ssize_t   len, str_len;
-	va_list   args_copy;
-	char     *ret;
+	ssize_t         len;
+	size_t          str_len, size;
+	va_list         args_copy;
+	char            buf[NIH_SPRINTF_BUFSIZ];
+	nih_local char *tmp = NULL;
+	const char     *src;
+	char           *ret;
 
 	nih_assert (str != NULL);
 	nih_assert (format != NULL);
 
-	str_len = *str ? strlen (*str) : 0;
+	if (! *str) {
+		*str = nih_vsprintf (parent, format, args);
+		return *str;
+	}
 
+	/* Format into the buffer on the stack, or a temporary string when
+	 * it doesn't fit, rather than straight into the space after @str;
+	 * the arguments may point into @str, and must not be overwritten
+	 * or moved by nih_realloc() before they have been read.
+	 */
 	va_copy (args_copy, args);
-	len = vsnprintf (NULL, 0, format, args_copy);
+	len = vsnprintf (buf, sizeof (buf), format, args_copy);
 	va_end (args_copy);
 
 	nih_assert (len >= 0);
 
-	ret = nih_realloc (*str, parent, str_len + len + 1);
-	if (! ret)
-		return NULL;
+	if ((size_t)len < sizeof (buf)) {
+		src = buf;
+	} else {
+		tmp = nih_alloc (NULL, len + 1);
+		if (! tmp)
+			return NULL;
 
-	*str = ret;
+		va_copy (args_copy, args);
+		vsnprintf (tmp, len + 1, format, args_copy);
+		va_end (args_copy);
 
-	va_copy (args_copy, args);
-	vsnprintf (*str + str_len, len + 1, format, args_copy);
-	va_end (args_copy);
+		src = tmp;
+	}
 
-	return ret;
+	/* Grow the string if the result doesn't fit in the space already
+	 * allocated after it, reserving space for further calls.
+	 */
+	str_len = strlen (*str);
+	size = nih_alloc_size (*str);
+
+	if (str_len + (size_t)len + 1 > size) {
+		ret = nih_realloc (*str, parent,
+				   nih_max (str_len + (size_t)len + 1,
+					    size * 2));
+		if (! ret)
+			return NULL;
+
+		*str = ret;
+	}
+
+	memcpy (*str + str_len, src, len + 1);
+
+	return *str;
 }
 
 
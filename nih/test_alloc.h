@@ -298,4 +298,103 @@ _test_free_tag (void *ptr)
 		TEST_FAILED ("block %p (%s) freed unexpectedly", \
 			     (_ptr), #_ptr)
 
+
+/**
+ * _test_budget_allocs:
+ *
+ * Number of allocations made within the TEST_ALLOC_BUDGET block.
+ **/
+static size_t _test_budget_allocs = 0;
+
+/**
+ * _test_budget_bytes:
+ *
+ * Number of bytes allocated within the TEST_ALLOC_BUDGET block.
+ **/
+static size_t _test_budget_bytes = 0;
+
+/**
+ * _test_budget_next_malloc:
+ *
+ * malloc() function in use before the TEST_ALLOC_BUDGET block.
+ **/
+static void *(*_test_budget_next_malloc)(size_t size) = NULL;
+
+/**
+ * _test_budget_next_realloc:
+ *
+ * realloc() function in use before the TEST_ALLOC_BUDGET block.
+ **/
+static void *(*_test_budget_next_realloc)(void *ptr, size_t size) = NULL;
+
+/**
+ * _test_budget_realloc:
+ *
+ * realloc() wrapper used by TEST_ALLOC_BUDGET.
+ *
+ * Counts the call and the number of bytes requested, and passes the call
+ * on to the function in use before the block so that it may be combined
+ * with TEST_ALLOC_FAIL.
+ **/
+static inline __attribute__ ((used)) void *
+_test_budget_realloc (void   *ptr,
+		      size_t  size)
+{
+	_test_budget_allocs++;
+	_test_budget_bytes += size;
+
+	return _test_budget_next_realloc (ptr, size);
+}
+
+/**
+ * _test_budget_malloc:
+ *
+ * malloc() wrapper used by TEST_ALLOC_BUDGET.
+ **/
+static inline __attribute__ ((used)) void *
+_test_budget_malloc (size_t size)
+{
+	_test_budget_allocs++;
+	_test_budget_bytes += size;
+
+	return _test_budget_next_malloc (size);
+}
+
+/**
+ * TEST_ALLOC_BUDGET:
+ * @_allocs: maximum number of allocations,
+ * @_bytes: maximum number of bytes allocated.
+ *
+ * This macro expands to code that runs the following block once, counting
+ * the calls made to allocate or reallocate memory through nih_alloc()
+ * and the total number of bytes requested; the test fails if either
+ * exceeds the budget given.  A budget of zero allocations can be used to
+ * ensure a code path never allocates.
+ *
+ * This may be used within a TEST_ALLOC_FAIL block, but cannot be nested
+ * within another TEST_ALLOC_BUDGET block.
+ **/
+#define TEST_ALLOC_BUDGET(_allocs, _bytes)				\
+	for (int _test_alloc_budget = 0; _test_alloc_budget < 3;	\
+	     _test_alloc_budget++)					\
+		if (_test_alloc_budget < 1) {				\
+			_test_budget_allocs = 0;			\
+			_test_budget_bytes = 0;				\
+			_test_budget_next_malloc = __nih_malloc;	\
+			_test_budget_next_realloc = __nih_realloc;	\
+			__nih_malloc = _test_budget_malloc;		\
+			__nih_realloc = _test_budget_realloc;		\
+		} else if (_test_alloc_budget > 1) {			\
+			__nih_malloc = _test_budget_next_malloc;	\
+			__nih_realloc = _test_budget_next_realloc;	\
+			if (_test_budget_allocs > (size_t)(_allocs))	\
+				TEST_FAILED ("too many allocations, expected at most %zu got %zu", \
+					     (size_t)(_allocs),		\
+					     _test_budget_allocs);	\
+			if (_test_budget_bytes > (size_t)(_bytes))	\
+				TEST_FAILED ("too many bytes allocated, expected at most %zu got %zu", \
+					     (size_t)(_bytes),		\
+					     _test_budget_bytes);	\
+		} else
+
 #endif /* NIH_TEST_ALLOC_H */
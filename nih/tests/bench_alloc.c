@@ -0,0 +1,203 @@
+/* libnih
+ *
+ * bench_alloc.c - benchmark allocator
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+
+
+static void
+bench_alloc (void)
+{
+	void *ptr;
+	void *parent;
+
+	BENCH_GROUP ("nih_alloc");
+
+	BENCH ("nih_alloc_free", 100000) {
+		ptr = nih_alloc (NULL, 64);
+		nih_free (ptr);
+	}
+
+	parent = nih_alloc (NULL, 1);
+
+	BENCH ("nih_alloc_free_child", 100000) {
+		ptr = nih_alloc (parent, 64);
+		nih_free (ptr);
+	}
+
+	BENCH ("nih_ref_unref", 100000) {
+		nih_ref (parent, parent);
+		nih_unref (parent, parent);
+	}
+
+	nih_free (parent);
+}
+
+static void
+bench_tree (void)
+{
+	void *root;
+	void *node;
+	int   i;
+	int   j;
+
+	BENCH_GROUP ("nih_alloc trees");
+
+	/* A wide and shallow tree, like a hash table of entries each
+	 * with a few strings.
+	 */
+	BENCH ("tree_wide_1000x4", 100) {
+		root = nih_alloc (NULL, 64);
+		for (i = 0; i < 1000; i++) {
+			node = nih_alloc (root, 64);
+			for (j = 0; j < 4; j++)
+				NIH_MUST (nih_alloc (node, 16));
+		}
+
+		nih_free (root);
+	}
+
+	/* A deep tree, like a chain of nested structures. */
+	BENCH ("tree_deep_5000", 100) {
+		root = node = nih_alloc (NULL, 64);
+		for (i = 0; i < 5000; i++)
+			node = nih_alloc (node, 32);
+
+		nih_free (root);
+	}
+
+	BENCH ("tree_wide_1000x4_deferred", 100) {
+		root = nih_alloc (NULL, 64);
+		for (i = 0; i < 1000; i++) {
+			node = nih_alloc (root, 64);
+			for (j = 0; j < 4; j++)
+				NIH_MUST (nih_alloc (node, 16));
+		}
+
+		nih_free_deferred (root);
+		while (nih_alloc_reclaim (NIH_ALLOC_RECLAIM_SLICE))
+			;
+	}
+}
+
+
+#if ENABLE_THREADING
+/**
+ * THREAD_ITERATIONS:
+ *
+ * Number of objects allocated and freed by each thread.
+ **/
+#define THREAD_ITERATIONS 200000
+
+
+/**
+ * shared_parent:
+ *
+ * Parent used by all threads in the shared case, or NULL.
+ **/
+static void *shared_parent = NULL;
+
+
+static void *
+worker (void *arg)
+{
+	void *parent;
+	int   i;
+
+	parent = shared_parent ?: NIH_MUST (nih_alloc (NULL, 1));
+
+	for (i = 0; i < THREAD_ITERATIONS; i++) {
+		void *ptr;
+
+		ptr = NIH_MUST (nih_alloc (parent, 64));
+		nih_free (ptr);
+	}
+
+	if (parent != shared_parent)
+		nih_free (parent);
+
+	return NULL;
+}
+
+static void
+bench_threads (const char *name,
+	       int         nthreads,
+	       int         shared)
+{
+	struct timespec start;
+	char            label[64];
+	double          ns;
+	int             i;
+	pthread_t       threads[nthreads];
+
+	shared_parent = shared ? NIH_MUST (nih_alloc (NULL, 1)) : NULL;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < nthreads; i++)
+		NIH_ZERO (pthread_create (&threads[i], NULL, worker, NULL));
+	for (i = 0; i < nthreads; i++)
+		NIH_ZERO (pthread_join (threads[i], NULL));
+
+	ns = _bench_elapsed (&start);
+
+	if (shared_parent)
+		nih_free (shared_parent);
+
+	/* Report wall-clock time per operation over all threads, so that
+	 * perfect scaling shows as a time divided by the thread count.
+	 */
+	snprintf (label, sizeof (label), "%s/%d", name, nthreads);
+	BENCH_REPORT (label, (size_t)nthreads * THREAD_ITERATIONS,
+		      ns / ((double)nthreads * THREAD_ITERATIONS), 0, 0);
+}
+#endif /* ENABLE_THREADING */
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+#if ENABLE_THREADING
+	static const int nthreads[] = { 1, 4, 16 };
+	int              i;
+
+	nih_alloc_set_thread_safe (TRUE);
+#endif /* ENABLE_THREADING */
+
+	bench_alloc ();
+	bench_tree ();
+
+#if ENABLE_THREADING
+	BENCH_GROUP ("nih_alloc threads");
+	for (i = 0; i < 3; i++)
+		bench_threads ("threads_private_parent", nthreads[i], FALSE);
+	for (i = 0; i < 3; i++)
+		bench_threads ("threads_shared_parent", nthreads[i], TRUE);
+#endif /* ENABLE_THREADING */
+
+	return 0;
+}
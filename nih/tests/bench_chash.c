@@ -0,0 +1,226 @@
+/* libnih
+ *
+ * bench_chash.c - benchmarks for nih/chash.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/chash.h>
+#include <nih/string.h>
+
+
+/**
+ * NUM_KEYS:
+ *
+ * Number of keys in each table.
+ **/
+#define NUM_KEYS 1024
+
+/**
+ * THREAD_ITERATIONS:
+ *
+ * Number of lookups made by each thread.
+ **/
+#define THREAD_ITERATIONS 1000000
+
+
+typedef struct entry {
+	NihList  list;
+	char    *key;
+} Entry;
+
+
+static NihHash  *hash = NULL;
+static NihCHash *chash = NULL;
+static char     *keys[NUM_KEYS];
+
+#if ENABLE_THREADING
+static int             writing = FALSE;
+static pthread_mutex_t hash_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* ENABLE_THREADING */
+
+
+static void *
+hash_reader (void *arg)
+{
+	size_t i;
+
+	for (i = 0; i < THREAD_ITERATIONS; i++) {
+#if ENABLE_THREADING
+		pthread_mutex_lock (&hash_lock);
+#endif /* ENABLE_THREADING */
+		nih_hash_lookup (hash, keys[i % NUM_KEYS]);
+#if ENABLE_THREADING
+		pthread_mutex_unlock (&hash_lock);
+#endif /* ENABLE_THREADING */
+	}
+
+	return NULL;
+}
+
+static void *
+chash_reader (void *arg)
+{
+	size_t i;
+
+	for (i = 0; i < THREAD_ITERATIONS; i++) {
+		nih_chash_read_lock ();
+		nih_chash_lookup (chash, keys[i % NUM_KEYS]);
+		nih_chash_read_unlock ();
+	}
+
+	return NULL;
+}
+
+#if ENABLE_THREADING
+static void *
+chash_writer (void *arg)
+{
+	size_t i = 0;
+
+	while (__atomic_load_n (&writing, __ATOMIC_ACQUIRE)) {
+		char *value;
+
+		value = NIH_MUST (nih_strdup (NULL, keys[i % NUM_KEYS]));
+		NIH_ZERO (nih_chash_add (chash, keys[i % NUM_KEYS], value));
+		nih_discard (value);
+
+		i++;
+	}
+
+	return NULL;
+}
+#endif /* ENABLE_THREADING */
+
+
+static void
+bench_threads (const char *name,
+	       void *(*reader)(void *),
+	       int         nthreads,
+	       int         writer)
+{
+	struct timespec start;
+	char            label[64];
+	double          ns;
+	int             i;
+#if ENABLE_THREADING
+	pthread_t       threads[nthreads];
+	pthread_t       writer_thread;
+
+	if (writer) {
+		writing = TRUE;
+		NIH_ZERO (pthread_create (&writer_thread, NULL,
+					  chash_writer, NULL));
+	}
+#endif /* ENABLE_THREADING */
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+#if ENABLE_THREADING
+	for (i = 0; i < nthreads; i++)
+		NIH_ZERO (pthread_create (&threads[i], NULL, reader, NULL));
+	for (i = 0; i < nthreads; i++)
+		NIH_ZERO (pthread_join (threads[i], NULL));
+#else /* ENABLE_THREADING */
+	for (i = 0; i < nthreads; i++)
+		reader (NULL);
+#endif /* ENABLE_THREADING */
+
+	ns = _bench_elapsed (&start);
+
+#if ENABLE_THREADING
+	if (writer) {
+		__atomic_store_n (&writing, FALSE, __ATOMIC_RELEASE);
+		NIH_ZERO (pthread_join (writer_thread, NULL));
+	}
+#endif /* ENABLE_THREADING */
+
+	/* Report wall-clock time per lookup over all threads, so that
+	 * perfect scaling shows as a time divided by the thread count.
+	 */
+	snprintf (label, sizeof (label), "%s/%d", name, nthreads);
+	BENCH_REPORT (label, (size_t)nthreads * THREAD_ITERATIONS,
+		      ns / ((double)nthreads * THREAD_ITERATIONS), 0, 0);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	int nthreads[5] = { 1, 2, 4, 8, 0 };
+	int ncpus;
+	int i;
+
+#if ENABLE_THREADING
+	nih_alloc_set_thread_safe (TRUE);
+#endif /* ENABLE_THREADING */
+
+	hash = NIH_MUST (nih_hash_string_new (NULL, NUM_KEYS));
+	chash = NIH_MUST (nih_chash_new (NULL, NUM_KEYS));
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		Entry *entry;
+
+		entry = NIH_MUST (nih_new (hash, Entry));
+		nih_list_init (&entry->list);
+		entry->key = NIH_MUST (nih_sprintf (entry, "entry-%d", i));
+		nih_hash_add (hash, &entry->list);
+
+		keys[i] = entry->key;
+		NIH_ZERO (nih_chash_add (chash, entry->key, entry->key));
+	}
+
+	/* Include the number of processors online if it's not already
+	 * one of the thread counts.
+	 */
+	ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+	if ((ncpus != 1) && (ncpus != 2) && (ncpus != 4) && (ncpus != 8))
+		nthreads[4] = ncpus;
+
+	BENCH_GROUP ("NihHash with mutex");
+	for (i = 0; i < 5 && nthreads[i]; i++)
+		bench_threads ("hash_lookup_locked", hash_reader,
+			       nthreads[i], FALSE);
+
+	BENCH_GROUP ("NihCHash");
+	for (i = 0; i < 5 && nthreads[i]; i++)
+		bench_threads ("chash_lookup", chash_reader,
+			       nthreads[i], FALSE);
+#if ENABLE_THREADING
+	for (i = 0; i < 5 && nthreads[i]; i++)
+		bench_threads ("chash_lookup_with_writer", chash_reader,
+			       nthreads[i], TRUE);
+#endif /* ENABLE_THREADING */
+
+	nih_free (chash);
+	nih_free (hash);
+
+	return 0;
+}
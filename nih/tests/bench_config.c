@@ -0,0 +1,138 @@
+/* libnih
+ *
+ * bench_config.c - benchmark configuration parsing
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/config.h>
+#include <nih/error.h>
+
+
+static int
+handle_exec (void *data, NihConfigStanza *stanza,
+	     const char *file, size_t len, size_t *pos, size_t *lineno)
+{
+	nih_local char **args = NULL;
+
+	args = nih_config_parse_args (NULL, file, len, pos, lineno);
+	if (! args)
+		return -1;
+
+	return 0;
+}
+
+static int
+handle_script (void *data, NihConfigStanza *stanza,
+	       const char *file, size_t len, size_t *pos, size_t *lineno)
+{
+	size_t endpos;
+
+	if (nih_config_skip_comment (file, len, pos, lineno) < 0)
+		return -1;
+
+	if (nih_config_skip_block (file, len, pos, lineno,
+				   "script", &endpos) < 0)
+		return -1;
+
+	return 0;
+}
+
+static NihConfigStanza stanzas[] = {
+	{ "exec",        handle_exec },
+	{ "env",         handle_exec },
+	{ "description", handle_exec },
+	{ "script",      handle_script },
+
+	NIH_CONFIG_LAST
+};
+
+
+/**
+ * generate:
+ * @stanzas: number of stanzas.
+ *
+ * Generates a configuration file with @stanzas groups of stanzas, with
+ * a mixture of comments, quoted arguments and blocks.
+ *
+ * Returns: newly allocated file contents.
+ **/
+static char *
+generate (size_t nstanzas)
+{
+	char   *file = NULL;
+	size_t  i;
+
+	for (i = 0; i < nstanzas; i++)
+		NIH_MUST (nih_strcat_sprintf (
+				  &file, NULL,
+				  "# Stanza group %zu\n"
+				  "description \"Generated job %zu\"\n"
+				  "env PATH=/usr/sbin:/usr/bin KEY%zu=value\n"
+				  "exec /usr/sbin/daemon --arg %zu \\\n"
+				  "    --config \"/etc/daemon/%zu.conf\"\n"
+				  "script\n"
+				  "    echo starting %zu\n"
+				  "    exec /usr/sbin/daemon\n"
+				  "end script\n"
+				  "\n", i, i, i, i, i, i));
+
+	return file;
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	static const size_t sizes[] = { 10, 100, 1000 };
+	char                name[64];
+	char               *file;
+	size_t              len;
+	int                 i;
+
+	BENCH_GROUP ("nih_config_parse_file");
+
+	for (i = 0; i < 3; i++) {
+		file = generate (sizes[i]);
+		len = strlen (file);
+
+		snprintf (name, sizeof (name), "nih_config_parse_file/%zu",
+			  sizes[i]);
+		BENCH (name, 10) {
+			if (nih_config_parse_file (file, len, NULL, NULL,
+						   stanzas, NULL) < 0) {
+				NihError *err;
+
+				err = nih_error_get ();
+				fprintf (stderr, "%s\n", err->message);
+				exit (1);
+			}
+		}
+
+		nih_free (file);
+	}
+
+	return 0;
+}
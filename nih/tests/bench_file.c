@@ -0,0 +1,161 @@
+/* libnih
+ *
+ * bench_file.c - benchmark path filters
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/file.h>
+
+
+/**
+ * suffixes:
+ *
+ * Endings of the generated file names, mostly of files that are not
+ * ignored as is typical of a configuration directory.
+ **/
+static const char *suffixes[] = {
+	".conf", ".conf", ".conf", ".conf", ".override", "", ".d",
+	".conf~", ".conf.dpkg-old", ".conf.swp", ",v",
+};
+
+static const size_t nsuffixes = sizeof (suffixes) / sizeof (suffixes[0]);
+
+static int matched = 0;
+
+static int
+ignore_filter (void       *data,
+	       const char *path,
+	       int         is_dir)
+{
+	return nih_file_ignore (data, path);
+}
+
+static int
+count_visitor (void        *data,
+	       const char  *dirname,
+	       const char  *path,
+	       struct stat *statbuf)
+{
+	matched++;
+	return 0;
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	NihFileGlob *glob;
+	char **      paths;
+	size_t       npaths = 10000;
+	char         dirname[] = "/tmp/bench_file.XXXXXX";
+	char         filename[PATH_MAX];
+	size_t       i, j;
+
+	glob = NIH_MUST (nih_file_glob_new (NULL));
+	NIH_ZERO (nih_file_glob_add_ignore (glob));
+
+	paths = NIH_MUST (nih_alloc (NULL, sizeof (char *) * npaths));
+	for (i = 0; i < npaths; i++)
+		paths[i] = NIH_MUST (nih_sprintf (
+				paths, "/etc/init/service-%zu/job%zu%s",
+				i / 100, i,
+				suffixes[i % nsuffixes]));
+
+	BENCH_GROUP ("path filter");
+
+	BENCH ("nih_file_ignore", npaths)
+		nih_file_ignore (NULL, paths[bench_iteration]);
+
+	BENCH ("nih_file_glob_match", npaths)
+		nih_file_glob_match (glob, paths[bench_iteration]);
+
+	/* Walk a tree of a hundred directories of a hundred files each
+	 * with each filter.
+	 */
+	if (! mkdtemp (dirname)) {
+		perror (dirname);
+		return 1;
+	}
+
+	for (i = 0; i < 100; i++) {
+		snprintf (filename, sizeof (filename), "%s/dir%zu",
+			  dirname, i);
+		if (mkdir (filename, 0755) < 0) {
+			perror (filename);
+			return 1;
+		}
+
+		for (j = 0; j < 100; j++) {
+			int fd;
+
+			snprintf (filename, sizeof (filename),
+				  "%s/dir%zu/file%zu%s", dirname, i, j,
+				  suffixes[j % nsuffixes]);
+			fd = open (filename, O_CREAT | O_WRONLY, 0644);
+			if (fd < 0) {
+				perror (filename);
+				return 1;
+			}
+
+			close (fd);
+		}
+	}
+
+	BENCH_GROUP ("nih_dir_walk");
+
+	BENCH ("nih_dir_walk_ignore", 1)
+		NIH_ZERO (nih_dir_walk (dirname, ignore_filter,
+					count_visitor, NULL, NULL));
+
+	BENCH ("nih_dir_walk_glob", 1)
+		NIH_ZERO (nih_dir_walk (dirname, nih_file_glob_filter,
+					count_visitor, NULL, glob));
+
+	for (i = 0; i < 100; i++) {
+		for (j = 0; j < 100; j++) {
+			snprintf (filename, sizeof (filename),
+				  "%s/dir%zu/file%zu%s", dirname, i, j,
+				  suffixes[j % nsuffixes]);
+			unlink (filename);
+		}
+
+		snprintf (filename, sizeof (filename), "%s/dir%zu",
+			  dirname, i);
+		rmdir (filename);
+	}
+
+	rmdir (dirname);
+
+	nih_free (paths);
+	nih_free (glob);
+
+	return 0;
+}
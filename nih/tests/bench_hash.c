@@ -0,0 +1,91 @@
+/* libnih
+ *
+ * bench_hash.c - benchmark hash tables
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#include <stdio.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/string.h>
+
+
+typedef struct entry {
+	NihList  list;
+	char    *key;
+} Entry;
+
+
+static void
+bench_size (size_t size)
+{
+	NihHash  *hash;
+	Entry   **entries;
+	char    **misses;
+	char      name[64];
+	size_t    i;
+
+	hash = NIH_MUST (nih_hash_string_new (NULL, size));
+	entries = NIH_MUST (nih_alloc (hash, sizeof (Entry *) * size));
+	misses = NIH_MUST (nih_alloc (hash, sizeof (char *) * size));
+
+	for (i = 0; i < size; i++) {
+		entries[i] = NIH_MUST (nih_new (hash, Entry));
+		nih_list_init (&entries[i]->list);
+		entries[i]->key = NIH_MUST (nih_sprintf (entries[i],
+							 "entry-%zu", i));
+
+		misses[i] = NIH_MUST (nih_sprintf (misses, "missing-%zu", i));
+	}
+
+	snprintf (name, sizeof (name), "nih_hash_add/%zu", size);
+	BENCH (name, size)
+		nih_hash_add (hash, &entries[bench_iteration]->list);
+
+	snprintf (name, sizeof (name), "nih_hash_replace/%zu", size);
+	BENCH (name, size)
+		nih_hash_replace (hash, &entries[bench_iteration]->list);
+
+	snprintf (name, sizeof (name), "nih_hash_lookup/%zu", size);
+	BENCH (name, size)
+		nih_hash_lookup (hash, entries[bench_iteration]->key);
+
+	snprintf (name, sizeof (name), "nih_hash_lookup_miss/%zu", size);
+	BENCH (name, size)
+		nih_hash_lookup (hash, misses[bench_iteration]);
+
+	nih_free (hash);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	BENCH_GROUP ("NihHash");
+
+	bench_size (16);
+	bench_size (1024);
+	bench_size (65536);
+
+	return 0;
+}
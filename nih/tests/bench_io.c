@@ -0,0 +1,86 @@
+/* libnih
+ *
+ * bench_io.c - benchmark I/O buffers
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/io.h>
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	static const size_t sizes[] = { 16, 256, 4096 };
+	NihIoBuffer        *buffer;
+	char                data[4096];
+	char                name[64];
+	char               *str;
+	size_t              len;
+	int                 i;
+
+	memset (data, 'x', sizeof (data));
+
+	BENCH_GROUP ("NihIoBuffer");
+
+	for (i = 0; i < 3; i++) {
+		buffer = NIH_MUST (nih_io_buffer_new (NULL));
+
+		snprintf (name, sizeof (name), "nih_io_buffer_push_pop/%zu",
+			  sizes[i]);
+		BENCH (name, 10000) {
+			NIH_ZERO (nih_io_buffer_push (buffer, data, sizes[i]));
+
+			len = sizes[i];
+			str = nih_io_buffer_pop (NULL, buffer, &len);
+			nih_free (str);
+		}
+
+		snprintf (name, sizeof (name), "nih_io_buffer_push_shrink/%zu",
+			  sizes[i]);
+		BENCH (name, 10000) {
+			NIH_ZERO (nih_io_buffer_push (buffer, data, sizes[i]));
+			nih_io_buffer_shrink (buffer, sizes[i]);
+		}
+
+		/* Queue up 64 writes then drain them, as a busy socket
+		 * would.
+		 */
+		snprintf (name, sizeof (name), "nih_io_buffer_queue_64/%zu",
+			  sizes[i]);
+		BENCH (name, 1000) {
+			for (int j = 0; j < 64; j++)
+				NIH_ZERO (nih_io_buffer_push (buffer, data,
+							      sizes[i]));
+			while (buffer->len) {
+				len = sizes[i];
+				str = nih_io_buffer_pop (NULL, buffer, &len);
+				nih_free (str);
+			}
+		}
+
+		nih_free (buffer);
+	}
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+/* libnih
+ *
+ * bench_list.c - benchmark linked lists
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+
+
+/**
+ * LIST_SIZE:
+ *
+ * Number of entries in the lists benchmarked.
+ **/
+#define LIST_SIZE 10000
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	NihList  list;
+	NihList *entries;
+	NihList *entry;
+	size_t   count;
+	int      i;
+
+	entries = NIH_MUST (nih_alloc (NULL, sizeof (NihList) * LIST_SIZE));
+	for (i = 0; i < LIST_SIZE; i++)
+		nih_list_init (&entries[i]);
+
+	nih_list_init (&list);
+
+	BENCH_GROUP ("NihList");
+
+	BENCH ("nih_list_add", LIST_SIZE)
+		nih_list_add (&list, &entries[bench_iteration]);
+
+	BENCH ("nih_list_add_after", LIST_SIZE)
+		nih_list_add_after (&list, &entries[bench_iteration]);
+
+	BENCH ("nih_list_remove", LIST_SIZE) {
+		nih_list_remove (&entries[bench_iteration]);
+		nih_list_add (&list, &entries[bench_iteration]);
+	}
+
+	BENCH ("NIH_LIST_FOREACH", 100) {
+		count = 0;
+		NIH_LIST_FOREACH (&list, iter)
+			count++;
+	}
+
+	BENCH ("NIH_LIST_FOREACH_SAFE", 100) {
+		count = 0;
+		NIH_LIST_FOREACH_SAFE (&list, iter)
+			count++;
+	}
+
+	BENCH ("nih_list_new_free", LIST_SIZE) {
+		entry = nih_list_new (NULL);
+		nih_list_add (&list, entry);
+		nih_free (entry);
+	}
+
+	nih_free (entries);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/* libnih
+ *
+ * bench_string.c - benchmark string functions
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/bench.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	char  *str;
+	char **array;
+
+	BENCH_GROUP ("nih_sprintf");
+
+	BENCH ("nih_sprintf_short", 100000) {
+		str = nih_sprintf (NULL, "%s-%d", "job", (int)bench_iteration);
+		nih_free (str);
+	}
+
+	BENCH ("nih_sprintf_message", 100000) {
+		str = nih_sprintf (NULL, "%s: %s process (%d) terminated "
+				   "with status %d", "init", "main",
+				   (int)bench_iteration, 1);
+		nih_free (str);
+	}
+
+	BENCH ("nih_sprintf_long", 100000) {
+		str = nih_sprintf (NULL, "%s %s %s %d %d %d",
+				   "/com/ubuntu/Upstart/jobs/some_job/instance",
+				   "org.freedesktop.DBus.Properties.GetAll",
+				   "the quick brown fox jumps over the lazy dog",
+				   (int)bench_iteration, 42, -1);
+		nih_free (str);
+	}
+
+	BENCH ("nih_strcat_sprintf", 1000) {
+		str = NULL;
+		for (int i = 0; i < 20; i++)
+			NIH_MUST (nih_strcat_sprintf (&str, NULL, "arg%d ", i));
+		nih_free (str);
+	}
+
+	BENCH ("nih_strcat_sprintf_long", 100) {
+		str = NULL;
+		for (int i = 0; i < 1000; i++)
+			NIH_MUST (nih_strcat_sprintf (&str, NULL, "arg%d ", i));
+		nih_free (str);
+	}
+
+	BENCH_GROUP ("nih_str_split");
+
+	BENCH ("nih_str_split_path", 100000) {
+		array = nih_str_split (NULL, "/usr/local/sbin:/usr/local/bin:"
+				       "/usr/sbin:/usr/bin:/sbin:/bin",
+				       ":", FALSE);
+		nih_free (array);
+	}
+
+	BENCH ("nih_str_split_repeat", 100000) {
+		array = nih_str_split (NULL, "  a  command   line  with   "
+				       "lots of  whitespace  ", " ", TRUE);
+		nih_free (array);
+	}
+
+	return 0;
+}
@@ -25,6 +25,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
 #include <nih/macros.h>
 #include <nih/alloc.h>
 #include <nih/list.h>
@@ -389,6 +393,92 @@ test_free (void)
 }
 
 
+static int free_count;
+
+static void
+my_count_free (void *ptr)
+{
+	free_count++;
+	free (ptr);
+}
+
+void
+test_free_deferred (void)
+{
+	void *ptr1;
+	void *ptr2;
+	void *ptr3;
+	int   ret;
+
+	TEST_FUNCTION ("nih_free_deferred");
+	__nih_free = my_count_free;
+
+	/* Check that destructors of the object and its children are called
+	 * immediately and the return value of the object's destructor is
+	 * returned, but that no memory is actually freed.
+	 */
+	TEST_FEATURE ("with children");
+	ptr1 = nih_alloc (NULL, 10);
+	nih_alloc_set_destructor (ptr1, destructor_called);
+	ptr2 = nih_alloc (ptr1, 10);
+	nih_alloc_set_destructor (ptr2, child_destructor_called);
+	ptr3 = nih_alloc (ptr2, 10);
+
+	destructor_was_called = 0;
+	child_destructor_was_called = 0;
+	free_count = 0;
+
+	ret = nih_free_deferred (ptr1);
+
+	TEST_TRUE (destructor_was_called);
+	TEST_TRUE (child_destructor_was_called);
+	TEST_EQ (ret, 2);
+	TEST_EQ (free_count, 0);
+
+
+	/* Check that nih_alloc_reclaim() returns the memory in slices no
+	 * larger than the maximum given, returning TRUE while objects
+	 * remain and FALSE once they have all been freed.
+	 */
+	TEST_FEATURE ("with reclaim in slices");
+	ret = nih_alloc_reclaim (2);
+
+	TEST_TRUE (ret);
+	TEST_EQ (free_count, 2);
+
+	ret = nih_alloc_reclaim (2);
+
+	TEST_FALSE (ret);
+	TEST_EQ (free_count, 3);
+
+
+	/* Check that children with other references are not freed. */
+	TEST_FEATURE ("with child referenced elsewhere");
+	ptr1 = nih_alloc (NULL, 10);
+	ptr2 = nih_alloc (NULL, 10);
+	ptr3 = nih_alloc (ptr1, 10);
+	nih_ref (ptr3, ptr2);
+	nih_alloc_set_destructor (ptr3, child_destructor_called);
+
+	child_destructor_was_called = 0;
+	free_count = 0;
+
+	nih_free_deferred (ptr1);
+
+	TEST_FALSE (child_destructor_was_called);
+	TEST_ALLOC_PARENT (ptr3, ptr2);
+
+	ret = nih_alloc_reclaim (0);
+
+	TEST_FALSE (ret);
+	TEST_EQ (free_count, 1);
+
+	nih_free (ptr2);
+
+	__nih_free = free;
+}
+
+
 void
 test_discard (void)
 {
@@ -460,6 +550,73 @@ test_discard (void)
 }
 
 
+void
+test_free_children (void)
+{
+	void *ptr1;
+	void *ptr2;
+	void *ptr3;
+
+	TEST_FUNCTION ("nih_free_children");
+
+	/* Check that the children of an object are freed, with their
+	 * destructors called, while the object itself is left allocated
+	 * and may be used as a parent again.
+	 */
+	TEST_FEATURE ("with children");
+	ptr1 = nih_alloc (NULL, 10);
+	nih_alloc_set_destructor (ptr1, destructor_called);
+	ptr2 = nih_alloc (ptr1, 10);
+	nih_alloc_set_destructor (ptr2, child_destructor_called);
+	ptr3 = nih_alloc (ptr2, 10);
+	TEST_FREE_TAG (ptr2);
+	TEST_FREE_TAG (ptr3);
+
+	destructor_was_called = 0;
+	child_destructor_was_called = 0;
+	nih_free_children (ptr1);
+
+	TEST_FALSE (destructor_was_called);
+	TEST_TRUE (child_destructor_was_called);
+	TEST_FREE (ptr2);
+	TEST_FREE (ptr3);
+
+	ptr2 = nih_alloc (ptr1, 10);
+	TEST_ALLOC_PARENT (ptr2, ptr1);
+	TEST_FREE_TAG (ptr2);
+
+	nih_free (ptr1);
+
+	TEST_TRUE (destructor_was_called);
+	TEST_FREE (ptr2);
+
+
+	/* Check that a child with another parent is only unreferenced,
+	 * and not freed.
+	 */
+	TEST_FEATURE ("with child with other parent");
+	ptr1 = nih_alloc (NULL, 10);
+	ptr3 = nih_alloc (NULL, 10);
+	ptr2 = nih_alloc (ptr1, 10);
+	nih_ref (ptr2, ptr3);
+	TEST_FREE_TAG (ptr2);
+
+	nih_free_children (ptr1);
+
+	TEST_NOT_FREE (ptr2);
+	TEST_FALSE (nih_alloc_parent (ptr2, ptr1));
+	TEST_TRUE (nih_alloc_parent (ptr2, ptr3));
+
+	nih_free (ptr1);
+
+	TEST_NOT_FREE (ptr2);
+
+	nih_free (ptr3);
+
+	TEST_FREE (ptr2);
+}
+
+
 void
 test_ref (void)
 {
@@ -768,6 +925,34 @@ test_parent (void)
 }
 
 
+void
+test_parents (void)
+{
+	void *ptr1;
+	void *ptr2;
+
+	TEST_FUNCTION ("nih_alloc_parents");
+
+	/* Check that each parent reference is counted, including that of
+	 * the NULL parent.
+	 */
+	ptr1 = nih_alloc (NULL, 10);
+	ptr2 = nih_alloc (NULL, 10);
+
+	TEST_EQ (nih_alloc_parents (ptr2), 1);
+
+	nih_ref (ptr2, ptr1);
+
+	TEST_EQ (nih_alloc_parents (ptr2), 2);
+
+	nih_unref (ptr2, NULL);
+
+	TEST_EQ (nih_alloc_parents (ptr2), 1);
+
+	nih_free (ptr1);
+}
+
+
 void
 test_local (void)
 {
@@ -822,6 +1007,143 @@ test_local (void)
 }
 
 
+void
+test_live_bytes (void)
+{
+	size_t  base;
+	void   *parent;
+	void   *ptr;
+
+	/* Check that the count of live bytes grows by the size of objects
+	 * as they are allocated and reallocated, and shrinks again when
+	 * they are freed along with their children.
+	 */
+	TEST_FUNCTION ("nih_alloc_live_bytes");
+	TEST_FEATURE ("with allocated objects");
+	base = nih_alloc_live_bytes ();
+
+	parent = nih_alloc (NULL, 100);
+	TEST_EQ (nih_alloc_live_bytes (), base + 100);
+
+	ptr = nih_alloc (parent, 20);
+	TEST_EQ (nih_alloc_live_bytes (), base + 120);
+
+	ptr = nih_realloc (ptr, parent, 50);
+	TEST_EQ (nih_alloc_live_bytes (), base + 150);
+
+	ptr = nih_realloc (ptr, parent, 10);
+	TEST_EQ (nih_alloc_live_bytes (), base + 110);
+
+	nih_free (parent);
+	TEST_EQ (nih_alloc_live_bytes (), base);
+
+
+	/* Check that objects freed with nih_free_deferred() remain live
+	 * until they have been reclaimed.
+	 */
+	TEST_FEATURE ("with deferred free");
+	parent = nih_alloc (NULL, 100);
+	TEST_NE_P (parent, NULL);
+
+	ptr = nih_alloc (parent, 20);
+	TEST_NE_P (ptr, NULL);
+
+	nih_free_deferred (parent);
+	TEST_EQ (nih_alloc_live_bytes (), base + 120);
+
+	while (nih_alloc_reclaim (0))
+		;
+
+	TEST_EQ (nih_alloc_live_bytes (), base);
+}
+
+
+#if ENABLE_THREADING
+static int thread_destructor_count;
+
+static int
+thread_destructor (void *ptr)
+{
+	__sync_fetch_and_add (&thread_destructor_count, 1);
+
+	return 0;
+}
+
+static void *
+thread_worker (void *arg)
+{
+	void *parent = arg;
+	void *ptr;
+	int   i;
+
+	for (i = 0; i < 10000; i++) {
+		ptr = nih_alloc (parent, 32);
+		if (! ptr)
+			return NULL;
+
+		nih_alloc_set_destructor (ptr, thread_destructor);
+
+		if (i % 2)
+			nih_free (ptr);
+	}
+
+	ptr = nih_alloc (NULL, 32);
+	if (ptr)
+		nih_alloc_set_destructor (ptr, thread_destructor);
+
+	return ptr;
+}
+#endif /* ENABLE_THREADING */
+
+void
+test_thread_safe (void)
+{
+#if ENABLE_THREADING
+	pthread_t  threads[4];
+	void      *parent;
+	void      *ptr;
+	int        i;
+#endif /* ENABLE_THREADING */
+
+	TEST_FUNCTION ("nih_alloc_set_thread_safe");
+#if ENABLE_THREADING
+	TEST_EQ (nih_alloc_set_thread_safe (TRUE), 0);
+
+
+	/* Check that multiple threads may allocate and free children of
+	 * a shared parent at the same time, and that objects allocated
+	 * without a parent in a thread may be handed to the main thread
+	 * which references them and drops the thread's reference.
+	 */
+	TEST_FEATURE ("with children of shared parent");
+	parent = nih_alloc (NULL, 1);
+	thread_destructor_count = 0;
+
+	for (i = 0; i < 4; i++)
+		TEST_EQ (pthread_create (&threads[i], NULL,
+					 thread_worker, parent), 0);
+
+	for (i = 0; i < 4; i++) {
+		TEST_EQ (pthread_join (threads[i], &ptr), 0);
+		TEST_NE_P (ptr, NULL);
+
+		nih_ref (ptr, parent);
+		nih_discard (ptr);
+
+		TEST_ALLOC_PARENT (ptr, parent);
+	}
+
+	TEST_EQ (thread_destructor_count, 4 * 5000);
+
+	nih_free (parent);
+
+	TEST_EQ (thread_destructor_count, 4 * 10000 + 4);
+#else /* ENABLE_THREADING */
+	TEST_LT (nih_alloc_set_thread_safe (TRUE), 0);
+#endif /* ENABLE_THREADING */
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -830,11 +1152,16 @@ main (int   argc,
 	test_alloc ();
 	test_realloc ();
 	test_free ();
+	test_free_deferred ();
 	test_discard ();
+	test_free_children ();
 	test_ref ();
 	test_unref ();
 	test_parent ();
+	test_parents ();
 	test_local ();
+	test_live_bytes ();
+	test_thread_safe ();
 
 	return 0;
 }
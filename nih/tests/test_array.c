@@ -0,0 +1,442 @@
+/* libnih
+ *
+ * test_array.c - test suite for nih/array.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <stdlib.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/array.h>
+#include <nih/logging.h>
+
+
+static int
+int_cmp (const void *a,
+	 const void *b)
+{
+	const int *int_a = a;
+	const int *int_b = b;
+
+	return (*int_a > *int_b) - (*int_a < *int_b);
+}
+
+#define int_cmp_inline(_a, _b) ((*(_a) > *(_b)) - (*(_a) < *(_b)))
+
+NIH_ARRAY_SORT_FUNCTION (int_sort, int, int_cmp_inline)
+
+
+void
+test_new (void)
+{
+	NihArray *array;
+
+	/* Check that a new array is empty, has no storage, and is allocated
+	 * with nih_alloc.
+	 */
+	TEST_FUNCTION ("nih_array_new");
+	TEST_ALLOC_FAIL {
+		array = nih_array_new (NULL, sizeof (int));
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (array, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (array, sizeof (NihArray));
+		TEST_EQ_P (array->data, NULL);
+		TEST_EQ (array->len, 0);
+		TEST_EQ (array->size, 0);
+		TEST_EQ (array->elem_size, sizeof (int));
+
+		nih_free (array);
+	}
+}
+
+void
+test_reserve (void)
+{
+	NihArray *array;
+	int       ret;
+
+	TEST_FUNCTION ("nih_array_reserve");
+
+	/* Check that reserving space allocates at least that many elements
+	 * as a child of the array.
+	 */
+	TEST_FEATURE ("with empty array");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			array = nih_array_new (NULL, sizeof (int));
+		}
+
+		ret = nih_array_reserve (array, 100);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+			TEST_EQ_P (array->data, NULL);
+			TEST_EQ (array->size, 0);
+
+			nih_free (array);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+		TEST_ALLOC_PARENT (array->data, array);
+		TEST_ALLOC_SIZE (array->data, sizeof (int) * 100);
+		TEST_EQ (array->size, 100);
+		TEST_EQ (array->len, 0);
+
+		nih_free (array);
+	}
+
+
+	/* Check that the storage is doubled when growing by a little. */
+	TEST_FEATURE ("with small increase");
+	array = nih_array_new (NULL, sizeof (int));
+
+	ret = nih_array_reserve (array, 1);
+	TEST_EQ (ret, 0);
+	TEST_EQ (array->size, 8);
+
+	ret = nih_array_reserve (array, 9);
+	TEST_EQ (ret, 0);
+	TEST_EQ (array->size, 16);
+
+	ret = nih_array_reserve (array, 16);
+	TEST_EQ (ret, 0);
+	TEST_EQ (array->size, 16);
+
+	nih_free (array);
+}
+
+void
+test_insert (void)
+{
+	NihArray *array;
+	int       value;
+	int *     elem;
+	int       i;
+
+	TEST_FUNCTION ("nih_array_insert");
+
+	/* Check that an element can be inserted into an empty array, and
+	 * that a pointer to the copy is returned.
+	 */
+	TEST_FEATURE ("with empty array");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			array = nih_array_new (NULL, sizeof (int));
+		}
+
+		value = 42;
+		elem = nih_array_insert (array, 0, &value);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (elem, NULL);
+			TEST_EQ (array->len, 0);
+
+			nih_free (array);
+			continue;
+		}
+
+		TEST_EQ_P (elem, array->data);
+		TEST_EQ (*elem, 42);
+		TEST_EQ (array->len, 1);
+
+		nih_free (array);
+	}
+
+
+	/* Check that inserting in the middle moves the following elements
+	 * up.
+	 */
+	TEST_FEATURE ("with middle of array");
+	array = nih_array_new (NULL, sizeof (int));
+
+	for (i = 0; i < 4; i++) {
+		value = i;
+		elem = nih_array_insert (array, i, &value);
+		TEST_NE_P (elem, NULL);
+	}
+
+	value = 99;
+	elem = nih_array_insert (array, 2, &value);
+
+	TEST_EQ_P (elem, &NIH_ARRAY_INDEX (array, int, 2));
+	TEST_EQ (array->len, 5);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 0), 0);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 1), 1);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 2), 99);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 3), 2);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 4), 3);
+
+	nih_free (array);
+
+
+	/* Check that a NULL element inserts a zeroed one. */
+	TEST_FEATURE ("with NULL element");
+	array = nih_array_new (NULL, sizeof (int));
+
+	NIH_MUST (nih_array_reserve (array, 1) == 0);
+	NIH_ARRAY_INDEX (array, int, 0) = 42;
+
+	elem = nih_array_insert (array, 0, NULL);
+
+	TEST_NE_P (elem, NULL);
+	TEST_EQ (*elem, 0);
+	TEST_EQ (array->len, 1);
+
+	nih_free (array);
+}
+
+void
+test_append (void)
+{
+	NihArray *array;
+	int       value;
+	int *     elem;
+	int       i;
+
+	/* Check that appending many elements keeps them in order, and that
+	 * the storage grows geometrically rather than for each element.
+	 */
+	TEST_FUNCTION ("nih_array_append");
+	array = nih_array_new (NULL, sizeof (int));
+
+	for (i = 0; i < 1000; i++) {
+		value = i;
+		elem = nih_array_append (array, &value);
+		TEST_NE_P (elem, NULL);
+		TEST_EQ (*elem, i);
+	}
+
+	TEST_EQ (array->len, 1000);
+	TEST_EQ (array->size, 1024);
+
+	for (i = 0; i < 1000; i++)
+		TEST_EQ (NIH_ARRAY_INDEX (array, int, i), i);
+
+	nih_free (array);
+}
+
+void
+test_remove (void)
+{
+	NihArray *array;
+	int       value;
+	int       i;
+
+	TEST_FUNCTION ("nih_array_remove");
+	array = nih_array_new (NULL, sizeof (int));
+
+	for (i = 0; i < 5; i++) {
+		value = i;
+		NIH_MUST (nih_array_append (array, &value));
+	}
+
+	/* Check that removing from the middle moves the following elements
+	 * down, without shrinking the storage.
+	 */
+	TEST_FEATURE ("with middle of array");
+	nih_array_remove (array, 1);
+
+	TEST_EQ (array->len, 4);
+	TEST_EQ (array->size, 8);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 0), 0);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 1), 2);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 2), 3);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 3), 4);
+
+
+	/* Check that the last element can be removed. */
+	TEST_FEATURE ("with end of array");
+	nih_array_remove (array, 3);
+
+	TEST_EQ (array->len, 3);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 2), 3);
+
+	nih_free (array);
+}
+
+void
+test_sort (void)
+{
+	NihArray *array;
+	int       value;
+	int       i;
+
+	/* Check that the array is sorted using the comparison function. */
+	TEST_FUNCTION ("nih_array_sort");
+	array = nih_array_new (NULL, sizeof (int));
+
+	srand (1);
+	for (i = 0; i < 1000; i++) {
+		value = rand () % 500;
+		NIH_MUST (nih_array_append (array, &value));
+	}
+
+	nih_array_sort (array, int_cmp);
+
+	TEST_EQ (array->len, 1000);
+	for (i = 1; i < 1000; i++)
+		TEST_LE (NIH_ARRAY_INDEX (array, int, i - 1),
+			 NIH_ARRAY_INDEX (array, int, i));
+
+	nih_free (array);
+}
+
+void
+test_sort_function (void)
+{
+	NihArray *array;
+	int       value;
+	int       i;
+
+	TEST_FUNCTION ("NIH_ARRAY_SORT_FUNCTION");
+
+	/* Check that a function defined with the macro sorts the array
+	 * using the inline comparison.
+	 */
+	TEST_FEATURE ("with random elements");
+	array = nih_array_new (NULL, sizeof (int));
+
+	srand (2);
+	for (i = 0; i < 1000; i++) {
+		value = rand () % 500;
+		NIH_MUST (nih_array_append (array, &value));
+	}
+
+	int_sort (array);
+
+	TEST_EQ (array->len, 1000);
+	for (i = 1; i < 1000; i++)
+		TEST_LE (NIH_ARRAY_INDEX (array, int, i - 1),
+			 NIH_ARRAY_INDEX (array, int, i));
+
+	nih_free (array);
+
+
+	/* Check that arrays with no elements and one element are left
+	 * alone.
+	 */
+	TEST_FEATURE ("with short arrays");
+	array = nih_array_new (NULL, sizeof (int));
+
+	int_sort (array);
+	TEST_EQ (array->len, 0);
+
+	value = 42;
+	NIH_MUST (nih_array_append (array, &value));
+
+	int_sort (array);
+	TEST_EQ (array->len, 1);
+	TEST_EQ (NIH_ARRAY_INDEX (array, int, 0), 42);
+
+	nih_free (array);
+}
+
+void
+test_search (void)
+{
+	NihArray *array;
+	int       value;
+	int *     elem;
+	int       i;
+
+	TEST_FUNCTION ("nih_array_search");
+	array = nih_array_new (NULL, sizeof (int));
+
+	/* Check that searching an empty array finds nothing. */
+	TEST_FEATURE ("with empty array");
+	value = 4;
+	elem = nih_array_search (array, &value, int_cmp);
+
+	TEST_EQ_P (elem, NULL);
+
+
+	for (i = 0; i < 100; i++) {
+		value = i * 2;
+		NIH_MUST (nih_array_append (array, &value));
+	}
+
+	/* Check that an element in a sorted array is found. */
+	TEST_FEATURE ("with matching element");
+	value = 42;
+	elem = nih_array_search (array, &value, int_cmp);
+
+	TEST_EQ_P (elem, &NIH_ARRAY_INDEX (array, int, 21));
+
+
+	/* Check that NULL is returned when there's no match. */
+	TEST_FEATURE ("with no matching element");
+	value = 43;
+	elem = nih_array_search (array, &value, int_cmp);
+
+	TEST_EQ_P (elem, NULL);
+
+	nih_free (array);
+}
+
+void
+test_foreach (void)
+{
+	NihArray *array;
+	int       value;
+	int       i;
+
+	/* Check that NIH_ARRAY_FOREACH visits each element in order. */
+	TEST_FUNCTION ("NIH_ARRAY_FOREACH");
+	array = nih_array_new (NULL, sizeof (int));
+
+	for (i = 0; i < 10; i++) {
+		value = i;
+		NIH_MUST (nih_array_append (array, &value));
+	}
+
+	i = 0;
+	NIH_ARRAY_FOREACH (array, int, iter) {
+		TEST_EQ_P (iter, &NIH_ARRAY_INDEX (array, int, i));
+		TEST_EQ (*iter, i);
+		i++;
+	}
+
+	TEST_EQ (i, 10);
+
+	nih_free (array);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_new ();
+	test_reserve ();
+	test_insert ();
+	test_append ();
+	test_remove ();
+	test_sort ();
+	test_sort_function ();
+	test_search ();
+	test_foreach ();
+
+	return 0;
+}
@@ -0,0 +1,222 @@
+/* libnih
+ *
+ * test_atom.c - test suite for nih/atom.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/atom.h>
+
+
+void
+test_table_new (void)
+{
+	NihAtomTable *table;
+
+	/* Check that a new table is empty and allocated with nih_alloc. */
+	TEST_FUNCTION ("nih_atom_table_new");
+	TEST_ALLOC_FAIL {
+		table = nih_atom_table_new (NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (table, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (table, sizeof (NihAtomTable));
+		TEST_ALLOC_PARENT (table->slots, table);
+		TEST_EQ (table->count, 0);
+		TEST_EQ (table->lookups, 0);
+		TEST_EQ (table->bytes, 0);
+		TEST_EQ (table->bytes_saved, 0);
+
+		nih_free (table);
+	}
+}
+
+void
+test_table_intern (void)
+{
+	NihAtomTable *table;
+	const char *  atom1;
+	const char *  atom2;
+	const char *  atoms[1000];
+	char          name[32];
+	int           i;
+
+	TEST_FUNCTION ("nih_atom_table_intern");
+
+	/* Check that interning a string returns a copy of it, owned by
+	 * the table, and that interning an equal string returns the same
+	 * pointer and counts the bytes saved.
+	 */
+	TEST_FEATURE ("with equal strings");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			table = nih_atom_table_new (NULL);
+		}
+
+		atom1 = nih_atom_table_intern (table, "com.netsplit.Nih");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (atom1, NULL);
+			TEST_EQ (table->count, 0);
+			TEST_EQ (table->lookups, 0);
+
+			nih_free (table);
+			continue;
+		}
+
+		TEST_EQ_STR (atom1, "com.netsplit.Nih");
+
+		strcpy (name, "com.netsplit.Nih");
+		atom2 = nih_atom_table_intern (table, name);
+
+		TEST_EQ_P (atom2, atom1);
+		TEST_EQ (table->count, 1);
+		TEST_EQ (table->lookups, 2);
+		TEST_EQ (table->bytes, 17);
+		TEST_EQ (table->bytes_saved, 17);
+
+		nih_free (table);
+	}
+
+
+	/* Check that different strings are different atoms. */
+	TEST_FEATURE ("with different strings");
+	table = nih_atom_table_new (NULL);
+
+	atom1 = nih_atom_table_intern (table, "foo");
+	atom2 = nih_atom_table_intern (table, "bar");
+
+	TEST_NE_P (atom2, atom1);
+	TEST_EQ_STR (atom1, "foo");
+	TEST_EQ_STR (atom2, "bar");
+	TEST_EQ (table->count, 2);
+
+	nih_free (table);
+
+
+	/* Check that the table grows as atoms are added, and that every
+	 * atom may still be found afterwards.
+	 */
+	TEST_FEATURE ("with many strings");
+	table = nih_atom_table_new (NULL);
+
+	for (i = 0; i < 1000; i++) {
+		sprintf (name, "atom%d", i);
+		atoms[i] = nih_atom_table_intern (table, name);
+		TEST_NE_P (atoms[i], NULL);
+	}
+
+	TEST_EQ (table->count, 1000);
+	TEST_GE (table->size, 2000);
+
+	for (i = 0; i < 1000; i++) {
+		sprintf (name, "atom%d", i);
+		TEST_EQ_P (nih_atom_table_intern (table, name), atoms[i]);
+	}
+
+	TEST_EQ (table->count, 1000);
+
+	nih_free (table);
+}
+
+void
+test_table_internn (void)
+{
+	NihAtomTable *table;
+	const char *  atom1;
+	const char *  atom2;
+
+	/* Check that only the given length of the string is interned, so
+	 * that tokens may be interned straight from a buffer.
+	 */
+	TEST_FUNCTION ("nih_atom_table_internn");
+	table = nih_atom_table_new (NULL);
+
+	atom1 = nih_atom_table_internn (table, "start on", 5);
+	atom2 = nih_atom_table_intern (table, "start");
+
+	TEST_EQ_STR (atom1, "start");
+	TEST_EQ_P (atom2, atom1);
+	TEST_EQ (nih_atom_len (atom1), 5);
+
+	nih_free (table);
+}
+
+void
+test_table_lookup (void)
+{
+	NihAtomTable *table;
+	const char *  atom;
+
+	/* Check that looking up a string that has been interned returns
+	 * the atom, and that one which hasn't returns NULL without adding
+	 * it.
+	 */
+	TEST_FUNCTION ("nih_atom_table_lookup");
+	table = nih_atom_table_new (NULL);
+
+	atom = nih_atom_table_intern (table, "foo");
+
+	TEST_EQ_P (nih_atom_table_lookup (table, "foo"), atom);
+	TEST_EQ_P (nih_atom_table_lookup (table, "bar"), NULL);
+	TEST_EQ (table->count, 1);
+
+	nih_free (table);
+}
+
+void
+test_atom (void)
+{
+	const char *atom;
+
+	/* Check that the global table is created on first use and that
+	 * atoms interned in it are shared.
+	 */
+	TEST_FUNCTION ("nih_atom");
+	TEST_EQ_P (nih_atom_lookup ("/com/netsplit/Nih"), NULL);
+
+	atom = nih_atom ("/com/netsplit/Nih");
+
+	TEST_NE_P (nih_atoms, NULL);
+	TEST_EQ_STR (atom, "/com/netsplit/Nih");
+	TEST_EQ_P (nih_atom ("/com/netsplit/Nih"), atom);
+	TEST_EQ_P (nih_atomn ("/com/netsplit/Nih/Test", 17), atom);
+	TEST_EQ_P (nih_atom_lookup ("/com/netsplit/Nih"), atom);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_table_new ();
+	test_table_intern ();
+	test_table_internn ();
+	test_table_lookup ();
+	test_atom ();
+
+	return 0;
+}
@@ -0,0 +1,387 @@
+/* libnih
+ *
+ * test_chash.c - test suite for nih/chash.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/chash.h>
+
+
+void
+test_new (void)
+{
+	NihCHash *hash;
+
+	/* Check that a new table is empty and allocated with nih_alloc. */
+	TEST_FUNCTION ("nih_chash_new");
+	TEST_ALLOC_FAIL {
+		hash = nih_chash_new (NULL, 100);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (hash, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_PARENT (hash, NULL);
+		TEST_EQ (nih_chash_count (hash), 0);
+
+		nih_free (hash);
+	}
+}
+
+void
+test_add (void)
+{
+	NihCHash *hash;
+	char *    value1;
+	char *    value2;
+	char      name[32];
+	int       ret;
+	int       i;
+
+	TEST_FUNCTION ("nih_chash_add");
+
+	/* Check that a value may be added, and that the table takes a
+	 * reference to it.
+	 */
+	TEST_FEATURE ("with new key");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			hash = nih_chash_new (NULL, 0);
+			value1 = nih_strdup (NULL, "value");
+		}
+
+		ret = nih_chash_add (hash, "foo", value1);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+			TEST_EQ (nih_chash_count (hash), 0);
+			TEST_EQ_P (nih_chash_lookup (hash, "foo"), NULL);
+
+			nih_free (hash);
+			nih_free (value1);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+		TEST_EQ (nih_chash_count (hash), 1);
+		TEST_EQ_P (nih_chash_lookup (hash, "foo"), value1);
+
+		TEST_FREE_TAG (value1);
+
+		nih_discard (value1);
+		TEST_NOT_FREE (value1);
+
+		nih_free (hash);
+		TEST_FREE (value1);
+	}
+
+
+	/* Check that adding a value with an existing key replaces it, and
+	 * that the old value is freed since nothing is reading it.
+	 */
+	TEST_FEATURE ("with existing key");
+	hash = nih_chash_new (NULL, 0);
+	value1 = nih_strdup (NULL, "value1");
+	value2 = nih_strdup (NULL, "value2");
+
+	ret = nih_chash_add (hash, "foo", value1);
+	TEST_EQ (ret, 0);
+	nih_discard (value1);
+
+	TEST_FREE_TAG (value1);
+
+	ret = nih_chash_add (hash, "foo", value2);
+	TEST_EQ (ret, 0);
+	nih_discard (value2);
+
+	TEST_FREE (value1);
+	TEST_EQ (nih_chash_count (hash), 1);
+	TEST_EQ_P (nih_chash_lookup (hash, "foo"), value2);
+
+	nih_free (hash);
+
+
+	/* Check that many values may be added and all found again. */
+	TEST_FEATURE ("with many keys");
+	hash = nih_chash_new (NULL, 0);
+
+	for (i = 0; i < 1000; i++) {
+		sprintf (name, "key%d", i);
+		value1 = nih_sprintf (hash, "value%d", i);
+
+		ret = nih_chash_add (hash, name, value1);
+		TEST_EQ (ret, 0);
+	}
+
+	TEST_EQ (nih_chash_count (hash), 1000);
+
+	for (i = 0; i < 1000; i++) {
+		sprintf (name, "key%d", i);
+		value1 = nih_chash_lookup (hash, name);
+
+		sprintf (name, "value%d", i);
+		TEST_EQ_STR (value1, name);
+	}
+
+	nih_free (hash);
+}
+
+void
+test_remove (void)
+{
+	NihCHash *hash;
+	char *    value;
+	int       ret;
+
+	TEST_FUNCTION ("nih_chash_remove");
+	hash = nih_chash_new (NULL, 0);
+
+	/* Check that removing a value drops the table's reference to it
+	 * immediately when nothing is reading it.
+	 */
+	TEST_FEATURE ("with existing key");
+	value = nih_strdup (NULL, "value");
+	ret = nih_chash_add (hash, "foo", value);
+	TEST_EQ (ret, 0);
+	nih_discard (value);
+
+	TEST_FREE_TAG (value);
+
+	ret = nih_chash_remove (hash, "foo");
+
+	TEST_TRUE (ret);
+	TEST_FREE (value);
+	TEST_EQ (nih_chash_count (hash), 0);
+	TEST_EQ_P (nih_chash_lookup (hash, "foo"), NULL);
+
+
+	/* Check that removing an unknown key returns FALSE. */
+	TEST_FEATURE ("with unknown key");
+	ret = nih_chash_remove (hash, "foo");
+
+	TEST_FALSE (ret);
+
+	nih_free (hash);
+}
+
+void
+test_read_lock (void)
+{
+	NihCHash *hash;
+	char *    value;
+	int       ret;
+
+	TEST_FUNCTION ("nih_chash_read_lock");
+	hash = nih_chash_new (NULL, 0);
+
+	/* Check that a value removed while a read section is active is not
+	 * freed until the section ends and the table is reclaimed.
+	 */
+	TEST_FEATURE ("with value removed while reading");
+	value = nih_strdup (NULL, "value");
+	ret = nih_chash_add (hash, "foo", value);
+	TEST_EQ (ret, 0);
+	nih_discard (value);
+
+	TEST_FREE_TAG (value);
+
+	nih_chash_read_lock ();
+
+	TEST_EQ_P (nih_chash_lookup (hash, "foo"), value);
+
+	ret = nih_chash_remove (hash, "foo");
+	TEST_TRUE (ret);
+
+	nih_chash_reclaim (hash);
+
+	TEST_NOT_FREE (value);
+	TEST_EQ_STR (value, "value");
+
+	nih_chash_read_unlock ();
+
+	TEST_NOT_FREE (value);
+
+	nih_chash_reclaim (hash);
+
+	TEST_FREE (value);
+
+
+	/* Check that read sections may be nested, and the value is kept
+	 * until the outermost ends.
+	 */
+	TEST_FEATURE ("with nested read sections");
+	value = nih_strdup (NULL, "value");
+	ret = nih_chash_add (hash, "foo", value);
+	TEST_EQ (ret, 0);
+	nih_discard (value);
+
+	TEST_FREE_TAG (value);
+
+	nih_chash_read_lock ();
+	nih_chash_read_lock ();
+
+	ret = nih_chash_remove (hash, "foo");
+	TEST_TRUE (ret);
+
+	nih_chash_read_unlock ();
+	nih_chash_reclaim (hash);
+
+	TEST_NOT_FREE (value);
+
+	nih_chash_read_unlock ();
+	nih_chash_reclaim (hash);
+
+	TEST_FREE (value);
+
+
+	/* Check that freeing the table frees values that were still
+	 * waiting to be reclaimed.
+	 */
+	TEST_FEATURE ("with table freed while reading");
+	value = nih_strdup (NULL, "value");
+	ret = nih_chash_add (hash, "foo", value);
+	TEST_EQ (ret, 0);
+	nih_discard (value);
+
+	TEST_FREE_TAG (value);
+
+	nih_chash_read_lock ();
+
+	ret = nih_chash_remove (hash, "foo");
+	TEST_TRUE (ret);
+
+	nih_chash_read_unlock ();
+
+	nih_free (hash);
+
+	TEST_FREE (value);
+}
+
+
+#if ENABLE_THREADING
+static NihCHash *thread_hash = NULL;
+static int       thread_done = FALSE;
+
+static void *
+reader_thread (void *arg)
+{
+	size_t *bad = arg;
+	char    name[32];
+	int     i = 0;
+
+	while ((i < 10000)
+	       || (! __atomic_load_n (&thread_done, __ATOMIC_ACQUIRE))) {
+		char *value;
+
+		sprintf (name, "key%d", i++ % 100);
+
+		nih_chash_read_lock ();
+
+		value = nih_chash_lookup (thread_hash, name);
+		if (value && strncmp (value, "value", 5))
+			(*bad)++;
+
+		nih_chash_read_unlock ();
+	}
+
+	return NULL;
+}
+#endif /* ENABLE_THREADING */
+
+void
+test_threads (void)
+{
+#if ENABLE_THREADING
+	pthread_t threads[4];
+	size_t    bad[4];
+	char      name[32];
+	int       i;
+	int       j;
+
+	/* Check that readers in other threads can look up values while
+	 * they are being replaced and removed, and only ever find complete
+	 * values.
+	 */
+	TEST_FUNCTION ("nih_chash_lookup");
+	TEST_FEATURE ("with concurrent writer");
+	thread_hash = nih_chash_new (NULL, 0);
+	thread_done = FALSE;
+
+	for (i = 0; i < 4; i++) {
+		bad[i] = 0;
+		NIH_ZERO (pthread_create (&threads[i], NULL,
+					  reader_thread, &bad[i]));
+	}
+
+	for (j = 0; j < 100; j++) {
+		for (i = 0; i < 100; i++) {
+			char *value;
+
+			sprintf (name, "key%d", i);
+			value = NIH_MUST (nih_sprintf (NULL, "value%d", j));
+
+			NIH_ZERO (nih_chash_add (thread_hash, name, value));
+			nih_discard (value);
+
+			if ((i + j) % 7 == 0)
+				nih_chash_remove (thread_hash, name);
+		}
+	}
+
+	__atomic_store_n (&thread_done, TRUE, __ATOMIC_RELEASE);
+
+	for (i = 0; i < 4; i++) {
+		NIH_ZERO (pthread_join (threads[i], NULL));
+		TEST_EQ (bad[i], 0);
+	}
+
+	nih_chash_reclaim (thread_hash);
+
+	nih_free (thread_hash);
+#endif /* ENABLE_THREADING */
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+#if ENABLE_THREADING
+	nih_alloc_set_thread_safe (TRUE);
+#endif /* ENABLE_THREADING */
+
+	test_new ();
+	test_add ();
+	test_remove ();
+	test_read_lock ();
+	test_threads ();
+
+	return 0;
+}
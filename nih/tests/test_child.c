@@ -25,18 +25,24 @@
 #include <valgrind/valgrind.h>
 #endif /* HAVE_VALGRIND_VALGRIND_H */
 
+#include <sys/ioctl.h>
 #include <sys/ptrace.h>
 
+#include <time.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <signal.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <nih/macros.h>
 #include <nih/alloc.h>
 #include <nih/list.h>
 #include <nih/string.h>
+#include <nih/io.h>
 #include <nih/child.h>
+#include <nih/error.h>
 
 
 static int handler_called = 0;
@@ -58,6 +64,23 @@ my_handler (void           *data,
 	last_status = status;
 }
 
+static struct rusage last_rusage;
+
+static void
+my_rusage_handler (void                *data,
+		   pid_t                pid,
+		   NihChildEvents       event,
+		   int                  status,
+		   const struct rusage *rusage)
+{
+	handler_called++;
+	last_data = data;
+	last_pid = pid;
+	last_event = event;
+	last_status = status;
+	memcpy (&last_rusage, rusage, sizeof (struct rusage));
+}
+
 void
 test_add_watch (void)
 {
@@ -109,6 +132,43 @@ test_add_watch (void)
 		TEST_EQ (watch->events, NIH_CHILD_ALL);
 		TEST_EQ_P (watch->handler, my_handler);
 		TEST_EQ_P (watch->data, &watch);
+		TEST_EQ_P (watch->rusage_handler, NULL);
+		TEST_LIST_NOT_EMPTY (&watch->entry);
+
+		nih_free (watch);
+	}
+}
+
+void
+test_add_rusage_watch (void)
+{
+	NihChildWatch *watch;
+
+	TEST_FUNCTION ("nih_child_add_rusage_watch");
+	nih_child_poll ();
+
+
+	/* Check that we can add a watch that receives resource usage,
+	 * and that the structure is filled in correctly with the handler
+	 * in the rusage member and part of a list.
+	 */
+	TEST_FEATURE ("with pid");
+	TEST_ALLOC_FAIL {
+		watch = nih_child_add_rusage_watch (NULL, getpid (),
+						    NIH_CHILD_EXITED,
+						    my_rusage_handler, &watch);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (watch, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (watch, sizeof (NihChildWatch));
+		TEST_EQ (watch->pid, getpid ());
+		TEST_EQ (watch->events, NIH_CHILD_EXITED);
+		TEST_EQ_P (watch->handler, NULL);
+		TEST_EQ_P (watch->rusage_handler, my_rusage_handler);
+		TEST_EQ_P (watch->data, &watch);
 		TEST_LIST_NOT_EMPTY (&watch->entry);
 
 		nih_free (watch);
@@ -541,6 +601,53 @@ test_poll (void)
 #endif
 
 
+	/* Check that a watch added for resource usage receives the usage
+	 * of the child along with the exit status, including the CPU time
+	 * it spent and its maximum resident set size.
+	 */
+	TEST_FEATURE ("with rusage watcher");
+
+	TEST_CHILD (pid) {
+		struct timespec start, now;
+
+		assert0 (clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &start));
+		do {
+			assert0 (clock_gettime (CLOCK_PROCESS_CPUTIME_ID,
+						&now));
+		} while ((now.tv_sec - start.tv_sec) * 1000000000L
+			 + (now.tv_nsec - start.tv_nsec) < 20000000L);
+
+		exit (12);
+	}
+
+	watch = nih_child_add_rusage_watch (NULL, pid, NIH_CHILD_EXITED,
+					    my_rusage_handler, &watch);
+
+	TEST_FREE_TAG (watch);
+
+	handler_called = 0;
+	last_data = NULL;
+	last_pid = 0;
+	last_event = -1;
+	last_status = 0;
+	memset (&last_rusage, 0, sizeof (last_rusage));
+
+	waitid (P_PID, pid, &siginfo, WEXITED | WNOWAIT);
+
+	nih_child_poll ();
+
+	TEST_TRUE (handler_called);
+	TEST_EQ_P (last_data, &watch);
+	TEST_EQ (last_pid, pid);
+	TEST_EQ (last_event, NIH_CHILD_EXITED);
+	TEST_EQ (last_status, 12);
+	TEST_TRUE (last_rusage.ru_utime.tv_sec || last_rusage.ru_utime.tv_usec
+		   || last_rusage.ru_stime.tv_sec
+		   || last_rusage.ru_stime.tv_usec);
+	TEST_GT (last_rusage.ru_maxrss, 0);
+	TEST_FREE (watch);
+
+
 	/* Check that we can watch for events from any process, which
 	 * shouldn't be freed when the child dies.
 	 */
@@ -671,12 +778,449 @@ test_poll (void)
 }
 
 
+static int   reader_called = 0;
+static char *last_lines = NULL;
+static int   last_stamped = FALSE;
+
+static void
+my_reader (void                  *data,
+	   NihChildCapture       *capture,
+	   const struct timespec *stamp,
+	   const char            *line,
+	   size_t                 len)
+{
+	reader_called++;
+	last_stamped = (stamp != NULL);
+
+	if (! last_lines)
+		last_lines = nih_strdup (NULL, "");
+
+	assert (nih_strncat (&last_lines, NULL, line, len));
+	assert (nih_strcat (&last_lines, NULL, "|"));
+}
+
+void
+test_capture_new (void)
+{
+	NihChildCapture *capture;
+	NihError        *err;
+	int              fds[2];
+
+	TEST_FUNCTION ("nih_child_capture_new");
+	nih_io_init ();
+
+	/* Check that we can capture the output of a process to a file
+	 * descriptor, and that the structure is filled in correctly with
+	 * a watch on both the pipe and the process.  No tee pipe or line
+	 * buffer should be allocated since there's no reader.
+	 */
+	TEST_FEATURE ("with output descriptor");
+	TEST_ALLOC_FAIL {
+		assert0 (pipe (fds));
+
+		capture = nih_child_capture_new (NULL, getpid (), fds[0],
+						 STDERR_FILENO,
+						 NIH_CHILD_CAPTURE_NONE,
+						 NULL, &capture);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (capture, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			TEST_GE (fcntl (fds[0], F_GETFD), 0);
+			close (fds[0]);
+			close (fds[1]);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (capture, sizeof (NihChildCapture));
+		TEST_EQ (capture->pid, getpid ());
+		TEST_EQ (capture->fd, fds[0]);
+		TEST_EQ (capture->out_fd, STDERR_FILENO);
+		TEST_EQ (capture->tee_fd[0], -1);
+		TEST_EQ (capture->tee_fd[1], -1);
+		TEST_EQ_P (capture->line_buf, NULL);
+		TEST_ALLOC_PARENT (capture->io_watch, capture);
+		TEST_EQ (capture->io_watch->fd, fds[0]);
+		TEST_EQ (capture->child_watch->pid, getpid ());
+		TEST_EQ_P (capture->reader, NULL);
+		TEST_EQ_P (capture->data, &capture);
+
+		TEST_TRUE (fcntl (fds[0], F_GETFL) & O_NONBLOCK);
+
+		nih_free (capture);
+
+		TEST_LT (fcntl (fds[0], F_GETFD), 0);
+		TEST_GE (fcntl (STDERR_FILENO, F_GETFD), 0);
+
+		close (fds[1]);
+	}
+
+
+	/* Check that when a reader is given along with an output descriptor,
+	 * a line buffer and tee pipe are also created.
+	 */
+	TEST_FEATURE ("with output descriptor and reader");
+	TEST_ALLOC_FAIL {
+		assert0 (pipe (fds));
+
+		capture = nih_child_capture_new (NULL, getpid (), fds[0],
+						 STDERR_FILENO,
+						 NIH_CHILD_CAPTURE_TIMESTAMP,
+						 my_reader, &capture);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (capture, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			close (fds[0]);
+			close (fds[1]);
+			continue;
+		}
+
+		TEST_EQ (capture->flags, NIH_CHILD_CAPTURE_TIMESTAMP);
+		TEST_GE (capture->tee_fd[0], 0);
+		TEST_GE (capture->tee_fd[1], 0);
+		TEST_ALLOC_PARENT (capture->line_buf, capture);
+		TEST_EQ_P (capture->reader, my_reader);
+
+		nih_free (capture);
+
+		close (fds[1]);
+	}
+
+
+	/* Check that when only a reader is given, no tee pipe is needed.
+	 */
+	TEST_FEATURE ("with only reader");
+	assert0 (pipe (fds));
+
+	capture = nih_child_capture_new (NULL, getpid (), fds[0], -1,
+					 NIH_CHILD_CAPTURE_NONE,
+					 my_reader, &capture);
+
+	TEST_EQ (capture->out_fd, -1);
+	TEST_EQ (capture->tee_fd[0], -1);
+	TEST_ALLOC_PARENT (capture->line_buf, capture);
+
+	nih_free (capture);
+
+	close (fds[1]);
+}
+
+void
+test_capture (void)
+{
+	NihChildCapture *capture;
+	siginfo_t        siginfo;
+	fd_set           readfds, writefds, exceptfds;
+	char             filename[PATH_MAX], buf[80];
+	char             big[NIH_CHILD_CAPTURE_LINE_MAX + 11];
+	pid_t            pid;
+	int              fds[2], out_fds[2], out_fd, i;
+	ssize_t          len;
+
+	TEST_FUNCTION ("nih_child_capture");
+	TEST_FILENAME (filename);
+
+	/* Check that output written by a child before it exits is moved
+	 * to the output file when the child is reaped, and that the
+	 * capture is freed since the pipe has also been closed.
+	 */
+	TEST_FEATURE ("with output to file");
+	assert0 (pipe (fds));
+	out_fd = open (filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	TEST_CHILD (pid) {
+		close (fds[0]);
+		assert (write (fds[1], "hello\nworld\n", 12) == 12);
+		exit (0);
+	}
+
+	close (fds[1]);
+
+	capture = nih_child_capture_new (NULL, pid, fds[0], out_fd,
+					 NIH_CHILD_CAPTURE_NONE, NULL, NULL);
+
+	TEST_FREE_TAG (capture);
+
+	waitid (P_PID, pid, &siginfo, WEXITED | WNOWAIT);
+
+	nih_child_poll ();
+
+	TEST_FREE (capture);
+
+	len = pread (out_fd, buf, sizeof (buf), 0);
+	TEST_EQ (len, 12);
+	TEST_EQ_MEM (buf, "hello\nworld\n", 12);
+
+	close (out_fd);
+	unlink (filename);
+
+
+	/* Check that output can be moved to a file opened in append mode,
+	 * which doesn't support splice, and that the reader is called for
+	 * each line including a final partial line.
+	 */
+	TEST_FEATURE ("with reader and output to append-mode file");
+	assert0 (pipe (fds));
+	out_fd = open (filename, O_RDWR | O_CREAT | O_APPEND, 0644);
+
+	TEST_CHILD (pid) {
+		close (fds[0]);
+		assert (write (fds[1], "hello\nworld\nbye", 15) == 15);
+		exit (0);
+	}
+
+	close (fds[1]);
+
+	capture = nih_child_capture_new (NULL, pid, fds[0], out_fd,
+					 NIH_CHILD_CAPTURE_NONE,
+					 my_reader, NULL);
+
+	TEST_FREE_TAG (capture);
+
+	reader_called = 0;
+	last_lines = NULL;
+	last_stamped = TRUE;
+
+	waitid (P_PID, pid, &siginfo, WEXITED | WNOWAIT);
+
+	nih_child_poll ();
+
+	TEST_FREE (capture);
+
+	TEST_EQ (reader_called, 3);
+	TEST_EQ_STR (last_lines, "hello|world|bye|");
+	TEST_FALSE (last_stamped);
+
+	len = pread (out_fd, buf, sizeof (buf), 0);
+	TEST_EQ (len, 15);
+	TEST_EQ_MEM (buf, "hello\nworld\nbye", 15);
+
+	nih_free (last_lines);
+	close (out_fd);
+	unlink (filename);
+
+
+	/* Check that output is passed to the reader when the pipe becomes
+	 * readable, with a timestamp when requested, and that the capture
+	 * is not freed while the child is still running.  Once the child
+	 * dies, the capture should be freed.
+	 */
+	TEST_FEATURE ("with reader while child running");
+	assert0 (pipe (fds));
+	out_fd = open (filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	TEST_CHILD (pid) {
+		close (fds[0]);
+		assert (write (fds[1], "one\ntwo", 7) == 7);
+		pause ();
+		exit (0);
+	}
+
+	close (fds[1]);
+
+	capture = nih_child_capture_new (NULL, pid, fds[0], out_fd,
+					 NIH_CHILD_CAPTURE_TIMESTAMP,
+					 my_reader, NULL);
+
+	TEST_FREE_TAG (capture);
+
+	reader_called = 0;
+	last_lines = NULL;
+	last_stamped = FALSE;
+
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+	FD_SET (fds[0], &readfds);
+
+	while (! reader_called)
+		nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_NOT_FREE (capture);
+	TEST_EQ (reader_called, 1);
+	TEST_EQ_STR (last_lines, "one|");
+	TEST_TRUE (last_stamped);
+	TEST_EQ (capture->line_buf->len, 3);
+
+	kill (pid, SIGTERM);
+	waitid (P_PID, pid, &siginfo, WEXITED | WNOWAIT);
+
+	nih_child_poll ();
+
+	TEST_FREE (capture);
+
+	TEST_EQ (reader_called, 2);
+	TEST_EQ_STR (last_lines, "one|two|");
+
+	len = pread (out_fd, buf, sizeof (buf), 0);
+	TEST_EQ (len, 7);
+	TEST_EQ_MEM (buf, "one\ntwo", 7);
+
+	nih_free (last_lines);
+	close (out_fd);
+	unlink (filename);
+
+
+	/* Check that when the output only accepts part of the data in the
+	 * pipe, only the lines that were moved are passed to the reader and
+	 * the rest are passed once they have been moved later, rather than
+	 * being passed twice.
+	 */
+	TEST_FEATURE ("with reader and partial move to output");
+	assert0 (pipe (fds));
+	assert0 (pipe (out_fds));
+	assert (fcntl (out_fds[1], F_SETPIPE_SZ, 4096) == 4096);
+	assert0 (nih_io_set_nonblock (out_fds[0]));
+	assert0 (nih_io_set_nonblock (out_fds[1]));
+
+	memset (big, 'x', 8192);
+	for (i = 63; i < 8192; i += 64)
+		big[i] = '\n';
+
+	TEST_CHILD (pid) {
+		close (fds[0]);
+		assert (write (fds[1], big, 8192) == 8192);
+		pause ();
+		exit (0);
+	}
+
+	close (fds[1]);
+
+	capture = nih_child_capture_new (NULL, pid, fds[0], out_fds[1],
+					 NIH_CHILD_CAPTURE_NONE,
+					 my_reader, NULL);
+
+	reader_called = 0;
+	last_lines = NULL;
+
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+	FD_SET (fds[0], &readfds);
+
+	/* Wait for all of the output to be in the pipe */
+	do {
+		assert0 (ioctl (fds[0], FIONREAD, &i));
+	} while (i < 8192);
+
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (reader_called, 64);
+	TEST_EQ (read (out_fds[0], big, 8192), 4096);
+
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (reader_called, 128);
+	TEST_EQ (strlen (last_lines), 128 * 64);
+	TEST_EQ (read (out_fds[0], big, 8192), 4096);
+
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (reader_called, 128);
+
+	kill (pid, SIGTERM);
+	waitpid (pid, NULL, 0);
+
+	nih_free (capture);
+	nih_free (last_lines);
+	close (out_fds[0]);
+	close (out_fds[1]);
+
+
+	/* Check that a long run of output without a newline is passed to
+	 * the reader in pieces, rather than being buffered without limit.
+	 */
+	TEST_FEATURE ("with line longer than maximum");
+	assert0 (pipe (fds));
+
+	memset (big, 'x', sizeof (big));
+	big[NIH_CHILD_CAPTURE_LINE_MAX + 10] = '\n';
+
+	TEST_CHILD (pid) {
+		close (fds[0]);
+		assert (write (fds[1], big, NIH_CHILD_CAPTURE_LINE_MAX + 11)
+			== NIH_CHILD_CAPTURE_LINE_MAX + 11);
+		exit (0);
+	}
+
+	close (fds[1]);
+
+	capture = nih_child_capture_new (NULL, pid, fds[0], -1,
+					 NIH_CHILD_CAPTURE_NONE,
+					 my_reader, NULL);
+
+	TEST_FREE_TAG (capture);
+
+	reader_called = 0;
+	last_lines = NULL;
+
+	waitid (P_PID, pid, &siginfo, WEXITED | WNOWAIT);
+
+	nih_child_poll ();
+
+	TEST_FREE (capture);
+
+	TEST_EQ (reader_called, 2);
+	TEST_EQ (strlen (last_lines), NIH_CHILD_CAPTURE_LINE_MAX + 12);
+	TEST_EQ (last_lines[NIH_CHILD_CAPTURE_LINE_MAX], '|');
+
+	nih_free (last_lines);
+
+
+	/* Check that when the child dies but the pipe remains open, the
+	 * capture is not freed until the pipe is closed.
+	 */
+	TEST_FEATURE ("with pipe still open after child dies");
+	assert0 (pipe (fds));
+
+	TEST_CHILD (pid) {
+		exit (0);
+	}
+
+	capture = nih_child_capture_new (NULL, pid, fds[0], -1,
+					 NIH_CHILD_CAPTURE_NONE, NULL, NULL);
+
+	TEST_FREE_TAG (capture);
+
+	waitid (P_PID, pid, &siginfo, WEXITED | WNOWAIT);
+
+	nih_child_poll ();
+
+	TEST_NOT_FREE (capture);
+	TEST_EQ_P (capture->child_watch, NULL);
+
+	assert (write (fds[1], "discarded", 9) == 9);
+	close (fds[1]);
+
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+	FD_SET (fds[0], &readfds);
+
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_FREE (capture);
+}
+
+
 int
 main (int   argc,
       char *argv[])
 {
 	test_add_watch ();
+	test_add_rusage_watch ();
 	test_poll ();
+	test_capture_new ();
+	test_capture ();
 
 	return 0;
 }
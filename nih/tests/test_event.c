@@ -0,0 +1,284 @@
+/* libnih
+ *
+ * test_event.c - test suite for nih/event.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <sys/select.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/io.h>
+#include <nih/event.h>
+#include <nih/error.h>
+
+
+static int       handler_called = 0;
+static void *    last_data = NULL;
+static NihEvent *last_event = NULL;
+static uint64_t  last_count = 0;
+
+static void
+my_handler (void     *data,
+	    NihEvent *event,
+	    uint64_t  count)
+{
+	handler_called++;
+	last_data = data;
+	last_event = event;
+	last_count = count;
+}
+
+static void
+free_handler (void     *data,
+	      NihEvent *event,
+	      uint64_t  count)
+{
+	handler_called++;
+	nih_free (event);
+}
+
+static NihEvent *signal_event = NULL;
+
+static void
+my_signal_handler (int signum)
+{
+	assert0 (nih_event_trigger (signal_event, 1));
+}
+
+static void
+handle_event (NihEvent *event)
+{
+	fd_set readfds, writefds, exceptfds;
+
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+	FD_SET (event->fd, &readfds);
+
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+}
+
+
+void
+test_new (void)
+{
+	NihEvent *event;
+	NihError *err;
+
+	TEST_FUNCTION ("nih_event_new");
+	nih_io_init ();
+
+	/* Check that we can create a new event, and that the structure is
+	 * filled in correctly with a non-blocking eventfd being watched
+	 * for reading.
+	 */
+	TEST_FEATURE ("with no flags");
+	TEST_ALLOC_FAIL {
+		event = nih_event_new (NULL, NIH_EVENT_NONE,
+				       my_handler, &event);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (event, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (event, sizeof (NihEvent));
+		TEST_GE (event->fd, 0);
+		TEST_TRUE (fcntl (event->fd, F_GETFL) & O_NONBLOCK);
+		TEST_TRUE (fcntl (event->fd, F_GETFD) & FD_CLOEXEC);
+		TEST_EQ (event->flags, NIH_EVENT_NONE);
+		TEST_ALLOC_PARENT (event->watch, event);
+		TEST_EQ (event->watch->fd, event->fd);
+		TEST_EQ (event->watch->events, NIH_IO_READ);
+		TEST_EQ_P (event->handler, my_handler);
+		TEST_EQ_P (event->data, &event);
+
+		nih_free (event);
+	}
+
+
+	/* Check that the eventfd is closed when the event is freed. */
+	TEST_FEATURE ("with event freed");
+	event = nih_event_new (NULL, NIH_EVENT_SEMAPHORE, my_handler, NULL);
+
+	TEST_EQ (event->flags, NIH_EVENT_SEMAPHORE);
+
+	{
+		int fd = event->fd;
+
+		nih_free (event);
+
+		TEST_LT (fcntl (fd, F_GETFD), 0);
+		TEST_EQ (errno, EBADF);
+	}
+}
+
+void
+test_trigger (void)
+{
+	NihEvent         *event;
+	struct sigaction  act, oldact;
+	int               ret;
+
+	TEST_FUNCTION ("nih_event_trigger");
+
+	/* Check that triggering an event several times results in the
+	 * handler being called once with the total, and that the counter
+	 * is reset so it's not called again.
+	 */
+	TEST_FEATURE ("with coalesced triggers");
+	event = nih_event_new (NULL, NIH_EVENT_NONE, my_handler, &event);
+
+	ret = nih_event_trigger (event, 1);
+	TEST_EQ (ret, 0);
+
+	ret = nih_event_trigger (event, 1);
+	TEST_EQ (ret, 0);
+
+	ret = nih_event_trigger (event, 3);
+	TEST_EQ (ret, 0);
+
+	handler_called = 0;
+	last_data = NULL;
+	last_event = NULL;
+	last_count = 0;
+
+	handle_event (event);
+
+	TEST_EQ (handler_called, 1);
+	TEST_EQ_P (last_data, &event);
+	TEST_EQ_P (last_event, event);
+	TEST_EQ_U (last_count, 5);
+
+	handle_event (event);
+
+	TEST_EQ (handler_called, 1);
+
+	nih_free (event);
+
+
+	/* Check that in semaphore mode, the handler is called with a count
+	 * of one each time until the triggers have been consumed.
+	 */
+	TEST_FEATURE ("with semaphore");
+	event = nih_event_new (NULL, NIH_EVENT_SEMAPHORE, my_handler, &event);
+
+	ret = nih_event_trigger (event, 2);
+	TEST_EQ (ret, 0);
+
+	handler_called = 0;
+	last_count = 0;
+
+	handle_event (event);
+
+	TEST_EQ (handler_called, 1);
+	TEST_EQ_U (last_count, 1);
+
+	handle_event (event);
+
+	TEST_EQ (handler_called, 2);
+	TEST_EQ_U (last_count, 1);
+
+	handle_event (event);
+
+	TEST_EQ (handler_called, 2);
+
+	nih_free (event);
+
+
+	/* Check that triggering an event such that its counter would
+	 * overflow returns the negated error number, leaving errno as it
+	 * was so that code interrupted by a signal handler is not affected.
+	 */
+	TEST_FEATURE ("with counter overflow");
+	event = nih_event_new (NULL, NIH_EVENT_NONE, my_handler, &event);
+
+	ret = nih_event_trigger (event, 1);
+	TEST_EQ (ret, 0);
+
+	errno = ESRCH;
+	ret = nih_event_trigger (event, UINT64_MAX - 1);
+
+	TEST_EQ (ret, -EAGAIN);
+	TEST_EQ (errno, ESRCH);
+
+	nih_free (event);
+
+
+	/* Check that an event may be triggered from a signal handler. */
+	TEST_FEATURE ("with trigger from signal handler");
+	signal_event = nih_event_new (NULL, NIH_EVENT_NONE, my_handler, NULL);
+
+	act.sa_handler = my_signal_handler;
+	act.sa_flags = 0;
+	sigemptyset (&act.sa_mask);
+	sigaction (SIGUSR1, &act, &oldact);
+
+	raise (SIGUSR1);
+	raise (SIGUSR1);
+
+	handler_called = 0;
+	last_count = 0;
+
+	handle_event (signal_event);
+
+	TEST_EQ (handler_called, 1);
+	TEST_EQ_U (last_count, 2);
+
+	sigaction (SIGUSR1, &oldact, NULL);
+	nih_free (signal_event);
+
+
+	/* Check that the handler may free the event. */
+	TEST_FEATURE ("with event freed by handler");
+	event = nih_event_new (NULL, NIH_EVENT_NONE, free_handler, NULL);
+
+	TEST_FREE_TAG (event);
+
+	assert0 (nih_event_trigger (event, 1));
+
+	handler_called = 0;
+
+	handle_event (event);
+
+	TEST_EQ (handler_called, 1);
+	TEST_FREE (event);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_new ();
+	test_trigger ();
+
+	return 0;
+}
@@ -639,6 +639,282 @@ test_ignore (void)
 }
 
 
+void
+test_glob_new (void)
+{
+	NihFileGlob *glob;
+
+	/* Check that a new glob is allocated with no patterns, and that
+	 * it matches nothing.
+	 */
+	TEST_FUNCTION ("nih_file_glob_new");
+	TEST_ALLOC_FAIL {
+		glob = nih_file_glob_new (NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (glob, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (glob, sizeof (NihFileGlob));
+		TEST_EQ (glob->npatterns, 0);
+		TEST_EQ_P (glob->patterns[0], NULL);
+		TEST_ALLOC_PARENT (glob->table, glob);
+		TEST_ALLOC_PARENT (glob->accept, glob);
+
+		TEST_FALSE (nih_file_glob_match (glob, "foo"));
+		TEST_FALSE (nih_file_glob_match (glob, ""));
+		TEST_FALSE (nih_file_glob_match (glob, "/path/to/foo"));
+
+		nih_free (glob);
+	}
+}
+
+void
+test_glob_add (void)
+{
+	NihFileGlob *glob;
+	NihError *   err;
+	int          ret;
+
+	TEST_FUNCTION ("nih_file_glob_add");
+
+	/* Check that a literal pattern can be added, and that it matches
+	 * only the whole final component of a path.
+	 */
+	TEST_FEATURE ("with literal pattern");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			glob = nih_file_glob_new (NULL);
+		}
+
+		ret = nih_file_glob_add (glob, "CVS");
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			TEST_EQ (glob->npatterns, 0);
+			TEST_EQ_P (glob->patterns[0], NULL);
+			TEST_FALSE (nih_file_glob_match (glob, "CVS"));
+
+			nih_free (glob);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+		TEST_EQ (glob->npatterns, 1);
+		TEST_EQ_STR (glob->patterns[0], "CVS");
+		TEST_ALLOC_PARENT (glob->patterns[0], glob->patterns);
+		TEST_EQ_P (glob->patterns[1], NULL);
+
+		TEST_TRUE (nih_file_glob_match (glob, "CVS"));
+		TEST_TRUE (nih_file_glob_match (glob, "/path/to/CVS"));
+		TEST_FALSE (nih_file_glob_match (glob, "CVSROOT"));
+		TEST_FALSE (nih_file_glob_match (glob, "xCVS"));
+		TEST_FALSE (nih_file_glob_match (glob, "CV"));
+		TEST_FALSE (nih_file_glob_match (glob, "CVS/foo"));
+		TEST_FALSE (nih_file_glob_match (glob, "/path/to/CVS/"));
+
+		nih_free (glob);
+	}
+
+
+	/* Check that stars match any sequence of characters, including
+	 * none, and that consecutive stars behave as one.
+	 */
+	TEST_FEATURE ("with star");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "*.bak"));
+	assert0 (nih_file_glob_add (glob, "#*#"));
+	assert0 (nih_file_glob_add (glob, "a**b"));
+
+	TEST_TRUE (nih_file_glob_match (glob, "foo.bak"));
+	TEST_TRUE (nih_file_glob_match (glob, ".bak"));
+	TEST_TRUE (nih_file_glob_match (glob, "foo.bak.bak"));
+	TEST_TRUE (nih_file_glob_match (glob, "/etc/foo.bak"));
+	TEST_FALSE (nih_file_glob_match (glob, "foo.bak.txt"));
+	TEST_FALSE (nih_file_glob_match (glob, "foo.bak/bar"));
+	TEST_TRUE (nih_file_glob_match (glob, "#foo#"));
+	TEST_TRUE (nih_file_glob_match (glob, "##"));
+	TEST_FALSE (nih_file_glob_match (glob, "#"));
+	TEST_TRUE (nih_file_glob_match (glob, "ab"));
+	TEST_TRUE (nih_file_glob_match (glob, "axyzb"));
+	TEST_FALSE (nih_file_glob_match (glob, "axyzba"));
+
+	nih_free (glob);
+
+
+	/* Check that a question mark matches any one character. */
+	TEST_FEATURE ("with question mark");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "foo.sw?"));
+
+	TEST_TRUE (nih_file_glob_match (glob, "foo.swp"));
+	TEST_TRUE (nih_file_glob_match (glob, "foo.swo"));
+	TEST_FALSE (nih_file_glob_match (glob, "foo.sw"));
+	TEST_FALSE (nih_file_glob_match (glob, "foo.swpx"));
+	TEST_FALSE (nih_file_glob_match (glob, "foo.sw/"));
+
+	nih_free (glob);
+
+
+	/* Check that a bracket expression matches one character in the
+	 * set, including ranges and negated sets.
+	 */
+	TEST_FEATURE ("with bracket expression");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "x[0-9a-f]"));
+	assert0 (nih_file_glob_add (glob, "y[!.]"));
+	assert0 (nih_file_glob_add (glob, "z[]-]"));
+
+	TEST_TRUE (nih_file_glob_match (glob, "x0"));
+	TEST_TRUE (nih_file_glob_match (glob, "x9"));
+	TEST_TRUE (nih_file_glob_match (glob, "xc"));
+	TEST_FALSE (nih_file_glob_match (glob, "xg"));
+	TEST_FALSE (nih_file_glob_match (glob, "xA"));
+	TEST_TRUE (nih_file_glob_match (glob, "ya"));
+	TEST_FALSE (nih_file_glob_match (glob, "y."));
+	TEST_TRUE (nih_file_glob_match (glob, "z]"));
+	TEST_TRUE (nih_file_glob_match (glob, "z-"));
+	TEST_FALSE (nih_file_glob_match (glob, "za"));
+
+	nih_free (glob);
+
+
+	/* Check that special characters may be escaped, and that an
+	 * unterminated bracket is matched literally.
+	 */
+	TEST_FEATURE ("with escaped characters");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "\\*\\?"));
+	assert0 (nih_file_glob_add (glob, "[abc"));
+
+	TEST_TRUE (nih_file_glob_match (glob, "*?"));
+	TEST_FALSE (nih_file_glob_match (glob, "ab"));
+	TEST_TRUE (nih_file_glob_match (glob, "[abc"));
+	TEST_FALSE (nih_file_glob_match (glob, "a"));
+
+	nih_free (glob);
+
+
+	/* Check that a pattern may be added after matching, and that
+	 * earlier patterns still match.
+	 */
+	TEST_FEATURE ("with additional pattern");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "*~"));
+
+	TEST_TRUE (nih_file_glob_match (glob, "foo~"));
+	TEST_FALSE (nih_file_glob_match (glob, "foo,v"));
+
+	assert0 (nih_file_glob_add (glob, "*,v"));
+
+	TEST_EQ (glob->npatterns, 2);
+	TEST_TRUE (nih_file_glob_match (glob, "foo~"));
+	TEST_TRUE (nih_file_glob_match (glob, "foo,v"));
+
+	nih_free (glob);
+
+
+	/* Check that a pattern containing a separator is rejected with
+	 * EINVAL, leaving the existing patterns alone.
+	 */
+	TEST_FEATURE ("with separator in pattern");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "*~"));
+
+	ret = nih_file_glob_add (glob, "foo/*");
+
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, EINVAL);
+	nih_free (err);
+
+	TEST_EQ (glob->npatterns, 1);
+	TEST_EQ_P (glob->patterns[1], NULL);
+	TEST_TRUE (nih_file_glob_match (glob, "foo~"));
+
+	nih_free (glob);
+}
+
+void
+test_glob_add_ignore (void)
+{
+	NihFileGlob *glob;
+	int          ret;
+	const char  *paths[] = {
+		".foo", "foo~", "foo.bak", "foo.BAK", "#foo#", "#", "foo.swp",
+		"foo.swo", "foo.swn", ".#foo", "foo,v", "RCS", "CVS",
+		"CVS.adm", "SCCS", ".git", "BitKeeper", "{arch}", "_darcs",
+		"foo.dpkg-new", "/path/to/foo.dpkg-bak", "foo.rpmsave",
+		"foo.rpmorig", "foo.rpmnew", "foo.rpmnewer",
+		"foo;0123abCD", "foo;0123abC", "foo;0123abCDE", "foo;0123abCG",
+		"foo.txt", "/path/to.dpkg-bak/foo", "/path/.git/foo",
+		"CVSROOT", "bak", "swp", "foo", "",
+		NULL
+	};
+
+	/* Check that the patterns added match the same paths as
+	 * nih_file_ignore().
+	 */
+	TEST_FUNCTION ("nih_file_glob_add_ignore");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			glob = nih_file_glob_new (NULL);
+		}
+
+		ret = nih_file_glob_add_ignore (glob);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+			nih_free (nih_error_get ());
+
+			TEST_EQ (glob->npatterns, 0);
+			TEST_EQ_P (glob->patterns[0], NULL);
+
+			nih_free (glob);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+		TEST_GT (glob->npatterns, 0);
+
+		for (const char **path = paths; *path; path++) {
+			ret = nih_file_ignore (NULL, *path);
+			if (nih_file_glob_match (glob, *path) != ret)
+				TEST_FAILED ("wrong result for %s, expected %d",
+					     *path, ret);
+		}
+
+		nih_free (glob);
+	}
+}
+
+void
+test_glob_filter (void)
+{
+	NihFileGlob *glob;
+
+	/* Check that the filter function matches paths against the glob
+	 * given as its data pointer.
+	 */
+	TEST_FUNCTION ("nih_file_glob_filter");
+	glob = nih_file_glob_new (NULL);
+	assert0 (nih_file_glob_add (glob, "*.swp"));
+
+	TEST_TRUE (nih_file_glob_filter (glob, "/tmp/foo.swp", FALSE));
+	TEST_FALSE (nih_file_glob_filter (glob, "/tmp/foo.txt", FALSE));
+	TEST_FALSE (nih_file_glob_filter (glob, "/tmp", TRUE));
+
+	nih_free (glob);
+}
+
+
 typedef struct visited {
 	NihList  entry;
 
@@ -1461,6 +1737,10 @@ main (int   argc,
 	test_is_rcs ();
 	test_is_packaging ();
 	test_ignore ();
+	test_glob_new ();
+	test_glob_add ();
+	test_glob_add_ignore ();
+	test_glob_filter ();
 	test_dir_walk ();
 
 	return 0;
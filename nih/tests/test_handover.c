@@ -0,0 +1,444 @@
+/* libnih
+ *
+ * test_handover.c - test suite for nih/handover.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/io.h>
+#include <nih/timer.h>
+#include <nih/watch.h>
+#include <nih/snapshot.h>
+#include <nih/handover.h>
+#include <nih/error.h>
+#include <nih/errors.h>
+
+
+static int create_called = 0;
+
+static void
+my_create_handler (void        *data,
+		   NihWatch    *watch,
+		   const char  *path,
+		   struct stat *statbuf)
+{
+	create_called++;
+}
+
+static void
+my_timer (void     *data,
+	  NihTimer *timer)
+{
+}
+
+
+/* Frees @io without closing its file descriptor, as exec would */
+static void
+io_forget (NihIo *io)
+{
+	nih_alloc_set_destructor (io, NULL);
+	nih_free (io);
+}
+
+
+void
+test_io (void)
+{
+	NihSnapshot * snapshot;
+	NihIo *       io;
+	NihIoMessage *message;
+	int           fds[2];
+	int           pipe_fds[2];
+	int           fd;
+
+	TEST_FUNCTION ("nih_handover_get_io");
+
+	/* Check that a stream structure is reconstructed on the same
+	 * file descriptor with the data that had not yet been sent or
+	 * read, and that the descriptor is not closed on exec in between
+	 * but is again afterwards.
+	 */
+	TEST_FEATURE ("with stream");
+	assert0 (socketpair (PF_UNIX, SOCK_STREAM, 0, fds));
+	assert0 (nih_io_set_cloexec (fds[0]));
+
+	io = nih_io_reopen (NULL, fds[0], NIH_IO_STREAM,
+			    NULL, NULL, NULL, NULL);
+	assert0 (nih_io_write (io, "hello", 5));
+	assert0 (nih_io_buffer_push (io->recv_buf, "partial", 7));
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_handover_add_io (snapshot, "io", io));
+
+	fd = nih_handover_write (snapshot);
+	TEST_GE (fd, 0);
+	TEST_FALSE (fcntl (fds[0], F_GETFD) & FD_CLOEXEC);
+
+	nih_free (snapshot);
+	io_forget (io);
+
+	snapshot = nih_handover_read (NULL, fd);
+	TEST_NE_P (snapshot, NULL);
+	close (fd);
+
+	io = nih_handover_get_io (NULL, snapshot, "io",
+				  NULL, NULL, NULL, NULL);
+	TEST_NE_P (io, NULL);
+
+	nih_free (snapshot);
+
+	TEST_EQ (io->watch->fd, fds[0]);
+	TEST_EQ (io->type, NIH_IO_STREAM);
+	TEST_TRUE (io->watch->events & NIH_IO_WRITE);
+	TEST_EQ (io->send_buf->len, 5);
+	TEST_EQ_MEM (io->send_buf->buf, "hello", 5);
+	TEST_EQ (io->recv_buf->len, 7);
+	TEST_EQ_MEM (io->recv_buf->buf, "partial", 7);
+	TEST_TRUE (fcntl (fds[0], F_GETFD) & FD_CLOEXEC);
+
+	nih_free (io);
+	close (fds[1]);
+
+
+	/* Check that a message structure is reconstructed with the messages
+	 * in its queues, and that file descriptors passed in messages are
+	 * also not closed on exec in between but are again afterwards.
+	 */
+	TEST_FEATURE ("with messages");
+	assert0 (socketpair (PF_UNIX, SOCK_DGRAM, 0, fds));
+	assert0 (pipe (pipe_fds));
+	assert0 (nih_io_set_cloexec (pipe_fds[0]));
+
+	io = nih_io_reopen (NULL, fds[0], NIH_IO_MESSAGE,
+			    NULL, NULL, NULL, NULL);
+
+	message = nih_io_message_new (NULL);
+	assert0 (nih_io_buffer_push (message->data, "hello", 5));
+	assert0 (nih_io_message_add_control (message, SOL_SOCKET, SCM_RIGHTS,
+					     sizeof (int), &pipe_fds[0]));
+	nih_io_send_message (io, message);
+	nih_discard (message);
+
+	message = nih_io_message_new (io);
+	assert0 (nih_io_buffer_push (message->data, "world", 5));
+	message->int_data = 42;
+	nih_list_add (io->recv_q, &message->entry);
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_handover_add_io (snapshot, "io", io));
+
+	fd = nih_handover_write (snapshot);
+	TEST_GE (fd, 0);
+	TEST_FALSE (fcntl (pipe_fds[0], F_GETFD) & FD_CLOEXEC);
+
+	nih_free (snapshot);
+	io_forget (io);
+
+	snapshot = nih_handover_read (NULL, fd);
+	TEST_NE_P (snapshot, NULL);
+	close (fd);
+
+	io = nih_handover_get_io (NULL, snapshot, "io",
+				  NULL, NULL, NULL, NULL);
+	TEST_NE_P (io, NULL);
+
+	nih_free (snapshot);
+
+	TEST_EQ (io->type, NIH_IO_MESSAGE);
+	TEST_TRUE (io->watch->events & NIH_IO_WRITE);
+
+	TEST_LIST_NOT_EMPTY (io->send_q);
+	message = (NihIoMessage *)io->send_q->next;
+	TEST_EQ_P (message->entry.next, io->send_q);
+	TEST_ALLOC_PARENT (message, io);
+	TEST_EQ (message->data->len, 5);
+	TEST_EQ_MEM (message->data->buf, "hello", 5);
+	TEST_NE_P (message->control[0], NULL);
+	TEST_EQ (message->control[0]->cmsg_level, SOL_SOCKET);
+	TEST_EQ (message->control[0]->cmsg_type, SCM_RIGHTS);
+	TEST_EQ (*(int *)CMSG_DATA (message->control[0]), pipe_fds[0]);
+	TEST_EQ_P (message->control[1], NULL);
+	TEST_TRUE (fcntl (pipe_fds[0], F_GETFD) & FD_CLOEXEC);
+
+	TEST_LIST_NOT_EMPTY (io->recv_q);
+	message = (NihIoMessage *)io->recv_q->next;
+	TEST_EQ_P (message->entry.next, io->recv_q);
+	TEST_ALLOC_PARENT (message, io);
+	TEST_EQ (message->data->len, 5);
+	TEST_EQ_MEM (message->data->buf, "world", 5);
+	TEST_EQ (message->int_data, 42);
+
+	nih_free (io);
+	close (fds[1]);
+	close (pipe_fds[0]);
+	close (pipe_fds[1]);
+}
+
+
+void
+test_abort (void)
+{
+	NihSnapshot * snapshot;
+	NihIo *       io;
+	NihIoMessage *message;
+	int           fds[2];
+	int           pipe_fds[2];
+	int           fd;
+
+	TEST_FUNCTION ("nih_handover_abort");
+
+	/* Check that when exec fails, file descriptors that were not to
+	 * be inherited before the image was written are no longer
+	 * inherited, while those that were still are.
+	 */
+	TEST_FEATURE ("with failed exec");
+	assert0 (socketpair (PF_UNIX, SOCK_DGRAM, 0, fds));
+	assert0 (pipe (pipe_fds));
+	assert0 (nih_io_set_cloexec (fds[0]));
+	assert0 (nih_io_set_cloexec (pipe_fds[0]));
+
+	io = nih_io_reopen (NULL, fds[0], NIH_IO_MESSAGE,
+			    NULL, NULL, NULL, NULL);
+
+	message = nih_io_message_new (NULL);
+	assert0 (nih_io_message_add_control (message, SOL_SOCKET, SCM_RIGHTS,
+					     sizeof (int) * 2, pipe_fds));
+	nih_io_send_message (io, message);
+	nih_discard (message);
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_handover_add_io (snapshot, "io", io));
+
+	fd = nih_handover_write (snapshot);
+	TEST_GE (fd, 0);
+	TEST_FALSE (fcntl (fds[0], F_GETFD) & FD_CLOEXEC);
+	TEST_FALSE (fcntl (pipe_fds[0], F_GETFD) & FD_CLOEXEC);
+	TEST_FALSE (fcntl (pipe_fds[1], F_GETFD) & FD_CLOEXEC);
+
+	nih_handover_abort (snapshot, fd);
+
+	TEST_LT (fcntl (fd, F_GETFD), 0);
+	TEST_TRUE (fcntl (fds[0], F_GETFD) & FD_CLOEXEC);
+	TEST_TRUE (fcntl (pipe_fds[0], F_GETFD) & FD_CLOEXEC);
+	TEST_FALSE (fcntl (pipe_fds[1], F_GETFD) & FD_CLOEXEC);
+
+	nih_free (snapshot);
+	nih_free (io);
+	close (fds[1]);
+	close (pipe_fds[0]);
+	close (pipe_fds[1]);
+}
+
+
+void
+test_watch (void)
+{
+	NihSnapshot *   snapshot;
+	NihWatch *      watch;
+	NihWatchHandle *handle;
+	FILE *          file;
+	fd_set          readfds, writefds, exceptfds;
+	char            dirname[PATH_MAX], filename[PATH_MAX];
+	int             fd, nfds, wd, subdir_wd = -1;
+
+	/* Check that a watch is reconstructed with the same inotify
+	 * instance and watch descriptors, without walking the directory
+	 * tree, and that it handles events on the sub-directories.
+	 */
+	TEST_FUNCTION ("nih_handover_get_watch");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/sub");
+	mkdir (filename, 0755);
+
+	watch = nih_watch_new (NULL, dirname, TRUE, FALSE, NULL,
+			       NULL, NULL, NULL, NULL);
+	TEST_NE_P (watch, NULL);
+
+	wd = watch->fd;
+	NIH_LIST_FOREACH (&watch->watches, iter) {
+		handle = (NihWatchHandle *)iter;
+
+		if (! strcmp (handle->path, filename))
+			subdir_wd = handle->wd;
+	}
+	TEST_NE (subdir_wd, -1);
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_handover_add_watch (snapshot, "watch", watch));
+
+	fd = nih_handover_write (snapshot);
+	TEST_GE (fd, 0);
+
+	nih_free (snapshot);
+	io_forget (watch->io);
+	nih_free (watch);
+
+	snapshot = nih_handover_read (NULL, fd);
+	TEST_NE_P (snapshot, NULL);
+	close (fd);
+
+	create_called = 0;
+	watch = nih_handover_get_watch (NULL, snapshot, "watch", NULL,
+					my_create_handler, NULL, NULL, NULL);
+	TEST_NE_P (watch, NULL);
+
+	nih_free (snapshot);
+
+	TEST_EQ (watch->fd, wd);
+	TEST_EQ (watch->io->watch->fd, wd);
+	TEST_EQ_STR (watch->path, dirname);
+	TEST_TRUE (watch->subdirs);
+	TEST_EQ (create_called, 0);
+
+	handle = NULL;
+	NIH_LIST_FOREACH (&watch->watches, iter) {
+		NihWatchHandle *h = (NihWatchHandle *)iter;
+
+		if (h->wd == subdir_wd)
+			handle = h;
+	}
+	TEST_NE_P (handle, NULL);
+	TEST_EQ_STR (handle->path, filename);
+	TEST_ALLOC_PARENT (handle, watch);
+
+	strcat (filename, "/frodo");
+	file = fopen (filename, "w");
+	fprintf (file, "test\n");
+	fclose (file);
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	select (nfds, &readfds, &writefds, &exceptfds, NULL);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (create_called, 1);
+
+	nih_free (watch);
+
+	unlink (filename);
+	filename[strlen (filename) - 6] = '\0';
+	rmdir (filename);
+	rmdir (dirname);
+}
+
+
+void
+test_timer (void)
+{
+	NihSnapshot *snapshot;
+	NihTimer *   timer;
+	NihError *   err;
+	time_t       due;
+	int          fd;
+
+	TEST_FUNCTION ("nih_handover_get_timer");
+
+	/* Check that a timer is reconstructed with the same period and
+	 * the same due time.
+	 */
+	TEST_FEATURE ("with periodic timer");
+	timer = nih_timer_add_periodic (NULL, 60, my_timer, NULL);
+	timer->due -= 10;
+	due = timer->due;
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_handover_add_timer (snapshot, "timer", timer));
+
+	fd = nih_handover_write (snapshot);
+	TEST_GE (fd, 0);
+
+	nih_free (snapshot);
+	nih_free (timer);
+
+	snapshot = nih_handover_read (NULL, fd);
+	TEST_NE_P (snapshot, NULL);
+	close (fd);
+
+	timer = nih_handover_get_timer (NULL, snapshot, "timer",
+					my_timer, &due);
+	TEST_NE_P (timer, NULL);
+
+	TEST_EQ (timer->type, NIH_TIMER_PERIODIC);
+	TEST_EQ (timer->period, 60);
+	TEST_EQ (timer->due, due);
+	TEST_EQ_P (timer->callback, my_timer);
+	TEST_EQ_P (timer->data, &due);
+	TEST_LIST_NOT_EMPTY (&timer->entry);
+
+	nih_free (timer);
+
+
+	/* Check that obtaining an object of a different type results in
+	 * an error.
+	 */
+	TEST_FEATURE ("with wrong type");
+	TEST_EQ_P (nih_handover_get_io (NULL, snapshot, "timer",
+					NULL, NULL, NULL, NULL), NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_SNAPSHOT_NOT_FOUND);
+	nih_free (err);
+
+
+	/* Check that obtaining an object that is not in the snapshot
+	 * results in an error.
+	 */
+	TEST_FEATURE ("with unknown name");
+	TEST_EQ_P (nih_handover_get_timer (NULL, snapshot, "frodo",
+					   my_timer, NULL), NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_SNAPSHOT_NOT_FOUND);
+	nih_free (err);
+
+	nih_free (snapshot);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_io ();
+	test_abort ();
+	test_watch ();
+	test_timer ();
+
+	return 0;
+}
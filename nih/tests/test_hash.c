@@ -479,9 +479,13 @@ test_lookup (void)
 	entry2 = nih_hash_add (hash, new_entry (hash, "entry 2"));
 	entry3 = new_entry (hash, "entry 3");
 
-	/* Check that we find a single matching entry. */
+	/* Check that we find a single matching entry, and that the lookup
+	 * doesn't allocate any memory.
+	 */
 	TEST_FEATURE ("with single match");
-	ptr = nih_hash_lookup (hash, "entry 1");
+	TEST_ALLOC_BUDGET (0, 0) {
+		ptr = nih_hash_lookup (hash, "entry 1");
+	}
 
 	TEST_EQ_P (ptr, entry1);
 
@@ -493,9 +497,13 @@ test_lookup (void)
 	TEST_EQ_P (ptr, entry2);
 
 
-	/* Check that we get NULL when there are no matching entries. */
+	/* Check that we get NULL when there are no matching entries,
+	 * again without allocating any memory.
+	 */
 	TEST_FEATURE ("with no matches");
-	ptr = nih_hash_lookup (hash, "entry 3");
+	TEST_ALLOC_BUDGET (0, 0) {
+		ptr = nih_hash_lookup (hash, "entry 3");
+	}
 
 	TEST_EQ_P (ptr, NULL);
 
@@ -127,15 +127,35 @@ test_log_message (void)
 	}
 
 
+	/* Check that formatting a message costs only a single allocation
+	 * of the formatted string.
+	 */
+	TEST_FEATURE ("with allocation budget");
+	TEST_ALLOC_BUDGET (1, 128) {
+		ret = nih_log_message (NIH_LOG_ERROR,
+				       "message with %s %d formatting",
+				       "some", 20);
+	}
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_STR (last_message, "message with some 20 formatting");
+
+	free (last_message);
+
+
 	/* Check that a message with insufficient priority does not make it
-	 * through to the logger.
+	 * through to the logger, and that no memory is allocated to format
+	 * it.
 	 */
 	TEST_FEATURE ("with message of insufficient priority");
 	TEST_ALLOC_FAIL {
 		last_priority = NIH_LOG_UNKNOWN;
 		last_message = NULL;
 
-		ret = nih_log_message (NIH_LOG_DEBUG, "not high enough");
+		TEST_ALLOC_BUDGET (0, 0) {
+			ret = nih_log_message (NIH_LOG_DEBUG,
+					       "not high enough %d", 42);
+		}
 
 		TEST_GT (ret, 0);
 		TEST_EQ (last_priority, NIH_LOG_UNKNOWN);
@@ -24,19 +24,25 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <fcntl.h>
 #include <stdio.h>
 #include <limits.h>
+#include <signal.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <nih/macros.h>
 #include <nih/list.h>
+#include <nih/io.h>
 #include <nih/main.h>
 #include <nih/timer.h>
 #include <nih/error.h>
+#include <nih/logging.h>
 
 
 void
@@ -507,6 +513,399 @@ test_main_loop_add_func (void)
 }
 
 
+static char *last_message = NULL;
+
+static int
+my_logger (NihLogLevel  priority,
+	   const char  *message)
+{
+	free (last_message);
+	last_message = strdup (message);
+
+	return 0;
+}
+
+static void
+my_slow_callback (void            *data,
+		  NihMainLoopFunc *func)
+{
+	struct timespec delay = { 0, 50000000 };
+
+	nanosleep (&delay, NULL);
+	nih_main_loop_exit (0);
+}
+
+void
+test_watchdog (void)
+{
+	NihMainLoopFunc  *func;
+	int               ret;
+#if ENABLE_THREADING
+	struct sigaction  act, oldact;
+#endif /* ENABLE_THREADING */
+
+	TEST_FUNCTION ("nih_main_watchdog_enable");
+	nih_log_set_logger (my_logger);
+
+	/* Check that a callback that takes longer than the threshold is
+	 * reported with a warning once the watchdog is enabled.
+	 */
+	TEST_FEATURE ("with slow callback");
+	ret = nih_main_watchdog_enable (10, NIH_MAIN_WATCHDOG_NONE);
+
+	TEST_EQ (ret, 0);
+
+	last_message = NULL;
+	func = nih_main_loop_add_func (NULL, my_slow_callback, NULL);
+	nih_main_loop_interrupt ();
+	ret = nih_main_loop ();
+
+	TEST_EQ (ret, 0);
+	TEST_NE_P (last_message, NULL);
+	TEST_EQ_STRN (last_message, "Slow main loop callback ");
+
+	free (last_message);
+	nih_free (func);
+
+
+	/* Check that a callback that's quicker than the threshold is not
+	 * reported.
+	 */
+	TEST_FEATURE ("with callback under threshold");
+	ret = nih_main_watchdog_enable (1000, NIH_MAIN_WATCHDOG_NONE);
+
+	TEST_EQ (ret, 0);
+
+	last_message = NULL;
+	func = nih_main_loop_add_func (NULL, my_slow_callback, NULL);
+	nih_main_loop_interrupt ();
+	ret = nih_main_loop ();
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_P (last_message, NULL);
+
+	nih_free (func);
+
+
+	/* Check that nothing is reported once the watchdog is disabled. */
+	TEST_FEATURE ("with watchdog disabled");
+	ret = nih_main_watchdog_enable (10, NIH_MAIN_WATCHDOG_NONE);
+
+	TEST_EQ (ret, 0);
+
+	nih_main_watchdog_disable ();
+
+	last_message = NULL;
+	func = nih_main_loop_add_func (NULL, my_slow_callback, NULL);
+	nih_main_loop_interrupt ();
+	ret = nih_main_loop ();
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_P (last_message, NULL);
+
+	nih_free (func);
+
+
+#if ENABLE_THREADING
+	/* Check that the backtrace thread replaces the action for the
+	 * signal it sends, and that the previous action is restored once
+	 * the watchdog is disabled.
+	 */
+	TEST_FEATURE ("with backtrace");
+	act.sa_handler = SIG_IGN;
+	act.sa_flags = 0;
+	sigemptyset (&act.sa_mask);
+	assert0 (sigaction (NIH_MAIN_WATCHDOG_SIGNAL, &act, &oldact));
+
+	ret = nih_main_watchdog_enable (1000, NIH_MAIN_WATCHDOG_BACKTRACE);
+
+	TEST_EQ (ret, 0);
+
+	assert0 (sigaction (NIH_MAIN_WATCHDOG_SIGNAL, NULL, &act));
+	TEST_FALSE (act.sa_handler == SIG_IGN);
+
+	nih_main_watchdog_disable ();
+
+	assert0 (sigaction (NIH_MAIN_WATCHDOG_SIGNAL, NULL, &act));
+	TEST_TRUE (act.sa_handler == SIG_IGN);
+
+	assert0 (sigaction (NIH_MAIN_WATCHDOG_SIGNAL, &oldact, NULL));
+#endif /* ENABLE_THREADING */
+
+	nih_log_set_logger (nih_logger_printf);
+}
+
+
+static int watcher_called = 0;
+
+static void
+my_watcher (void        *data,
+	    NihIoWatch  *watch,
+	    NihIoEvents  events)
+{
+	int fd;
+
+	watcher_called++;
+
+	fd = accept (watch->fd, NULL, NULL);
+	assert (fd >= 0);
+	close (fd);
+}
+
+void
+test_listen_fds (void)
+{
+	struct sockaddr_un addr;
+	socklen_t          addrlen;
+	pid_t              pid;
+	int                ret, sock, status;
+	char               buf[32];
+
+	TEST_FUNCTION ("nih_main_listen_fds");
+
+	/* Check that file descriptors passed by a service manager to a
+	 * process are counted and marked close-on-exec, and that the
+	 * environment is unset.  The service manager is stood in for by
+	 * the child itself, which moves a listening socket into place.
+	 */
+	TEST_FEATURE ("with passed descriptors");
+	TEST_CHILD (pid) {
+		sock = socket (PF_UNIX, SOCK_STREAM, 0);
+		assert (sock >= 0);
+		assert (dup2 (sock, NIH_MAIN_LISTEN_FDS_START + 1) >= 0);
+		assert (dup2 (sock, NIH_MAIN_LISTEN_FDS_START) >= 0);
+		close (sock);
+
+		sprintf (buf, "%d", getpid ());
+		setenv ("LISTEN_PID", buf, TRUE);
+		setenv ("LISTEN_FDS", "2", TRUE);
+
+		ret = nih_main_listen_fds (TRUE);
+
+		TEST_EQ (ret, 2);
+		TEST_EQ (fcntl (NIH_MAIN_LISTEN_FDS_START, F_GETFD),
+			 FD_CLOEXEC);
+		TEST_EQ (fcntl (NIH_MAIN_LISTEN_FDS_START + 1, F_GETFD),
+			 FD_CLOEXEC);
+		TEST_EQ_P (getenv ("LISTEN_PID"), NULL);
+		TEST_EQ_P (getenv ("LISTEN_FDS"), NULL);
+
+		exit (0);
+	}
+
+	waitpid (pid, &status, 0);
+	TEST_TRUE (WIFEXITED (status));
+	TEST_EQ (WEXITSTATUS (status), 0);
+
+
+	/* Check that descriptors intended for another process are ignored,
+	 * and the environment kept when not asked to unset it.
+	 */
+	TEST_FEATURE ("with descriptors for another process");
+	sprintf (buf, "%d", getppid ());
+	setenv ("LISTEN_PID", buf, TRUE);
+	setenv ("LISTEN_FDS", "1", TRUE);
+
+	ret = nih_main_listen_fds (FALSE);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ_STR (getenv ("LISTEN_FDS"), "1");
+
+
+	/* Check that zero is returned without the environment. */
+	TEST_FEATURE ("without environment");
+	unsetenv ("LISTEN_PID");
+	unsetenv ("LISTEN_FDS");
+
+	ret = nih_main_listen_fds (FALSE);
+
+	TEST_EQ (ret, 0);
+
+
+	/* Check that an invalid count raises an error, and that the
+	 * environment is still unset.
+	 */
+	TEST_FEATURE ("with invalid count");
+	sprintf (buf, "%d", getpid ());
+	setenv ("LISTEN_PID", buf, TRUE);
+	setenv ("LISTEN_FDS", "two", TRUE);
+
+	ret = nih_main_listen_fds (TRUE);
+
+	TEST_LT (ret, 0);
+	TEST_EQ_P (getenv ("LISTEN_FDS"), NULL);
+
+	nih_free (nih_error_get ());
+
+
+	/* Check that a passed listening socket can be watched, and that
+	 * the watcher is called for each pending connection.
+	 */
+	TEST_FUNCTION ("nih_main_listen_watch");
+	TEST_CHILD (pid) {
+		NihIoWatch *watch;
+		fd_set      readfds, writefds, exceptfds;
+		int         nfds = 0, client;
+
+		sock = socket (PF_UNIX, SOCK_STREAM, 0);
+		assert (sock >= 0);
+
+		memset (&addr, 0, sizeof (addr));
+		addr.sun_family = AF_UNIX;
+		addr.sun_path[0] = '\0';
+		addrlen = offsetof (struct sockaddr_un, sun_path) + 1;
+		addrlen += snprintf (addr.sun_path + 1,
+				     sizeof (addr.sun_path) - 1,
+				     "/com/netsplit/nih/test_main/%d",
+				     getpid ());
+
+		assert0 (bind (sock, (struct sockaddr *)&addr, addrlen));
+		assert0 (listen (sock, 1));
+		assert (dup2 (sock, NIH_MAIN_LISTEN_FDS_START) >= 0);
+		close (sock);
+
+		sprintf (buf, "%d", getpid ());
+		setenv ("LISTEN_PID", buf, TRUE);
+		setenv ("LISTEN_FDS", "1", TRUE);
+
+		assert (nih_main_listen_fds (TRUE) == 1);
+
+		watch = nih_main_listen_watch (NULL, NIH_MAIN_LISTEN_FDS_START,
+					       my_watcher, &watch);
+
+		TEST_NE_P (watch, NULL);
+		TEST_EQ (watch->fd, NIH_MAIN_LISTEN_FDS_START);
+		TEST_EQ (watch->events, NIH_IO_READ);
+		TEST_TRUE (fcntl (NIH_MAIN_LISTEN_FDS_START, F_GETFL)
+			   & O_NONBLOCK);
+
+		client = socket (PF_UNIX, SOCK_STREAM, 0);
+		assert (client >= 0);
+		assert0 (connect (client, (struct sockaddr *)&addr, addrlen));
+
+		watcher_called = 0;
+
+		FD_ZERO (&readfds);
+		FD_ZERO (&writefds);
+		FD_ZERO (&exceptfds);
+
+		nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+		assert (select (nfds, &readfds, &writefds,
+				&exceptfds, NULL) > 0);
+		nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+		TEST_EQ (watcher_called, 1);
+
+		nih_free (watch);
+		close (client);
+
+		exit (0);
+	}
+
+	waitpid (pid, &status, 0);
+	TEST_TRUE (WIFEXITED (status));
+	TEST_EQ (WEXITSTATUS (status), 0);
+}
+
+void
+test_notify (void)
+{
+	struct sockaddr_un addr;
+	socklen_t          addrlen;
+	char               filename[PATH_MAX], buf[80];
+	ssize_t            len;
+	int                ret, sock;
+
+	TEST_FUNCTION ("nih_main_notify");
+
+	/* Check that the state is sent as a single datagram to a socket
+	 * named by an absolute path in NOTIFY_SOCKET, the service manager
+	 * being stood in for by a socket bound in a temporary directory.
+	 */
+	TEST_FEATURE ("with path");
+	TEST_FILENAME (filename);
+
+	sock = socket (PF_UNIX, SOCK_DGRAM, 0);
+	assert (sock >= 0);
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	assert (strlen (filename) < sizeof (addr.sun_path));
+	strcpy (addr.sun_path, filename);
+	assert0 (bind (sock, (struct sockaddr *)&addr, sizeof (addr)));
+
+	setenv ("NOTIFY_SOCKET", filename, TRUE);
+
+	ret = nih_main_notify ("READY=1\nSTATUS=Running");
+
+	TEST_EQ (ret, TRUE);
+
+	len = recv (sock, buf, sizeof (buf), MSG_DONTWAIT);
+
+	TEST_EQ (len, 22);
+	TEST_EQ_MEM (buf, "READY=1\nSTATUS=Running", 22);
+
+	close (sock);
+	unlink (filename);
+
+
+	/* Check that a socket in the abstract namespace is used when the
+	 * name begins with "@".
+	 */
+	TEST_FEATURE ("with abstract name");
+	sock = socket (PF_UNIX, SOCK_DGRAM, 0);
+	assert (sock >= 0);
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	addr.sun_path[0] = '@';
+	addrlen = offsetof (struct sockaddr_un, sun_path) + 1;
+	addrlen += snprintf (addr.sun_path + 1, sizeof (addr.sun_path) - 1,
+			     "/com/netsplit/nih/test_main/notify/%d",
+			     getpid ());
+
+	setenv ("NOTIFY_SOCKET", addr.sun_path, TRUE);
+
+	addr.sun_path[0] = '\0';
+	assert0 (bind (sock, (struct sockaddr *)&addr, addrlen));
+
+	ret = nih_main_notify ("READY=1");
+
+	TEST_EQ (ret, TRUE);
+
+	len = recv (sock, buf, sizeof (buf), MSG_DONTWAIT);
+
+	TEST_EQ (len, 7);
+	TEST_EQ_MEM (buf, "READY=1", 7);
+
+	close (sock);
+
+
+	/* Check that nothing is sent, and FALSE returned, when the process
+	 * was not started by a service manager.
+	 */
+	TEST_FEATURE ("without socket");
+	unsetenv ("NOTIFY_SOCKET");
+
+	ret = nih_main_notify ("READY=1");
+
+	TEST_EQ (ret, FALSE);
+
+
+	/* Check that an error is raised if the socket is not listening. */
+	TEST_FEATURE ("with missing socket");
+	setenv ("NOTIFY_SOCKET", filename, TRUE);
+
+	ret = nih_main_notify ("READY=1");
+
+	TEST_LT (ret, 0);
+
+	nih_free (nih_error_get ());
+
+	unsetenv ("NOTIFY_SOCKET");
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -521,6 +920,9 @@ main (int   argc,
 	test_write_pidfile ();
 	test_main_loop ();
 	test_main_loop_add_func ();
+	test_watchdog ();
+	test_listen_fds ();
+	test_notify ();
 
 	return 0;
 }
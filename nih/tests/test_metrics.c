@@ -0,0 +1,457 @@
+/* libnih
+ *
+ * test_metrics.c - test suite for nih/metrics.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#if ENABLE_THREADING
+# include <pthread.h>
+#endif /* ENABLE_THREADING */
+
+#include <sys/select.h>
+
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/io.h>
+#include <nih/metrics.h>
+
+
+static NihMetricValue *
+find_value (NihMetricValue **snapshot,
+	    const char      *name)
+{
+	NihMetricValue **value;
+
+	for (value = snapshot; *value; value++)
+		if (! strcmp ((*value)->name, name))
+			return *value;
+
+	return NULL;
+}
+
+
+void
+test_counter (void)
+{
+	NihMetric  *metric;
+	NihMetric  *again;
+
+	/* Check that a counter is created the first time it is looked
+	 * up, and that the same counter is returned the next time.
+	 */
+	TEST_FUNCTION ("nih_metric_counter");
+	metric = nih_metric_counter ("test_counter");
+
+	TEST_NE_P (metric, NULL);
+	TEST_EQ_STR (metric->name, "test_counter");
+	TEST_EQ (metric->type, NIH_METRIC_COUNTER);
+	TEST_EQ_U ((uintptr_t)metric->shards % NIH_METRIC_CACHE_LINE, 0);
+	TEST_EQ_U ((uintptr_t)&metric->shards[1] % NIH_METRIC_CACHE_LINE, 0);
+
+	again = nih_metric_counter ("test_counter");
+
+	TEST_EQ_P (again, metric);
+}
+
+void
+test_add (void)
+{
+	NihMetric       *metric;
+	NihMetricValue **snapshot;
+	NihMetricValue  *value;
+
+	/* Check that values added to a counter are totalled in the
+	 * snapshot.
+	 */
+	TEST_FUNCTION ("nih_metric_add");
+	metric = nih_metric_counter ("test_add");
+
+	nih_metric_add (metric, 1);
+	nih_metric_add (metric, 41);
+
+	snapshot = nih_metrics_snapshot (NULL);
+	value = find_value (snapshot, "test_add");
+
+	TEST_NE_P (value, NULL);
+	TEST_EQ (value->type, NIH_METRIC_COUNTER);
+	TEST_EQ (value->value, 42);
+
+	nih_free (snapshot);
+}
+
+void
+test_set_max (void)
+{
+	NihMetric       *metric;
+	NihMetricValue **snapshot;
+	NihMetricValue  *value;
+
+	TEST_FUNCTION ("nih_metric_set_max");
+
+	/* Check that a larger value replaces the value of a gauge. */
+	TEST_FEATURE ("with larger value");
+	metric = nih_metric_gauge ("test_set_max");
+
+	nih_metric_set (metric, 10);
+	nih_metric_set_max (metric, 20);
+
+	snapshot = nih_metrics_snapshot (NULL);
+	value = find_value (snapshot, "test_set_max");
+
+	TEST_NE_P (value, NULL);
+	TEST_EQ (value->type, NIH_METRIC_GAUGE);
+	TEST_EQ (value->value, 20);
+
+	nih_free (snapshot);
+
+
+	/* Check that a smaller value is ignored. */
+	TEST_FEATURE ("with smaller value");
+	nih_metric_set_max (metric, 15);
+
+	snapshot = nih_metrics_snapshot (NULL);
+	value = find_value (snapshot, "test_set_max");
+
+	TEST_EQ (value->value, 20);
+
+	nih_free (snapshot);
+}
+
+void
+test_record (void)
+{
+	NihMetric       *metric;
+	NihMetricValue **snapshot;
+	NihMetricValue  *value;
+	int              i;
+
+	TEST_FUNCTION ("nih_metric_record");
+
+	/* Check that the values recorded in a histogram are summarised in
+	 * the snapshot, with percentiles given as the upper bound of the
+	 * bucket they fall within.
+	 */
+	TEST_FEATURE ("with range of values");
+	metric = nih_metric_histogram ("test_record");
+
+	for (i = 1; i <= 100; i++)
+		nih_metric_record (metric, i);
+
+	snapshot = nih_metrics_snapshot (NULL);
+	value = find_value (snapshot, "test_record");
+
+	TEST_NE_P (value, NULL);
+	TEST_EQ (value->type, NIH_METRIC_HISTOGRAM);
+	TEST_EQ (value->count, 100);
+	TEST_EQ (value->sum, 5050);
+	TEST_EQ (value->min, 1);
+	TEST_EQ (value->max, 100);
+	TEST_EQ (value->p50, 51);
+	TEST_EQ (value->p90, 95);
+	TEST_EQ (value->p99, 103);
+
+	nih_free (snapshot);
+
+
+	/* Check that a value too large for the buckets is counted in the
+	 * last one, but still reported as the maximum.
+	 */
+	TEST_FEATURE ("with very large value");
+	metric = nih_metric_histogram ("test_record_large");
+
+	nih_metric_record (metric, UINT64_MAX);
+
+	snapshot = nih_metrics_snapshot (NULL);
+	value = find_value (snapshot, "test_record_large");
+
+	TEST_EQ (value->count, 1);
+	TEST_EQ (value->max, UINT64_MAX);
+	TEST_GT (value->p99, 1ULL << 39);
+
+	nih_free (snapshot);
+
+
+	/* Check that an empty histogram has zero for all values. */
+	TEST_FEATURE ("with no values");
+	metric = nih_metric_histogram ("test_record_empty");
+
+	snapshot = nih_metrics_snapshot (NULL);
+	value = find_value (snapshot, "test_record_empty");
+
+	TEST_EQ (value->count, 0);
+	TEST_EQ (value->min, 0);
+	TEST_EQ (value->max, 0);
+	TEST_EQ (value->p50, 0);
+
+	nih_free (snapshot);
+}
+
+
+void
+test_get (void)
+{
+	NihMetricValue **snapshot;
+	NihMetricValue   value;
+
+	TEST_FUNCTION ("nih_metric_get");
+
+	/* Check that the value of a single counter is obtained, without
+	 * a name being set.
+	 */
+	TEST_FEATURE ("with counter");
+	nih_metric_add (nih_metric_counter ("test_get"), 7);
+
+	nih_metric_get ("test_get", &value);
+
+	TEST_EQ_P (value.name, NULL);
+	TEST_EQ (value.type, NIH_METRIC_COUNTER);
+	TEST_EQ (value.value, 7);
+
+
+	/* Check that a histogram is summarised just as it is in the
+	 * snapshot.
+	 */
+	TEST_FEATURE ("with histogram");
+	nih_metric_get ("test_record", &value);
+
+	TEST_EQ (value.type, NIH_METRIC_HISTOGRAM);
+	TEST_EQ (value.count, 100);
+	TEST_EQ (value.sum, 5050);
+	TEST_EQ (value.min, 1);
+	TEST_EQ (value.max, 100);
+	TEST_EQ (value.p50, 51);
+	TEST_EQ (value.p90, 95);
+	TEST_EQ (value.p99, 103);
+
+
+	/* Check that the value is zeroed for a metric that has not been
+	 * used, and that the metric is not created.
+	 */
+	TEST_FEATURE ("with unknown metric");
+	memset (&value, 0xff, sizeof (NihMetricValue));
+
+	nih_metric_get ("test_get_unknown", &value);
+
+	TEST_EQ_P (value.name, NULL);
+	TEST_EQ (value.value, 0);
+	TEST_EQ (value.count, 0);
+	TEST_EQ (value.p99, 0);
+
+	snapshot = nih_metrics_snapshot (NULL);
+
+	TEST_EQ_P (find_value (snapshot, "test_get_unknown"), NULL);
+
+	nih_free (snapshot);
+}
+
+
+#if ENABLE_THREADING
+static void *
+add_thread (void *arg)
+{
+	NihMetric *metric = arg;
+	int        i;
+
+	for (i = 0; i < 10000; i++)
+		nih_metric_add (metric, 1);
+
+	return NULL;
+}
+#endif /* ENABLE_THREADING */
+
+void
+test_snapshot (void)
+{
+	NihMetricValue **snapshot;
+	NihMetricValue **value;
+#if ENABLE_THREADING
+	NihMetric       *metric;
+	pthread_t        threads[4];
+	int              i;
+#endif /* ENABLE_THREADING */
+
+	TEST_FUNCTION ("nih_metrics_snapshot");
+
+	/* Check that the snapshot is sorted by name, and that each value
+	 * is a child of the array.
+	 */
+	TEST_FEATURE ("with multiple metrics");
+	TEST_ALLOC_FAIL {
+		snapshot = nih_metrics_snapshot (NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (snapshot, NULL);
+			continue;
+		}
+
+		TEST_NE_P (snapshot[0], NULL);
+		for (value = snapshot; *value; value++) {
+			TEST_ALLOC_PARENT (*value, snapshot);
+			if (value[1])
+				TEST_LT (strcmp ((*value)->name,
+						 value[1]->name), 0);
+		}
+
+		nih_free (snapshot);
+	}
+
+
+#if ENABLE_THREADING
+	/* Check that updates made from several threads, which each use
+	 * their own shard, are all counted.
+	 */
+	TEST_FEATURE ("with multiple threads");
+	metric = nih_metric_counter ("test_threads");
+
+	for (i = 0; i < 4; i++)
+		pthread_create (&threads[i], NULL, add_thread, metric);
+	for (i = 0; i < 4; i++)
+		pthread_join (threads[i], NULL);
+
+	snapshot = nih_metrics_snapshot (NULL);
+
+	TEST_EQ (find_value (snapshot, "test_threads")->value, 40000);
+
+	nih_free (snapshot);
+#endif /* ENABLE_THREADING */
+}
+
+void
+test_reset (void)
+{
+	NihMetricValue **snapshot;
+
+	/* Check that resetting metrics zeroes counters and histograms, but
+	 * leaves gauges alone.
+	 */
+	TEST_FUNCTION ("nih_metrics_reset");
+	nih_metrics_reset ();
+
+	snapshot = nih_metrics_snapshot (NULL);
+
+	TEST_EQ (find_value (snapshot, "test_add")->value, 0);
+	TEST_EQ (find_value (snapshot, "test_set_max")->value, 20);
+	TEST_EQ (find_value (snapshot, "test_record")->count, 0);
+	TEST_EQ (find_value (snapshot, "test_record")->max, 0);
+	TEST_EQ (find_value (snapshot, "test_record")->p50, 0);
+
+	nih_free (snapshot);
+}
+
+void
+test_macros (void)
+{
+	NihMetricValue **snapshot;
+	int              i;
+
+	TEST_FUNCTION ("NIH_METRIC_ADD");
+
+	/* Check that the macro does nothing, not even create the counter,
+	 * while metrics are disabled.
+	 */
+	TEST_FEATURE ("with metrics disabled");
+	nih_metrics_enable (FALSE);
+
+	NIH_METRIC_ADD ("test_macro", 1);
+
+	snapshot = nih_metrics_snapshot (NULL);
+
+	TEST_EQ_P (find_value (snapshot, "test_macro"), NULL);
+
+	nih_free (snapshot);
+
+
+	/* Check that the macro creates and updates the counter once
+	 * metrics are enabled, caching it for the next call.
+	 */
+	TEST_FEATURE ("with metrics enabled");
+	nih_metrics_enable (TRUE);
+
+	for (i = 0; i < 3; i++)
+		NIH_METRIC_ADD ("test_macro", 2);
+
+	snapshot = nih_metrics_snapshot (NULL);
+
+	TEST_EQ (find_value (snapshot, "test_macro")->value, 6);
+
+	nih_free (snapshot);
+
+	nih_metrics_enable (FALSE);
+}
+
+void
+test_io_read (void)
+{
+	NihIo         *io;
+	NihMetricValue value;
+	int            fds[2];
+	fd_set         readfds, writefds, exceptfds;
+
+	/* Check that data read into the receive buffer of a stream by its
+	 * read watcher is reflected in the buffer high-water gauge, which
+	 * is otherwise only raised by nih_io_buffer_push().
+	 */
+	TEST_FUNCTION ("nih_io_watcher");
+	nih_metrics_enable (TRUE);
+
+	assert0 (pipe (fds));
+	io = nih_io_reopen (NULL, fds[0], NIH_IO_STREAM,
+			    NULL, NULL, NULL, NULL);
+
+	assert (write (fds[1], "this is a test of the buffer", 28) == 28);
+
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+	FD_SET (fds[0], &readfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (io->recv_buf->len, 28);
+
+	nih_metric_get ("io_buffer_high_water", &value);
+
+	TEST_EQ (value.type, NIH_METRIC_GAUGE);
+	TEST_EQ (value.value, 28);
+
+	nih_free (io);
+	close (fds[1]);
+
+	nih_metrics_enable (FALSE);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_counter ();
+	test_add ();
+	test_set_max ();
+	test_record ();
+	test_get ();
+	test_snapshot ();
+	test_reset ();
+	test_macros ();
+	test_io_read ();
+
+	return 0;
+}
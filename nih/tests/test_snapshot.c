@@ -0,0 +1,498 @@
+/* libnih
+ *
+ * test_snapshot.c - test suite for nih/snapshot.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <sys/mman.h>
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/tree.h>
+#include <nih/snapshot.h>
+#include <nih/error.h>
+#include <nih/errors.h>
+
+
+typedef struct item {
+	NihList entry;
+	char   *name;
+	int     value;
+} Item;
+
+typedef struct node {
+	NihTree node;
+	int     value;
+} Node;
+
+typedef struct root {
+	char    *name;
+	NihList  items;
+	NihHash *index;
+	Node    *tree;
+	Item    *first;
+	char    *data;
+	size_t   len;
+	int      restored;
+} Root;
+
+static int restored_items = 0;
+
+static int
+item_restore (void *ptr)
+{
+	restored_items++;
+	return 0;
+}
+
+static int
+root_restore (void *ptr)
+{
+	((Root *)ptr)->restored = TRUE;
+	return 0;
+}
+
+static const NihSnapshotType item_type;
+static const NihSnapshotType node_type;
+
+static const NihSnapshotField item_fields[] = {
+	{ NIH_SNAPSHOT_LINK, offsetof (Item, entry) },
+	{ NIH_SNAPSHOT_STRING, offsetof (Item, name) },
+};
+
+static const NihSnapshotType item_type = {
+	"test-item-1", sizeof (Item), item_fields,
+	sizeof (item_fields) / sizeof (item_fields[0]), item_restore
+};
+
+static const NihSnapshotField node_fields[] = {
+	{ NIH_SNAPSHOT_TREE, offsetof (Node, node), &node_type,
+	  offsetof (Node, node) },
+};
+
+static const NihSnapshotType node_type = {
+	"test-node-1", sizeof (Node), node_fields,
+	sizeof (node_fields) / sizeof (node_fields[0]), NULL
+};
+
+static const NihSnapshotField root_fields[] = {
+	{ NIH_SNAPSHOT_STRING, offsetof (Root, name) },
+	{ NIH_SNAPSHOT_LIST, offsetof (Root, items), &item_type,
+	  offsetof (Item, entry) },
+	{ NIH_SNAPSHOT_HASH, offsetof (Root, index), &item_type,
+	  offsetof (Item, entry) },
+	{ NIH_SNAPSHOT_POINTER, offsetof (Root, tree), &node_type },
+	{ NIH_SNAPSHOT_POINTER, offsetof (Root, first), &item_type },
+	{ NIH_SNAPSHOT_DATA, offsetof (Root, data), NULL,
+	  offsetof (Root, len) },
+};
+
+static const NihSnapshotType root_type = {
+	"test-root-1", sizeof (Root), root_fields,
+	sizeof (root_fields) / sizeof (root_fields[0]), root_restore
+};
+
+static const NihSnapshotType unknown_type = {
+	"test-unknown-1", sizeof (Item), item_fields,
+	sizeof (item_fields) / sizeof (item_fields[0]), NULL
+};
+
+
+static Item *
+item_new (const void *parent,
+	  const char *name,
+	  int         value)
+{
+	Item *item;
+
+	item = nih_new (parent, Item);
+	nih_list_init (&item->entry);
+	item->name = nih_strdup (item, name);
+	item->value = value;
+
+	return item;
+}
+
+static Node *
+node_new (const void *parent,
+	  int         value)
+{
+	Node *node;
+
+	node = nih_new (parent, Node);
+	nih_tree_init (&node->node);
+	node->value = value;
+
+	return node;
+}
+
+/* Builds a root with two items in its list, two items in its hash table,
+ * a tree of three nodes and a block of data; the first item is also
+ * pointed to directly.
+ */
+static Root *
+root_new (void)
+{
+	Root *root;
+	Node *node;
+
+	root = nih_new (NULL, Root);
+	root->name = nih_strdup (root, "root");
+	nih_list_init (&root->items);
+	root->restored = FALSE;
+
+	nih_list_add (&root->items, &item_new (root, "foo", 1)->entry);
+	nih_list_add (&root->items, &item_new (root, "bar", 2)->entry);
+
+	root->first = (Item *)root->items.next;
+
+	root->len = 4;
+	root->data = nih_alloc (root, root->len);
+	memcpy (root->data, "a\0b\0", root->len);
+
+	root->index = nih_hash_string_new (root, 0);
+	nih_hash_add (root->index, &item_new (root->index, "baz", 3)->entry);
+	nih_hash_add (root->index, &item_new (root->index, "frodo", 4)->entry);
+
+	root->tree = node_new (root, 2);
+	node = node_new (root->tree, 1);
+	nih_tree_add (&root->tree->node, &node->node, NIH_TREE_LEFT);
+	node = node_new (root->tree, 3);
+	nih_tree_add (&root->tree->node, &node->node, NIH_TREE_RIGHT);
+
+	return root;
+}
+
+
+void
+test_register (void)
+{
+	/* Check that types can be registered, and that registering a type
+	 * again is harmless.
+	 */
+	TEST_FUNCTION ("nih_snapshot_register");
+	TEST_EQ (nih_snapshot_register (&item_type), 0);
+	TEST_EQ (nih_snapshot_register (&item_type), 0);
+	TEST_EQ (nih_snapshot_register (&node_type), 0);
+	TEST_EQ (nih_snapshot_register (&root_type), 0);
+}
+
+
+void
+test_new (void)
+{
+	NihSnapshot *snapshot;
+
+	/* Check that a new snapshot is allocated with no objects. */
+	TEST_FUNCTION ("nih_snapshot_new");
+	TEST_ALLOC_FAIL {
+		snapshot = nih_snapshot_new (NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (snapshot, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (snapshot, sizeof (NihSnapshot));
+		TEST_ALLOC_PARENT (snapshot->objects, snapshot);
+		TEST_ALLOC_PARENT (snapshot->addresses, snapshot);
+		TEST_ALLOC_PARENT (snapshot->roots, snapshot);
+		TEST_EQ (snapshot->objects->len, 0);
+
+		nih_free (snapshot);
+	}
+}
+
+
+void
+test_add (void)
+{
+	NihSnapshot *      snapshot;
+	NihSnapshotObject *object;
+	NihError *         err;
+	Root *             root;
+	int                ret;
+
+	TEST_FUNCTION ("nih_snapshot_add");
+	root = root_new ();
+
+	/* Check that adding an object adds every object reachable from it
+	 * exactly once, recording the parent of each; the first item is
+	 * reached twice, and the parent of items in the hash table is
+	 * recorded as its member.
+	 */
+	TEST_FEATURE ("with object graph");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			snapshot = nih_snapshot_new (NULL);
+		}
+
+		ret = nih_snapshot_add (snapshot, "root", &root_type, root);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			nih_free (snapshot);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+		TEST_EQ (snapshot->objects->len, 8);
+
+		object = &NIH_ARRAY_INDEX (snapshot->objects,
+					   NihSnapshotObject, 0);
+		TEST_EQ_P (object->ptr, root);
+		TEST_EQ_P (object->type, &root_type);
+		TEST_EQ (object->parent, 0);
+
+		NIH_ARRAY_FOREACH (snapshot->objects, NihSnapshotObject, iter) {
+			if (iter->type != &item_type)
+				continue;
+
+			TEST_EQ (iter->parent, 1);
+			if (((Item *)iter->ptr)->value > 2) {
+				TEST_EQ (iter->parent_field, 3);
+			} else {
+				TEST_EQ (iter->parent_field, 0);
+			}
+		}
+
+		TEST_EQ_P (nih_snapshot_get (snapshot, "root"), root);
+
+		nih_free (snapshot);
+	}
+
+
+	/* Check that an object shared with one already added is not added
+	 * again.
+	 */
+	TEST_FEATURE ("with shared object");
+	snapshot = nih_snapshot_new (NULL);
+
+	ret = nih_snapshot_add (snapshot, "root", &root_type, root);
+	TEST_EQ (ret, 0);
+
+	ret = nih_snapshot_add (snapshot, "item", &item_type, root->first);
+	TEST_EQ (ret, 0);
+
+	TEST_EQ (snapshot->objects->len, 8);
+	TEST_EQ_P (nih_snapshot_get (snapshot, "item"), root->first);
+
+	nih_free (snapshot);
+
+
+	/* Check that an object reached as a different type results in an
+	 * error.
+	 */
+	TEST_FEATURE ("with mismatched type");
+	snapshot = nih_snapshot_new (NULL);
+
+	ret = nih_snapshot_add (snapshot, "root", &root_type, root);
+	TEST_EQ (ret, 0);
+
+	ret = nih_snapshot_add (snapshot, "item", &node_type, root->first);
+	TEST_LT (ret, 0);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_SNAPSHOT_INVALID);
+	nih_free (err);
+
+	nih_free (snapshot);
+
+	nih_free (root);
+}
+
+
+void
+test_read (void)
+{
+	NihSnapshot *snapshot;
+	NihError *   err;
+	Root *       root;
+	Root *       copy;
+	Item *       item;
+	Node *       node;
+	int          fd;
+	int          i;
+
+	TEST_FUNCTION ("nih_snapshot_read");
+	root = root_new ();
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_snapshot_add (snapshot, "root", &root_type, root));
+
+	fd = nih_snapshot_write (snapshot);
+	TEST_GE (fd, 0);
+	TEST_FALSE (fcntl (fd, F_GETFD) & FD_CLOEXEC);
+
+	nih_free (snapshot);
+
+
+	/* Check that an image written by nih_snapshot_write can be read
+	 * back, and that the objects are restored with the same values,
+	 * links and parents, and that the restore functions are called.
+	 */
+	TEST_FEATURE ("with written image");
+	TEST_ALLOC_FAIL {
+		restored_items = 0;
+
+		snapshot = nih_snapshot_read (NULL, fd);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (snapshot, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+			continue;
+		}
+
+		TEST_NE_P (snapshot, NULL);
+
+		copy = nih_snapshot_get (snapshot, "root");
+		TEST_NE_P (copy, NULL);
+		TEST_NE_P (copy, root);
+		TEST_ALLOC_PARENT (copy, snapshot);
+		TEST_TRUE (copy->restored);
+		TEST_EQ (restored_items, 4);
+
+		TEST_EQ_STR (copy->name, "root");
+		TEST_ALLOC_PARENT (copy->name, copy);
+
+		i = 0;
+		NIH_LIST_FOREACH (&copy->items, iter) {
+			item = (Item *)iter;
+
+			TEST_ALLOC_PARENT (item, copy);
+			TEST_EQ (item->value, i + 1);
+			TEST_EQ_STR (item->name, i ? "bar" : "foo");
+			TEST_ALLOC_PARENT (item->name, item);
+			i++;
+		}
+		TEST_EQ (i, 2);
+
+		TEST_EQ_P (copy->first, (Item *)copy->items.next);
+
+		TEST_EQ (copy->len, 4);
+		TEST_EQ_MEM (copy->data, "a\0b\0", 4);
+		TEST_ALLOC_PARENT (copy->data, copy);
+
+		TEST_ALLOC_PARENT (copy->index, copy);
+		TEST_EQ (copy->index->size, root->index->size);
+
+		item = (Item *)nih_hash_lookup (copy->index, "baz");
+		TEST_NE_P (item, NULL);
+		TEST_EQ (item->value, 3);
+		TEST_ALLOC_PARENT (item, copy->index);
+
+		item = (Item *)nih_hash_lookup (copy->index, "frodo");
+		TEST_NE_P (item, NULL);
+		TEST_EQ (item->value, 4);
+		TEST_ALLOC_PARENT (item, copy->index);
+
+		TEST_ALLOC_PARENT (copy->tree, copy);
+		TEST_EQ (copy->tree->value, 2);
+		TEST_EQ_P (copy->tree->node.parent, NULL);
+
+		node = (Node *)copy->tree->node.left;
+		TEST_NE_P (node, NULL);
+		TEST_EQ (node->value, 1);
+		TEST_EQ_P (node->node.parent, &copy->tree->node);
+		TEST_ALLOC_PARENT (node, copy->tree);
+
+		node = (Node *)copy->tree->node.right;
+		TEST_NE_P (node, NULL);
+		TEST_EQ (node->value, 3);
+		TEST_EQ_P (node->node.parent, &copy->tree->node);
+		TEST_ALLOC_PARENT (node, copy->tree);
+
+		nih_free (snapshot);
+	}
+
+	close (fd);
+	nih_free (root);
+
+
+	/* Check that an image containing a type that has not been registered
+	 * results in an error.
+	 */
+	TEST_FEATURE ("with unknown type");
+	item = item_new (NULL, "foo", 1);
+
+	snapshot = nih_snapshot_new (NULL);
+	assert0 (nih_snapshot_add (snapshot, "item", &unknown_type, item));
+
+	fd = nih_snapshot_write (snapshot);
+	TEST_GE (fd, 0);
+
+	nih_free (snapshot);
+
+	snapshot = nih_snapshot_read (NULL, fd);
+	TEST_EQ_P (snapshot, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_SNAPSHOT_UNKNOWN_TYPE);
+	nih_free (err);
+
+	close (fd);
+	nih_free (item);
+
+
+	/* Check that a file that is not a snapshot image results in an
+	 * error.
+	 */
+	TEST_FEATURE ("with invalid image");
+	fd = memfd_create ("test", 0);
+	TEST_GE (fd, 0);
+	assert (write (fd, "NIHSNAP1\x08", 9) == 9);
+
+	snapshot = nih_snapshot_read (NULL, fd);
+	TEST_EQ_P (snapshot, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_SNAPSHOT_INVALID);
+	nih_free (err);
+
+	close (fd);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_register ();
+	test_new ();
+	test_add ();
+	test_read ();
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+/* libnih
+ *
+ * test_str.c - test suite for nih/str.c
+ *
+ * Copyright © 2026 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/str.h>
+
+
+void
+test_new (void)
+{
+	NihStr *str1;
+	NihStr *str2;
+	char *  parent;
+
+	/* Check that a new shared string is a copy of the string given,
+	 * allocated with nih_alloc as a child of the parent.
+	 */
+	TEST_FUNCTION ("nih_lstr_new");
+	TEST_FEATURE ("with new string");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			parent = nih_strdup (NULL, "parent");
+		}
+
+		str1 = nih_lstr_new (parent, "/com/netsplit/Nih");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str1, NULL);
+			nih_free (parent);
+			continue;
+		}
+
+		TEST_ALLOC_PARENT (str1, parent);
+		TEST_EQ_STR (str1, "/com/netsplit/Nih");
+
+		nih_free (parent);
+	}
+
+
+	/* Check that equal strings are not merged, each is a separate
+	 * copy.
+	 */
+	TEST_FEATURE ("with equal string");
+	parent = nih_strdup (NULL, "parent");
+
+	str1 = nih_lstr_new (parent, "/com/netsplit/Nih");
+	str2 = nih_lstr_new (parent, "/com/netsplit/Nih");
+
+	TEST_NE_P (str2, str1);
+	TEST_EQ_STR (str2, str1);
+
+	nih_free (parent);
+
+
+	/* Check that a shared string without a parent may be discarded. */
+	TEST_FEATURE ("with no parent");
+	str1 = nih_lstr_new (NULL, "/com/netsplit/Nih");
+	TEST_FREE_TAG (str1);
+
+	nih_discard (str1);
+
+	TEST_FREE (str1);
+}
+
+void
+test_newn (void)
+{
+	NihStr *str;
+	char *  parent;
+
+	/* Check that only the given length of the string is used, and that
+	 * it's terminated.
+	 */
+	TEST_FUNCTION ("nih_lstr_newn");
+	parent = nih_strdup (NULL, "parent");
+
+	str = nih_lstr_newn (parent, "/com/netsplit/Nih/Test", 17);
+
+	TEST_ALLOC_PARENT (str, parent);
+	TEST_EQ_STR (str, "/com/netsplit/Nih");
+	TEST_EQ (nih_lstr_len (str), 17);
+
+	nih_free (parent);
+}
+
+void
+test_ref (void)
+{
+	NihStr *str;
+	char *  parent1;
+	char *  parent2;
+
+	TEST_FUNCTION ("nih_lstr_ref");
+
+	/* Check that sharing a string returns the same string, with a
+	 * reference from both parents.
+	 */
+	TEST_FEATURE ("with second parent");
+	parent1 = nih_strdup (NULL, "parent");
+	parent2 = nih_strdup (NULL, "parent");
+
+	str = nih_lstr_new (parent1, "/com/netsplit/Nih");
+
+	TEST_EQ_P (nih_lstr_ref (parent2, str), str);
+	TEST_ALLOC_PARENT (str, parent1);
+	TEST_ALLOC_PARENT (str, parent2);
+
+
+	/* Check that the string survives the first of its parents being
+	 * freed, and is freed along with the last.
+	 */
+	TEST_FEATURE ("with parents freed");
+	TEST_FREE_TAG (str);
+
+	nih_free (parent1);
+
+	TEST_NOT_FREE (str);
+	TEST_EQ_STR (str, "/com/netsplit/Nih");
+
+	nih_free (parent2);
+
+	TEST_FREE (str);
+}
+
+void
+test_len (void)
+{
+	NihStr *str;
+	char *  parent;
+	char    buf[64];
+	size_t  i;
+
+	/* Check that the length of shared strings is returned, for lengths
+	 * either side of the alignment boundaries.
+	 */
+	TEST_FUNCTION ("nih_lstr_len");
+	parent = nih_strdup (NULL, "parent");
+
+	for (i = 0; i < sizeof (buf) - 1; i++) {
+		memset (buf, 'x', i);
+		buf[i] = '\0';
+
+		str = nih_lstr_new (parent, buf);
+
+		TEST_EQ (nih_lstr_len (str), i);
+		TEST_EQ_STR (str, buf);
+	}
+
+	nih_free (parent);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_new ();
+	test_newn ();
+	test_ref ();
+	test_len ();
+
+	return 0;
+}
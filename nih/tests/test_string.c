@@ -84,6 +84,31 @@ test_sprintf (void)
 	}
 
 	nih_free (str1);
+
+
+	/* Check that a string too long to be formatted on the stack is
+	 * still formatted correctly.
+	 */
+	TEST_FEATURE ("with long string");
+	TEST_ALLOC_FAIL {
+		char buf[1000];
+
+		memset (buf, 'x', sizeof (buf) - 1);
+		buf[sizeof (buf) - 1] = '\0';
+
+		str1 = nih_sprintf (NULL, "%s %d", buf, 54321);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str1, NULL);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (str1, sizeof (buf) + 6);
+		TEST_EQ (strncmp (str1, buf, sizeof (buf) - 1), 0);
+		TEST_EQ_STR (str1 + sizeof (buf) - 1, " 54321");
+
+		nih_free (str1);
+	}
 }
 
 
@@ -498,6 +523,69 @@ test_strcat_sprintf (void)
 
 		nih_free (str);
 	}
+
+
+	/* Check that growing a string reserves space for further calls,
+	 * which are formatted into it without allocating.
+	 */
+	TEST_FEATURE ("with reserved space");
+	str = nih_strdup (NULL, "this");
+
+	ret = nih_strcat_sprintf (&str, NULL, " %s", "is");
+
+	TEST_EQ_P (ret, str);
+	TEST_ALLOC_SIZE (str, 10);
+	TEST_EQ_STR (str, "this is");
+
+	TEST_ALLOC_BUDGET (0, 0) {
+		ret = nih_strcat_sprintf (&str, NULL, "%c", '!');
+	}
+
+	TEST_EQ_P (ret, str);
+	TEST_ALLOC_SIZE (str, 10);
+	TEST_EQ_STR (str, "this is!");
+
+	nih_free (str);
+
+
+	/* Check that the string itself may be passed as an argument, both
+	 * when it has to be grown and when the result fits into the space
+	 * already reserved after it.
+	 */
+	TEST_FEATURE ("with string as argument");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			str = nih_strdup (NULL, "this");
+		}
+
+		ret = nih_strcat_sprintf (&str, NULL, " and %s", str);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (ret, NULL);
+			TEST_EQ_STR (str, "this");
+
+			nih_free (str);
+			continue;
+		}
+
+		TEST_EQ_P (ret, str);
+		TEST_EQ_STR (str, "this and this");
+
+		nih_free (str);
+	}
+
+	str = nih_alloc (NULL, 32);
+	strcpy (str, "this");
+
+	TEST_ALLOC_BUDGET (0, 0) {
+		ret = nih_strcat_sprintf (&str, NULL, " %s%s", str, str);
+	}
+
+	TEST_EQ_P (ret, str);
+	TEST_ALLOC_SIZE (str, 32);
+	TEST_EQ_STR (str, "this thisthis");
+
+	nih_free (str);
 }
 
 static char *
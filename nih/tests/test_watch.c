@@ -27,6 +27,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -1631,6 +1633,388 @@ test_reader (void)
 }
 
 
+static int           file_modify_called = 0;
+static int           file_delete_called = 0;
+static NihWatchFile *last_file = NULL;
+static char *        last_file_path = NULL;
+static void *        last_file_data = NULL;
+static int           file_free_in_handler = FALSE;
+
+static void
+my_file_modify_handler (void         *data,
+			NihWatchFile *file,
+			const char   *path,
+			struct stat  *statbuf)
+{
+	file_modify_called++;
+	last_file = file;
+	last_file_data = data;
+
+	free (last_file_path);
+	last_file_path = strdup (path);
+
+	if (file_free_in_handler)
+		nih_free (file);
+}
+
+static void
+my_file_delete_handler (void         *data,
+			NihWatchFile *file,
+			const char   *path)
+{
+	file_delete_called++;
+	last_file = file;
+	last_file_data = data;
+
+	free (last_file_path);
+	last_file_path = strdup (path);
+}
+
+static void
+my_file_events (void)
+{
+	fd_set readfds, writefds, exceptfds;
+	int    nfds = 0;
+
+	file_modify_called = 0;
+	file_delete_called = 0;
+	last_file = NULL;
+	last_file_data = NULL;
+
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	select (nfds, &readfds, &writefds, &exceptfds, NULL);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+}
+
+static void
+my_file_overflow (const char *dirname)
+{
+	FILE *fd;
+	char  filename[PATH_MAX];
+	int   max_events = 16384, i;
+
+	/* Fill the queue of the shared inotify instance by creating more
+	 * files in the directory than it can hold events for.
+	 */
+	fd = fopen ("/proc/sys/fs/inotify/max_queued_events", "r");
+	if (fd) {
+		assert (fscanf (fd, "%d", &max_events) == 1);
+		fclose (fd);
+	}
+
+	for (i = 0; i <= max_events; i++) {
+		sprintf (filename, "%s/overflow%d", dirname, i);
+
+		fd = fopen (filename, "w");
+		fclose (fd);
+		unlink (filename);
+	}
+}
+
+void
+test_file (void)
+{
+	NihWatchFile *file, *other;
+	NihError *    err;
+	FILE *        fd;
+	char          dirname[PATH_MAX], filename[PATH_MAX];
+	char          newname[PATH_MAX], unrelated[PATH_MAX];
+
+	TEST_FUNCTION ("nih_watch_file");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/foo");
+
+	strcpy (newname, dirname);
+	strcat (newname, "/foo.new");
+
+	strcpy (unrelated, dirname);
+	strcat (unrelated, "/bar");
+
+	fd = fopen (filename, "w");
+	fprintf (fd, "test\n");
+	fclose (fd);
+
+
+	/* Check that we can watch an existing file, and that the returned
+	 * structure is filled in with the handlers and data.  The shared
+	 * inotify instance is created by the first watch, so make one
+	 * outside of the allocation failure loop.
+	 */
+	TEST_FEATURE ("with existing file");
+	file = nih_watch_file (NULL, filename, NULL, NULL, NULL);
+	assert (file != NULL);
+	nih_free (file);
+
+	TEST_ALLOC_FAIL {
+		file = nih_watch_file (NULL, filename, my_file_modify_handler,
+				       my_file_delete_handler, &file);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (file, NULL);
+
+			err = nih_error_get ();
+			nih_free (err);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (file, sizeof (NihWatchFile));
+		TEST_NE_P (file->target, NULL);
+		TEST_EQ_STR (file->path, filename);
+		TEST_EQ_P (file->modify_handler, my_file_modify_handler);
+		TEST_EQ_P (file->delete_handler, my_file_delete_handler);
+		TEST_EQ_P (file->data, &file);
+
+		nih_free (file);
+	}
+
+
+	/* Check that the modify handler is called when the file is
+	 * modified.
+	 */
+	TEST_FEATURE ("with modified file");
+	file = nih_watch_file (NULL, filename, my_file_modify_handler,
+			       my_file_delete_handler, &file);
+	TEST_NE_P (file, NULL);
+
+	fd = fopen (filename, "a");
+	fprintf (fd, "more\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ (file_delete_called, 0);
+	TEST_EQ_P (last_file, file);
+	TEST_EQ_STR (last_file_path, filename);
+	TEST_EQ_P (last_file_data, &file);
+
+
+	/* Check that creating a different file in the same directory does
+	 * not call either handler.
+	 */
+	TEST_FEATURE ("with unrelated file");
+	fd = fopen (unrelated, "w");
+	fprintf (fd, "unrelated\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 0);
+	TEST_EQ (file_delete_called, 0);
+
+	unlink (unrelated);
+
+
+	/* Check that replacing the file by renaming another over it calls
+	 * the modify handler, and that the new file is watched.
+	 */
+	TEST_FEATURE ("with replacement by rename");
+	fd = fopen (newname, "w");
+	fprintf (fd, "replaced\n");
+	fclose (fd);
+
+	assert0 (rename (newname, filename));
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ (file_delete_called, 0);
+	TEST_EQ_STR (last_file_path, filename);
+
+	fd = fopen (filename, "a");
+	fprintf (fd, "more\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ_P (last_file, file);
+
+
+	/* Check that a second caller watching the same file shares the
+	 * same watches, and that both handlers are called.
+	 */
+	TEST_FEATURE ("with second caller");
+	other = nih_watch_file (NULL, filename, my_file_modify_handler,
+				NULL, &other);
+	TEST_NE_P (other, NULL);
+	TEST_EQ_P (other->target, file->target);
+
+	fd = fopen (filename, "a");
+	fprintf (fd, "more\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 2);
+
+
+	/* Check that the remaining caller is still called once the other
+	 * removes its watch.
+	 */
+	TEST_FEATURE ("with second caller removed");
+	nih_free (other);
+
+	fd = fopen (filename, "a");
+	fprintf (fd, "more\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ_P (last_file, file);
+
+
+	/* Check that the delete handler is called when the file is
+	 * deleted.
+	 */
+	TEST_FEATURE ("with deleted file");
+	unlink (filename);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 0);
+	TEST_EQ (file_delete_called, 1);
+	TEST_EQ_P (last_file, file);
+	TEST_EQ_STR (last_file_path, filename);
+
+
+	/* Check that the modify handler is called when the file is
+	 * created again.
+	 */
+	TEST_FEATURE ("with re-created file");
+	fd = fopen (filename, "w");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ (file_delete_called, 0);
+	TEST_EQ_P (last_file, file);
+
+
+	/* Check that when the queue overflows, neither handler is called
+	 * for a file that hasn't changed.
+	 */
+	TEST_FEATURE ("with queue overflow");
+	my_file_overflow (dirname);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 0);
+	TEST_EQ (file_delete_called, 0);
+
+
+	/* Check that the modify handler is called when the queue overflows
+	 * and the event for modifying the file is lost.
+	 */
+	TEST_FEATURE ("with modification lost to queue overflow");
+	my_file_overflow (dirname);
+
+	fd = fopen (filename, "a");
+	fprintf (fd, "more\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ (file_delete_called, 0);
+	TEST_EQ_P (last_file, file);
+
+
+	/* Check that the delete handler is called when the queue overflows
+	 * and the event for deleting the file is lost, and that the file
+	 * is watched again once it is re-created.
+	 */
+	TEST_FEATURE ("with deletion lost to queue overflow");
+	my_file_overflow (dirname);
+
+	unlink (filename);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 0);
+	TEST_EQ (file_delete_called, 1);
+	TEST_EQ_P (last_file, file);
+
+	fd = fopen (filename, "w");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ (file_delete_called, 0);
+
+
+	/* Check that it's safe to free the watch from a handler. */
+	TEST_FEATURE ("with free in handler");
+	TEST_FREE_TAG (file);
+
+	file_free_in_handler = TRUE;
+
+	fd = fopen (filename, "a");
+	fprintf (fd, "more\n");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_FREE (file);
+
+	file_free_in_handler = FALSE;
+
+
+	/* Check that we can watch a file that doesn't exist yet, and that
+	 * the modify handler is called when it is created.
+	 */
+	TEST_FEATURE ("with missing file");
+	unlink (filename);
+
+	file = nih_watch_file (NULL, filename, my_file_modify_handler,
+			       my_file_delete_handler, &file);
+	TEST_NE_P (file, NULL);
+
+	fd = fopen (filename, "w");
+	fclose (fd);
+
+	my_file_events ();
+
+	TEST_EQ (file_modify_called, 1);
+	TEST_EQ_P (last_file, file);
+
+	nih_free (file);
+
+
+	/* Check that an error is raised if the directory doesn't exist. */
+	TEST_FEATURE ("with missing directory");
+	strcpy (newname, dirname);
+	strcat (newname, "/missing/foo");
+
+	file = nih_watch_file (NULL, newname, my_file_modify_handler,
+			       my_file_delete_handler, &file);
+
+	TEST_EQ_P (file, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, ENOENT);
+	nih_free (err);
+
+
+	unlink (filename);
+	rmdir (dirname);
+
+	free (last_file_path);
+	last_file_path = NULL;
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -1648,6 +2032,7 @@ main (int   argc,
 	test_add ();
 	test_destroy ();
 	test_reader ();
+	test_file ();
 
 	return 0;
 }
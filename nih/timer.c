@@ -32,8 +32,10 @@
 #include <nih/list.h>
 #include <nih/logging.h>
 #include <nih/error.h>
+#include <nih/metrics.h>
 
 #include "timer.h"
+#include "main_private.h"
 
 
 /**
@@ -112,6 +114,8 @@ nih_timer_add_timeout (const void *parent,
 	timer->callback = callback;
 	timer->data = data;
 
+	timer->caller = __builtin_return_address (0);
+
 	nih_assert (clock_gettime (CLOCK_MONOTONIC, &now) == 0);
 	timer->due = now.tv_sec + timeout;
 
@@ -171,6 +175,8 @@ nih_timer_add_periodic (const void *parent,
 	timer->callback = callback;
 	timer->data = data;
 
+	timer->caller = __builtin_return_address (0);
+
 	nih_assert (clock_gettime (CLOCK_MONOTONIC, &now) == 0);
 	timer->due = now.tv_sec + period;
 
@@ -229,6 +235,8 @@ nih_timer_add_scheduled (const void       *parent,
 	timer->callback = callback;
 	timer->data = data;
 
+	timer->caller = __builtin_return_address (0);
+
 	/* FIXME Not implemented */
 	timer->due = 0;
 
@@ -289,12 +297,20 @@ nih_timer_poll (void)
 	nih_assert (clock_gettime (CLOCK_MONOTONIC, &now) == 0);
 
 	NIH_LIST_FOREACH_SAFE (nih_timers, iter) {
-		NihTimer *timer = (NihTimer *)iter;
-		int       free_when_done = FALSE;
+		NihTimer        *timer = (NihTimer *)iter;
+		NihTimerCb       callback = timer->callback;
+		void            *caller = timer->caller;
+		struct timespec  start;
+		int              free_when_done = FALSE;
 
 		if (timer->due > now.tv_sec)
 			continue;
 
+		NIH_METRIC_ADD ("timer_fired", 1);
+		NIH_METRIC_RECORD ("timer_lateness_ns",
+				   ((uint64_t)(now.tv_sec - timer->due)
+				    * 1000000000ULL + now.tv_nsec));
+
 		switch (timer->type) {
 		case NIH_TIMER_TIMEOUT:
 			nih_ref (timer, nih_timers);
@@ -310,7 +326,9 @@ nih_timer_poll (void)
 		}
 
 		nih_error_push_context ();
+		nih_main_watchdog_begin (&start);
 		timer->callback (timer->data, timer);
+		nih_main_watchdog_end (&start, "timer", callback, caller);
 		nih_error_pop_context ();
 
 		if (free_when_done)
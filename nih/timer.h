@@ -80,7 +80,8 @@ typedef struct nih_timer_schedule {
  * @period: seconds between triggerings of timer (periodic),
  * @schedule: detail of when to call the timer (scheduled),
  * @callback: function called when timer triggered,
- * @data: pointer passed to callback.
+ * @data: pointer passed to callback,
+ * @caller: address of the code that added the timer.
  *
  * Timers may be used whenever a function needs to be called later in
  * the process.  They are divided into three types, identified by @type.
@@ -91,6 +92,11 @@ typedef struct nih_timer_schedule {
  *
  * In all cases, a timer may be cancelled by calling nih_list_remove() on
  * it as they are held in a list internally.
+ *
+ * @caller is only used to identify the timer when reporting slow
+ * callbacks, see nih_main_watchdog_enable().  Functions in libnih that
+ * add a timer on behalf of their own caller record the address of that
+ * caller instead.
  **/
 struct nih_timer {
 	NihList       entry;
@@ -105,6 +111,8 @@ struct nih_timer {
 
 	NihTimerCb    callback;
 	void         *data;
+
+	void         *caller;
 };
 
 
@@ -43,6 +43,7 @@
 #include <nih/watch.h>
 #include <nih/logging.h>
 #include <nih/error.h>
+#include <nih/metrics.h>
 
 
 /**
@@ -54,6 +55,76 @@
 #define INOTIFY_EVENTS (IN_CREATE | IN_DELETE | IN_CLOSE_WRITE \
 			| IN_MOVE | IN_MOVE_SELF)
 
+/**
+ * INOTIFY_FILE_EVENTS:
+ *
+ * The set of inotify events used for watching an individual file with
+ * nih_watch_file().
+ **/
+#define INOTIFY_FILE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF \
+			     | IN_MOVE_SELF)
+
+/**
+ * INOTIFY_FILE_DIR_EVENTS:
+ *
+ * The set of inotify events used for watching the directory of an
+ * individual file with nih_watch_file(), which is only needed to notice
+ * it being created or replaced.
+ **/
+#define INOTIFY_FILE_DIR_EVENTS (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR)
+
+
+/**
+ * NihWatchFileLink:
+ * @entry: entry in hash table,
+ * @wd: inotify watch descriptor, or -1,
+ * @target: path being watched.
+ *
+ * This structure links one of the inotify watches of a path watched with
+ * nih_watch_file() into the hash table of watch descriptors, so that the
+ * paths an event concerns are found without checking every path.
+ **/
+typedef struct nih_watch_file_link {
+	NihList                       entry;
+	int                           wd;
+	struct nih_watch_file_target *target;
+} NihWatchFileLink;
+
+/**
+ * NihWatchFileTarget:
+ * @entry: entry in hash table,
+ * @path: full path being watched,
+ * @name: final component of @path,
+ * @watch: inotify watch for the file,
+ * @dev: device of the file,
+ * @ino: inode of the file,
+ * @changed: last status change of the file,
+ * @dir_watch: inotify watch for the directory,
+ * @pending: entry in list of paths an event is being handled for,
+ * @files: list of NihWatchFile structures for callers.
+ *
+ * This structure holds the inotify watches for a path watched with
+ * nih_watch_file(), shared by each caller watching it.  @dev and @ino
+ * identify the file @watch is watching, so that events for it can be
+ * ignored once another file has replaced it; @changed is used to tell
+ * whether it was modified while events were lost.
+ **/
+typedef struct nih_watch_file_target {
+	NihList           entry;
+	char             *path;
+	const char       *name;
+
+	NihWatchFileLink  watch;
+	dev_t             dev;
+	ino_t             ino;
+	struct timespec   changed;
+
+	NihWatchFileLink  dir_watch;
+
+	NihList           pending;
+	NihList           files;
+} NihWatchFileTarget;
+
 
 /* Prototypes for static functions */
 static NihWatchHandle *nih_watch_handle_by_wd   (NihWatch *watch, int wd);
@@ -75,6 +146,56 @@ static int             nih_watch_walk_filter (void *data, const char *path,
 					      int is_dir)
 	__attribute__ ((warn_unused_result));
 
+static int                 nih_watch_file_init        (void)
+	__attribute__ ((warn_unused_result));
+static NihWatchFileTarget *nih_watch_file_target_new  (const char *path)
+	__attribute__ ((warn_unused_result));
+static void                nih_watch_file_target_free (NihWatchFileTarget *target);
+static void                nih_watch_file_set_wd      (NihWatchFileLink *link,
+						       int wd);
+static const void *        nih_watch_file_wd_key      (NihList *entry);
+static uint32_t            nih_watch_file_wd_hash     (const void *key);
+static int                 nih_watch_file_wd_cmp      (const void *key1,
+						       const void *key2);
+static int                 nih_watch_file_destroy     (NihWatchFile *file);
+static void                nih_watch_file_release     (int wd);
+static void                nih_watch_file_reader      (void *data, NihIo *io,
+						       const char *buf,
+						       size_t len);
+static void                nih_watch_file_handle      (NihWatchFileTarget *target,
+						       int wd, uint32_t events,
+						       const char *name);
+static void                nih_watch_file_rescan      (NihWatchFileTarget *target);
+static void                nih_watch_file_modified    (NihWatchFileTarget *target,
+						       struct stat *statbuf);
+static void                nih_watch_file_deleted     (NihWatchFileTarget *target);
+
+
+/**
+ * file_watch_io:
+ *
+ * NihIo for the inotify instance shared by all watches added with
+ * nih_watch_file(), created on first use.
+ **/
+static NihIo *file_watch_io = NULL;
+
+/**
+ * file_targets:
+ *
+ * Hash table of paths being watched with nih_watch_file(), each entry is
+ * an NihWatchFileTarget structure.
+ **/
+static NihHash *file_targets = NULL;
+
+/**
+ * file_wds:
+ *
+ * Hash table of the inotify watch descriptors of paths being watched
+ * with nih_watch_file(), each entry is an NihWatchFileLink structure;
+ * the same descriptor may be found for several paths.
+ **/
+static NihHash *file_wds = NULL;
+
 
 /**
  * nih_watch_new:
@@ -182,9 +303,104 @@ nih_watch_new (const void       *parent,
 		return NULL;
 	}
 
+	watch->io->watch->caller = __builtin_return_address (0);
+
+	nih_alloc_set_destructor (watch, nih_watch_destroy);
+
+	return watch;
+}
+
+/**
+ * nih_watch_reopen:
+ * @parent: parent object for new watch,
+ * @fd: inotify instance,
+ * @path: full path being watched,
+ * @subdirs: include sub-directories of @path,
+ * @create: call @create_handler for existing files,
+ * @filter: function to filter paths watched,
+ * @create_handler: function called when a path is created,
+ * @modify_handler: function called when a path is modified,
+ * @delete_handler: function called when a path is deleted,
+ * @data: pointer to pass to functions.
+ *
+ * Creates a watch for an inotify instance @fd that was opened elsewhere,
+ * for example inherited from a previous process image, which already
+ * has watch descriptors for @path and any other paths.  Unlike
+ * nih_watch_new() no watches are added, and no handlers are called for
+ * existing files; NihWatchHandle structures for the watch descriptors
+ * should be added to the watches list of the returned structure.
+ *
+ * @fd is closed when the returned watch is freed, but not if this
+ * function fails.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned watch.  When all parents
+ * of the returned watch are freed, the returned watch will also be
+ * freed.
+ *
+ * Returns: new NihWatch structure, or NULL on raised error.
+ **/
+NihWatch *
+nih_watch_reopen (const void       *parent,
+		  int               fd,
+		  const char       *path,
+		  int               subdirs,
+		  int               create,
+		  NihFileFilter     filter,
+		  NihCreateHandler  create_handler,
+		  NihModifyHandler  modify_handler,
+		  NihDeleteHandler  delete_handler,
+		  void             *data)
+{
+	NihWatch *watch;
+
+	nih_assert (fd >= 0);
+	nih_assert (path != NULL);
+
+	watch = nih_new (parent, NihWatch);
+	if (! watch)
+		nih_return_no_memory_error (NULL);
+
+	watch->fd = fd;
+
+	watch->path = nih_strdup (watch, path);
+	if (! watch->path)
+		goto error;
+
+	nih_list_init (&watch->watches);
+
+	watch->created = nih_hash_string_new (watch, 0);
+	if (! watch->created)
+		goto error;
+
+	watch->subdirs = subdirs;
+	watch->create = create;
+	watch->filter = filter;
+
+	watch->create_handler = create_handler;
+	watch->modify_handler = modify_handler;
+	watch->delete_handler = delete_handler;
+	watch->data = data;
+
+	watch->free = NULL;
+
+	watch->io = nih_io_reopen (watch, watch->fd, NIH_IO_STREAM,
+				   (NihIoReader)nih_watch_reader,
+				   NULL, NULL, watch);
+	if (! watch->io) {
+		nih_free (watch);
+		return NULL;
+	}
+
+	watch->io->watch->caller = __builtin_return_address (0);
+
 	nih_alloc_set_destructor (watch, nih_watch_destroy);
 
 	return watch;
+
+error:
+	nih_free (watch);
+	nih_return_no_memory_error (NULL);
 }
 
 
@@ -456,6 +672,10 @@ nih_watch_reader (NihWatch   *watch,
 		if (len < sz)
 			goto finish;
 
+		NIH_METRIC_ADD ("watch_events", 1);
+		if (event->mask & IN_Q_OVERFLOW)
+			NIH_METRIC_ADD ("watch_overflows", 1);
+
 		/* Find the handle for this watch */
 		handle = nih_watch_handle_by_wd (watch, event->wd);
 		if (handle)
@@ -630,3 +850,668 @@ nih_watch_handle (NihWatch       *watch,
 		}
 	}
 }
+
+
+/**
+ * nih_watch_file:
+ * @parent: parent object for new watch,
+ * @path: absolute path to file,
+ * @modify_handler: function called when @path is modified,
+ * @delete_handler: function called when @path is deleted,
+ * @data: pointer to pass to functions.
+ *
+ * Watches the individual file @path for changes, without being woken
+ * for changes to other files in the same directory as a watch of that
+ * directory with nih_watch_new() would be.
+ *
+ * The file itself is watched for modification of its contents or
+ * attributes, calling @modify_handler, and for being deleted or moved
+ * away, calling @delete_handler.  Its directory is watched only for
+ * files created or moved into @path, so that replacing the file by
+ * renaming a new one over it, as editors and package managers do, calls
+ * @modify_handler for the new file; @path need not exist when the watch
+ * is added, but its directory must.
+ *
+ * @path must be an absolute path.  Callers watching the same @path share
+ * the same inotify watches, and there is a single inotify instance for
+ * all such watches, so they are cheap to add.
+ *
+ * The returned watch structure is allocated with nih_alloc(), and may be
+ * removed with nih_free().
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned watch.  When all parents
+ * of the returned watch are freed, the returned watch will also be
+ * freed.
+ *
+ * Returns: new NihWatchFile structure, or NULL on raised error.
+ **/
+NihWatchFile *
+nih_watch_file (const void                *parent,
+		const char                *path,
+		NihWatchFileModifyHandler  modify_handler,
+		NihWatchFileDeleteHandler  delete_handler,
+		void                      *data)
+{
+	NihWatchFileTarget *target;
+	NihWatchFile *      file;
+
+	nih_assert (path != NULL);
+	nih_assert (path[0] == '/');
+
+	if (nih_watch_file_init () < 0)
+		return NULL;
+
+	target = (NihWatchFileTarget *)nih_hash_lookup (file_targets, path);
+	if (! target) {
+		target = nih_watch_file_target_new (path);
+		if (! target)
+			return NULL;
+	}
+
+	file = nih_new (parent, NihWatchFile);
+	if (! file) {
+		nih_watch_file_target_free (target);
+		nih_return_no_memory_error (NULL);
+	}
+
+	nih_list_init (&file->entry);
+
+	file->target = target;
+	file->path = target->path;
+
+	file->modify_handler = modify_handler;
+	file->delete_handler = delete_handler;
+	file->data = data;
+
+	nih_list_add (&target->files, &file->entry);
+
+	nih_alloc_set_destructor (file, nih_watch_file_destroy);
+
+	return file;
+}
+
+/**
+ * nih_watch_file_init:
+ *
+ * Initialise the inotify instance shared by watches added with
+ * nih_watch_file(), and the hash tables of paths being watched and of
+ * their watch descriptors.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+nih_watch_file_init (void)
+{
+	int fd;
+
+	if (! file_targets) {
+		file_targets = nih_hash_string_new (NULL, 0);
+		if (! file_targets)
+			nih_return_no_memory_error (-1);
+	}
+
+	if (! file_wds) {
+		file_wds = nih_hash_new (NULL, 0, nih_watch_file_wd_key,
+					 nih_watch_file_wd_hash,
+					 nih_watch_file_wd_cmp);
+		if (! file_wds)
+			nih_return_no_memory_error (-1);
+	}
+
+	if (! file_watch_io) {
+		fd = inotify_init ();
+		if (fd < 0)
+			nih_return_system_error (-1);
+
+		nih_io_set_cloexec (fd);
+
+		file_watch_io = nih_io_reopen (NULL, fd, NIH_IO_STREAM,
+					       nih_watch_file_reader,
+					       NULL, NULL, NULL);
+		if (! file_watch_io) {
+			close (fd);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * nih_watch_file_target_new:
+ * @path: full path to file.
+ *
+ * Adds inotify watches for @path and its directory to the shared
+ * instance, and a structure for them to the hash tables of paths being
+ * watched and of their watch descriptors.  A missing @path is not an
+ * error, the directory watch will notice it being created.
+ *
+ * Returns: new NihWatchFileTarget structure, or NULL on raised error.
+ **/
+static NihWatchFileTarget *
+nih_watch_file_target_new (const char *path)
+{
+	NihWatchFileTarget *target;
+	nih_local char *    dirname = NULL;
+	struct stat         statbuf;
+	int                 wd, dir_wd;
+
+	nih_assert (path != NULL);
+	nih_assert (path[0] == '/');
+
+	target = nih_new (file_targets, NihWatchFileTarget);
+	if (! target)
+		nih_return_no_memory_error (NULL);
+
+	nih_list_init (&target->entry);
+	nih_list_init (&target->pending);
+	nih_list_init (&target->files);
+
+	nih_list_init (&target->watch.entry);
+	target->watch.wd = -1;
+	target->watch.target = target;
+
+	nih_list_init (&target->dir_watch.entry);
+	target->dir_watch.wd = -1;
+	target->dir_watch.target = target;
+
+	target->path = nih_strdup (target, path);
+	if (! target->path)
+		goto error;
+
+	target->name = strrchr (target->path, '/') + 1;
+
+	dirname = nih_strndup (NULL, path,
+			       (target->name - target->path > 1
+				? target->name - target->path - 1 : 1));
+	if (! dirname)
+		goto error;
+
+	target->dev = 0;
+	target->ino = 0;
+	memset (&target->changed, 0, sizeof (target->changed));
+
+	/* Watch the directory first, so that we can't miss the file
+	 * being created once we've found that it doesn't exist.
+	 */
+	dir_wd = inotify_add_watch (file_watch_io->watch->fd, dirname,
+				    INOTIFY_FILE_DIR_EVENTS | IN_MASK_ADD);
+	if (dir_wd < 0) {
+		nih_error_raise_system ();
+		nih_free (target);
+		return NULL;
+	}
+
+	wd = inotify_add_watch (file_watch_io->watch->fd, path,
+				INOTIFY_FILE_EVENTS | IN_MASK_ADD);
+	if ((wd < 0) && (errno != ENOENT)) {
+		nih_error_raise_system ();
+		nih_watch_file_release (dir_wd);
+		nih_free (target);
+		return NULL;
+	}
+
+	if ((wd >= 0) && (stat (path, &statbuf) == 0)) {
+		target->dev = statbuf.st_dev;
+		target->ino = statbuf.st_ino;
+		target->changed = statbuf.st_ctim;
+	}
+
+	nih_watch_file_set_wd (&target->watch, wd);
+	nih_watch_file_set_wd (&target->dir_watch, dir_wd);
+
+	nih_hash_add (file_targets, &target->entry);
+
+	return target;
+error:
+	nih_free (target);
+	nih_return_no_memory_error (NULL);
+}
+
+/**
+ * nih_watch_file_target_free:
+ * @target: target to free.
+ *
+ * Once there are no callers left watching @target, removes it from the
+ * hash tables of paths being watched, removing its inotify watches unless
+ * they are shared with another path, and frees it once no event is being
+ * handled for it.
+ *
+ * While the handlers of callers are being called, the list of callers
+ * contains a cursor, so this is called again afterwards.
+ **/
+static void
+nih_watch_file_target_free (NihWatchFileTarget *target)
+{
+	int wd, dir_wd;
+
+	nih_assert (target != NULL);
+
+	if ((! NIH_LIST_EMPTY (&target->files))
+	    || NIH_LIST_EMPTY (&target->entry))
+		return;
+
+	nih_list_remove (&target->entry);
+
+	wd = target->watch.wd;
+	dir_wd = target->dir_watch.wd;
+
+	nih_watch_file_set_wd (&target->watch, -1);
+	nih_watch_file_set_wd (&target->dir_watch, -1);
+
+	nih_watch_file_release (wd);
+	nih_watch_file_release (dir_wd);
+
+	nih_unref (target, file_targets);
+}
+
+/**
+ * nih_watch_file_set_wd:
+ * @link: link to change,
+ * @wd: new inotify watch descriptor, or -1.
+ *
+ * Changes the watch descriptor of @link, moving it within the hash table
+ * of watch descriptors.
+ **/
+static void
+nih_watch_file_set_wd (NihWatchFileLink *link,
+		       int               wd)
+{
+	nih_assert (link != NULL);
+
+	nih_list_remove (&link->entry);
+
+	link->wd = wd;
+	if (wd >= 0)
+		nih_hash_add (file_wds, &link->entry);
+}
+
+/**
+ * nih_watch_file_wd_key:
+ * @entry: NihWatchFileLink entry.
+ *
+ * Key function for the hash table of watch descriptors.
+ *
+ * Returns: pointer to watch descriptor.
+ **/
+static const void *
+nih_watch_file_wd_key (NihList *entry)
+{
+	nih_assert (entry != NULL);
+
+	return &((NihWatchFileLink *)entry)->wd;
+}
+
+/**
+ * nih_watch_file_wd_hash:
+ * @key: pointer to watch descriptor.
+ *
+ * Hash function for the hash table of watch descriptors; descriptors are
+ * allocated in sequence, so are spread by multiplying.
+ *
+ * Returns: 32-bit hash.
+ **/
+static uint32_t
+nih_watch_file_wd_hash (const void *key)
+{
+	nih_assert (key != NULL);
+
+	return (uint32_t)*(const int *)key * 2654435761U;
+}
+
+/**
+ * nih_watch_file_wd_cmp:
+ * @key1: pointer to watch descriptor,
+ * @key2: pointer to watch descriptor.
+ *
+ * Comparison function for the hash table of watch descriptors.
+ *
+ * Returns: zero if @key1 and @key2 are the same, non-zero otherwise.
+ **/
+static int
+nih_watch_file_wd_cmp (const void *key1,
+		       const void *key2)
+{
+	nih_assert (key1 != NULL);
+	nih_assert (key2 != NULL);
+
+	return *(const int *)key1 != *(const int *)key2;
+}
+
+/**
+ * nih_watch_file_destroy:
+ * @file: NihWatchFile to be destroyed.
+ *
+ * Removes @file from the list of callers watching its path, and removes
+ * the watches for the path once there are none left.
+ *
+ * Normally used or called from an nih_alloc() destructor.
+ *
+ * Returns: zero.
+ **/
+static int
+nih_watch_file_destroy (NihWatchFile *file)
+{
+	NihWatchFileTarget *target;
+
+	nih_assert (file != NULL);
+
+	target = file->target;
+
+	nih_list_destroy (&file->entry);
+	nih_watch_file_target_free (target);
+
+	return 0;
+}
+
+/**
+ * nih_watch_file_release:
+ * @wd: inotify watch descriptor.
+ *
+ * Removes @wd from the shared inotify instance, unless it is still used
+ * by a path being watched; the same descriptor is returned for each
+ * path of a file with multiple links, and for a directory containing
+ * several files being watched.
+ **/
+static void
+nih_watch_file_release (int wd)
+{
+	if (wd < 0)
+		return;
+
+	if (nih_hash_lookup (file_wds, &wd))
+		return;
+
+	inotify_rm_watch (file_watch_io->watch->fd, wd);
+}
+
+
+/**
+ * nih_watch_file_reader:
+ * @data: not used,
+ * @io: NihIo with data to be read,
+ * @buf: buffer data is available in,
+ * @len: bytes in @buf.
+ *
+ * This function is called whenever there is data to be read on the
+ * inotify instance shared by watches added with nih_watch_file().  Each
+ * event in the buffer is read and handled for every path it concerns,
+ * found by its watch descriptor.  When the queue of the instance has
+ * overflowed, events may have been lost for any path, so every path is
+ * checked again instead.
+ **/
+static void
+nih_watch_file_reader (void       *data,
+		       NihIo      *io,
+		       const char *buf,
+		       size_t      len)
+{
+	NihList  pending;
+	NihList *iter;
+
+	nih_assert (io != NULL);
+	nih_assert (buf != NULL);
+	nih_assert (len > 0);
+
+	while (len >= sizeof (struct inotify_event)) {
+		struct inotify_event *event;
+		size_t                sz;
+
+		event = (struct inotify_event *)buf;
+		sz = sizeof (struct inotify_event) + event->len;
+		if (len < sz)
+			break;
+
+		NIH_METRIC_ADD ("watch_events", 1);
+
+		/* Gather the paths first, since handling an event may
+		 * change their watch descriptors; and hold a reference to
+		 * each path while handling it, so that it isn't freed from
+		 * under us when its last caller frees their watch from a
+		 * handler.
+		 */
+		nih_list_init (&pending);
+
+		if (event->mask & IN_Q_OVERFLOW) {
+			NIH_METRIC_ADD ("watch_overflows", 1);
+
+			NIH_HASH_FOREACH (file_targets, target_iter) {
+				NihWatchFileTarget *target;
+
+				target = (NihWatchFileTarget *)target_iter;
+
+				nih_ref (target, io);
+				nih_list_add (&pending, &target->pending);
+			}
+		}
+
+		for (iter = nih_hash_lookup (file_wds, &event->wd);
+		     iter; iter = nih_hash_search (file_wds, &event->wd, iter)) {
+			NihWatchFileLink *  link = (NihWatchFileLink *)iter;
+			NihWatchFileTarget *target = link->target;
+
+			if (! NIH_LIST_EMPTY (&target->pending))
+				continue;
+
+			nih_ref (target, io);
+			nih_list_add (&pending, &target->pending);
+		}
+
+		while (! NIH_LIST_EMPTY (&pending)) {
+			NihWatchFileTarget *target;
+
+			target = NIH_LIST_ITER (pending.next, NihWatchFileTarget,
+						pending);
+			nih_list_remove (&target->pending);
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				nih_watch_file_rescan (target);
+			} else {
+				nih_watch_file_handle (target, event->wd,
+						       event->mask,
+						       (event->len
+							? event->name : NULL));
+			}
+			nih_unref (target, io);
+		}
+
+		nih_io_buffer_shrink (io->recv_buf, sz);
+		buf = io->recv_buf->buf;
+		len -= sz;
+	}
+}
+
+/**
+ * nih_watch_file_handle:
+ * @target: path being watched,
+ * @wd: inotify watch descriptor,
+ * @events: inotify events mask,
+ * @name: name of path under directory @wd.
+ *
+ * This function is called for each event on either of the inotify
+ * watches for @target, and calls the handlers of each caller watching
+ * it when the file is modified, replaced or deleted.
+ **/
+static void
+nih_watch_file_handle (NihWatchFileTarget *target,
+		       int                 wd,
+		       uint32_t            events,
+		       const char         *name)
+{
+	struct stat statbuf;
+
+	nih_assert (target != NULL);
+
+	/* Events for the file itself; check that the path still refers
+	 * to the file we're watching since it may have been replaced, in
+	 * which case the directory watch handles it.
+	 */
+	if ((target->watch.wd == wd) && (! name)) {
+		if (events & IN_IGNORED) {
+			nih_watch_file_set_wd (&target->watch, -1);
+		} else if (stat (target->path, &statbuf) < 0) {
+			nih_watch_file_set_wd (&target->watch, -1);
+			nih_watch_file_release (wd);
+
+			nih_watch_file_deleted (target);
+		} else if ((statbuf.st_dev != target->dev)
+			   || (statbuf.st_ino != target->ino)) {
+			if (events & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+				nih_watch_file_set_wd (&target->watch, -1);
+				nih_watch_file_release (wd);
+			}
+		} else if (events & (IN_MODIFY | IN_ATTRIB)) {
+			nih_watch_file_modified (target, &statbuf);
+		}
+	}
+
+	/* Events for the directory; only a file being created or moved
+	 * into the path matter, for which we watch the new file.
+	 */
+	if (target->dir_watch.wd == wd) {
+		int new_wd;
+
+		if (events & IN_IGNORED) {
+			nih_watch_file_set_wd (&target->dir_watch, -1);
+			return;
+		}
+
+		if ((! name) || strcmp (name, target->name)
+		    || (! (events & (IN_CREATE | IN_MOVED_TO))))
+			return;
+
+		new_wd = inotify_add_watch (file_watch_io->watch->fd,
+					    target->path,
+					    INOTIFY_FILE_EVENTS | IN_MASK_ADD);
+		if (new_wd < 0)
+			return;
+
+		/* The file may have gone again already; the new watch is
+		 * only kept if it is shared with another path.
+		 */
+		if (stat (target->path, &statbuf) < 0) {
+			nih_watch_file_release (new_wd);
+			return;
+		}
+
+		if (target->watch.wd != new_wd) {
+			wd = target->watch.wd;
+			nih_watch_file_set_wd (&target->watch, new_wd);
+			nih_watch_file_release (wd);
+		}
+
+		target->dev = statbuf.st_dev;
+		target->ino = statbuf.st_ino;
+
+		nih_watch_file_modified (target, &statbuf);
+	}
+}
+
+/**
+ * nih_watch_file_rescan:
+ * @target: path being watched.
+ *
+ * This function is called for every path being watched once the queue
+ * of the shared inotify instance has overflowed, since events for
+ * @target may have been lost.  The file is watched again in case it was
+ * created or replaced, and the handlers of each caller watching it are
+ * called if it has been modified, replaced or deleted since it was last
+ * seen.
+ **/
+static void
+nih_watch_file_rescan (NihWatchFileTarget *target)
+{
+	struct stat statbuf;
+	int         wd, new_wd;
+
+	nih_assert (target != NULL);
+
+	wd = target->watch.wd;
+
+	new_wd = inotify_add_watch (file_watch_io->watch->fd, target->path,
+				    INOTIFY_FILE_EVENTS | IN_MASK_ADD);
+	if ((new_wd < 0) && (errno != ENOENT))
+		return;
+
+	if ((new_wd < 0) || (stat (target->path, &statbuf) < 0)) {
+		nih_watch_file_release (new_wd);
+
+		if (wd >= 0) {
+			nih_watch_file_set_wd (&target->watch, -1);
+			nih_watch_file_release (wd);
+
+			nih_watch_file_deleted (target);
+		}
+
+		return;
+	}
+
+	/* A different watch descriptor means a different file, otherwise
+	 * it's only been modified if its status has changed.
+	 */
+	if (new_wd != wd) {
+		nih_watch_file_set_wd (&target->watch, new_wd);
+		nih_watch_file_release (wd);
+	} else if ((statbuf.st_dev == target->dev)
+		   && (statbuf.st_ino == target->ino)
+		   && (statbuf.st_ctim.tv_sec == target->changed.tv_sec)
+		   && (statbuf.st_ctim.tv_nsec == target->changed.tv_nsec)) {
+		return;
+	}
+
+	target->dev = statbuf.st_dev;
+	target->ino = statbuf.st_ino;
+
+	nih_watch_file_modified (target, &statbuf);
+}
+
+/**
+ * nih_watch_file_modified:
+ * @target: path being watched,
+ * @statbuf: stat of path.
+ *
+ * Calls the modify handler of each caller watching @target, and notes
+ * the status change of the file in @statbuf.
+ **/
+static void
+nih_watch_file_modified (NihWatchFileTarget *target,
+			 struct stat        *statbuf)
+{
+	nih_assert (target != NULL);
+	nih_assert (statbuf != NULL);
+
+	target->changed = statbuf->st_ctim;
+
+	NIH_LIST_FOREACH_SAFE (&target->files, iter) {
+		NihWatchFile *file = (NihWatchFile *)iter;
+
+		if (file->modify_handler)
+			file->modify_handler (file->data, file,
+					      target->path, statbuf);
+	}
+
+	nih_watch_file_target_free (target);
+}
+
+/**
+ * nih_watch_file_deleted:
+ * @target: path being watched.
+ *
+ * Calls the delete handler of each caller watching @target.
+ **/
+static void
+nih_watch_file_deleted (NihWatchFileTarget *target)
+{
+	nih_assert (target != NULL);
+
+	NIH_LIST_FOREACH_SAFE (&target->files, iter) {
+		NihWatchFile *file = (NihWatchFile *)iter;
+
+		if (file->delete_handler)
+			file->delete_handler (file->data, file,
+					      target->path);
+	}
+
+	nih_watch_file_target_free (target);
+}
@@ -33,6 +33,7 @@
 
 /* Predefine the typedefs as we use them in the callbacks */
 typedef struct nih_watch NihWatch;
+typedef struct nih_watch_file NihWatchFile;
 
 /**
  * NihCreateHandler:
@@ -89,6 +90,39 @@ typedef void (*NihModifyHandler) (void *data, NihWatch *watch,
 typedef void (*NihDeleteHandler) (void *data, NihWatch *watch,
 				  const char *path);
 
+/**
+ * NihWatchFileModifyHandler:
+ * @data: data pointer given when registered,
+ * @file: NihWatchFile for path,
+ * @path: full path to file,
+ * @statbuf: stat of @path.
+ *
+ * A file modify handler is a function that is called whenever the
+ * contents or attributes of a file being watched with nih_watch_file()
+ * change, including when it is created or replaced by another file.
+ *
+ * It is safe to remove the watch with nih_free() from this function.
+ **/
+typedef void (*NihWatchFileModifyHandler) (void *data, NihWatchFile *file,
+					   const char *path,
+					   struct stat *statbuf);
+
+/**
+ * NihWatchFileDeleteHandler:
+ * @data: data pointer given when registered,
+ * @file: NihWatchFile for path,
+ * @path: full path to file.
+ *
+ * A file delete handler is a function that is called whenever a file
+ * being watched with nih_watch_file() is deleted or moved away.  The
+ * watch remains, and the modify handler is called should the file be
+ * created again.
+ *
+ * It is safe to remove the watch with nih_free() from this function.
+ **/
+typedef void (*NihWatchFileDeleteHandler) (void *data, NihWatchFile *file,
+					   const char *path);
+
 
 /**
  * NihWatch:
@@ -148,6 +182,33 @@ typedef struct nih_watch_handle {
 	char    *path;
 } NihWatchHandle;
 
+/**
+ * NihWatchFile:
+ * @entry: entry in list of watches for the same path,
+ * @target: watch shared with other callers,
+ * @path: full path being watched,
+ * @modify_handler: function called when @path is modified,
+ * @delete_handler: function called when @path is deleted,
+ * @data: pointer to pass to functions.
+ *
+ * This structure represents a single caller's interest in an individual
+ * file, returned by nih_watch_file().  Callers watching the same path
+ * share the same inotify watches, through @target, and are each called
+ * in turn.
+ *
+ * The watch may be removed by using nih_free().
+ **/
+struct nih_watch_file {
+	NihList                        entry;
+	struct nih_watch_file_target  *target;
+
+	const char                    *path;
+
+	NihWatchFileModifyHandler      modify_handler;
+	NihWatchFileDeleteHandler      delete_handler;
+	void                          *data;
+};
+
 
 NIH_BEGIN_EXTERN
 
@@ -157,12 +218,24 @@ NihWatch *nih_watch_new     (const void *parent, const char *path, int subdirs,
 			     NihModifyHandler modify_handler,
 			     NihDeleteHandler delete_handler, void *data)
 	__attribute__ ((warn_unused_result));
+NihWatch *nih_watch_reopen  (const void *parent, int fd, const char *path,
+			     int subdirs, int create, NihFileFilter filter,
+			     NihCreateHandler create_handler,
+			     NihModifyHandler modify_handler,
+			     NihDeleteHandler delete_handler, void *data)
+	__attribute__ ((warn_unused_result));
 
 int       nih_watch_add     (NihWatch *watch, const char *path, int subdirs)
 	__attribute__ ((warn_unused_result));
 
 int       nih_watch_destroy (NihWatch *watch);
 
+NihWatchFile *nih_watch_file (const void *parent, const char *path,
+			      NihWatchFileModifyHandler modify_handler,
+			      NihWatchFileDeleteHandler delete_handler,
+			      void *data)
+	__attribute__ ((warn_unused_result));
+
 NIH_END_EXTERN
 
 #endif /* NIH_WATCH_H */